@@ -0,0 +1,301 @@
+/*
+ * Blend tree crowd benchmark.
+ *
+ * Makes walk, run, lean and wave animation clips for a skeleton and
+ * a crowd of characters which all share them. Each character has a
+ * BlendTree which interpolates between walk and run by its speed,
+ * adds the lean on top and layers the wave on the upper body.
+ * The trees are children of a BlendGroup which evaluates them in
+ * parallel. Each frame of the crowd is timed with different numbers
+ * of threads and the poses computed are compared to the poses
+ * computed by one thread.
+ *
+ * Frame times and speedups are written as JSON.
+ *
+ *	blendbench [options]
+ *		-chars n		number of characters in the crowd (default 200)
+ *		-bones n		number of bones in the skeleton (default 40)
+ *		-frames n		number of frames to run (default 300)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_FrameRate		30.0f
+#define	BENCH_PlayRate		60.0f
+#define	BENCH_ClipSeconds	4.0f
+#define	BENCH_NumModes		4
+
+static const int32 ModeThreads[BENCH_NumModes] = { 1, 2, 4, 8 };
+
+/*!
+ * @class BlendBench
+ * @brief Measures parallel evaluation of blend trees for a crowd.
+ */
+class BlendBench : public World
+{
+public:
+	BlendBench();
+	~BlendBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	bool		ParseOptions(int argc, char** argv);
+	AnimClip*	MakeClip(float rate, float amp, float lean);
+	bool		MakeCrowd(BlendGroup* group, Engine* skels);
+	bool		RunMode(int mode);
+	void		WriteReport(FILE* fp);
+
+	int32			m_NumChars;
+	int32			m_NumBones;
+	int32			m_NumFrames;
+	const char*		m_OutFile;
+	Ref<AnimClip>	m_Walk;
+	Ref<AnimClip>	m_Run;
+	Ref<AnimClip>	m_Lean;
+	Ref<AnimClip>	m_Wave;
+	float*			m_Times[BENCH_NumModes];
+	double			m_Sums[BENCH_NumModes];
+};
+
+BlendBench::BlendBench() : World()
+{
+	m_NumChars = 200;
+	m_NumBones = 40;
+	m_NumFrames = 300;
+	m_OutFile = NULL;
+	for (int i = 0; i < BENCH_NumModes; ++i)
+	{
+		m_Times[i] = NULL;
+		m_Sums[i] = 0;
+	}
+}
+
+BlendBench::~BlendBench()
+{
+	for (int i = 0; i < BENCH_NumModes; ++i)
+		if (m_Times[i])
+			free(m_Times[i]);
+}
+
+bool BlendBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+		if (!BenchOption(argc, argv, i, "-chars", m_NumChars) &&
+			!BenchOption(argc, argv, i, "-bones", m_NumBones) &&
+			!BenchOption(argc, argv, i, "-frames", m_NumFrames) &&
+			!BenchOption(argc, argv, i, "-out", m_OutFile))
+			return false;
+	if ((m_NumChars <= 0) || (m_NumBones <= 1) || (m_NumFrames <= 0))
+		return false;
+	return true;
+}
+
+/*
+ * Make a looping clip for a chain of bones. Each bone swings about
+ * its own axis at a multiple of the given rate and the root bobs
+ * up and down. The lean is a constant bend of every bone.
+ */
+AnimClip* BlendBench::MakeClip(float rate, float amp, float lean)
+{
+	AnimClip*	clip = new AnimClip;
+	int32		framesize = 3 + 4 * m_NumBones;
+	int32		numframes = int32(BENCH_ClipSeconds * BENCH_FrameRate) + 1;
+	float*		samples = (float*) malloc(numframes * framesize * sizeof(float));
+	bool		ok;
+
+	if (samples == NULL)
+	{
+		clip->Delete();
+		return NULL;
+	}
+	for (int32 b = 0; b < m_NumBones; ++b)
+	{
+		char	name[32];
+
+		sprintf(name, "bone%d", b);
+		clip->AddBone(Core::String(name), b - 1, Vec3(0, (b > 0) ? 10.0f : 0.0f, 0), Quat(0, 0, 0, 1));
+	}
+	clip->AddChannel(0, Evaluator::POSITION);
+	for (int32 b = 0; b < m_NumBones; ++b)
+		clip->AddChannel(b, Evaluator::ROTATION);
+	for (int32 f = 0; f < numframes; ++f)
+	{
+		float	t = f / BENCH_FrameRate;
+		float	phase = 2.0f * PI * t / BENCH_ClipSeconds;
+		float*	s = samples + f * framesize;
+
+		*s++ = 0;
+		*s++ = 90.0f + amp * 5.0f * sinf(2.0f * rate * phase);
+		*s++ = 0;
+		for (int32 b = 0; b < m_NumBones; ++b)
+		{
+			Vec3	axis(sinf(float(b)), cosf(float(b)), 0.5f);
+			Quat	q;
+
+			axis.Normalize();
+			q.Set(axis, lean + amp * sinf(rate * phase + 0.3f * b));
+			*s++ = q.x;
+			*s++ = q.y;
+			*s++ = q.z;
+			*s++ = q.w;
+		}
+	}
+	ok = clip->Compress(samples, numframes, 1.0f / BENCH_FrameRate);
+	free(samples);
+	if (!ok)
+	{
+		clip->Delete();
+		return NULL;
+	}
+	return clip;
+}
+
+/*
+ * Make a skeleton and a blend tree for each character.
+ * The characters start at different times in the clips
+ * and move at different speeds. The skeletons are kept
+ * under another engine because the trees do not reference them.
+ */
+bool BlendBench::MakeCrowd(BlendGroup* group, Engine* skels)
+{
+	uint32	seed = 12345;
+
+	for (int32 i = 0; i < m_NumChars; ++i)
+	{
+		char		name[32];
+		Skeleton*	skel;
+		BlendTree*	tree;
+		float		ofs, speed;
+		int			walk, run, loco, lean, leanref, add, wave, layer;
+
+		seed = seed * 1664525 + 1013904223;
+		ofs = BENCH_ClipSeconds * float((seed >> 8) & 0xFFFF) / 65535.0f;
+		speed = float((seed >> 4) & 0xF) / 15.0f;
+		sprintf(name, "char%d", i);
+		if ((skel = m_Walk->MakeSkeleton(Core::String(name), false)) == NULL)
+			return false;
+		tree = new BlendTree;
+		tree->SetName(Core::String(name) + TEXT(".blend"));
+		tree->SetTarget(skel);
+		walk = tree->AddClip(m_Walk, 1.0f, ofs);
+		run = tree->AddClip(m_Run, 1.5f, ofs);
+		loco = tree->AddLerp(walk, run, speed);
+		lean = tree->AddClip(m_Lean, 1.0f, ofs);
+		leanref = tree->AddClip(m_Lean, 0.0f, 0.0f, false);
+		add = tree->AddAdditive(loco, lean, leanref, 0.5f * speed);
+		wave = tree->AddClip(m_Wave, 1.0f, ofs);
+		layer = tree->AddLayer(add, wave, 0.8f);
+		if ((layer < 0) ||
+			!tree->SetMask(layer, 0, 0.0f) ||
+			!tree->SetMask(layer, m_NumBones / 2, 1.0f))
+			return false;
+		group->Append(tree);
+		skels->Append(skel);
+	}
+	return true;
+}
+
+/*
+ * Build a crowd and run all the frames with the number of threads for one mode.
+ */
+bool BlendBench::RunMode(int mode)
+{
+	Ref<BlendGroup>	group = new BlendGroup;
+	Ref<Engine>		skels = new Engine;
+	double			sum = 0.0;
+
+	BlendGroup::NumThreads = ModeThreads[mode];
+	if (!MakeCrowd(group, skels))
+		return false;
+	m_Times[mode] = (float*) malloc(m_NumFrames * sizeof(float));
+	if (m_Times[mode] == NULL)
+		return false;
+	for (int32 f = 0; f < m_NumFrames; ++f)
+	{
+		int64	start = Core::Profiler::GetTicks();
+
+		group->Compute(f / BENCH_PlayRate);
+		m_Times[mode][f] = BenchElapsed(start);
+	}
+	GroupIterNotSafe<BlendTree> iter(group, Group::CHILDREN);
+	BlendTree*	tree;
+	while (tree = iter.Next())
+		for (int32 b = 0; b < m_NumBones; ++b)
+		{
+			Quat	q;
+
+			if (tree->GetLocalRotation(b, q))
+				sum += q.x + q.y + q.z + q.w;
+		}
+	m_Sums[mode] = sum;
+	return true;
+}
+
+void BlendBench::WriteReport(FILE* fp)
+{
+	double	maxdiff = 0.0;
+	float	base = 0.0f;
+
+	for (int m = 1; m < BENCH_NumModes; ++m)
+	{
+		double	d = fabs(m_Sums[m] - m_Sums[0]);
+
+		if (d > maxdiff)
+			maxdiff = d;
+	}
+	fprintf(fp, "{\n\t\"characters\": %d,\n\t\"bones\": %d,\n\t\"frames\": %d,\n",
+			m_NumChars, m_NumBones, m_NumFrames);
+	fprintf(fp, "\t\"pose_difference\": %g,\n", maxdiff);
+	fprintf(fp, "\t\"modes\": [\n");
+	for (int m = 0; m < BENCH_NumModes; ++m)
+	{
+		BenchStats	s;
+
+		BenchGetStats(m_Times[m], m_NumFrames, s);
+		if (m == 0)
+			base = s.Mean;
+		fprintf(fp, "\t\t{ \"threads\": %d, ", ModeThreads[m]);
+		BenchWriteStats(fp, "milliseconds", s);
+		fprintf(fp, ", \"speedup\": %.2f }%s\n", (s.Mean > 0) ? base / s.Mean : 0.0f, (m < BENCH_NumModes - 1) ? "," : "");
+	}
+	fprintf(fp, "\t]\n}\n");
+}
+
+int BlendBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: blendbench [-chars n] [-bones n] [-frames n] [-out file]\n");
+		return 1;
+	}
+	if (!OnInit())
+		return BenchError("blendbench", "cannot initialize");
+	m_Walk = MakeClip(1.0f, 0.4f, 0.0f);
+	m_Run = MakeClip(2.0f, 0.7f, 0.1f);
+	m_Lean = MakeClip(0.5f, 0.1f, 0.2f);
+	m_Wave = MakeClip(3.0f, 0.9f, 0.0f);
+	if (((AnimClip*) m_Walk == NULL) || ((AnimClip*) m_Run == NULL) ||
+		((AnimClip*) m_Lean == NULL) || ((AnimClip*) m_Wave == NULL))
+		return BenchError("blendbench", "cannot make clips");
+	for (int m = 0; m < BENCH_NumModes; ++m)
+		if (!RunMode(m))
+			return BenchError("blendbench", "cannot make crowd");
+	if ((fp = BenchOpenReport("blendbench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	BlendBench*	bench = new BlendBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
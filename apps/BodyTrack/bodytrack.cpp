@@ -1,5 +1,6 @@
 #include "vxmfc.h"
 #include "body/vxbodytrack.h"
+#include "body/vxreplaytrack.h"
 #include <fstream>
 
 //#define	USE_PHYSICS 1
@@ -26,6 +27,8 @@ using namespace Vixen;
  * The application has several other options:
  *	-kinect		use the Microsoft Kinect controller to move the body
  *	-scape		use the SCAPE generative body model instead of the test body
+ *	-replay <file>	play back a joint log instead of using a sensor
+ *	-record <file>	record the joint frames from the body tracker to a file
  *	if a filename is provided after the options, the application will load
  *	that model instead of the test body. This option will be useful when
  *	Maya export of skinned characters is a reality...
@@ -105,6 +108,8 @@ protected:
 	Core::String		m_SaveFile;			// name of file to save scene in
 	Core::String		m_SkelName;			// name of skeleton to use from scene
 	Core::String		m_BodyName;			// name of body model to use from scene
+	Core::String		m_ReplayFile;		// name of joint log to play back
+	Core::String		m_RecordFile;		// name of joint log to record
 };
 
 BodyTrackDemo::BodyTrackDemo() : MFC::Demo()
@@ -133,6 +138,8 @@ BodyTrackDemo::~BodyTrackDemo()
  * Checks for the following command line arguments:
  *	-kinect		use the Microsoft Kinect controller to move the body
  *	-scape		use the SCAPE generative body model instead of the test body
+ *	-replay		play back a joint log instead of using a sensor
+ *	-record		record the joint frames from the body tracker
  */
 bool BodyTrackDemo::ParseArgs(int argc, TCHAR** argv)
 {
@@ -172,6 +179,22 @@ bool BodyTrackDemo::ParseArgs(int argc, TCHAR** argv)
 				argv[i] = 0;
 			}
 		}
+		else if (STRCMP(p, "-replay") == 0)
+		{
+			if ((i + 1) < argc)
+			{
+				m_ReplayFile = argv[++i];
+				argv[i] = 0;
+			}
+		}
+		else if (STRCMP(p, "-record") == 0)
+		{
+			if ((i + 1) < argc)
+			{
+				m_RecordFile = argv[++i];
+				argv[i] = 0;
+			}
+		}
 	}
 	return MFC::Demo::ParseArgs(argc, argv);
 }
@@ -400,6 +423,17 @@ Skeleton* BodyTrackDemo::MakeTracker(Engine* parent)
 		VX_TRACE(Debug, ("Attaching Kinect body tracking engine"));
 	}
 #endif
+	if (m_Tracker.IsNull() && !m_ReplayFile.IsEmpty())
+	{
+		ReplayTracker* replay = new ReplayTracker(m_ReplayFile);
+
+		replay->SetLoop(true);
+		m_Tracker = replay;
+		m_Tracker->SetOptions(BodyTracker::TRACK_SKELETON);
+		m_Tracker->SetControl(Engine::CONTROL_CHILDREN);
+		mapper = m_Tracker->GetPoseMapper();
+		VX_TRACE(Debug, ("Attaching replay body tracking engine"));
+	}
 #ifdef USE_OMEK
 	if (UseOmek)
 	{
@@ -418,6 +452,8 @@ Skeleton* BodyTrackDemo::MakeTracker(Engine* parent)
 	{
 		skel = m_Tracker->GetSkeleton();
 		m_Tracker->PutBefore(m_Poser);
+		if (!m_RecordFile.IsEmpty())
+			m_Tracker->StartRecording(m_RecordFile);
 	}
 	else
 	{
@@ -0,0 +1,17 @@
+/*
+ * World bounds query benchmark.
+ *
+ * Moves models in a large hierarchy and measures asking every model
+ * for its world bounding sphere, see boundbench.h for the modes and options.
+ *
+ *	boundbench [-nodes n] [-branch n] [-moves n] [-frames n] [-out file]
+ */
+#include "boundbench.h"
+
+int main(int argc, char** argv)
+{
+	BoundBench*	bench = new BoundBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
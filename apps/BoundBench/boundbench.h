@@ -0,0 +1,359 @@
+/*!
+ * @file boundbench.h
+ * @brief Hierarchy benchmark which moves models and measures bounds queries.
+ *
+ * Builds a large hierarchy of models and, each frame, moves some of
+ * them and then asks every model for its bounding sphere in world
+ * coordinates, the way pickers and triggers do. The queries are done
+ * three ways:
+ *
+ *	walk	concatenate the local matrices up to the root for each query
+ *			(how Model::TotalTransform used to work)
+ *	lazy	Model::GetBound with cached world matrices, each invalid
+ *			matrix is recomputed when it is first asked for
+ *	batch	Model::UpdateWorld recomputes the invalid matrices once
+ *			at the start of the frame, then Model::GetBound
+ *
+ * Frame times and the number of matrices recomputed are written as JSON.
+ *
+ * Other benchmarks which move models in the same hierarchy, like
+ * refitbench, derive from BoundBench and override the virtual
+ * functions which build the models and do the work for each frame.
+ * The functions are defined here, this header is included by the one
+ * source file of each benchmark.
+ *
+ *	boundbench [options]
+ *		-nodes n		number of models in the hierarchy (default 50000)
+ *		-branch n		number of children of each model (default 8)
+ *		-moves n		number of models moved each frame (default 500, -1 for 1% of nodes)
+ *		-frames n		number of frames to run (default 100)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#pragma once
+
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_NumModes	3
+
+/*!
+ * @class BoundBench
+ * @brief Measures world bounding volume queries on a large hierarchy.
+ */
+class BoundBench : public World
+{
+public:
+	BoundBench(const char* name = "boundbench");
+	~BoundBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	virtual bool	ParseOptions(int argc, char** argv);
+	virtual Model*	MakeNode(int32 i);
+	virtual bool	MakeGraph();
+	virtual void	FreeGraph();
+	virtual void	MoveNode(int32 i, int mode);
+	virtual void	BeginMode(int mode);
+	virtual float	RunFrame(int mode);
+	virtual void	EndMode(int mode);
+	virtual float	GetError();
+	virtual const char*	GetCountName(int mode);
+
+	void		MoveModels(uint32& seed, int mode);
+	float		QueryWalk(Vec3& sum);
+	float		QueryCached(Vec3& sum);
+	bool		RunMode(int mode);
+	void		WriteReport(FILE* fp);
+	static void	WalkTransform(const Model* mod, Matrix* trans);
+
+	const char*		m_Name;			// program name for messages
+	const char**	m_ModeNames;	// name of each mode in the report
+	int32			m_NumNodes;
+	int32			m_Branch;
+	int32			m_NumMoves;
+	int32			m_NumFrames;
+	const char*		m_OutFile;
+	Ref<Model>		m_Root;
+	Model**			m_Nodes;
+	float*			m_Times[BENCH_NumModes];
+	int64			m_Counts[BENCH_NumModes];	// work counted in each mode
+	Vec3			m_Sum;						// sum of the centers queried in current mode
+	Vec3			m_Sums[BENCH_NumModes];
+};
+
+static const char* BoundModeNames[BENCH_NumModes] = { "walk", "lazy", "batch" };
+
+BoundBench::BoundBench(const char* name) : World()
+{
+	m_Name = name;
+	m_ModeNames = BoundModeNames;
+	m_NumNodes = 50000;
+	m_Branch = 8;
+	m_NumMoves = 500;
+	m_NumFrames = 100;
+	m_OutFile = NULL;
+	m_Nodes = NULL;
+	for (int i = 0; i < BENCH_NumModes; ++i)
+	{
+		m_Times[i] = NULL;
+		m_Counts[i] = 0;
+	}
+}
+
+BoundBench::~BoundBench()
+{
+	for (int i = 0; i < BENCH_NumModes; ++i)
+		if (m_Times[i])
+			free(m_Times[i]);
+	if (m_Nodes)
+		free(m_Nodes);
+}
+
+bool BoundBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+		if (!BenchOption(argc, argv, i, "-nodes", m_NumNodes) &&
+			!BenchOption(argc, argv, i, "-branch", m_Branch) &&
+			!BenchOption(argc, argv, i, "-moves", m_NumMoves) &&
+			!BenchOption(argc, argv, i, "-frames", m_NumFrames) &&
+			!BenchOption(argc, argv, i, "-out", m_OutFile))
+			return false;
+	if (m_NumMoves < 0)
+		m_NumMoves = m_NumNodes / 100;
+	if ((m_NumNodes <= 1) || (m_Branch <= 0) || (m_NumFrames <= 0))
+		return false;
+	return true;
+}
+
+/*
+ * Make model i of the hierarchy with a fixed bounding sphere.
+ */
+Model* BoundBench::MakeNode(int32 i)
+{
+	Sphere	bsp(Vec3(0, 0, 0), 1.0f);
+	Model*	mod = new Model;
+
+	mod->SetBound(&bsp);
+	return mod;
+}
+
+/*
+ * Make a hierarchy where the parent of model i is model (i - 1) / branch.
+ * Each model has a small offset and rotation from its parent.
+ */
+bool BoundBench::MakeGraph()
+{
+	m_Nodes = (Model**) calloc(m_NumNodes, sizeof(Model*));
+	if (m_Nodes == NULL)
+		return false;
+	for (int32 i = 0; i < m_NumNodes; ++i)
+	{
+		Model* mod = MakeNode(i);
+
+		if (i > 0)
+		{
+			mod->SetTranslation(Vec3(float(i % m_Branch), 1.0f, 0));
+			mod->Rotate(Model::YAXIS, 0.1f);
+			m_Nodes[(i - 1) / m_Branch]->Append(mod);
+		}
+		m_Nodes[i] = mod;
+	}
+	m_Root = m_Nodes[0];
+	return true;
+}
+
+void BoundBench::FreeGraph()
+{
+	m_Root = (Model*) NULL;
+	free(m_Nodes);
+	m_Nodes = NULL;
+}
+
+void BoundBench::MoveNode(int32 i, int mode)
+{
+	m_Nodes[i]->Move(0.01f, 0, 0);
+}
+
+/*
+ * Move randomly chosen models. The same models are moved in each mode.
+ */
+void BoundBench::MoveModels(uint32& seed, int mode)
+{
+	for (int32 i = 0; i < m_NumMoves; ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		MoveNode((seed >> 8) % m_NumNodes, mode);
+	}
+}
+
+/*
+ * Concatenate local matrices up to the root.
+ */
+void BoundBench::WalkTransform(const Model* mod, Matrix* trans)
+{
+	trans->Copy(mod->GetTransform());
+	while ((mod = (const Model*) mod->Parent()) != NULL)
+		trans->PreMul(*(mod->GetTransform()));
+}
+
+float BoundBench::QueryWalk(Vec3& sum)
+{
+	int64	start = Core::Profiler::GetTicks();
+	Matrix	total;
+	Sphere	bsp;
+
+	for (int32 i = 0; i < m_NumNodes; ++i)
+	{
+		const Model* mod = m_Nodes[i];
+
+		WalkTransform(mod, &total);
+		mod->GetBound(&bsp, Model::NONE);
+		bsp *= total;
+		sum += bsp.Center;
+	}
+	return BenchElapsed(start);
+}
+
+float BoundBench::QueryCached(Vec3& sum)
+{
+	int64	start = Core::Profiler::GetTicks();
+	Sphere	bsp;
+
+	for (int32 i = 0; i < m_NumNodes; ++i)
+	{
+		m_Nodes[i]->GetBound(&bsp, Model::WORLD);
+		sum += bsp.Center;
+	}
+	return BenchElapsed(start);
+}
+
+void BoundBench::BeginMode(int mode)
+{
+	m_Sum.Set(0, 0, 0);
+	Model::UpdateWorld(m_Root);
+}
+
+/*
+ * Do the work measured for one frame, return its time in milliseconds.
+ */
+float BoundBench::RunFrame(int mode)
+{
+	int64	start;
+	float	t = 0;
+
+	switch (mode)
+	{
+		case 0:
+		t = QueryWalk(m_Sum);
+		break;
+
+		case 1:
+		t = QueryCached(m_Sum);
+		break;
+
+		case 2:
+		start = Core::Profiler::GetTicks();
+		m_Counts[mode] += Model::UpdateWorld(m_Root);
+		t = BenchElapsed(start);
+		t += QueryCached(m_Sum);
+		break;
+	}
+	return t;
+}
+
+void BoundBench::EndMode(int mode)
+{
+	m_Sums[mode] = m_Sum;
+}
+
+/*
+ * Return the largest difference between the results of the
+ * first mode and the others, relative to the first.
+ */
+float BoundBench::GetError()
+{
+	float	maxdiff = 0;
+
+	for (int m = 1; m < BENCH_NumModes; ++m)
+	{
+		Vec3	d(m_Sums[m] - m_Sums[0]);
+		float	len = d.Length() / m_Sums[0].Length();
+
+		if (len > maxdiff)
+			maxdiff = len;
+	}
+	return maxdiff;
+}
+
+/*
+ * Return the name of the work counted in a mode, NULL if none.
+ */
+const char* BoundBench::GetCountName(int mode)
+{
+	return "matrices_per_frame";
+}
+
+/*
+ * Build a new hierarchy and run all the frames for one mode.
+ */
+bool BoundBench::RunMode(int mode)
+{
+	uint32	seed = 12345;
+
+	if (!MakeGraph())
+		return false;
+	m_Times[mode] = (float*) malloc(m_NumFrames * sizeof(float));
+	if (m_Times[mode] == NULL)
+		return false;
+	BeginMode(mode);
+	for (int32 f = 0; f < m_NumFrames; ++f)
+	{
+		MoveModels(seed, mode);
+		m_Times[mode][f] = RunFrame(mode);
+	}
+	EndMode(mode);
+	FreeGraph();
+	return true;
+}
+
+void BoundBench::WriteReport(FILE* fp)
+{
+	fprintf(fp, "{\n\t\"nodes\": %d,\n\t\"branch\": %d,\n\t\"moves\": %d,\n\t\"frames\": %d,\n",
+			m_NumNodes, m_Branch, m_NumMoves, m_NumFrames);
+	fprintf(fp, "\t\"relative_error\": %g,\n", GetError());
+	fprintf(fp, "\t\"modes\": [\n");
+	for (int m = 0; m < BENCH_NumModes; ++m)
+	{
+		const char*	count = GetCountName(m);
+
+		fprintf(fp, "\t\t{ \"mode\": \"%s\", ", m_ModeNames[m]);
+		if (count && (m_Counts[m] > 0))
+			fprintf(fp, "\"%s\": %.1f, ", count, float(m_Counts[m]) / m_NumFrames);
+		BenchWriteTimes(fp, "milliseconds", m_Times[m], m_NumFrames);
+		fprintf(fp, " }%s\n", (m < BENCH_NumModes - 1) ? "," : "");
+	}
+	fprintf(fp, "\t]\n}\n");
+}
+
+int BoundBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: %s [-nodes n] [-branch n] [-moves n] [-frames n] [-out file]\n", m_Name);
+		return 1;
+	}
+	if (!OnInit())
+		return BenchError(m_Name, "cannot initialize");
+	for (int m = 0; m < BENCH_NumModes; ++m)
+		if (!RunMode(m))
+			return BenchError(m_Name, "out of memory");
+	if ((fp = BenchOpenReport(m_Name, m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	return 0;
+}
@@ -0,0 +1,231 @@
+/*
+ * Scene file load time benchmark.
+ *
+ * Compares loading a Vixen content file (.vix) with loading the same
+ * content from a chunked scene file (.vxz) made by vixchunk.
+ * Each load is repeated and timed separately:
+ *
+ *	vix			FileMessenger::Load of the .vix file
+ *	vxz_1		ChunkMessenger::Load with one decompression thread
+ *	vxz_n		ChunkMessenger::Load with -threads decompression threads
+ *	subtree		ChunkMessenger::LoadSubtree of one named subtree
+ *
+ * Times in milliseconds and file sizes are written as JSON.
+ *
+ *	chunkbench [options] file.vix file.vxz
+ *		-threads n		number of decompression threads (default 4)
+ *		-repeat n		number of times to load each file (default 5)
+ *		-subtree name	subtree to load (default is the first one in the file)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_NumTests	4
+#define	BENCH_MaxRepeat	100
+
+static const char* TestNames[BENCH_NumTests] =
+{
+	"vix", "vxz_1", "vxz_n", "subtree"
+};
+
+/*!
+ * @class ChunkBench
+ * @brief Console world which times loading scene files.
+ */
+class ChunkBench : public World3D
+{
+public:
+	ChunkBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	bool		ParseOptions(int argc, char** argv);
+	float		LoadVix();
+	float		LoadChunks(int nthreads, bool subtree);
+	void		WriteReport(FILE* fp);
+	static long	GetFileSize(const char* filename);
+
+	int				m_NumThreads;
+	int				m_Repeat;
+	const char*		m_VixFile;
+	const char*		m_ChunkFile;
+	const char*		m_Subtree;
+	const char*		m_OutFile;
+	Core::String	m_SubtreeName;
+	int32			m_NumChunks;
+	int32			m_NumSubtrees;
+	int32			m_SubtreeChunks;
+	float			m_Times[BENCH_NumTests][BENCH_MaxRepeat];
+};
+
+ChunkBench::ChunkBench() : World3D()
+{
+	m_NumThreads = 4;
+	m_Repeat = 5;
+	m_VixFile = NULL;
+	m_ChunkFile = NULL;
+	m_Subtree = NULL;
+	m_OutFile = NULL;
+	m_NumChunks = 0;
+	m_NumSubtrees = 0;
+	m_SubtreeChunks = 0;
+	DoAsyncLoad = false;
+}
+
+bool ChunkBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (BenchOption(argc, argv, i, "-threads", m_NumThreads) ||
+			BenchOption(argc, argv, i, "-repeat", m_Repeat) ||
+			BenchOption(argc, argv, i, "-subtree", m_Subtree) ||
+			BenchOption(argc, argv, i, "-out", m_OutFile))
+			continue;
+		if (*argv[i] == '-')
+			return false;
+		if (m_VixFile == NULL)
+			m_VixFile = argv[i];
+		else
+			m_ChunkFile = argv[i];
+	}
+	if ((m_VixFile == NULL) || (m_ChunkFile == NULL) ||
+		(m_Repeat <= 0) || (m_Repeat > BENCH_MaxRepeat) ||
+		(m_NumThreads <= 0) || (m_NumThreads > CHUNK_MaxThreads))
+		return false;
+	return true;
+}
+
+/*
+ * Load the whole .vix file, return the time in milliseconds.
+ * The objects loaded are freed when the messenger is closed.
+ */
+float ChunkBench::LoadVix()
+{
+	Core::String		filename(m_VixFile);
+	Core::FileStream*	instream = new Core::FileStream;
+	Ref<FileMessenger>	file = new FileMessenger;
+	int64				start = Core::Profiler::GetTicks();
+
+	if (!instream->Open(filename, Core::Stream::OPEN_READ))
+	{
+		delete instream;
+		VX_ERROR(("chunkbench: cannot open %s\n", m_VixFile), -1.0f);
+	}
+	file->SetInStream(instream);
+	if (!file->Load())
+		VX_ERROR(("chunkbench: cannot load %s\n", m_VixFile), -1.0f);
+	float t = BenchElapsed(start);
+	file->Close();
+	return t;
+}
+
+/*
+ * Load the whole .vxz file or just one subtree using the given
+ * number of threads, return the time in milliseconds.
+ */
+float ChunkBench::LoadChunks(int nthreads, bool subtree)
+{
+	Core::String		filename(m_ChunkFile);
+	Ref<ChunkMessenger>	file = new ChunkMessenger;
+	int64				start = Core::Profiler::GetTicks();
+
+	ChunkMessenger::NumThreads = nthreads;
+	if (!file->Open(filename, Core::Stream::OPEN_READ))
+		VX_ERROR(("chunkbench: %s is not a chunked scene file\n", m_ChunkFile), -1.0f);
+	if (subtree)
+	{
+		if (m_SubtreeName.IsEmpty())
+		{
+			if (m_Subtree)
+				m_SubtreeName = Core::String(m_Subtree);
+			else if (file->GetNumSubtrees() > 0)
+				m_SubtreeName = file->GetSubtreeName(0);
+		}
+		if (file->LoadSubtree(m_SubtreeName) == NULL)
+			VX_ERROR(("chunkbench: cannot load subtree %s\n", (const char*) m_SubtreeName), -1.0f);
+		m_SubtreeChunks = file->GetNumLoaded();
+	}
+	else if (!file->Load())
+		VX_ERROR(("chunkbench: cannot load %s\n", m_ChunkFile), -1.0f);
+	float t = BenchElapsed(start);
+	m_NumChunks = file->GetNumChunks();
+	m_NumSubtrees = file->GetNumSubtrees();
+	file->Close();
+	return t;
+}
+
+long ChunkBench::GetFileSize(const char* filename)
+{
+	FILE*	fp = fopen(filename, "rb");
+	long	size;
+
+	if (fp == NULL)
+		return 0;
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fclose(fp);
+	return size;
+}
+
+void ChunkBench::WriteReport(FILE* fp)
+{
+	fprintf(fp, "{\n\t\"vix_file\": ");
+	BenchWriteString(fp, m_VixFile);
+	fprintf(fp, ",\n\t\"vxz_file\": ");
+	BenchWriteString(fp, m_ChunkFile);
+	fprintf(fp, ",\n");
+	fprintf(fp, "\t\"vix_bytes\": %ld,\n\t\"vxz_bytes\": %ld,\n", GetFileSize(m_VixFile), GetFileSize(m_ChunkFile));
+	fprintf(fp, "\t\"chunks\": %d,\n\t\"subtrees\": %d,\n", m_NumChunks, m_NumSubtrees);
+	fprintf(fp, "\t\"subtree\": ");
+	BenchWriteString(fp, (const char*) m_SubtreeName);
+	fprintf(fp, ",\n\t\"subtree_chunks\": %d,\n", m_SubtreeChunks);
+	fprintf(fp, "\t\"threads\": %d,\n\t\"repeat\": %d,\n", m_NumThreads, m_Repeat);
+	fprintf(fp, "\t\"milliseconds\": {\n");
+	for (int i = 0; i < BENCH_NumTests; ++i)
+	{
+		fprintf(fp, "\t\t");
+		BenchWriteTimes(fp, TestNames[i], m_Times[i], m_Repeat);
+		fprintf(fp, "%s\n", (i < BENCH_NumTests - 1) ? "," : "");
+	}
+	fprintf(fp, "\t}\n}\n");
+}
+
+int ChunkBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: chunkbench [-threads n] [-repeat n] [-subtree name] [-out file] file.vix file.vxz\n");
+		return 1;
+	}
+	if (!OnInit())
+		return BenchError("chunkbench", "cannot initialize");
+	for (int r = 0; r < m_Repeat; ++r)
+	{
+		m_Times[0][r] = LoadVix();
+		m_Times[1][r] = LoadChunks(1, false);
+		m_Times[2][r] = LoadChunks(m_NumThreads, false);
+		m_Times[3][r] = LoadChunks(m_NumThreads, true);
+		for (int i = 0; i < BENCH_NumTests; ++i)
+			if (m_Times[i][r] < 0)
+				return 1;
+	}
+	if ((fp = BenchOpenReport("chunkbench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	OnExit();
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	ChunkBench*	bench = new ChunkBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
@@ -0,0 +1,300 @@
+/*
+ * Animation clip compression benchmark.
+ *
+ * Makes a motion capture style animation for a skeleton sampled at
+ * 120 frames per second, compresses it into an AnimClip and writes it
+ * to a clip file (.vxa). The clip file is then opened again and played
+ * from the file, only the window of keys around the current time is
+ * read and decompressed. Three things are measured:
+ *
+ *	size		bytes of raw float keys, compressed keys and the clip file
+ *	error		largest position and rotation error after compression and
+ *				the largest difference between the streamed and in-memory clip
+ *	time		compression time, time to open the clip file and the time
+ *				to evaluate all the channels each frame while playing forward
+ *				and while jumping to random times
+ *
+ * Results are written as JSON.
+ *
+ *	clipbench [options]
+ *		-bones n		number of bones in the skeleton (default 30)
+ *		-seconds n		length of the animation (default 600)
+ *		-postol f		position error tolerance (default AnimClip::PosTolerance)
+ *		-rottol f		rotation error tolerance in radians (default AnimClip::RotTolerance)
+ *		-window n		frames in a window (default AnimClip::WindowSize)
+ *		-clip file		clip file to write (default clipbench.vxa)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_FrameRate		120.0f
+#define	BENCH_PlayRate		60.0f
+#define	BENCH_NumSeeks		10000
+
+/*!
+ * @class ClipBench
+ * @brief Measures compression and streamed playback of animation clips.
+ */
+class ClipBench : public World
+{
+public:
+	ClipBench();
+	~ClipBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	bool		ParseOptions(int argc, char** argv);
+	bool		MakeSamples();
+	bool		Compress();
+	bool		Play();
+	void		WriteReport(FILE* fp);
+
+	int32			m_NumBones;
+	float			m_Seconds;
+	const char*		m_ClipFile;
+	const char*		m_OutFile;
+	int32			m_NumFrames;
+	int32			m_FrameSize;
+	float*			m_Samples;
+	Ref<AnimClip>	m_Clip;
+	Ref<AnimClip>	m_Streamed;
+	int32			m_FileSize;
+	float			m_StreamDiff;
+	double			m_CompressTime;
+	double			m_OpenTime;
+	double			m_PlayTime;
+	double			m_SeekTime;
+	int32			m_PlayFrames;
+};
+
+ClipBench::ClipBench() : World()
+{
+	m_NumBones = 30;
+	m_Seconds = 600.0f;
+	m_ClipFile = "clipbench.vxa";
+	m_OutFile = NULL;
+	m_NumFrames = 0;
+	m_FrameSize = 0;
+	m_Samples = NULL;
+	m_FileSize = 0;
+	m_StreamDiff = 0;
+	m_CompressTime = 0;
+	m_OpenTime = 0;
+	m_PlayTime = 0;
+	m_SeekTime = 0;
+	m_PlayFrames = 0;
+}
+
+ClipBench::~ClipBench()
+{
+	if (m_Samples)
+		free(m_Samples);
+}
+
+bool ClipBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+		if (!BenchOption(argc, argv, i, "-bones", m_NumBones) &&
+			!BenchOption(argc, argv, i, "-seconds", m_Seconds) &&
+			!BenchOption(argc, argv, i, "-postol", AnimClip::PosTolerance) &&
+			!BenchOption(argc, argv, i, "-rottol", AnimClip::RotTolerance) &&
+			!BenchOption(argc, argv, i, "-window", AnimClip::WindowSize) &&
+			!BenchOption(argc, argv, i, "-clip", m_ClipFile) &&
+			!BenchOption(argc, argv, i, "-out", m_OutFile))
+			return false;
+	if ((m_NumBones <= 0) || (m_Seconds <= 0) ||
+		(AnimClip::WindowSize <= 0) || (AnimClip::WindowSize > CLIP_MaxWindow))
+		return false;
+	return true;
+}
+
+/*
+ * Make the bones of a chain and samples for a root position channel
+ * and a rotation channel for each bone. Each bone swings about its own
+ * axis at its own rate with a little noise, like motion capture data.
+ * Some bones do not move at all.
+ */
+bool ClipBench::MakeSamples()
+{
+	uint32	seed = 12345;
+
+	m_Clip = new AnimClip;
+	for (int32 b = 0; b < m_NumBones; ++b)
+	{
+		char	name[32];
+
+		sprintf(name, "bone%d", b);
+		if (m_Clip->AddBone(Core::String(name), b - 1, Vec3(0, (b > 0) ? 10.0f : 0.0f, 0), Quat(0, 0, 0, 1)) < 0)
+			return false;
+	}
+	m_Clip->AddChannel(0, Evaluator::POSITION);
+	for (int32 b = 0; b < m_NumBones; ++b)
+		m_Clip->AddChannel(b, Evaluator::ROTATION);
+	m_FrameSize = 3 + 4 * m_NumBones;
+	m_NumFrames = int32(m_Seconds * BENCH_FrameRate) + 1;
+	m_Samples = (float*) malloc(m_NumFrames * m_FrameSize * sizeof(float));
+	if (m_Samples == NULL)
+		return false;
+	for (int32 f = 0; f < m_NumFrames; ++f)
+	{
+		float	t = f / BENCH_FrameRate;
+		float*	s = m_Samples + f * m_FrameSize;
+
+		*s++ = 100.0f * sinf(0.2f * t);
+		*s++ = 90.0f + 5.0f * sinf(3.0f * t);
+		*s++ = 150.0f * t;
+		for (int32 b = 0; b < m_NumBones; ++b)
+		{
+			Vec3	axis(sinf(float(b)), cosf(float(b)), 0.5f);
+			float	a = 0.6f * sinf(t * (1.0f + 0.3f * b));
+			Quat	q;
+
+			seed = seed * 1664525 + 1013904223;
+			a += 0.002f * float((seed >> 8) & 0xFF) / 255.0f;
+			if (b % 7 == 6)
+				a = 0;
+			axis.Normalize();
+			q.Set(axis, a);
+			*s++ = q.x;
+			*s++ = q.y;
+			*s++ = q.z;
+			*s++ = q.w;
+		}
+	}
+	return true;
+}
+
+/*
+ * Compress the samples, write the clip file and open it again for streaming.
+ */
+bool ClipBench::Compress()
+{
+	Core::String		filename(m_ClipFile);
+	Core::FileStream*	outstream = new Core::FileStream;
+	Core::FileStream*	instream = new Core::FileStream;
+	Ref<Core::Stream>	out(outstream);
+	Ref<Core::Stream>	in(instream);
+	int64				start = Core::Profiler::GetTicks();
+
+	if (!m_Clip->Compress(m_Samples, m_NumFrames, 1.0f / BENCH_FrameRate))
+		return false;
+	m_CompressTime = BenchElapsed(start);
+	if (!outstream->Open(filename, Core::Stream::OPEN_WRITE))
+		VX_ERROR(("clipbench: cannot write %s\n", m_ClipFile), false);
+	if (!m_Clip->Write(outstream))
+		VX_ERROR(("clipbench: cannot write %s\n", m_ClipFile), false);
+	outstream->Close();
+	start = Core::Profiler::GetTicks();
+	if (!instream->Open(filename, Core::Stream::OPEN_READ | Core::Stream::OPEN_SEEK))
+		VX_ERROR(("clipbench: cannot open %s\n", m_ClipFile), false);
+	m_Streamed = new AnimClip;
+	if (!m_Streamed->Open(instream))
+		VX_ERROR(("clipbench: %s is not a clip file\n", m_ClipFile), false);
+	m_OpenTime = BenchElapsed(start);
+	if (FILE* fp = fopen(m_ClipFile, "rb"))
+	{
+		fseek(fp, 0, SEEK_END);
+		m_FileSize = (int32) ftell(fp);
+		fclose(fp);
+	}
+	return true;
+}
+
+/*
+ * Play the streamed clip forward at the play rate, then evaluate it
+ * at random times. Both are compared with the in-memory clip.
+ */
+bool ClipBench::Play()
+{
+	int32	nchans = m_Clip->GetNumChannels();
+	float	dur = m_Clip->GetDuration();
+	float	v1[4], v2[4];
+	uint32	seed = 4567;
+	int64	start;
+
+	m_PlayFrames = int32(dur * BENCH_PlayRate) + 1;
+	for (int32 f = 0; f < m_PlayFrames; ++f)
+	{
+		float t = f / BENCH_PlayRate;
+
+		start = Core::Profiler::GetTicks();
+		for (int32 c = 0; c < nchans; ++c)
+			if (!m_Streamed->Eval(c, t, v2))
+				VX_ERROR(("clipbench: cannot evaluate channel %d at %f\n", c, t), false);
+		m_PlayTime += BenchElapsed(start);
+		for (int32 c = 0; c < nchans; ++c)
+		{
+			int32 n = (m_Clip->GetChannelType(c) == Evaluator::ROTATION) ? 4 : 3;
+
+			m_Streamed->Eval(c, t, v2);
+			m_Clip->Eval(c, t, v1);
+			for (int32 i = 0; i < n; ++i)
+				if (fabsf(v1[i] - v2[i]) > m_StreamDiff)
+					m_StreamDiff = fabsf(v1[i] - v2[i]);
+		}
+	}
+	start = Core::Profiler::GetTicks();
+	for (int32 k = 0; k < BENCH_NumSeeks; ++k)
+	{
+		float t;
+
+		seed = seed * 1664525 + 1013904223;
+		t = dur * float(seed >> 8) / float(1 << 24);
+		for (int32 c = 0; c < nchans; ++c)
+			if (!m_Streamed->Eval(c, t, v2))
+				VX_ERROR(("clipbench: cannot evaluate channel %d at %f\n", c, t), false);
+	}
+	m_SeekTime = BenchElapsed(start);
+	return true;
+}
+
+void ClipBench::WriteReport(FILE* fp)
+{
+	int32	rawsize = m_NumFrames * m_FrameSize * sizeof(float);
+	int32	datasize = m_Clip->GetDataSize();
+
+	fprintf(fp, "{\n\t\"bones\": %d,\n\t\"channels\": %d,\n\t\"frames\": %d,\n",
+			m_NumBones, m_Clip->GetNumChannels(), m_NumFrames);
+	fprintf(fp, "\t\"window\": %d,\n\t\"windows\": %d,\n", AnimClip::WindowSize, m_Clip->GetNumWindows());
+	fprintf(fp, "\t\"keys\": %d,\n\t\"samples\": %d,\n",
+			m_Clip->GetNumKeys(), m_NumFrames * m_Clip->GetNumChannels());
+	fprintf(fp, "\t\"bytes\": { \"raw\": %d, \"compressed\": %d, \"file\": %d, \"ratio\": %.2f },\n",
+			rawsize, datasize, m_FileSize, (m_FileSize > 0) ? float(rawsize) / m_FileSize : 0.0f);
+	fprintf(fp, "\t\"error\": { \"pos_tolerance\": %g, \"pos\": %g, \"rot_tolerance\": %g, \"rot\": %g, \"stream_diff\": %g },\n",
+			AnimClip::PosTolerance, m_Clip->GetPosError(), AnimClip::RotTolerance, m_Clip->GetRotError(), m_StreamDiff);
+	fprintf(fp, "\t\"milliseconds\": { \"compress\": %.3f, \"open\": %.3f, \"play_per_frame\": %.4f, \"seek_per_eval\": %.4f }\n}\n",
+			m_CompressTime, m_OpenTime, m_PlayTime / m_PlayFrames, m_SeekTime / BENCH_NumSeeks);
+}
+
+int ClipBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: clipbench [-bones n] [-seconds n] [-postol f] [-rottol f] [-window n] [-clip file] [-out file]\n");
+		return 1;
+	}
+	if (!OnInit())
+		return BenchError("clipbench", "cannot initialize");
+	if (!MakeSamples())
+		return BenchError("clipbench", "out of memory");
+	if (!Compress() || !Play())
+		return 1;
+	if ((fp = BenchOpenReport("clipbench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	ClipBench*	bench = new ClipBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
@@ -0,0 +1,363 @@
+/*
+ * Scene graph read contention benchmark.
+ *
+ * Builds a two level hierarchy of models and traverses it from several
+ * reader threads while a loader thread continually removes models and
+ * appends new ones, the way a streaming loader edits the scene graph
+ * while it is being displayed. The test is run twice:
+ *
+ *	lock	readers lock each model they visit and hold the parent
+ *			lock while visiting the children, writers lock the group they edit
+ *	epoch	readers traverse inside a Core::Epoch read section without locking,
+ *			removed models are freed when no reader can still see them
+ *
+ * Traversal times, traversal and edit throughput are written as JSON.
+ *
+ *	epochbench [options]
+ *		-readers n		number of traversal threads (default 4)
+ *		-groups n		number of groups under the root (default 64)
+ *		-models n		number of models in each group (default 64)
+ *		-seconds s		how long to run each test (default 2)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_MaxReaders	16
+#define	BENCH_MaxSamples	200000
+
+class EpochBench;
+
+/*
+ * Thread which traverses the hierarchy or edits it.
+ */
+class BenchThread : public Core::Thread
+{
+public:
+	BenchThread() : Core::Thread(0), Bench(NULL), Count(0), NumSamples(0), Times(NULL) { }
+	~BenchThread()	{ if (Times) free(Times); }
+
+	static Core::ThreadFunc	ReadFunc;
+	static Core::ThreadFunc	LoadFunc;
+
+	EpochBench*	Bench;			// benchmark which owns the thread
+	int64		Count;			// traversals or edits done
+	int32		NumSamples;		// number of traversal times recorded
+	float*		Times;			// milliseconds for each traversal
+};
+
+/*!
+ * @class EpochBench
+ * @brief Measures scene graph traversal while another thread edits it.
+ */
+class EpochBench : public World
+{
+public:
+	EpochBench();
+
+	int			Main(int argc, char** argv);
+	const Model* GetRoot() const	{ return m_Root; }
+	int64		Traverse(const Model* mod, Vec3& sum);
+	void		Edit(uint32& seed);
+
+	vint32		DoExit;			// set to make threads exit
+
+protected:
+	/*
+	 * Results for one test
+	 */
+	struct Run
+	{
+		const char*	Mode;		// "lock" or "epoch"
+		int64		Traversals;	// total traversals by all readers
+		int64		Edits;		// total models replaced by the loader
+		int32		MaxRetired;	// most objects waiting to be freed
+		int32		NumTimes;	// number of traversal times
+		float*		Times;		// milliseconds for each traversal
+	};
+
+	bool		ParseOptions(int argc, char** argv);
+	Model*		MakeGraph();
+	bool		RunTest(Run& run, bool epoch);
+	void		WriteReport(FILE* fp);
+	static void	Sleep(int ms);
+
+	int				m_NumReaders;
+	int				m_NumGroups;
+	int				m_NumModels;
+	float			m_Seconds;
+	const char*		m_OutFile;
+	Ref<Model>		m_Root;
+	Model**			m_Groups;
+	Run				m_Runs[2];
+};
+
+#if defined(_WIN32) && !defined(VX_PTHREAD)
+void BenchThread::ReadFunc(void* arg)
+#else
+void* BenchThread::ReadFunc(void* arg)
+#endif
+{
+	BenchThread&	thread = *((BenchThread*) arg);
+	EpochBench*		bench = thread.Bench;
+
+	while (!bench->DoExit)
+	{
+		int64	start = Core::Profiler::GetTicks();
+		Vec3	sum(0, 0, 0);
+
+		{
+			Core::EpochReader	reader;		// does nothing unless epoch mode is on
+			bench->Traverse(bench->GetRoot(), sum);
+		}
+		if (thread.NumSamples < BENCH_MaxSamples)
+			thread.Times[thread.NumSamples++] = BenchElapsed(start);
+		++thread.Count;
+	}
+	thread.Stop();
+#if !defined(_WIN32) || defined(VX_PTHREAD)
+	return NULL;
+#endif
+}
+
+#if defined(_WIN32) && !defined(VX_PTHREAD)
+void BenchThread::LoadFunc(void* arg)
+#else
+void* BenchThread::LoadFunc(void* arg)
+#endif
+{
+	BenchThread&	thread = *((BenchThread*) arg);
+	EpochBench*		bench = thread.Bench;
+	uint32			seed = 12345;
+
+	while (!bench->DoExit)
+	{
+		bench->Edit(seed);
+		if ((++thread.Count & 15) == 0)
+			Core::Epoch::Collect();			// free models readers have left
+	}
+	thread.Stop();
+#if !defined(_WIN32) || defined(VX_PTHREAD)
+	return NULL;
+#endif
+}
+
+EpochBench::EpochBench() : World()
+{
+	DoExit = 0;
+	m_NumReaders = 4;
+	m_NumGroups = 64;
+	m_NumModels = 64;
+	m_Seconds = 2.0f;
+	m_OutFile = NULL;
+	m_Groups = NULL;
+	memset(m_Runs, 0, sizeof(m_Runs));
+}
+
+bool EpochBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+		if (!BenchOption(argc, argv, i, "-readers", m_NumReaders) &&
+			!BenchOption(argc, argv, i, "-groups", m_NumGroups) &&
+			!BenchOption(argc, argv, i, "-models", m_NumModels) &&
+			!BenchOption(argc, argv, i, "-seconds", m_Seconds) &&
+			!BenchOption(argc, argv, i, "-out", m_OutFile))
+			return false;
+	if ((m_NumReaders <= 0) || (m_NumReaders > BENCH_MaxReaders) ||
+		(m_NumGroups <= 0) || (m_NumModels <= 0) || (m_Seconds <= 0))
+		return false;
+	return true;
+}
+
+void EpochBench::Sleep(int ms)
+{
+#ifdef _WIN32
+	::Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
+/*
+ * Make a root with m_NumGroups groups, each with m_NumModels models.
+ */
+Model* EpochBench::MakeGraph()
+{
+	Model*	root = new Model;
+
+	root->MakeLock();
+	m_Groups = (Model**) calloc(m_NumGroups, sizeof(Model*));
+	for (int g = 0; g < m_NumGroups; ++g)
+	{
+		Model* group = new Model;
+
+		group->MakeLock();
+		group->SetTranslation(Vec3(float(g), 0, 0));
+		for (int m = 0; m < m_NumModels; ++m)
+		{
+			Model* mod = new Model;
+
+			mod->MakeLock();
+			mod->SetTranslation(Vec3(0, float(m), 0));
+			group->Append(mod);
+		}
+		root->Append(group);
+		m_Groups[g] = group;
+	}
+	return root;
+}
+
+/*
+ * Visit a model and its children, summing their translations.
+ * Without epoch mode, each model is locked while its transform is read
+ * and its children are visited so the loader cannot free a child
+ * the reader is looking at.
+ */
+int64 EpochBench::Traverse(const Model* mod, Vec3& sum)
+{
+	bool			locked = !Core::Epoch::IsReading() && mod->Lock();
+	const Matrix*	mtx = mod->GetTransform();
+	int64			n = 1;
+	Vec3			p;
+
+	if (mtx)
+	{
+		mtx->GetTranslation(p);
+		sum += p;
+	}
+	for (const Model* child = mod->First(); child; child = child->Next())
+		n += Traverse(child, sum);
+	if (locked)
+		mod->Unlock();
+	return n;
+}
+
+/*
+ * Replace the first model in a random group with a new one at the end.
+ */
+void EpochBench::Edit(uint32& seed)
+{
+	Model*	group;
+	Model*	mod;
+
+	seed = seed * 1664525 + 1013904223;
+	group = m_Groups[(seed >> 8) % m_NumGroups];
+	mod = new Model;
+	mod->MakeLock();
+	mod->SetTranslation(Vec3(0, float(seed & 0xFF), 0));
+	group->Lock();
+	if (group->First())
+		group->First()->Remove(true);		// freed or retired
+	group->Append(mod);
+	group->Unlock();
+}
+
+bool EpochBench::RunTest(Run& run, bool epoch)
+{
+	BenchThread	readers[BENCH_MaxReaders];
+	BenchThread	loader;
+	double		start;
+
+	Core::Epoch::SetEnabled(epoch);
+	m_Root = MakeGraph();
+	DoExit = 0;
+	run.Mode = epoch ? "epoch" : "lock";
+	for (int i = 0; i < m_NumReaders; ++i)
+	{
+		readers[i].Bench = this;
+		readers[i].Times = (float*) malloc(BENCH_MaxSamples * sizeof(float));
+		if (readers[i].Times == NULL)
+			return false;
+		readers[i].Run(&BenchThread::ReadFunc);
+	}
+	loader.Bench = this;
+	loader.Run(&BenchThread::LoadFunc);
+	start = Core::GetTime();
+	while (Core::GetTime() - start < m_Seconds)
+	{
+		int32 n = Core::Epoch::GetNumRetired();
+
+		if (n > run.MaxRetired)
+			run.MaxRetired = n;
+		Sleep(1);
+	}
+	Core::InterlockSet(&DoExit, 1);
+	if (loader.IsRunning())
+		loader.GetDoneEvent()->Wait();
+	for (int i = 0; i < m_NumReaders; ++i)
+		if (readers[i].IsRunning())
+			readers[i].GetDoneEvent()->Wait();
+	run.Edits = loader.Count;
+	for (int i = 0; i < m_NumReaders; ++i)
+	{
+		run.Traversals += readers[i].Count;
+		run.NumTimes += readers[i].NumSamples;
+	}
+	run.Times = (float*) malloc((run.NumTimes + 1) * sizeof(float));
+	if (run.Times == NULL)
+		return false;
+	run.NumTimes = 0;
+	for (int i = 0; i < m_NumReaders; ++i)
+	{
+		memcpy(run.Times + run.NumTimes, readers[i].Times, readers[i].NumSamples * sizeof(float));
+		run.NumTimes += readers[i].NumSamples;
+	}
+	m_Root = (Model*) NULL;
+	free(m_Groups);
+	m_Groups = NULL;
+	Core::Epoch::SetEnabled(false);		// free everything retired
+	return true;
+}
+
+void EpochBench::WriteReport(FILE* fp)
+{
+	fprintf(fp, "{\n\t\"readers\": %d,\n\t\"groups\": %d,\n\t\"models\": %d,\n\t\"seconds\": %.2f,\n",
+			m_NumReaders, m_NumGroups, m_NumModels, m_Seconds);
+	fprintf(fp, "\t\"runs\": [\n");
+	for (int r = 0; r < 2; ++r)
+	{
+		Run&	run = m_Runs[r];
+
+		fprintf(fp, "\t\t{ \"mode\": \"%s\", \"traversals_per_sec\": %.1f, \"edits_per_sec\": %.1f, \"max_retired\": %d",
+				run.Mode, run.Traversals / m_Seconds, run.Edits / m_Seconds, run.MaxRetired);
+		if (run.NumTimes > 0)
+		{
+			fprintf(fp, ", ");
+			BenchWriteTimes(fp, "milliseconds", run.Times, run.NumTimes);
+		}
+		fprintf(fp, " }%s\n", (r < 1) ? "," : "");
+	}
+	fprintf(fp, "\t]\n}\n");
+}
+
+int EpochBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: epochbench [-readers n] [-groups n] [-models n] [-seconds s] [-out file]\n");
+		return 1;
+	}
+	if (!OnInit())
+		return BenchError("epochbench", "cannot initialize");
+	if (!RunTest(m_Runs[0], false) || !RunTest(m_Runs[1], true))
+		return BenchError("epochbench", "out of memory");
+	if ((fp = BenchOpenReport("epochbench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	for (int r = 0; r < 2; ++r)
+		if (m_Runs[r].Times)
+			free(m_Runs[r].Times);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	EpochBench*	bench = new EpochBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
@@ -0,0 +1,367 @@
+/*
+ * Matrix math benchmark.
+ *
+ * Times the common matrix operations done through the Matrix object
+ * against the same operations done on Mat4 values, and transforming
+ * an interleaved vertex array one vertex at a time against the Mat4
+ * batch kernels. Each test is run several times and the fastest run
+ * is reported. The results of both versions are compared so the
+ * report also shows the largest difference between them.
+ *
+ * Times and speedups are written as JSON.
+ *
+ *	mathbench [options]
+ *		-count n		number of operations per run (default 100000)
+ *		-runs n			number of runs of each test (default 10)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_VtxSize		8		// location, normal and texcoord
+#define	BENCH_NormalOfs		3
+#define	BENCH_NumTests		6
+
+static const char* TestNames[BENCH_NumTests] =
+{
+	"multiply", "invert", "quaternion", "transform_chain", "transform_points", "transform_normals"
+};
+
+/*!
+ * @class MathBench
+ * @brief Compares Matrix operations with the Mat4 kernels.
+ */
+class MathBench : public World
+{
+public:
+	MathBench();
+	~MathBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	bool		ParseOptions(int argc, char** argv);
+	void		MakeInputs();
+	double		RunMatrix(int test);
+	double		RunMat4(int test);
+	void		WriteReport(FILE* fp);
+	static float	Diff(const float* a, const float* b, intptr n);
+
+	int32		m_Count;
+	int32		m_Runs;
+	const char*	m_OutFile;
+	Mat4*		m_Mats;						// random affine matrices
+	Quat*		m_Quats;					// random rotations
+	float*		m_Verts;					// source vertices
+	float*		m_Out1;						// vertices transformed by Matrix
+	float*		m_Out2;						// vertices transformed by Mat4
+	Mat4		m_Result1;					// last matrix computed with Matrix
+	Mat4		m_Result2;					// last matrix computed with Mat4
+	double		m_Times[BENCH_NumTests][2];	// fastest run of each test
+	float		m_Diffs[BENCH_NumTests];	// largest difference in results
+};
+
+MathBench::MathBench() : World()
+{
+	m_Count = 100000;
+	m_Runs = 10;
+	m_OutFile = NULL;
+	m_Mats = NULL;
+	m_Quats = NULL;
+	m_Verts = NULL;
+	m_Out1 = NULL;
+	m_Out2 = NULL;
+	memset(m_Times, 0, sizeof(m_Times));
+	memset(m_Diffs, 0, sizeof(m_Diffs));
+}
+
+MathBench::~MathBench()
+{
+	if (m_Mats)
+		free(m_Mats);
+	if (m_Quats)
+		free(m_Quats);
+	if (m_Verts)
+		free(m_Verts);
+	if (m_Out1)
+		free(m_Out1);
+	if (m_Out2)
+		free(m_Out2);
+}
+
+bool MathBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+		if (!BenchOption(argc, argv, i, "-count", m_Count) &&
+			!BenchOption(argc, argv, i, "-runs", m_Runs) &&
+			!BenchOption(argc, argv, i, "-out", m_OutFile))
+			return false;
+	if ((m_Count <= 0) || (m_Runs <= 0))
+		return false;
+	return true;
+}
+
+float MathBench::Diff(const float* a, const float* b, intptr n)
+{
+	float	maxdiff = 0.0f;
+
+	for (intptr i = 0; i < n; ++i)
+	{
+		float d = fabs(a[i] - b[i]);
+
+		if (d > maxdiff)
+			maxdiff = d;
+	}
+	return maxdiff;
+}
+
+/*
+ * Make random rotations, affine matrices built from them
+ * and a vertex array with unit normals.
+ */
+void MathBench::MakeInputs()
+{
+	uint32	seed = 12345;
+
+	for (int32 i = 0; i < m_Count; ++i)
+	{
+		Vec3	axis, pos;
+		Mat4	m;
+
+		seed = seed * 1664525 + 1013904223;
+		axis.Set(float(seed & 0xFF) + 1.0f, float((seed >> 8) & 0xFF), float((seed >> 16) & 0xFF));
+		axis.Normalize();
+		pos.Set(float(seed & 0x3F), float((seed >> 6) & 0x3F), float((seed >> 12) & 0x3F));
+		m_Quats[i].Set(axis, float((seed >> 20) & 0xFF) / 40.0f);
+		m.Set(m_Quats[i]);
+		m.PreScale(Vec3(1.0f + (seed & 3), 2.0f, 1.5f));
+		m.PreTranslate(pos);
+		m_Mats[i] = m;
+
+		float*	v = m_Verts + i * BENCH_VtxSize;
+		v[0] = pos.x;
+		v[1] = pos.y;
+		v[2] = pos.z;
+		v[3] = axis.x;
+		v[4] = axis.y;
+		v[5] = axis.z;
+		v[6] = 0.0f;
+		v[7] = 1.0f;
+	}
+}
+
+/*
+ * Run a test using the Matrix object, return the elapsed milliseconds.
+ */
+double MathBench::RunMatrix(int test)
+{
+	Ref<Matrix>	a = new Matrix;
+	Ref<Matrix>	c = new Matrix;
+	int64		start;
+	double		ms;
+
+	memcpy(m_Out1, m_Verts, m_Count * BENCH_VtxSize * sizeof(float));
+	start = Core::Profiler::GetTicks();
+	switch (test)
+	{
+		case 0:
+		c->Identity();
+		for (int32 i = 0; i < m_Count; ++i)
+		{
+			a->SetMatrix(m_Mats[i].GetData());
+			c->PostMul(*a);
+			if ((i & 15) == 15)
+				c->Identity();
+		}
+		break;
+
+		case 1:
+		for (int32 i = 0; i < m_Count; ++i)
+		{
+			a->SetMatrix(m_Mats[i].GetData());
+			a->Set(3, 0, 0.01f);				// force the full inverse
+			c->Invert(*a);
+		}
+		break;
+
+		case 2:
+		for (int32 i = 0; i < m_Count; ++i)
+			c->RotationMatrix(m_Quats[i]);
+		break;
+
+		case 3:
+		for (int32 i = 0; i < m_Count; ++i)
+		{
+			const float* v = m_Verts + i * BENCH_VtxSize;
+
+			c->Identity();
+			c->Translate(v[0], v[1], v[2]);
+			c->Rotate(m_Quats[i]);
+			c->Scale(2.0f, 2.0f, 2.0f);
+		}
+		break;
+
+		case 4:
+		a->SetMatrix(m_Mats[0].GetData());
+		for (int32 i = 0; i < m_Count; ++i)
+		{
+			Vec3* p = (Vec3*) (m_Out1 + i * BENCH_VtxSize);
+
+			*p *= *a;
+		}
+		break;
+
+		case 5:
+		a->SetMatrix(m_Mats[0].GetData());
+		for (int32 i = 0; i < m_Count; ++i)
+		{
+			Vec3* n = (Vec3*) (m_Out1 + i * BENCH_VtxSize + BENCH_NormalOfs);
+			Vec3  t(*n);
+
+			a->TransformVector(t, *n);
+			n->Normalize();
+		}
+		break;
+	}
+	ms = BenchElapsed(start);
+	m_Result1 = c->GetMat4();
+	return ms;
+}
+
+/*
+ * Run a test using Mat4 values, return the elapsed milliseconds.
+ */
+double MathBench::RunMat4(int test)
+{
+	Mat4	a, c;
+	int64	start;
+	double	ms;
+
+	memcpy(m_Out2, m_Verts, m_Count * BENCH_VtxSize * sizeof(float));
+	start = Core::Profiler::GetTicks();
+	switch (test)
+	{
+		case 0:
+		for (int32 i = 0; i < m_Count; ++i)
+		{
+			c.Multiply(c, m_Mats[i]);
+			if ((i & 15) == 15)
+				c.Identity();
+		}
+		break;
+
+		case 1:
+		for (int32 i = 0; i < m_Count; ++i)
+		{
+			a = m_Mats[i];
+			a.data[3][0] = 0.01f;
+			c.Invert(a);
+		}
+		break;
+
+		case 2:
+		for (int32 i = 0; i < m_Count; ++i)
+			c.Set(m_Quats[i]);
+		break;
+
+		case 3:
+		for (int32 i = 0; i < m_Count; ++i)
+		{
+			const float* v = m_Verts + i * BENCH_VtxSize;
+
+			c.Identity();
+			c.PreTranslate(Vec3(v[0], v[1], v[2]));
+			a.Set(m_Quats[i]);
+			c.Multiply(a, c);
+			c.PreScale(Vec3(2.0f, 2.0f, 2.0f));
+		}
+		break;
+
+		case 4:
+		m_Mats[0].TransformPoints(m_Out2, m_Out2, m_Count, BENCH_VtxSize);
+		break;
+
+		case 5:
+		m_Mats[0].TransformVectors(m_Out2 + BENCH_NormalOfs, m_Out2 + BENCH_NormalOfs, m_Count, BENCH_VtxSize, true);
+		break;
+	}
+	ms = BenchElapsed(start);
+	m_Result2 = c;
+	return ms;
+}
+
+void MathBench::WriteReport(FILE* fp)
+{
+	fprintf(fp, "{\n\t\"count\": %d,\n\t\"runs\": %d,\n", m_Count, m_Runs);
+#ifdef VX_SSE
+	fprintf(fp, "\t\"simd\": \"sse\",\n");
+#else
+	fprintf(fp, "\t\"simd\": \"none\",\n");
+#endif
+	fprintf(fp, "\t\"tests\": [\n");
+	for (int t = 0; t < BENCH_NumTests; ++t)
+	{
+		double	t1 = m_Times[t][0];
+		double	t2 = m_Times[t][1];
+
+		fprintf(fp, "\t\t{ \"name\": \"%s\", ", TestNames[t]);
+		fprintf(fp, "\"milliseconds\": { \"matrix\": %.4f, \"mat4\": %.4f }, ", t1, t2);
+		fprintf(fp, "\"difference\": %g, ", m_Diffs[t]);
+		fprintf(fp, "\"speedup\": %.2f }%s\n", (t2 > 0) ? t1 / t2 : 0.0, (t < BENCH_NumTests - 1) ? "," : "");
+	}
+	fprintf(fp, "\t]\n}\n");
+}
+
+int MathBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+	intptr	nfloats;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: mathbench [-count n] [-runs n] [-out file]\n");
+		return 1;
+	}
+	if (!OnInit())
+		return BenchError("mathbench", "cannot initialize");
+	nfloats = intptr(m_Count) * BENCH_VtxSize;
+	m_Mats = (Mat4*) malloc(m_Count * sizeof(Mat4));
+	m_Quats = (Quat*) malloc(m_Count * sizeof(Quat));
+	m_Verts = (float*) malloc(nfloats * sizeof(float));
+	m_Out1 = (float*) malloc(nfloats * sizeof(float));
+	m_Out2 = (float*) malloc(nfloats * sizeof(float));
+	if (!m_Mats || !m_Quats || !m_Verts || !m_Out1 || !m_Out2)
+		return BenchError("mathbench", "out of memory");
+	MakeInputs();
+	for (int t = 0; t < BENCH_NumTests; ++t)
+	{
+		for (int r = 0; r < m_Runs; ++r)
+		{
+			double	t1 = RunMatrix(t);
+			double	t2 = RunMat4(t);
+
+			if ((r == 0) || (t1 < m_Times[t][0]))
+				m_Times[t][0] = t1;
+			if ((r == 0) || (t2 < m_Times[t][1]))
+				m_Times[t][1] = t2;
+		}
+		if (t >= 4)
+			m_Diffs[t] = Diff(m_Out1, m_Out2, nfloats);
+		else
+			m_Diffs[t] = Diff(m_Result1.GetData(), m_Result2.GetData(), 16);
+	}
+	if ((fp = BenchOpenReport("mathbench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	MathBench*	bench = new MathBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
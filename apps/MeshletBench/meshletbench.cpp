@@ -0,0 +1,309 @@
+/*
+ * Meshlet culling benchmark.
+ *
+ * Makes a field of large sphere meshes around the camera in a display
+ * scene which uses the NullRenderer and turns the camera a little
+ * each frame. The frames are run twice, first with each mesh culled
+ * as a whole and then with the meshes divided into meshlets, so the
+ * parts of a sphere which are off screen or on its far side are culled.
+ * The triangles submitted per frame, the index bytes and the frame
+ * times are written as JSON.
+ *
+ *	meshletbench [options]
+ *		-meshes n		number of sphere meshes (default 64)
+ *		-verts n		approximate number of vertices in each mesh (default 16000)
+ *		-frames n		number of frames to measure (default 200)
+ *		-warmup n		number of frames to run before measuring (default 10)
+ *		-maxvtx n		maximum vertices in a meshlet (default 64)
+ *		-maxtris n		maximum triangles in a meshlet (default 124)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_NumModes	2
+
+static const char* ModeNames[BENCH_NumModes] = { "whole_mesh", "meshlets" };
+
+/*
+ * Results for one way of culling
+ */
+struct MeshletResult
+{
+	double	FrameMS;		// mean milliseconds per frame
+	double	DrawCalls;		// draw calls per frame
+	double	Triangles;		// triangles submitted per frame
+	double	Indices;		// indices submitted per frame
+	double	Ranges;			// meshlet index ranges drawn per frame
+	double	Bytes;			// vertex and index bytes submitted per frame
+};
+
+/*!
+ * @class MeshletBench
+ * @brief Compares culling whole meshes with culling meshlets.
+ */
+class MeshletBench : public World3D
+{
+public:
+	MeshletBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	bool		ParseOptions(int argc, char** argv);
+	bool		MakeDisplay();
+	TriMesh*	MakeSphere(const Vec3& center, float radius);
+	void		MakeField();
+	double		MakeMeshlets();
+	void		RunFrames(int mode);
+	void		WriteReport(FILE* fp);
+
+	int32			m_NumMeshes;
+	int32			m_NumVerts;
+	int32			m_NumFrames;
+	int32			m_WarmUp;
+	int32			m_MaxVtx;
+	int32			m_MaxTris;
+	const char*		m_OutFile;
+	int64			m_TotalTris;
+	int64			m_TotalIndices;
+	int64			m_IndexBytes;		// index bytes in device buffers
+	int32			m_NumMeshlets;
+	double			m_MeshletMS;		// milliseconds to make all meshlets
+	NullRenderer*	m_Render;
+	Ref<Scene>		m_Scene;
+	Ref<Model>		m_Root;
+	MeshletResult	m_Results[BENCH_NumModes];
+};
+
+MeshletBench::MeshletBench() : World3D()
+{
+	m_NumMeshes = 64;
+	m_NumVerts = 16000;
+	m_NumFrames = 200;
+	m_WarmUp = 10;
+	m_MaxVtx = TriMesh::MESHLET_MaxVtx;
+	m_MaxTris = TriMesh::MESHLET_MaxTris;
+	m_OutFile = NULL;
+	m_TotalTris = 0;
+	m_TotalIndices = 0;
+	m_IndexBytes = 0;
+	m_NumMeshlets = 0;
+	m_MeshletMS = 0;
+	m_Render = NULL;
+	memset(m_Results, 0, sizeof(m_Results));
+	DoAsyncLoad = false;
+}
+
+bool MeshletBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+		if (!BenchOption(argc, argv, i, "-meshes", m_NumMeshes) &&
+			!BenchOption(argc, argv, i, "-verts", m_NumVerts) &&
+			!BenchOption(argc, argv, i, "-frames", m_NumFrames) &&
+			!BenchOption(argc, argv, i, "-warmup", m_WarmUp) &&
+			!BenchOption(argc, argv, i, "-maxvtx", m_MaxVtx) &&
+			!BenchOption(argc, argv, i, "-maxtris", m_MaxTris) &&
+			!BenchOption(argc, argv, i, "-out", m_OutFile))
+			return false;
+	return (m_NumMeshes > 0) && (m_NumVerts >= 16) && (m_NumFrames > 0) &&
+		   (m_WarmUp >= 0) && (m_MaxVtx >= 3) && (m_MaxTris > 0);
+}
+
+/*
+ * Make a display scene which uses the null renderer
+ * and register it with the world as the main scene.
+ */
+bool MeshletBench::MakeDisplay()
+{
+	Scene*	scene;
+
+	m_Render = new NullRenderer;
+	scene = new Scene(m_Render);
+	m_Scene = scene;
+	scene->SetOptions(Scene::CLEARALL | Scene::STATESORT);
+	if (!m_Render->Init(scene, Window(NULL), NULL))
+		return false;
+	AddScene(scene, Window(NULL));
+	scene->SetViewport(0.0f, 0.0f, 1024.0f, 768.0f);
+	return true;
+}
+
+/*
+ * Make an indexed UV sphere with locations and normals.
+ * The triangles go around the sphere a row at a time
+ * like most exported meshes.
+ */
+TriMesh* MeshletBench::MakeSphere(const Vec3& center, float radius)
+{
+	int32		rows = int32(sqrt(double(m_NumVerts)));
+	int32		cols = m_NumVerts / rows;
+	TriMesh*	mesh = new TriMesh(TEXT("float3 position, float3 normal"), rows * cols);
+	int32*		inds = (int32*) malloc(6 * (rows - 1) * (cols - 1) * sizeof(int32));
+	int32*		idx = inds;
+
+	for (int32 r = 0; r < rows; ++r)
+		for (int32 c = 0; c < cols; ++c)
+		{
+			float	theta = float(c) / float(cols - 1) * 2.0f * PI;
+			float	phi = float(r) / float(rows - 1) * PI;
+			Vec3	nml(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+			Vec3	loc(center + nml * radius);
+			float	vtx[6] = { loc.x, loc.y, loc.z, nml.x, nml.y, nml.z };
+
+			mesh->AddVertices(vtx, 1);
+		}
+	for (int32 r = 0; r < rows - 1; ++r)
+		for (int32 c = 0; c < cols - 1; ++c)
+		{
+			int32	v = r * cols + c;
+
+			*idx++ = v;
+			*idx++ = v + cols;
+			*idx++ = v + 1;
+			*idx++ = v + 1;
+			*idx++ = v + cols;
+			*idx++ = v + cols + 1;
+		}
+	mesh->AddIndices(inds, idx - inds);
+	free(inds);
+	return mesh;
+}
+
+/*
+ * Put the spheres on a ring around the camera so some are
+ * always behind it and each visible one is partly off screen.
+ */
+void MeshletBench::MakeField()
+{
+	Model*	root = new Model;
+
+	m_Root = root;
+	for (int32 i = 0; i < m_NumMeshes; ++i)
+	{
+		float		angle = float(i) * 2.0f * PI / m_NumMeshes;
+		float		dist = 60.0f + 40.0f * float(i % 3);
+		Vec3		center(dist * cosf(angle), float(i % 5) * 10.0f - 20.0f, dist * sinf(angle));
+		Shape*		shape = new Shape;
+		TriMesh*	mesh = MakeSphere(center, 25.0f);
+
+		shape->SetGeometry(mesh);
+		root->Append(shape);
+		m_TotalTris += mesh->GetNumFaces();
+		m_TotalIndices += mesh->GetNumIdx();
+		m_IndexBytes += mesh->GetNumIdx() * Mesh::FindIndexSize(mesh->GetIndices());
+	}
+	m_Scene->SetModels(root);
+}
+
+/*
+ * Divide every mesh into meshlets, return the elapsed milliseconds.
+ */
+double MeshletBench::MakeMeshlets()
+{
+	GroupIter<Shape>	iter((Shape*) m_Scene->GetModels(), Group::CHILDREN);
+	Shape*				shape;
+	int64				start = Core::Profiler::GetTicks();
+
+	while (shape = iter.Next())
+	{
+		TriMesh* mesh = (TriMesh*) shape->GetGeometry();
+
+		if (mesh && mesh->MakeMeshlets(m_MaxVtx, m_MaxTris))
+			m_NumMeshlets += mesh->GetNumMeshlets();
+	}
+	return BenchElapsed(start);
+}
+
+/*
+ * Run the warm up frames, then the measured frames, turning
+ * the camera the same way for both modes.
+ */
+void MeshletBench::RunFrames(int mode)
+{
+	Camera*			cam = m_Scene->GetCamera();
+	MeshletResult&	r = m_Results[mode];
+	double			ms = 0;
+	double			frames;
+
+	for (int f = -m_WarmUp; f < m_NumFrames; ++f)
+	{
+		int64 start;
+
+		if (f == 0)
+			m_Render->ResetCounts();
+		cam->Reset();
+		cam->Rotate(Vec3(0, 1, 0), float(f) * 2.0f * PI / 120.0f);
+		start = Core::Profiler::GetTicks();
+		m_Scene->DoFrame();
+		if (f >= 0)
+			ms += BenchElapsed(start);
+	}
+	const NullRenderer::Counts& c = m_Render->GetTotalCounts();
+
+	frames = c.Frames ? double(c.Frames) : 1.0;
+	r.FrameMS = ms / m_NumFrames;
+	r.DrawCalls = c.Meshes / frames;
+	r.Triangles = c.Prims / frames;
+	r.Indices = c.Indices / frames;
+	r.Ranges = c.Ranges / frames;
+	r.Bytes = c.Bytes / frames;
+}
+
+void MeshletBench::WriteReport(FILE* fp)
+{
+	fprintf(fp, "{\n\t\"meshes\": %d,\n\t\"triangles\": %lld,\n\t\"frames\": %d,\n",
+			m_NumMeshes, (long long) m_TotalTris, m_NumFrames);
+	fprintf(fp, "\t\"index_buffers\": { \"indices\": %lld, \"kb_32bit\": %d, \"kb_device\": %d },\n",
+			(long long) m_TotalIndices, int(m_TotalIndices * sizeof(int32) / 1024), int(m_IndexBytes / 1024));
+	fprintf(fp, "\t\"meshlets\": { \"count\": %d, \"max_vertices\": %d, \"max_triangles\": %d, \"build_milliseconds\": %.3f },\n",
+			m_NumMeshlets, m_MaxVtx, m_MaxTris, m_MeshletMS);
+	fprintf(fp, "\t\"tests\": [\n");
+	for (int m = 0; m < BENCH_NumModes; ++m)
+	{
+		const MeshletResult& r = m_Results[m];
+
+		fprintf(fp, "\t\t{ \"name\": \"%s\", \"frame_milliseconds\": %.4f, \"draw_calls\": %.1f, ",
+				ModeNames[m], r.FrameMS, r.DrawCalls);
+		fprintf(fp, "\"triangles_per_frame\": %.1f, \"indices_per_frame\": %.1f, \"ranges_per_frame\": %.1f, \"bytes_per_frame\": %.1f }%s\n",
+				r.Triangles, r.Indices, r.Ranges, r.Bytes, (m < BENCH_NumModes - 1) ? "," : "");
+	}
+	fprintf(fp, "\t],\n");
+	fprintf(fp, "\t\"triangle_reduction\": %.3f\n",
+			(m_Results[0].Triangles > 0) ? 1.0 - m_Results[1].Triangles / m_Results[0].Triangles : 0.0);
+	fprintf(fp, "}\n");
+}
+
+int MeshletBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: meshletbench [-meshes n] [-verts n] [-frames n] [-warmup n] [-maxvtx n] [-maxtris n] [-out file]\n");
+		return 1;
+	}
+	if (!OnInit() || !MakeDisplay())
+		return BenchError("meshletbench", "cannot initialize");
+	MakeField();
+	RunFrames(0);
+	m_MeshletMS = MakeMeshlets();
+	RunFrames(1);
+	if ((fp = BenchOpenReport("meshletbench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	m_Root = (Model*) NULL;
+	m_Scene = (Scene*) NULL;
+	OnExit();
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	MeshletBench*	bench = new MeshletBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
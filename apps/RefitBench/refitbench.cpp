@@ -0,0 +1,269 @@
+/*
+ * Bounding volume refit benchmark.
+ *
+ * Builds a large hierarchy of shapes and, each frame, moves a small
+ * fraction of them and then brings the bounds of the whole hierarchy
+ * up to date, the way the scene does after simulation. The bounds
+ * are refit three ways:
+ *
+ *	rescan	each invalid model recomputes its bounds by transforming
+ *			the bounds of all its children (how Model::DoBounds used to work)
+ *	lazy	Model::GetBound on the root, invalid models are refit
+ *			recursively using the saved bounds of unchanged children
+ *	batch	Model::UpdateBounds collects the invalid models and
+ *			refits them children first in one pass
+ *
+ * Frame times, the number of models refit and the root bounds
+ * are written as JSON. The hierarchy, the models moved, the options
+ * and the report come from BoundBench.
+ *
+ *	refitbench [options]
+ *		-nodes n		number of models in the hierarchy (default 100000)
+ *		-branch n		number of children of each model (default 8)
+ *		-moves n		number of models moved each frame (default 1% of nodes)
+ *		-frames n		number of frames to run (default 100)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#include "../BoundBench/boundbench.h"
+
+static const char* RefitModeNames[BENCH_NumModes] = { "rescan", "lazy", "batch" };
+
+/*!
+ * @class RefitBench
+ * @brief Measures bounding volume maintenance on a large hierarchy.
+ */
+class RefitBench : public BoundBench
+{
+public:
+	RefitBench();
+	~RefitBench();
+
+protected:
+	virtual Model*	MakeNode(int32 i);
+	virtual bool	MakeGraph();
+	virtual void	FreeGraph();
+	virtual void	MoveNode(int32 i, int mode);
+	virtual void	BeginMode(int mode);
+	virtual float	RunFrame(int mode);
+	virtual void	EndMode(int mode);
+	virtual float	GetError();
+	virtual const char*	GetCountName(int mode);
+
+	TriMesh*	MakeBox();
+	void		Rescan(int32 i);
+
+	Ref<TriMesh>	m_Mesh;
+	Box3*			m_Boxes;		// bounds of each model for rescan mode
+	Sphere*			m_Spheres;		// bounding spheres of each model for rescan mode
+	bool*			m_Dirty;		// bounds invalid flags for rescan mode
+	Box3			m_RootBox[BENCH_NumModes];
+};
+
+RefitBench::RefitBench() : BoundBench("refitbench")
+{
+	m_ModeNames = RefitModeNames;
+	m_NumNodes = 100000;
+	m_NumMoves = -1;
+	m_Boxes = NULL;
+	m_Spheres = NULL;
+	m_Dirty = NULL;
+}
+
+RefitBench::~RefitBench()
+{
+	if (m_Boxes)
+		free(m_Boxes);
+	if (m_Spheres)
+		free(m_Spheres);
+	if (m_Dirty)
+		free(m_Dirty);
+}
+
+/*
+ * Make a unit cube mesh shared by all the shapes.
+ */
+TriMesh* RefitBench::MakeBox()
+{
+	static const float verts[8 * 3] = {
+		-0.5f, -0.5f, -0.5f,	0.5f, -0.5f, -0.5f,
+		 0.5f,  0.5f, -0.5f,	-0.5f,  0.5f, -0.5f,
+		-0.5f, -0.5f,  0.5f,	0.5f, -0.5f,  0.5f,
+		 0.5f,  0.5f,  0.5f,	-0.5f,  0.5f,  0.5f };
+	static const int32 inds[36] = {
+		0, 2, 1, 0, 3, 2,	4, 5, 6, 4, 6, 7,
+		0, 1, 5, 0, 5, 4,	3, 6, 2, 3, 7, 6,
+		0, 4, 7, 0, 7, 3,	1, 2, 6, 1, 6, 5 };
+	TriMesh* mesh = new TriMesh(TEXT("float3 position"), 8);
+
+	mesh->AddVertices(verts, 8);
+	mesh->AddIndices(inds, 36);
+	return mesh;
+}
+
+/*
+ * Make shape i of the hierarchy, its bounds are computed
+ * from the shared box mesh.
+ */
+Model* RefitBench::MakeNode(int32 i)
+{
+	Shape* shape = new Shape;
+
+	shape->SetGeometry(m_Mesh);
+	m_Dirty[i] = true;
+	return shape;
+}
+
+bool RefitBench::MakeGraph()
+{
+	m_Boxes = (Box3*) calloc(m_NumNodes, sizeof(Box3));
+	m_Spheres = (Sphere*) calloc(m_NumNodes, sizeof(Sphere));
+	m_Dirty = (bool*) calloc(m_NumNodes, sizeof(bool));
+	if ((m_Boxes == NULL) || (m_Spheres == NULL) || (m_Dirty == NULL))
+		return false;
+	if (m_Mesh.IsNull())
+		m_Mesh = MakeBox();
+	return BoundBench::MakeGraph();
+}
+
+void RefitBench::FreeGraph()
+{
+	BoundBench::FreeGraph();
+	free(m_Boxes);
+	free(m_Spheres);
+	free(m_Dirty);
+	m_Boxes = NULL;
+	m_Spheres = NULL;
+	m_Dirty = NULL;
+}
+
+/*
+ * Move a model. For rescan mode, the model and
+ * its ancestors are marked invalid.
+ */
+void RefitBench::MoveNode(int32 n, int mode)
+{
+	BoundBench::MoveNode(n, mode);
+	if (mode != 0)
+		return;
+	while (!m_Dirty[n])
+	{
+		m_Dirty[n] = true;
+		if (n == 0)
+			break;
+		n = (n - 1) / m_Branch;
+	}
+}
+
+/*
+ * Recompute the bounds of an invalid model from its geometry and
+ * the bounds of all its children transformed by their matrices.
+ */
+void RefitBench::Rescan(int32 i)
+{
+	Box3	box;
+	Sphere	bsp;
+	int32	first = i * m_Branch + 1;
+
+	if (!m_Dirty[i])
+		return;
+	m_Mesh->GetBound(&box);
+	bsp = box;
+	for (int32 c = first; (c < first + m_Branch) && (c < m_NumNodes); ++c)
+	{
+		Box3			cbox;
+		Sphere			csp;
+		const Matrix*	trans = m_Nodes[c]->GetTransform();
+
+		Rescan(c);
+		cbox = m_Boxes[c];
+		csp = m_Spheres[c];
+		if (!trans->IsIdentity())
+		{
+			cbox *= *trans;
+			csp *= *trans;
+		}
+		box.Extend(cbox);
+		bsp.Extend(csp);
+		++m_Counts[0];
+	}
+	m_Boxes[i] = box;
+	m_Spheres[i] = bsp;
+	m_Dirty[i] = false;
+}
+
+/*
+ * Bring the bounds up to date before the first frame,
+ * this work is not counted.
+ */
+void RefitBench::BeginMode(int mode)
+{
+	if (mode == 0)
+		Rescan(0);
+	else
+		Model::UpdateBounds(m_Root);
+	m_Counts[mode] = 0;
+}
+
+float RefitBench::RunFrame(int mode)
+{
+	int64	start = Core::Profiler::GetTicks();
+	Sphere	bsp;
+
+	switch (mode)
+	{
+		case 0:
+		Rescan(0);
+		break;
+
+		case 1:
+		m_Root->GetBound(&bsp, Model::NONE);
+		break;
+
+		case 2:
+		m_Counts[mode] += Model::UpdateBounds(m_Root);
+		break;
+	}
+	return BenchElapsed(start);
+}
+
+void RefitBench::EndMode(int mode)
+{
+	if (mode == 0)
+		m_RootBox[mode] = m_Boxes[0];
+	else
+		m_Root->GetBound(&m_RootBox[mode], Model::NONE);
+}
+
+/*
+ * Return the largest difference between the root bounds of rescan
+ * mode and the others, relative to the size of the bounds.
+ */
+float RefitBench::GetError()
+{
+	float	maxdiff = 0;
+	float	size = (m_RootBox[0].max - m_RootBox[0].min).Length();
+
+	for (int m = 1; m < BENCH_NumModes; ++m)
+	{
+		float	dmin = (m_RootBox[m].min - m_RootBox[0].min).Length();
+		float	dmax = (m_RootBox[m].max - m_RootBox[0].max).Length();
+		float	d = ((dmin > dmax) ? dmin : dmax) / size;
+
+		if (d > maxdiff)
+			maxdiff = d;
+	}
+	return maxdiff;
+}
+
+const char* RefitBench::GetCountName(int mode)
+{
+	return (mode == 0) ? "children_transformed_per_frame" : "models_refit_per_frame";
+}
+
+int main(int argc, char** argv)
+{
+	RefitBench*	bench = new RefitBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
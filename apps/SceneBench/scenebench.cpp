@@ -0,0 +1,562 @@
+/*
+ * Headless scene benchmark.
+ *
+ * Loads a Vixen content file (.vix) or script (.scp) into a display
+ * scene which uses the NullRenderer, runs a fixed number of frames through
+ * Scene::DoFrame and writes timing, device work and memory statistics as JSON.
+ *
+ *	scenebench [options] file
+ *		-frames n		number of frames to measure (default 500)
+ *		-warmup n		number of frames to run before measuring (default 20)
+ *		-size w h		viewport size (default 1024 x 768)
+ *		-detail			enable detailed (per-engine, per-model) profiler zones
+ *		-noinstance		disable instanced rendering in the state sorter
+ *		-batch			merge static geometry into chunks when the scene is loaded
+ *		-clusterlights	find the lights near each shape using view volume cells
+ *		-materials		change the diffuse color of every material each frame
+ *		-commands		record a command stream each frame and replay it
+ *		-replay n		time n replays of the last frame's commands (default 100)
+ *		-savecommands file	save the last frame's commands to file
+ *		-diffcommands file	compare the last frame's commands with those saved in file
+ *		-trace file		capture the measured frames as a Chrome trace
+ *		-out file		write JSON results to file instead of stdout
+ *
+ * Per-phase timings come from the profiler zones in Scene::DoFrame and are
+ * only available if the library was compiled with VX_PROFILE.
+ * Total frame times are always measured. The cost of recording one zone
+ * is measured after the warm up and multiplied by the number of zones
+ * recorded per frame to estimate the profiler's own share of the frame.
+ *
+ * The command stream options imply -commands. Replaying the last frame
+ * against a second null renderer times the submission path by itself
+ * and checks that it does the same device work as the live frame.
+ */
+#include "vxbench.h"
+#include "vxutil.h"
+
+#ifdef _WIN32
+	#include <psapi.h>
+	#pragma comment(lib, "psapi.lib")
+#else
+	#include <sys/resource.h>
+#endif
+
+using namespace Vixen;
+
+#define	BENCH_NumPhases	6
+
+static const TCHAR* PhaseZones[BENCH_NumPhases] =
+{
+	TEXT("Scene::DoFrame"),
+	TEXT("Messenger::Load"),
+	TEXT("Scene::DoDisplay"),
+	TEXT("Scene::DoRender"),
+	TEXT("Scene::DoSimulation"),
+	TEXT("Messenger::Flush"),
+};
+
+static const char* PhaseNames[BENCH_NumPhases] =
+{
+	"frame", "load_events", "display", "render", "simulation", "flush_events"
+};
+
+/*!
+ * @class SceneBench
+ * @brief Console world which runs a scene without a display.
+ */
+class SceneBench : public World3D
+{
+public:
+	SceneBench();
+	~SceneBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	bool		ParseOptions(int argc, char** argv);
+	bool		MakeDisplay();
+	bool		LoadContent();
+	void		FindMaterials();
+	void		AnimateMaterials(int frame);
+	void		RunFrames();
+	void		SavePhases(int frame);
+	void		ReplayCommands();
+	void		WriteReport(FILE* fp);
+	static int	GetPeakMemory();
+	static bool	BatchScene(Scene* scene, const TCHAR* filename);
+
+	int				m_NumFrames;
+	int				m_WarmUp;
+	int				m_RenderOptions;
+	bool			m_ClusterLights;
+	bool			m_AnimMaterials;
+	int				m_NumMaterials;
+	DeviceBuffer**	m_Materials;
+	SlotHandle*		m_DiffuseSlots;
+	double			m_MaterialTime;
+	float			m_Width;
+	float			m_Height;
+	const char*		m_InFile;
+	const char*		m_OutFile;
+	const char*		m_TraceFile;
+	const char*		m_SaveCommands;
+	const char*		m_DiffCommands;
+	int				m_Replays;
+	double			m_ReplayTime;
+	int				m_ReplayDraws;
+	bool			m_ReplayMatches;
+	int32			m_FirstDiff;
+	float			m_LoadTime;
+	int				m_LoadMemory;
+	int				m_PeakMemory;
+	bool			m_HavePhases;
+	float			m_ZoneCost;
+	double			m_ZoneEvents;
+	float*			m_Times[BENCH_NumPhases];
+	NullRenderer*	m_Render;
+	Ref<Scene>		m_Scene;
+	static bool		s_Batched;
+	static SceneOptimize::Stats	s_BatchStats;
+};
+
+bool					SceneBench::s_Batched = false;
+SceneOptimize::Stats	SceneBench::s_BatchStats;
+
+SceneBench::SceneBench() : World3D()
+{
+	m_NumFrames = 500;
+	m_WarmUp = 20;
+	m_RenderOptions = 0;
+	m_ClusterLights = false;
+	m_AnimMaterials = false;
+	m_NumMaterials = 0;
+	m_Materials = NULL;
+	m_DiffuseSlots = NULL;
+	m_MaterialTime = 0.0;
+	m_Width = 1024.0f;
+	m_Height = 768.0f;
+	m_InFile = NULL;
+	m_OutFile = NULL;
+	m_TraceFile = NULL;
+	m_SaveCommands = NULL;
+	m_DiffCommands = NULL;
+	m_Replays = 100;
+	m_ReplayTime = 0.0;
+	m_ReplayDraws = 0;
+	m_ReplayMatches = false;
+	m_FirstDiff = -1;
+	m_LoadTime = 0.0f;
+	m_LoadMemory = 0;
+	m_PeakMemory = 0;
+	m_HavePhases = false;
+	m_ZoneCost = 0.0f;
+	m_ZoneEvents = 0.0;
+	m_Render = NULL;
+	for (int i = 0; i < BENCH_NumPhases; ++i)
+		m_Times[i] = NULL;
+	DoAsyncLoad = false;
+}
+
+SceneBench::~SceneBench()
+{
+	for (int i = 0; i < BENCH_NumPhases; ++i)
+		if (m_Times[i])
+			free(m_Times[i]);
+	if (m_Materials)
+		free(m_Materials);
+	if (m_DiffuseSlots)
+		free(m_DiffuseSlots);
+}
+
+bool SceneBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+
+		if (BenchOption(argc, argv, i, "-frames", m_NumFrames) ||
+			BenchOption(argc, argv, i, "-warmup", m_WarmUp) ||
+			BenchOption(argc, argv, i, "-trace", m_TraceFile) ||
+			BenchOption(argc, argv, i, "-out", m_OutFile))
+			continue;
+		if (BenchOption(argc, argv, i, "-replay", m_Replays) ||
+			BenchOption(argc, argv, i, "-savecommands", m_SaveCommands) ||
+			BenchOption(argc, argv, i, "-diffcommands", m_DiffCommands) ||
+			(strcmp(arg, "-commands") == 0))
+			m_RenderOptions |= GeoSorter::RecordCommands;
+		else if ((strcmp(arg, "-size") == 0) && (i + 2 < argc))
+		{
+			m_Width = (float) atof(argv[++i]);
+			m_Height = (float) atof(argv[++i]);
+		}
+		else if (strcmp(arg, "-detail") == 0)
+			Core::Profiler::Detail = true;
+		else if (strcmp(arg, "-noinstance") == 0)
+			m_RenderOptions |= GeoSorter::NoInstancing;
+		else if (strcmp(arg, "-batch") == 0)
+			SceneLoader::PostLoad = &BatchScene;
+		else if (strcmp(arg, "-clusterlights") == 0)
+			m_ClusterLights = true;
+		else if (strcmp(arg, "-materials") == 0)
+			m_AnimMaterials = true;
+		else if (*arg == '-')
+			return false;
+		else
+			m_InFile = arg;
+	}
+	if ((m_InFile == NULL) || (m_NumFrames <= 0) || (m_WarmUp < 0) || (m_Replays < 0))
+		return false;
+	return true;
+}
+
+/*
+ * Make a display scene which uses the null renderer
+ * and register it with the world as the main scene.
+ */
+bool SceneBench::MakeDisplay()
+{
+	Scene*	scene;
+
+	m_Render = new NullRenderer(m_RenderOptions);
+	scene = new Scene(m_Render);
+	m_Scene = scene;
+	scene->SetOptions(Scene::CLEARALL | Scene::STATESORT);
+	if (!m_Render->Init(scene, Window(NULL), NULL))
+		return false;
+	if (m_ClusterLights)
+	{
+		m_Render->GetLights()->DoDistanceCull = true;
+		m_Render->GetLights()->DoClusterLights = true;
+	}
+	AddScene(scene, Window(NULL));
+	scene->SetViewport(0.0f, 0.0f, m_Width, m_Height);
+	return true;
+}
+
+/*
+ * Load the content file with a blocking read. A scene file
+ * generates a LOAD_SCENE event which World3D::OnEvent uses to
+ * replace the contents of the display scene when the first frame
+ * processes its events. A script is run by a Scriptor which
+ * becomes the root of the simulation tree.
+ */
+bool SceneBench::LoadContent()
+{
+	Core::String	filename(m_InFile);
+	const TCHAR*	fname = filename;
+	size_t			len = STRLEN(fname);
+	double			start = Core::GetTime();
+
+	if ((len > 4) && (STRCMP(fname + len - 4, TEXT(".scp")) == 0))
+	{
+		Scriptor* script = new Scriptor;
+
+		m_Scene->SetEngines(script);
+		script->LoadScript(fname);
+	}
+	else
+		MakeScene(fname);
+	m_Scene->DoFrame();						// process load events
+	m_LoadTime = float(Core::GetTime() - start);
+	m_LoadMemory = GetPeakMemory();
+	if (m_Scene->GetModels() == NULL)
+		VX_ERROR(("scenebench: cannot load %s\n", fname), false);
+	return true;
+}
+
+/*
+ * Loader post-processing function which merges static geometry
+ * and saves the optimizer statistics for the report.
+ */
+bool SceneBench::BatchScene(Scene* scene, const TCHAR* filename)
+{
+	SceneOptimize	opt;
+	Model*			root = scene->GetModels();
+
+	if ((root == NULL) || !opt.OptimizeStatic(root, scene->GetEngines()))
+		return false;
+	s_BatchStats = opt.GetStats();
+	s_Batched = true;
+	return true;
+}
+
+/*
+ * Find the materials in the scene which have a diffuse color
+ * and resolve the handle for it in each one.
+ */
+void SceneBench::FindMaterials()
+{
+	GroupIter<Shape>	iter((Shape*) m_Scene->GetModels(), Group::DEPTH_FIRST);
+	Shape*				shape;
+	int					maxmtls = 0;
+
+	while (shape = iter.Next())
+	{
+		Appearance*		app;
+		DeviceBuffer*	mtl;
+		SlotHandle		slot;
+		int				i;
+
+		if (!shape->IsClass(VX_Shape) ||
+			((app = shape->GetAppearance()) == NULL) ||
+			((mtl = app->GetMaterial()) == NULL))
+			continue;
+		for (i = 0; i < m_NumMaterials; ++i)
+			if (m_Materials[i] == mtl)
+				break;
+		if (i < m_NumMaterials)
+			continue;
+		slot = mtl->GetHandle(TEXT("Diffuse"));
+		if (!slot.IsValid())
+			continue;
+		if (m_NumMaterials >= maxmtls)
+		{
+			maxmtls = maxmtls ? maxmtls * 2 : 64;
+			m_Materials = (DeviceBuffer**) realloc(m_Materials, maxmtls * sizeof(DeviceBuffer*));
+			m_DiffuseSlots = (SlotHandle*) realloc(m_DiffuseSlots, maxmtls * sizeof(SlotHandle));
+		}
+		m_Materials[m_NumMaterials] = mtl;
+		m_DiffuseSlots[m_NumMaterials] = slot;
+		++m_NumMaterials;
+	}
+}
+
+/*
+ * Change the diffuse color of every material through its slot handle
+ * and add the time taken to the material update time.
+ */
+void SceneBench::AnimateMaterials(int frame)
+{
+	int64	start = Core::Profiler::GetTicks();
+	float	t = 0.5f + 0.5f * sinf(frame * 0.1f);
+
+	for (int i = 0; i < m_NumMaterials; ++i)
+		m_Materials[i]->Set(m_DiffuseSlots[i], Col4(t, 1.0f - t, float(i & 1), 1.0f));
+	m_MaterialTime += BenchElapsed(start);
+}
+
+/*
+ * Save the profiler times of each scene phase for a frame.
+ * Scene::DoFrame collects the zones of the previous frame when it starts,
+ * so the times for a frame are read after the next frame starts.
+ */
+void SceneBench::SavePhases(int frame)
+{
+	m_ZoneEvents += Core::Profiler::GetFrameEvents();
+	for (int i = 1; i < BENCH_NumPhases; ++i)
+	{
+		const Core::Profiler::ZoneStats* zone = Core::Profiler::FindZone(PhaseZones[i]);
+
+		m_Times[i][frame] = zone ? zone->Last : 0.0f;
+		if (zone)
+			m_HavePhases = true;
+	}
+}
+
+/*
+ * Run the warm up frames, then the measured frames, saving the
+ * time for each frame and each scene phase.
+ * The profiler zones are collected by Scene::DoFrame. They are only
+ * collected here before the measured frames, to discard the warm up,
+ * and after them, to get the zones of the last frame.
+ */
+void SceneBench::RunFrames()
+{
+	Scene*	scene = m_Scene;
+
+	for (int i = 0; i < BENCH_NumPhases; ++i)
+		m_Times[i] = (float*) malloc(m_NumFrames * sizeof(float));
+	Core::Profiler::Enabled = true;
+	if (m_AnimMaterials)
+		FindMaterials();
+	for (int f = 0; f < m_WarmUp; ++f)
+		scene->DoFrame();
+	m_ZoneCost = Core::Profiler::MeasureOverhead();
+	Core::Profiler::EndFrame();			// discard warm up zones
+	Core::Profiler::Reset();
+	m_Render->ResetCounts();
+	if (m_TraceFile)
+		Core::Profiler::StartCapture(m_NumFrames + 1);	// first collection is empty
+	for (int f = 0; f < m_NumFrames; ++f)
+	{
+		int64	start;
+
+		if (m_AnimMaterials)
+			AnimateMaterials(f);
+		start = Core::Profiler::GetTicks();
+		scene->DoFrame();
+		m_Times[0][f] = BenchElapsed(start);
+		if (f > 0)
+			SavePhases(f - 1);
+	}
+	Core::Profiler::EndFrame();			// collect zones for the last frame
+	if (m_NumFrames > 0)
+		SavePhases(m_NumFrames - 1);
+	m_PeakMemory = GetPeakMemory();
+	if (m_TraceFile)
+		Core::Profiler::WriteTrace(Core::String(m_TraceFile));
+}
+
+/*
+ * Replay the commands recorded for the last frame against a
+ * second null renderer, compare its device work with the live
+ * frame, then save or compare the commands if requested.
+ */
+void SceneBench::ReplayCommands()
+{
+	RenderStream*		stream = m_Render->GetCommands();
+	Ref<NullRenderer>	player = new NullRenderer;
+
+	if (stream == NULL)
+		return;
+	for (int r = 0; r < m_Replays; ++r)
+	{
+		int64	start = Core::Profiler::GetTicks();
+
+		player->Begin(0, r);
+		m_ReplayDraws = stream->Replay(player);
+		player->End(r);
+		m_ReplayTime += BenchElapsed(start);
+	}
+	if (m_Replays > 0)
+	{
+		const NullRenderer::Counts& live = m_Render->GetFrameCounts();
+		const NullRenderer::Counts& replay = player->GetFrameCounts();
+
+		m_ReplayMatches = (live.Meshes == replay.Meshes) &&
+						  (live.Prims == replay.Prims) &&
+						  (live.Batches == replay.Batches) &&
+						  (live.Instances == replay.Instances) &&
+						  (live.StateChanges == replay.StateChanges);
+	}
+	if (m_SaveCommands && !stream->Write(Core::String(m_SaveCommands)))
+		fprintf(stderr, "scenebench: cannot write %s\n", m_SaveCommands);
+	if (m_DiffCommands)
+	{
+		Ref<RenderStream>	saved = new RenderStream;
+
+		if (saved->Read(Core::String(m_DiffCommands)))
+			m_FirstDiff = stream->Compare(*saved);
+		else
+		{
+			fprintf(stderr, "scenebench: cannot read %s\n", m_DiffCommands);
+			m_DiffCommands = NULL;
+		}
+	}
+}
+
+/*
+ * Return the peak resident memory of the process in kilobytes
+ */
+int SceneBench::GetPeakMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS	pmc;
+
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return int(pmc.PeakWorkingSetSize / 1024);
+	return 0;
+#else
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return int(usage.ru_maxrss);
+	return 0;
+#endif
+}
+
+void SceneBench::WriteReport(FILE* fp)
+{
+	const NullRenderer::Counts&	c = m_Render->GetTotalCounts();
+	double	frames = c.Frames ? double(c.Frames) : 1.0;
+	int		nphases = m_HavePhases ? BENCH_NumPhases : 1;
+
+	fprintf(fp, "{\n\t\"file\": ");
+	BenchWriteString(fp, m_InFile);
+	fprintf(fp, ",\n");
+	fprintf(fp, "\t\"frames\": %d,\n\t\"warmup\": %d,\n", m_NumFrames, m_WarmUp);
+	fprintf(fp, "\t\"load_seconds\": %.4f,\n", m_LoadTime);
+	fprintf(fp, "\t\"milliseconds\": {\n");
+	for (int i = 0; i < nphases; ++i)
+	{
+		fprintf(fp, "\t\t");
+		BenchWriteTimes(fp, PhaseNames[i], m_Times[i], m_NumFrames);
+		fprintf(fp, "%s\n", (i < nphases - 1) ? "," : "");
+	}
+	fprintf(fp, "\t},\n");
+	fprintf(fp, "\t\"per_frame\": {\n");
+	fprintf(fp, "\t\t\"draw_calls\": %.1f,\n", c.Meshes / frames);
+	fprintf(fp, "\t\t\"primitives\": %.1f,\n", c.Prims / frames);
+	fprintf(fp, "\t\t\"vertices\": %.1f,\n", c.Verts / frames);
+	fprintf(fp, "\t\t\"indices\": %.1f,\n", c.Indices / frames);
+	fprintf(fp, "\t\t\"state_changes\": %.1f,\n", c.StateChanges / frames);
+	fprintf(fp, "\t\t\"matrix_changes\": %.1f,\n", c.MatrixChanges / frames);
+	fprintf(fp, "\t\t\"instance_batches\": %.1f,\n", c.Batches / frames);
+	fprintf(fp, "\t\t\"instanced_meshes\": %.1f,\n", c.Instances / frames);
+	fprintf(fp, "\t\t\"draw_calls_saved\": %.1f,\n", (c.Instances - c.Batches) / frames);
+	fprintf(fp, "\t\t\"constant_uploads\": %.1f,\n", c.ConstantUploads / frames);
+	fprintf(fp, "\t\t\"constant_bytes\": %.1f,\n", c.ConstantBytes / frames);
+	fprintf(fp, "\t\t\"bytes_submitted\": %.1f\n", c.Bytes / frames);
+	fprintf(fp, "\t},\n");
+	if (s_Batched)
+	{
+		const SceneOptimize::Stats& b = s_BatchStats;
+
+		fprintf(fp, "\t\"static_batching\": { \"shapes_before\": %d, \"shapes_after\": %d, \"chunks\": %d, \"kb_before\": %d, \"kb_after\": %d },\n",
+				b.ShapesBefore, b.ShapesAfter, b.Chunks, int(b.BytesBefore / 1024), int(b.BytesAfter / 1024));
+	}
+	if (m_RenderOptions & GeoSorter::RecordCommands)
+	{
+		RenderStream*	stream = m_Render->GetCommands();
+
+		fprintf(fp, "\t\"command_stream\": { \"words\": %d, \"commands\": %d, \"objects\": %d, ",
+				stream ? stream->GetSize() : 0, stream ? stream->GetNumCommands() : 0, stream ? stream->GetNumObjects() : 0);
+		fprintf(fp, "\"replays\": %d, \"replay_milliseconds\": %.4f, \"replay_draws\": %d, \"replay_matches\": %s",
+				m_Replays, m_Replays ? m_ReplayTime / m_Replays : 0.0, m_ReplayDraws, m_ReplayMatches ? "true" : "false");
+		if (m_DiffCommands)
+			fprintf(fp, ", \"first_difference\": %d", m_FirstDiff);
+		fprintf(fp, " },\n");
+	}
+	if (m_AnimMaterials)
+		fprintf(fp, "\t\"material_updates\": { \"materials\": %d, \"set_milliseconds_per_frame\": %.4f },\n",
+				m_NumMaterials, m_MaterialTime / m_NumFrames);
+	fprintf(fp, "\t\"profiler\": { \"zone_nanoseconds\": %.1f, \"zones_per_frame\": %.1f, \"milliseconds_per_frame\": %.4f },\n",
+			m_ZoneCost, m_ZoneEvents / m_NumFrames, m_ZoneCost * m_ZoneEvents / m_NumFrames / 1000000.0);
+	fprintf(fp, "\t\"memory_kb\": { \"after_load\": %d, \"peak\": %d }\n", m_LoadMemory, m_PeakMemory);
+	fprintf(fp, "}\n");
+}
+
+int SceneBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: scenebench [-frames n] [-warmup n] [-size w h] [-detail] [-noinstance] [-batch] [-clusterlights] [-materials] [-commands] [-replay n] [-savecommands file] [-diffcommands file] [-trace file] [-out file] file.vix|file.scp\n");
+		return 1;
+	}
+	if (!OnInit() || !MakeDisplay())
+		return BenchError("scenebench", "cannot initialize");
+	if (!LoadContent())
+		return 1;
+	RunFrames();
+	if (m_RenderOptions & GeoSorter::RecordCommands)
+		ReplayCommands();
+	if ((fp = BenchOpenReport("scenebench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	m_Scene = (Scene*) NULL;
+	OnExit();
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	SceneBench*	bench = new SceneBench;
+	int			rc;
+
+	bench->IncUse();
+	rc = bench->Main(argc, argv);
+	return rc;
+}
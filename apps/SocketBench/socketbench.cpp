@@ -0,0 +1,299 @@
+/*
+ * Socket arbitrator loopback benchmark.
+ *
+ * Opens a SocketArbitrator and connects a number of slave sockets to it
+ * over the loopback interface in the same process. A reader thread drains
+ * the slaves while the master sends a packet to every slave each frame,
+ * the way the Synchronizer distributes updates to a display wall.
+ * The time the master spends sending each frame is measured for an
+ * increasing number of slaves and written as JSON.
+ *
+ *	socketbench [options]
+ *		-slaves n		maximum number of slaves, doubled from 1 (default 16)
+ *		-slow n			number of slaves which never read (default 0)
+ *		-frames n		number of frames to measure (default 1000)
+ *		-packet n		bytes sent to each slave per frame (default 8192)
+ *		-interval ms	milliseconds between frames (default 1)
+ *		-resync			discard output for slow slaves instead of dropping them
+ *		-port n			port to listen on (default 6667)
+ *		-out file		write JSON results to file instead of stdout
+ *
+ * With the non-blocking arbitrator the master frame time depends only on
+ * the amount of data sent. Slow slaves are dropped or resynchronized
+ * instead of stalling the master.
+ */
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_MaxSlaves		SOCK_MaxClients
+
+/*
+ * Thread which reads and discards everything sent to the slaves.
+ */
+class SlaveReader : public Core::Thread
+{
+public:
+	SlaveReader() : Core::Thread(0), NumSlaves(0), DoExit(0) { }
+
+	static Core::ThreadFunc	ReadFunc;
+
+	SOCKET		Slaves[BENCH_MaxSlaves];	// slave sockets to read from
+	int			NumSlaves;					// number of slaves to read
+	vint32		DoExit;						// set to make thread exit
+};
+
+#if defined(_WIN32) && !defined(VX_PTHREAD)
+void SlaveReader::ReadFunc(void* arg)
+#else
+void* SlaveReader::ReadFunc(void* arg)
+#endif
+{
+	SlaveReader&	thread = *((SlaveReader*) arg);
+	char			buf[16 * 1024];
+
+	while (!thread.DoExit)
+	{
+		fd_set	input;
+		timeval	timeout;
+		SOCKET	maxfd = 0;
+
+		timeout.tv_sec = 0;
+		timeout.tv_usec = 10000;
+		FD_ZERO(&input);
+		for (int i = 0; i < thread.NumSlaves; ++i)
+		{
+			FD_SET(thread.Slaves[i], &input);
+			if (thread.Slaves[i] > maxfd)
+				maxfd = thread.Slaves[i];
+		}
+		if (select((int) maxfd + 1, &input, 0, 0, &timeout) <= 0)
+			continue;
+		for (int i = 0; i < thread.NumSlaves; ++i)
+			if (FD_ISSET(thread.Slaves[i], &input))
+				recv(thread.Slaves[i], buf, sizeof(buf), 0);
+	}
+	thread.Stop();
+#if !defined(_WIN32) || defined(VX_PTHREAD)
+	return NULL;
+#endif
+}
+
+/*!
+ * @class SocketBench
+ * @brief Measures the time a socket arbitrator takes to send to many slaves.
+ */
+class SocketBench
+{
+public:
+	SocketBench();
+	~SocketBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	/*
+	 * Results for one run with a given number of slaves
+	 */
+	struct Run
+	{
+		int		Slaves;		// number of slaves connected
+		int		Dropped;	// number of slaves dropped or resynced
+		float*	Times;		// milliseconds to send each frame
+	};
+
+	bool		ParseOptions(int argc, char** argv);
+	bool		RunSlaves(Run& run);
+	void		WriteReport(FILE* fp);
+	static void	Sleep(int ms);
+
+	int				m_MaxSlaves;
+	int				m_NumSlow;
+	int				m_NumFrames;
+	int				m_PacketSize;
+	int				m_Interval;
+	int				m_Port;
+	bool			m_Resync;
+	const char*		m_OutFile;
+	int				m_NumRuns;
+	Run				m_Runs[8];
+};
+
+SocketBench::SocketBench()
+{
+	m_MaxSlaves = 16;
+	m_NumSlow = 0;
+	m_NumFrames = 1000;
+	m_PacketSize = 8192;
+	m_Interval = 1;
+	m_Port = 6667;
+	m_Resync = false;
+	m_OutFile = NULL;
+	m_NumRuns = 0;
+	memset(m_Runs, 0, sizeof(m_Runs));
+}
+
+SocketBench::~SocketBench()
+{
+	for (int i = 0; i < m_NumRuns; ++i)
+		if (m_Runs[i].Times)
+			free(m_Runs[i].Times);
+}
+
+bool SocketBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-resync") == 0)
+			m_Resync = true;
+		else if (!BenchOption(argc, argv, i, "-slaves", m_MaxSlaves) &&
+				 !BenchOption(argc, argv, i, "-slow", m_NumSlow) &&
+				 !BenchOption(argc, argv, i, "-frames", m_NumFrames) &&
+				 !BenchOption(argc, argv, i, "-packet", m_PacketSize) &&
+				 !BenchOption(argc, argv, i, "-interval", m_Interval) &&
+				 !BenchOption(argc, argv, i, "-port", m_Port) &&
+				 !BenchOption(argc, argv, i, "-out", m_OutFile))
+			return false;
+	}
+	if ((m_MaxSlaves <= 0) || (m_MaxSlaves > BENCH_MaxSlaves) ||
+		(m_NumSlow < 0) || (m_NumFrames <= 0) || (m_PacketSize <= 0))
+		return false;
+	return true;
+}
+
+void SocketBench::Sleep(int ms)
+{
+	if (ms <= 0)
+		return;
+#ifdef _WIN32
+	::Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
+/*
+ * Connect the slaves to a new arbitrator and send a packet
+ * to all of them every frame, timing each frame.
+ */
+bool SocketBench::RunSlaves(Run& run)
+{
+	Core::SocketArbitrator	master(m_Port);
+	Core::Socket*			slaves[BENCH_MaxSlaves];
+	SlaveReader				reader;
+	int						connids[BENCH_MaxSlaves];
+	int						stalled[BENCH_MaxSlaves];
+	char*					packet = (char*) malloc(m_PacketSize);
+	int						nslaves = run.Slaves;
+	int						nslow = (m_NumSlow < nslaves) ? m_NumSlow : nslaves - 1;
+
+	if (packet == NULL)
+		return false;
+	memset(packet, 0, m_PacketSize);
+	memset(slaves, 0, sizeof(slaves));
+	master.SlowPolicy = m_Resync ? Core::SocketArbitrator::SLOW_RESYNC : Core::SocketArbitrator::SLOW_DROP;
+	if (!master.Open(NULL, Core::Stream::OPEN_RW))
+	{
+		fprintf(stderr, "socketbench: cannot listen on port %d\n", m_Port);
+		free(packet);
+		return false;
+	}
+	for (int i = 0; i < nslaves; ++i)
+	{
+		slaves[i] = new Core::Socket(m_Port);
+		if (!slaves[i]->Open("127.0.0.1", Core::Stream::OPEN_RW))
+		{
+			fprintf(stderr, "socketbench: slave %d cannot connect\n", i);
+			nslaves = i;
+			break;
+		}
+		if (i >= nslow)						// first slaves never read
+			reader.Slaves[reader.NumSlaves++] = (SOCKET) slaves[i]->GetHandle();
+	}
+	for (int tries = 0; (master.GetSize() < nslaves) && (tries < 100); ++tries)
+	{
+		master.IsEmpty();					// accept the slaves
+		Sleep(1);
+	}
+	reader.Run(&SlaveReader::ReadFunc);
+	run.Slaves = master.GetSize();
+	for (int f = 0; f < m_NumFrames; ++f)
+	{
+		int64	start = Core::Profiler::GetTicks();
+		int		n = master.GetSize();
+
+		*((int32*) packet) = f;
+		for (int i = 0; i < n; ++i)
+			connids[i] = i;
+		master.Select(connids, n);
+		for (int i = 0; i < n; ++i)
+			if (connids[i] >= 0)
+				master.SendConnection(master.GetAt(connids[i]), packet, m_PacketSize);
+		run.Dropped += master.GetStalled(stalled, BENCH_MaxSlaves);
+		run.Times[f] = BenchElapsed(start);
+		Sleep(m_Interval);
+	}
+	Core::InterlockSet(&(reader.DoExit), 1);
+	if (reader.IsRunning())
+		reader.GetDoneEvent()->Wait();
+	master.Close();
+	for (int i = 0; i < BENCH_MaxSlaves; ++i)
+		if (slaves[i])
+			delete slaves[i];
+	free(packet);
+	return true;
+}
+
+void SocketBench::WriteReport(FILE* fp)
+{
+	fprintf(fp, "{\n\t\"frames\": %d,\n\t\"packet_bytes\": %d,\n\t\"slow_slaves\": %d,\n\t\"policy\": \"%s\",\n",
+			m_NumFrames, m_PacketSize, m_NumSlow, m_Resync ? "resync" : "drop");
+	fprintf(fp, "\t\"runs\": [\n");
+	for (int r = 0; r < m_NumRuns; ++r)
+	{
+		Run&	run = m_Runs[r];
+
+		fprintf(fp, "\t\t{ \"slaves\": %d, \"stalled\": %d, ", run.Slaves, run.Dropped);
+		BenchWriteTimes(fp, "milliseconds", run.Times, m_NumFrames);
+		fprintf(fp, " }%s\n", (r < m_NumRuns - 1) ? "," : "");
+	}
+	fprintf(fp, "\t]\n}\n");
+}
+
+int SocketBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: socketbench [-slaves n] [-slow n] [-frames n] [-packet n] [-interval ms] [-resync] [-port n] [-out file]\n");
+		return 1;
+	}
+	for (int nslaves = 1; m_NumRuns < 8; nslaves *= 2)
+	{
+		Run&	run = m_Runs[m_NumRuns];
+
+		if (nslaves > m_MaxSlaves)
+			nslaves = m_MaxSlaves;
+		run.Slaves = nslaves;
+		run.Dropped = 0;
+		run.Times = (float*) calloc(m_NumFrames, sizeof(float));
+		if ((run.Times == NULL) || !RunSlaves(run))
+			return 1;
+		++m_NumRuns;
+		if (nslaves >= m_MaxSlaves)
+			break;
+	}
+	if ((fp = BenchOpenReport("socketbench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	SocketBench	bench;
+
+	return bench.Main(argc, argv);
+}
@@ -0,0 +1,271 @@
+/*
+ * Text label update benchmark.
+ *
+ * Makes a set of labels showing numbers, like the prices and timers
+ * on a dashboard, and changes the text of some of them each frame.
+ * The labels are made once as separate TextGeometry meshes and once
+ * as a single TextBatch using a glyph atlas. Only the CPU work of
+ * regenerating the glyphs is timed, nothing is drawn.
+ *
+ * Times and label updates per second are written as JSON.
+ *
+ *	textbench [options] font.txf
+ *		-labels n		number of labels (default 5000)
+ *		-updates n		number of labels changed each frame (default 500)
+ *		-frames n		number of frames to run (default 200)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_NumTests	2
+
+static const char* TestNames[BENCH_NumTests] = { "text_geometry", "text_batch" };
+
+/*
+ * TextGeometry which uses a font image that is already loaded.
+ */
+class BenchText : public TextGeometry
+{
+public:
+	void	SetFontImage(Texture* image)	{ m_FontImage = image; m_Font = NULL; }
+};
+
+/*!
+ * @class TextBench
+ * @brief Compares updating separate text meshes with a text batch.
+ */
+class TextBench : public World
+{
+public:
+	TextBench();
+	~TextBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	bool		ParseOptions(int argc, char** argv);
+	bool		LoadFont();
+	void		MakeText(int32 label, int frame, TCHAR* buf);
+	double		RunTextGeometry();
+	double		RunTextBatch();
+	void		WriteReport(FILE* fp);
+
+	int32		m_NumLabels;
+	int32		m_NumUpdates;
+	int32		m_NumFrames;
+	const char*	m_FontFile;
+	const char*	m_OutFile;
+	Ref<Texture>	m_FontImage;
+	Ref<TextBatch>	m_Batch;
+	double		m_Times[BENCH_NumTests];		// milliseconds to run all frames
+	int64		m_Draws[BENCH_NumTests];		// meshes which would be drawn
+	int64		m_Verts[BENCH_NumTests];		// vertices in the meshes
+};
+
+TextBench::TextBench() : World()
+{
+	m_NumLabels = 5000;
+	m_NumUpdates = 500;
+	m_NumFrames = 200;
+	m_FontFile = NULL;
+	m_OutFile = NULL;
+	memset(m_Times, 0, sizeof(m_Times));
+	memset(m_Draws, 0, sizeof(m_Draws));
+	memset(m_Verts, 0, sizeof(m_Verts));
+}
+
+TextBench::~TextBench()
+{
+	m_Batch = (TextBatch*) NULL;
+	m_FontImage = (Texture*) NULL;
+}
+
+bool TextBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (BenchOption(argc, argv, i, "-labels", m_NumLabels) ||
+			BenchOption(argc, argv, i, "-updates", m_NumUpdates) ||
+			BenchOption(argc, argv, i, "-frames", m_NumFrames) ||
+			BenchOption(argc, argv, i, "-out", m_OutFile))
+			continue;
+		if (*argv[i] == '-')
+			return false;
+		m_FontFile = argv[i];
+	}
+	if ((m_FontFile == NULL) || (m_NumLabels <= 0) || (m_NumFrames <= 0) ||
+		(m_NumUpdates <= 0) || (m_NumUpdates > m_NumLabels))
+		return false;
+	return true;
+}
+
+/*
+ * Load the font file with a blocking read into a texture
+ * which both kinds of text share.
+ */
+bool TextBench::LoadFont()
+{
+	Core::String		filename(m_FontFile);
+	Ref<Core::Stream>	stream = new Core::FileStream;
+	TexFont*			font = txfLoadFont(filename, stream);
+
+	stream->Close();
+	if (font == NULL)
+		return false;
+	m_FontImage = new Texture;
+	m_FontImage->SetBitmap(Bitmap::FONT, font);
+	return true;
+}
+
+/*
+ * Make the text for a label, alternating between prices and timers.
+ */
+void TextBench::MakeText(int32 label, int frame, TCHAR* buf)
+{
+	uint32	seed = (label * 2654435761u) ^ (frame * 40503u);
+
+	if (label & 1)
+		SPRINTF(buf, TEXT("%d.%02d"), int(seed % 10000), int((seed >> 16) % 100));
+	else
+		SPRINTF(buf, TEXT("%02d:%02d:%02d"), int((frame / 3600) % 24), int((frame / 60 + label) % 60), int((frame + label) % 60));
+}
+
+/*
+ * Update labels made as separate text meshes, return the elapsed milliseconds.
+ * Culling the text regenerates its glyphs as it would when the scene is displayed.
+ */
+double TextBench::RunTextGeometry()
+{
+	BenchText**	labels = (BenchText**) calloc(m_NumLabels, sizeof(BenchText*));
+	TCHAR		buf[64];
+	int64		start;
+	double		ms;
+	int32		next = 0;
+
+	for (int32 i = 0; i < m_NumLabels; ++i)
+	{
+		BenchText* text = new BenchText;
+
+		text->IncUse();
+		text->SetFontImage(m_FontImage);
+		text->SetTextBox(Box3(0, 0, 0, 1, 0.1f, 0));
+		MakeText(i, 0, buf);
+		text->SetText(buf);
+		text->Cull(NULL, NULL);
+		labels[i] = text;
+	}
+	start = Core::Profiler::GetTicks();
+	for (int f = 1; f <= m_NumFrames; ++f)
+		for (int32 u = 0; u < m_NumUpdates; ++u)
+		{
+			BenchText* text = labels[next];
+
+			MakeText(next, f, buf);
+			text->SetText(buf);
+			text->Cull(NULL, NULL);
+			if (++next >= m_NumLabels)
+				next = 0;
+		}
+	ms = BenchElapsed(start);
+	for (int32 i = 0; i < m_NumLabels; ++i)
+	{
+		m_Verts[0] += labels[i]->GetNumVtx();
+		labels[i]->Delete();
+	}
+	free(labels);
+	m_Draws[0] = m_NumLabels;
+	return ms;
+}
+
+/*
+ * Update labels in a single text batch, return the elapsed milliseconds.
+ */
+double TextBench::RunTextBatch()
+{
+	Ref<GlyphAtlas>	atlas = new GlyphAtlas;
+	TCHAR			buf[64];
+	int64			start;
+	int32			next = 0;
+
+	atlas->SetFont((TexFont*) m_FontImage->GetBitmap()->Data);
+	m_Batch = new TextBatch(atlas);
+	for (int32 i = 0; i < m_NumLabels; ++i)
+	{
+		MakeText(i, 0, buf);
+		m_Batch->AddLabel(buf, Vec3(float(i % 100), float(i / 100) * 0.2f, 0.0f), 0.1f);
+	}
+	m_Batch->Cull(NULL, NULL);
+	start = Core::Profiler::GetTicks();
+	for (int f = 1; f <= m_NumFrames; ++f)
+	{
+		for (int32 u = 0; u < m_NumUpdates; ++u)
+		{
+			MakeText(next, f, buf);
+			m_Batch->SetLabelText(next, buf);
+			if (++next >= m_NumLabels)
+				next = 0;
+		}
+		m_Batch->Cull(NULL, NULL);
+	}
+	m_Verts[1] = m_Batch->GetNumVtx();
+	m_Draws[1] = 1;
+	return BenchElapsed(start);
+}
+
+void TextBench::WriteReport(FILE* fp)
+{
+	double	updates = double(m_NumFrames) * m_NumUpdates;
+	GlyphAtlas* atlas = m_Batch->GetAtlas();
+
+	fprintf(fp, "{\n\t\"labels\": %d,\n\t\"updates_per_frame\": %d,\n\t\"frames\": %d,\n",
+			m_NumLabels, m_NumUpdates, m_NumFrames);
+	fprintf(fp, "\t\"tests\": [\n");
+	for (int t = 0; t < BENCH_NumTests; ++t)
+	{
+		double	ms = m_Times[t];
+
+		fprintf(fp, "\t\t{ \"name\": \"%s\", \"milliseconds\": %.4f, ", TestNames[t], ms);
+		fprintf(fp, "\"updates_per_second\": %.0f, ", (ms > 0) ? updates * 1000.0 / ms : 0.0);
+		fprintf(fp, "\"draw_calls\": %d, \"vertices\": %d }%s\n",
+				int(m_Draws[t]), int(m_Verts[t]), (t < BENCH_NumTests - 1) ? "," : "");
+	}
+	fprintf(fp, "\t],\n");
+	fprintf(fp, "\t\"speedup\": %.2f,\n", (m_Times[1] > 0) ? m_Times[0] / m_Times[1] : 0.0);
+	fprintf(fp, "\t\"atlas\": { \"glyphs\": %d, \"usage\": %.3f }\n", atlas->GetNumGlyphs(), atlas->GetUsage());
+	fprintf(fp, "}\n");
+}
+
+int TextBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: textbench [-labels n] [-updates n] [-frames n] [-out file] font.txf\n");
+		return 1;
+	}
+	if (!OnInit())
+		return BenchError("textbench", "cannot initialize");
+	if (!LoadFont())
+	{
+		fprintf(stderr, "textbench: cannot load font %s\n", m_FontFile);
+		return 1;
+	}
+	m_Times[0] = RunTextGeometry();
+	m_Times[1] = RunTextBatch();
+	if ((fp = BenchOpenReport("textbench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	TextBench*	bench = new TextBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
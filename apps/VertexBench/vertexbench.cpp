@@ -0,0 +1,326 @@
+/*
+ * Compact vertex format benchmark.
+ *
+ * Makes a sphere with locations, normals and texture coordinates
+ * stored as floats and converts it to compact vertex layouts:
+ * 16 bit locations, octahedral or 10:10:10:2 normals and half float
+ * texture coordinates. For each layout it measures the memory used,
+ * the time to copy all the vertex data (which is what uploading it
+ * costs), the time to decode every vertex on the CPU and the largest
+ * error introduced by the compact format. Nothing is drawn.
+ *
+ * Results are written as JSON.
+ *
+ *	vertexbench [options]
+ *		-verts n		approximate number of vertices (default 4000000)
+ *		-passes n		number of times each test is repeated (default 10)
+ *		-out file		write JSON results to file instead of stdout
+ */
+#include "vxbench.h"
+
+using namespace Vixen;
+
+#define	BENCH_NumTests	3
+
+static const char* TestNames[BENCH_NumTests] = { "float", "compact_oct", "compact_packed10" };
+static const int TestOptions[BENCH_NumTests] =
+	{ 0, VertexPool::COMPACT_ALL, VertexPool::COMPACT_ALL | VertexPool::COMPACT_PACKED };
+
+/*
+ * Results for one vertex layout
+ */
+struct VertexResult
+{
+	Core::String	Layout;		// layout descriptor
+	int32			VtxBytes;	// bytes per vertex
+	int64			Bytes;		// bytes for all vertices
+	double			ConvertMS;	// milliseconds to convert from float
+	double			CopyMS;		// milliseconds to copy all vertex data once
+	double			DecodeMS;	// milliseconds to decode all vertices once
+	double			BoundMS;	// milliseconds to compute the bounds once
+	double			LocError;	// largest location error
+	double			NormalError;	// largest normal error in degrees
+	double			UVError;	// largest texture coordinate error
+};
+
+/*!
+ * @class VertexBench
+ * @brief Compares float and compact vertex layouts.
+ */
+class VertexBench : public World
+{
+public:
+	VertexBench();
+	~VertexBench();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	bool		ParseOptions(int argc, char** argv);
+	void		MakeSphere();
+	bool		RunTest(int t);
+	double		TimeCopy(const VertexArray* verts);
+	double		TimeDecode(const VertexArray* verts);
+	double		TimeBound(const VertexArray* verts);
+	void		MeasureError(const VertexArray* verts, VertexResult& r);
+	void		WriteReport(FILE* fp);
+
+	int32		m_NumVerts;
+	int32		m_NumPasses;
+	const char*	m_OutFile;
+	Ref<VertexArray>	m_Source;
+	void*		m_CopyBuf;
+	double		m_Checksum;						// keeps decode loops from being optimized away
+	VertexResult	m_Results[BENCH_NumTests];
+};
+
+VertexBench::VertexBench() : World()
+{
+	m_NumVerts = 4000000;
+	m_NumPasses = 10;
+	m_OutFile = NULL;
+	m_CopyBuf = NULL;
+	m_Checksum = 0;
+	for (int t = 0; t < BENCH_NumTests; ++t)
+	{
+		VertexResult& r = m_Results[t];
+
+		r.VtxBytes = 0;
+		r.Bytes = 0;
+		r.ConvertMS = r.CopyMS = r.DecodeMS = r.BoundMS = 0;
+		r.LocError = r.NormalError = r.UVError = 0;
+	}
+}
+
+VertexBench::~VertexBench()
+{
+	m_Source = (VertexArray*) NULL;
+	if (m_CopyBuf)
+		free(m_CopyBuf);
+}
+
+bool VertexBench::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+		if (!BenchOption(argc, argv, i, "-verts", m_NumVerts) &&
+			!BenchOption(argc, argv, i, "-passes", m_NumPasses) &&
+			!BenchOption(argc, argv, i, "-out", m_OutFile))
+			return false;
+	return (m_NumVerts >= 4) && (m_NumPasses > 0);
+}
+
+/*
+ * Make a UV sphere of radius 100 centered away from the origin
+ * with float locations, normals and texture coordinates.
+ */
+void VertexBench::MakeSphere()
+{
+	int32	n = int32(sqrt(double(m_NumVerts)));
+	int32	rows = n;
+	int32	cols = m_NumVerts / n;
+	Vec3	center(1000, 50, -300);
+
+	m_Source = new VertexArray(TEXT("float3 position, float3 normal, float2 texcoord"), rows * cols);
+	for (int32 r = 0; r < rows; ++r)
+		for (int32 c = 0; c < cols; ++c)
+		{
+			float	u = float(c) / float(cols - 1);
+			float	v = float(r) / float(rows - 1);
+			float	theta = u * 2.0f * PI;
+			float	phi = v * PI;
+			Vec3	nml(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+			Vec3	loc(center + nml * 100.0f);
+			float	tmp[VertexPool::MAX_VTX_SIZE];
+			const DataLayout* layout = m_Source->GetLayout();
+
+			memset(tmp, 0, sizeof(tmp));
+			memcpy(tmp + layout->Slot[0].Offset, &loc.x, sizeof(Vec3));
+			memcpy(tmp + layout->Slot[1].Offset, &nml.x, sizeof(Vec3));
+			tmp[layout->Slot[2].Offset] = u;
+			tmp[layout->Slot[2].Offset + 1] = v;
+			m_Source->AddVertices(tmp, 1);
+		}
+	m_NumVerts = rows * cols;
+}
+
+/*
+ * Copy all the vertex data to a staging buffer as an upload would,
+ * return the milliseconds for one copy.
+ */
+double VertexBench::TimeCopy(const VertexArray* verts)
+{
+	size_t	bytes = size_t(verts->GetNumVtx()) * verts->GetVtxSize() * sizeof(float);
+	int64	start = Core::Profiler::GetTicks();
+	double	ms;
+
+	for (int p = 0; p < m_NumPasses; ++p)
+		memcpy(m_CopyBuf, verts->GetData(), bytes);
+	ms = BenchElapsed(start);
+	m_Checksum += ((const char*) m_CopyBuf)[bytes / 2];
+	return ms / m_NumPasses;
+}
+
+/*
+ * Decode the location, normal and texture coordinates of every vertex,
+ * return the milliseconds for one pass.
+ */
+double VertexBench::TimeDecode(const VertexArray* verts)
+{
+	int64	start = Core::Profiler::GetTicks();
+	double	sum = 0;
+	double	ms;
+
+	for (int p = 0; p < m_NumPasses; ++p)
+	{
+		VertexPool::DecodeIter	iter(verts);
+		Vec3					loc, nml;
+		Vec2					uv;
+
+		while (iter.Next())
+		{
+			iter.GetLoc(loc);
+			iter.GetNormal(nml);
+			iter.GetTexCoord(iter.GetIndex(), uv);
+			sum += loc.x + nml.y + uv.x;
+		}
+	}
+	ms = BenchElapsed(start);
+	m_Checksum += sum;
+	return ms / m_NumPasses;
+}
+
+double VertexBench::TimeBound(const VertexArray* verts)
+{
+	int64	start = Core::Profiler::GetTicks();
+	Box3	bound;
+	double	ms;
+
+	for (int p = 0; p < m_NumPasses; ++p)
+		verts->GetBound(&bound);
+	ms = BenchElapsed(start);
+	m_Checksum += bound.Width();
+	return ms / m_NumPasses;
+}
+
+/*
+ * Compare the decoded vertices with the float source.
+ */
+void VertexBench::MeasureError(const VertexArray* verts, VertexResult& r)
+{
+	VertexPool::DecodeIter	src(m_Source);
+	VertexPool::DecodeIter	dst(verts);
+	Vec3					sloc, dloc, snml, dnml;
+	Vec2					suv, duv;
+
+	while (src.Next() && dst.Next())
+	{
+		intptr	i = src.GetIndex();
+		double	d;
+
+		src.GetLoc(sloc);
+		dst.GetLoc(dloc);
+		d = sloc.Distance(dloc);
+		if (d > r.LocError)
+			r.LocError = d;
+		src.GetNormal(snml);
+		dst.GetNormal(dnml);
+		d = snml.Dot(dnml);
+		d = (d >= 1.0) ? 0.0 : acos(d) * 180.0 / PI;
+		if (d > r.NormalError)
+			r.NormalError = d;
+		src.GetTexCoord(i, suv);
+		dst.GetTexCoord(i, duv);
+		d = suv.Distance(duv);
+		if (d > r.UVError)
+			r.UVError = d;
+	}
+}
+
+bool VertexBench::RunTest(int t)
+{
+	VertexResult&		r = m_Results[t];
+	Ref<VertexArray>	verts = m_Source;
+
+	if (TestOptions[t])
+	{
+		Core::String	desc;
+		int64			start;
+
+		if (!VertexPool::MakeCompactLayout(desc, m_Source->GetLayout(), TestOptions[t]))
+			return false;
+		verts = new VertexArray(desc);
+		start = Core::Profiler::GetTicks();
+		if (!verts->Convert(m_Source))
+			return false;
+		r.ConvertMS = BenchElapsed(start);
+		MeasureError(verts, r);
+	}
+	r.Layout = verts->GetLayout()->Descriptor;
+	r.VtxBytes = verts->GetVtxSize() * sizeof(float);
+	r.Bytes = int64(verts->GetNumVtx()) * r.VtxBytes;
+	r.CopyMS = TimeCopy(verts);
+	r.DecodeMS = TimeDecode(verts);
+	r.BoundMS = TimeBound(verts);
+	return true;
+}
+
+void VertexBench::WriteReport(FILE* fp)
+{
+	const VertexResult& base = m_Results[0];
+
+	fprintf(fp, "{\n\t\"vertices\": %d,\n\t\"passes\": %d,\n", m_NumVerts, m_NumPasses);
+	fprintf(fp, "\t\"tests\": [\n");
+	for (int t = 0; t < BENCH_NumTests; ++t)
+	{
+		const VertexResult& r = m_Results[t];
+		double	gbps = (r.CopyMS > 0) ? (r.Bytes / (r.CopyMS * 1e6)) : 0.0;
+
+		fprintf(fp, "\t\t{ \"name\": \"%s\", \"layout\": \"%s\",\n", TestNames[t], (const char*) r.Layout);
+		fprintf(fp, "\t\t  \"bytes_per_vertex\": %d, \"megabytes\": %.2f, \"memory_ratio\": %.3f,\n",
+				r.VtxBytes, r.Bytes / (1024.0 * 1024.0), base.Bytes ? double(r.Bytes) / base.Bytes : 0.0);
+		fprintf(fp, "\t\t  \"convert_ms\": %.3f, \"copy_ms\": %.3f, \"copy_gb_per_second\": %.2f,\n",
+				r.ConvertMS, r.CopyMS, gbps);
+		fprintf(fp, "\t\t  \"decode_ms\": %.3f, \"bound_ms\": %.3f,\n", r.DecodeMS, r.BoundMS);
+		fprintf(fp, "\t\t  \"max_location_error\": %g, \"max_normal_error_degrees\": %g, \"max_texcoord_error\": %g }%s\n",
+				r.LocError, r.NormalError, r.UVError, (t < BENCH_NumTests - 1) ? "," : "");
+	}
+	fprintf(fp, "\t],\n");
+	fprintf(fp, "\t\"checksum\": %g\n", m_Checksum);
+	fprintf(fp, "}\n");
+}
+
+int VertexBench::Main(int argc, char** argv)
+{
+	FILE*	fp;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: vertexbench [-verts n] [-passes n] [-out file]\n");
+		return 1;
+	}
+	if (!OnInit())
+		return BenchError("vertexbench", "cannot initialize");
+	MakeSphere();
+	m_CopyBuf = malloc(size_t(m_NumVerts) * m_Source->GetVtxSize() * sizeof(float));
+	if (m_CopyBuf == NULL)
+		return BenchError("vertexbench", "out of memory");
+	for (int t = 0; t < BENCH_NumTests; ++t)
+		if (!RunTest(t))
+		{
+			fprintf(stderr, "vertexbench: cannot convert to %s\n", TestNames[t]);
+			return 1;
+		}
+	if ((fp = BenchOpenReport("vertexbench", m_OutFile)) == NULL)
+		return 1;
+	WriteReport(fp);
+	BenchCloseReport(fp);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	VertexBench*	bench = new VertexBench;
+
+	bench->IncUse();
+	return bench->Main(argc, argv);
+}
@@ -0,0 +1,218 @@
+/*
+ * Converts a Vixen content file (.vix) to a chunked scene file (.vxz).
+ *
+ * The file is loaded and saved again with a ChunkMessenger.
+ * Each named child of the scene graph root and of the simulation
+ * root is saved as a separate subtree so it can be loaded by name
+ * without loading the rest of the file. The scene itself is saved
+ * last and refers to the subtrees saved before it.
+ *
+ *	vixchunk [options] file.vix file.vxz
+ *		-chunk bytes	uncompressed chunk size (default 262144)
+ *		-quiet			do not list the subtrees
+ */
+#include "vixen.h"
+
+using namespace Vixen;
+
+/*!
+ * @class VixChunk
+ * @brief Console world which converts .vix files to chunked .vxz files.
+ */
+class VixChunk : public World3D
+{
+public:
+	VixChunk();
+
+	int			Main(int argc, char** argv);
+
+protected:
+	bool		ParseOptions(int argc, char** argv);
+	bool		LoadFile();
+	bool		SaveFile();
+	int			SaveChildren(ChunkMessenger& out, const Group* root);
+	bool		SaveSubtree(ChunkMessenger& out, const SharedObj* obj, const TCHAR* name);
+
+	const char*			m_InFile;
+	const char*			m_OutFile;
+	bool				m_Quiet;
+	TCHAR				m_FileBase[VX_MaxPath];
+	FileMessenger		m_Input;
+	Ref<Scene>			m_InScene;
+	Ref<Model>			m_Root;
+	Ref<Engine>			m_SimRoot;
+};
+
+VixChunk::VixChunk() : World3D()
+{
+	m_InFile = NULL;
+	m_OutFile = NULL;
+	m_Quiet = false;
+	m_FileBase[0] = 0;
+	DoAsyncLoad = false;
+}
+
+bool VixChunk::ParseOptions(int argc, char** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+
+		if ((strcmp(arg, "-chunk") == 0) && (i + 1 < argc))
+			ChunkMessenger::ChunkSize = atoi(argv[++i]);
+		else if (strcmp(arg, "-quiet") == 0)
+			m_Quiet = true;
+		else if (*arg == '-')
+			return false;
+		else if (m_InFile == NULL)
+			m_InFile = arg;
+		else
+			m_OutFile = arg;
+	}
+	if ((m_InFile == NULL) || (m_OutFile == NULL) || (ChunkMessenger::ChunkSize <= 0))
+		return false;
+	return true;
+}
+
+/*
+ * Load the .vix file and find the scene, scene graph root and
+ * simulation root by the names the exporters give them.
+ */
+bool VixChunk::LoadFile()
+{
+	Core::String		filename(m_InFile);
+	Core::FileStream*	instream = new Core::FileStream;
+	TCHAR				dir[VX_MaxPath];
+	TCHAR				name[VX_MaxPath];
+
+	instream->ParseDirectory(filename, m_FileBase, dir);
+	instream->SetDirectory(dir);
+	if (!instream->Open(filename, Core::Stream::OPEN_READ))
+	{
+		delete instream;
+		VX_ERROR(("vixchunk: cannot open %s\n", m_InFile), false);
+	}
+	m_Input.SetInStream(instream);
+	if (!m_Input.Load())
+		VX_ERROR(("vixchunk: cannot load %s\n", m_InFile), false);
+	STRCPY(name, m_FileBase);
+	STRCAT(name, TEXT(".scene"));
+	m_InScene = (Scene*) (SharedObj*) m_Input.Find(name);
+	if (m_InScene.IsNull() || !m_InScene->IsClass(VX_Scene))
+	{
+		m_InScene = (Scene*) NULL;
+		STRCPY(name, m_FileBase);
+		STRCAT(name, TEXT(".root"));
+		m_Root = (Model*) m_Input.Find(name);
+		STRCPY(name, m_FileBase);
+		STRCAT(name, TEXT(".simroot"));
+		m_SimRoot = (Engine*) m_Input.Find(name);
+	}
+	else
+	{
+		m_Root = m_InScene->GetModels();
+		m_SimRoot = m_InScene->GetEngines();
+	}
+	if (m_Root.IsNull() && m_SimRoot.IsNull())
+		VX_ERROR(("vixchunk: %s has no scene root\n", m_InFile), false);
+	return true;
+}
+
+/*
+ * Save one object and everything it references that has
+ * not already been saved as a named subtree.
+ */
+bool VixChunk::SaveSubtree(ChunkMessenger& out, const SharedObj* obj, const TCHAR* name)
+{
+	int32 first = out.GetNumChunks();
+
+	if (!out.BeginSubtree(name))
+		return false;
+	obj->Save(out, 0);
+	out.EndSubtree();
+	if (!m_Quiet)
+		printf("%s\t%d chunks\n", (const char*) Core::String(name), out.GetNumChunks() - first);
+	return true;
+}
+
+/*
+ * Save each named child of a hierarchy root as its own subtree.
+ * Returns the number of subtrees saved.
+ */
+int VixChunk::SaveChildren(ChunkMessenger& out, const Group* root)
+{
+	int n = 0;
+
+	if (root == NULL)
+		return 0;
+	for (int i = 0; i < root->GetSize(); ++i)
+	{
+		const Group*	child = root->GetAt(i);
+		const TCHAR*	name = child->GetName();
+
+		if (name && *name && SaveSubtree(out, child, name))
+			++n;
+	}
+	return n;
+}
+
+/*
+ * Save the subtrees first, then the roots and the scene which refer to them.
+ */
+bool VixChunk::SaveFile()
+{
+	ChunkMessenger	out;
+	Core::String	outname(m_OutFile);
+	int				n;
+
+	if (!out.Open(outname, Core::Stream::OPEN_WRITE))
+		VX_ERROR(("vixchunk: cannot write %s\n", m_OutFile), false);
+	n = SaveChildren(out, m_Root);
+	n += SaveChildren(out, m_SimRoot);
+	if (!m_InScene.IsNull())
+		SaveSubtree(out, m_InScene, m_InScene->GetName());
+	else
+	{
+		if (!m_Root.IsNull() && m_Root->GetName())
+			SaveSubtree(out, m_Root, m_Root->GetName());
+		if (!m_SimRoot.IsNull() && m_SimRoot->GetName())
+			SaveSubtree(out, m_SimRoot, m_SimRoot->GetName());
+	}
+	if (!out.Close())
+		VX_ERROR(("vixchunk: error writing %s\n", m_OutFile), false);
+	if (!m_Quiet)
+		printf("%d subtrees in %d chunks\n", n, out.GetNumChunks());
+	return true;
+}
+
+int VixChunk::Main(int argc, char** argv)
+{
+	int rc = 0;
+
+	if (!ParseOptions(argc, argv))
+	{
+		fprintf(stderr, "usage: vixchunk [-chunk bytes] [-quiet] file.vix file.vxz\n");
+		return 1;
+	}
+	if (!OnInit())
+	{
+		fprintf(stderr, "vixchunk: cannot initialize\n");
+		return 1;
+	}
+	if (!LoadFile() || !SaveFile())
+		rc = 1;
+	m_Input.Close();
+	m_InScene = (Scene*) NULL;
+	m_Root = (Model*) NULL;
+	m_SimRoot = (Engine*) NULL;
+	OnExit();
+	return rc;
+}
+
+int main(int argc, char** argv)
+{
+	VixChunk*	conv = new VixChunk;
+
+	conv->IncUse();
+	return conv->Main(argc, argv);
+}
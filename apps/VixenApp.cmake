@@ -0,0 +1,57 @@
+##############################################################
+# Settings shared by the console applications and tests.
+# Include this file from the application CMakeLists.txt and
+# call VIXEN_APP with the name of the program:
+#
+#	INCLUDE(${CMAKE_CURRENT_SOURCE_DIR}/../VixenApp.cmake)
+#	VIXEN_APP(textbench)
+#
+# The program is built from the source file of the same name.
+# Paths are relative to this file so it can be included from
+# any directory. Headers in this directory, like vxbench.h,
+# can be included by the programs.
+##############################################################
+
+SET(USE_INTEL_COMPILER 1 CACHE BOOL "Set to 1 to use the Intel Compiler")
+SET(CMAKE_VERBOSE_MAKEFILE false)
+
+IF(COMMAND cmake_policy)
+  CMAKE_POLICY(SET CMP0003 NEW)
+ENDIF(COMMAND cmake_policy)
+
+ADD_DEFINITIONS(-DVIXEN_OGL)
+
+##############################################################
+# Compiler
+##############################################################
+
+IF (USE_INTEL_COMPILER)
+
+SET (CMAKE_CXX_COMPILER "/opt/intel/composerxe/bin/icpc")
+SET (CMAKE_C_COMPILER "/opt/intel/composerxe/bin/icc")
+SET (CMAKE_CXX_FLAGS "-fPIC -fstrict-aliasing -fp-model fast ${SSE_FLAGS}")
+#SET (CMAKE_CXX_FLAGS "-fPIC -g -D_DEBUG -fstrict-aliasing -fp-model fast ${SSE_FLAGS}")
+#-Wall
+SET (CMAKE_CXX_FLAGS_DEBUG "-DDEBUG -g -O0")
+SET (CMAKE_CXX_FLAGS_RELEASE "-DNDEBUG -g -O2")
+SET (CMAKE_EXE_LINKER_FLAGS "")
+
+ELSE (USE_INTEL_COMPILER)
+
+SET (CMAKE_CXX_COMPILER "g++")
+SET (CMAKE_C_COMPILER "gcc")
+SET (CMAKE_CXX_FLAGS "-fPIC -fstrict-aliasing -ffast-math ${SSE_FLAGS}")
+#-Wall
+SET (CMAKE_CXX_FLAGS_DEBUG "-DDEBUG -g -O0 -ftree-ter")
+SET (CMAKE_CXX_FLAGS_RELEASE "-DNDEBUG -g -O2")
+SET (CMAKE_EXE_LINKER_FLAGS "")
+ENDIF (USE_INTEL_COMPILER)
+
+GET_FILENAME_COMPONENT(VIXEN_APPS_DIR ${CMAKE_CURRENT_LIST_FILE} PATH)
+INCLUDE_DIRECTORIES(${VIXEN_APPS_DIR}/../inc ${VIXEN_APPS_DIR})
+LINK_DIRECTORIES(${VIXEN_APPS_DIR}/../opt)
+
+MACRO(VIXEN_APP name)
+  ADD_EXECUTABLE(${name} ${name})
+  TARGET_LINK_LIBRARIES(${name} VixenGL GL GLU glib-2.0 freeimage)
+ENDMACRO(VIXEN_APP)
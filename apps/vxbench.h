@@ -0,0 +1,172 @@
+/*!
+ * @file vxbench.h
+ * @brief Option parsing, timing statistics and reports shared by the benchmarks.
+ *
+ * Each benchmark is a console program which parses its options,
+ * initializes Vixen, runs its measurements and writes the results
+ * as JSON to standard output or to the file given with \b -out.
+ * The helpers here do the parts which are the same in all of them.
+ *
+ * @code
+ *	for (int i = 1; i < argc; ++i)
+ *		if (!BenchOption(argc, argv, i, "-frames", m_NumFrames) &&
+ *			!BenchOption(argc, argv, i, "-out", m_OutFile))
+ *			return false;
+ *	...
+ *	if ((fp = BenchOpenReport("mybench", m_OutFile)) == NULL)
+ *		return 1;
+ *	BenchWriteTimes(fp, "milliseconds", m_Times, m_NumFrames);
+ *	BenchCloseReport(fp);
+ * @endcode
+ */
+#pragma once
+
+#include "vixen.h"
+
+/*!
+ * Statistics for a set of times in milliseconds.
+ * @see BenchGetStats
+ */
+struct BenchStats
+{
+	float	Mean;	//!< average time
+	float	Min;	//!< shortest time
+	float	P50;	//!< median
+	float	P90;	//!< 90th percentile
+	float	P99;	//!< 99th percentile
+	float	Max;	//!< longest time
+};
+
+/*
+ * Parses an option with a numeric value. If argument \b i is the named
+ * option and is followed by a value, stores the value, skips past it
+ * and returns true.
+ */
+template <class T> static inline bool BenchOption(int argc, char** argv, int& i, const char* name, T& value)
+{
+	if ((strcmp(argv[i], name) != 0) || (i + 1 >= argc))
+		return false;
+	value = (T) atof(argv[++i]);
+	return true;
+}
+
+/*
+ * Parses an option with a string value, usually a file name.
+ */
+static inline bool BenchOption(int argc, char** argv, int& i, const char* name, const char*& value)
+{
+	if ((strcmp(argv[i], name) != 0) || (i + 1 >= argc))
+		return false;
+	value = argv[++i];
+	return true;
+}
+
+/*
+ * Returns the milliseconds elapsed since a time from Core::Profiler::GetTicks.
+ */
+static inline float BenchElapsed(int64 start)
+{
+	return float((Core::Profiler::GetTicks() - start) * 1000.0 / Core::Profiler::GetTickRate());
+}
+
+/*
+ * Orders times for qsort.
+ */
+static inline int BenchCompareTimes(const void* p1, const void* p2)
+{
+	float t1 = *((const float*) p1);
+	float t2 = *((const float*) p2);
+
+	return (t1 < t2) ? -1 : ((t1 > t2) ? 1 : 0);
+}
+
+/*
+ * Computes the mean, extremes and percentiles of a set of times.
+ * The times are sorted in place.
+ */
+static inline void BenchGetStats(float* times, int n, BenchStats& stats)
+{
+	double	total = 0.0;
+
+	memset(&stats, 0, sizeof(stats));
+	if (n <= 0)
+		return;
+	qsort(times, n, sizeof(float), &BenchCompareTimes);
+	for (int i = 0; i < n; ++i)
+		total += times[i];
+	stats.Mean = float(total / n);
+	stats.Min = times[0];
+	stats.P50 = times[(n - 1) * 50 / 100];
+	stats.P90 = times[(n - 1) * 90 / 100];
+	stats.P99 = times[(n - 1) * 99 / 100];
+	stats.Max = times[n - 1];
+}
+
+/*
+ * Writes time statistics as a named JSON object,
+ * without a trailing comma or newline.
+ */
+static inline void BenchWriteStats(FILE* fp, const char* name, const BenchStats& s)
+{
+	fprintf(fp, "\"%s\": { \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+			name, s.Mean, s.Min, s.P50, s.P90, s.P99, s.Max);
+}
+
+/*
+ * Writes the statistics for a set of times as a named JSON object,
+ * without a trailing comma or newline. The times are sorted in place.
+ */
+static inline void BenchWriteTimes(FILE* fp, const char* name, float* times, int n)
+{
+	BenchStats	s;
+
+	BenchGetStats(times, n, s);
+	BenchWriteStats(fp, name, s);
+}
+
+/*
+ * Writes a string as a JSON string value, quotes included.
+ */
+static inline void BenchWriteString(FILE* fp, const char* str)
+{
+	fputc('"', fp);
+	for (const char* p = str; *p; ++p)
+	{
+		if ((*p == '\\') || (*p == '"'))
+			fputc('\\', fp);
+		fputc(*p, fp);
+	}
+	fputc('"', fp);
+}
+
+/*
+ * Opens the file the report is written to, standard output if no
+ * file was given. Prints an error and returns NULL if the file cannot
+ * be written.
+ */
+static inline FILE* BenchOpenReport(const char* prog, const char* filename)
+{
+	FILE*	fp;
+
+	if (filename == NULL)
+		return stdout;
+	if ((fp = fopen(filename, "w")) == NULL)
+		fprintf(stderr, "%s: cannot write %s\n", prog, filename);
+	return fp;
+}
+
+static inline void BenchCloseReport(FILE* fp)
+{
+	if (fp && (fp != stdout))
+		fclose(fp);
+}
+
+/*
+ * Prints an error message prefixed with the program name
+ * and returns 1, to be returned from main.
+ */
+static inline int BenchError(const char* prog, const char* msg)
+{
+	fprintf(stderr, "%s: %s\n", prog, msg);
+	return 1;
+}
@@ -9,7 +9,6 @@ uniform mat4	ViewProjMatrix;
 uniform	vec3	CameraPos;
 uniform	vec2	ImageSize;
 uniform int		NumLights;
-uniform int		LightsEnabled[16];
 
 struct Radiance
 {
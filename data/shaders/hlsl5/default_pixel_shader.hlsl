@@ -4,21 +4,16 @@ float4 _$SURFACESHADER(in VertexOutput v) : SV_Target0
 {
 	Surface		s;
 	float3		color;
-	int			enabled = LightsEnabled;
-	int			nlights = NumLights;
-	int			i;
+	uint		nlights = LightCount;
+	uint		i;
 
 	s = SurfaceColor.ComputeColor(v);
 	color = float3(0, 0, 0);
 	for (i = 0; i < nlights; ++i)
-	{ 
-		if ((enabled & 0x80000000) != 0)
-		{
-			Radiance r;
-			r = LightList[i].Illuminate(s);
-			color += SurfaceColor.ApplyLight(s, r);
-		}
-		enabled = enabled << 1;
+	{
+		Radiance r;
+		r = LightList[LightIndex[i >> 2][i & 3]].Illuminate(s);
+		color += SurfaceColor.ApplyLight(s, r);
 	}
 	return float4(color, 1.0);
 }
\ No newline at end of file
@@ -6,13 +6,16 @@ cbuffer PerFrameConstants : register(b0)
 	float4x4	ProjMatrix;
 	float4		CameraPos;
 	uint		NumLights;
-	int			LightsEnabled;
+	int			Pad;
 	uint2		ImageSize;
 };
 
 cbuffer PerObjectConstants : register(b1)
 {
 	matrix WorldMatrix;
+	uint		LightCount;		// number of lights which illuminate the object
+	uint3		LightPad;
+	uint4		LightIndex[4];	// LightList indices of the lights, four per register (LIGHT_MaxLights / 4)
 };
 
 
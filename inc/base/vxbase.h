@@ -29,6 +29,7 @@ namespace Vixen
 #include "base/vxarray.inl"
 #include "base/vxevent.h"
 #include "base/vxevent.inl"
+#include "base/vxevbus.h"
 #include "base/vxobj.inl"
 #include "base/vxmess.inl"
 #include "base/vxweakref.inl"
@@ -37,6 +38,7 @@ namespace Vixen
 #include "base/vxworld.h"
 #include "base/vxbitmap.h"
 #include "base/vxmath.h"
+#include "base/vxmat4.h"
 #include "base/vxmatrix.h"
 #include "base/vxmath.inl"
 #include "base/vxmatrix.inl"
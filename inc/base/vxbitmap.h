@@ -93,6 +93,9 @@ public:
 //! Garbage collects the bitmap pixel data area.
 	void			Kill();
 
+//! Charge the size of the pixel data area to bitmap memory.
+	void			UpdateMemStats();
+
 //! Read pixels from bitmap file using given stream.
 	static	bool	ReadFile(const TCHAR* filename, Core::Stream* stream, LoadEvent* e);
 
@@ -164,6 +167,7 @@ public:
 	mutable intptr	DevHandle;
 
 protected:
+	intptr			m_MemCharged;	// bitmap bytes charged to Core::MemStats
 	static	vint32	IsInitialized;
 };
 
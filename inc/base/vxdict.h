@@ -110,13 +110,12 @@ namespace Core
 {
 template <> inline bool Dict<NameProp, ObjRef, Vixen::BaseDict>::CompareKeys(const NameProp& knew, const NameProp& kdict)
 {
-//	return STRCASECMP(knew, kdict) == 0;
-	return String(knew).CompareNoCase(kdict) == 0;
+	return knew.IsSame(kdict);
 }
 
 template <> inline uint32 Dict<NameProp, ObjRef, Vixen::BaseDict>::HashKey(const NameProp& np) const
 {
-	return HashStr((const TCHAR*) np);
+	return np.GetHash();
 }
 
 }
@@ -142,6 +141,8 @@ public:
 	ITEM*			FindWild(const TCHAR* name) const;
 // find single entry with exact match
 	ITEM*			Find(const TCHAR* name) const;
+// find single entry with the given name atom
+	ITEM*			Find(Core::Atom atom) const;
 // Find multiple entries using wildcard match.
 	Array<ITEM>*	FindAll(const TCHAR* name) const;
 };
@@ -107,12 +107,32 @@ template <class ITEM> ITEM* NameDict<ITEM>::FindWild(const TCHAR* name) const
  * Finds the value associated with the given string.
  * This is the fastest way to access values but will only
  * perform an exact match on the string name.
+ * The name is looked up in the atom table but not added to it.
+ * If it has never been interned, no entry can have that name.
  *
- * @see NameDict::FindWild Dictionary::Find
+ * @see NameDict::FindWild Dictionary::Find Core::AtomTable::Find
  */
 template <class ITEM> inline ITEM* NameDict<ITEM>::Find(const TCHAR* name) const
 {
-	NameProp	np(name);
+	return Find(Core::AtomTable::Find(name));
+}
+
+/**
+ * @fn ITEM* NameDict::Find(Core::Atom atom) const
+ *
+ * Finds the value associated with the name for the given atom.
+ * Callers which look up the same name repeatedly can intern it once
+ * and avoid hashing and comparing the string each time.
+ *
+ * @see NameDict::Find Core::AtomTable::Intern
+ */
+template <class ITEM> inline ITEM* NameDict<ITEM>::Find(Core::Atom atom) const
+{
+	NameProp	np;
+
+	if (atom == 0)
+		return NULL;
+	np.SetAtom(atom);
 	return Dictionary<NameProp, ITEM>::Find(np);
 }
 
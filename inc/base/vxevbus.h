@@ -0,0 +1,149 @@
+/*!
+ * @file vxevbus.h
+ * @brief In-process event dispatch without serialization.
+ *
+ * The event bus delivers events to the observers in the same process
+ * directly from the event objects instead of writing them to the
+ * messenger stream and parsing them back. Observers are indexed by
+ * event code and sender so an event only visits the observers
+ * which want it. Events which cross threads are copied into pooled
+ * events and passed through lock-free mailboxes.
+ *
+ * @author Nola Donato
+ * @ingroup vixen
+ *
+ * @see vxmess.h vxevent.h
+ */
+#pragma once
+
+namespace Vixen {
+
+#define	EVBUS_MaxMailboxes	8		// most mailboxes one event is forwarded to
+
+/*!
+ * @class EventBus
+ * @brief Dispatches events to local observers indexed by code and sender.
+ *
+ * Each event code has its own table of observers. Observers of any sender
+ * come first, the others are sorted by sender so the ones for a given
+ * sender are found by binary search. Observers of code 0 get every event.
+ * The tables are copy on write: observing or ignoring builds a new table
+ * and the old one is freed when no thread is dispatching, so dispatching
+ * never takes a lock.
+ *
+ * An observer may name a mailbox. EventBus::Dispatch only calls the
+ * observers of the mailbox it is given (NULL for observers without one)
+ * and forwards a copy of the event to each of the other mailboxes,
+ * which calls their observers when the thread which owns it
+ * calls EventBus::Mailbox::Deliver.
+ *
+ * The copies come from a pool of events for each code made by World::MakeEvent.
+ * EventBus::Post copies an event into the bus's own mailbox, which
+ * is delivered by EventBus::Deliver. The messenger posts the events logged
+ * to it this way unless they must be sent to remote processors,
+ * so local events are never serialized.
+ *
+ * @see Messenger::Observe Messenger::DirectEvents Event SharedObj::OnEvent
+ */
+class EventBus : public SharedObj
+{
+public:
+	VX_DECLARE_CLASS(EventBus);
+
+	/*!
+	 * @brief Queue of events to be dispatched by one thread.
+	 *
+	 * Any number of threads may put events into a mailbox.
+	 * Only the thread which owns it may deliver them.
+	 * Events are delivered in the order they were put.
+	 */
+	class Mailbox : public SharedObj
+	{
+		friend class EventBus;
+	public:
+		Mailbox(EventBus* bus = NULL);
+		~Mailbox();
+
+		void		Put(Event* ev);		//!< Add a pooled event to the mailbox.
+		int			Deliver();			//!< Dispatch all the events in the mailbox.
+		bool		IsEmpty() const;	//!< Return \b true if no events are waiting.
+
+	protected:
+		Event*		TakeAll();
+
+		EventBus*		m_Bus;			// bus which owns the events
+		Event* volatile	m_Head;			// events waiting, most recent first
+	};
+
+	EventBus();
+	~EventBus();
+
+	//! Observe events based on code, sender and mailbox.
+	bool		Observe(const SharedObj* target, int code, const SharedObj* sender, Mailbox* box = NULL);
+
+	//! Ignore events based on code and sender.
+	bool		Ignore(const SharedObj* target, int code, const SharedObj* sender);
+
+	//! Return \b true if an event with this code and sender would be observed.
+	bool		IsObserved(int code, const SharedObj* sender = NULL) const;
+
+	//! Dispatch an event to the observers of a mailbox now.
+	int			Dispatch(const Event& ev, Mailbox* box = NULL);
+
+	//! Copy an event to be dispatched by EventBus::Deliver.
+	bool		Post(const Event& ev);
+
+	//! Dispatch the posted events.
+	int			Deliver();
+
+	//! Return an empty event for a code from the pool.
+	Event*		NewEvent(int code);
+
+	//! Return an event obtained from EventBus::NewEvent to the pool.
+	void		FreeEvent(Event* ev);
+
+protected:
+	/*
+	 * Observer of an event code
+	 */
+	struct Entry
+	{
+		SharedObj*			Target;		// object observing
+		const SharedObj*	Sender;		// object observed, NULL for any sender
+		Mailbox*			Box;		// mailbox events are delivered to, NULL for none
+	};
+
+	/*
+	 * Observers of one event code. Entries for any sender come first,
+	 * the rest are sorted by sender.
+	 */
+	struct Table
+	{
+		Table*		NextRetired;		// next table waiting to be freed
+		int32		NumAny;				// number of entries for any sender
+		int32		NumEntries;			// total number of entries
+		Entry		Entries[1];
+	};
+
+	Event*		CopyEvent(const Event& src);
+	bool		Replace(int code, Table* table);
+	int			Visit(const Table* table, const Event& ev, Mailbox* box, Mailbox** boxes, int& nboxes);
+	void		Collect();
+	static Table*	MakeTable(int32 n);
+	static void		FreeTable(Table* table);
+	static int		CompareEntries(const void* p1, const void* p2);
+
+	Table* volatile	m_Tables[Event::MAX_CODE];	// observers of each code
+	Event*			m_Free[Event::MAX_CODE];	// pooled events for each code
+	Event*			m_Blank[Event::MAX_CODE];	// empty event of each code to reset pooled ones
+	Table*			m_Retired;					// old tables waiting to be freed
+	vint32			m_TableLock;				// guards changes to the tables
+	vint32			m_PoolLock;					// guards the event pool
+	vint32			m_Dispatching;				// number of threads dispatching
+	Ref<Mailbox>	m_Posted;					// events posted to the bus
+};
+
+inline bool EventBus::Mailbox::IsEmpty() const
+{ return m_Head == NULL; }
+
+} // end Vixen
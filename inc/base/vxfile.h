@@ -48,4 +48,150 @@ public:
 	Messenger&	OutObj(const SharedObj* obj);
 };
 
+#define	CHUNK_Magic			0x4B435856		// "VXCK" at start of chunked files
+#define	CHUNK_Version		1				// chunked file format version
+#define	CHUNK_MaxThreads	16				// most threads used to decompress chunks
+
+/*!
+ * @class ChunkMessenger
+ * @brief Loads or saves Vixen content in a chunked, compressed container.
+ *
+ * A chunked scene file (.vxz) holds the same Vixen binary protocol as a
+ * .vix file split into chunks which are compressed independently
+ * with Core::Compressor. A directory at the start of the file lists the
+ * chunks and the named subtrees they contain. Each chunk records the earlier
+ * chunks which create objects it refers to.
+ *
+ * Because chunks are independent, they can be decompressed in parallel.
+ * ChunkMessenger::Load decompresses all the chunks using up to
+ * ChunkMessenger::NumThreads threads and executes them in file order.
+ * ChunkMessenger::LoadSubtree only reads the chunks needed to make one named
+ * subtree, so an application can get at part of a large scene without
+ * loading all of it.
+ *
+ * To make a chunked file, open the messenger for writing and save each
+ * subtree between ChunkMessenger::BeginSubtree and ChunkMessenger::EndSubtree.
+ * The objects which contain the subtrees should be saved last.
+ * The \b vixchunk tool converts .vix files this way.
+ *
+ * File layout (32 bit words unless noted):
+ * @code
+ *	CHUNK_Magic CHUNK_Version <#chunks> <#subtrees> <directory bytes> 0
+ *	for each chunk:		<offset> <packed size> <raw size> <#deps> <dep chunk>...
+ *	for each subtree:	<first chunk> <#chunks> <name string>
+ *	compressed chunk data
+ * @endcode
+ * Chunk 0 holds the protocol version commands and is loaded first.
+ *
+ * @code
+ *	ChunkMessenger	file;
+ *	Core::FileStream* stream = new Core::FileStream;
+ *	stream->Open(TEXT("city.vxz"), Core::Stream::OPEN_READ);
+ *	file.SetInStream(stream);
+ *	Model* block = (Model*) file.LoadSubtree(TEXT("city.block12"));
+ * @endcode
+ *
+ * @ingroup vixen
+ * @see FileMessenger Core::Compressor SceneLoader::OpenScene
+ */
+class ChunkMessenger : public FileMessenger
+{
+public:
+	VX_DECLARE_CLASS(ChunkMessenger);
+	ChunkMessenger(const TCHAR* filename = NULL);
+	~ChunkMessenger();
+
+	bool			Open(const TCHAR* name, int mode = Core::Stream::OPEN_RW);
+	bool			Close();
+	bool			Load();
+	int				Attach(const SharedObj*, int flags = 0);
+	Messenger&		OutObj(const SharedObj* obj);
+	Messenger&		OutOp(const VXOpcode&);
+	bool			IsEmpty() const;
+	size_t			Read(char*, int);
+	size_t			Write(const char*, int);
+
+//! Load the chunks needed for a named subtree and return its root.
+	SharedObj*		LoadSubtree(const TCHAR* name);
+//! Start saving a named subtree in new chunks.
+	bool			BeginSubtree(const TCHAR* name);
+//! Finish saving a named subtree.
+	void			EndSubtree();
+//! Read the chunk directory from the input stream.
+	bool			ReadDirectory();
+//! Get number of chunks in the file.
+	int32			GetNumChunks() const		{ return m_NumChunks; }
+//! Get number of named subtrees in the file.
+	int32			GetNumSubtrees() const		{ return m_NumSubtrees; }
+//! Get the name of a subtree.
+	const TCHAR*	GetSubtreeName(int32 i) const;
+//! Get the index of a subtree from its name.
+	int32			FindSubtree(const TCHAR* name) const;
+//! Get the number of chunks which have been loaded.
+	int32			GetNumLoaded() const		{ return m_NumLoaded; }
+//! \b true if the file name is a chunked file.
+	static bool		IsChunked(const TCHAR* filename);
+
+	static int32	ChunkSize;		//!< uncompressed size at which a new chunk is started
+	static int32	NumThreads;		//!< number of threads which decompress chunks
+
+protected:
+	/*
+	 * Chunk directory entry
+	 */
+	struct Chunk
+	{
+		int32	Offset;		// offset of compressed data from start of chunk data
+		int32	PackSize;	// number of compressed bytes
+		int32	RawSize;	// number of uncompressed bytes
+		int32	NumDeps;	// number of earlier chunks this one refers to
+		int32	FirstDep;	// index of first dependency in m_Deps
+		int32	Subtree;	// subtree containing chunk, -1 if none
+		bool	Loaded;		// chunk has been executed
+		char*	Packed;		// compressed data while loading
+		char*	Data;		// uncompressed data while loading
+	};
+
+	/*
+	 * Named subtree directory entry
+	 */
+	struct Subtree
+	{
+		Core::Atom	Name;		// subtree name
+		int32		First;		// first chunk
+		int32		Count;		// number of chunks
+	};
+
+	bool			LoadChunks(int32* list, int32 n);
+	bool			Decompress(int32* list, int32 n);
+	bool			FlushChunk();
+	bool			WriteFile();
+	bool			AddChunk();
+	void			AddDep(int32 chunk);
+	void			FreeChunks();
+
+	Chunk*			m_Chunks;			// chunk directory
+	int32			m_NumChunks;		// number of chunks
+	int32			m_MaxChunks;		// allocated size of chunk directory
+	Subtree*		m_Subtrees;			// named subtree directory
+	int32			m_NumSubtrees;		// number of subtrees
+	int32			m_NumLoaded;		// number of chunks executed
+	int32*			m_Deps;				// dependencies for all chunks
+	int32			m_NumDeps;			// number of dependencies
+	int32			m_MaxDeps;			// allocated size of dependency list
+	int32			m_DataStart;		// file offset of first compressed chunk
+	int32			m_ReadOffset;		// current file offset of input stream
+	int32			m_CurSubtree;		// subtree being written, -1 if none
+	char*			m_Buffer;			// uncompressed chunk being written or read
+	int32			m_BufSize;			// bytes in buffer
+	int32			m_BufMax;			// allocated size of buffer
+	int32			m_ReadPos;			// read position in chunk being executed
+	char*			m_PackData;			// compressed chunks being written
+	int32			m_PackSize;			// number of compressed bytes
+	int32			m_PackMax;			// allocated size of compressed data
+	int32*			m_HandleChunk;		// chunk which creates each handle being written
+	int32*			m_DepMark;			// last chunk which added each dependency
+	int32			m_MaxHandle;		// allocated size of handle map
+};
+
 } // end Vixen
\ No newline at end of file
@@ -0,0 +1,132 @@
+/*!
+ * @file vxmat4.h
+ * @brief 4x4 matrix value type with SIMD kernels.
+ *
+ * Mat4 is the arithmetic underneath Matrix. It is a plain
+ * array of floats with no reference count, lock or virtual functions
+ * so temporaries can live on the stack and be copied freely.
+ * When the compiler targets SSE the multiply, inverse and batch
+ * transform kernels use it, otherwise they are plain C++.
+ *
+ * @author Nola Donato
+ * @ingroup vixen
+ *
+ * @see vxmatrix.h vxmath.h
+ */
+#pragma once
+
+#if !defined(VX_NOSIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1)))
+#define	VX_SSE
+#endif
+
+namespace Vixen {
+
+/*!
+ * @class Mat4
+ * @brief 4x4 transformation matrix value type.
+ *
+ * The elements are stored by rows in the same order as Matrix.
+ * Points are column vectors multiplied on the right, so the
+ * translation is in the last column.
+ * All the functions which compute a matrix from other matrices
+ * work when the result is one of the inputs.
+ * The elements are not declared 16 byte aligned because a Mat4
+ * embedded in a Matrix only has the 8 byte alignment of the
+ * Vixen allocators. The SSE kernels use unaligned loads and stores.
+ *
+ * @ingroup vixen
+ * @see Matrix Vec3 Vec4 Quat
+ */
+class Mat4
+{
+public:
+	Mat4();										//!< Construct identity matrix.
+	Mat4(const float* floatArray);				//!< Construct matrix from 16 floats.
+	Mat4(const Quat& q);						//!< Construct rotation matrix from quaternion.
+
+	void	Identity();							//!< Make identity matrix.
+	bool	IsIdentity() const;					//!< Return \b true if this is the identity matrix.
+	void	Set(const float* floatArray);		//!< Set matrix elements from 16 floats.
+	void	Set(const Quat& q);					//!< Make rotation matrix from quaternion.
+	void	Set(int i1, int i2, float v);		//!< Set matrix element.
+	float	Get(int i1, int i2) const;			//!< Return matrix element.
+	const float*	GetData() const;			//!< Return pointer to the 16 elements.
+
+	//! Make translation matrix.
+	void	TranslationMatrix(const Vec3& v);
+	//! Make scaling matrix.
+	void	ScaleMatrix(const Vec3& s);
+	//! Premultiply by a translation matrix.
+	void	PreTranslate(const Vec3& v);
+	//! Premultiply by a scaling matrix.
+	void	PreScale(const Vec3& s);
+
+	//! Multiply two matrices, this = a * b.
+	void	Multiply(const Mat4& a, const Mat4& b);
+	//! Compute inverse of a matrix, returns \b false if it is singular.
+	bool	Invert(const Mat4& src);
+	//! Exchange rows and columns.
+	void	Transpose();
+
+	//! Transform homogeneous vector.
+	void	Transform(const Vec4& src, Vec4& dst) const;
+	//! Transform 3D point, including translation.
+	void	Transform(const Vec3& src, Vec3& dst) const;
+	//! Transform 3D vector by the 3x3 part.
+	void	TransformVector(const Vec3& src, Vec3& dst) const;
+	//! Transform an array of 3D points.
+	void	TransformPoints(const float* src, float* dst, intptr n, int stride = 3) const;
+	//! Transform an array of 3D vectors by the 3x3 part, optionally normalizing them.
+	void	TransformVectors(const float* src, float* dst, intptr n, int stride = 3, bool normalize = false) const;
+
+	float	data[4][4];			//!< matrix elements by row, not aligned
+};
+
+inline Mat4::Mat4()
+{ Identity(); }
+
+inline Mat4::Mat4(const float* src)
+{ Set(src); }
+
+inline Mat4::Mat4(const Quat& q)
+{ Set(q); }
+
+inline void Mat4::Set(const float* src)
+{ memcpy(data, src, sizeof(data)); }
+
+inline void Mat4::Set(int i1, int i2, float v)
+{
+	VX_ASSERT((i1 >= 0) && (i1 < 4) && (i2 >= 0) && (i2 < 4));
+	data[i1][i2] = v;
+}
+
+inline float Mat4::Get(int i1, int i2) const
+{
+	VX_ASSERT((i1 >= 0) && (i1 < 4) && (i2 >= 0) && (i2 < 4));
+	return data[i1][i2];
+}
+
+inline const float* Mat4::GetData() const
+{ return &data[0][0]; }
+
+inline void Mat4::Transform(const Vec3& src, Vec3& dst) const
+{
+	float x = src.x * data[0][0] + src.y * data[0][1] + src.z * data[0][2] + data[0][3];
+	float y = src.x * data[1][0] + src.y * data[1][1] + src.z * data[1][2] + data[1][3];
+	float z = src.x * data[2][0] + src.y * data[2][1] + src.z * data[2][2] + data[2][3];
+	dst.x = x;
+	dst.y = y;
+	dst.z = z;
+}
+
+inline void Mat4::TransformVector(const Vec3& src, Vec3& dst) const
+{
+	float x = src.x * data[0][0] + src.y * data[0][1] + src.z * data[0][2];
+	float y = src.x * data[1][0] + src.y * data[1][1] + src.z * data[1][2];
+	float z = src.x * data[2][0] + src.y * data[2][1] + src.z * data[2][2];
+	dst.x = x;
+	dst.y = y;
+	dst.z = z;
+}
+
+} // end Vixen
@@ -17,8 +17,12 @@ class Sphere;
  * @class Matrix
  * @brief 4x4 Matrix transformation class that supports automation.
  *
+ * A matrix is a shared object so it can be referenced by models
+ * and logged to a messenger. The arithmetic is done by the Mat4
+ * value type it wraps. Use Mat4 directly for temporary matrices.
+ *
  * @ingroup vixen
- * @see Vec3 Vec4 Quat
+ * @see Mat4 Vec3 Vec4 Quat
  */
 class Matrix : public SharedObj
 {
@@ -59,6 +63,7 @@ public:
 //! @name Element Access
 //!@{
 	const float*	GetMatrix() const;			//!< Return pointer to matrix element data.
+	const Mat4&		GetMat4() const;			//!< Return matrix elements as a value.
 	void	SetMatrix(const float* floatArray);	//!< Set matrix element data from float array.
 
 	Vec4	GetRotationAxis() const;			//!< Get rotation axis and angle.
@@ -67,6 +72,7 @@ public:
 	bool	IsIdentity() const					//!< Check for identity matrix
 			{ return identity; }
 	void	Copy(const Matrix &src);			//!< Copy source matrix into this one.
+	void	Copy(const Mat4 &src);				//!< Copy matrix elements into this one.
 	Matrix& operator=(const Matrix &src);		//!< Copy source matrix into this one.
 	bool	Copy(const SharedObj*);				//!< Copy source matrix object into this one.
 	void	Touch();							//!< Indicate matrix has been updated.
@@ -134,7 +140,7 @@ public:
 
 protected:
 	static	Matrix* s_IdentityMatrix;	//!< Pre-constructed identity matrix
-	float	ALIGN16	data[4][4];
+	Mat4	m_Mat;							//!< matrix elements
 	bool	identity;
 };
 
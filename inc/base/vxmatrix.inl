@@ -10,7 +10,7 @@ FORCE_INLINE void
 Matrix::Set(int i1, int i2, float v)
 {
 	VX_ASSERT( i1 >=0 && i1 <= 4 && i2 >=0 && i2 <= 4 );
-	data[i1][i2] = v;
+	m_Mat.data[i1][i2] = v;
 	identity = false;
 }
 
@@ -18,12 +18,17 @@ FORCE_INLINE float
 Matrix::Get(int i1, int i2) const
 {
 	VX_ASSERT( i1 >=0 && i1 <= 4 && i2 >=0 && i2 <= 4 );
-	return data[i1][i2];
+	return m_Mat.data[i1][i2];
 }
 
 FORCE_INLINE const float*	Matrix::GetMatrix() const
 {
-	return (const float*) data;
+	return m_Mat.GetData();
+}
+
+FORCE_INLINE const Mat4&	Matrix::GetMat4() const
+{
+	return m_Mat;
 }
 
 FORCE_INLINE const Matrix*	Matrix::GetIdentity()
@@ -103,18 +108,12 @@ FORCE_INLINE void	Matrix::GetScale(Vec3& scale) const
  */
 FORCE_INLINE void Matrix::Transform(const Vec3 &tmp, Vec3 &dst) const
 {
-	float x = Dot3(tmp, data[0]) + data[0][3];
-	float y = Dot3(tmp, data[1]) + data[1][3];
-	float z = Dot3(tmp, data[2]) + data[2][3];
-	dst.Set(x, y, z);
+	m_Mat.Transform(tmp, dst);
 }
 
 FORCE_INLINE void Matrix::TransformVector(const Vec3 &src, Vec3 &dst) const
 {
-	float x = Dot3(src, data[0]);
-	float y = Dot3(src, data[1]);
-	float z = Dot3(src, data[2]);
-	dst.Set(x, y, z);
+	m_Mat.TransformVector(src, dst);
 }
 
 FORCE_INLINE void	Vec3::TransformVector(const Matrix& mtx, const Vec3& src)
@@ -3,6 +3,7 @@
 namespace Vixen {
 
 class Event;
+class EventBus;
 
 /*!
  * @file vxmess.h
@@ -104,10 +105,12 @@ struct VXOpcode
  * <B>Event Handling</B>
  *
  * Messengers are also used to log events and propagate them. Each messenger
- * maintains a list of observers that can react to specific events and
+ * has an event bus with the observers that can react to specific events and
  * channel them to individual objects. For example, you could direct
  * all mouse events to a specific engine in the simulation tree designed
- * to process them.
+ * to process them. Events which only have local observers are posted
+ * to the bus directly if \b DirectEvents is set rather than written
+ * to the stream.
  *
  * A messenger has a set of public variables that determine its logging
  * behavior with respect to both updates and events. Whether a transaction
@@ -124,7 +127,7 @@ struct VXOpcode
  * attached string.
  *
  * @ingroup vixen
- * @see SharedObj::IsGlobal SharedObj::GetID Event Core::Stream
+ * @see SharedObj::IsGlobal SharedObj::GetID Event EventBus Core::Stream
  */
 class Messenger : public SharedObj
 {
@@ -229,35 +232,6 @@ public:
 		int32		m_freeHandle;
 	};
 
-	/*!
-	 * @brief Internal property class used to maintain observation
-	 * relationships for a stream.
-	 *
-	 * Each time an event is observed,
-	 * an Observer property is linked into that event's list of observers.
-	 * When an event occurs, its observer list is scanned and the
-	 * OnEvent method is called for the observers of that event
-	 * @ingroup vixenint
-	 * @internal
-	 */
-	class Observer : public Core::List
-	{
-		friend class Messenger;
-		VX_DECLARE_CLASS(Messenger::Observer);
-	public:
-		Observer() : Core::List(), Code(0) { }
-		Observer(const SharedObj* target, uint32 code, const SharedObj* sender) : Core::List()
-			{ Target = target; Code = code; Sender = sender; }
-
-		void	Dispatch(Event*);
-		int		Remove(const SharedObj* target, const SharedObj* sender);
-		bool	operator==(const Observer&);
-
-		ObjRef	Target;				// object that is observing
-		ObjRef	Sender;				// object that is observed, if any
-		uint32	Code;				// event code being observed
-	};
-
 	Messenger(Core::Stream* stream = NULL, bool dolock = false);
 	virtual ~Messenger();
 
@@ -269,6 +243,8 @@ public:
 	virtual	const TCHAR*	GetPath(const TCHAR* name, TCHAR* buf = NULL, int buflen = 0);
 //! Find an object based on its name.
 	virtual	SharedObj*		Find(const TCHAR*) const;
+//! Find an object based on its name atom.
+	SharedObj*				Find(Core::Atom) const;
 //! Find all objects whose names match a given string.
 	virtual	Vixen::ObjArray* FindAll(const TCHAR* name) const;
 //! Attach named object to messenger.
@@ -305,6 +281,8 @@ public:
 	virtual	bool		Observe(const SharedObj* target, int code, const SharedObj* sender);
 //! Ignore events based on code and sender.
 	virtual	bool		Ignore(const SharedObj* target, int code, const SharedObj* sender);
+//! Return event bus which dispatches events to local observers.
+	EventBus*			GetEventBus() const;
 //! Set output stream for sending logged transactions to remote processors.
 	virtual void		SetInStream(Core::Stream*);				
 //! Set input stream for receiving transactions from remote processors.
@@ -385,6 +363,7 @@ public:
 	int				FileVecSize;	//!< number of floats in position, normals for currently loading file
 	bool			DoSync;			//!< true to frame-synchronize with remote processors, default is false
 	bool			SendEvents;		//!< true to send events to remote clients, default is false
+	bool			DirectEvents;	//!< true to post local events to the event bus instead of the stream, default is false
 	bool			SendUpdates;	//!< true to send updates to remote clients, default is false
 	static int		SysVecSize;		//!< number of floats in position, normals for current renderer
 	THREAD_LOCAL bool	t_NoLog;	//!< true to disable transaction logging for current thread
@@ -396,7 +375,7 @@ protected:
 protected:
 	Ref<NameTable>		m_Names;
 	Ref<ObjMap>			m_Objs;
-	Ref<PtrArray>		m_Observers;
+	Ref<EventBus>		m_EventBus;
 	Ref<Core::Stream>	m_InStream;
 	Ref<Core::Stream>	m_OutStream;
 	int					m_ConnectID;
@@ -517,6 +496,7 @@ public:
 protected:
 	virtual bool	SendAll(uint32 sendflags);
 	bool			SendToArbitrator(int* connections, int nconn, uint32 sendflags);
+	void			CheckStalled(Core::Arbitrator* stream);
 	void			ChangeHandle(int oldhandle, int newhandle, uint32 sendmask);
 	void			DoRemap(int oldhandle, int newhandle, uint32 sendmask);
 	int				LookupHandle(int handle, uint32 sendmask);
@@ -538,6 +518,7 @@ protected:
 	int32			m_SendAll;		// bit flags for clients to send to
 	int32			m_AllClients;	// bit flags for all clients
 	int32			m_SendAgain;	// bit flags for sents that failed
+	int32			m_Resync;		// bit flags for clients to send the scene again
 	ObjRef			m_InMap;		// incoming ID remapping table
 };
 
@@ -15,6 +15,9 @@ inline	const TCHAR*	Messenger::GetPath(const TCHAR* name, TCHAR* buf, int buflen
 inline int Messenger::GetConnectID() const
 	{ return m_ConnectID; }
 
+inline EventBus* Messenger::GetEventBus() const
+	{ return m_EventBus; }
+
 inline Core::Stream* Messenger::GetInStream() const
 	{ return m_InStream; }
 
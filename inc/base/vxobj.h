@@ -127,8 +127,17 @@ public:
  * Name properties are allocated by SharedObj::SetName
  * or by Messenger::Define.
  *
+ * Names are interned in the global atom table. The string in
+ * the name property shares its data with the atom table so objects
+ * with the same name do not each keep a copy of it. Name dictionaries
+ * hash and compare names using their atoms instead of the strings.
+ * Constructing or assigning a name property interns the name.
+ * A name property used only to look up a name should be set
+ * with NameProp::Find so names which are not found do not make
+ * the atom table grow.
+ *
  * @ingroup vixen
- * @see Messenger SharedObj::SetName
+ * @see Messenger SharedObj::SetName Core::AtomTable
  */
 class NameProp : public Property
 {
@@ -145,6 +154,16 @@ public:
 	operator Core::String&()					{ return m_String; }
 //! \b true if the string name is empty
 	bool		IsEmpty() const					{ return m_String.IsEmpty() != 0; }
+//! Return atom for the name
+	Core::Atom	GetAtom() const					{ return m_Atom; }
+//! Set the name from an atom
+	void		SetAtom(Core::Atom atom);
+//! Set the name for a lookup without interning it, \b false if it was never interned
+	bool		Find(const TCHAR* name);
+//! \b true if the names match ignoring case
+	bool		IsSame(const NameProp& np) const;
+//! Return case insensitive hash of the name
+	uint32		GetHash() const;
 //! compare input string with name string of this property
 	NameProp& operator=(const TCHAR* str);
 //! copy input name property into this one
@@ -155,31 +174,69 @@ public:
 	bool operator!=(const TCHAR* s) const		{ return m_String != s; }
 
 protected:
-	Core::String m_String;
+	void			Intern(const TCHAR* name);
+
+	Core::String	m_String;
+	Core::Atom		m_Atom;		// zero if empty or the atom table was full
 };
 
 
 inline NameProp::NameProp(const TCHAR* name, intptr tag)
- :	Property(tag), m_String(name) { }
+ :	Property(tag), m_Atom(0) { Intern(name); }
 
 inline NameProp::NameProp(const TCHAR* name)
- :	Property(PROP_NameTag), m_String(name) { }
+ :	Property(PROP_NameTag), m_Atom(0) { Intern(name); }
 
 inline NameProp::NameProp(const NameProp& s)
- :	Property(PROP_NameTag), m_String(s.m_String) { }
+ :	Property(PROP_NameTag), m_String(s.m_String), m_Atom(s.m_Atom) { }
+
+inline void NameProp::SetAtom(Core::Atom atom)
+{
+	m_Atom = atom;
+	if (atom)
+		m_String = Core::AtomTable::GetString(atom);
+	else
+		m_String.Empty();
+}
 
 inline NameProp& NameProp::operator=(const NameProp& s)
 {
 	m_String = s.m_String;
+	m_Atom = s.m_Atom;
 	return *this;
 }
 
 inline NameProp& NameProp::operator=(const TCHAR* str)
 {
-	m_String = str;
+	Intern(str);
 	return *this;
 }
 
+inline bool NameProp::Find(const TCHAR* name)
+{
+	m_Atom = Core::AtomTable::Find(name);
+	m_String = name;
+	return m_Atom != 0;
+}
+
+/*
+ * Names which could not be interned have no atom
+ * and are compared by their strings.
+ */
+inline bool NameProp::IsSame(const NameProp& np) const
+{
+	if (m_Atom && np.m_Atom)
+		return Core::AtomTable::Equal(m_Atom, np.m_Atom);
+	return m_String.CompareNoCase(np.m_String) == 0;
+}
+
+inline uint32 NameProp::GetHash() const
+{
+	if (m_Atom)
+		return Core::AtomTable::GetHash(m_Atom);
+	return m_String.IsEmpty() ? 0 : Core::AtomTable::Hash(m_String);
+}
+
 #pragma warning(disable:4291)
 
 
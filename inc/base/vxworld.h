@@ -57,6 +57,8 @@ public:
 //! @name World Domination
 //! Elapsed time since world was created in seconds.
 	virtual	float		GetTime() const;
+//! Elapsed time since world was created in seconds with full precision.
+	virtual	double		GetRealTime() const;
 //! Return the world pointer.
 	static World*		Get()				{ return s_OnlyOne; }	
 //! Return name of file to open on startup.
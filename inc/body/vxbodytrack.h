@@ -12,6 +12,10 @@
  */
 namespace Vixen {
 
+#define	BODYTRACK_LogMagic		0x4C4A5856	// "VXJL" joint log file signature
+#define	BODYTRACK_LogVersion	1			// joint log file version
+
+class BodyCaptureThread;
 
 /*!
  * @class BodyTracker
@@ -27,11 +31,21 @@ namespace Vixen {
  *
  * The BodyTracker can also emit a series of events which observers can listen for.
  *
+ * Sensor input is gathered by BodyTracker::CaptureFrame on a separate capture
+ * thread so a slow sensor never stalls the simulation. Each sample is a
+ * JointFrame with the sensor joint data and the tracking state of every user.
+ * Frames are passed to the simulation thread through a lock-free triple buffer.
+ * BodyTracker::Eval only consumes the newest frame, older frames are dropped.
+ * If the capture thread is not running, the sensor is polled without
+ * waiting during BodyTracker::Eval. Captured frames can be recorded to a
+ * joint log and played back later by a ReplayTracker.
+ *
  * @see Skeleton Transformer Skin TrackEvent BodyTracker
  * @ingroup vixen
  */
 class BodyTracker : public Engine
 {
+	friend class BodyCaptureThread;
 public:
 	VX_DECLARE_CLASS(BodyTracker);
 
@@ -94,6 +108,21 @@ public:
 	//! Set the Kinect user ID of the user to track.
 	void			SetUserID(int userid)			{ m_UserID = userid; }
 
+	//! Start capturing sensor input on a separate thread.
+	bool			StartCapture();
+
+	//! Stop the capture thread.
+	void			StopCapture();
+
+	//! Returns \b true if the capture thread is running.
+	bool			IsCapturing() const				{ return m_CaptureThread != NULL; }
+
+	//! Record captured joint frames to a file.
+	bool			StartRecording(const TCHAR* filename);
+
+	//! Stop recording joint frames.
+	void			StopRecording();
+
 	virtual void	OnNewUser(int userid);
 	virtual	void	OnStartJointTrack(int userid);
 	virtual void	OnPauseJointTrack(int userid);
@@ -118,6 +147,47 @@ public:
 		MAX_USERS = 8
 	};
 
+	/*!
+	 * Tracking state of a user in a JointFrame.
+	 * The body tracker generates the user tracking events
+	 * when the state of a user changes between frames.
+	 */
+	enum
+	{
+		USER_NONE = 0,			//! user not present
+		USER_TRACKING = 1,		//! user present and being tracked
+		USER_PAUSED = 2			//! user present but tracking paused
+	};
+
+	/*!
+	 * Sensor joint data for all users captured at one time.
+	 * Joint positions and rotations are in sensor coordinates
+	 * using the Skeleton bone ordering. Only the bones whose bit is
+	 * set in the rotation or position mask have valid data.
+	 */
+	struct JointFrame
+	{
+		struct User
+		{
+			int32	State;								//!< USER_NONE, USER_TRACKING or USER_PAUSED
+			uint32	RotMask;							//!< bones with valid rotations
+			uint32	PosMask;							//!< bones with valid positions
+			Quat	Rotations[Skeleton::NUM_BONES];		//!< joint rotations from sensor
+			Vec3	Positions[Skeleton::NUM_BONES];		//!< joint positions from sensor
+		};
+
+		double		Time;								//!< capture time in seconds
+		int32		Sequence;							//!< capture sequence number
+		User		Users[MAX_USERS];					//!< joint data for each user
+
+		void		Empty();
+	};
+
+	//! Copy the joint frame the tracker is currently using.
+	void			GetJointFrame(JointFrame& frame) const;
+
+	static bool		UseCaptureThread;			//!< start capture thread when engine starts (default true)
+
 	enum Opcode
 	{
 		BODYTRACK_SetOptions = ENG_NextOp,
@@ -127,13 +197,58 @@ public:
 	};
 
 protected:
+	/*
+	 * Lock-free triple buffer which passes joint frames from the capture
+	 * thread to the simulation thread. The producer always owns the back
+	 * frame and the consumer always owns the front frame. The newest complete
+	 * frame is kept in the middle. Neither side ever waits.
+	 */
+	class JointBuffer
+	{
+	public:
+		JointBuffer();
+
+		JointFrame&			GetBack()			{ return m_Frames[m_Back]; }
+		const JointFrame&	GetFront() const	{ return m_Frames[m_Front]; }
+		void				Publish();
+		bool				Acquire();
+
+	protected:
+		enum { FRESH = 4 };		// set in middle index when it has a new frame
+
+		JointFrame	m_Frames[3];
+		int32		m_Back;		// frame being written by producer
+		vint32		m_Middle;	// newest complete frame
+		int32		m_Front;	// frame being read by consumer
+	};
+
 	virtual	int		Save(Messenger&, int) const;
 	virtual	bool	Do(Messenger& s, int op);
 	virtual	bool	Copy(const SharedObj*);
 	virtual bool	Eval(float t);
+	virtual bool	OnStart();
+	virtual bool	OnStop();
 	virtual bool	ComputeBoneAngles(int userid);
 	virtual void	Init();
 
+	//! Read joint data from the sensor.
+	virtual bool	CaptureFrame(JointFrame& frame, bool wait);
+
+	//! Consume the newest joint frame.
+	virtual bool	UpdateFrame();
+
+	//! Generate tracking events for user state changes and make the frame current.
+	void			ApplyFrame(const JointFrame& frame);
+
+	//! Write a joint frame to the recording file.
+	void			RecordFrame(const JointFrame& frame);
+
+	//! Return monotonic time in seconds.
+	static double	GetClock();
+
+	//! Suspend the calling thread.
+	static void		SleepFor(int ms);
+
 	//! Determine if Z axis forward after rotation.
 	static float	ZForward(const Quat& rotation);
 
@@ -167,6 +282,13 @@ protected:
 	Skeleton		m_Skeleton;							// internal skeleton
 	Ref<PoseMapper>	m_PoseMapper;						// internal pose mapper
 	Vec3			m_WaistOffset;						// initial waist offset for skeleton
+	JointFrame		m_Frame;							// current joint frame
+	mutable Core::CritSec m_FrameLock;					// guards current frame while it is replaced
+	JointBuffer		m_Joints;							// frames from capture thread
+	int32			m_Sequence;							// sequence number of last frame captured
+	BodyCaptureThread*	m_CaptureThread;				// thread polling sensor
+	FILE*			m_RecordFile;						// joint log being recorded
+	Core::CritSec	m_RecordLock;						// guards recording file
 };
 
 /*
@@ -93,7 +93,8 @@ protected:
 	virtual void	Init();
 	virtual bool	Eval(float t);
 	virtual bool	OnStart();
-	virtual bool	ComputeBoneAngles(int userid);
+	virtual bool	CaptureFrame(JointFrame& frame, bool wait);
+	virtual bool	UpdateFrame();
 
 	Kinect*			m_Kinect;
 	Quat			m_KinectRest[NUM_BONES];	// the Kinect "T" pose as world rotations
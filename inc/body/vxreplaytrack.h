@@ -0,0 +1,89 @@
+#pragma once
+#pragma managed(push, off)
+/*!
+ * @file vxreplaytrack.h
+ * @brief Body tracker which plays back recorded sensor input.
+ *
+ * Animates a human skeleton from a joint log recorded
+ * from another body tracker.
+ *
+ * @ingroup vixen
+ */
+namespace Vixen {
+
+/*!
+ * @class ReplayTracker
+ *
+ * @brief Body tracker which plays back a recorded joint log.
+ *
+ * The joint log is recorded from another body tracker with
+ * BodyTracker::StartRecording. It contains the view volume and image
+ * size of the original sensor followed by the joint frames captured.
+ * The frames are streamed on the capture thread at their original timing
+ * (scaled by the playback speed) so the tracking pipeline behaves as it
+ * would with a live sensor. This allows body tracking applications to be
+ * tested and benchmarked on machines without a sensor.
+ *
+ * @code
+ *	ReplayTracker* tracker = new ReplayTracker(TEXT("session.vxj"));
+ *	tracker->SetOptions(BodyTracker::TRACK_SKELETON);
+ *	tracker->SetLoop(true);
+ * @endcode
+ *
+ * @see BodyTracker::StartRecording KinectTracker
+ * @ingroup vixen
+ */
+class ReplayTracker : public BodyTracker
+{
+public:
+	VX_DECLARE_CLASS(ReplayTracker);
+
+	ReplayTracker(const TCHAR* filename = NULL);
+	~ReplayTracker();
+
+	//! Open a joint log file for playback.
+	virtual bool	Configure(const TCHAR* filename);
+
+	//! Return dimensions of recorded camera output bitmap.
+	virtual Vec2	GetImageSize() const;
+
+	//! Return recorded sensor view volume.
+	virtual bool	GetViewVolume(Box3& vvol);
+
+	//! Return recorded field of view in radians.
+	virtual	float	GetFOV()						{ return m_FOV; }
+
+	//! Return \b true if playback restarts at the end of the log.
+	bool			IsLoop() const					{ return m_Loop; }
+
+	//! Enable or disable restarting playback at the end of the log.
+	void			SetLoop(bool loop)				{ m_Loop = loop; }
+
+	//! Return playback speed relative to the original timing.
+	float			GetPlaySpeed() const			{ return m_PlaySpeed; }
+
+	//! Set playback speed, 0 plays as fast as possible.
+	void			SetPlaySpeed(float speed)		{ m_PlaySpeed = speed; }
+
+protected:
+	virtual bool	CaptureFrame(JointFrame& frame, bool wait);
+	bool			ReadFrame(JointFrame& frame);
+	void			Close();
+
+	FILE*			m_File;			// joint log being played
+	long			m_DataStart;	// file offset of first frame
+	Box3			m_ViewVol;		// recorded view volume
+	Vec2			m_ImageSize;	// recorded image size
+	float			m_FOV;			// recorded field of view
+	bool			m_Loop;			// restart at end of log
+	bool			m_Ended;		// reached end of log
+	bool			m_HasNext;		// next frame has been read
+	float			m_PlaySpeed;	// playback speed
+	double			m_LogStart;		// log time of first frame
+	double			m_ClockStart;	// clock time playback started
+	JointFrame		m_Next;			// next frame to play
+};
+
+}	// end Vixen
+
+#pragma managed(pop)
\ No newline at end of file
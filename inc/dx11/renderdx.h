@@ -42,6 +42,7 @@ namespace Vixen
 		void			MakeDefaultShaders();
 		int				MakeLightDesc();
 		int				LoadLights();
+		int				LoadObjectLights(uint32* lightindex);
 		void			FreeResources();
 		void			FreeBuffers();
 		bool			CreateBuffers(int w, int h);
@@ -49,6 +50,7 @@ namespace Vixen
 		ID3D11View*		ChangeRenderTarget(Bitmap* bmap, DXGI_FORMAT format, D3D11_BIND_FLAG type);
 
 		Ref<DeviceBuffer>		m_ConstantBuffers[CBUF_MAX + 1]; // constant buffer list
+		SlotHandle				m_WorldMatrixSlot;	// world matrix in per object constant buffer
 		Core::String			m_LightShaderSource;
 		D3DDEVICE*				m_Device;				// The D3D rendering device
 		D3DCONTEXT*				m_Context;
@@ -103,6 +105,7 @@ namespace Vixen
 		{
 			SetName(sourcelight.ClassName());
 			LocalDir.Set(0, 0, 1);
+			ShaderSlot = -1;
 		}
 		DXLight&				operator=(const GPULight& src);
 		virtual	void			Detach();
@@ -114,6 +117,7 @@ namespace Vixen
 		static	int						LoadLights(LightList& lights, Core::String& source);
 
 		int							VectorOffset;
+		int							ShaderSlot;		// index in shader LightList array, -1 if not declared
 		DXRef<ID3D11ClassInstance>	LightClassInstance;
 		static	int					NumLights;
 	};
@@ -71,7 +71,7 @@ class DXIndexBuf : public DXBuffer
 public:
 	DXIndexBuf();
 
-	bool	Update(DXRenderer*, const IndexArray*, bool dynamic = false);
+	int		Update(DXRenderer*, const IndexArray*, bool dynamic = false);
 };
 
 /*!
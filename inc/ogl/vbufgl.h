@@ -16,7 +16,7 @@ public:
 	GLuint		GetBuffer()	{ return m_GLBuffer; }
 	void		Release();
 	
-	static bool		Update(const DeviceBuffer* devbuf, GLuint program, const TCHAR* prefix = NULL);	
+	static bool		Update(const DeviceBuffer* devbuf, GLuint program, const TCHAR* prefix = NULL, size_t start = 0, size_t end = size_t(-1));
 	static	void	ReleaseAll();
 protected:
 	GLuint			m_GLBuffer;
@@ -40,7 +40,7 @@ class GLIndexBuf : public GLBuffer
 public:
 	GLIndexBuf();
 
-	bool	Update(GLRenderer*, const IndexArray*, bool dynamic = false);
+	int		Update(GLRenderer*, const IndexArray*, bool dynamic = false);
 };
 
 /*!
@@ -24,7 +24,7 @@ namespace Vixen
 	public:
 		CullList();
 
-		virtual	int		AddShape(Shape*, const Matrix*, int32 lightmask);
+		virtual	int		AddShape(Shape*, const Matrix*);
 		virtual	void	Reset();
 		virtual	void	Render(int32 opts = GeoSorter::All);
 
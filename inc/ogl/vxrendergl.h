@@ -38,6 +38,7 @@ public:
 //	Initializers
 	GLRenderer();
 	GLRenderer&		operator=(const GLRenderer& src);
+	~GLRenderer();
 
 // Scene overrides
 	virtual intptr			AddLight(Light* light);
@@ -56,10 +57,12 @@ public:
 	intptr					UpdateTexture(Texture* texture, int texunit, bool mipmap);
 	GLuint					GetProgram() { return m_CurProgram; }
 	bool					GeneratePixelShader(Core::String& name, Core::String& source, bool dolighting);
+	void					EnableLight(int id, int enabled);
 
 	static int				NumTexUnits;
 	int						NumLights;
-	int						LightsEnabled[LIGHT_MaxLights];
+	int*					LightsEnabled;		// enable flag for each light indexed by GPULight::ID
+	int						NumLightsEnabled;	// number of entries in LightsEnabled
 	Ref<PhongMaterial>		DefaultMaterial;
 
 protected:
@@ -72,6 +75,7 @@ protected:
 	void			MakeDefaultShaders();
 	int				LoadLights();
 	void			InitPerFrame(intptr program, int changed);
+	void			LoadLightsEnabled(GLuint program);
 
 #if defined(VIXEN_GLES2) && !defined(VIXEN_GLFW)
 	EGLDisplay		m_Display;
@@ -81,6 +85,8 @@ protected:
 #endif
 	int				m_Changed;
 	bool			m_LightShaderChanged;
+	bool			m_LightsEnabledChanged;	// LightsEnabled changed since last loaded into the program
+	int				m_LightsDeclared;		// size of LightsEnabled array in light shader source
 	GLuint			m_CurProgram;			// current GL program
 	Core::String	m_LightShaderSource;	// source for light shaders
 	Core::String	m_NoLightSource;		// shader code for no light sources
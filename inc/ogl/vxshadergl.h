@@ -36,7 +36,7 @@ public:
 class GLProgram
 {
 public:
-	GLProgram() { m_GLProgram = 0; }
+	GLProgram() { m_GLProgram = 0; m_Material = NULL; m_MaterialProgram = 0; m_MaterialVersion = 0; }
 
 	GLuint			GetProgram()	{ return (GLuint) m_GLProgram; }
 	GLuint			FindProgram(const TCHAR* key);
@@ -51,6 +51,9 @@ public:
 
 protected:
 	GLuint						m_GLProgram;
+	const DeviceBuffer*			m_Material;			// last material loaded into a program
+	GLuint						m_MaterialProgram;	// program it was loaded into
+	uint32						m_MaterialVersion;	// version of the material loaded
 	static NameDict< int32 >*	ProgramDict;	// maps vertex & pixel shader name combo into program id
 };
 
@@ -33,7 +33,34 @@ struct LayoutSlot
 
 	// For vertex buffers only
 	int32			TexIndex;	//!< texture stage index
-	int32			Size;		//!< number of floats/ints in this component
+	int32			Size;		//!< number of 32 bit words in this component
+	int32			Count;		//!< number of values in this component after decoding
+	int32			Format;		//!< storage format, DataLayout::FULL, DataLayout::HALF, ...
+};
+
+class DataLayout;
+
+/*!
+ * @class SlotHandle
+ * @brief Pre-resolved reference to an element of a device buffer.
+ *
+ * Looking up a buffer element by name compares strings on every access.
+ * A slot handle is resolved once from the layout and then used to read
+ * and write the element directly. It remembers the layout it was resolved
+ * for and only works with buffers which have that layout.
+ *
+ * @see DataLayout::GetHandle DeviceBuffer::Set DeviceBuffer::SetSlots
+ */
+struct SlotHandle
+{
+	SlotHandle() : Layout(NULL), Offset(-1), Size(0) { }
+
+	//! Returns \b true if the handle refers to an element.
+	bool	IsValid() const		{ return Offset >= 0; }
+
+	const DataLayout*	Layout;	//!< layout the handle was resolved for
+	int32				Offset;	//!< offset of element in 32 bit words, -1 if not found
+	int32				Size;	//!< number of 32 bit words in the element
 };
 
 /*!
@@ -56,12 +83,18 @@ public:
 	//!< Get layout slot for named element.
 	const LayoutSlot*	GetSlot(const TCHAR* name) const;
 
+	//! Resolve a handle for a named element.
+	SlotHandle			GetHandle(const TCHAR* name) const;
+
 	//! Set data layout information based on string descriptor.
 	void				SetDescriptor(const TCHAR* desc);
 
 	//! Make a string descriptor from the information in the data layout.
 	void				MakeDescriptor(Core::String& desc) const;
 
+	//! Returns \b true if any element is stored in a compact format.
+	bool				IsCompact() const	{ return NumCompact > 0; }
+
 	//!< Find layout structure for given descriptor.
 	static	const DataLayout*	FindLayout(const TCHAR* desc);
 
@@ -70,6 +103,7 @@ public:
 
 	Core::String	Descriptor;		//!< layout descriptor string
 	int32			NumSlots;		//!< number of vertex components
+	int32			NumCompact;		//!< number of components in a compact format
 	int32			Size;			//!< size of vertex in floats
 	mutable intptr	DevHandle;		//!< device specific handle
 
@@ -88,6 +122,24 @@ public:
 		INTEGER = 16,
 		FLOAT = 0,
 	};
+
+	/*!
+	 * @brief Storage format of the values in an element.
+	 *
+	 * Elements which are not FULL are packed into fewer 32 bit words
+	 * and must be decoded to be used on the CPU.
+	 * @see LayoutSlot::Format VertexPool::DecodeIter
+	 */
+	enum
+	{
+		FULL = 0,		//!< 32 bit float or integer, descriptor type \b float or \b int
+		HALF,			//!< 16 bit float, two per word, descriptor type \b half
+		QUANTIZED,		//!< 16 bit unsigned scaled by VertexPool::GetQuantScale, two per word, descriptor type \b short
+		OCTAHEDRAL,		//!< unit vector as two 16 bit signed values in one word, descriptor type \b oct
+		PACKED10,		//!< unit vector as 10:10:10:2 unsigned in one word, descriptor type \b packed
+		SNORM16,		//!< vector as three 16 bit signed values normalized to [-1, 1] in two words, descriptor type \b snorm
+	};
+
 protected:
 	static void	FormatDescriptor(Core::String& outdesc, const TCHAR* indesc);
 
@@ -119,8 +171,13 @@ template <> inline uint32 Dict< Core::String, DataLayout, Vixen::BaseDict >::Has
  * that may be sent to a graphics display device, such as shader
  * constant buffers.
  *
+ * Elements may be accessed by name or by a SlotHandle resolved once
+ * from the layout, which avoids looking up the name each time.
+ * The buffer keeps the range of bytes changed since the renderer last
+ * uploaded it so only that part needs to be sent to the device.
+ *
  * @ingroup vixen
- * @see Material VertexArray
+ * @see Material VertexArray SlotHandle DeviceBuffer::GetDirty
  */
 class DeviceBuffer : public SharedObj
 {
@@ -156,6 +213,32 @@ public:
 	bool			Set(const TCHAR* name, const float* src);
 	bool			Set(const TCHAR* name, const int32* src);
 
+	// Pre-resolved accessors
+	SlotHandle		GetHandle(const TCHAR* name) const;				//!< Resolve handle for named element.
+	bool			Get(const SlotHandle& slot, float& v) const;	//!< Get float element.
+	bool			Get(const SlotHandle& slot, Col4& v) const;		//!< Get 4D color element.
+	bool			Get(const SlotHandle& slot, Vec3& v) const;		//!< Get 3D vector element.
+	bool			Get(const SlotHandle& slot, Vec4& v) const;		//!< Get 4D vector element.
+	bool			Get(const SlotHandle& slot, Vec2& v) const;		//!< Get 2D vector element.
+	bool			Get(const SlotHandle& slot, float* dst) const;	//!< Get elements of any size.
+	bool			Set(const SlotHandle& slot, float v);			//!< Set float element.
+	bool			Set(const SlotHandle& slot, int32 v);			//!< Set int element.
+	bool			Set(const SlotHandle& slot, const Col4& v);		//!< Set 4D color element.
+	bool			Set(const SlotHandle& slot, const Vec3& v);		//!< Set 3D vector element.
+	bool			Set(const SlotHandle& slot, const Vec4& v);		//!< Set 4D vector element.
+	bool			Set(const SlotHandle& slot, const Vec2& v);		//!< Set 2D vector element.
+	bool			Set(const SlotHandle& slot, const float* src);	//!< Set elements of any size.
+	int				SetSlots(const SlotHandle* slots, const void* const* src, int n);
+
+	// Changed data tracking
+	void			MarkDirty(size_t ofs, size_t nbytes) const;		//!< Mark a byte range as changed.
+	void			MarkDirty() const;								//!< Mark the whole buffer as changed.
+	bool			TakeDirty(size_t& start, size_t& end) const;	//!< Get and forget range of changed bytes, called before uploading.
+	bool			IsDirty() const;								//!< Returns \b true if any bytes changed.
+	bool			GetDirty(size_t& start, size_t& end) const;		//!< Get range of changed bytes.
+	uint32			GetVersion() const;								//!< Returns number of changes so far.
+	uint32			GetCleanVersion() const;						//!< Returns version at last TakeDirty.
+
 //  Overrides
 	virtual bool	Copy(const SharedObj* src);
 
@@ -176,10 +259,17 @@ protected:
 	};
 
 	void*				GetSlotData(const TCHAR* name, int32& size) const;
+	void*				GetSlotData(const SlotHandle& slot, int32& size) const;
+	bool				SetSlot(const SlotHandle& slot, const void* src, int32 nbytes);
+	bool				GetSlot(const SlotHandle& slot, void* dst, int32 nbytes) const;
 
 	const DataLayout*	m_Layout;
 	size_t				m_Size;
 	void*				m_Data;
+	mutable size_t		m_DirtyStart;	// first changed byte
+	mutable size_t		m_DirtyEnd;		// byte after the last changed byte, 0 if none
+	mutable uint32		m_Version;		// incremented on each change
+	mutable uint32		m_CleanVersion;	// version when the changes were last cleared
 };
 
 inline size_t	DeviceBuffer::GetByteSize() const
@@ -203,6 +293,34 @@ inline void DeviceBuffer::SetData(void* data)
 		ClearFlags(STATIC_DATA);
 	}
 	m_Data = data;
+	MarkDirty();
+}
+
+inline void DeviceBuffer::MarkDirty() const
+{
+	MarkDirty(0, m_Size);
+}
+
+inline bool DeviceBuffer::IsDirty() const
+{
+	return m_DirtyEnd > m_DirtyStart;
+}
+
+inline uint32 DeviceBuffer::GetVersion() const
+{
+	return m_Version;
+}
+
+inline uint32 DeviceBuffer::GetCleanVersion() const
+{
+	return m_CleanVersion;
+}
+
+inline SlotHandle DeviceBuffer::GetHandle(const TCHAR* name) const
+{
+	if (m_Layout)
+		return m_Layout->GetHandle(name);
+	return SlotHandle();
 }
 
 inline const DataLayout* DeviceBuffer::GetLayout() const
@@ -239,4 +357,66 @@ inline void* DeviceBuffer::GetSlotData(const TCHAR* name, int32& nbytes) const
 	return NULL;
 }
 
+/*!
+ * @fn void* DeviceBuffer::GetSlotData(const SlotHandle& slot, int32& nbytes)
+ * @param slot		handle of element to get
+ * @param nbytes	number of bytes in data for this slot
+ *
+ * Returns a pointer to the data for the given slot.
+ *
+ * @returns -> slot data if successful, NULL if the handle is not
+ *			valid for the layout of this buffer
+ *
+ * @see DeviceBuffer::Get DataLayout::GetHandle
+ */
+inline void* DeviceBuffer::GetSlotData(const SlotHandle& slot, int32& nbytes) const
+{
+	if (slot.IsValid() && (slot.Layout == m_Layout) && m_Data)
+	{
+		nbytes = slot.Size * sizeof(int32);
+		return (int32*) m_Data + slot.Offset;
+	}
+	nbytes = 0;
+	return NULL;
+}
+
+inline bool DeviceBuffer::Set(const SlotHandle& slot, float v)
+{ return SetSlot(slot, &v, sizeof(float)); }
+
+inline bool DeviceBuffer::Set(const SlotHandle& slot, int32 v)
+{ return SetSlot(slot, &v, sizeof(int32)); }
+
+inline bool DeviceBuffer::Set(const SlotHandle& slot, const Col4& v)
+{ return SetSlot(slot, &v, sizeof(Col4)); }
+
+inline bool DeviceBuffer::Set(const SlotHandle& slot, const Vec3& v)
+{ return SetSlot(slot, &v, sizeof(Vec3)); }
+
+inline bool DeviceBuffer::Set(const SlotHandle& slot, const Vec4& v)
+{ return SetSlot(slot, &v, sizeof(Vec4)); }
+
+inline bool DeviceBuffer::Set(const SlotHandle& slot, const Vec2& v)
+{ return SetSlot(slot, &v, sizeof(Vec2)); }
+
+inline bool DeviceBuffer::Set(const SlotHandle& slot, const float* src)
+{ return SetSlot(slot, src, 0); }
+
+inline bool DeviceBuffer::Get(const SlotHandle& slot, float& v) const
+{ return GetSlot(slot, &v, sizeof(float)); }
+
+inline bool DeviceBuffer::Get(const SlotHandle& slot, Col4& v) const
+{ return GetSlot(slot, &v, sizeof(Col4)); }
+
+inline bool DeviceBuffer::Get(const SlotHandle& slot, Vec3& v) const
+{ return GetSlot(slot, &v, sizeof(Vec3)); }
+
+inline bool DeviceBuffer::Get(const SlotHandle& slot, Vec4& v) const
+{ return GetSlot(slot, &v, sizeof(Vec4)); }
+
+inline bool DeviceBuffer::Get(const SlotHandle& slot, Vec2& v) const
+{ return GetSlot(slot, &v, sizeof(Vec2)); }
+
+inline bool DeviceBuffer::Get(const SlotHandle& slot, float* dst) const
+{ return GetSlot(slot, dst, 0); }
+
 } // end Vixen
\ No newline at end of file
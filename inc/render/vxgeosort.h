@@ -2,6 +2,8 @@
 
 namespace Vixen {
 
+class RenderStream;
+
 /*!
  * @class Renderer
  * @brief Base class for encapsulating device-specific rendering functionality.
@@ -14,6 +16,21 @@ class Renderer : public SharedObj
 	VX_DECLARE_CLASS(Renderer);
 
 public:
+	/*!
+	 * @brief Per-instance data for instanced rendering.
+	 *
+	 * Holds the top three rows of the world matrix
+	 * (the bottom row is always 0 0 0 1), packed so that an array
+	 * of them can be copied directly to a device buffer.
+	 * All the instances in a batch are lit by the same lights.
+	 *
+	 * @see Renderer::RenderInstances
+	 */
+	struct Instance
+	{
+		float	Transform[12];	//!< rows 0 - 2 of world matrix
+	};
+
 	Renderer(int opts = 0);
 	Renderer& operator=(const Renderer&);
 	~Renderer() { }
@@ -40,7 +57,7 @@ public:
 	virtual void	Reset();
 
 	//! Called from traversal thread to add this shape to be rendered next frame.
-	virtual int		AddShape(const Shape*, const Matrix*, int32 lightmask)	{ return -1; };
+	virtual int		AddShape(const Shape*, const Matrix*)	{ return -1; };
 
 	//! Called from traversal thread to add this light to be used in this frame.
 	virtual intptr	AddLight(Light*);
@@ -66,6 +83,9 @@ public:
 	//! Called from rendering thread to render a single mesh.
 	virtual	void	RenderMesh(const Geometry* geo, const Appearance* appear, const Matrix* mtx) { }
 
+	//! Called from rendering thread to render many copies of a mesh with different transforms.
+	virtual	void	RenderInstances(const Geometry* geo, const Appearance* appear, const Instance* inst, int n);
+
 	//! Called to free resources and/or completely shutdown.
 	virtual	void	Exit(bool shutdown = true);
 
@@ -109,6 +129,17 @@ protected:
  * order causing everything with a like appearance to be rendering
  * together. For most graphics hardware, this is more efficient because
  * it minimized render state changes.
+ *
+ * Within an opaque bucket, copies of the same geometry and appearance
+ * are grouped and rendered together with Renderer::RenderInstances
+ * so renderers which support instancing can draw them with one call.
+ *
+ * With the GeoSorter::RecordCommands option, the buckets are recorded
+ * into a RenderStream which is then replayed against the renderer
+ * instead of calling it directly. The commands for the last frame
+ * are available from GeoSorter::GetCommands. GeoSorter::Record
+ * records a range of buckets so different threads can record
+ * different ranges into separate streams.
  * 
  * A non locking allocator is used for the render state buckets and
  * its memory is reclaimed each frame after the renderer has finished.
@@ -125,6 +156,8 @@ class GeoSorter : public Renderer
 public:
 	enum SortOptions
 	{
+		RecordCommands = 64,
+		NoInstancing = 32,
 		NoStateSort = 16,
 		Flatten = 8,
 	};
@@ -155,7 +188,8 @@ public:
 		{
 			Shape = shape;
 			Matrix = NULL;
-			LightMask = 0;
+			Lights = NULL;
+			NumLights = 0;
 		}
 
 	//! Determine if static or dynamic property (dynamic has matrix).
@@ -164,7 +198,8 @@ public:
 
 		const Shape*	Shape;		//!< shape to render
 		Matrix*			Matrix;		//!< accumulated world matrix for owner shape
-		uint32			LightMask;	//!< lights that illuminate this shape
+		const uint16*	Lights;		//!< indices of lights that illuminate this shape
+		int32			NumLights;	//!< number of light indices
 	};
 
 	typedef int CompareFunc(const RenderPrim* prim1, const RenderPrim* prim2);
@@ -178,9 +213,17 @@ public:
 	virtual void	Empty();
 	virtual	void	Reset();
 	virtual void	Print(DebugOut& dbg = vixen_debug) const;
-	virtual int		AddShape(const Shape*, const Matrix*, int32 lightmask);
+	virtual int		AddShape(const Shape*, const Matrix*);
 	virtual void	Render(int frame, int opts = 0);
 
+	//! Record rendering commands for a range of state buckets.
+	void			Record(RenderStream* stream, int32 first, int32 last);
+
+	//! Return the commands recorded for the last frame, NULL if not recording.
+	RenderStream*	GetCommands() const	{ return m_Commands; }
+
+	static	int		MinInstances;		//!< minimum number of copies of a mesh rendered as instances
+
 protected:
 
 	//! Render the accumulated meshes for a single state.
@@ -189,9 +232,18 @@ protected:
 	//! Get state bucket index for this appearance.
 	virtual int32		GetState(const Appearance*) const;
 
-	virtual RenderPrim*	AddPrim(const Shape* shape, int stateindex, const Matrix* wmtx, int32 lightmask);
+	//! Render or record the accumulated meshes for a single state.
+	void				DrawState(int32 stateindex, RenderStream* stream);
+
+	//! Render or record a run of primitives which share geometry, appearance and lights as instances.
+	void				DrawBatch(RenderPrim* first, int n, RenderStream* stream);
+
+	virtual RenderPrim*	AddPrim(const Shape* shape, int stateindex, const Matrix* wmtx);
+	void				AddLights(RenderPrim* prim, const Matrix* wmtx);
 	virtual bool		SortBin(RenderPrim** listhead, CompareFunc* cmpfunc);
+	static RenderPrim*	SortList(RenderPrim* list, CompareFunc* cmpfunc);
 	static int			CompareZ(const RenderPrim* prim1, const RenderPrim* prim2);
+	static int			CompareGeo(const RenderPrim* prim1, const RenderPrim* prim2);
 
 
 	RenderPrim*			GetState(int32 stateindex)
@@ -204,6 +256,9 @@ protected:
 	static	int		StateMask;			// bit mask to keep within range of MaxStates
 	Array<RenderPrim*> m_States;		// render state buckets
 	Core::FastAllocator	m_FrameAlloc;	// local heap (reused each frame)
+	Ref<RenderStream>	m_Commands;		// commands recorded for the last frame
+	const uint16*	m_AllLights;		// lights shared by all primitives when not culled by distance
+	int32			m_NumAllLights;		// number of shared lights, -1 if not found yet this frame
 };
 
 } // end Vixen
\ No newline at end of file
@@ -0,0 +1,96 @@
+/*!
+ * @file vxglyphatlas.h
+ * @brief Dynamically packed texture of font glyphs.
+ *
+ * @author Nola Donato
+ * @ingroup vixen
+ *
+ * @see vxtextbatch.h vxtextgeom.h texfont.h
+ */
+#pragma once
+
+#include "render/texfont.h"
+
+namespace Vixen {
+
+/*!
+ * @class GlyphAtlas
+ * @brief Texture which holds the glyphs of a font actually used for text.
+ *
+ * A glyph atlas starts out empty and copies each glyph from its source
+ * font the first time it is requested. Glyphs are placed with a skyline
+ * allocator which keeps the top edge of the used area as a list of
+ * horizontal segments and puts each new glyph where its top ends up lowest.
+ *
+ * The atlas is itself a TexFont so its texture can be used anywhere
+ * a font texture can. All the text which uses the same atlas and
+ * appearance can be drawn together, which TextBatch relies on to put
+ * thousands of labels into a single mesh.
+ *
+ * @ingroup vixen
+ * @see TextBatch TextGeometry Texture
+ */
+class GlyphAtlas : public SharedObj
+{
+public:
+	VX_DECLARE_CLASS(GlyphAtlas);
+
+	//! Construct empty atlas of the given pixel size.
+	GlyphAtlas(int width = 256, int height = 256);
+	~GlyphAtlas();
+
+	//! Set the font to copy glyphs from, empties the atlas.
+	bool			SetFont(TexFont* font);
+
+	//! Return the font glyphs are copied from.
+	TexFont*		GetFont() const			{ return m_Source; }
+
+	//! Return the texture containing the glyphs.
+	Texture*		GetTexture() const		{ return m_Texture; }
+
+	//! Return the glyph for a character, adding it to the atlas if necessary.
+	const TexGlyphVertexInfo*	GetGlyph(int c);
+
+	//! Return the number of glyphs in the atlas.
+	int				GetNumGlyphs() const	{ return m_Atlas.num_glyphs; }
+
+	//! Return the fraction of the atlas area used by glyphs.
+	float			GetUsage() const;
+
+	//! Mark the texture as changed if glyphs were added since the last call.
+	bool			UpdateTexture();
+
+	//! Remove all glyphs from the atlas.
+	void			Empty();
+
+	//! Pixels left between glyphs to prevent filtering from bleeding.
+	static int		Padding;
+
+protected:
+	/*
+	 * Horizontal segment of the top edge of the used area
+	 */
+	struct SkyNode
+	{
+		int32	X;			// left edge of segment
+		int32	Y;			// height of used area below segment
+		int32	Width;		// width of segment
+	};
+
+	bool			Pack(int w, int h, int* x, int* y);
+	int32			Fit(int32 index, int w, int h) const;
+	bool			AddGlyph(int c, const TexGlyphVertexInfo* src);
+	void			FreeGlyphs();
+
+	TexFont*		m_Source;		// font glyphs are copied from
+	TexFont			m_Atlas;		// font describing glyphs in the atlas
+	Ref<Texture>	m_Texture;		// texture referencing m_Atlas
+	SkyNode*		m_Skyline;		// segments of the top edge of the used area
+	int32			m_NumNodes;		// number of segments used
+	int32			m_MaxNodes;		// number of segments allocated
+	int32			m_UsedArea;		// number of pixels covered by glyphs
+	int32			m_PixelSize;	// bytes per pixel
+	bool			m_Changed;		// glyphs added since last texture update
+};
+
+} // end Vixen
@@ -41,11 +41,12 @@ class TriHitEvent;
  */
 class Geometry : public SharedObj
 {
+	friend class Shape;
 public:
 	VX_DECLARE_CLASS(Geometry);
 
 	//! Construct empty geometry with no appearance.
-	Geometry() : SharedObj()		{ DevHandle = 0; }
+	Geometry() : SharedObj()		{ DevHandle = 0; m_NumShapes = 0; }
 
 	//! Construct geometry which is the same as given input geometry.
 	Geometry(const Geometry&);
@@ -77,6 +78,9 @@ public:
 	//! Callback to determine sort location for Z sorting.
 	virtual Vec3	GetSortLoc() const;
 
+	//! Return the number of shapes which use this geometry.
+	int32			GetNumShapes() const	{ return m_NumShapes; }
+
 	virtual bool	Do(Messenger&, int);
 
 	enum Opcode
@@ -87,6 +91,9 @@ public:
 	};
 
 	mutable voidptr	DevHandle;
+
+protected:
+	mutable vint32	m_NumShapes;	// number of shapes referencing this geometry
 };
 
 
@@ -99,6 +106,10 @@ public:
  * This class is a base container for different types of indexed meshes.
  * The base class renders its vertex list as lines or points.
  *
+ * Indices are kept as 32 bit integers. Device index buffers are made
+ * with 16 bit indices whenever they all fit when they are uploaded
+ * (see Mesh::GetIndexSize).
+ *
  * @see TriMesh VertexArray Shape
  */
 class Mesh : public Geometry
@@ -110,6 +121,7 @@ public:
 	Mesh(int style, intptr maxvtx = 0);				//!< Construct empty mesh.
 	Mesh(const TCHAR* layout_desc, intptr maxvtx = 0);
 	Mesh(const Mesh&);								//!< Share vertices and indices with input mesh.
+	~Mesh();
 
 //	Accessors
 	VertexArray*	GetVertices();					//!< Get vertex array.
@@ -124,6 +136,8 @@ public:
 	bool			SetNumVtx(intptr);				//!< Set current number of vertices in array.
 	bool			SetMaxVtx(intptr);				//!< Set maximum vertex array size.
 	intptr			GetNumIdx() const;				//!< Return number of indices.
+	int				GetIndexSize() const;			//!< Return bytes per index on the device (2 or 4, 0 before upload).
+	void			SetIndexSize(int) const;		//!< Record bytes per index chosen by the device buffer.
 	intptr			GetIndex(intptr index) const;	//!< Get Nth vertex index from index array.
 	bool			SetIndex(intptr index, intptr v);	//!< Replace index in index array.
 	bool			AddIndex(intptr v);				//!< Append an index to index array.
@@ -133,6 +147,8 @@ public:
 	bool			SetEndVtx(intptr index);		//!< Set maximum vertex offset (internal).
 	intptr			AddIndices(const int32* intArray, intptr size);	//!< Add indices to mesh.
 	intptr			AddVertices(const float* floatArray, intptr size);	//!< Add vertices to mesh.
+	void			SetBound(const Box3& bound);	//!< Set bounding box without examining vertices.
+	static int		FindIndexSize(const IndexArray*);	//!< Return bytes per device index needed by input indices.
 
 
 //	Internal overrides
@@ -162,12 +178,16 @@ public:
 
 
 protected:
+	void				UpdateMemStats();
+
 //	Data members
 	mutable Box3		m_Bound;		// axial bounding box
 	Ref<VertexArray>	m_Verts;		// vertex array
 	Ref<IndexArray>		m_VtxIndex;		// indices into vertex array
 	intptr				m_StartVtx;		// starting vertex
 	intptr				m_EndVtx;		// ending vertex
+	intptr				m_MemCharged;	// index bytes charged to Core::MemStats
+	mutable int32		m_IndexSize;	// bytes per index in device buffer, 0 if not uploaded
 };
 
 
@@ -184,7 +204,13 @@ protected:
  * This is a device-dependent class in that some of the functionality is
  * implemented differently depending on which graphics platform is used.
  *
- * @see VertexArray Geometry Mesh
+ * A large mesh can be divided into meshlets, small clusters of
+ * consecutive triangles with their own bounding sphere and normal cone.
+ * When the mesh is culled, meshlets which are outside the view volume
+ * or which face away from the camera are culled too and only the
+ * index ranges of the others are drawn.
+ *
+ * @see VertexArray Geometry Mesh TriMesh::MakeMeshlets
  */
 class TriMesh : public Mesh
 {
@@ -218,12 +244,40 @@ public:
 		intptr			m_PrevIndex;
 	};
 
+	/*!
+	 * @brief Cluster of consecutive triangles which is culled as a unit.
+	 *
+	 * The cone contains the facing directions of all the triangles.
+	 * If the eye is far enough behind the cone, every triangle in the
+	 * meshlet faces away from it.
+	 *
+	 * @see TriMesh::MakeMeshlets
+	 */
+	struct Meshlet
+	{
+		Vec3	Center;		//!< center of bounding sphere
+		float	Radius;		//!< radius of bounding sphere
+		Vec3	ConeAxis;	//!< average facing direction of the triangles
+		float	ConeCutoff;	//!< sine of cone half angle, 1 or more if back face culling is not possible
+		int32	StartIdx;	//!< offset in index array of first index
+		int32	NumTris;	//!< number of triangles
+		int32	NumVtx;		//!< number of different vertices used
+	};
+
+	//! Default meshlet limits.
+	enum
+	{
+		MESHLET_MaxVtx = 64,	//!< maximum vertices in a meshlet
+		MESHLET_MaxTris = 124	//!< maximum triangles in a meshlet
+	};
+
 	//! Construct empty triangle mesh with given vertex style and size.
 	TriMesh(int style = 0, intptr nvtx = 0);
 	TriMesh(const TCHAR* layout_desc, intptr nvtx = 0);
 
 	//! Construct triangle mesh like input mesh.
 	TriMesh(const TriMesh&);
+	~TriMesh();
 
 	//! Returns number of triangles in the mesh.
 	virtual intptr	GetNumFaces() const;
@@ -231,10 +285,28 @@ public:
 	//! Generate normals for the triangles in the mesh.
 	virtual bool	MakeNormals(bool noclear = false);
 
+	//! Divide the triangles into meshlets which are culled separately.
+	bool			MakeMeshlets(int maxvtx = MESHLET_MaxVtx, int maxtris = MESHLET_MaxTris);
+
+	//! Discard the meshlets.
+	void			EmptyMeshlets();
+
+	//! Returns number of meshlets, 0 if mesh is not divided.
+	int32			GetNumMeshlets() const	{ return m_NumMeshlets; }
+
+	//! Returns meshlet array.
+	const Meshlet*	GetMeshlets() const		{ return m_Meshlets; }
+
+	//! Returns index ranges of the meshlets which were not culled.
+	int32			GetDrawRanges(const int32** ranges) const;
+
 	//! Perform ray / triangle intersection
 	static bool		TriHit(const Ray& ray, const Vec3& V0, const Vec3& V1, const Vec3& V2, Vec3* intersect);
 
 	// Internal overrides
+	virtual intptr	Cull(const Matrix*, Scene*);
+	virtual void	Empty();
+	virtual bool	Copy(const SharedObj*);
 	virtual bool	Do(Messenger&, int);
 	virtual	bool	Hit(const Ray& ray, TriHitEvent* hitinfo) const;
 
@@ -246,6 +318,14 @@ public:
 		TRIMESH_MakeNormals = MESH_NextOp,
 		TRIMESH_NextOp = MESH_NextOp + 20
 	};
+
+protected:
+	bool			CopyMeshlets(const TriMesh* src);
+
+	Meshlet*		m_Meshlets;		// meshlets, NULL if not divided
+	int32			m_NumMeshlets;	// number of meshlets
+	int32*			m_DrawRanges;	// first index and number of indices of visible meshlets
+	int32			m_NumRanges;	// number of draw ranges, 0 to draw all indices
 };
 
 /*!
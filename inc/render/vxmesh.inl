@@ -18,6 +18,35 @@ inline intptr Mesh::GetNumIdx() const
 	return m_VtxIndex->GetSize();
 }
 
+/*!
+ * @fn int Mesh::GetIndexSize() const
+ *
+ * Returns the number of bytes each index uses in the device index buffer.
+ * If every index in the mesh fits in 16 bits, the device buffer uses
+ * 16 bit indices which halves the index memory and bandwidth.
+ * The size is decided by the device buffer when it uploads the indices
+ * so it always describes the data on the device.
+ *
+ * @return 2 for 16 bit indices, 4 for 32 bit indices,
+ *			0 if the indices have not been uploaded
+ *
+ * @see Mesh::FindIndexSize Mesh::SetIndexSize
+ */
+inline int Mesh::GetIndexSize() const
+	{ return m_IndexSize; }
+
+/*!
+ * @fn void Mesh::SetIndexSize(int idxsize) const
+ * @param idxsize	bytes per index in the device buffer, 2 or 4
+ *
+ * Called by the renderer after it uploads the indices to a device
+ * index buffer to record the index size the buffer was made with.
+ *
+ * @see Mesh::GetIndexSize Mesh::FindIndexSize
+ */
+inline void Mesh::SetIndexSize(int idxsize) const
+	{ m_IndexSize = idxsize; }
+
 inline intptr Mesh::GetIndex(intptr i) const
 {
 	const IndexArray* idx = m_VtxIndex;
@@ -108,6 +137,19 @@ inline bool Mesh::GetBound(Box3* bound) const
 	return true;
 }
 
+/*!
+ * @fn void Mesh::SetBound(const Box3& bound)
+ * @param bound	new bounding box for the vertices
+ *
+ * Replaces the bounding box returned by Mesh::GetBound.
+ * Deformers which already know the bounds of the vertices
+ * they produce use this so the vertices are not examined again.
+ *
+ * @see Mesh::GetBound Deformer::UpdateBound
+ */
+inline void Mesh::SetBound(const Box3& bound)
+	{ m_Bound = bound; }
+
 /*!
  * @fn Geometry& Mesh::operator*=(const Matrix& trans)
  *
@@ -121,6 +163,26 @@ inline bool Mesh::GetBound(Box3* bound) const
 inline Geometry& Mesh::operator*=(const Matrix& trans)
 	{ *((VertexArray*) m_Verts) *= trans; Touch(); m_Bound.Empty(); return *this; }
 
+/*!
+ * @fn int32 TriMesh::GetDrawRanges(const int32** ranges) const
+ * @param ranges	gets pointer to pairs of integers, the offset of the
+ *					first index and the number of indices of each range
+ *
+ * Returns the index ranges to draw after the mesh was culled.
+ * Consecutive meshlets which are visible are combined into one range.
+ * If the mesh is not divided into meshlets or all of them are
+ * visible, there are no ranges and all of the indices are drawn.
+ *
+ * @return number of index ranges, 0 to draw the whole mesh
+ *
+ * @see TriMesh::Cull TriMesh::MakeMeshlets
+ */
+inline int32 TriMesh::GetDrawRanges(const int32** ranges) const
+{
+	*ranges = m_DrawRanges;
+	return m_NumRanges;
+}
+
 /*!
  * @fn Vec3 Geometry::GetSortLoc() const
  *
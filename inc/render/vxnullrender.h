@@ -0,0 +1,94 @@
+/*!
+ * @file vxnullrender.h
+ * @brief Renderer which does not draw anything but counts what it would submit.
+ *
+ * @ingroup vixenint
+ * @see vxgeosort.h
+ */
+#pragma once
+
+namespace Vixen {
+
+/*!
+ * @class NullRenderer
+ * @brief State sorting renderer which counts device work instead of drawing.
+ *
+ * The null renderer does everything the GeoSorter does
+ * (culling, state sorting, light selection) but instead of
+ * calling a graphics device it records how many meshes,
+ * primitives, vertices and indices would have been submitted,
+ * how many times the render state and the world matrix changed
+ * and how many bytes of geometry would have been sent to the device.
+ * Instance batches count as a single draw call so the reduction
+ * in draw calls from instancing is Counts::Instances - Counts::Batches.
+ * Materials are uploaded like a device renderer with per-material
+ * constant buffers would, only the changed range of each one is counted.
+ * Index bytes are counted at the size the device buffer would use
+ * (16 bit when possible) and meshlets culled by TriMesh::Cull are not counted.
+ * It is used for headless benchmarking and for platforms without
+ * a graphics device.
+ *
+ * The counts for the last frame are available from
+ * NullRenderer::GetFrameCounts, the accumulated counts since the
+ * last call to NullRenderer::ResetCounts from NullRenderer::GetTotalCounts.
+ * The scene statistics (SceneStats::PrimsRendered and
+ * SceneStats::RenderStateChanges) are updated the same way
+ * device renderers update them.
+ *
+ * @ingroup vixenint
+ * @see GeoSorter SceneStats
+ * @internal
+ */
+class NullRenderer : public GeoSorter
+{
+public:
+	//! Device work counted by the null renderer.
+	struct Counts
+	{
+		int64	Frames;			//!< number of frames rendered
+		int64	Meshes;			//!< number of meshes (draw calls) submitted
+		int64	Prims;			//!< number of primitives (triangles, lines, points)
+		int64	Verts;			//!< number of vertices referenced
+		int64	Indices;		//!< number of indices referenced
+		int64	StateChanges;	//!< number of appearance changes
+		int64	MatrixChanges;	//!< number of world matrix changes
+		int64	Bytes;			//!< vertex, index and instance bytes submitted
+		int64	Batches;		//!< number of instance batches submitted
+		int64	Instances;		//!< number of meshes rendered as instances
+		int64	ConstantUploads;	//!< number of material buffers uploaded
+		int64	ConstantBytes;		//!< changed material bytes uploaded
+		int64	Ranges;			//!< number of meshlet index ranges drawn
+	};
+
+	VX_DECLARE_CLASS(NullRenderer);
+
+	NullRenderer(int options = 0);
+
+	virtual bool	Init(Scene* scene, Vixen::Window win, const TCHAR* options);
+	virtual void	Begin(int changed, int frame);
+	virtual	void	End(int frame);
+	virtual	void	RenderMesh(const Geometry* geo, const Appearance* appear, const Matrix* mtx);
+	virtual	void	RenderInstances(const Geometry* geo, const Appearance* appear, const Instance* inst, int n);
+	virtual void	Print(DebugOut& dbg = vixen_debug) const;
+
+	//! Returns the device work counted for the last frame.
+	const Counts&	GetFrameCounts() const	{ return m_LastFrame; }
+
+	//! Returns the device work counted since the last reset.
+	const Counts&	GetTotalCounts() const	{ return m_Total; }
+
+	//! Discard accumulated counts.
+	void			ResetCounts();
+
+protected:
+	static void		ClearCounts(Counts&);
+	void			CountMesh(const Geometry* geo, const Appearance* appear, int ninst);
+
+	Counts				m_Frame;		// counts for frame being rendered
+	Counts				m_LastFrame;	// counts for last completed frame
+	Counts				m_Total;		// accumulated counts
+	const Appearance*	m_CurAppear;	// last appearance submitted
+	const Matrix*		m_CurMatrix;	// last world matrix submitted
+};
+
+} // end Vixen
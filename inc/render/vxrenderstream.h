@@ -0,0 +1,188 @@
+/*!
+ * @file vxrenderstream.h
+ * @brief Device independent stream of rendering commands.
+ *
+ * The state sorter can record the commands to render a frame
+ * instead of calling the renderer directly. The commands can be
+ * replayed against any renderer, saved to a file and compared.
+ *
+ * @author Nola Donato
+ * @ingroup vixenint
+ *
+ * @see vxgeosort.h vxnullrender.h
+ */
+#pragma once
+
+namespace Vixen {
+
+/*!
+ * @class RenderStream
+ * @brief Compact binary rendering commands which can be recorded, saved and replayed.
+ *
+ * A render stream is an array of 32 bit words. Each command starts with
+ * a word which has the command code in the low 8 bits and the number
+ * of words in the command (including the first) in the rest.
+ * Geometry and appearances are referred to by their index in the
+ * object table of the stream, which holds a reference to each one.
+ * @code
+ *	CMD_Frame		<frame>
+ *	CMD_Appearance	<object>
+ *	CMD_Matrix		<12 floats, rows 0 - 2 of world matrix>
+ *	CMD_Identity
+ *	CMD_Lights		<n> <n 16 bit light IDs, two per word>
+ *	CMD_Draw		<object>
+ *	CMD_Instances	<object> <n> <n Renderer::Instance structures>
+ * @endcode
+ *
+ * Lights are identified by their slot in the light list of the
+ * renderer (GPULight::ID) rather than by a bit mask, so scenes with
+ * more lights than fit in a mask can be recorded. A light command
+ * holds at most LIGHT_MaxLights IDs, the ones nearest the following
+ * draws, packed two to a word in native byte order with the unused
+ * half of the last word zero. Commands are checked against their
+ * length before replay so corrupt streams are rejected.
+ *
+ * Recording filters redundant state: an appearance, matrix or light
+ * list is only recorded when it differs from the last one recorded.
+ * RenderStream::Replay calls Renderer::RenderMesh and Renderer::RenderInstances
+ * for the draw commands with the current state.
+ *
+ * A stream can only be recorded by one thread at a time but different
+ * threads can record into different streams. RenderStream::Append
+ * concatenates streams so the parts of a frame may be recorded in parallel
+ * and replayed in order.
+ *
+ * Streams are saved with the Vixen binary protocol along with the
+ * objects they refer to. RenderStream::Write and RenderStream::Read save
+ * and load one stream in a file, so a frame captured from an application
+ * can be replayed against the NullRenderer for benchmarking and
+ * compared to other frames with RenderStream::Compare.
+ *
+ * @ingroup vixenint
+ * @see GeoSorter::Record NullRenderer Renderer::RenderMesh
+ * @internal
+ */
+class RenderStream : public SharedObj
+{
+public:
+	VX_DECLARE_CLASS(RenderStream);
+
+	//! Rendering command codes.
+	enum Command
+	{
+		CMD_Frame = 1,		//!< start of frame
+		CMD_Appearance,		//!< set appearance for the following draws
+		CMD_Matrix,			//!< set world matrix for the following draws
+		CMD_Identity,		//!< set identity world matrix
+		CMD_Lights,			//!< set lights which illuminate the following draws
+		CMD_Draw,			//!< draw geometry
+		CMD_Instances,		//!< draw copies of geometry
+		CMD_MaxCommand
+	};
+
+	enum Opcode
+	{
+		RSTREAM_AddObject = SharedObj::OBJ_NextOp,
+		RSTREAM_SetCommands,
+		RSTREAM_NextOp = SharedObj::OBJ_NextOp + 10,
+	};
+
+	RenderStream();
+	~RenderStream();
+
+	//! Discard all commands and objects.
+	void			Empty();
+
+	//! Record the start of a frame.
+	void			BeginFrame(int32 frame);
+
+	//! Record the appearance used by the following draws.
+	void			SetAppearance(const Appearance* appear);
+
+	//! Record the world matrix used by the following draws.
+	void			SetMatrix(const Matrix* mtx);
+
+	//! Record the lights used by the following draws.
+	void			SetLights(const uint16* ids, int n);
+
+	//! Record drawing geometry with the current state.
+	void			Draw(const Geometry* geo);
+
+	//! Record drawing copies of geometry, return the instance array to fill in.
+	Renderer::Instance*	DrawInstances(const Geometry* geo, int n);
+
+	//! Add the commands from another stream to the end of this one.
+	bool			Append(const RenderStream& src);
+
+	//! Call the renderer for each command, return the number of draws.
+	int				Replay(Renderer* render) const;
+
+	//! Compare to another stream, return index of first different command or -1.
+	int32			Compare(const RenderStream& src) const;
+
+	//! Return the number of 32 bit words of commands.
+	int32			GetSize() const			{ return m_Size; }
+
+	//! Return the number of commands.
+	int32			GetNumCommands() const	{ return m_NumCommands; }
+
+	//! Return the number of objects referenced.
+	int32			GetNumObjects() const	{ return m_NumObjects; }
+
+	//! Return an object referenced by the commands.
+	const SharedObj*	GetObj(int32 index) const;
+
+	//! Save the stream and the objects it references in a file.
+	bool			Write(const TCHAR* filename);
+
+	//! Load a stream saved by RenderStream::Write.
+	bool			Read(const TCHAR* filename);
+
+	// overrides
+	virtual bool		Copy(const SharedObj*);
+	virtual int			Save(Messenger&, int) const;
+	virtual bool		Do(Messenger& s, int opcode);
+	virtual DebugOut&	Print(DebugOut& dbg = vixen_debug, int opts = SharedObj::PRINT_Default) const;
+
+protected:
+	/*
+	 * Entry in the table which finds the index of an object
+	 */
+	struct Slot
+	{
+		const SharedObj*	Obj;	// object referenced, NULL if slot is empty
+		int32				Index;	// index of object in m_Objects
+	};
+
+	int32*			Reserve(int cmd, int32 nwords);
+	int32			AddObject(const SharedObj* obj);
+	bool			GrowHash(int32 size);
+	void			ResetState();
+	static bool		SameObject(const SharedObj* obj1, const SharedObj* obj2);
+
+	int32*			m_Data;				// command words
+	int32			m_Size;				// number of words used
+	int32			m_MaxSize;			// number of words allocated
+	int32			m_NumCommands;		// number of commands recorded
+	ObjArray		m_Objects;			// references to objects used by commands
+	const SharedObj**	m_Ptrs;			// addresses of objects used by commands
+	int32			m_NumObjects;		// number of objects referenced
+	int32			m_MaxObjects;		// number of object addresses allocated
+	Slot*			m_Hash;				// finds object index from address
+	int32			m_HashSize;			// number of hash slots, power of 2
+	int32			m_CurAppear;		// index of last appearance recorded, -1 if none
+	uint16			m_CurLights[LIGHT_MaxLights];	// last light IDs recorded
+	int32			m_NumCurLights;		// number of light IDs in m_CurLights
+	bool			m_HasLights;		// a light list has been recorded
+	int				m_MatrixState;		// 0 = none recorded, 1 = identity, 2 = m_CurMatrix
+	float			m_CurMatrix[12];	// last world matrix recorded
+};
+
+inline const SharedObj* RenderStream::GetObj(int32 index) const
+{
+	if ((index < 0) || (index >= m_NumObjects))
+		return NULL;
+	return m_Ptrs[index];
+}
+
+} // end Vixen
@@ -0,0 +1,108 @@
+/*!
+ * @file vxtextbatch.h
+ * @brief Geometry which draws many text labels at once.
+ *
+ * @author Nola Donato
+ * @ingroup vixen
+ *
+ * @see vxglyphatlas.h vxtextgeom.h vxmesh.h
+ */
+#pragma once
+
+namespace Vixen {
+
+/*!
+ * @class TextBatch
+ * @brief Triangle mesh containing the glyphs for a set of text labels.
+ *
+ * All of the labels in a batch use the same glyph atlas and appearance
+ * so the whole batch is a single mesh drawn with one call.
+ * Each label owns a run of glyph rectangles in the vertex array with
+ * room for a few more characters than it currently has. Changing the
+ * text of a label only rewrites its own vertices, unused rectangles
+ * are collapsed to a point. A label whose text outgrows its run is moved
+ * to the end of the vertex array and the space it leaves is reclaimed
+ * by TextBatch::Compact once enough has accumulated.
+ * Every change to the labels touches the batch (Geometry::Touch)
+ * so renderers reload its vertices before it is drawn again.
+ *
+ * The vertices have the same layout as TextGeometry: location, color and
+ * texture coordinates. To display the batch, put it in a shape whose
+ * appearance uses the atlas texture, GlyphAtlas::GetTexture, in its sampler.
+ * Labels are not saved, a saved batch loads as a static mesh.
+ *
+ * @ingroup vixen
+ * @see GlyphAtlas TextGeometry TriMesh
+ */
+class TextBatch : public TriMesh
+{
+public:
+	VX_DECLARE_CLASS(TextBatch);
+
+	//! Construct empty batch which gets its glyphs from the given atlas.
+	TextBatch(GlyphAtlas* atlas = NULL);
+	~TextBatch();
+
+	//! Set the atlas glyphs come from, empties the batch.
+	void			SetAtlas(GlyphAtlas* atlas);
+
+	//! Return the atlas glyphs come from.
+	GlyphAtlas*		GetAtlas() const		{ return m_Atlas; }
+
+	//! Add a label to the batch, return its index.
+	int32			AddLabel(const TCHAR* text, const Vec3& pos, float size = 1.0f, const Col4& color = Col4(1, 1, 1));
+
+	//! Change the text of a label.
+	bool			SetLabelText(int32 label, const TCHAR* text);
+
+	//! Move a label.
+	bool			SetLabelPos(int32 label, const Vec3& pos);
+
+	//! Change the color of a label.
+	bool			SetLabelColor(int32 label, const Col4& color);
+
+	//! Remove a label from the batch.
+	bool			RemoveLabel(int32 label);
+
+	//! Return the number of labels in the batch.
+	int32			GetNumLabels() const	{ return m_NumLabels - m_NumFree; }
+
+	//! Reclaim the vertices left behind by moved and removed labels.
+	void			Compact();
+
+//	Internal overrides
+	virtual void	Empty();
+	virtual intptr	Cull(const Matrix*, Scene*);
+	virtual bool	GetBound(Box3*) const;
+	virtual bool	Copy(const SharedObj*);
+	virtual DebugOut&	Print(DebugOut& = vixen_debug, int opts = SharedObj::PRINT_Default) const;
+
+protected:
+	/*
+	 * Location, size and vertex run of a single label
+	 */
+	struct Label
+	{
+		Vec3	Pos;		// location of baseline of first character
+		float	Size;		// height of a line of text
+		uint32	Color;		// packed vertex color
+		int32	FirstVtx;	// first vertex of glyph rectangles, -1 if label is unused
+		int32	MaxGlyphs;	// number of glyph rectangles allocated
+		int32	NumGlyphs;	// number of glyph rectangles used
+	};
+
+	int32			AllocGlyphs(int32 n);
+	int32			WriteGlyphs(Label& label, const TCHAR* text);
+	void			ClearGlyphs(const Label& label, int32 first, int32 last);
+	static int32	CountGlyphs(const TCHAR* text);
+
+	Ref<GlyphAtlas>	m_Atlas;		// atlas glyphs come from
+	Label*			m_Labels;		// label table
+	int32			m_NumLabels;	// number of label table entries used
+	int32			m_MaxLabels;	// number of label table entries allocated
+	int32			m_NumFree;		// number of removed labels in the table
+	int32			m_NumGlyphs;	// number of glyph rectangles in the vertex array
+	int32			m_WastedGlyphs;	// glyph rectangles not owned by any label
+};
+
+} // end Vixen
@@ -28,6 +28,7 @@ public:
 	VertexArray(int style = VertexPool::NORMALS, intptr size = 0);
 	VertexArray(const TCHAR* layout_desc, intptr size = 0);
 	VertexArray(const VertexArray&);
+	~VertexArray();
 
 //!	Retrieve device-dependent pointer to vertex data information
 	virtual	const float*	GetData() const;
@@ -42,7 +43,10 @@ public:
 	static	Core::Allocator*	VertexAlloc;
 
 protected:
+	void			UpdateMemStats();
+
 	FloatArray		m_Data;		// vertex data
+	intptr			m_MemCharged;	// vertex bytes charged to Core::MemStats
 };
 
 } // end Vixen
\ No newline at end of file
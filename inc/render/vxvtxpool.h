@@ -43,6 +43,13 @@ struct VXOpcode;
  * what is required by the underlying renderer so that vertices
  * may be quickly copied without reformatting.
  *
+ * To save memory and bandwidth, layouts may store components in
+ * compact formats: half float texture coordinates, octahedral or
+ * 10:10:10:2 normals and 16 bit locations which are scaled and offset
+ * to fit the bounds of the pool. These components cannot be accessed as floats,
+ * use VertexPool::DecodeIter to read them and VertexPool::Convert to
+ * make a compact pool from a float one.
+ *
  * @ingroup vixen
  * @see Geometry TriMesh Mesh VertexArray DataLayout
  */
@@ -202,6 +209,86 @@ public:
 		}
 	};
 
+	/*!
+	 * @brief Vertex pool iterator which decodes compact vertex formats.
+	 *
+	 * Components stored in a compact format (half float, quantized,
+	 * octahedral or 10:10:10:2) cannot be used directly as floats.
+	 * This iterator returns the location, normal and first texture
+	 * coordinates of a vertex as floats whatever format they are stored in.
+	 * It also works for float layouts, so code which only reads vertices
+	 * (picking, bounds, normal generation) can use it for any pool.
+	 * Do not delete or resize the vertex array while you are iterating.
+	 *
+	 * @code
+	 *	VertexPool::DecodeIter	iter(verts);
+	 *	Vec3					loc;
+	 *
+	 *	while (iter.Next())
+	 *	{
+	 *		iter.GetLoc(loc);
+	 *		...
+	 *	}
+	 * @endcode
+	 *
+	 * @ingroup vixen
+	 * @see VertexPool::ConstIter DataLayout::SetDescriptor VertexPool::Convert
+	 */
+	class DecodeIter
+	{
+	public:
+		DecodeIter() : m_Data(NULL), m_NumVtx(0), m_VtxSize(0), m_CurVtx(-1), m_Loc(NULL), m_Normal(NULL), m_TexCoord(NULL) { }
+		DecodeIter(const VertexPool& verts)	{ Init(&verts); }
+		DecodeIter(const VertexPool* verts)	{ Init(verts); }
+
+		//! Initialize iterator to a specific vertex array.
+		void	Init(const VertexPool* verts);
+
+		//! Advance iterator to next vertex, returns \b false at the end.
+		bool	Next()						{ return ++m_CurVtx < m_NumVtx; }
+
+		//! Reset iterator to start at first vertex.
+		void	Reset()						{ m_CurVtx = -1; }
+
+		//! Get the index of the current vertex.
+		intptr	GetIndex() const			{ return m_CurVtx; }
+
+		//! Get the number of vertices being iterated.
+		intptr	GetNumVtx() const			{ return m_NumVtx; }
+
+		//! Return true if the vertices have normals.
+		bool	HasNormals() const			{ return m_Normal != NULL; }
+
+		//! Return true if the vertices have texture coordinates.
+		bool	HasTexCoords() const		{ return m_TexCoord != NULL; }
+
+		//! Get location of current vertex.
+		void	GetLoc(Vec3& loc) const		{ GetLoc(m_CurVtx, loc); }
+
+		//! Get location of Ith vertex.
+		void	GetLoc(intptr i, Vec3& loc) const;
+
+		//! Get normal of current vertex, returns \b false if no normals.
+		bool	GetNormal(Vec3& nml) const	{ return GetNormal(m_CurVtx, nml); }
+
+		//! Get normal of Ith vertex, returns \b false if no normals.
+		bool	GetNormal(intptr i, Vec3& nml) const;
+
+		//! Get first texture coordinates of Ith vertex, returns \b false if none.
+		bool	GetTexCoord(intptr i, Vec2& uv) const;
+
+	protected:
+		const int32*		m_Data;
+		intptr				m_NumVtx;
+		int					m_VtxSize;
+		intptr				m_CurVtx;
+		const LayoutSlot*	m_Loc;
+		const LayoutSlot*	m_Normal;
+		const LayoutSlot*	m_TexCoord;
+		Vec3				m_QuantScale;
+		Vec3				m_QuantOffset;
+	};
+
 	/*!
 	 * @brief vertex style values, indicates components in vertex layout.
 	 * @see VertexPool::SetLayout VertexPool::SetStyle
@@ -221,6 +308,20 @@ public:
 		MAX_VTX_SIZE =	64,				//!< maximum # floats/vertex
 	};
 
+	/*!
+	 * @brief Options for VertexPool::MakeCompactLayout, indicate which components to compact.
+	 */
+	enum
+	{
+		COMPACT_LOCATIONS =	1,			//!< 16 bit locations scaled to the pool bounds
+		COMPACT_NORMALS =	2,			//!< octahedral normals and tangents
+		COMPACT_TEXCOORDS =	4,			//!< half float texture coordinates
+		COMPACT_PACKED =	8,			//!< 10:10:10:2 instead of octahedral normals
+		COMPACT_SNORM =		16,			//!< 16 bit signed normalized normals and tangents
+		COMPACT_ALL =		7,			//!< compact locations, normals and texture coordinates, needs shader decoding (see SceneOptimize::ShaderDecode)
+		COMPACT_HARDWARE =	20,			//!< only formats the GPU expands: half texture coordinates, 16 bit normals
+	};
+
 public:
 	VertexPool(int style = LOCATIONS);
 	VertexPool(const TCHAR* layout_desc);
@@ -276,6 +377,48 @@ public:
 //! Transform the vertex locations and normals by the given matrix.
 	virtual	VertexPool&	operator*=(const Matrix&);
 
+//! Set the scale and offset of quantized locations to fit the given bounds.
+	void			SetQuantize(const Box3& bound);
+
+//! Set the scale and offset of quantized locations.
+	void			SetQuantize(const Vec3& scale, const Vec3& offset);
+
+//! Get the amount a quantized location changes for each step of its 16 bit value.
+	const Vec3&		GetQuantScale() const	{ return m_QuantScale; }
+
+//! Get the location which corresponds to a quantized value of zero.
+	const Vec3&		GetQuantOffset() const	{ return m_QuantOffset; }
+
+//! Replace the vertices with those of another pool converted to this pool's layout.
+	bool			Convert(const VertexPool* src);
+
+//! Make a descriptor for a compact version of a float vertex layout.
+	static bool		MakeCompactLayout(Core::String& desc, const DataLayout* layout, int opts = COMPACT_HARDWARE);
+
+//! Decode a vertex component into floats.
+	static void		DecodeSlot(const LayoutSlot& slot, const int32* vtx, float* out, const Vec3& scale, const Vec3& offset);
+
+//! Encode floats into a vertex component.
+	static void		EncodeSlot(const LayoutSlot& slot, const float* in, int32* vtx, const Vec3& scale, const Vec3& offset);
+
+//! Convert a float to a 16 bit half float.
+	static uint32	EncodeHalf(float f);
+
+//! Convert a 16 bit half float to a float.
+	static float	DecodeHalf(uint32 h);
+
+//! Encode a unit vector as two 16 bit octahedral coordinates.
+	static uint32	EncodeOctahedral(const Vec3& n);
+
+//! Decode a unit vector from two 16 bit octahedral coordinates.
+	static void		DecodeOctahedral(uint32 w, Vec3& n);
+
+//! Encode a unit vector as 10:10:10:2.
+	static uint32	EncodePacked10(const Vec3& n);
+
+//! Decode a unit vector from 10:10:10:2.
+	static void		DecodePacked10(uint32 w, Vec3& n);
+
 //	Internal overrides
 	virtual	bool		Copy(const SharedObj*);
 	virtual	bool		Do(Messenger&, int);
@@ -304,6 +447,7 @@ public:
 		VTX_SetNumTexCoords,// DEPRECATED
 		VTX_SetColors,		// DEPRECATED
 		VTX_SetLayout,
+		VTX_SetQuantize,
 		VTX_NextOp = SharedObj::OBJ_NextOp + 20
 	};
 
@@ -317,6 +461,8 @@ protected:
 	intptr				m_MaxVtx;			//!< maximum number of vertices
 	intptr volatile		m_NumVtx;			//!< current number of vertices
 	const DataLayout*	m_Layout;			//!< vertex layout description
+	Vec3				m_QuantScale;		//!< scale of quantized locations
+	Vec3				m_QuantOffset;		//!< offset of quantized locations
 	static Core::Dict<Core::String, DataLayout, BaseDict>*	s_Layouts;	//!< table of vertex layouts
 };
 
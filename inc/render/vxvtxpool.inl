@@ -31,5 +31,173 @@ inline intptr VertexPool::GetMaxVtx() const
 inline const DataLayout* VertexPool::GetLayout() const
 	{ return m_Layout; }
 
+/*!
+ * @fn float VertexPool::DecodeHalf(uint32 h)
+ * @param h	16 bit half float in the low bits
+ *
+ * Converts an IEEE half precision float to single precision.
+ * Denormals, infinities and NaNs are preserved.
+ *
+ * @see VertexPool::EncodeHalf
+ */
+inline float VertexPool::DecodeHalf(uint32 h)
+{
+	uint32	sign = (h & 0x8000) << 16;
+	uint32	exp = (h >> 10) & 0x1F;
+	uint32	mant = h & 0x3FF;
+	union { uint32 i; float f; } u;
+
+	if (exp == 0)							// zero or denormal
+	{
+		u.f = mant * (1.0f / 16777216.0f);
+		u.i |= sign;
+		return u.f;
+	}
+	if (exp == 31)							// infinity or NaN
+		u.i = sign | 0x7F800000 | (mant << 13);
+	else
+		u.i = sign | ((exp + 112) << 23) | (mant << 13);
+	return u.f;
+}
+
+/*!
+ * @fn void VertexPool::DecodeOctahedral(uint32 w, Vec3& n)
+ * @param w	two 16 bit signed coordinates, X in the low bits
+ * @param n	where to store the unit vector
+ *
+ * The unit sphere is mapped onto an octahedron which is unfolded
+ * into a square. The two coordinates give the position in the square.
+ *
+ * @see VertexPool::EncodeOctahedral
+ */
+inline void VertexPool::DecodeOctahedral(uint32 w, Vec3& n)
+{
+	float	x = float(int16(w & 0xFFFF)) * (1.0f / 32767.0f);
+	float	y = float(int16(w >> 16)) * (1.0f / 32767.0f);
+	float	z;
+
+	if (x < -1.0f) x = -1.0f;
+	if (y < -1.0f) y = -1.0f;
+	z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f)							// lower hemisphere is folded over
+	{
+		float	t = x;
+
+		x = (1.0f - fabsf(y)) * ((t >= 0.0f) ? 1.0f : -1.0f);
+		y = (1.0f - fabsf(t)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+	}
+	n.Set(x, y, z);
+	n.Normalize();
+}
+
+/*!
+ * @fn void VertexPool::DecodePacked10(uint32 w, Vec3& n)
+ * @param w	X, Y and Z as 10 bit unsigned values, X in the low bits
+ * @param n	where to store the vector
+ *
+ * Each component is mapped from [0, 1023] to [-1, 1].
+ * The top two bits are unused.
+ *
+ * @see VertexPool::EncodePacked10
+ */
+inline void VertexPool::DecodePacked10(uint32 w, Vec3& n)
+{
+	const float s = 2.0f / 1023.0f;
+
+	n.Set(float(w & 0x3FF) * s - 1.0f,
+		  float((w >> 10) & 0x3FF) * s - 1.0f,
+		  float((w >> 20) & 0x3FF) * s - 1.0f);
+}
+
+inline void VertexPool::DecodeIter::Init(const VertexPool* verts)
+{
+	const DataLayout*	layout;
+
+	VX_ASSERT(verts);
+	layout = verts->GetLayout();
+	m_Data = (const int32*) verts->GetData();
+	m_NumVtx = m_Data ? verts->GetNumVtx() : 0;
+	m_VtxSize = verts->GetVtxSize();
+	m_CurVtx = -1;
+	m_Loc = NULL;
+	m_Normal = NULL;
+	m_TexCoord = NULL;
+	m_QuantScale = verts->GetQuantScale();
+	m_QuantOffset = verts->GetQuantOffset();
+	if (layout == NULL)
+		return;
+	m_Loc = &(layout->Slot[0]);
+	for (int i = 1; i < layout->NumSlots; ++i)
+	{
+		const LayoutSlot& slot = layout->Slot[i];
+
+		if ((slot.Style & VertexPool::NORMALS) && (m_Normal == NULL))
+			m_Normal = &slot;
+		else if ((slot.Style & VertexPool::TEXCOORDS) && (m_TexCoord == NULL))
+			m_TexCoord = &slot;
+	}
+}
+
+inline void VertexPool::DecodeIter::GetLoc(intptr i, Vec3& loc) const
+{
+	const int32* p = m_Data + i * m_VtxSize + m_Loc->Offset;
+
+	VX_ASSERT((i >= 0) && (i < m_NumVtx));
+	switch (m_Loc->Format)
+	{
+		case DataLayout::QUANTIZED:
+		loc.x = m_QuantOffset.x + float(uint32(p[0]) & 0xFFFF) * m_QuantScale.x;
+		loc.y = m_QuantOffset.y + float(uint32(p[0]) >> 16) * m_QuantScale.y;
+		loc.z = m_QuantOffset.z + float(uint32(p[1]) & 0xFFFF) * m_QuantScale.z;
+		break;
+
+		case DataLayout::HALF:
+		loc.x = DecodeHalf(uint32(p[0]) & 0xFFFF);
+		loc.y = DecodeHalf(uint32(p[0]) >> 16);
+		loc.z = DecodeHalf(uint32(p[1]) & 0xFFFF);
+		break;
+
+		default:
+		loc = *((const Vec3*) p);
+	}
+}
+
+inline bool VertexPool::DecodeIter::GetNormal(intptr i, Vec3& nml) const
+{
+	if (m_Normal == NULL)
+		return false;
+	const int32* p = m_Data + i * m_VtxSize + m_Normal->Offset;
+
+	VX_ASSERT((i >= 0) && (i < m_NumVtx));
+	switch (m_Normal->Format)
+	{
+		case DataLayout::OCTAHEDRAL:	DecodeOctahedral(uint32(*p), nml); break;
+		case DataLayout::PACKED10:		DecodePacked10(uint32(*p), nml); break;
+		case DataLayout::FULL:			nml = *((const Vec3*) p); break;
+		default:
+		{
+			float	v[MAX_VTX_SIZE];
+
+			DecodeSlot(*m_Normal, m_Data + i * m_VtxSize, v, m_QuantScale, m_QuantOffset);
+			nml.Set(v[0], v[1], v[2]);
+		}
+	}
+	return true;
+}
+
+inline bool VertexPool::DecodeIter::GetTexCoord(intptr i, Vec2& uv) const
+{
+	if (m_TexCoord == NULL)
+		return false;
+	const int32* p = m_Data + i * m_VtxSize + m_TexCoord->Offset;
+
+	VX_ASSERT((i >= 0) && (i < m_NumVtx));
+	if (m_TexCoord->Format == DataLayout::HALF)
+		uv.Set(DecodeHalf(uint32(*p) & 0xFFFF), DecodeHalf(uint32(*p) >> 16));
+	else
+		uv = *((const Vec2*) p);
+	return true;
+}
+
 } // end Vixen
 
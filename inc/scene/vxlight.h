@@ -19,8 +19,7 @@ class GPULight;
 class Shader;
 class Renderer;
 
-#define	LIGHT_MaxLights		16
-#define	LIGHT_All			0xffff0000
+#define	LIGHT_MaxLights		16		// maximum number of lights which illuminate one primitive
 #define	LIGHT_NoDevice		intptr(-1)
 
 
@@ -245,11 +244,13 @@ public:
 
 	Renderer&		Render;			//!< renderer we belong to
 	int32			ID;				//!< light ID (index in light list)
-	uint32			Mask;			//!< bit mask for light
+	uint32			State;			//!< LightList state flags for this light
 	intptr			DevIndex;		//!< device index of light
 	Vec3			LocalDir;		//!< local light direction
 	const Light*	LightModel;		//!< scene light we are attached to
 	int32			Type;			//!< type of light this is
+	SlotHandle		WorldPosSlot;	//!< handle of light world position in light data buffer
+	SlotHandle		WorldDirSlot;	//!< handle of light world direction in light data buffer
 
 	/*
 	 * The phong shaders implementing lighting use these
@@ -304,6 +305,10 @@ inline GPULight*	GPULight::Clone() const
  *
  * This behavior lets you have more lights in the scene than
  * the display hardware can support by managing them efficiently.
+ * The light table grows as lights are attached, there is no limit
+ * on the number of lights in a scene. Each primitive is rendered
+ * with the (at most LIGHT_MaxLights) lights nearest to it,
+ * which LightList::LightsOn enables in the device.
  * Lights with children automatically de-activate themselves until display traversal
  * For example, a light which does not have any vertices
  * within its illumination radius deactivates itself.
@@ -349,31 +354,55 @@ public:
 	~LightList();
 
 	LightList&		operator=(const LightList&);
-	uint32	LightsActive() const	{ return m_LightsActive; }
-	uint32	LightsChanged() const	{ return m_LightsChanged; }
+	int32	GetNumActive() const	{ return m_NumActive; }
+	int32	GetNumChanged() const	{ return m_NumChanged; }
 	uint32	GetNumLights() const	{ return m_NumLights; }
-	uint32	LightsEnabled() const	{ return m_LightsOn; }
+	int32	GetMaxLights() const	{ return m_MaxLights; }
 	bool	CheckListChanged()		{ bool r = m_ListChanged; m_ListChanged = false; return r; }
+	GPULight*	GetLight(int id) const;						//!< Get light with the given ID.
+	int		GetLightsOn(const uint16** ids) const;			//!< Get IDs of lights enabled for the next primitive.
 
 	int		Attach(const Light*, GPULight* prop);		//!< Attach a light to the list.
 	void	Detach(GPULight* prop);					//!< Detach a light property from list.
 	void	DetachAll();								//!< Detach all lights from list.
-	uint32	LightsOn(uint32 mask);						//!< Enable lights in the device.
+	void	LightsOn(const uint16* ids, int n);			//!< Enable lights in the device.
 	void	LoadAll();									//!< Load all lights into device.
-	void	LightsOff(uint32 mask);						//!< Force off selected lights.
 	void	UpdateAll();								//!< Transform lights before traversal.
-	uint32	NearLights(const Model* mod, const Matrix* mtx, uint32 mask); //! Determine which lights are near a model.
+	int		NearLights(const Model* mod, const Matrix* mtx, uint16* ids, int maxids); //! Find indices of lights near a model.
+	bool	BuildClusters(const Camera* cam);			//!< Assign lights to view volume cells.
+	bool	IsClustered() const		{ return DoClusterLights && m_Cluster.IsBuilt(); }
+	const LightCluster&	GetCluster() const	{ return m_Cluster; }
+
+	/*!
+	 * @brief Values for GPULight::State.
+	 */
+	enum
+	{
+		LIGHT_Active = 1,	//!< light is active in the scene
+		LIGHT_Changed = 2,	//!< light changed this frame
+		LIGHT_Enabled = 4,	//!< light is enabled in the device
+		LIGHT_Near = 8		//!< light illuminates the next primitive (used by LightsOn)
+	};
 
 	bool	DoDistanceCull;					// cull lights based on distance from object
+	bool	DoClusterLights;				// use view volume cells to find nearby lights
 
 protected:
-	uint32		m_LightsActive;				// mask of lights active from traversal
-	uint32		m_LightsChanged;			// mask of lights changed this frame
+	bool		Grow(int32 size);
+	static void	Enable(GPULight* prop);
+	static void	Disable(GPULight* prop);
+
+	int32		m_NumActive;				// number of lights active from traversal
+	int32		m_NumChanged;				// number of lights changed this frame
 	int32		m_NumLights;				// number of lights used in scene
-	GPULight*	m_Lights[LIGHT_MaxLights];	// light properties
-	uint32		m_LightsOn;					// mask of active and enabled lights
-	uint32		m_LightsOff;				// lights to keep off
+	int32		m_MaxLights;				// number of entries in light table
+	GPULight**	m_Lights;					// light properties indexed by ID
+	Vec4*		m_LightPos;					// light positions and radii for BuildClusters
+	int32*		m_LightIDs;					// light IDs for BuildClusters
+	uint16		m_LightsOn[LIGHT_MaxLights];// IDs of lights enabled for the next primitive
+	int32		m_NumOn;					// number of IDs in m_LightsOn, -1 if all active lights are on
 	bool		m_ListChanged;				// true if items added or removed
+	LightCluster m_Cluster;					// lights for each view volume cell
 };
 
 
@@ -0,0 +1,119 @@
+/*!
+ * @file vxlightcluster.h
+ * @brief Clustered assignment of lights to view volume cells.
+ *
+ * @ingroup vixenint
+ *
+ * @see vxlight.h vxcam.h
+ */
+
+#pragma once
+
+namespace Vixen {
+
+/*!
+ * @class LightCluster
+ * @brief Divides the view volume into cells and keeps a list of lights for each cell.
+ *
+ * The view volume of the camera is divided into a grid of
+ * LightCluster::TilesX by LightCluster::TilesY tiles across the screen
+ * and LightCluster::Slices slices in depth. The slices are spaced
+ * exponentially between the hither and yon planes so cells near the
+ * camera are small. Each frame the bounding sphere of every light with an
+ * illumination radius is mapped to the range of cells it overlaps and
+ * the light is added to the light list for those cells.
+ * Lights without a radius and directional lights illuminate everything
+ * and are kept in a separate global list.
+ *
+ * To find the lights near a model, its bounding sphere is mapped
+ * to the cells it overlaps and the lights in those cells are merged.
+ * The cost depends on the number of lights near the model, not on the
+ * total number of lights in the scene. Both lights and models outside
+ * the view volume are clamped to the border cells so the result is
+ * conservative: a light whose sphere intersects the model sphere is
+ * always returned.
+ *
+ * Lights are identified by integer indices supplied when the cluster
+ * is built (for a LightList these are the light slots, GPULight::ID).
+ * The cluster does not reference any device resources and can be
+ * built and queried without a renderer.
+ *
+ * @code
+ *	LightCluster	cluster;
+ *	Vec4			lights[3] = { ... };	// world center and radius
+ *	int32			ids[3] = { 0, 1, 2 };
+ *	uint16			near[16];
+ *
+ *	cluster.Build(camera, lights, ids, 3);
+ *	int n = cluster.GetLights(model_bound, near, 16);
+ * @endcode
+ *
+ * @see LightList::BuildClusters LightList::NearLights
+ * @ingroup vixenint
+ * @internal
+ */
+class LightCluster
+{
+public:
+	LightCluster();
+	~LightCluster();
+
+	//! Assign lights to the cells of the camera view volume.
+	bool	Build(const Camera* cam, const Vec4* lights, const int32* ids, int nlights);
+
+	//! Find the lights which may illuminate a world space bounding sphere.
+	int		GetLights(const Sphere& bound, uint16* ids, int maxids) const;
+
+	//! Discard the light lists.
+	void	Empty();
+
+	//! Returns \b true if the lights have been assigned to cells.
+	bool	IsBuilt() const				{ return m_NumCells > 0; }
+
+	//! Returns number of lights in the cluster (including global lights).
+	int		GetNumLights() const		{ return m_NumLights; }
+
+	//! Returns the total number of light references in all the cells.
+	int		GetNumRefs() const			{ return m_NumRefs; }
+
+	static int	TilesX;		//!< number of tiles across the view
+	static int	TilesY;		//!< number of tiles down the view
+	static int	Slices;		//!< number of depth slices
+
+protected:
+	/*
+	 * Range of cells overlapped by a sphere
+	 */
+	struct CellRange
+	{
+		int32	X0, X1, Y0, Y1, Z0, Z1;
+	};
+
+	bool	Alloc(int nlights);
+	void	GetCellRange(float cx, float cy, float cz, float r, CellRange& range) const;
+	int		GetSlice(float depth) const;
+
+	Matrix		m_ViewTrans;	// world to camera matrix
+	bool		m_Ortho;		// true for orthographic camera
+	float		m_Left;			// X slope (or position) of left edge of view
+	float		m_Bottom;		// Y slope (or position) of bottom edge of view
+	float		m_ScaleX;		// maps X slope to tile
+	float		m_ScaleY;		// maps Y slope to tile
+	float		m_Hither;		// depth of first slice
+	float		m_LogScale;		// maps log depth to slice
+	int32		m_NumCells;		// TilesX * TilesY * Slices
+	int32		m_NumLights;	// number of lights in cluster
+	int32		m_NumRefs;		// number of light references in cells
+	int32		m_NumGlobal;	// number of global lights
+	int32*		m_CellStart;	// index of first light for each cell (NumCells + 1)
+	uint16*		m_CellLights;	// light indices for all the cells
+	uint16*		m_Global;		// lights which illuminate everything
+	int32*		m_IDs;			// light ids supplied by caller
+	CellRange*	m_Ranges;		// cell range for each light
+	float*		m_ViewPos;		// view space light centers and radii (X, Y, Z, R arrays)
+	int32		m_MaxCells;		// allocated sizes
+	int32		m_MaxRefs;
+	int32		m_MaxLights;
+};
+
+} // end Vixen
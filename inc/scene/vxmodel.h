@@ -41,6 +41,12 @@ class Scene;
  * provided to manipulate the model's matrix in intuitive terms.
  * You can also ask a model for its center and bounding box.
  *
+ * Bounding volumes are maintained incrementally. Moving a model or
+ * changing its geometry only invalidates the bounds of the model and
+ * its ancestors. Each model also keeps its bounds in the coordinates
+ * of its parent, so refitting a parent only transforms the children
+ * which changed (see Model::UpdateBounds).
+ *
  * You view the models in a hierarchy by associating them with a Scene.
  * Each frame, your application repositions the models and the scene
  * displays them. You can control how models are displayed by overriding
@@ -224,6 +230,15 @@ public:
 	//! Compute transformation matrix relative to a parent.
 	void			TotalTransform(Matrix* output, const Model* parent) const;
 
+	//! Copy cached world transformation matrix.
+	void			GetWorldTransform(Matrix* world) const;
+
+	//! Recompute cached world matrices which have changed in a hierarchy.
+	static int		UpdateWorld(const Model* root);
+
+	//! Recompute bounding volumes which have changed in a hierarchy.
+	static int		UpdateBounds(const Model* root);
+
 	//! Return number of vertices in the model and its children.
 	intptr			GetNumVtx() const;
 
@@ -297,14 +312,44 @@ protected:
 	//! Compute axially aligned bounding box for hierarchy.
 	bool			DoBounds() const;
 
+	//! Compute bounding volumes in the coordinates of the parent.
+	void			CalcParentBound(bool valid) const;
+
+	//! Remember local matrix before it changes in a simulation step.
+	void			SaveTransform();
+
+	//! Mark cached world matrices of this model and its children as invalid.
+	void			InvalidateWorld() const;
+
+	//! Compute cached world matrix from the parent world matrix.
+	void			CalcWorld(const Matrix* parentworld) const;
+
+	//! Return cached world matrix, caller holds the world matrix lock.
+	const Matrix*	FindWorld() const;
+
+	//! Mark cached world matrices invalid, caller holds the world matrix lock.
+	void			MarkWorld() const;
+
+	//! Return the lock for the cached world matrices of this hierarchy.
+	vint32*			GetWorldLock() const;
+
 //	DATA MEMBERS
 	Ref<Matrix>		m_Transform;		// local matrix
+	Ref<Matrix>		m_PrevTransform;	// local matrix before last simulation step
+	int32			m_PrevStep;			// simulation step m_PrevTransform was saved in
+	mutable Matrix	m_WorldTransform;	// cached world matrix
+	mutable bool	m_WorldDirty;		// world matrix must be recomputed
+	mutable bool	m_WorldBelow;		// world matrix of a descendant must be recomputed
+	mutable vint32	m_WorldLock;		// guards world matrices of the hierarchy, used in the root
 	mutable Sphere	m_BoundVol;			// bounding sphere
 	mutable Box3	m_BoundBox;			// bounding box
+	mutable Sphere	m_ParentVol;		// bounding sphere in parent coordinates
+	mutable Box3	m_ParentBox;		// bounding box in parent coordinates
 	mutable bits	m_Hints : 4;		// hint bits
 	mutable bits	m_NoCull : 1;		// true to suppress culling
 	mutable bits	m_NoBounds : 1;		// true if empty bounds
 	mutable bits	m_AutoBounds : 1;	// true to automatically calc bounds
+	mutable bits	m_ParentBound : 1;	// true if parent coordinate bounds are current
 	mutable bits	m_Rendered : 1;		// true if rendered
 	mutable intptr volatile m_Faces;	// number of faces in the model & children
 	mutable intptr volatile m_Verts;	// number of vertices in model & children
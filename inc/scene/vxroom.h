@@ -102,12 +102,30 @@ public:
     //!< Get hierarchy of fixtures (objects to display in the room).
     Model* GetFixture() const;
 
+	//! Get number of separately visible fixtures.
+	int GetNumFixtures() const;
+
+	//! Get a separately visible fixture.
+	Model* GetFixture(int index) const;
+
     //! Compute world planes of walls from from model planes
     void UpdateWalls(const Matrix* room_mtx);
 
 	//! Determine if room contains the origin.
 	bool ContainsOrigin();
 
+	//! Determine if room contains a point in room group coordinates.
+	bool ContainsPoint(const Vec3& p) const;
+
+	//! Get bounding box of the walls in room group coordinates.
+	const Box3& GetWallBound() const;
+
+	//! Set which parts of the room are in the potentially visible set.
+	void SetPVS(bool visible, const int32* row = NULL, int32 firstfixture = -1);
+
+	//! Determine if the room is in the potentially visible set.
+	bool IsPotentiallyVisible() const;
+
 	//! Remove matrices from room, walls and portals
  	void RemoveMatrix();
 
@@ -143,10 +161,20 @@ protected:
     Ref<Model>		m_Fixture;		// objects in the room
 	Box3				m_WallBound;
 	bool				m_ComputeNormals;	// force recalculation of wall normals
+	bool				m_PVSVisible;		// false if culled by room group PVS
+	const int32*		m_PVSRow;			// PVS bits of camera room, NULL if none
+	int32				m_PVSFixture;		// first fixture bit in PVS row
+	IntArray			m_FixtureActive;	// fixtures disabled by PVS
 
 };
 
-inline Room::Room() : Model() { m_WallBound.Empty(); }
+inline Room::Room() : Model()
+{
+	m_WallBound.Empty();
+	m_PVSVisible = true;
+	m_PVSRow = NULL;
+	m_PVSFixture = -1;
+}
 
 inline const RefArray<Model>& Room::GetWalls() const
 {
@@ -168,4 +196,14 @@ inline Model* Room::GetFixture() const
     return m_Fixture;
 }
 
+inline const Box3& Room::GetWallBound() const
+{
+	return m_WallBound;
+}
+
+inline bool Room::IsPotentiallyVisible() const
+{
+	return m_PVSVisible;
+}
+
 } // end Vixen
\ No newline at end of file
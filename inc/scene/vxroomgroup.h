@@ -42,6 +42,12 @@ namespace Vixen {
  * located outside the interior scene, and draws the shell or exterior
  * representation of the scene, if one is supplied.
  *
+ * The room group can also keep a potentially visible set (PVS) for each room
+ * which says which other rooms and fixtures can be seen from anywhere in it.
+ * It is computed once by RoomGroup::BuildPVS and saved with the scene.
+ * When the camera is in a room, the rooms and fixtures not in its set are
+ * culled by a table lookup and portal clipping is only done for the rest.
+ *
  * @see Wall Room Portal
  */
 class RoomGroup : public Model
@@ -49,6 +55,7 @@ class RoomGroup : public Model
 public:
 	VX_DECLARE_CLASS(RoomGroup);
     RoomGroup();									//!< Make empty room group.
+	~RoomGroup();
 
     // representation of room group when viewed from the outside
     void			AttachShell(Model* shell);	//!< attach a model as the shell object.
@@ -67,6 +74,11 @@ public:
 
 	void			RemoveMatrix();					// remove matrices from portal framework
 
+	//! Compute potentially visible set of each room from sample viewpoints.
+	bool			BuildPVS(int samples = 4);
+	void			ClearPVS();						//!< Discard potentially visible sets.
+	bool			HasPVS() const;					//!< Return \b true if potentially visible sets are current.
+
     // overrides
     virtual void	Display (Scene* pScene);
 	virtual int		Save(Messenger&, int) const;
@@ -77,6 +89,7 @@ public:
 	{
 		ROOMGROUP_AttachShell = Model::MOD_NextOp,
 		ROOMGROUP_AttachRoom,
+		ROOMGROUP_SetPVS,
 		ROOMGROUP_NextOp = Model::MOD_NextOp + 10,
 	};
 
@@ -86,13 +99,38 @@ protected:
 
 	void LogEvent(Room* enter, Room* exit, Camera* cam);
 
+	// allocate PVS rows for rooms and fixtures
+	bool AllocPVS(int32 nrooms, int32 nfixtures);
+
+	// add rooms and fixtures seen from a point through the portals of a room
+	void VisitPVS(Room* room, const Vec3& eye, int32* row, const Plane* planes, int nplanes, int depth);
+
+	// tell the rooms which parts are visible from the room containing the camera
+	void ApplyPVS(const Room* camroom);
+
     Ref<Model>		m_Shell;		// outside representation of room group
     RefArray<Model>	m_Rooms;		// list of managed rooms
     Ref<Room>			m_LastRoom;		// last room containing the camera
 	Matrix			m_lastMatrix;
+	int32*			m_PVSBase;		// first fixture bit of each room, then total
+	int32*			m_PVSData;		// PVS bits, one row for each room
+	int32			m_PVSRooms;		// number of rooms in the PVS
+	int32			m_PVSWords;		// number of words in a PVS row
 };
 
-inline RoomGroup::RoomGroup() : Model() { SetChanged(true); }
+inline RoomGroup::RoomGroup() : Model()
+{
+	m_PVSBase = NULL;
+	m_PVSData = NULL;
+	m_PVSRooms = 0;
+	m_PVSWords = 0;
+	SetChanged(true);
+}
+
+inline bool RoomGroup::HasPVS() const
+{
+	return (m_PVSData != NULL) && (m_PVSRooms == m_Rooms.GetSize());
+}
 
 
 inline const Model* RoomGroup::GetShell () const
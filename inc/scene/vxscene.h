@@ -105,6 +105,7 @@ public:
 		uint32	ThreadType;			//!< type of thread
 		int32	Frame;				//!< frame counter
 		int32	ThreadIndex;		//!< 0 based thread index
+		int32	SimStep;			//!< fixed simulation step this thread is running, 0 if none
 	};
 
 	/*!
@@ -176,6 +177,7 @@ public:
 	virtual void	SetModels(const Model*);	//!< set model hierarchy to display.
 	virtual void	SetEngines(const Engine*);	//!< set simulation hierarchy.
 	virtual void	SetTimeInc(float timeinc);	//!< set time increment between frames.
+	virtual void	SetSimStep(float step);		//!< set fixed simulation time step.
 	virtual bool	SetWindow(Window win);		//!< set window to use for display.
 	virtual	void	Append(Scene* child);		//!< add child scene which shares this scene's context
 	virtual const Shader*	InstallShader(const Shader*);	//!< install a shader for global use
@@ -197,6 +199,9 @@ public:
 	bool			IsAutoAdjust() const;		//!< return \b true if camera autoadjusts.
 	float			GetTime() const;			//!< get time this frame started.
 	float			GetTimeInc() const;			//!< get time increment between frames.
+	float			GetSimStep() const;			//!< get fixed simulation time step.
+	float			GetSimAlpha() const;		//!< get interpolation factor between simulation steps.
+	int32			GetLastSimStep() const;		//!< get identifier of last simulation step @internal
 	bool			GetBound(Sphere* sphere) const; //!< get bounding sphere for entire hierarchy.
 	SceneStats*		GetStats() const;			//!< get scene display statistics.
 	Appearance*		GetPostProcess() const;		//!< get appearance used for pixel post-processing
@@ -247,6 +252,7 @@ public:
 	void				InitThreadGlobals();			//!< initialize thread storage @internal
 	static	int			NumTexUnits;					//!< number of texture units in device
 	static	int			DeviceDepth;					//!< desired framebuffer depth
+	static	int			MaxSimSteps;					//!< maximum simulation steps per frame
 	static	bool		SupportDDS;						//!< device supports compressed textures
 	static const TCHAR*	RenderOptions;					//!< renderer-specific options
 	static	Core::ThreadFunc FrameFunc;					//!< thread function for scene graph display
@@ -259,6 +265,7 @@ public:
 
 protected:
 	void				Empty();						//!< empty scene, dereference all nodes @internal
+	void				RebaseTime(double base);		//!< move origin of engine time @internal
 	virtual	bool		Run(Window);					//!< start up scene display threads
 	virtual void		AllowUpdate();					//!< allow scene update by foreign threads @internal
 	DeviceInfo*			MakeDevInfo(const DeviceInfo* = NULL);	//!< make device descriptor @internal
@@ -272,6 +279,13 @@ protected:
 	vint32			m_Options;
 	float			m_Time;
 	float			m_TimeInc;
+	float			m_SimStep;			// fixed simulation time step (0 = once per frame)
+	float			m_SimAlpha;			// interpolation factor for rendering between steps
+	double			m_SimTime;			// time of last simulation step
+	double			m_TimeBase;			// simulation time engine time is relative to
+	double			m_SimAccum;			// real time not yet simulated
+	double			m_RealTime;			// real time at start of last frame
+	int32			m_LastSimStep;		// identifier of last simulation step
 	Box2			m_Viewport;
 	Col4			m_BackColor;
 	Ref<Model>		m_Models;
@@ -279,6 +293,7 @@ protected:
 	Ref<Bitmap>		m_ColorBuffer;
 	Ref<Bitmap>		m_DepthBuffer;
 	Ref<Engine>		m_Engines;
+	Ref<Engine>		m_BasedEngines;		// engines whose start times are relative to m_TimeBase
 	Ref<Appearance>	m_PostProcess;
 	mutable Ref<Light>	m_Ambient;		// ambient light source
 
@@ -68,6 +68,15 @@ inline Bitmap* Scene::GetDepthBuffer() const
 inline float Scene::GetTimeInc() const
 	{ return m_TimeInc; }
 
+inline float Scene::GetSimStep() const
+	{ return m_SimStep; }
+
+inline float Scene::GetSimAlpha() const
+	{ return m_SimAlpha; }
+
+inline int32 Scene::GetLastSimStep() const
+	{ return m_LastSimStep; }
+
 inline Renderer*	Scene::GetRenderer() const
 	{ return m_Renderer; }
 
@@ -51,6 +51,8 @@ public:
 	//! Construct shape that is a copy of another shape
 	Shape(const Shape& s): Model() { Copy(&s); }
 
+	~Shape();
+
 	//! Get the geometry to render
 	Geometry*			GetGeometry();
 	const Geometry*		GetGeometry() const;
@@ -96,6 +98,8 @@ public:
 		SHAPE_NextOp = Model::MOD_NextOp + 10
 	};
 protected:
+	void				ReplaceGeometry(const Geometry*);
+
 //	Data members
 	Ref<Geometry>		m_Geometry;
 	Ref<Appearance>	m_Appearance;
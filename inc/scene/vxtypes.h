@@ -108,7 +108,7 @@ enum SerialID
 	VX_Pose = 128,
 	VX_Skin = 129,
 
-	//	130,
+	VX_ClipInterp = 130,
 	VX_TimeInterp = 131,
 	VX_PoseMapper = 132,
 	VX_Physics = 133,
@@ -139,6 +139,11 @@ enum SerialID
 	VX_BodyTracker,		// 226
 	VX_KinectTracker,	// 227
 	VX_OmekTracker,		// 228
+	VX_ReplayTracker,	// 229
+	VX_BlendTree,		// 230
+	VX_BlendGroup,		// 231
+	VX_RenderStream,	// 232
+	VX_TextBatch,		// 233
 };
 
 /*
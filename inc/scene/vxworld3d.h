@@ -166,7 +166,7 @@ class SceneLoader : public FileLoader
 {
 public:
 	VX_DECLARE_CLASS(SceneLoader);
-	SceneLoader() : FileLoader() { m_LastDict = NULL; }
+	SceneLoader() : FileLoader() { m_LastDict = NULL; m_LastChunks = NULL; }
 //! Return the dictionary for the given scene.
 	NameTable*	GetSceneDict(const TCHAR* scenename) const;
 //!	Set the dictionary for the given scene.
@@ -179,10 +179,20 @@ public:
 	void		Unload(const TCHAR* filename);
 //!	Read a file and send an event to the observer.
 	static bool	ReadScene(const TCHAR* fname, Core::Stream* instream, LoadEvent* event);
+//! Open a chunked scene file for loading subtrees on demand.
+	bool		OpenScene(const TCHAR* filename);
 	void		Kill();
 
+//! Function called to process each scene after it is read and before it is displayed.
+	typedef bool PostLoadFunc(Scene* scene, const TCHAR* filename);
+	static PostLoadFunc*	PostLoad;
+
 protected:	
-	NameTable*	m_LastDict;			// dictionary of last file loaded
+	ChunkMessenger*	GetChunks(const TCHAR* scenename) const;
+	void			SetChunks(const TCHAR* scenename, ChunkMessenger* chunks);
+
+	NameTable*		m_LastDict;			// dictionary of last file loaded
+	ChunkMessenger*	m_LastChunks;		// last chunked file opened
 };
 
 } // end Vixen
\ No newline at end of file
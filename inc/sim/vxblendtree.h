@@ -0,0 +1,234 @@
+/*!
+ * @file vxblendtree.h
+ * @brief Blend trees which compute skeleton poses from animation clips.
+ *
+ * A blend tree combines several animation clips into one pose
+ * for a skeleton: locomotion clips are interpolated by speed,
+ * additive clips lean or breathe on top of them and masked layers
+ * replace part of the body with another motion. The poses are
+ * computed into structure of arrays buffers so the blends are
+ * simple loops over all the bones.
+ *
+ * @author Nola Donato
+ * @ingroup vixen
+ *
+ * @see vxclip.h vxskeleton.h
+ */
+#pragma once
+
+namespace Vixen {
+
+#define	BLEND_MaxThreads	16		// most threads used to evaluate blend trees
+#define	BLEND_SpinCount		4000	// times an idle blend thread polls before sleeping
+
+/*!
+ * @class BlendTree
+ * @brief Engine which poses a skeleton by blending animation clips.
+ *
+ * The target of a blend tree is a Skeleton. The tree is a list of nodes,
+ * each of which computes the local rotation of every bone and the position
+ * of the root. A node only uses the results of nodes added before it,
+ * so the nodes are evaluated in the order they were added. The result of
+ * the output node (the last one added unless BlendTree::SetOutput is called)
+ * is applied to the bone transformers of the skeleton.
+ *
+ * Node types are:
+ * @code
+ *	CLIP		samples an animation clip, bones the clip does not animate keep their bind pose
+ *	POSE		copies the local rotations of a pose
+ *	LERP		interpolates between two nodes by the weight of the node
+ *	ADDITIVE	adds the difference between two nodes to a base node, scaled by the weight
+ *	LAYER		interpolates from a base node to another, weighted per bone by a mask
+ * @endcode
+ *
+ * Clips are matched to the skeleton by bone name and are not copied.
+ * Each clip node decompresses into its own AnimClip::Cursor, so
+ * many trees can share a clip at different times. Evaluating the poses
+ * (BlendTree::EvalPose) only changes the tree itself, so different trees
+ * can be evaluated at the same time by different threads. Applying the
+ * pose to the skeleton (BlendTree::ApplyPose) is done by one thread.
+ * Put the trees of a crowd under a BlendGroup to evaluate them in parallel.
+ *
+ * @see BlendGroup AnimClip Skeleton Pose
+ */
+class BlendTree : public Engine
+{
+public:
+	VX_DECLARE_CLASS(BlendTree);
+
+	/*!
+	 * @brief Types of blend tree nodes.
+	 * @see BlendTree::GetNodeType
+	 */
+	enum
+	{
+		CLIP = 1,
+		POSE,
+		LERP,
+		ADDITIVE,
+		LAYER
+	};
+
+	BlendTree();
+	~BlendTree();
+
+	int			GetNumNodes() const;				//!< Return number of nodes in the tree.
+	int			GetNodeType(int node) const;		//!< Return type of a node.
+	int			GetOutput() const;					//!< Return node whose pose is applied to the skeleton.
+	void		SetOutput(int node);				//!< Set node whose pose is applied to the skeleton.
+	float		GetWeight(int node) const;			//!< Return blend weight of a node.
+	void		SetWeight(int node, float weight);	//!< Set blend weight of a node.
+
+	//! Add a node which samples an animation clip.
+	int			AddClip(AnimClip* clip, float speed = 1.0f, float timeofs = 0.0f, bool cycle = true);
+
+	//! Add a node which copies the local rotations of a pose.
+	int			AddPose(Pose* pose);
+
+	//! Add a node which interpolates between two nodes.
+	int			AddLerp(int src1, int src2, float weight = 0.5f);
+
+	//! Add a node which adds the difference between two nodes to a base node.
+	int			AddAdditive(int base, int add, int ref, float weight = 1.0f);
+
+	//! Add a node which replaces the masked bones of a base node.
+	int			AddLayer(int base, int layer, float weight = 1.0f);
+
+	//! Set the layer mask weight of a bone and optionally all its descendants.
+	bool		SetMask(int node, int bone, float weight, bool branch = true);
+
+	//! Set the speed and time offset of a clip node.
+	void		SetClipTime(int node, float speed, float timeofs);
+
+	//! Compute the poses of all the nodes, does not change the skeleton.
+	bool		EvalPose(float t);
+
+	//! Apply the pose of the output node to the skeleton.
+	void		ApplyPose();
+
+	//! Return local rotation of a bone computed by the output node.
+	bool		GetLocalRotation(int bone, Quat& rot) const;
+
+	virtual bool	Eval(float t);
+	virtual void	SetTarget(SharedObj* target);
+
+protected:
+	/*
+	 * Node of the blend tree
+	 */
+	struct Node
+	{
+		int32				Type;		// CLIP, POSE, LERP, ADDITIVE or LAYER
+		int32				Input[3];	// indices of input nodes
+		float				Weight;		// blend weight
+		float				Speed;		// clip time scale
+		float				TimeOfs;	// clip time offset
+		int32				Cycle;		// nonzero to repeat the clip
+		SharedObj*			Source;		// AnimClip or Pose sampled
+		AnimClip::Cursor*	Cursor;		// keys of the clip window being sampled
+		int32*				BoneMap;	// skeleton bone for each clip channel, -1 if none
+		float*				Mask;		// layer weight of each bone
+		int32				HasRoot;	// nonzero if the root position was computed
+		Vec3				Root;		// root position computed
+	};
+
+	int			AddNode(int type, SharedObj* source);
+	void		FreeNodes();
+	bool		Bind();
+	void		EvalClip(Node& node, float t, float* rots);
+	void		CopyPose(Node& node, float* rots);
+	void		EvalLerp(Node& node, float* rots, const float* mask);
+	void		EvalAdditive(Node& node, float* rots);
+	float*		GetRotations(int node) const;
+
+	Node*		m_Nodes;
+	int32		m_NumNodes;
+	int32		m_MaxNodes;
+	int32		m_Output;		// node applied to the skeleton, -1 for the last one
+	int32		m_NumBones;		// bones in the skeleton the buffers are for
+	int32		m_Pitch;		// floats in each component of a rotation buffer
+	float*		m_Rotations;	// x, y, z, w arrays of bone rotations for each node
+	float*		m_BindRots;		// x, y, z, w arrays of bind pose rotations
+	int32		m_NeedBind;		// nonzero if bone maps and buffers must be rebuilt
+	int32		m_Valid;		// nonzero if the output pose was computed
+};
+
+inline int BlendTree::GetNumNodes() const
+{ return m_NumNodes; }
+
+inline int BlendTree::GetNodeType(int node) const
+{
+	VX_ASSERT((node >= 0) && (node < m_NumNodes));
+	return m_Nodes[node].Type;
+}
+
+inline int BlendTree::GetOutput() const
+{ return (m_Output >= 0) ? m_Output : (m_NumNodes - 1); }
+
+inline float BlendTree::GetWeight(int node) const
+{
+	VX_ASSERT((node >= 0) && (node < m_NumNodes));
+	return m_Nodes[node].Weight;
+}
+
+inline float* BlendTree::GetRotations(int node) const
+{ return m_Rotations + node * 4 * m_Pitch; }
+
+class BlendThread;
+
+/*!
+ * @class BlendGroup
+ * @brief Engine which evaluates the blend trees below it in parallel.
+ *
+ * Each frame the blend group computes the time for each BlendTree child
+ * and then evaluates their poses using up to BlendGroup::NumThreads
+ * threads, including the simulation thread. The worker threads are started
+ * the first time they are needed and wait for work between frames.
+ * When all the poses are done, they are applied to the skeletons
+ * one after the other. Children which are not blend trees are
+ * evaluated afterwards by the simulation thread.
+ *
+ * Putting the blend trees of the characters in a crowd under a blend group
+ * lets their locomotion blending scale across the processors.
+ * The skeletons themselves are still evaluated by their own engines.
+ *
+ * @see BlendTree Engine::ComputeChildren
+ */
+class BlendGroup : public Engine
+{
+	friend class BlendThread;
+public:
+	VX_DECLARE_CLASS(BlendGroup);
+
+	BlendGroup();
+	~BlendGroup();
+
+	virtual	void	ComputeChildren(float time, int filter = 0);
+
+	static int32	NumThreads;		//!< number of threads which evaluate blend trees
+
+protected:
+	/*
+	 * Blend tree to evaluate this frame
+	 */
+	struct Job
+	{
+		BlendTree*	Tree;		// tree to evaluate
+		float		Time;		// evaluation time of the tree
+	};
+
+	bool		StartThreads(int32 n);
+	void		StopThreads();
+	void		RunJobs();
+
+	Job*			m_Jobs;
+	int32			m_MaxJobs;
+	vint32			m_NumJobs;		// number of jobs this frame
+	vint32			m_NextJob;		// index of next job to claim
+	vint32			m_NumDone;		// number of jobs finished
+	vint32			m_Generation;	// incremented when new jobs are ready
+	int32			m_NumThreads;	// number of worker threads running
+	BlendThread*	m_Threads[BLEND_MaxThreads];
+};
+
+} // end Vixen
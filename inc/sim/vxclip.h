@@ -0,0 +1,270 @@
+/*!
+ * @file vxclip.h
+ * @brief Compressed animation clips.
+ *
+ * An animation clip holds the motion of a skeleton sampled at a fixed
+ * rate in a compact form. Each channel is reduced to the keys needed
+ * to stay within an error tolerance and the keys are quantized.
+ * Clips are saved in their own binary file format (.vxa) and read
+ * from the file a window at a time while they play.
+ *
+ * @author Nola Donato
+ * @ingroup vixen
+ *
+ * @see vxinterpolator.h vxskeleton.h
+ */
+#pragma once
+
+namespace Vixen {
+
+#define	CLIP_Magic			0x43415856		// "VXAC" at start of clip files
+#define	CLIP_Version		1				// clip file format version
+#define	CLIP_MaxWindow		255				// most frames in a window
+
+/*!
+ * @class AnimClip
+ * @brief Compressed key data for all the channels of a skeleton animation.
+ *
+ * The clip has a position channel for the root bone and a rotation
+ * channel for each animated bone. The frames are divided into windows
+ * of AnimClip::WindowSize frames which are compressed separately.
+ * Within a window, each channel keeps only the keys needed to
+ * reproduce the original samples within AnimClip::PosTolerance or
+ * AnimClip::RotTolerance when interpolated. Rotations are stored as
+ * the three smallest quaternion components in 48 bits, positions
+ * as 16 bit values scaled to the range of the channel in the window.
+ *
+ * Only one window is decompressed at a time. When the clip is read
+ * from a file, the file stays open and the window around the current
+ * time is read and decompressed when needed, so a long clip takes
+ * little memory and starts playing as soon as the directory is read.
+ * Clips are evaluated by ClipInterp engines, one per channel.
+ * Players which use the clip at different times, like the characters
+ * of a crowd sharing a walk cycle, each decompress into their own
+ * AnimClip::Cursor so they do not throw away each other's windows.
+ *
+ * The clip file format is:
+ * @code
+ *	CLIP_Magic CLIP_Version <#bones> <#channels> <#frames> <window size> <#keys> <time step> <directory bytes>
+ *	for each bone:		<parent> <offset x y z> <bind rotation x y z w> <name bytes> <name padded to 4 bytes>
+ *	for each channel:	<bone> <type>
+ *	for each window:	<offset of window data>, followed by the end offset
+ *	for each window, for each channel:
+ *		<minimum x y z> <scale x y z>	position channels only (floats)
+ *		<#keys - 1>						one byte
+ *		<frame of each key>				one byte each, first and last frame not stored
+ *		<packed keys>					6 bytes each
+ * @endcode
+ *
+ * @see ClipInterp BVHLoader::LoadClip Sequencer::Load
+ */
+class AnimClip : public SharedObj
+{
+public:
+	VX_DECLARE_CLASS(AnimClip);
+
+	/*!
+	 * @brief Keys of the window of a clip currently decompressed by one player.
+	 *
+	 * The cursor is filled in by AnimClip::Eval and can be used
+	 * by one thread at a time.
+	 */
+	class Cursor
+	{
+	public:
+		Cursor();
+		~Cursor();
+		void	Empty();		//!< Free the decompressed keys.
+
+		int32	Window;			//!< window decompressed, -1 if none
+		int32	Serial;			//!< serial number of the clip data decompressed
+		int32	MaxKeys;		//!< number of keys allocated
+		int32*	KeyStart;		//!< index of first key of each channel in the window, then the end
+		float*	KeyFrames;		//!< frame of each key in the window
+		float*	KeyVals;		//!< 4 floats for each key in the window
+
+	private:
+		Cursor(const Cursor&);
+		Cursor& operator=(const Cursor&);
+	};
+
+	AnimClip();
+	~AnimClip();
+
+	int				GetNumBones() const;			//!< Return number of bones.
+	int				GetNumChannels() const;			//!< Return number of channels.
+	int				GetNumFrames() const;			//!< Return number of frames sampled.
+	int				GetNumKeys() const;				//!< Return number of keys kept for all channels.
+	int				GetNumWindows() const;			//!< Return number of compressed windows.
+	float			GetTimeStep() const;			//!< Return time between frames.
+	float			GetDuration() const;			//!< Return total time of clip.
+	int				GetChannelBone(int i) const;	//!< Return bone animated by a channel.
+	int				GetChannelType(int i) const;	//!< Return Evaluator::POSITION or Evaluator::ROTATION.
+	const TCHAR*	GetBoneName(int i) const;		//!< Return name of a bone.
+	int32			GetDataSize() const;			//!< Return bytes of compressed key data.
+	float			GetPosError() const;			//!< Return largest position error after compression.
+	float			GetRotError() const;			//!< Return largest rotation error after compression.
+
+	//! Add a bone to the skeleton saved with the clip.
+	int			AddBone(const TCHAR* name, int parent, const Vec3& offset, const Quat& bindrot);
+
+	//! Add a position or rotation channel for a bone.
+	int			AddChannel(int bone, int type);
+
+	//! Compress sampled frames for all the channels.
+	bool		Compress(const float* samples, int numframes, float timestep);
+
+	//! Write the compressed clip to a stream.
+	bool		Write(Core::Stream* out) const;
+
+	//! Read the clip directory from a stream, windows are read when needed.
+	bool		Open(Core::Stream* in);
+
+	//! Compute the value of a channel at the given time.
+	bool		Eval(int channel, float t, float* val);
+
+	//! Compute the value of a channel at the given time using a player's own cursor.
+	bool		Eval(Cursor& cur, int channel, float t, float* val);
+
+	//! Make a skeleton, optionally with a ClipInterp for each channel.
+	Skeleton*	MakeSkeleton(const TCHAR* filebase, bool interps = true);
+
+	//! Load function for clip files.
+	static bool	ReadAnim(const TCHAR* filename, Core::Stream* instream, LoadEvent* ev);
+
+	static float	PosTolerance;	//!< largest position error allowed when removing keys
+	static float	RotTolerance;	//!< largest rotation error (radians) allowed when removing keys
+	static int32	WindowSize;		//!< number of frames in a window (up to CLIP_MaxWindow)
+
+protected:
+	/*
+	 * Bone of the skeleton the clip animates
+	 */
+	struct Bone
+	{
+		int32	Parent;			// index of parent bone, -1 for root
+		Vec3	Offset;			// position relative to parent
+		Quat	BindRot;		// local rotation in bind pose
+		int32	Name;			// offset of name in m_Names
+	};
+
+	/*
+	 * Position or rotation channel
+	 */
+	struct Channel
+	{
+		int32	Bone;			// index of bone animated
+		int32	Type;			// Evaluator::POSITION or Evaluator::ROTATION
+		int32	Offset;			// offset of channel in a sampled frame
+	};
+
+	void		Empty();
+	bool		AllocWindow();
+	bool		LoadWindow(int32 w, Cursor& cur);
+	bool		UnpackWindow(int32 w, const uchar* ip, Cursor& cur) const;
+	int32		ReduceKeys(const float* samples, int32 c, int32 first, int32 last, uchar* keep) const;
+	float		KeyError(const Channel& chan, const float* s, const float* k1, const float* k2, float t) const;
+	void		PackKey(int32 type, const Vec3* range, const float* v, uchar* op) const;
+	void		UnpackKey(int32 type, const Vec3* range, const uchar* ip, float* v) const;
+	void		CheckError(const float* samples);
+
+	int32		m_NumBones;
+	int32		m_NumChannels;
+	int32		m_NumFrames;
+	int32		m_NumKeys;
+	int32		m_NumWindows;
+	int32		m_WindowSize;
+	int32		m_FrameSize;		// floats in a sampled frame
+	float		m_TimeStep;
+	float		m_PosError;
+	float		m_RotError;
+	Bone*		m_Bones;
+	Channel*	m_Channels;
+	TCHAR*		m_Names;			// bone names
+	int32		m_NamesSize;		// number of characters used in m_Names
+	int32*		m_Windows;			// offset of each window, then the end offset
+	char*		m_Data;				// packed windows, NULL if streamed
+	char*		m_WindowData;		// packed data of streamed window
+	int32		m_MaxWindowSize;	// bytes in the largest packed window
+	int32		m_DataOffset;		// stream offset of the first window
+	int32		m_Serial;			// changed whenever the key data changes
+	Ref<Core::Stream>	m_Stream;	// stream windows are read from
+	Core::CritSec		m_StreamLock;	// guards stream and m_WindowData
+	Cursor		m_Cursor;			// window used by ClipInterp engines
+};
+
+inline int AnimClip::GetNumBones() const		{ return m_NumBones; }
+inline int AnimClip::GetNumChannels() const		{ return m_NumChannels; }
+inline int AnimClip::GetNumFrames() const		{ return m_NumFrames; }
+inline int AnimClip::GetNumKeys() const			{ return m_NumKeys; }
+inline int AnimClip::GetNumWindows() const		{ return m_NumWindows; }
+inline float AnimClip::GetTimeStep() const		{ return m_TimeStep; }
+inline float AnimClip::GetPosError() const		{ return m_PosError; }
+inline float AnimClip::GetRotError() const		{ return m_RotError; }
+inline int32 AnimClip::GetDataSize() const		{ return m_Windows ? m_Windows[m_NumWindows] : 0; }
+
+inline float AnimClip::GetDuration() const
+{
+	return (m_NumFrames > 1) ? (m_NumFrames - 1) * m_TimeStep : 0.0f;
+}
+
+inline int AnimClip::GetChannelBone(int i) const
+{
+	VX_ASSERT((i >= 0) && (i < m_NumChannels));
+	return m_Channels[i].Bone;
+}
+
+inline int AnimClip::GetChannelType(int i) const
+{
+	VX_ASSERT((i >= 0) && (i < m_NumChannels));
+	return m_Channels[i].Type;
+}
+
+inline const TCHAR* AnimClip::GetBoneName(int i) const
+{
+	VX_ASSERT((i >= 0) && (i < m_NumBones));
+	return m_Names + m_Bones[i].Name;
+}
+
+/*!
+ * @class ClipInterp
+ * @brief Interpolator which gets its keys from one channel of a compressed clip.
+ *
+ * A clip interpolator has no key array of its own. Each frame it asks
+ * the clip for the value of its channel at the current time. The clip
+ * decompresses the window of keys around that time if it is not
+ * already available. Clips are not saved with the interpolator,
+ * they are loaded from clip files.
+ *
+ * @see AnimClip Interpolator
+ */
+class ClipInterp : public Interpolator
+{
+public:
+	VX_DECLARE_CLASS(ClipInterp);
+
+	ClipInterp();
+
+	AnimClip*		GetClip() const;		//!< Return clip keys come from.
+	int				GetChannel() const;		//!< Return channel of clip interpolated.
+	void			SetClip(AnimClip* clip, int channel);
+
+	// internal overrides
+	virtual int		GetSize() const;
+	virtual float	GetTime(int i) const;
+	virtual bool	Copy(const SharedObj*);
+
+protected:
+	const float*	ComputeValue(float t);
+
+	Ref<AnimClip>	m_Clip;
+	int32			m_Channel;
+};
+
+inline AnimClip* ClipInterp::GetClip() const
+{ return m_Clip; }
+
+inline int ClipInterp::GetChannel() const
+{ return m_Channel; }
+
+} // end Vixen
@@ -68,6 +68,7 @@ protected:
 	virtual VertexArray*	ValidateTarget(SharedObj* target);
 	virtual	bool			Reset();
 	virtual	int				InitRestNormals();
+	void					UpdateBound(const Box3& bound);
 
 	Ref<IntArray>		m_VertexMap;
 	Ref<VertexArray>	m_TargetVerts;
@@ -183,6 +183,8 @@ public:
 	virtual	void	ComputeChildren(float time, int filter = 0);
 //! Called to compute the engine evaluation time.
 	virtual	float	ComputeTime(float t);
+//! Move the start times of this engine and its children by a time offset. @internal
+	void			ShiftTime(float ofs);
 
 // Overrides
 	virtual bool	Do(Messenger& s, int opcode);
@@ -14,6 +14,7 @@
 namespace Vixen {
 
 class Pose;
+class AnimClip;
 
 /*!
  * @class Skeleton
@@ -324,6 +325,7 @@ struct BVHLoader
 	bool		LoadSkel();	
 	bool		LoadKeyAsPose(Skeleton* skel);
 	bool		LoadKeys();
+	bool		LoadClip(AnimClip* clip);
 	int			NextLine(TCHAR* linebuf, int maxlen);
 	int			ReadKeys(float* data, int numchannels);
 	static bool ReadAnim(const TCHAR* filename, Core::Stream* instream, LoadEvent* ev);
@@ -12,6 +12,120 @@
 
 namespace Vixen {
 
+class Trigger;
+
+/*!
+ * @class TriggerSpace
+ * @brief Broad phase collision detection shared by the triggers of an engine subtree.
+ *
+ * Without a broad phase, each trigger computes the world position of every
+ * one of its colliders each frame, so T triggers with C colliders cost
+ * T x C walks up the hierarchy. The trigger space computes the world position
+ * of each collider once per frame, no matter how many triggers it belongs to,
+ * and the world bounding box of each trigger zone. The colliders are kept
+ * sorted along the X axis (sweep and prune). Sorting is incremental, so
+ * colliders which move a little each frame are cheap to re-sort. Each trigger
+ * only narrow phase tests the colliders inside its box, plus the ones that were
+ * inside last frame (to detect when they leave). The cost follows the number
+ * of actual overlaps instead of the size of the collider lists.
+ *
+ * Triggers register themselves with a space the first time they are evaluated
+ * if Trigger::UseBroadPhase is set. There is one space for each trigger root:
+ * the closest ancestor engine which is Engine::TASK_PARALLEL or, if there is none,
+ * the top of the simulation tree. All the triggers of a space are evaluated
+ * by the same thread, so each scene and each parallel task has its own space
+ * and the space itself needs no locking. The space is updated by the first
+ * trigger evaluated each frame. Triggers without colliders are not in a space.
+ *
+ * @see Trigger Trigger::UseBroadPhase
+ * @ingroup vixenint
+ * @internal
+ */
+class TriggerSpace
+{
+public:
+	TriggerSpace();
+	~TriggerSpace();
+
+	//! Register a trigger with the space.
+	int		AddTrigger(Trigger* trigger);
+
+	//! Unregister a trigger.
+	void	RemoveTrigger(Trigger* trigger);
+
+	//! Indicate the collider lists have changed.
+	void	SetChanged()	{ m_Changed = true; }
+
+	//! Update the space if a new frame has started.
+	bool	Touch(Trigger* trigger);
+
+	//! Update collider positions and trigger bounds.
+	void	Update();
+
+	//! Find the colliders of a trigger inside its bounding box.
+	int		Overlaps(const Trigger* trigger, const int32** indices, const Vec3** positions);
+
+	//! Return the number of colliders in the space.
+	int		GetNumColliders() const	{ return m_NumProxies; }
+
+	//! Return the root engine of the triggers in the space.
+	const Engine*	GetRoot() const	{ return m_Root; }
+
+	//! Add a trigger to the space for its trigger root.
+	static TriggerSpace*	Join(Trigger* trigger, const Engine* root);
+
+	//! Remove a trigger from its space, freeing the space if it is empty.
+	static void				Leave(Trigger* trigger);
+
+protected:
+	struct Entry
+	{
+		Trigger*		Owner;		// trigger in the space
+		Box3			Bound;		// world bounding box of trigger zone
+		bool			HasBound;	// false if trigger has no zone
+		int32			First;		// index of first member
+		int32			Count;		// number of members
+		intptr			Size;		// size of collider list when members were built
+		int32			Pass;		// last pass trigger was evaluated
+	};
+
+	struct Member
+	{
+		const Model*	Collider;	// collider model
+		int32			Proxy;		// index of collider proxy
+		int32			Index;		// index in trigger collider list
+	};
+
+	struct Proxy
+	{
+		const Model*	Collider;	// collider model
+		Vec3			Pos;		// world position of collider center
+		bool			Active;		// false if collider inactive
+	};
+
+	static bool	Grow(void** data, int32& maxsize, int32 size, int elemsize);
+	void	BuildMembers();
+	static int	CompareColliders(const void* p1, const void* p2);
+	static int	CompareProxies(const void* p1, const void* p2);
+	static int	CompareModels(const void* p1, const void* p2);
+
+	const Engine*	m_Root;		// trigger root of the space
+	Entry*		m_Entries;		// one for each trigger
+	int32		m_NumEntries;
+	int32		m_MaxEntries;
+	Member*		m_Members;		// trigger colliders sorted by proxy for each trigger
+	int32		m_NumMembers;
+	int32		m_MaxMembers;
+	Proxy*		m_Proxies;		// unique colliders sorted by address
+	int32		m_NumProxies;
+	int32		m_MaxProxies;
+	int32*		m_Order;		// proxy indices sorted by X
+	IntArray	m_Found;		// collider indices found by Overlaps
+	Array<Vec3>	m_FoundPos;		// world positions of colliders found by Overlaps
+	int32		m_Pass;			// number of updates
+	bool		m_Changed;		// true if collider lists changed
+};
+
 /*!
  * @class Trigger
  * @brief Simple collision detection engine.
@@ -40,15 +154,31 @@ namespace Vixen {
  * This approach is not efficient if you supply large collider lists or
  * if the collision geometry is complex.
  *
- * @see TriggerEvent Animator Engine::SetTarget Engine::SetControl
+ * When Trigger::UseBroadPhase is set (the default), the triggers under the
+ * same trigger root share a TriggerSpace which culls colliders against the
+ * bounding box of the trigger zone so only nearby colliders are tested.
+ * A trigger with no colliders tests the camera of the main scene and
+ * does not use the broad phase.
+ *
+ * The two evaluations report collisions differently. Without the broad phase,
+ * the colliders are tested in order and testing stops at the first one which
+ * enters or leaves, so at most one event is sent per frame and the other
+ * colliders are reported on later frames. With the broad phase, every
+ * collider which enters or leaves in a frame sends its own event that frame.
+ * Event handlers which expect one event per frame should clear
+ * Trigger::UseBroadPhase.
+ *
+ * @see TriggerSpace TriggerEvent Animator Engine::SetTarget Engine::SetControl
  */
 class Trigger : public Engine
 {
+	friend class TriggerSpace;
 public:
 	VX_DECLARE_CLASS(Trigger);
 
 	Trigger();
 	Trigger(const Trigger&);
+	~Trigger();
 
 	SharedObj*			GetColliders();					//!< Return objects to test for collision.
 	const SharedObj*	GetColliders() const;
@@ -64,6 +194,7 @@ public:
 	bool				GetGeoBox(Box3&) const;			//!< Get collision box.
 	int					GetOptions() const;				//!< Get collision options.
 	void				SetOptions(int opts);			//!< Set collision options.
+	bool				GetWorldBound(Box3&) const;		//!< Get world bounding box of trigger zone.
 
 //	Overrides
 	virtual bool		Do(Messenger& s, int opcode);
@@ -103,15 +234,41 @@ public:
 		TRIGGER_NextOp = Engine::ENG_NextOp + 20
 	};
 
+	static bool		UseBroadPhase;	//!< share collision work between triggers with TriggerSpace, sends an event for every collider which enters or leaves
+
 protected:
-	//! Callback to perform collision detection with a model.
-	virtual bool	Hit(const Model*, int32&, TriggerEvent&);
+	//! Callback to perform collision detection with a model at a world position.
+	virtual bool	Hit(const Model*, const Vec3&, int32&, TriggerEvent&);
+
+	//! Compute the collision zone in world coordinates.
+	bool			UpdateZone();
+
+	//! Evaluate only the colliders found by the broad phase.
+	bool			EvalSpace(TriggerSpace* space, TriggerEvent& te);
+
+	//! Return the collider at the given index in the collider list.
+	const Model*	GetCollider(intptr index) const;
+
+	//! Return the number of colliders in the collider list.
+	intptr			GetNumColliders() const;
+
+	//! Return the engine whose subtree shares a trigger space with this trigger.
+	const Engine*	GetSpaceRoot() const;
 
 	int32			m_Options;		// collision testing options, type, etc.
+	TriggerSpace*	m_Space;		// broad phase this trigger is registered with
+	int32			m_SpaceIndex;	// index of trigger in broad phase
+	int32			m_NumInside;	// number of colliders inside the trigger
 	Ref<IntArray>	m_TriggerFlags;	// state flags, matched with m_Collider array (if array)
 	ObjRef			m_Collider;		// objects to collision test
 	Box3			m_GeoBox;		// box geometry
 	Sphere			m_GeoSphere;	// sphere geometry
+	const Model*	m_ZoneTarget;	// target model of the zone, NULL if none
+	Sphere			m_ZoneSphere;	// world sphere for sphere test
+	Box3			m_ZoneBox;		// box for box test
+	Matrix			m_ZoneMtx;		// world to box coordinates for box test
+	Box3			m_ZoneBound;	// world bounding box of the zone
+	bool			m_HasZone;		// true if zone has a bounding box
 };
 
 inline SharedObj* Trigger::GetColliders()
@@ -1,32 +1,135 @@
 /*!
- * @class VXSceneOptimize
- * 
- * Optimizer for a scene graph that can make appearance
- * and geometry usage more efficient. It can also spatially sort
- * static scenery for faster rendering, picking and collision detection.
+ * @file sceneopt.h
+ * @brief Load-time optimization of static scenery.
  *
- * @see VXOctree
+ * @ingroup vixen
+ * @see vxshape.h vxmesh.h
  */
 #pragma once
 
-class VXSceneOptimize
+namespace Vixen {
+
+/*!
+ * @class SceneOptimize
+ * @brief Optimizer for a scene graph which merges static geometry.
+ *
+ * Shapes which are not animated are collected, their triangle meshes
+ * are transformed into the coordinate system of the scene root
+ * and merged into large shared meshes, one set for each appearance
+ * and vertex layout. Each set is divided into spatial chunks which
+ * are small enough to be culled effectively and to fit within
+ * SceneOptimize::MaxChunkVerts vertices. The merged chunks are put
+ * into a single model named <root>.static under the scene root and
+ * the original shapes are removed.
+ *
+ * A shape is considered static if it and all of its parents are
+ * plain Model or Shape nodes (not subclasses which change the matrix
+ * or geometry dynamically) which are not the target of any engine in the
+ * simulation tree and do not have the Model::MORPH hint. Geometry shared by
+ * at least GeoSorter::MinInstances static shapes is left alone so it
+ * can be rendered with instancing.
+ *
+ * The optimizer can also convert vertices to compact formats
+ * (16 bit locations, octahedral normals, half float texture coordinates)
+ * which halves the memory and bandwidth used by typical meshes.
+ *
+ * Large triangle meshes, including the merged chunks, can be divided
+ * into meshlets so the parts which are off screen or facing away
+ * from the camera are culled (see TriMesh::MakeMeshlets).
+ *
+ * The optimizer can be run on every scene file as it is loaded
+ * by setting SceneLoader::PostLoad to SceneOptimize::PostLoad.
+ * Set SceneOptimize::CompactOptions to compact the vertices too
+ * and SceneOptimize::MeshletFaces to make meshlets. Locations and normals
+ * are only compacted if SceneOptimize::ShaderDecode is also set because
+ * the shaders supplied with Vixen cannot decode them.
+ *
+ * @code
+ *	SceneLoader::PostLoad = &SceneOptimize::PostLoad;
+ *	SceneOptimize::CompactOptions = VertexPool::COMPACT_HARDWARE;
+ *	SceneOptimize::MeshletFaces = 1024;
+ *	World3D::Get()->LoadAsync(TEXT("city.vix"));
+ * @endcode
+ *
+ * @see SceneLoader::PostLoad GeoSorter
+ */
+class SceneOptimize
 {
 public:
+	//! Statistics gathered by SceneOptimize::OptimizeStatic.
+	struct Stats
+	{
+		int32	ShapesBefore;	//!< static shapes (draw calls) before merging
+		int32	ShapesAfter;	//!< merged shapes (draw calls) after merging
+		int32	Chunks;			//!< number of spatial chunks
+		int64	BytesBefore;	//!< vertex and index bytes used by static shapes before merging
+		int64	BytesAfter;		//!< vertex and index bytes used by merged shapes
+		int32	Compacted;		//!< vertex arrays converted to compact formats
+		int64	CompactBefore;	//!< vertex bytes used by compacted arrays before conversion
+		int64	CompactAfter;	//!< vertex bytes used by compacted arrays after conversion
+		int32	MeshletMeshes;	//!< meshes divided into meshlets
+		int32	Meshlets;		//!< total number of meshlets made
+	};
+
+	SceneOptimize();
+	~SceneOptimize();
+
+	//! Merge static geometry in a hierarchy not animated by the given engines.
+	bool			OptimizeStatic(Model* root, const Engine* simroot = NULL);
 
-	//! Optimizes the vertex usage among multiple triangle meshes.
-	void			OptimizeVerts(PSSurface* surf);
+	//! Convert the vertices of meshes in a hierarchy to compact formats.
+	int32			CompactVertices(Model* root, const Engine* simroot = NULL, int opts = VertexPool::COMPACT_HARDWARE);
 
-	//! Optimize appearance usage for a hierarchy.
-	VXAppearances*	UniqueAppearances(VXModel* root);
+	//! Divide the large triangle meshes in a hierarchy into meshlets.
+	int32			MakeMeshlets(Model* root, int32 minfaces);
 
-	//! Build static hierarchy from objects in input hierarchy which are not dynamic
-	VXModel*		OptimizeStatic(VXModel* root);
+	//! Return statistics for the last optimization.
+	const Stats&	GetStats() const	{ return m_Stats; }
+
+	//! Loader post-processing function which optimizes each scene loaded.
+	static bool		PostLoad(Scene* scene, const TCHAR* filename);
+
+	int32			MaxChunkVerts;	//!< maximum number of vertices in a merged mesh
+	float			ChunkSize;		//!< size of spatial chunk, 0 to compute from MaxChunkVerts
+	static int		Debug;			//!< print optimization statistics if nonzero
+	static int		CompactOptions;	//!< vertex components PostLoad converts to compact formats, 0 for none
+	static bool		ShaderDecode;	//!< set if the shaders decode quantized locations and octahedral normals
+	static int32	MeshletFaces;	//!< minimum triangles for PostLoad to divide a mesh into meshlets, 0 for none
 
 protected:
-	VXModel*		BuildStatic(VXModel* root, const VXObjArray* statmods);
-	bool			CollectStatic(const VXModel* root, const VXMatrix* mtx, int level);
+	//! Static shape collected from the hierarchy.
+	struct StaticShape
+	{
+		Shape*				Source;		// original shape
+		const Appearance*	Appear;		// appearance of shape
+		const DataLayout*	Layout;		// vertex layout of shape geometry
+		float				World[16];	// shape to root transform
+		Vec3				Center;		// center of shape in root coordinates
+		int32				Cell;		// spatial chunk index
+		int32				Depth;		// distance from root, used to remove children first
+	};
 
-	VXObjArray	m_StatRoots;	// roots of static hierarchies
-};
+	void			CollectTargets(const Engine* simroot);
+	bool			IsTarget(const Model* mod) const;
+	void			CollectStatic(Model* root, const Matrix* mtx);
+	void			KeepInstanced();
+	void			AssignCells(int first, int last);
+	void			BuildChunks(Model* statroot, int first, int last);
+	bool			MergeShape(TriMesh* dst, StaticShape* src);
+	void			RemoveShape(Model* root, Shape* shape);
+	static int		CompareShapes(const void* p1, const void* p2);
+	static int		CompareDepth(const void* p1, const void* p2);
+	static int		CompareGeometry(const void* p1, const void* p2);
+	static int		CompareTargets(const void* p1, const void* p2);
+	static int64	GetBytes(const Mesh* mesh);
 
+	StaticShape*	m_Shapes;		// static shapes collected
+	int32			m_NumShapes;	// number of static shapes
+	int32			m_MaxShapes;	// size of static shape array
+	intptr*			m_Targets;		// sorted engine targets
+	int32			m_NumTargets;	// number of engine targets
+	IntArray		m_VtxMap;		// maps source to merged vertex indices
+	Stats			m_Stats;
+};
 
+} // end Vixen
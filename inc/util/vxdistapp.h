@@ -3,6 +3,7 @@
 namespace Vixen {
 
 #define	WORKING_DIR	"/vixen/bin/win32"
+#define	DISTRIB_DefaultPort	6666
 
 /*!
  * @class DistribWorld
@@ -17,7 +18,7 @@ namespace Vixen {
  *
  * Command line arguments are used for initialization:
  *
- *	 content -d  workdir -s  socket
+ *	 content -d  workdir -s  socket -p port
  * @code
  *	content		is a fully qualified pathname of the initial content
  *				to load and display. This is unrelated to the working
@@ -26,6 +27,8 @@ namespace Vixen {
  *				config files and executables (default is /vixen/bin/win32)
  *	-s socket	name or IP address of client socket, \b master indicates
  *				this instance is the master server socket
+ *	-p port		port the master listens on and the slaves connect to
+ *				(default is DISTRIB_DefaultPort)
  * @endcode
  *
  * The  content file must be the name of a valid .Vixen file or a file format
@@ -48,6 +51,12 @@ public:
 
 //! Set whether this application is master or slave
 	virtual void	SetMaster(bool f)		{ m_IsMaster = f; }
+
+//! Get port used to communicate between master and slaves
+	int				GetPort() const			{ return m_Port; }
+
+//! Set port used to communicate between master and slaves
+	void			SetPort(int port)		{ m_Port = port; }
 	bool			OnEvent(Event*);
 	bool			OnInit();
 	bool			ParseArgs(int argc, TCHAR** argv);
@@ -59,6 +68,7 @@ public:
 
 protected:
 	bool			m_IsMaster;
+	int				m_Port;
 	Core::String	m_WorkingDir;
 	Core::String	m_SocketServer;
 	Ref<Scriptor>	m_InitScript;
@@ -69,6 +79,7 @@ template <class BASE> DistribWorld<BASE>::DistribWorld()
 {
 	DoAsyncLoad = true;
 	m_IsMaster = false;
+	m_Port = DISTRIB_DefaultPort;
 	m_InitScript = new Scriptor;
 }
 
@@ -106,7 +117,7 @@ template <class BASE> bool DistribWorld<BASE>::OnInit()
 		if (m_IsMaster)								// are we the server?
 		{
 			sync->SetName("master");
-			stream = new Core::SocketArbitrator(6666);	// open server socket
+			stream = new Core::SocketArbitrator(m_Port);	// open server socket
 			sync->SetInStream(stream);
 			sync->SetOutStream(stream);
 			sync->SendUpdates = true;
@@ -114,7 +125,7 @@ template <class BASE> bool DistribWorld<BASE>::OnInit()
 		else
 		{
 			sync->SetName("slave");
-			stream = new Core::Socket(6666);			// slave? single socket to master
+			stream = new Core::Socket(m_Port);		// slave? single socket to master
 			sync->SetInStream(stream);
 			sync->SendUpdates = false;
 		}
@@ -144,7 +155,7 @@ template <class BASE> bool DistribWorld<BASE>::OnInit()
 	sync->Observe(this, Event::KEY, NULL);
 	sync->Observe(this, Event::CONNECT, NULL);
 	sync->Observe(this, Event::EXEC, NULL);
-	StartTime = (float) Core::GetTime();
+	StartTime = Core::GetTime();
 	return BASE::OnInit();
 }
 
@@ -152,7 +163,7 @@ template <class BASE> bool DistribWorld<BASE>::OnInit()
  * @fn bool DistribWorld<BASE>::ParseArgs(int argc, TCHAR** argv)
  *
  * Parses command line arguments specific for a Distributed application.
- *		 content -s  socket -T
+ *		 content -s  socket -p port -T
  *
  * @code	
  *	content		is the name of the file that contains the initial
@@ -161,6 +172,7 @@ template <class BASE> bool DistribWorld<BASE>::OnInit()
  *				config files and executables (default is /vixen/bin)
  *	-s socket	name or IP address of client socket, <<master>> indicates
  *				this instance is the master server socket
+ *	-p port		socket port to use (default is DISTRIB_DefaultPort)
  * @endcode
  *
  * @return \b true	do default parsing (filename), \b false suppress parsing
@@ -193,6 +205,12 @@ template <class BASE> bool DistribWorld<BASE>::ParseArgs(int argc, TCHAR** argv)
 			argv[i] = NULL;
 			m_SocketServer = p;
 			break;
+
+			case TEXT('p'):		// -p <port>
+			p = argv[++i];
+			argv[i] = NULL;
+			m_Port = (int) ATOL(p);
+			break;
 		}
 }
 	return BASE::ParseArgs(argc, argv);
@@ -58,6 +58,8 @@
 #include "sim/vxdeformer.h"
 #include "sim/vxpose.h"
 #include "sim/vxskeleton.h"
+#include "sim/vxclip.h"
+#include "sim/vxblendtree.h"
 #include "sim/vxposemapper.h"
 #include "sim/vxskin.h"
 #include "sim/vxmorph.h"
@@ -22,6 +22,10 @@ namespace Vixen {
  * for gathering information and setting added properties.
  * They are not gathered automatically like the default ones are. 
  *
+ * Properties can also be attached to profiler zones with AddZone.
+ * These are gathered automatically from the per-frame zone times
+ * (in milliseconds) kept by Core::Profiler when VX_PROFILE is defined.
+ *
  * @par BuiltIn Properties
  * @code
  *	STAT_FrameRate		frames processed per second
@@ -32,9 +36,19 @@ namespace Vixen {
  *	STAT_ModelsRendered	number of models rendered this frame
  *	STAT_ModelsCulled	number of models culled this frame
  *	STAT_FrameTime		time in seconds to process this frame
+ *	STAT_ObjectMemory	megabytes in live objects
+ *	STAT_VertexMemory	megabytes of vertex data
+ *	STAT_IndexMemory	megabytes of index data
+ *	STAT_BitmapMemory	megabytes of texture pixels
  * @endcode
  *
- * @see TextGeometry Engine::SetDuration
+ * The memory properties come from Core::MemStats and are totals
+ * for the whole application. They are not enabled for display by default.
+ * SetMemoryLog periodically writes a JSON breakdown of memory by class
+ * and the change since the previous one, for watching long running
+ * applications for leaks.
+ *
+ * @see TextGeometry Engine::SetDuration Core::Profiler Core::MemStats
  */
 enum StatOps
 {
@@ -55,7 +69,11 @@ enum psStatID
 	STAT_ModelsRendered,
 	STAT_ModelsCulled,
 	STAT_FrameTime,
-	STAT_LastProp = STAT_FrameTime,
+	STAT_ObjectMemory,
+	STAT_VertexMemory,
+	STAT_IndexMemory,
+	STAT_BitmapMemory,
+	STAT_LastProp = STAT_BitmapMemory,
 
 //	room for user-added properties
 	STAT_MaxProp = STAT_LastProp + 20
@@ -72,7 +90,7 @@ public:
 
 	struct StatProp
 	{
-		StatProp()		{ Enable = false; Name = NULL; Reset(); }
+		StatProp()		{ Enable = false; Name = NULL; Zone = NULL; Reset(); }
 		void Reset()	{ Value = Average = Minimum = Maximum = 0; Samples = 0; }
 
 		bool		Enable;		// enable / disable
@@ -82,6 +100,7 @@ public:
 		float		Maximum;	// maximum value
 		int			Samples;	// # samples taken
 		const TCHAR* Name;		// string name
+		const TCHAR* Zone;		// profiler zone name
 	};
 
 	virtual bool	Eval(float t);
@@ -103,6 +122,12 @@ public:
 	//! Add new property with the given name.
 	virtual int		AddProperty(const TCHAR* name, int prop = -1);
 
+	//! Add new property which reports the time spent in a profiler zone.
+	virtual int		AddZone(const TCHAR* zonename, const TCHAR* name = NULL);
+
+	//! Periodically write memory usage by class to a JSON file.
+	void			SetMemoryLog(const TCHAR* filename, float interval = 60.0f);
+
 	//! Print statistics properties and values.
 	virtual DebugOut&		Print(DebugOut& = vixen_debug, int opts = SharedObj::PRINT_Default) const;
 
@@ -122,6 +147,10 @@ protected:
 	FILE*			m_LogFile;
 	Core::String	m_StatusString;
 	StatProp		m_Stats[STAT_MaxProp];
+	Core::String	m_MemLogFile;		// file for memory log
+	float			m_MemLogInterval;	// seconds between memory log updates
+	float			m_MemLogTime;		// time memory log last written
+	Core::MemStats::Snapshot	m_MemLast;	// memory counts when log last written
 };
 
 inline const TCHAR* FrameStats::GetString() const
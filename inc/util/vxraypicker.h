@@ -208,6 +208,8 @@ protected:
  *
  * @see Picker RayPicker
  */
+#define	PICK_NameCacheSize	64		// number of name filter results remembered
+
 class NamePicker : public RayPicker
 {
 public:
@@ -228,8 +230,11 @@ public:
 protected:
 	int			CanSelect(const Model* mod, float closest);
 	bool		IsNameValid(const Model* mod);
+	bool		MatchName(const TCHAR* objname) const;
 
 	Core::String	m_NameFilter;
+	Core::Atom		m_NameAtoms[PICK_NameCacheSize];	// names already checked against filter
+	bool			m_NameValid[PICK_NameCacheSize];	// filter result for each name
 };
 
 inline const TCHAR* NamePicker::GetNameFilter() const
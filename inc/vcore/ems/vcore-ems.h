@@ -40,12 +40,15 @@ namespace Vixen {
 #include "vcore/valloc.h"
 #include "vcore/vtlsdata.h"
 #include "vcore/linux/vlock-x.h"
+#include "vcore/vepoch.h"
 #include "vcore/vrefptr.h"
 #include "vcore/vrefptr.inl"
 #include "vcore/vref.h"		// class Ref in global namespace
 #include "vcore/vref.inl"
 
 #include "vcore/vstring.h"
+#include "vcore/vatom.h"
+#include "vcore/vcompress.h"
 #include "vcore/vstringpool.h"
 #include "vcore/vobj.inl"	// after vobj/valloc sequence
 #include "vcore/varray.h"
@@ -71,6 +74,8 @@ namespace Core
 #include "vcore/vthread.h"
 #include "vcore/vpool.h"
 #include "vcore/vbufq.h"
+#include "vcore/vprofile.h"
+#include "vcore/vmemstats.h"
 
 extern DebugOut& vixen_debug;
 } // end Vixen
@@ -171,6 +171,10 @@ typedef std::ostream DebugOut;
 
 #define FORCE_INLINE	inline
 
+#ifndef ALIGN16
+#define ALIGN16 __attribute__((aligned(16)))
+#endif
+
 #define		VK_ESCAPE	0x1B
 #define		VK_END		0x23
 #define		VK_HOME		0x24
@@ -16,6 +16,7 @@
  *	_WIN32			enable compilation for Windows platform
  *	X11_LINUX		enable compilator for X11 under Linux
  *	VX_NOTHREAD		disable multi-threading and locking
+ *	VX_PROFILE		enable hierarchical frame profiler zones
  *
  */
 #pragma once
@@ -53,11 +54,14 @@ namespace Vixen {
 #include "vcore/vtlsdata.h"
 #include "vcore/vstringpool.h"
 #include "vcore/linux/vlock-x.h"
+#include "vcore/vepoch.h"
 #include "vcore/vrefptr.h"
 #include "vcore/vrefptr.inl"
 #include "vcore/vref.h"		// class Ref in global namespace
 #include "vcore/vref.inl"
 #include "vcore/vstring.h"
+#include "vcore/vatom.h"
+#include "vcore/vcompress.h"
 #include "vcore/vobj.inl"	// after vobj/valloc sequence
 #include "vcore/varray.h"
 #include "vcore/varray.inl"
@@ -81,6 +85,8 @@ namespace Core
 #include "vcore/vthread.h"
 #include "vcore/vpool.h"
 #include "vcore/vbufq.h"
+#include "vcore/vprofile.h"
+#include "vcore/vmemstats.h"
 
 extern DebugOut& vixen_debug;
 } // end Vixen
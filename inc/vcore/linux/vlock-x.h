@@ -30,6 +30,8 @@ inline int32 InterlockDec(vint32* lpAddend)
 
 inline int32 InterlockAdd(vint32* dst, int src) { *dst += src; return *dst; }
 
+inline int64 InterlockAdd(vint64* dst, int64 src) { *dst += src; return *dst; }
+
 inline int InterlockTestSet(vint32* i, int set, int test)
 {	if (*i == test) { *i = set; return 1; } else return 0; }
 
@@ -105,6 +107,9 @@ inline int32 InterlockAdd(vint32* Addend, int Value)
 inline size_t InterlockAdd(intptr volatile* Addend, int Value)
 { return g_atomic_pointer_exchange_and_add(Addend,Value); }
 
+inline int64 InterlockAdd(vint64* Addend, int64 Value)
+{ return __sync_fetch_and_add(Addend, Value); }
+
 class CritSec : BaseObj
 {
 public:
@@ -0,0 +1,108 @@
+/*!
+ * @file vatom.h
+ *
+ * @brief Global table of interned names.
+ *
+ * Names are interned once and afterwards identified by a 32 bit atom.
+ * Each atom keeps a shared copy of its string and a precomputed hash
+ * so name lookups can compare integers instead of strings.
+ *
+ * @ingroup vcore
+ * @see vstring.h vstringpool.h
+ */
+
+#pragma once
+
+namespace Core {
+
+#define	ATOM_BlockSize		1024	// number of atoms allocated at once
+#define	ATOM_MaxBlocks		4096	// maximum number of atom blocks
+
+/*!
+ * Identifies an interned name. Zero is the empty name.
+ *
+ * @see AtomTable
+ */
+typedef uint32	Atom;
+
+/*!
+ * @class AtomTable
+ * @brief Thread-safe global table which interns names as atoms.
+ *
+ * Interning a string returns an atom which is the same for all
+ * occurrences of the string. The atom table keeps a single
+ * reference counted copy of each string which is shared
+ * by all the Core::String objects made from the atom, so
+ * many objects with the same name do not each allocate it.
+ *
+ * Names are compared without regard to case, like the name
+ * dictionaries. Each atom has a \e folded atom which is the
+ * first atom interned which matches it ignoring case.
+ * Two names are the same if their folded atoms are equal.
+ * The hash of an atom is computed once when it is interned
+ * and is the same as BaseDict::HashStr for the string.
+ *
+ * Atoms are never freed until CoreExit. Looking up the string,
+ * hash or folded atom for an atom does not lock. Interning and
+ * finding strings lock the table briefly.
+ *
+ * @code
+ *	Core::Atom a1 = Core::AtomTable::Intern(TEXT("file.root"));
+ *	Core::Atom a2 = Core::AtomTable::Find(TEXT("FILE.ROOT"));
+ *	Core::AtomTable::Equal(a1, a2);	// true, same name ignoring case
+ * @endcode
+ *
+ * @ingroup vcore
+ * @see NameProp NameDict
+ */
+class AtomTable
+{
+public:
+	static Atom				Intern(const TCHAR* name);	//!< get atom for name, add if not there
+	static Atom				Find(const TCHAR* name);	//!< get atom for name, zero if not there
+	static const String&	GetString(Atom atom);		//!< get shared string for atom
+	static uint32			GetHash(Atom atom);			//!< get case insensitive hash for atom
+	static Atom				GetFolded(Atom atom);		//!< get atom which matches ignoring case
+	static bool				Equal(Atom a1, Atom a2);	//!< \b true if atoms match ignoring case
+	static int32			GetSize();					//!< get number of atoms interned
+	static uint32			Hash(const TCHAR* name);	//!< compute case insensitive hash
+	static void				FreeAll();					//!< free all atoms
+
+protected:
+	/*
+	 * Information kept for each atom
+	 */
+	struct Entry
+	{
+		String		Name;		// shared copy of string
+		uint32		Hash;		// case insensitive hash of string
+		Atom		Folded;		// first atom which matches ignoring case
+		Atom		Next;		// next atom in hash bucket
+	};
+
+	static Entry*	GetEntry(Atom atom);
+	static Atom		Lookup(const TCHAR* name, uint32 hash, Atom* folded);
+	static bool		Grow();
+
+	static Entry*	s_Blocks[ATOM_MaxBlocks];	// blocks of atoms
+	static Atom*	s_Buckets;					// first atom in each hash bucket
+	static uint32	s_NumBuckets;				// number of hash buckets (power of 2)
+	static vint32	s_Size;						// number of atoms used (including zero)
+};
+
+inline AtomTable::Entry* AtomTable::GetEntry(Atom atom)
+	{ return &(s_Blocks[atom / ATOM_BlockSize][atom % ATOM_BlockSize]); }
+
+inline uint32 AtomTable::GetHash(Atom atom)
+	{ return atom ? GetEntry(atom)->Hash : 0; }
+
+inline Atom AtomTable::GetFolded(Atom atom)
+	{ return atom ? GetEntry(atom)->Folded : 0; }
+
+inline bool AtomTable::Equal(Atom a1, Atom a2)
+	{ return (a1 == a2) || (GetFolded(a1) == GetFolded(a2)); }
+
+inline int32 AtomTable::GetSize()
+	{ return s_Size ? (s_Size - 1) : 0; }
+
+}	// end Core
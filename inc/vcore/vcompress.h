@@ -0,0 +1,55 @@
+/*!
+ * @file vcompress.h
+ *
+ * @brief Fast block compression.
+ *
+ * @ingroup vcore
+ * @see vstream.h
+ */
+
+#pragma once
+
+namespace Core {
+
+#define	LZ_HashBits		14		// number of bits in compressor hash table index
+#define	LZ_MaxOffset	65535	// farthest back a match can be
+
+/*!
+ * @class Compressor
+ * @brief Compresses and decompresses independent blocks of data.
+ *
+ * The compressed data uses the LZ4 block format: a sequence of
+ * literal runs each followed by a back reference of at most 64K bytes.
+ * Each block is compressed separately so blocks can be decompressed in
+ * any order and by different threads. Compression is fast and favors
+ * speed over ratio, decompression does not need any memory besides the
+ * output buffer.
+ *
+ * The caller keeps track of the uncompressed size of each block.
+ *
+ * @code
+ *	int32	maxsize = Core::Compressor::GetMaxSize(rawsize);
+ *	char*	packed = (char*) malloc(maxsize);
+ *	int32	packsize = Core::Compressor::Compress(raw, rawsize, packed, maxsize);
+ *	...
+ *	Core::Compressor::Decompress(packed, packsize, raw, rawsize);
+ * @endcode
+ *
+ * @ingroup vcore
+ * @see ChunkMessenger
+ */
+class Compressor
+{
+public:
+	//! Get the most bytes a block of the given size can compress to.
+	static int32	GetMaxSize(int32 srclen);
+	//! Compress a block, returns compressed size or zero if it does not fit.
+	static int32	Compress(const char* src, int32 srclen, char* dst, int32 dstmax);
+	//! Decompress a block, returns decompressed size or -1 if the data is bad.
+	static int32	Decompress(const char* src, int32 srclen, char* dst, int32 dstlen);
+};
+
+inline int32 Compressor::GetMaxSize(int32 srclen)
+	{ return srclen + (srclen / 255) + 16; }
+
+}	// end Core
@@ -17,6 +17,7 @@
  *	VIXEN_EMSCRIPTEN	enable compilation with Emscripten
  *	X11_LINUX			enable compilator for X11 under Linux
  *	VX_NOTHREAD			disable multi-threading and locking
+ *	VX_PROFILE			enable hierarchical frame profiler zones
  *
  */
 #pragma once
@@ -0,0 +1,135 @@
+/*!
+ * @file vepoch.h
+ *
+ * @brief Epoch based reclamation for read-mostly shared data.
+ *
+ * Threads which traverse shared structures enter an epoch instead of
+ * locking each object they visit. Objects released while readers may
+ * still see them are retired instead of deleted and freed after
+ * every reader which could have seen them has left.
+ *
+ * @ingroup vcore
+ * @see vlock.h vrefptr.h
+ */
+
+#pragma once
+
+namespace Core {
+
+#define	EPOCH_MaxReaders	64		// maximum number of threads reading at once
+#define	EPOCH_CollectSize	256		// retired objects which trigger a collection
+
+class RefObj;
+
+/*!
+ * @class Epoch
+ * @brief Defers freeing objects until no reader can be referencing them.
+ *
+ * When epoch mode is enabled, RefObj::Release and RefObj::Delete retire
+ * objects whose reference count drops to zero instead of deleting them.
+ * Reader threads bracket traversals with Epoch::Enter and Epoch::Leave
+ * (or an EpochReader on the stack). These only write a slot in a
+ * global table so traversal does not take a lock per object.
+ *
+ * There is a global epoch counter. A reader records the epoch it
+ * entered in. The epoch can be advanced once every active reader has
+ * seen the current epoch. An object retired in epoch \b e is deleted
+ * when the epoch advances from \b e + 2 to \b e + 3. By then every reader
+ * which could have seen it has left. One advance would be enough for readers
+ * which entered normally. The extra one covers a reader which read the
+ * epoch just before it advanced and claimed its slot just after.
+ * Epoch::Collect tries to advance the epoch and is called once per frame
+ * by the scene manager and whenever many objects are waiting.
+ *
+ * Each thread which retires objects has its own retired lists, so
+ * releasing objects on different threads does not contend for a lock.
+ * Only Epoch::Collect visits the lists of all the threads.
+ *
+ * Writers still lock objects they change. Epoch mode only guarantees
+ * that a reader never sees freed memory; it may see a node which was
+ * removed from the graph during the traversal.
+ *
+ * @code
+ *	Core::Epoch::SetEnabled(true);	// before starting traversal threads
+ *	...
+ *	{
+ *		Core::EpochReader	reader;	// traversal thread
+ *		root->Display(scene);
+ *	}
+ *	...
+ *	group->Remove(child);			// another thread, freed later
+ *	Core::Epoch::Collect();
+ * @endcode
+ *
+ * @ingroup vcore
+ * @see EpochReader RefObj::Release RefObj::Delete
+ */
+class Epoch
+{
+public:
+	static bool		IsEnabled();				//!< \b true if frees are deferred
+	static void		SetEnabled(bool);			//!< enable or disable epoch mode
+	static void		Enter();					//!< enter a read-side critical section
+	static void		Leave();					//!< leave a read-side critical section
+	static bool		IsReading();				//!< \b true if this thread is reading in epoch mode
+	static void		Retire(RefObj* obj);		//!< free object when readers have left
+	static bool		Collect();					//!< try to advance epoch and free old objects
+	static void		Flush();					//!< wait for readers and free all retired objects
+	static int32	GetEpoch();					//!< get current global epoch
+	static int32	GetNumRetired();			//!< get number of objects waiting to be freed
+
+protected:
+	/*
+	 * Objects retired by one thread in each epoch (mod 3).
+	 * The lock is only contended when Epoch::Collect takes a list.
+	 */
+	struct RetireList
+	{
+		RetireList*		Next;				// next thread's lists
+		vint32			Lock;				// guards the lists
+		RefObj**		Retired[3];			// objects retired in each epoch (mod 3)
+		int32			Size[3];			// number of objects in each list
+		int32			Max[3];				// allocated size of each list
+	};
+
+	static void			FreeList(RefObj** list, int32 n);
+	static RetireList*	GetRetireList();
+
+	static volatile bool	s_Enabled;					// epoch mode is on
+	static vint32			s_Epoch;					// global epoch counter
+	static vint32			s_Readers[EPOCH_MaxReaders];// epoch each reader entered in (0 = idle)
+	static vint32			s_NumRetired;				// total objects waiting
+	static vint32			s_Collecting;				// nonzero while a thread is collecting
+	static RetireList* volatile	s_RetireLists;			// retired lists of all threads
+	THREAD_LOCAL int32		t_Slot;						// reader slot index + 1 for this thread
+	THREAD_LOCAL int32		t_Depth;					// read section nesting depth
+	THREAD_LOCAL RetireList*	t_Retired;				// retired lists for this thread
+};
+
+/*!
+ * @class EpochReader
+ * @brief Enters an epoch read section for its lifetime.
+ *
+ * @ingroup vcore
+ * @see Epoch::Enter Epoch::Leave
+ */
+class EpochReader
+{
+public:
+	EpochReader()	{ Epoch::Enter(); }
+	~EpochReader()	{ Epoch::Leave(); }
+};
+
+inline bool Epoch::IsEnabled()
+	{ return s_Enabled; }
+
+inline int32 Epoch::GetEpoch()
+	{ return s_Epoch; }
+
+inline int32 Epoch::GetNumRetired()
+	{ return s_NumRetired; }
+
+inline bool Epoch::IsReading()
+	{ return t_Slot > 0; }
+
+}	// end Core
@@ -0,0 +1,127 @@
+/*!
+ * @file vmemstats.h
+ *
+ * @brief Always-on accounting of live objects and resource memory.
+ *
+ * Objects are counted by class when they are allocated and freed.
+ * Large data areas like vertices, indices and texture pixels are
+ * charged to a resource type by the objects which own them.
+ * Snapshots of the counts can be compared to find what is growing
+ * and written as JSON for offline analysis.
+ *
+ * @ingroup vcore
+ *
+ * @see vobj.h vxframestats.h
+ */
+
+#pragma once
+
+namespace Core {
+
+/*!
+ * @class MemStats
+ * @brief Reports memory used by each class and each type of resource.
+ *
+ * Every class declared with VX_DECLARE_CLASS keeps the number of its
+ * objects currently allocated, the bytes they occupy and the number
+ * ever allocated. The counters are updated atomically by \b new and
+ * \b delete so they cost a few instructions per object and are always on.
+ * Objects of a subclass which does not declare its own class are
+ * counted with the closest ancestor which does.
+ *
+ * The memory for vertex, index and pixel data is much larger
+ * than the objects that own it. These are charged to a resource
+ * type with MemStats::Charge whenever the owner resizes its data area.
+ *
+ * A MemStats::Snapshot captures all the counts at one time.
+ * The difference between two snapshots shows which classes and
+ * resources grew, which is the quickest way to find a leak in a
+ * long running application.
+ *
+ * @code
+ *	Core::MemStats::Snapshot	before, after, growth;
+ *
+ *	before.Take();
+ *	...
+ *	after.Take();
+ *	growth.Diff(before, after);
+ *	Core::MemStats::WriteJSON(TEXT("growth.json"), &growth);
+ * @endcode
+ *
+ * @ingroup vcore
+ * @see Class::GetLiveObjects FrameStats::SetMemoryLog
+ */
+class MemStats
+{
+public:
+	/*!
+	 * @brief Types of resource memory (values for MemStats::Charge).
+	 */
+	enum
+	{
+		VERTEX = 0,		//!< vertex data
+		INDEX,			//!< vertex index data
+		BITMAP,			//!< texture pixel data
+		NUM_RESOURCES
+	};
+
+	//! Live object counts for a single class.
+	struct ClassStats
+	{
+		Class*		Info;			//!< class counted
+		int32		LiveObjects;	//!< objects currently allocated
+		int64		LiveBytes;		//!< bytes used by objects currently allocated
+		int32		TotalAllocs;	//!< objects allocated since startup
+	};
+
+	/*!
+	 * @brief Memory counts at a point in time, or the change between two times.
+	 *
+	 * Only classes which have had objects allocated are included.
+	 */
+	class Snapshot
+	{
+	public:
+		Snapshot();
+		~Snapshot();
+
+		//! Capture current memory counts.
+		bool		Take();
+		//! Compute the change between two snapshots.
+		bool		Diff(const Snapshot& before, const Snapshot& after);
+		//! Write snapshot as JSON.
+		void		Write(FILE* fp) const;
+		//! Discard class counts.
+		void		Empty();
+
+		double		Time;							//!< time taken in seconds, elapsed seconds for a difference
+		int64		ObjectBytes;					//!< total bytes in live objects
+		int64		LiveObjects;					//!< total number of live objects
+		int64		ResourceBytes[NUM_RESOURCES];	//!< bytes charged to each resource type
+		int32		NumClasses;						//!< number of class entries
+		ClassStats*	Classes;						//!< per-class counts
+		bool		IsDiff;							//!< \b true if result of MemStats::Snapshot::Diff
+
+	protected:
+		bool		Alloc(int32 n);
+		int32		m_MaxClasses;	// number of class entries allocated
+	};
+
+	//! Add to (or subtract from) the bytes used by a resource type.
+	static void			Charge(int restype, intptr bytes);
+	//! Get the bytes currently used by a resource type.
+	static int64		GetResourceBytes(int restype);
+	//! Get the name of a resource type.
+	static const char*	GetResourceName(int restype);
+	//! Get the total bytes in live objects of all classes.
+	static int64		GetObjectBytes();
+	//! Get the total number of live objects of all classes.
+	static int64		GetLiveObjects();
+	//! Write current counts, and optionally the change since a snapshot, as JSON.
+	static bool			WriteJSON(const TCHAR* filename, const Snapshot* since = NULL);
+
+protected:
+	static int64		s_Resources[NUM_RESOURCES];	// bytes charged to each resource type
+};
+
+} // end Core
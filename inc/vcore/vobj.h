@@ -11,7 +11,8 @@ namespace Core {
  *
  * @see valloc.h
  */
-extern double GetTime();
+extern double GetTime();		// monotonic time in seconds
+extern int64 GetTimeNS();		// monotonic time in nanoseconds
 
 // forward declarations
 class BaseObj;
@@ -241,11 +242,27 @@ public:
 //! Print XML description of class
 	void			Print(DebugOut& vixen_debug);
 
+// live object accounting
+//! Returns number of objects of this class currently allocated.
+	int32			GetLiveObjects() const				{ return m_liveObjects; }
+//! Returns bytes occupied by objects of this class currently allocated.
+	int64			GetLiveBytes() const				{ return m_liveBytes; }
+//! Returns number of objects of this class allocated since startup.
+	int32			GetTotalAllocs() const				{ return m_totalAllocs; }
+//! Records the allocation of an object of this class.
+	void			CountAlloc(size_t amount);
+//! Records the release of an object of this class.
+	void			CountFree(size_t amount);
+
 // IID => Class mapping for dynamic creation
 //! Returns class descriptor based on string name.
 	static Class*	GetClass (const TCHAR * iName);
 //! Returns class descriptor based on serial ID.
 	static Class*	GetClass (uint32 serialid);
+//! Returns number of registered classes.
+	static int		GetNumClasses();
+//! Returns registered class descriptor by index.
+	static Class*	GetClassAt(int index);
 
 // Class hierarchy linkage routines - used by INTERFACE macros
 	static Class*	LinkClass(Class* derivedClass, Class* baseClass);
@@ -278,6 +295,11 @@ public:
 	Interface*		m_pNextInterface;		// Establishes interface chain for iteration and discovery
 #endif
 
+// Live object counts - not in the class initializers so they start out zero
+	vint32			m_liveObjects;			// objects currently allocated
+	vint64			m_liveBytes;			// bytes used by objects currently allocated
+	vint32			m_totalAllocs;			// objects allocated since startup
+
 // Linkage static data members to fixup the hierarchy after static construction - private
 	static bool		s_isLinked;
 	static Class*	s_classFixup[];
@@ -217,4 +217,35 @@ inline Allocator*	Class::GetAllocator() const
 	return GlobalAllocator::Get();
 }
 
+/*!
+ * @fn void Class::CountAlloc(size_t amount)
+ * @param amount	number of bytes allocated
+ *
+ * Called by \b new for each object of this class allocated on the heap.
+ * The counts are always kept and are updated atomically so they
+ * can be read at any time from any thread.
+ *
+ * @see Class::CountFree Class::GetLiveObjects MemStats
+ */
+inline void Class::CountAlloc(size_t amount)
+{
+	InterlockInc(&m_liveObjects);
+	InterlockInc(&m_totalAllocs);
+	InterlockAdd(&m_liveBytes, (int64) amount);
+}
+
+/*!
+ * @fn void Class::CountFree(size_t amount)
+ * @param amount	number of bytes freed
+ *
+ * Called by \b delete for each object of this class released to its allocator.
+ *
+ * @see Class::CountAlloc Class::GetLiveBytes MemStats
+ */
+inline void Class::CountFree(size_t amount)
+{
+	InterlockDec(&m_liveObjects);
+	InterlockAdd(&m_liveBytes, -(int64) amount);
+}
+
 } // end Core
\ No newline at end of file
@@ -19,11 +19,18 @@
  * @def VX_DECLARE_CLASS(classname)
  * Declares members necessary for run-time type checking.
  * Place inside class declaration at the top.
+ *
+ * The class gets its own \b new and \b delete which count
+ * the live objects and bytes of the class so memory usage
+ * can be broken down by class.
+ *
+ * @see Class::GetLiveObjects MemStats
  */
 #define VX_DECLARE_CLASS(localClass)							\
 public:															\
 	void* operator new(size_t, void*);							\
 	void* operator new(size_t, Core::Allocator* = NULL);		\
+	void operator delete(void*, size_t);						\
 	virtual Core::Class* GetClass() const;						\
 	static	Core::Class ClassInfo;								\
 	static const TCHAR** DoNames;								\
@@ -43,7 +50,13 @@ public:															\
 	void* localClass::operator new(size_t n, Core::Allocator* a)			\
 		{  if (a == NULL) a = ClassInfo.GetAllocator();						\
 		   VX_TRACE(Core::BaseObj::Debug, ("%s(%d)\n", ClassInfo.GetName(), n));\
-		   return Core::BaseObj::operator new(n, a); }						\
+		   void* p = Core::BaseObj::operator new(n, a);					\
+		   if (p) ClassInfo.CountAlloc(n);								\
+		   return p; }													\
+	void localClass::operator delete(void* p, size_t n)					\
+		{  if (((Core::BaseObj*) p)->GetAllocator())					\
+			  ClassInfo.CountFree(n);									\
+		   Core::BaseObj::operator delete(p); }							\
  	Core::BaseObj* localClass::CreateObject(Core::Allocator* a)				\
  		{ return new (a) localClass(); }									\
 	Core::Class* localClass::GetClass() const 								\
@@ -64,7 +77,13 @@ public:															\
 	void* localClass::operator new(size_t n, Core::Allocator* a)			\
 		{  if (a == NULL) a = ClassInfo.GetAllocator();						\
 		   VX_TRACE(Core::BaseObj::Debug, ("%s(%d)\n", ClassInfo.GetName(), n));\
-		   return Core::BaseObj::operator new(n, a); }						\
+		   void* p = Core::BaseObj::operator new(n, a);					\
+		   if (p) ClassInfo.CountAlloc(n);								\
+		   return p; }													\
+	void localClass::operator delete(void* p, size_t n)					\
+		{  if (((Core::BaseObj*) p)->GetAllocator())					\
+			  ClassInfo.CountFree(n);									\
+		   Core::BaseObj::operator delete(p); }							\
  	Core::BaseObj* localClass::CreateObject(Core::Allocator* a)				\
  		{ return new (a) localClass(); }									\
 	Core::Class* localClass::GetClass() const 								\
@@ -0,0 +1,182 @@
+/*!
+ * @file vprofile.h
+ *
+ * @brief Low overhead hierarchical frame profiler.
+ *
+ * Scoped timers record nested zones into per-thread event buffers
+ * which are drained once per frame into per-zone statistics.
+ * Captured frames can be exported as Chrome / Perfetto trace JSON.
+ *
+ * Profiling is compiled in only if VX_PROFILE is defined.
+ * Otherwise the VX_PROFILE_xxx macros expand to nothing.
+ *
+ * @ingroup vcore
+ *
+ * @see vxframestats.h
+ */
+
+#pragma once
+
+namespace Core {
+
+#define	PROFILE_MaxZones		256		// maximum number of distinct zone names
+#define	PROFILE_MaxEvents		8192	// events per thread buffer (power of 2)
+#define	PROFILE_HistFrames		128		// frames in rolling zone history
+#define	PROFILE_HistBuckets		20		// log2 microsecond histogram buckets
+
+/*!
+ * @class Profiler
+ * @brief Collects timing information for named, nested zones of code.
+ *
+ * Each thread which enters a zone gets its own single producer,
+ * single consumer ring of events so recording a zone does not lock.
+ * The buffers are registered on a lock-free list the first time the
+ * thread records anything. Profiler::EndFrame is called once per frame
+ * by the display thread to drain all the buffers and update the
+ * rolling per-zone statistics. Zones are keyed by the address
+ * of their name string so class names (SharedObj::ClassName)
+ * and string literals are inexpensive to use as zone names.
+ *
+ * Detailed zones (VX_PROFILE_DETAIL) are only recorded if
+ * Profiler::Detail is set. These are used for per-object zones like
+ * engine evaluation which are too numerous to record all the time.
+ *
+ * @code
+ *	void Scene::DoDisplay()
+ *	{
+ *		VX_PROFILE_ZONE(TEXT("Scene::DoDisplay"));
+ *		...
+ *	}
+ *	Core::Profiler::StartCapture(10);		// capture next 10 frames
+ *	...
+ *	Core::Profiler::WriteTrace(TEXT("frame.json"));
+ * @endcode
+ *
+ * @ingroup vcore
+ * @see ProfileZone FrameStats::AddZone
+ */
+class Profiler
+{
+public:
+	//! Timing record for a single zone invocation.
+	struct Event
+	{
+		const TCHAR*	Name;		//!< zone name
+		int64			Start;		//!< start time in ticks
+		int64			End;		//!< end time in ticks
+		int32			Depth;		//!< nesting depth within thread
+		int32			Thread;		//!< index of thread that recorded it
+	};
+
+	//! Rolling statistics kept for each named zone.
+	struct ZoneStats
+	{
+		const TCHAR*	Name;							//!< zone name
+		int32			Calls;							//!< number of calls this frame
+		int64			FrameTicks;						//!< ticks accumulated this frame
+		float			Last;							//!< time last frame in milliseconds
+		float			Average;						//!< average time over history in milliseconds
+		float			Maximum;						//!< maximum time over history in milliseconds
+		int32			NumSamples;						//!< number of valid history entries
+		float			History[PROFILE_HistFrames];	//!< per-frame milliseconds (rolling)
+		int32			Histogram[PROFILE_HistBuckets];	//!< log2 microsecond buckets over history
+	};
+
+	//! Per-thread event buffer, written only by the owning thread.
+	struct ThreadBuffer
+	{
+		ThreadBuffer*	Next;					//!< next buffer in global list
+		int32			Index;					//!< thread index for trace output
+		int32			Depth;					//!< current nesting depth
+		vint32			Head;					//!< next event to write (producer)
+		vint32			Tail;					//!< next event to read (consumer)
+		vint32			Dropped;				//!< events dropped because buffer was full
+		Event			Events[PROFILE_MaxEvents];
+	};
+
+	static bool			Enabled;				//!< enable zone recording at runtime
+	static bool			Detail;					//!< enable detailed (per-object) zones
+
+	static int64		GetTicks();				//!< current high resolution time in ticks
+	static double		GetTickRate();			//!< ticks per second
+	static int64		Enter();				//!< enter a zone, returns start time
+	static void			Leave(const TCHAR* name, int64 start);	//!< leave zone, record event
+	static void			EndFrame();				//!< drain thread buffers, update zone statistics
+	static void			StartCapture(int nframes);	//!< begin capturing events for trace export
+	static bool			IsCapturing();			//!< \b true if a trace capture is in progress
+	static bool			WriteTrace(const TCHAR* filename);	//!< write captured frames as trace JSON
+	static const ZoneStats*	FindZone(const TCHAR* name);	//!< find statistics for a zone
+	static float		GetAverage(const TCHAR* name);	//!< average zone time in milliseconds
+	static float		GetPercentile(const TCHAR* name, float pct);	//!< zone time percentile in milliseconds
+	static int			GetNumZones();			//!< number of zones seen so far
+	static const ZoneStats*	GetZone(int i);		//!< get statistics for zone by index
+	static float		MeasureOverhead(int n = 1000);	//!< nanoseconds to record one zone
+	static int32		GetFrameEvents();		//!< number of zone events collected last frame
+	static void			Reset();				//!< discard statistics and captured events
+	static void			Shutdown();				//!< free thread buffers and captured events
+
+protected:
+	static ThreadBuffer*	GetBuffer();
+	static ZoneStats*		MakeZone(const TCHAR* name);
+	static void				AddSample(ZoneStats*, float ms);
+
+	THREAD_LOCAL ThreadBuffer*	t_Buffer;		// buffer for the current thread
+	static ThreadBuffer* volatile s_Buffers;	// list of all thread buffers
+	static vint32			s_NumThreads;		// number of registered threads
+	static ZoneStats*		s_Zones;			// zone statistics table
+	static int32			s_NumZones;			// number of zones in table
+	static Event*			s_Capture;			// captured events for trace output
+	static int32			s_CaptureSize;		// number of captured events
+	static int32			s_CaptureMax;		// allocated size of capture buffer
+	static int32			s_CaptureFrames;	// number of frames left to capture
+	static int32			s_FrameEvents;		// number of events drained by last EndFrame
+};
+
+/*!
+ * @class ProfileZone
+ * @brief Scoped timer which records a profiler zone for its lifetime.
+ *
+ * Use the VX_PROFILE_ZONE and VX_PROFILE_DETAIL macros instead
+ * of constructing these directly so the zones are compiled out
+ * when VX_PROFILE is not defined.
+ *
+ * @ingroup vcore
+ * @see Profiler
+ */
+class ProfileZone
+{
+public:
+	ProfileZone(const TCHAR* name)
+	{
+		m_Name = name;
+		m_Start = Profiler::Enabled ? Profiler::Enter() : 0;
+	}
+
+	ProfileZone(const TCHAR* name, bool detail)
+	{
+		m_Name = name;
+		m_Start = (Profiler::Enabled && Profiler::Detail) ? Profiler::Enter() : 0;
+	}
+
+	~ProfileZone()
+	{
+		if (m_Start)
+			Profiler::Leave(m_Name, m_Start);
+	}
+
+protected:
+	const TCHAR*	m_Name;
+	int64			m_Start;
+};
+
+#ifdef VX_PROFILE
+#define	VX_PROFILE_ZONE(name)		Core::ProfileZone _vx_zone_(name)
+#define	VX_PROFILE_DETAIL(name)		Core::ProfileZone _vx_zone_(name, true)
+#define	VX_PROFILE_FRAME()			Core::Profiler::EndFrame()
+#else
+#define	VX_PROFILE_ZONE(name)
+#define	VX_PROFILE_DETAIL(name)
+#define	VX_PROFILE_FRAME()
+#endif
+
+} // end Core
@@ -49,10 +49,11 @@ protected:
 //! Reference count value, 0 indicates not referenced.
 	mutable vint32	m_refCount;
 	friend class RefPtr;		// for access to m_refCount
+	friend class Epoch;			// for deferred delete
 protected:
 #ifndef VIXEN_EMSCRIPTEN
 //! Do not use delete, use RefObj::Delete
-	void operator delete(void*);
+	void operator delete(void*, size_t);
 #endif
 };
 
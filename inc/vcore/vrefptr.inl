@@ -6,8 +6,10 @@
 namespace Core {
 
 #ifndef VIXEN_EMSCRIPTEN
-inline void  RefObj::operator delete (void* ptr)
+inline void  RefObj::operator delete (void* ptr, size_t size)
 {
+	if (((BaseObj*) ptr)->GetAllocator())
+		ClassInfo.CountFree(size);
 	BaseObj::operator delete(ptr);
 }
 #endif
@@ -28,8 +30,14 @@ inline long  RefObj::Release()
 	long	refCount = InterlockDec(&m_refCount);
 
 	// Can discard object.  BaseObj::operator delete() takes care of Allocator handling
+	// In epoch mode, readers may still see it so free it after they leave
 	if (refCount == 0 && GetAllocator() != NULL) 
-		delete this; 
+	{
+		if (Epoch::IsEnabled())
+			Epoch::Retire(this);
+		else
+			delete this; 
+	}
 	return refCount;
 }
 
@@ -58,7 +66,12 @@ inline bool RefObj::Delete()
 			VX_PRINTF(("RefObj::Delete %p reference count < 0\n", this));
 #endif
 		if (refCount <= 0) 
-			delete this; 
+		{
+			if (Epoch::IsEnabled())
+				Epoch::Retire(this);
+			else
+				delete this; 
+		}
 	}
 	return (refCount == 0);
 }
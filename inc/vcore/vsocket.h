@@ -13,6 +13,9 @@ namespace Core {
 
 #define	STREAM_DefaultPort	1234
 #define	STREAM_MaxReads		10
+#define	SOCK_MaxClients		32
+#define	SOCK_MaxQueueBytes	(16 * 1024 * 1024)
+#define	SOCK_MaxStallTime	2.0f
 
 /*!
  * @class Socket
@@ -61,13 +64,48 @@ protected:
  * This socket stream can be used to maintain a single server that maintains
  * a scene graph across a set of multiple clients. It can also be used to
  * implement a distributed 3D world across a network.
- * 
+ *
+ * The client sockets are non-blocking. Output sent to a client is written
+ * immediately if the socket can accept it. Whatever cannot be written is
+ * appended to a send queue for that client and written the next time the
+ * arbitrator is flushed or output is sent to the client. Queued output and
+ * new output are written together with a single gather write so a client
+ * which falls behind a few packets catches up with one system call.
+ * Sending never waits for a client, the time spent by the server each frame
+ * depends on how much is sent, not on how fast the clients read it.
+ *
+ * A client is considered slow if more than SocketArbitrator::MaxQueueBytes
+ * are queued for it or its queue has made no progress for
+ * SocketArbitrator::MaxStallTime seconds. Slow clients are handled according
+ * to SocketArbitrator::SlowPolicy:
+ * @code
+ *	SLOW_DROP	close the connection, the client must reconnect
+ *	SLOW_RESYNC	discard the complete packets waiting in the queue,
+ *				the client must be sent the whole scene again
+ * @endcode
+ * Connections which were dropped or need to be resynchronized are
+ * reported by SocketArbitrator::GetStalled.
+ *
+ * Input readiness is determined with epoll on Linux and select elsewhere.
+ * The connection ID of a client is its slot in the arbitrator. Slots are
+ * not renumbered when a client disconnects, they are reused by the
+ * next client which connects.
+ *
  * @ingroup vcore
- * @see Arbitrator
+ * @see Arbitrator Synchronizer
  */
 class SocketArbitrator : public Arbitrator
 {
 public:
+	/*
+	 * What to do with a client that cannot keep up
+	 */
+	enum
+	{
+		SLOW_DROP = 0,		//!< close connection to slow client
+		SLOW_RESYNC = 1,	//!< discard queued output for slow client
+	};
+
 	SocketArbitrator(int port = STREAM_DefaultPort);
 	~SocketArbitrator();
 
@@ -75,29 +113,66 @@ public:
 	int		FindConnection(intptr connection) const;
 	bool	SendConnection(intptr connid, const char* buf, int nbytes);
 	int		Select(int* connections, int n);
+	int		GetStalled(int* connections, int n);
 	bool	Open(const TCHAR* name, int mode = Stream::OPEN_RW);
 	bool	Close();
 	bool	IsEmpty() const;
+	void	Flush();
 	size_t	Read(char* buffer, size_t nbytes);
 	size_t	Write(const char* buf, size_t nbytes);
 	intptr	GetAt(int i) const;
 	int		GetSize() const;
-	void	RemoveConnection(intptr connection);
-	bool	SendAll(intptr sendflags);
+	void	RemoveConnection(int connid);
 
-	int				MaxReads;		// maximum reads before empty
+//! Returns the number of bytes waiting to be sent to a connection.
+	int		GetQueued(int connid) const;
+
+	int32			MaxQueueBytes;	//!< maximum bytes queued for a client before it is slow
+	float			MaxStallTime;	//!< maximum seconds a client queue may make no progress
+	float			ReadTimeOut;	//!< maximum seconds to wait for the rest of a message
+	int32			SlowPolicy;		//!< what to do with slow clients, SLOW_DROP or SLOW_RESYNC
 
 protected:
-	bool			DoConnect;		// send connected obj list
-	mutable fd_set	m_Pending;		// FDs with pending input
+	/*
+	 * Connection to a single client.
+	 * Output which could not be sent is kept in the send queue.
+	 * The end of each queued packet is remembered so a
+	 * client can be resynchronized on a packet boundary.
+	 */
+	struct Client
+	{
+		SOCKET		Sock;		// client socket, INVALID_SOCKET if slot is free
+		char*		SendBuf;	// send queue
+		int32		SendStart;	// offset of first unsent byte
+		int32		SendEnd;	// offset past last queued byte
+		int32		SendMax;	// allocated size of send queue
+		int32*		Packets;	// queue offset of the end of each packet
+		int32		NumPackets;	// number of packets in the queue
+		int32		MaxPackets;	// allocated size of packet array
+		int64		StallTicks;	// time of last progress while output is queued
+		bool		Stalled;	// dropped or resynced since GetStalled
+	};
+
+	bool		Enqueue(Client& client, const char* buf, int nbytes);
+	bool		SendQueue(int connid, const char* buf, int nbytes);
+	void		CheckSlow(int connid, int64 now);
+	void		DropClient(int connid, bool report);
+	bool		NextInput();
+	bool		HasInput(SOCKET sock);
+	bool		WaitInput(SOCKET sock);
+	int			Poll();
+	void		Accept();
+
+	Client			m_Clients[SOCK_MaxClients];
+	SOCKET			m_Ready[SOCK_MaxClients + 1];	// sockets with input from last poll
+	int32			m_NumReady;		// number of sockets in m_Ready
+	int32			m_NextReady;	// next entry in m_Ready to check
+	int32			m_NumSlots;		// one past highest client slot used
 	SOCKET			m_Listener;		// socket used to listen for input
-	timeval			m_TimeOut;		// timeout for input wait
+	intptr			m_EPoll;		// epoll descriptor (Linux only)
 	int				m_Port;			// port to connect with
 	mutable SOCKET	m_CurSock;		// current socket for read/write
-	uint32			m_NumRecvd;		// number of clients who have responded
 	uint32			m_NumClients;	// number of clients
-	mutable int32	m_NumReads;		// number of socket reads so far
-	mutable fd_set	m_Clients;		// FDs to listen for input on
 };
 
 } // end Core
\ No newline at end of file
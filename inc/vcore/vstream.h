@@ -125,6 +125,8 @@ public:
 	virtual void	RemoveConnection(int connectid);
 //! Send data to this connection.
 	virtual bool	SendConnection(intptr connectid, const char* buf, int n);
+//! Get connections which could not keep up with output.
+	virtual int		GetStalled(int* connectids, int n);
 //! Finds the device handle for a connection given its connection ID.
 	virtual intptr	GetAt(int connectid) const;
 //! Get number of connections.
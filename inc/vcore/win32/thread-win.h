@@ -81,6 +81,8 @@ public:
 	void			SetThreadFunc(ThreadFunc* func)	{ m_ThreadFunc = func; }
 //! Run this thread with the given thread function.
 	virtual void	Run(ThreadFunc* = NULL);
+//! Wait for this thread to exit.
+	bool			Join();
 //! Suspend this thread, wait for resume event to be signalled.
 	virtual bool	Suspend();
 //! Resume this thread, signal a resume event.
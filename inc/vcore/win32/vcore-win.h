@@ -15,6 +15,7 @@
  * @par Compile Options
  *	_WIN32			enable compilation for Windows platform
  *	VX_NOTHREAD		disable multi-threading and locking
+ *	VX_PROFILE		enable hierarchical frame profiler zones
  *
  */
 
@@ -45,6 +46,7 @@ namespace Vixen {
 #include "vcore/vobj.h"
 #include "vcore/valloc.h"
 #include "vcore/win32/vlock-win.h"
+#include "vcore/vepoch.h"
 #include "vcore/vtlsdata.h"
 #include "vcore/vstringpool.h"
 #include "vcore/vrefptr.h"
@@ -52,6 +54,8 @@ namespace Vixen {
 #include "vcore/vref.h"		// class Ref in global namespace
 #include "vcore/vref.inl"
 #include "vcore/vstring.h"
+#include "vcore/vatom.h"
+#include "vcore/vcompress.h"
 
 #include "vcore/vobj.inl"	// after vobj/valloc sequence
 #include "vcore/varray.h"
@@ -74,6 +78,8 @@ namespace Vixen {
 #include "vcore/vthread.h"
 #include "vcore/vpool.h"
 #include "vcore/vbufq.h"
+#include "vcore/vprofile.h"
+#include "vcore/vmemstats.h"
 
 extern DebugOut& vixen_debug;
 } // end Vixen
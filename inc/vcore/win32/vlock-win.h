@@ -100,6 +100,9 @@ inline void	InterlockOr(vint32* dst, int32 val)
 	do { oldval = *dst; newval = oldval | val; } while (!InterlockTestSet(dst, newval, oldval));
 }
 
+inline int64	InterlockAdd(vint64* dst, int64 val)
+{ return InterlockedExchangeAdd64(dst, val); }
+
 
 #endif
 
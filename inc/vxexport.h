@@ -12,6 +12,7 @@
 #include "render/vximage.h"
 #include "render/vximage.inl"
 #include "render/vxdevbuf.h"
+#include "scene/vxlightcluster.h"
 #include "scene/vxlight.h"
 #include "render/vxmaterial.h"
 #include "render/vxsampler.h"
@@ -30,6 +31,8 @@
 #include "base/vxsysevents.h"
 #include "scene/vxworld3d.h"
 #include "render/vxgeosort.h"
+#include "render/vxrenderstream.h"
+#include "render/vxnullrender.h"
 #include "scene/vxscene.inl"
 #include "base/vxsysevents.inl"
 #include "scene/vxdualscene.h"
@@ -48,6 +51,8 @@
 #include "scene/vxextmodel.h"
 //#include "sim/vxtexswitcher.h"
 #include "render/vxtextgeom.h"
+#include "render/vxglyphatlas.h"
+#include "render/vxtextbatch.h"
 #include "sim/vxtrigger.h"
 #include "sim/vxsequencer.h"
 #include "sim/vxscriptor.h"
@@ -58,6 +63,8 @@
 #include "sim/vxdeformer.h"
 #include "sim/vxpose.h"
 #include "sim/vxskeleton.h"
+#include "sim/vxclip.h"
+#include "sim/vxblendtree.h"
 #include "sim/vxposemapper.h"
 #include "sim/vxskin.h"
 #include "sim/vxmorph.h"
@@ -12,6 +12,7 @@
 #include "render/vximage.h"
 #include "render/vximage.inl"
 #include "render/vxdevbuf.h"
+#include "scene/vxlightcluster.h"
 #include "scene/vxlight.h"
 #include "render/vxmaterial.h"
 #include "render/vxsampler.h"
@@ -31,6 +32,7 @@
 #include "base/vxsysevents.h"
 #include "scene/vxworld3d.h"
 #include "render/vxgeosort.h"
+#include "render/vxrenderstream.h"
 #include "scene/vxscene.inl"
 #include "base/vxsysevents.inl"
 #include "scene/vxdualscene.h"
@@ -42,12 +44,16 @@
 #include "sim/vxanimator.h"
 #include "scene/vxextmodel.h"
 #include "render/vxtextgeom.h"
+#include "render/vxglyphatlas.h"
+#include "render/vxtextbatch.h"
 #include "sim/vxtrigger.h"
 #include "sim/vxsequencer.h"
 #include "sim/vxscriptor.h"
 #include "sim/vxdeformer.h"
 #include "sim/vxpose.h"
 #include "sim/vxskeleton.h"
+#include "sim/vxclip.h"
+#include "sim/vxblendtree.h"
 #include "sim/vxposemapper.h"
 #include "sim/vxskin.h"
 #include "sim/vxmorph.h"
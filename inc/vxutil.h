@@ -61,6 +61,7 @@ namespace Vixen
 #include "util/vxterrain.h"
 #include "util/vxterrcoll.h"
 #include "util/vxtrackball.h"
+#include "util/sceneopt.h"
 
 #ifdef _MANAGED
 #pragma managed(pop)
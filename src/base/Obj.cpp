@@ -20,6 +20,25 @@ VX_IMPLEMENT_CLASS(NameProp, Property);
 
 Property::~Property() { if (Owner) ((SharedObj*) Owner)->RemoveProp(this); }
 
+/*
+ * Interns the name in the atom table and shares its string.
+ * If the atom table is full, the name keeps its own copy of
+ * the string without an atom instead of being dropped.
+ */
+void NameProp::Intern(const TCHAR* name)
+{
+	Core::Atom	atom = Core::AtomTable::Intern(name);
+
+	if (atom || (name == NULL) || (*name == 0))
+	{
+		SetAtom(atom);
+		return;
+	}
+	m_Atom = 0;
+	m_String = name;
+	VX_WARNING(("NameProp: atom table full, name %s is compared by string\n", name));
+}
+
 /*!
  * @fn Property* SharedObj::GetProp(uint32 tag) const
  * @param tag	16-bit tag for the property we want
@@ -39,7 +58,7 @@ Property::~Property() { if (Owner) ((SharedObj*) Owner)->RemoveProp(this); }
  */
 Property* SharedObj::GetProp(intptr tag) const
 {
-	ObjectLock lock(this);
+	ObjectLock lock(Core::Epoch::IsReading() ? NULL : this);
 	Property* p = m_Prop;
  
 	while (p)
@@ -69,7 +88,7 @@ Property* SharedObj::GetProp(intptr tag) const
  */
 Property* SharedObj::GetProp(intptr tag, uint32 key) const
 {
-	ObjectLock lock(this);
+	ObjectLock lock(Core::Epoch::IsReading() ? NULL : this);
 	Property* p = m_Prop;
  
 	while (p)
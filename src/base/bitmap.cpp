@@ -47,7 +47,9 @@ Bitmap::Bitmap() : SharedObj()
 	Width = 0;
 	Depth = 0;
 	Height = 0;
+	ByteSize = 0;
 	DevHandle = 0;
+	m_MemCharged = 0;
 }
 
 Bitmap::~Bitmap()
@@ -70,8 +72,36 @@ Bitmap&	Bitmap::operator=(const Bitmap& src)
 	return *this;
 };
 
+/*!
+ * @fn void Bitmap::UpdateMemStats()
+ *
+ * Charges the size of the pixel data area to bitmap memory
+ * in Core::MemStats. The size is Bitmap::ByteSize if it is set,
+ * otherwise it is computed from the dimensions and depth.
+ * This is called automatically when a bitmap is loaded. Code which
+ * supplies its own data area should call it after setting the
+ * data pointer and dimensions. Bitmap::Kill removes the charge.
+ *
+ * @see Core::MemStats::Charge Bitmap::Kill
+ */
+void Bitmap::UpdateMemStats()
+{
+	intptr	bytes = ByteSize;
+
+	if (Data == NULL)
+		bytes = 0;
+	else if (bytes <= 0)
+		bytes = (intptr) Width * Height * Depth / 8;
+	if (bytes == m_MemCharged)
+		return;
+	Core::MemStats::Charge(Core::MemStats::BITMAP, bytes - m_MemCharged);
+	m_MemCharged = bytes;
+}
+
 void Bitmap::Kill()
 {
+	Core::MemStats::Charge(Core::MemStats::BITMAP, -m_MemCharged);
+	m_MemCharged = 0;
 #ifndef VX_NOTEXTURE
 	if ((Data == NULL) || (Format & Bitmap::NOFREE_DATA))
 		return;
@@ -157,6 +187,7 @@ bool Bitmap::Load(const TCHAR* filename, Core::Stream* stream)
 	ReadBitmap(filename, stream);
 	if (Data)
 	{
+		UpdateMemStats();
 		VX_TRACE(Bitmap::Debug || FileLoader::Debug, ("Image::Load %s load complete\n", filename));
 		return true;
 	}
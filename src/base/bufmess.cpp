@@ -27,6 +27,7 @@ BufMessenger::BufMessenger(Core::ThreadQueue* bufpool)
  :	Messenger(NULL, true), m_BufPool(bufpool)
 {
 	Open(NULL, Stream::OPEN_RW);
+	DirectEvents = true;
 	VX_ASSERT(s_OnlyOne == NULL);
 	s_OnlyOne = this;
 }
@@ -300,6 +301,12 @@ bool BufMessenger::Load()
 		Messenger::Load();	// load from only that log
 		SetReadBuf(NULL);		// don't reuse read buffer from this log
 		m_ReadPtr = NULL;
+		if (log == MESS_EventLog)
+		{
+			t_NoLog = false;	// enable logging during events
+			m_EventBus->Deliver();	// dispatch events posted directly
+			t_NoLog = true;
+		}
 	}
 	t_NoLog = false;			// enable logging for this thread
 	return true;
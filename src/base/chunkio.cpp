@@ -0,0 +1,896 @@
+#include "vixen.h"
+
+namespace Vixen {
+
+VX_IMPLEMENT_CLASS(ChunkMessenger, FileMessenger);
+
+int32	ChunkMessenger::ChunkSize = 256 * 1024;
+int32	ChunkMessenger::NumThreads = 4;
+
+#define	CHUNK_HeaderWords	6				// number of words in file header
+#define	CHUNK_BatchSize		64				// most chunks decompressed at once
+
+/*
+ * One chunk to decompress
+ */
+struct ChunkJob
+{
+	const char*	Packed;		// compressed data
+	int32		PackSize;	// number of compressed bytes
+	char*		Data;		// buffer for uncompressed data
+	int32		RawSize;	// number of uncompressed bytes
+};
+
+/*
+ * Decompresses every \b step job starting with job \b first.
+ * Returns the number of chunks which could not be decompressed.
+ */
+static int32 DecompressJobs(ChunkJob* jobs, int32 njobs, int32 first, int32 step)
+{
+	int32 failed = 0;
+
+	for (int32 i = first; i < njobs; i += step)
+	{
+		ChunkJob& job = jobs[i];
+
+		if (Core::Compressor::Decompress(job.Packed, job.PackSize, job.Data, job.RawSize) != job.RawSize)
+			++failed;
+	}
+	return failed;
+}
+
+#ifndef VX_NOTHREAD
+/*
+ * Thread which decompresses some of the chunks being loaded.
+ */
+class ChunkThread : public Core::Thread
+{
+public:
+	ChunkThread() : Core::Thread(0), Jobs(NULL), NumJobs(0), First(0), Step(1), Failed(0) { }
+
+	static Core::ThreadFunc	DecompressFunc;
+
+	ChunkJob*	Jobs;		// all the chunks being decompressed
+	int32		NumJobs;	// number of chunks
+	int32		First;		// first chunk for this thread
+	int32		Step;		// number of threads
+	int32		Failed;		// number of chunks which could not be decompressed
+};
+
+#if defined(_WIN32) && !defined(VX_PTHREAD)
+void ChunkThread::DecompressFunc(void* arg)
+#else
+void* ChunkThread::DecompressFunc(void* arg)
+#endif
+{
+	ChunkThread&	thread = *((ChunkThread*) arg);
+
+	thread.Failed = DecompressJobs(thread.Jobs, thread.NumJobs, thread.First, thread.Step);
+	thread.Stop();
+#if !defined(_WIN32) || defined(VX_PTHREAD)
+	return NULL;
+#endif
+}
+#endif
+
+ChunkMessenger::ChunkMessenger(const TCHAR* filename) : FileMessenger(filename)
+{
+	m_Chunks = NULL;
+	m_NumChunks = m_MaxChunks = 0;
+	m_Subtrees = NULL;
+	m_NumSubtrees = 0;
+	m_NumLoaded = 0;
+	m_Deps = NULL;
+	m_NumDeps = m_MaxDeps = 0;
+	m_DataStart = m_ReadOffset = 0;
+	m_CurSubtree = -1;
+	m_Buffer = NULL;
+	m_BufSize = m_BufMax = 0;
+	m_ReadPos = 0;
+	m_PackData = NULL;
+	m_PackSize = m_PackMax = 0;
+	m_HandleChunk = NULL;
+	m_DepMark = NULL;
+	m_MaxHandle = 0;
+}
+
+ChunkMessenger::~ChunkMessenger()
+{
+	FreeChunks();
+}
+
+/*!
+ * @fn bool ChunkMessenger::IsChunked(const TCHAR* filename)
+ * @param filename	name of file to check
+ *
+ * @return \b true if the file has the .vxz extension used for chunked files
+ */
+bool ChunkMessenger::IsChunked(const TCHAR* filename)
+{
+	const TCHAR* ext;
+
+	if (filename == NULL)
+		return false;
+	ext = STRRCHR(filename, TEXT('.'));
+	return ext && (STRCASECMP(ext, TEXT(".vxz")) == 0);
+}
+
+/*!
+ * @fn bool ChunkMessenger::Open(const TCHAR* filename, int mode)
+ * @param filename	name of chunked file
+ * @param mode		Core::Stream::OPEN_WRITE to make a new chunked file,
+ *					Core::Stream::OPEN_READ to read an existing one
+ *
+ * When opened for writing, everything saved to the messenger is
+ * accumulated in chunks which are compressed as they fill up.
+ * The file is written when the messenger is closed.
+ * When opened for reading, the chunk directory is read but no
+ * chunks are loaded.
+ *
+ * @return \b true if file was opened, \b false on error
+ *
+ * @see ChunkMessenger::Close ChunkMessenger::Load ChunkMessenger::LoadSubtree
+ */
+bool ChunkMessenger::Open(const TCHAR* filename, int mode)
+{
+	FreeChunks();
+	if (mode & OPEN_WRITE)
+	{
+		if (!AddChunk())
+			return false;
+		if (!FileMessenger::Open(filename, mode & ~OPEN_READ))	// version commands go into chunk 0
+			return false;
+		return FlushChunk();
+	}
+	if (m_InStream.IsNull())
+		m_InStream = new Core::FileStream;
+	if (!m_InStream->Open(filename, OPEN_READ))
+		return false;
+	Version = 0;
+	m_OpenMode = OPEN_READ;
+	m_Objs = new ObjMap;
+	m_Names = new NameTable;
+	return ReadDirectory();
+}
+
+/*!
+ * @fn bool ChunkMessenger::Close()
+ *
+ * If the messenger was open for writing, the last chunk is compressed
+ * and the chunked file is written. The directory and any chunk data still
+ * in memory are freed. Objects which have been loaded and the
+ * name dictionary are not affected.
+ *
+ * @see ChunkMessenger::Open
+ */
+bool ChunkMessenger::Close()
+{
+	bool	rc = true;
+
+	if ((m_OpenMode & OPEN_WRITE) && !m_OutStream.IsNull() && m_Chunks)
+	{
+		int32 v = VIXEN_End;
+
+		if (m_CurSubtree >= 0)
+			EndSubtree();
+		Write((const char*) &v, sizeof(int32));
+		rc = FlushChunk() && WriteFile();
+	}
+	FreeChunks();
+	if (!Messenger::Close())
+		return false;
+	return rc;
+}
+
+/*!
+ * @fn bool ChunkMessenger::ReadDirectory()
+ *
+ * Reads the header and chunk directory from the input stream.
+ * The stream must be positioned at the start of the file.
+ * This is done automatically by ChunkMessenger::Open or by the first
+ * load if the input stream was supplied with Messenger::SetInStream.
+ *
+ * @return \b true if directory was read, \b false if the file is not a chunked file
+ */
+bool ChunkMessenger::ReadDirectory()
+{
+	int32	header[CHUNK_HeaderWords];
+	int32*	dir;
+	int32*	ip;
+	int32*	iend;
+	int32	n;
+
+	FreeChunks();
+	if (m_InStream.IsNull() ||
+		(m_InStream->Read((char*) header, sizeof(header)) != sizeof(header)))
+		VX_ERROR(("ChunkMessenger::ReadDirectory ERROR cannot read header\n"), false);
+	if ((header[0] != CHUNK_Magic) || (header[1] != CHUNK_Version) ||
+		(header[2] <= 0) || (header[3] < 0) || (header[4] <= 0) || (header[4] & 3))
+		VX_ERROR(("ChunkMessenger::ReadDirectory ERROR not a chunked file\n"), false);
+	dir = (int32*) malloc(header[4]);
+	m_Chunks = (Chunk*) calloc(header[2], sizeof(Chunk));
+	m_Subtrees = (Subtree*) calloc(header[3] + 1, sizeof(Subtree));
+	if ((dir == NULL) || (m_Chunks == NULL) || (m_Subtrees == NULL) ||
+		(m_InStream->Read((char*) dir, header[4]) != size_t(header[4])))
+	{
+		if (dir)
+			free(dir);
+		FreeChunks();
+		VX_ERROR(("ChunkMessenger::ReadDirectory ERROR cannot read directory\n"), false);
+	}
+	m_MaxChunks = header[2];
+	ip = dir;
+	iend = dir + header[4] / sizeof(int32);
+	for (n = 0; n < header[2]; ++n)			// read chunk entries
+	{
+		Chunk& c = m_Chunks[n];
+
+		if ((iend - ip) < 4)
+			break;
+		c.Offset = *ip++;
+		c.PackSize = *ip++;
+		c.RawSize = *ip++;
+		c.NumDeps = *ip++;
+		c.FirstDep = m_NumDeps;
+		c.Subtree = -1;
+		if ((c.Offset < 0) || (c.PackSize < 0) || (c.RawSize < 0) ||
+			(c.NumDeps < 0) || (c.NumDeps > (iend - ip)))
+			break;
+		while (c.NumDeps-- > 0)
+		{
+			if ((*ip < 0) || (*ip >= n))	// only earlier chunks
+				break;
+			AddDep(*ip++);
+		}
+		if (c.NumDeps >= 0)
+			break;
+		c.NumDeps = m_NumDeps - c.FirstDep;
+		++m_NumChunks;
+	}
+	for (n = 0; (n < header[3]) && (m_NumChunks == header[2]); ++n)
+	{										// read subtree entries
+		Subtree&	s = m_Subtrees[n];
+		TCHAR		name[VX_MaxName + 4];
+		int32		len;
+
+		if ((iend - ip) < 3)
+			break;
+		s.First = *ip++;
+		s.Count = *ip++;
+		len = *ip++;
+		if ((s.First < 0) || (s.Count <= 0) || (s.First + s.Count > m_NumChunks) ||
+			(len <= 0) || (len > VX_MaxName) || (len & 3) || (len / 4 > (iend - ip)))
+			break;
+		memcpy(name, ip, len);
+		name[len / sizeof(TCHAR)] = 0;
+		ip += len / 4;
+		s.Name = Core::AtomTable::Intern(name);
+		for (int32 i = s.First; i < s.First + s.Count; ++i)
+			m_Chunks[i].Subtree = n;
+		++m_NumSubtrees;
+	}
+	free(dir);
+	if ((m_NumChunks != header[2]) || (m_NumSubtrees != header[3]))
+	{
+		FreeChunks();
+		VX_ERROR(("ChunkMessenger::ReadDirectory ERROR bad directory\n"), false);
+	}
+	m_DataStart = m_ReadOffset = sizeof(header) + header[4];
+	return true;
+}
+
+/*!
+ * @fn bool ChunkMessenger::Load()
+ *
+ * Loads all of the chunks which have not already been loaded.
+ * The chunks are decompressed in parallel and executed in the
+ * order they were saved, which has the same result as loading
+ * the original .vix file.
+ *
+ * @return \b true if all chunks were loaded, \b false on error
+ *
+ * @see ChunkMessenger::LoadSubtree Messenger::Load
+ */
+bool ChunkMessenger::Load()
+{
+	int32*	list;
+	int32	n = 0;
+	bool	rc;
+
+	if ((m_Chunks == NULL) && !ReadDirectory())
+		return false;
+	list = (int32*) malloc(m_NumChunks * sizeof(int32));
+	if (list == NULL)
+		return false;
+	for (int32 i = 0; i < m_NumChunks; ++i)
+		if (!m_Chunks[i].Loaded)
+			list[n++] = i;
+	rc = LoadChunks(list, n);
+	free(list);
+	return rc;
+}
+
+/*
+ * Marks a chunk as needed and adds it to the work list if it was not already.
+ */
+static int32 NeedChunk(int32 chunk, char* need, int32* work, int32 nwork)
+{
+	if (!need[chunk])
+	{
+		need[chunk] = 1;
+		work[nwork++] = chunk;
+	}
+	return nwork;
+}
+
+/*!
+ * @fn SharedObj* ChunkMessenger::LoadSubtree(const TCHAR* name)
+ * @param name	name of subtree in the chunk directory
+ *
+ * Loads only the chunks needed to make the named subtree:
+ * the chunks which were saved for it, the chunks which make
+ * the objects they refer to and the subtrees containing those chunks.
+ * Chunks which have already been loaded are not loaded again, so
+ * loading several subtrees which share objects only makes them once.
+ *
+ * @return root of subtree, NULL if there is no subtree with that name
+ *
+ * @see ChunkMessenger::Load ChunkMessenger::FindSubtree SceneLoader::Find
+ */
+SharedObj* ChunkMessenger::LoadSubtree(const TCHAR* name)
+{
+	int32	s;
+	char*	need;
+	int32*	work;
+	int32	nwork = 0;
+	int32	n = 0;
+	bool	rc;
+
+	if ((m_Chunks == NULL) && !ReadDirectory())
+		return NULL;
+	if ((s = FindSubtree(name)) < 0)
+		return NULL;
+	need = (char*) calloc(m_NumChunks, 1);
+	work = (int32*) malloc(m_NumChunks * sizeof(int32));
+	if ((need == NULL) || (work == NULL))
+	{
+		if (need)
+			free(need);
+		if (work)
+			free(work);
+		VX_ERROR(("ChunkMessenger::LoadSubtree ERROR out of memory\n"), NULL);
+	}
+	nwork = NeedChunk(0, need, work, nwork);	// version commands
+	for (int32 i = 0; i < m_Subtrees[s].Count; ++i)
+		nwork = NeedChunk(m_Subtrees[s].First + i, need, work, nwork);
+	while (nwork > 0)
+	{
+		Chunk&	c = m_Chunks[work[--nwork]];
+
+		for (int32 d = 0; d < c.NumDeps; ++d)
+		{
+			int32 dep = m_Deps[c.FirstDep + d];
+
+			if (need[dep])
+				continue;
+			nwork = NeedChunk(dep, need, work, nwork);
+			if (m_Chunks[dep].Subtree >= 0)		// objects may be finished in later chunks
+			{
+				Subtree& t = m_Subtrees[m_Chunks[dep].Subtree];
+
+				for (int32 i = 0; i < t.Count; ++i)
+					nwork = NeedChunk(t.First + i, need, work, nwork);
+			}
+		}
+	}
+	for (int32 i = 0; i < m_NumChunks; ++i)		// load in file order
+		if (need[i] && !m_Chunks[i].Loaded)
+			work[n++] = i;
+	rc = LoadChunks(work, n);
+	free(need);
+	free(work);
+	if (!rc)
+		return NULL;
+	return Find(name);
+}
+
+/*
+ * Reads, decompresses and executes the given chunks in batches.
+ * The chunk list must be in ascending order.
+ */
+bool ChunkMessenger::LoadChunks(int32* list, int32 n)
+{
+	bool	rc = true;
+
+	for (int32 b = 0; (b < n) && rc; b += CHUNK_BatchSize)
+	{
+		int32	nbatch = n - b;
+		int32	i;
+
+		if (nbatch > CHUNK_BatchSize)
+			nbatch = CHUNK_BatchSize;
+		for (i = 0; i < nbatch; ++i)			// read compressed chunks
+		{
+			Chunk&	c = m_Chunks[list[b + i]];
+			int32	pos = m_DataStart + c.Offset;
+
+			if ((pos != m_ReadOffset) && (m_InStream->Seek(pos, Core::Stream::SEEK_FROM_START) < 0))
+				break;
+			m_ReadOffset = pos;
+			c.Packed = (char*) malloc(c.PackSize + 1);
+			c.Data = (char*) malloc(c.RawSize + 1);
+			if ((c.Packed == NULL) || (c.Data == NULL) ||
+				(m_InStream->Read(c.Packed, c.PackSize) != size_t(c.PackSize)))
+				break;
+			m_ReadOffset += c.PackSize;
+		}
+		if (i < nbatch)
+		{
+			VX_ERROR(("ChunkMessenger::Load ERROR cannot read chunk %d\n", list[b + i]), false);
+			rc = false;
+		}
+		else if (!Decompress(list + b, nbatch))
+			rc = false;
+		for (i = 0; i < nbatch; ++i)			// execute chunks in order
+		{
+			Chunk& c = m_Chunks[list[b + i]];
+
+			if (rc)
+			{
+				m_Buffer = c.Data;
+				m_BufSize = c.RawSize;
+				m_ReadPos = 0;
+				FileMessenger::Load();
+				c.Loaded = true;
+				++m_NumLoaded;
+			}
+			if (c.Packed)
+				free(c.Packed);
+			if (c.Data)
+				free(c.Data);
+			c.Packed = c.Data = NULL;
+		}
+		m_Buffer = NULL;
+		m_BufSize = m_ReadPos = 0;
+	}
+	return rc;
+}
+
+/*
+ * Decompresses the given chunks using up to NumThreads threads.
+ * The calling thread decompresses its share too. All the threads
+ * are joined before returning. If a thread cannot be started,
+ * its chunks count as corrupted.
+ */
+bool ChunkMessenger::Decompress(int32* list, int32 n)
+{
+	ChunkJob	jobs[CHUNK_BatchSize];
+	int32		nthreads = NumThreads;
+	int32		failed;
+
+	VX_ASSERT(n <= CHUNK_BatchSize);
+	for (int32 i = 0; i < n; ++i)
+	{
+		Chunk& c = m_Chunks[list[i]];
+
+		jobs[i].Packed = c.Packed;
+		jobs[i].PackSize = c.PackSize;
+		jobs[i].Data = c.Data;
+		jobs[i].RawSize = c.RawSize;
+	}
+	if (nthreads > n)
+		nthreads = n;
+	if (nthreads > CHUNK_MaxThreads)
+		nthreads = CHUNK_MaxThreads;
+#ifdef VX_NOTHREAD
+	nthreads = 1;
+#else
+	ChunkThread	threads[CHUNK_MaxThreads];
+
+	for (int32 t = 1; t < nthreads; ++t)
+	{
+		threads[t].Jobs = jobs;
+		threads[t].NumJobs = n;
+		threads[t].First = t;
+		threads[t].Step = nthreads;
+		threads[t].Run(&ChunkThread::DecompressFunc);
+		if (threads[t].GetThreadHandle() == NULL)	// thread not started?
+			threads[t].Failed = (n - t + nthreads - 1) / nthreads;
+	}
+#endif
+	if (nthreads < 1)
+		nthreads = 1;
+	failed = DecompressJobs(jobs, n, 0, nthreads);
+#ifndef VX_NOTHREAD
+	for (int32 t = 1; t < nthreads; ++t)
+	{
+		threads[t].Join();
+		failed += threads[t].Failed;
+	}
+#endif
+	if (failed)
+		VX_ERROR(("ChunkMessenger::Load ERROR %d chunks are corrupted\n", failed), false);
+	return true;
+}
+
+/*!
+ * @fn bool ChunkMessenger::BeginSubtree(const TCHAR* name)
+ * @param name	name of the subtree, usually the name of its root object
+ *
+ * Starts a new chunk for the named subtree. Everything saved until
+ * ChunkMessenger::EndSubtree is called is in the chunks for this subtree.
+ * Objects saved in earlier chunks are not saved again, the new chunks
+ * just refer to them.
+ *
+ * @code
+ *	out.BeginSubtree(child->GetName());
+ *	child->Save(out);
+ *	out.EndSubtree();
+ * @endcode
+ *
+ * @return \b true if subtree was started, \b false if not writing
+ *
+ * @see ChunkMessenger::EndSubtree ChunkMessenger::LoadSubtree
+ */
+bool ChunkMessenger::BeginSubtree(const TCHAR* name)
+{
+	if (!(m_OpenMode & OPEN_WRITE) || (name == NULL) || (*name == 0))
+		return false;
+	if (m_CurSubtree >= 0)
+		EndSubtree();
+	if (!FlushChunk())
+		return false;
+	if ((m_NumSubtrees & 63) == 0)				// grow subtree directory
+	{
+		Subtree* subtrees = (Subtree*) realloc(m_Subtrees, (m_NumSubtrees + 64) * sizeof(Subtree));
+		if (subtrees == NULL)
+			VX_ERROR(("ChunkMessenger::BeginSubtree ERROR out of memory\n"), false);
+		m_Subtrees = subtrees;
+	}
+	Subtree& s = m_Subtrees[m_NumSubtrees];
+	s.Name = Core::AtomTable::Intern(name);
+	s.First = m_NumChunks;
+	s.Count = 0;
+	m_CurSubtree = m_NumSubtrees++;
+	return true;
+}
+
+/*!
+ * @fn void ChunkMessenger::EndSubtree()
+ *
+ * Finishes the chunks for the current subtree.
+ * If nothing was saved for it, it is removed from the directory.
+ *
+ * @see ChunkMessenger::BeginSubtree
+ */
+void ChunkMessenger::EndSubtree()
+{
+	if (m_CurSubtree < 0)
+		return;
+	FlushChunk();
+	Subtree& s = m_Subtrees[m_CurSubtree];
+	s.Count = m_NumChunks - s.First;
+	if (s.Count <= 0)
+		--m_NumSubtrees;
+	m_CurSubtree = -1;
+}
+
+/*!
+ * @fn int32 ChunkMessenger::FindSubtree(const TCHAR* name) const
+ * @param name	name of subtree to find, case is ignored
+ *
+ * @return index of subtree in the directory, -1 if not found
+ */
+int32 ChunkMessenger::FindSubtree(const TCHAR* name) const
+{
+	Core::Atom atom = Core::AtomTable::Find(name);
+
+	if (atom == 0)
+		return -1;
+	for (int32 i = 0; i < m_NumSubtrees; ++i)
+		if (Core::AtomTable::Equal(m_Subtrees[i].Name, atom))
+			return i;
+	return -1;
+}
+
+const TCHAR* ChunkMessenger::GetSubtreeName(int32 i) const
+{
+	if ((i < 0) || (i >= m_NumSubtrees))
+		return NULL;
+	return Core::AtomTable::GetString(m_Subtrees[i].Name);
+}
+
+/*
+ * Objects are created in the chunk which was being written when they were
+ * attached. A new chunk is started here instead of in OutOp so the object
+ * is created in the chunk recorded for it.
+ */
+int ChunkMessenger::Attach(const SharedObj* obj, int flags)
+{
+	bool	writing = (m_OpenMode & OPEN_WRITE) && m_Chunks;
+	int		h;
+
+	if (writing && (m_BufSize >= ChunkSize))
+		FlushChunk();
+	h = FileMessenger::Attach(obj, flags);
+	if (!writing || (h <= 0))
+		return h;
+	if (h >= m_MaxHandle)
+	{
+		int32	newmax = (h < 1024) ? 1024 : (h * 2);
+		int32*	map = (int32*) realloc(m_HandleChunk, newmax * sizeof(int32));
+
+		if (map == NULL)
+			VX_ERROR(("ChunkMessenger::Attach ERROR out of memory\n"), h);
+		for (int32 i = m_MaxHandle; i < newmax; ++i)
+			map[i] = -1;
+		m_HandleChunk = map;
+		m_MaxHandle = newmax;
+	}
+	m_HandleChunk[h] = m_NumChunks;
+	return h;
+}
+
+/*
+ * Records a dependency on the chunk which created the object
+ * if it is an earlier chunk.
+ */
+Messenger& ChunkMessenger::OutObj(const SharedObj* obj)
+{
+	int32	handle = m_Objs->GetHandle(obj);
+
+	if ((handle > 0) && (handle < m_MaxHandle) && (m_OpenMode & OPEN_WRITE))
+	{
+		int32 c = m_HandleChunk[handle];
+
+		if ((c >= 0) && (c < m_NumChunks))
+			AddDep(c);
+	}
+	Output(&handle, 1);
+	return *this;
+}
+
+/*
+ * Starts a new chunk when the current one is full.
+ * Chunks always begin with an opcode. The create command for an
+ * object stays in the chunk ChunkMessenger::Attach recorded for it.
+ */
+Messenger& ChunkMessenger::OutOp(const VXOpcode& op)
+{
+	if ((m_OpenMode & OPEN_WRITE) && m_Chunks && (m_BufSize >= ChunkSize) &&
+		(op.Opcode != SharedObj::OBJ_Create))
+		FlushChunk();
+	return FileMessenger::OutOp(op);
+}
+
+bool ChunkMessenger::IsEmpty() const
+{
+	return m_ReadPos >= m_BufSize;
+}
+
+size_t ChunkMessenger::Read(char* buf, int n)
+{
+	int32 left = m_BufSize - m_ReadPos;
+
+	if (n > left)
+		n = left;
+	if (n <= 0)
+		return 0;
+	memcpy(buf, m_Buffer + m_ReadPos, n);
+	m_ReadPos += n;
+	return n;
+}
+
+/*
+ * Output is accumulated in the current chunk.
+ */
+size_t ChunkMessenger::Write(const char* buf, int n)
+{
+	if (!(m_OpenMode & OPEN_WRITE) || (m_Chunks == NULL))
+		return FileMessenger::Write(buf, n);
+	if (m_BufSize + n > m_BufMax)
+	{
+		int32	newmax = m_BufMax ? m_BufMax : ChunkSize;
+		char*	newbuf;
+
+		while (newmax < m_BufSize + n)
+			newmax *= 2;
+		newbuf = (char*) realloc(m_Buffer, newmax);
+		if (newbuf == NULL)
+			VX_ERROR(("ChunkMessenger::Write ERROR out of memory\n"), 0);
+		m_Buffer = newbuf;
+		m_BufMax = newmax;
+	}
+	memcpy(m_Buffer + m_BufSize, buf, n);
+	m_BufSize += n;
+	return n;
+}
+
+/*
+ * Compresses the chunk being written and starts a new one.
+ * Nothing is done if the current chunk is empty.
+ */
+bool ChunkMessenger::FlushChunk()
+{
+	int32	maxsize;
+	int32	n;
+
+	if (m_BufSize == 0)
+		return true;
+	maxsize = Core::Compressor::GetMaxSize(m_BufSize);
+	if (m_PackSize + maxsize > m_PackMax)
+	{
+		int32	newmax = (m_PackMax ? m_PackMax * 2 : ChunkSize) + maxsize;
+		char*	data = (char*) realloc(m_PackData, newmax);
+
+		if (data == NULL)
+			VX_ERROR(("ChunkMessenger::FlushChunk ERROR out of memory\n"), false);
+		m_PackData = data;
+		m_PackMax = newmax;
+	}
+	n = Core::Compressor::Compress(m_Buffer, m_BufSize, m_PackData + m_PackSize, maxsize);
+	if (n <= 0)
+		VX_ERROR(("ChunkMessenger::FlushChunk ERROR cannot compress chunk %d\n", m_NumChunks), false);
+	Chunk& c = m_Chunks[m_NumChunks];
+	c.Offset = m_PackSize;
+	c.PackSize = n;
+	c.RawSize = m_BufSize;
+	c.Subtree = m_CurSubtree;
+	m_PackSize += n;
+	m_BufSize = 0;
+	++m_NumChunks;
+	return AddChunk();
+}
+
+/*
+ * Makes room for the next chunk being written.
+ */
+bool ChunkMessenger::AddChunk()
+{
+	if (m_NumChunks >= m_MaxChunks)
+	{
+		int32	newmax = m_MaxChunks ? (m_MaxChunks * 2) : 64;
+		Chunk*	chunks = (Chunk*) realloc(m_Chunks, newmax * sizeof(Chunk));
+		int32*	marks;
+
+		if (chunks == NULL)
+			VX_ERROR(("ChunkMessenger::AddChunk ERROR out of memory\n"), false);
+		m_Chunks = chunks;
+		marks = (int32*) realloc(m_DepMark, newmax * sizeof(int32));
+		if (marks == NULL)
+			VX_ERROR(("ChunkMessenger::AddChunk ERROR out of memory\n"), false);
+		m_DepMark = marks;
+		for (int32 i = m_MaxChunks; i < newmax; ++i)
+			m_DepMark[i] = -1;
+		m_MaxChunks = newmax;
+	}
+	Chunk& c = m_Chunks[m_NumChunks];
+	memset(&c, 0, sizeof(Chunk));
+	c.FirstDep = m_NumDeps;
+	c.Subtree = -1;
+	return true;
+}
+
+/*
+ * Adds a dependency to the chunk being written or read.
+ */
+void ChunkMessenger::AddDep(int32 chunk)
+{
+	if (m_DepMark)
+	{
+		if (m_DepMark[chunk] == m_NumChunks)	// already depends on it?
+			return;
+		m_DepMark[chunk] = m_NumChunks;
+	}
+	if (m_NumDeps >= m_MaxDeps)
+	{
+		int32	newmax = m_MaxDeps ? (m_MaxDeps * 2) : 256;
+		int32*	deps = (int32*) realloc(m_Deps, newmax * sizeof(int32));
+
+		if (deps == NULL)
+			VX_ERROR_RETURN(("ChunkMessenger::AddDep ERROR out of memory\n"));
+		m_Deps = deps;
+		m_MaxDeps = newmax;
+	}
+	m_Deps[m_NumDeps++] = chunk;
+	if (m_DepMark)
+		++(m_Chunks[m_NumChunks].NumDeps);
+}
+
+/*
+ * Writes the header, directory and compressed chunks to the output stream.
+ */
+bool ChunkMessenger::WriteFile()
+{
+	int32	header[CHUNK_HeaderWords] = { CHUNK_Magic, CHUNK_Version, m_NumChunks, m_NumSubtrees, 0, 0 };
+	int32	dirsize = 0;
+	int32*	dir;
+	int32*	op;
+
+	for (int32 i = 0; i < m_NumChunks; ++i)
+		dirsize += 4 + m_Chunks[i].NumDeps;
+	for (int32 i = 0; i < m_NumSubtrees; ++i)
+		dirsize += 3 + ((int32) (STRLEN(GetSubtreeName(i)) * sizeof(TCHAR)) + 4) / 4;
+	dir = (int32*) calloc(dirsize, sizeof(int32));
+	if (dir == NULL)
+		VX_ERROR(("ChunkMessenger::Close ERROR out of memory\n"), false);
+	op = dir;
+	for (int32 i = 0; i < m_NumChunks; ++i)
+	{
+		Chunk& c = m_Chunks[i];
+
+		*op++ = c.Offset;
+		*op++ = c.PackSize;
+		*op++ = c.RawSize;
+		*op++ = c.NumDeps;
+		memcpy(op, m_Deps + c.FirstDep, c.NumDeps * sizeof(int32));
+		op += c.NumDeps;
+	}
+	for (int32 i = 0; i < m_NumSubtrees; ++i)
+	{
+		const TCHAR*	name = GetSubtreeName(i);
+		int32			n = (int32) (STRLEN(name) * sizeof(TCHAR));
+		int32			len = (n + 4) & ~3;		// include terminator
+
+		*op++ = m_Subtrees[i].First;
+		*op++ = m_Subtrees[i].Count;
+		*op++ = len;
+		memcpy(op, name, n);
+		op += len / 4;
+	}
+	header[4] = dirsize * sizeof(int32);
+	bool rc = (m_OutStream->Write((const char*) header, sizeof(header)) == sizeof(header)) &&
+			  (m_OutStream->Write((const char*) dir, header[4]) == size_t(header[4])) &&
+			  (m_OutStream->Write(m_PackData, m_PackSize) == size_t(m_PackSize));
+	free(dir);
+	if (!rc)
+		VX_ERROR(("ChunkMessenger::Close ERROR cannot write file\n"), false);
+	return true;
+}
+
+/*
+ * Frees the chunk directory and chunk data.
+ */
+void ChunkMessenger::FreeChunks()
+{
+	if (m_Chunks)
+	{
+		for (int32 i = 0; i < m_NumChunks; ++i)
+		{
+			if (m_Chunks[i].Packed)
+				free(m_Chunks[i].Packed);
+			if (m_Chunks[i].Data)
+				free(m_Chunks[i].Data);
+		}
+		free(m_Chunks);
+	}
+	if (m_Subtrees)
+		free(m_Subtrees);
+	if (m_Deps)
+		free(m_Deps);
+	if (m_BufMax && m_Buffer)
+		free(m_Buffer);
+	if (m_PackData)
+		free(m_PackData);
+	if (m_HandleChunk)
+		free(m_HandleChunk);
+	if (m_DepMark)
+		free(m_DepMark);
+	m_Chunks = NULL;
+	m_NumChunks = m_MaxChunks = 0;
+	m_Subtrees = NULL;
+	m_NumSubtrees = 0;
+	m_NumLoaded = 0;
+	m_Deps = NULL;
+	m_NumDeps = m_MaxDeps = 0;
+	m_CurSubtree = -1;
+	m_Buffer = NULL;
+	m_BufSize = m_BufMax = m_ReadPos = 0;
+	m_PackData = NULL;
+	m_PackSize = m_PackMax = 0;
+	m_HandleChunk = NULL;
+	m_DepMark = NULL;
+	m_MaxHandle = 0;
+}
+
+}	// end Vixen
@@ -0,0 +1,665 @@
+#include "vixen.h"
+#ifndef _WIN32
+#include <sched.h>
+#endif
+
+namespace Vixen {
+
+VX_IMPLEMENT_CLASS(EventBus, SharedObj);
+VX_IMPLEMENT_CLASS(EventBus::Mailbox, SharedObj);
+
+static void LockBus(vint32* lock)
+{
+	while (!Core::InterlockTestSet(lock, 1, 0))
+#ifdef _WIN32
+		::Sleep(0);
+#else
+		sched_yield();
+#endif
+}
+
+static void UnlockBus(vint32* lock)
+{
+	Core::InterlockSet(lock, 0);
+}
+
+EventBus::EventBus() : SharedObj()
+{
+	for (int i = 0; i < Event::MAX_CODE; ++i)
+	{
+		m_Tables[i] = NULL;
+		m_Free[i] = NULL;
+		m_Blank[i] = NULL;
+	}
+	m_Retired = NULL;
+	m_TableLock = 0;
+	m_PoolLock = 0;
+	m_Dispatching = 0;
+	m_Posted = new Mailbox(this);
+}
+
+EventBus::~EventBus()
+{
+	Event*	ev = m_Posted->TakeAll();
+	Event*	next;
+
+	while (ev)
+	{
+		next = (Event*) ev->Next;
+		ev->Next = NULL;
+		delete ev;
+		ev = next;
+	}
+	m_Posted = (Mailbox*) NULL;
+	VX_ASSERT(m_Dispatching == 0);
+	Collect();
+	for (int i = 0; i < Event::MAX_CODE; ++i)
+	{
+		FreeTable(m_Tables[i]);
+		while (ev = m_Free[i])
+		{
+			m_Free[i] = (Event*) ev->Next;
+			ev->Next = NULL;
+			delete ev;
+		}
+		if (m_Blank[i])
+			delete m_Blank[i];
+	}
+}
+
+/*
+ * Allocate a table for n observers. The entries are filled in by the caller.
+ */
+EventBus::Table* EventBus::MakeTable(int32 n)
+{
+	Table*	table;
+
+	if (n <= 0)
+		return NULL;
+	table = (Table*) malloc(sizeof(Table) + (n - 1) * sizeof(Entry));
+	if (table == NULL)
+		return NULL;
+	table->NextRetired = NULL;
+	table->NumAny = 0;
+	table->NumEntries = n;
+	return table;
+}
+
+/*
+ * Each table holds its own references to the targets, senders and mailboxes
+ * so the entries stay valid as long as a dispatcher can see the table.
+ */
+void EventBus::FreeTable(Table* table)
+{
+	if (table == NULL)
+		return;
+	for (int32 i = 0; i < table->NumEntries; ++i)
+	{
+		Entry&	e = table->Entries[i];
+
+		e.Target->Delete();
+		if (e.Sender)
+			((SharedObj*) e.Sender)->Delete();
+		if (e.Box)
+			e.Box->Delete();
+	}
+	free(table);
+}
+
+int EventBus::CompareEntries(const void* p1, const void* p2)
+{
+	intptr	s1 = (intptr) ((const Entry*) p1)->Sender;
+	intptr	s2 = (intptr) ((const Entry*) p2)->Sender;
+
+	return (s1 < s2) ? -1 : ((s1 > s2) ? 1 : 0);
+}
+
+/*
+ * Sort the entries of a new table, reference their objects and make it
+ * the table for the event code. The old table is retired until no thread
+ * is dispatching. Called with the table lock held.
+ */
+bool EventBus::Replace(int code, Table* table)
+{
+	Table*	old = m_Tables[code];
+
+	if (table)
+	{
+		qsort(table->Entries, table->NumEntries, sizeof(Entry), &CompareEntries);
+		table->NumAny = 0;
+		for (int32 i = 0; i < table->NumEntries; ++i)
+		{
+			Entry&	e = table->Entries[i];
+
+			if (e.Sender == NULL)
+				++(table->NumAny);
+			else
+				((SharedObj*) e.Sender)->IncUse();
+			e.Target->IncUse();
+			if (e.Box)
+				e.Box->IncUse();
+		}
+	}
+	Core::InterlockExch((voidptr*) &m_Tables[code], table);
+	if (old)
+	{
+		old->NextRetired = m_Retired;
+		m_Retired = old;
+	}
+	return true;
+}
+
+/*
+ * Free the retired tables if no thread is dispatching.
+ * A dispatcher counts itself before it looks at a table
+ * so it can only see the current ones. Called without the
+ * table lock after the tables change and after each dispatch.
+ */
+void EventBus::Collect()
+{
+	Table*	table;
+	Table*	next;
+
+	if (m_Retired == NULL)
+		return;
+	LockBus(&m_TableLock);
+	if (m_Dispatching > 0)
+	{
+		UnlockBus(&m_TableLock);
+		return;
+	}
+	table = m_Retired;
+	m_Retired = NULL;
+	UnlockBus(&m_TableLock);
+	while (table)
+	{
+		next = table->NextRetired;
+		FreeTable(table);
+		table = next;
+	}
+}
+
+/*!
+ * @fn bool EventBus::Observe(const SharedObj* target, int code, const SharedObj* sender, Mailbox* box)
+ * @param target	Observer object, target for events (cannot be NULL).
+ * @param code		Event code to observe, if 0 all events for the sender are observed.
+ * @param sender	Object sending event, NULL observes all objects generating the event.
+ * @param box		Mailbox to deliver events to, NULL to dispatch them without one.
+ *
+ * Adds an observer to the table for the event code. If the target already
+ * observes the code for this sender, or for all senders, nothing is added.
+ * The table keeps a reference to the target, the sender and the mailbox.
+ * The old table is freed as soon as no thread is dispatching from it.
+ *
+ * @return \b true if an observation was attached, else \b false
+ *
+ * @see EventBus::Ignore Messenger::Observe
+ */
+bool EventBus::Observe(const SharedObj* target, int code, const SharedObj* sender, Mailbox* box)
+{
+	Table*	old;
+	Table*	table;
+	int32	n = 0;
+
+	if ((target == NULL) || (code < 0) || (code >= Event::MAX_CODE))
+		return false;
+	LockBus(&m_TableLock);
+	if (old = m_Tables[code])
+	{
+		for (int32 i = 0; i < old->NumEntries; ++i)
+		{
+			const Entry& e = old->Entries[i];
+
+			if ((e.Target == target) &&
+				((e.Sender == NULL) || (e.Sender == sender)))
+			{
+				UnlockBus(&m_TableLock);
+				return false;
+			}
+		}
+		n = old->NumEntries;
+	}
+	if ((table = MakeTable(n + 1)) == NULL)
+	{
+		UnlockBus(&m_TableLock);
+		VX_ERROR(("EventBus::Observe out of memory\n"), false);
+	}
+	if (n > 0)
+		memcpy(table->Entries, old->Entries, n * sizeof(Entry));
+	table->Entries[n].Target = (SharedObj*) target;
+	table->Entries[n].Sender = sender;
+	table->Entries[n].Box = box;
+	Replace(code, table);
+	UnlockBus(&m_TableLock);
+	Collect();
+	return true;
+}
+
+/*!
+ * @fn bool EventBus::Ignore(const SharedObj* target, int code, const SharedObj* sender)
+ * @param target	Observer object to remove, NULL removes all observers.
+ * @param code		Event code to ignore, if 0 the event is ignored for all codes.
+ * @param sender	Object sending event, NULL ignores all objects generating the event.
+ *
+ * Removes the observers which match all of the non-NULL arguments.
+ * If all input arguments are NULL, all observations are removed.
+ *
+ * @return \b true if an observation was removed, else \b false
+ *
+ * @see EventBus::Observe Messenger::Ignore
+ */
+bool EventBus::Ignore(const SharedObj* target, int code, const SharedObj* sender)
+{
+	int		first = code;
+	int		last = code;
+	bool	found = false;
+
+	if ((code < 0) || (code >= Event::MAX_CODE))
+		return false;
+	if (code == 0)
+	{
+		first = 0;
+		last = Event::MAX_CODE - 1;
+	}
+	LockBus(&m_TableLock);
+	for (int c = first; c <= last; ++c)
+	{
+		Table*	old = m_Tables[c];
+		Table*	table;
+		int32	n = 0;
+
+		if (old == NULL)
+			continue;
+		for (int32 i = 0; i < old->NumEntries; ++i)
+		{
+			const Entry& e = old->Entries[i];
+
+			if ((target && (e.Target != target)) ||
+				(sender && (e.Sender != sender)))
+				++n;
+		}
+		if (n == old->NumEntries)
+			continue;
+		found = true;
+		table = MakeTable(n);
+		if (table)
+		{
+			n = 0;
+			for (int32 i = 0; i < old->NumEntries; ++i)
+			{
+				const Entry& e = old->Entries[i];
+
+				if ((target && (e.Target != target)) ||
+					(sender && (e.Sender != sender)))
+					table->Entries[n++] = e;
+			}
+		}
+		Replace(c, table);
+		VX_TRACE(Messenger::Debug, ("EventBus::Ignore %s %d\n", Event::GetName(c), c));
+	}
+	UnlockBus(&m_TableLock);
+	if (found)
+		Collect();
+	return found;
+}
+
+/*!
+ * @fn bool EventBus::IsObserved(int code, const SharedObj* sender) const
+ * @param code		event code to check
+ * @param sender	object which would send the event, NULL for any sender
+ *
+ * Producers of frequent events can check this before making an event
+ * which nobody would get. The answer may change as soon as it is returned
+ * if another thread observes or ignores the event.
+ *
+ * @see EventBus::Observe
+ */
+bool EventBus::IsObserved(int code, const SharedObj* sender) const
+{
+	const Table*	table;
+
+	if ((code <= 0) || (code >= Event::MAX_CODE))
+		return false;
+	if (m_Tables[0])
+		return true;
+	if ((table = m_Tables[code]) == NULL)
+		return false;
+	if ((table->NumAny > 0) || (sender == NULL))
+		return true;
+	for (int32 i = table->NumAny; i < table->NumEntries; ++i)
+		if (table->Entries[i].Sender == sender)
+			return true;
+	return false;
+}
+
+/*
+ * Call the observers in a table which use the given mailbox and
+ * accumulate the other mailboxes the event must be forwarded to.
+ * Observers of any sender are all visited, observers of the sender
+ * of the event are found by binary search.
+ */
+int EventBus::Visit(const Table* table, const Event& ev, Mailbox* box, Mailbox** boxes, int& nboxes)
+{
+	const SharedObj*	sender = ev.Sender;
+	int32				first = table->NumEntries;
+	int32				last = table->NumEntries;
+	int32				n = 0;
+
+	if (sender)
+	{
+		int32	lo = table->NumAny;
+		int32	hi = table->NumEntries;
+
+		while (lo < hi)						// find first entry for sender
+		{
+			int32	mid = (lo + hi) / 2;
+
+			if ((intptr) table->Entries[mid].Sender < (intptr) sender)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		first = last = lo;
+		while ((last < table->NumEntries) && (table->Entries[last].Sender == sender))
+			++last;
+	}
+	for (int32 i = 0; i < last; ++i)
+	{
+		int		j;
+
+		if (i == table->NumAny)				// skip to entries for sender
+		{
+			i = first;
+			if (i >= last)
+				break;
+		}
+		if (table->Entries[i].Box == box)	// call observers for this mailbox
+		{
+			table->Entries[i].Target->OnEvent((Event*) &ev);
+			++n;
+			continue;
+		}
+		if (box != NULL)
+			continue;
+		for (j = 0; j < nboxes; ++j)		// forward to other mailboxes once
+			if (boxes[j] == table->Entries[i].Box)
+				break;
+		if ((j == nboxes) && (nboxes < EVBUS_MaxMailboxes))
+			boxes[nboxes++] = table->Entries[i].Box;
+	}
+	return n;
+}
+
+/*!
+ * @fn int EventBus::Dispatch(const Event& ev, Mailbox* box)
+ * @param ev	event to dispatch
+ * @param box	mailbox whose observers should get the event, NULL for observers without a mailbox
+ *
+ * Calls SharedObj::OnEvent for the observers of the event which use the mailbox,
+ * in the calling thread. If the mailbox is NULL, a copy of the event is also put into
+ * each mailbox other observers use, up to EVBUS_MaxMailboxes of them.
+ * The event is not copied for the observers called directly.
+ *
+ * @return number of observers called
+ *
+ * @see EventBus::Post EventBus::Mailbox::Deliver
+ */
+int EventBus::Dispatch(const Event& ev, Mailbox* box)
+{
+	Mailbox*	boxes[EVBUS_MaxMailboxes];
+	int			nboxes = 0;
+	int			n = 0;
+	int32		code = ev.Code;
+	const Table* table;
+
+	if ((code <= 0) || (code >= Event::MAX_CODE))
+		return 0;
+	Core::InterlockInc(&m_Dispatching);
+	if (table = m_Tables[code])
+		n += Visit(table, ev, box, boxes, nboxes);
+	if (table = m_Tables[0])
+		n += Visit(table, ev, box, boxes, nboxes);
+	for (int i = 0; i < nboxes; ++i)
+	{
+		Event*	copy = CopyEvent(ev);
+
+		if (copy)
+			boxes[i]->Put(copy);
+	}
+	Core::InterlockDec(&m_Dispatching);
+	if (m_Retired)						// observers changed while dispatching?
+		Collect();
+	return n;
+}
+
+/*!
+ * @fn bool EventBus::Post(const Event& ev)
+ * @param ev	event to post
+ *
+ * Copies the event into a pooled event and puts it into the bus's own
+ * mailbox. Any thread may post events. They are dispatched in the order
+ * they were posted when EventBus::Deliver is called.
+ *
+ * @return \b true if the event was posted, \b false if it could not be copied
+ *
+ * @see EventBus::Deliver EventBus::Dispatch
+ */
+bool EventBus::Post(const Event& ev)
+{
+	Event*	copy = CopyEvent(ev);
+
+	if (copy == NULL)
+		return false;
+	m_Posted->Put(copy);
+	return true;
+}
+
+/*!
+ * @fn int EventBus::Deliver()
+ *
+ * Dispatches all the events posted so far in the calling thread and
+ * returns them to the pool. Observers may post more events while
+ * they are delivered, these are delivered by the next call.
+ *
+ * @return number of events delivered
+ *
+ * @see EventBus::Post Messenger::Load
+ */
+int EventBus::Deliver()
+{
+	Event*	ev = m_Posted->TakeAll();
+	Event*	next;
+	int		n = 0;
+
+	while (ev)
+	{
+		next = (Event*) ev->Next;
+		ev->Next = NULL;
+		Dispatch(*ev);
+		FreeEvent(ev);
+		ev = next;
+		++n;
+	}
+	Collect();
+	return n;
+}
+
+/*!
+ * @fn Event* EventBus::NewEvent(int code)
+ * @param code	event code
+ *
+ * Returns an event of the class World::MakeEvent makes for the code,
+ * reusing one returned by EventBus::FreeEvent if possible.
+ *
+ * @return empty event or NULL on error
+ *
+ * @see EventBus::FreeEvent World::MakeEvent
+ */
+Event* EventBus::NewEvent(int code)
+{
+	Event*	ev;
+
+	if ((code <= 0) || (code >= Event::MAX_CODE))
+		VX_ERROR(("EventBus::NewEvent(%d) bad event code\n", code), NULL);
+	LockBus(&m_PoolLock);
+	if (ev = m_Free[code])
+	{
+		m_Free[code] = (Event*) ev->Next;
+		ev->Next = NULL;
+	}
+	UnlockBus(&m_PoolLock);
+	if (ev)
+		return ev;
+	if (m_Blank[code] == NULL)
+	{
+		Event*	blank = World::Get()->MakeEvent(code);
+
+		if (blank == NULL)
+			return NULL;
+		if (!Core::InterlockTestSet((voidptr*) &m_Blank[code], blank, NULL))
+			delete blank;
+	}
+	return World::Get()->MakeEvent(code);
+}
+
+/*!
+ * @fn void EventBus::FreeEvent(Event* ev)
+ * @param ev	event from EventBus::NewEvent
+ *
+ * Resets the event to empty, releasing the objects it references,
+ * and keeps it for the next event with the same code.
+ *
+ * @see EventBus::NewEvent
+ */
+void EventBus::FreeEvent(Event* ev)
+{
+	int32	code;
+	Event*	blank;
+
+	if (ev == NULL)
+		return;
+	code = ev->Code;
+	VX_ASSERT((code > 0) && (code < Event::MAX_CODE));
+	blank = m_Blank[code];
+	if ((blank == NULL) || (blank->GetClass() != ev->GetClass()))
+	{
+		delete ev;
+		return;
+	}
+	*ev = *blank;
+	ev->Time = blank->Time;
+	ev->Sender = (SharedObj*) NULL;
+	LockBus(&m_PoolLock);
+	ev->Next = m_Free[code];
+	m_Free[code] = ev;
+	UnlockBus(&m_PoolLock);
+}
+
+/*
+ * Copy an event into a pooled event. Only events of the class the pool
+ * has for their code can be copied, otherwise some of the event would be lost.
+ */
+Event* EventBus::CopyEvent(const Event& src)
+{
+	Event*	ev = NewEvent(src.Code);
+
+	if (ev == NULL)
+		return NULL;
+	if (ev->GetClass() != src.GetClass())
+	{
+		FreeEvent(ev);
+		return NULL;
+	}
+	*ev = src;
+	ev->Time = src.Time;
+	return ev;
+}
+
+EventBus::Mailbox::Mailbox(EventBus* bus) : SharedObj()
+{
+	m_Bus = bus;
+	m_Head = NULL;
+}
+
+EventBus::Mailbox::~Mailbox()
+{
+	Event*	ev = TakeAll();
+	Event*	next;
+
+	while (ev)
+	{
+		next = (Event*) ev->Next;
+		ev->Next = NULL;
+		if (m_Bus)
+			m_Bus->FreeEvent(ev);
+		else
+			delete ev;
+		ev = next;
+	}
+}
+
+/*!
+ * @fn void EventBus::Mailbox::Put(Event* ev)
+ * @param ev	event from EventBus::NewEvent, the mailbox takes ownership
+ *
+ * Adds the event to the mailbox without taking a lock.
+ * Any thread may put events into a mailbox.
+ *
+ * @see EventBus::Mailbox::Deliver
+ */
+void EventBus::Mailbox::Put(Event* ev)
+{
+	do ev->Next = m_Head;
+	while (!Core::InterlockTestSet((voidptr*) &m_Head, ev, ev->Next));
+}
+
+/*
+ * Take all the events out of the mailbox, oldest first.
+ */
+Event* EventBus::Mailbox::TakeAll()
+{
+	Event*	ev = (Event*) Core::InterlockExch((voidptr*) &m_Head, NULL);
+	Event*	prev = NULL;
+	Event*	next;
+
+	while (ev)
+	{
+		next = (Event*) ev->Next;
+		ev->Next = prev;
+		prev = ev;
+		ev = next;
+	}
+	return prev;
+}
+
+/*!
+ * @fn int EventBus::Mailbox::Deliver()
+ *
+ * Dispatches the events in the mailbox to the observers which use it,
+ * in the calling thread, and returns them to the pool of the bus.
+ * Only the thread which owns the mailbox should call this.
+ *
+ * @return number of events delivered
+ *
+ * @see EventBus::Observe EventBus::Dispatch
+ */
+int EventBus::Mailbox::Deliver()
+{
+	Event*	ev = TakeAll();
+	Event*	next;
+	int		n = 0;
+
+	VX_ASSERT(m_Bus);
+	while (ev)
+	{
+		next = (Event*) ev->Next;
+		ev->Next = NULL;
+		m_Bus->Dispatch(*ev, this);
+		m_Bus->FreeEvent(ev);
+		ev = next;
+		++n;
+	}
+	return n;
+}
+
+}	// end Vixen
@@ -272,7 +272,6 @@ bool FileLoader::ReadFile(const TCHAR* fname, SharedObj* loader)
  */
 Core::Stream* FileLoader::OpenStream(const TCHAR* name, int opts)
 {
-	NameProp		fname(name);
 	TCHAR			pathbuf[VX_MaxPath];
 	Core::Stream*	instream = (Core::Stream*) StreamClass->CreateObject();
 
@@ -531,8 +530,11 @@ bool FileLoader::ReadBinary(const TCHAR* filename, Core::Stream* stream, LoadEve
  */
 void FileLoader::Unload(const TCHAR* filename)
 {
-	ObjLock lock(this);
-	m_FileDict.Remove(NameProp(filename));
+	ObjLock		lock(this);
+	NameProp	np;
+
+	np.Find(filename);				// look up without interning
+	m_FileDict.Remove(np);
 }
 
 #ifdef VX_NOTHREAD
@@ -702,6 +704,7 @@ void LoadThread::ThreadFunc( void *arg )
 			if (lq->LoadThreads.DoExit)
 				break;
 			VX_TRACE2(FileLoader::Debug, ("Loader::Load processing %s on %d\n", (const TCHAR*) req->FileName, thread->QueueID));
+			VX_PROFILE_ZONE(TEXT("FileLoader::Load"));
 			if (req->LoadFunc == NULL)
 				lq->ReadFile(req->FileName, req->Requestor);
 			else
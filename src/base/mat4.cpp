@@ -0,0 +1,431 @@
+/****
+ *
+ * Mat4: 4x4 matrix value type and SIMD kernels
+ *
+ ****/
+#include "vixen.h"
+#ifdef VX_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace Vixen
+{
+
+#ifdef VX_SSE
+/*
+ * Matrices are loaded without assuming alignment because the ones
+ * inside Matrix objects come from allocators which only align to 8 bytes.
+ */
+#define	MAT4_Shuffle(a, b, x, y, z, w)	_mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define	MAT4_Swizzle(v, x, y, z, w)		_mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+#define	MAT4_Splat(v, i)				_mm_shuffle_ps(v, v, _MM_SHUFFLE(i, i, i, i))
+
+/*
+ * Multiply a row vector by the rows of a matrix in registers.
+ */
+static inline __m128 MulRow(__m128 row, __m128 b0, __m128 b1, __m128 b2, __m128 b3)
+{
+	__m128	r = _mm_mul_ps(MAT4_Splat(row, 0), b0);
+
+	r = _mm_add_ps(r, _mm_mul_ps(MAT4_Splat(row, 1), b1));
+	r = _mm_add_ps(r, _mm_mul_ps(MAT4_Splat(row, 2), b2));
+	return _mm_add_ps(r, _mm_mul_ps(MAT4_Splat(row, 3), b3));
+}
+
+/*
+ * 2x2 matrices stored as (m00 m01 m10 m11) in one register.
+ * Mat2Mul computes a * b, Mat2AdjMul adj(a) * b and Mat2MulAdj a * adj(b).
+ */
+static inline __m128 Mat2Mul(__m128 a, __m128 b)
+{
+	return _mm_add_ps(_mm_mul_ps(a, MAT4_Swizzle(b, 0, 3, 0, 3)),
+					  _mm_mul_ps(MAT4_Swizzle(a, 1, 0, 3, 2), MAT4_Swizzle(b, 2, 1, 2, 1)));
+}
+
+static inline __m128 Mat2AdjMul(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(MAT4_Swizzle(a, 3, 3, 0, 0), b),
+					  _mm_mul_ps(MAT4_Swizzle(a, 1, 1, 2, 2), MAT4_Swizzle(b, 2, 3, 0, 1)));
+}
+
+static inline __m128 Mat2MulAdj(__m128 a, __m128 b)
+{
+	return _mm_sub_ps(_mm_mul_ps(a, MAT4_Swizzle(b, 3, 0, 3, 0)),
+					  _mm_mul_ps(MAT4_Swizzle(a, 1, 0, 3, 2), MAT4_Swizzle(b, 2, 1, 2, 1)));
+}
+#endif
+
+/*!
+ * @fn void Mat4::Identity()
+ *
+ * Replaces this matrix with the identity matrix.
+ *
+ * @see Mat4::IsIdentity Matrix::Identity
+ */
+void Mat4::Identity()
+{
+	memset(data, 0, sizeof(data));
+	data[0][0] = data[1][1] = data[2][2] = data[3][3] = 1.0f;
+}
+
+bool Mat4::IsIdentity() const
+{
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			if (data[i][j] != ((i == j) ? 1.0f : 0.0f))
+				return false;
+	return true;
+}
+
+/*!
+ * @fn void Mat4::Set(const Quat& q)
+ * @param q	quaternion, need not be unit length
+ *
+ * Replaces this matrix with the rotation matrix for the quaternion.
+ * Works for right-handed coordinate systems and right-handed rotations.
+ *
+ * @see Matrix::Set Quat::Set
+ */
+void Mat4::Set(const Quat& q)
+{
+	float	s = 2.0f / q.LengthSquared();
+	float	xx = q.x * q.x;
+	float	xy = q.x * q.y;
+	float	xz = q.x * q.z;
+	float	xw = q.x * q.w;
+	float	yy = q.y * q.y;
+	float	yz = q.y * q.z;
+	float	yw = q.y * q.w;
+	float	zz = q.z * q.z;
+	float	wz = q.z * q.w;
+
+	data[0][0] = 1.0f - s * (yy + zz);
+	data[1][0] = s * (xy + wz);
+	data[2][0] = s * (xz - yw);
+	data[0][1] = s * (xy - wz);
+	data[1][1] = 1.0f - s * (xx + zz);
+	data[2][1] = s * (yz + xw);
+	data[0][2] = s * (xz + yw);
+	data[1][2] = s * (yz - xw);
+	data[2][2] = 1.0f - s * (xx + yy);
+	data[0][3] = data[1][3] = data[2][3] = 0.0f;
+	data[3][0] = data[3][1] = data[3][2] = 0.0f;
+	data[3][3] = 1.0f;
+}
+
+void Mat4::TranslationMatrix(const Vec3& v)
+{
+	Identity();
+	data[0][3] = v.x;
+	data[1][3] = v.y;
+	data[2][3] = v.z;
+}
+
+void Mat4::ScaleMatrix(const Vec3& s)
+{
+	Identity();
+	data[0][0] = s.x;
+	data[1][1] = s.y;
+	data[2][2] = s.z;
+}
+
+/*!
+ * @fn void Mat4::PreTranslate(const Vec3& v)
+ * @param v	translation
+ *
+ * Premultiplies this matrix by a translation matrix without making one.
+ * Translating the result adds a multiple of the last row to each of the others.
+ * <B>this = T(v) * this</B>
+ *
+ * @see Matrix::Translate
+ */
+void Mat4::PreTranslate(const Vec3& v)
+{
+#ifdef VX_SSE
+	__m128	r3 = _mm_loadu_ps(data[3]);
+
+	_mm_storeu_ps(data[0], _mm_add_ps(_mm_loadu_ps(data[0]), _mm_mul_ps(_mm_set1_ps(v.x), r3)));
+	_mm_storeu_ps(data[1], _mm_add_ps(_mm_loadu_ps(data[1]), _mm_mul_ps(_mm_set1_ps(v.y), r3)));
+	_mm_storeu_ps(data[2], _mm_add_ps(_mm_loadu_ps(data[2]), _mm_mul_ps(_mm_set1_ps(v.z), r3)));
+#else
+	for (int j = 0; j < 4; ++j)
+	{
+		data[0][j] += v.x * data[3][j];
+		data[1][j] += v.y * data[3][j];
+		data[2][j] += v.z * data[3][j];
+	}
+#endif
+}
+
+/*!
+ * @fn void Mat4::PreScale(const Vec3& s)
+ * @param s	scale factors
+ *
+ * Premultiplies this matrix by a scaling matrix without making one.
+ * <B>this = S(s) * this</B>
+ *
+ * @see Matrix::Scale
+ */
+void Mat4::PreScale(const Vec3& s)
+{
+	for (int j = 0; j < 4; ++j)
+	{
+		data[0][j] *= s.x;
+		data[1][j] *= s.y;
+		data[2][j] *= s.z;
+	}
+}
+
+/*!
+ * @fn void Mat4::Multiply(const Mat4& a, const Mat4& b)
+ * @param a	first multiplicand
+ * @param b	second multiplicand
+ *
+ * Computes the full 4x4 product <B>this = a * b</B>.
+ * Either input may be this matrix.
+ *
+ * @see Matrix::Multiply
+ */
+void Mat4::Multiply(const Mat4& a, const Mat4& b)
+{
+#ifdef VX_SSE
+	__m128	b0 = _mm_loadu_ps(b.data[0]);
+	__m128	b1 = _mm_loadu_ps(b.data[1]);
+	__m128	b2 = _mm_loadu_ps(b.data[2]);
+	__m128	b3 = _mm_loadu_ps(b.data[3]);
+	__m128	r0 = MulRow(_mm_loadu_ps(a.data[0]), b0, b1, b2, b3);
+	__m128	r1 = MulRow(_mm_loadu_ps(a.data[1]), b0, b1, b2, b3);
+	__m128	r2 = MulRow(_mm_loadu_ps(a.data[2]), b0, b1, b2, b3);
+	__m128	r3 = MulRow(_mm_loadu_ps(a.data[3]), b0, b1, b2, b3);
+
+	_mm_storeu_ps(data[0], r0);
+	_mm_storeu_ps(data[1], r1);
+	_mm_storeu_ps(data[2], r2);
+	_mm_storeu_ps(data[3], r3);
+#else
+	float	tmp[4][4];
+
+	for (int i = 0; i < 4; ++i)
+		for (int j = 0; j < 4; ++j)
+			tmp[i][j] = a.data[i][0] * b.data[0][j] + a.data[i][1] * b.data[1][j] +
+						a.data[i][2] * b.data[2][j] + a.data[i][3] * b.data[3][j];
+	memcpy(data, tmp, sizeof(data));
+#endif
+}
+
+/*!
+ * @fn bool Mat4::Invert(const Mat4& src)
+ * @param src	matrix to invert, may be this matrix
+ *
+ * Replaces this matrix with the inverse of the source matrix.
+ * The matrix is divided into four 2x2 blocks and the inverse is
+ * computed from their adjugates and determinants, which maps well
+ * onto SIMD registers. Without SSE the cofactors are computed directly.
+ *
+ * @return \b true if inverted, \b false if the source is singular
+ *	in which case this matrix is not changed
+ *
+ * @see Matrix::Invert
+ */
+bool Mat4::Invert(const Mat4& src)
+{
+#ifdef VX_SSE
+	__m128	r0 = _mm_loadu_ps(src.data[0]);
+	__m128	r1 = _mm_loadu_ps(src.data[1]);
+	__m128	r2 = _mm_loadu_ps(src.data[2]);
+	__m128	r3 = _mm_loadu_ps(src.data[3]);
+	__m128	A = _mm_movelh_ps(r0, r1);				// 2x2 blocks
+	__m128	B = _mm_movehl_ps(r1, r0);
+	__m128	C = _mm_movelh_ps(r2, r3);
+	__m128	D = _mm_movehl_ps(r3, r2);
+	__m128	detsub = _mm_sub_ps(					// |A| |B| |C| |D|
+				_mm_mul_ps(MAT4_Shuffle(r0, r2, 0, 2, 0, 2), MAT4_Shuffle(r1, r3, 1, 3, 1, 3)),
+				_mm_mul_ps(MAT4_Shuffle(r0, r2, 1, 3, 1, 3), MAT4_Shuffle(r1, r3, 0, 2, 0, 2)));
+	__m128	detA = MAT4_Splat(detsub, 0);
+	__m128	detB = MAT4_Splat(detsub, 1);
+	__m128	detC = MAT4_Splat(detsub, 2);
+	__m128	detD = MAT4_Splat(detsub, 3);
+	__m128	DC = Mat2AdjMul(D, C);
+	__m128	AB = Mat2AdjMul(A, B);
+	__m128	X = _mm_sub_ps(_mm_mul_ps(detD, A), Mat2Mul(B, DC));
+	__m128	W = _mm_sub_ps(_mm_mul_ps(detA, D), Mat2Mul(C, AB));
+	__m128	Y = _mm_sub_ps(_mm_mul_ps(detB, C), Mat2MulAdj(D, AB));
+	__m128	Z = _mm_sub_ps(_mm_mul_ps(detC, B), Mat2MulAdj(A, DC));
+	__m128	det = _mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC));
+	__m128	tr = _mm_mul_ps(AB, MAT4_Swizzle(DC, 0, 2, 1, 3));
+	float	d;
+
+	tr = _mm_add_ps(tr, MAT4_Swizzle(tr, 1, 0, 3, 2));	// horizontal sum
+	tr = _mm_add_ps(tr, MAT4_Swizzle(tr, 2, 3, 0, 1));
+	det = _mm_sub_ps(det, tr);
+	_mm_store_ss(&d, det);
+	if (fabs(d) < VX_SMALL_NUMBER * VX_SMALL_NUMBER)
+		return false;
+	det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+	X = _mm_mul_ps(X, det);
+	Y = _mm_mul_ps(Y, det);
+	Z = _mm_mul_ps(Z, det);
+	W = _mm_mul_ps(W, det);
+	_mm_storeu_ps(data[0], MAT4_Shuffle(X, Y, 3, 1, 3, 1));
+	_mm_storeu_ps(data[1], MAT4_Shuffle(X, Y, 2, 0, 2, 0));
+	_mm_storeu_ps(data[2], MAT4_Shuffle(Z, W, 3, 1, 3, 1));
+	_mm_storeu_ps(data[3], MAT4_Shuffle(Z, W, 2, 0, 2, 0));
+	return true;
+#else
+	const float* m = src.GetData();
+	float	inv[16];
+	float	det;
+
+	inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] + m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+	inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] - m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+	inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] + m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+	inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] - m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+	inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] - m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+	inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] + m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+	inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] - m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+	inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] + m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+	inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] + m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+	inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] - m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+	inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] + m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+	inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] - m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+	inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] - m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+	inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] + m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+	inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] - m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+	inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] + m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+	det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+	if (fabs(det) < VX_SMALL_NUMBER * VX_SMALL_NUMBER)
+		return false;
+	det = 1.0f / det;
+	for (int i = 0; i < 16; ++i)
+		inv[i] *= det;
+	memcpy(data, inv, sizeof(data));
+	return true;
+#endif
+}
+
+void Mat4::Transpose()
+{
+#ifdef VX_SSE
+	__m128	r0 = _mm_loadu_ps(data[0]);
+	__m128	r1 = _mm_loadu_ps(data[1]);
+	__m128	r2 = _mm_loadu_ps(data[2]);
+	__m128	r3 = _mm_loadu_ps(data[3]);
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(data[0], r0);
+	_mm_storeu_ps(data[1], r1);
+	_mm_storeu_ps(data[2], r2);
+	_mm_storeu_ps(data[3], r3);
+#else
+	float	t;
+
+	for (int i = 0; i < 4; ++i)
+		for (int j = i + 1; j < 4; ++j)
+		{
+			t = data[i][j];
+			data[i][j] = data[j][i];
+			data[j][i] = t;
+		}
+#endif
+}
+
+void Mat4::Transform(const Vec4& src, Vec4& dst) const
+{
+	float x = src.x * data[0][0] + src.y * data[0][1] + src.z * data[0][2] + src.w * data[0][3];
+	float y = src.x * data[1][0] + src.y * data[1][1] + src.z * data[1][2] + src.w * data[1][3];
+	float z = src.x * data[2][0] + src.y * data[2][1] + src.z * data[2][2] + src.w * data[2][3];
+	float w = src.x * data[3][0] + src.y * data[3][1] + src.z * data[3][2] + src.w * data[3][3];
+
+	dst.Set(x, y, z, w);
+}
+
+/*!
+ * @fn void Mat4::TransformPoints(const float* src, float* dst, intptr n, int stride) const
+ * @param src		first source point
+ * @param dst		where to store the first result, may be the same as \b src
+ * @param n			number of points
+ * @param stride	number of floats from one point to the next (at least 3)
+ *
+ * Transforms an array of 3D points by this matrix, including translation.
+ * The points may be part of larger vertices, only the first three floats
+ * of each one are changed. With SSE the columns of the matrix stay
+ * in registers and each point takes three multiplies and adds.
+ *
+ * @see Mat4::TransformVectors VertexPool::operator*=
+ */
+void Mat4::TransformPoints(const float* src, float* dst, intptr n, int stride) const
+{
+	VX_ASSERT(stride >= 3);
+#ifdef VX_SSE
+	__m128	c0 = _mm_setr_ps(data[0][0], data[1][0], data[2][0], 0.0f);
+	__m128	c1 = _mm_setr_ps(data[0][1], data[1][1], data[2][1], 0.0f);
+	__m128	c2 = _mm_setr_ps(data[0][2], data[1][2], data[2][2], 0.0f);
+	__m128	c3 = _mm_setr_ps(data[0][3], data[1][3], data[2][3], 0.0f);
+
+	for (intptr i = 0; i < n; ++i, src += stride, dst += stride)
+	{
+		__m128	r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(src[0]), c0), c3);
+
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(src[1]), c1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(src[2]), c2));
+		_mm_storel_pi((__m64*) dst, r);				// only write x, y, z
+		_mm_store_ss(dst + 2, _mm_movehl_ps(r, r));
+	}
+#else
+	for (intptr i = 0; i < n; ++i, src += stride, dst += stride)
+		Transform(*((const Vec3*) src), *((Vec3*) dst));
+#endif
+}
+
+/*!
+ * @fn void Mat4::TransformVectors(const float* src, float* dst, intptr n, int stride, bool normalize) const
+ * @param src		first source vector
+ * @param dst		where to store the first result, may be the same as \b src
+ * @param n			number of vectors
+ * @param stride	number of floats from one vector to the next (at least 3)
+ * @param normalize	\b true to make the results unit length (for normals)
+ *
+ * Transforms an array of 3D vectors by the 3x3 part of this matrix,
+ * ignoring translation. Vectors which end up zero length are not normalized.
+ *
+ * @see Mat4::TransformPoints VertexPool::operator*=
+ */
+void Mat4::TransformVectors(const float* src, float* dst, intptr n, int stride, bool normalize) const
+{
+	VX_ASSERT(stride >= 3);
+#ifdef VX_SSE
+	__m128	c0 = _mm_setr_ps(data[0][0], data[1][0], data[2][0], 0.0f);
+	__m128	c1 = _mm_setr_ps(data[0][1], data[1][1], data[2][1], 0.0f);
+	__m128	c2 = _mm_setr_ps(data[0][2], data[1][2], data[2][2], 0.0f);
+
+	for (intptr i = 0; i < n; ++i, src += stride, dst += stride)
+	{
+		__m128	r = _mm_mul_ps(_mm_set1_ps(src[0]), c0);
+
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(src[1]), c1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(src[2]), c2));
+		if (normalize)
+		{
+			__m128	d = _mm_mul_ps(r, r);				// w is zero
+
+			d = _mm_add_ps(d, MAT4_Swizzle(d, 1, 0, 3, 2));
+			d = _mm_add_ps(d, MAT4_Swizzle(d, 2, 3, 0, 1));
+			if (_mm_cvtss_f32(d) > 0.0f)
+				r = _mm_div_ps(r, _mm_sqrt_ps(d));
+		}
+		_mm_storel_pi((__m64*) dst, r);
+		_mm_store_ss(dst + 2, _mm_movehl_ps(r, r));
+	}
+#else
+	for (intptr i = 0; i < n; ++i, src += stride, dst += stride)
+	{
+		Vec3*	v = (Vec3*) dst;
+
+		TransformVector(*((const Vec3*) src), *v);
+		if (normalize && (v->LengthSquared() > 0.0f))
+			v->Normalize();
+	}
+#endif
+}
+
+}	// end Vixen
@@ -45,7 +45,6 @@ const TCHAR** Matrix::DoNames = opnames;
 
 static void Up_triangle_Inverse_Xform(const float [4][4], float [4][4]);
 static void Down_triangle_Inverse_Xform(const float [4][4], float [4][4]);
-static void Full_Inverse_Xform3(const float [4][4], float [4][4]);
 
 Matrix::Matrix() : SharedObj()
 {
@@ -58,13 +57,13 @@ Matrix::Matrix(const float *foreign_data) : SharedObj()
 	assert( 0 != foreign_data );
 
 	identity = false;
-	memcpy(data, foreign_data, sizeof(data));
+	m_Mat.Set(foreign_data);
 	SetChanged(true);
 }
 
 Matrix::Matrix(const Matrix& rhs) : SharedObj(rhs)
 {
-	memcpy(data, rhs.data, sizeof(data));
+	m_Mat = rhs.m_Mat;
 	identity = rhs.identity;
 }
 
@@ -159,44 +158,7 @@ void Matrix::Identity()
 	else
 		identity = true;
 	SetChanged(true);
-#if 1
-	data[0][1] = 0.0f;
-	data[0][2] = 0.0f;
-	data[0][3] = 0.0f;    
-	data[3][3] = 1.0f;
-	data[1][0] = 0.0f;
-	data[1][2] = 0.0f;
-	data[1][3] = 0.0f;
-	data[3][3] = 1.0f;
-	data[2][0] = 0.0f;
-	data[2][1] = 0.0f;
-	data[2][2] = 1.0f;
-	data[3][3] = 1.0f;
-	data[2][3] = 0.0f;
-	data[1][1] = 1.0f;
-	data[3][0] = 0.0f;
-	data[3][1] = 0.0f;
-	data[3][2] = 0.0f;
-	data[0][0] = 1.0f;
-	data[3][3] = 1.0f;
-#else
-	data[0][0] = 1.0f;
-	data[0][1] = 0.0f;
-	data[0][2] = 0.0f;
-	data[0][3] = 0.0f;
-	data[1][0] = 0.0f;
-	data[1][1] = 1.0f;
-	data[1][2] = 0.0f;
-	data[1][3] = 0.0f;
-	data[2][0] = 0.0f;
-	data[2][1] = 0.0f;
-	data[2][2] = 1.0f;
-	data[2][3] = 0.0f;
-	data[3][0] = 0.0f;
-	data[3][1] = 0.0f;
-	data[3][2] = 0.0f;
-	data[3][3] = 1.0f;
-#endif
+	m_Mat.Identity();
 }
 
 /*!
@@ -210,7 +172,7 @@ void Matrix::Identity()
  */
 void Matrix::Zero()
 {
-	memset(data, 0, sizeof(data) );
+	memset(m_Mat.data, 0, sizeof(m_Mat.data));
 	identity = false;
 	SetChanged(true);
 }
@@ -238,7 +200,7 @@ void Matrix::SetMatrix(const float* src)
 
 	SetChanged(true);
 	identity = false;
-	memcpy(data, src, sizeof(data));
+	m_Mat.Set(src);
 }
 
 void Matrix::XAngleMatrix(float angle)
@@ -246,15 +208,15 @@ void Matrix::XAngleMatrix(float angle)
 	float	cost = cosf(angle);
 	float	sint = sinf(angle);
 
-	data[0][0] = 1.0f;
-	data[0][1] = 0.0f;
-	data[0][2] = 0.0f;
-	data[1][0] = 0.0f;
-	data[1][1] = cost;
-	data[1][2] = -sint;
-	data[2][0] = 0.0f;
-	data[2][1] = sint;
-	data[2][2] = cost;
+	m_Mat.data[0][0] = 1.0f;
+	m_Mat.data[0][1] = 0.0f;
+	m_Mat.data[0][2] = 0.0f;
+	m_Mat.data[1][0] = 0.0f;
+	m_Mat.data[1][1] = cost;
+	m_Mat.data[1][2] = -sint;
+	m_Mat.data[2][0] = 0.0f;
+	m_Mat.data[2][1] = sint;
+	m_Mat.data[2][2] = cost;
 	identity = false;
 	SetChanged(true);
 }
@@ -264,15 +226,15 @@ void Matrix::YAngleMatrix(float angle)
 	float	cost = cosf(angle);
 	float	sint = sinf(angle);
 
-	data[0][0] = cost;
-	data[0][1] = 0.0f;
-	data[0][2] = sint;
-	data[1][0] = 0.0f;
-	data[1][1] = 1.0f;
-	data[1][2] = 0.0f;
-	data[2][0] = -sint;
-	data[2][1] = 0.0f;
-	data[2][2] = cost;
+	m_Mat.data[0][0] = cost;
+	m_Mat.data[0][1] = 0.0f;
+	m_Mat.data[0][2] = sint;
+	m_Mat.data[1][0] = 0.0f;
+	m_Mat.data[1][1] = 1.0f;
+	m_Mat.data[1][2] = 0.0f;
+	m_Mat.data[2][0] = -sint;
+	m_Mat.data[2][1] = 0.0f;
+	m_Mat.data[2][2] = cost;
 	identity = false;
 	SetChanged(true);
 }
@@ -282,15 +244,15 @@ void Matrix::ZAngleMatrix(float angle)
 	float	cost = cosf(angle);
 	float	sint = sinf(angle);
 
-	data[0][0] = cost;
-	data[0][1] = -sint;
-	data[0][2] = 0.0f;
-	data[1][0] = sint;
-	data[1][1] = cost;
-	data[1][2] = 0.0f;
-	data[2][0] = 0.0f;
-	data[2][1] = 0.0f;
-	data[2][2] = 1.0f;
+	m_Mat.data[0][0] = cost;
+	m_Mat.data[0][1] = -sint;
+	m_Mat.data[0][2] = 0.0f;
+	m_Mat.data[1][0] = sint;
+	m_Mat.data[1][1] = cost;
+	m_Mat.data[1][2] = 0.0f;
+	m_Mat.data[2][0] = 0.0f;
+	m_Mat.data[2][1] = 0.0f;
+	m_Mat.data[2][2] = 1.0f;
 	identity = false;
 	SetChanged(true);
 }
@@ -312,13 +274,13 @@ void Matrix::RotationMatrix(const Vec3& rotaxis, float angle)
     float sint = sinf(angle);
 	identity = false;
 	SetChanged(true);
-    data[0][3] = 0.0f;
-    data[1][3] = 0.0f;
-    data[2][3] = 0.0f;
-    data[3][3] = 1.0f;
-    data[3][0] = 0.0f;
-    data[3][1] = 0.0f;
-    data[3][2] = 0.0f;
+    m_Mat.data[0][3] = 0.0f;
+    m_Mat.data[1][3] = 0.0f;
+    m_Mat.data[2][3] = 0.0f;
+    m_Mat.data[3][3] = 1.0f;
+    m_Mat.data[3][0] = 0.0f;
+    m_Mat.data[3][1] = 0.0f;
+    m_Mat.data[3][2] = 0.0f;
 	if (rotaxis == Vec3(1, 0, 0))
 		XAngleMatrix(angle);
     else if (rotaxis == Vec3(0, 1, 0))
@@ -340,15 +302,15 @@ void Matrix::RotationMatrix(const Vec3& rotaxis, float angle)
         float asin = axis.x * sint;
         float bsin = axis.y * sint;
         float csin = axis.z * sint;
-        data[0][0] = x2 * mcos + cost;
-        data[0][1] = xym - csin;
-        data[0][2] = xzm + bsin;
-        data[1][0] = xym + csin;
-        data[1][1] = y2 * mcos + cost;
-        data[1][2] = yzm - asin;
-        data[2][0] = xzm - bsin;
-        data[2][1] = yzm + asin;
-        data[2][2] = z2 * mcos + cost;
+        m_Mat.data[0][0] = x2 * mcos + cost;
+        m_Mat.data[0][1] = xym - csin;
+        m_Mat.data[0][2] = xzm + bsin;
+        m_Mat.data[1][0] = xym + csin;
+        m_Mat.data[1][1] = y2 * mcos + cost;
+        m_Mat.data[1][2] = yzm - asin;
+        m_Mat.data[2][0] = xzm - bsin;
+        m_Mat.data[2][1] = yzm + asin;
+        m_Mat.data[2][2] = z2 * mcos + cost;
     }
 }
 
@@ -404,7 +366,13 @@ void Matrix::Rotate(const Vec3& axis, float angle)
 		return;
 	Matrix tmp;
 	tmp.RotationMatrix(axis, angle);
-	PreMul(tmp);
+	if (identity)
+	{
+		Copy(tmp);
+		return;
+	}
+	m_Mat.Multiply(tmp.m_Mat, m_Mat);
+	SetChanged(true);
 }
 
 /*!
@@ -418,9 +386,11 @@ void Matrix::Rotate(const Vec3& axis, float angle)
  */
 void Matrix::Rotate(const Quat& q)
 {	
-	Matrix tmp;
-	tmp.RotationMatrix(q);
-	PreMul(tmp);
+	Mat4 tmp(q);
+
+	m_Mat.Multiply(tmp, m_Mat);
+	identity = false;
+	SetChanged(true);
 }
 
 /*!
@@ -443,28 +413,28 @@ void Matrix::TranslationMatrix(const Vec3 &v)
 		//jb - try to save some time
 	if (identity)
 	{
-		data[0][3] = v.x;
-		data[1][3] = v.y;
-		data[2][3] = v.z;
+		m_Mat.data[0][3] = v.x;
+		m_Mat.data[1][3] = v.y;
+		m_Mat.data[2][3] = v.z;
 	}
 	else
 	{
-		data[0][0] = 1.0f;
-		data[0][1] = 0.0f;
-		data[0][2] = 0.0f;
-		data[0][3] = v.x;
-		data[1][0] = 0.0f;
-		data[1][1] = 1.0f;
-		data[1][2] = 0.0f;
-		data[1][3] = v.y;
-		data[2][0] = 0.0f;
-		data[2][1] = 0.0f;
-		data[2][2] = 1.0f;
-		data[2][3] = v.z;
-		data[3][0] = 0.0f;
-		data[3][1] = 0.0f;
-		data[3][2] = 0.0f;
-		data[3][3] = 1.0f;
+		m_Mat.data[0][0] = 1.0f;
+		m_Mat.data[0][1] = 0.0f;
+		m_Mat.data[0][2] = 0.0f;
+		m_Mat.data[0][3] = v.x;
+		m_Mat.data[1][0] = 0.0f;
+		m_Mat.data[1][1] = 1.0f;
+		m_Mat.data[1][2] = 0.0f;
+		m_Mat.data[1][3] = v.y;
+		m_Mat.data[2][0] = 0.0f;
+		m_Mat.data[2][1] = 0.0f;
+		m_Mat.data[2][2] = 1.0f;
+		m_Mat.data[2][3] = v.z;
+		m_Mat.data[3][0] = 0.0f;
+		m_Mat.data[3][1] = 0.0f;
+		m_Mat.data[3][2] = 0.0f;
+		m_Mat.data[3][3] = 1.0f;
 	}
 	identity = false;
 	SetChanged(true);
@@ -488,10 +458,9 @@ void Matrix::TranslationMatrix(const Vec3 &v)
  */
 void Matrix::Translate(float x, float y, float z)
 {
-	//jb - took out one layer of function calls
-	Matrix tmp;
-	tmp.TranslationMatrix(Vec3(x, y, z));
-	PreMul(tmp);
+	m_Mat.PreTranslate(Vec3(x, y, z));
+	identity = false;
+	SetChanged(true);
 }
 
 /*!
@@ -510,9 +479,9 @@ void Matrix::Translate(float x, float y, float z)
  */
 void Matrix::Translate(const Vec3& p)
 {
-	Matrix tmp;
-	tmp.TranslationMatrix(p);
-	PreMul(tmp);
+	m_Mat.PreTranslate(p);
+	identity = false;
+	SetChanged(true);
 }
 
 /*!
@@ -533,28 +502,28 @@ void Matrix::ScaleMatrix(const Vec3 &s)
 {
 	if (identity)
 	{
-		data[0][0] = s.x;
-		data[1][1] = s.y;
-		data[2][2] = s.z;
+		m_Mat.data[0][0] = s.x;
+		m_Mat.data[1][1] = s.y;
+		m_Mat.data[2][2] = s.z;
 	}
 	else
 	{
-		data[0][0] = s.x;
-		data[0][1] = 0.0f;
-		data[0][2] = 0.0f;
-		data[0][3] = 0.0f;
-		data[1][0] = 0.0f;
-		data[1][1] = s.y;
-		data[1][2] = 0.0f;
-		data[1][3] = 0.0f;
-		data[2][0] = 0.0f;
-		data[2][1] = 0.0f;
-		data[2][2] = s.z;
-		data[2][3] = 0.0f;
-		data[3][0] = 0.0f;
-		data[3][1] = 0.0f;
-		data[3][2] = 0.0f;
-		data[3][3] = 1.0f;
+		m_Mat.data[0][0] = s.x;
+		m_Mat.data[0][1] = 0.0f;
+		m_Mat.data[0][2] = 0.0f;
+		m_Mat.data[0][3] = 0.0f;
+		m_Mat.data[1][0] = 0.0f;
+		m_Mat.data[1][1] = s.y;
+		m_Mat.data[1][2] = 0.0f;
+		m_Mat.data[1][3] = 0.0f;
+		m_Mat.data[2][0] = 0.0f;
+		m_Mat.data[2][1] = 0.0f;
+		m_Mat.data[2][2] = s.z;
+		m_Mat.data[2][3] = 0.0f;
+		m_Mat.data[3][0] = 0.0f;
+		m_Mat.data[3][1] = 0.0f;
+		m_Mat.data[3][2] = 0.0f;
+		m_Mat.data[3][3] = 1.0f;
 	}
 	identity = false;
 	SetChanged(true);
@@ -578,11 +547,9 @@ void Matrix::ScaleMatrix(const Vec3 &s)
  */
 void Matrix::Scale(float x, float y, float z)
 {
-	//jb - removing function calls
-	//Scale(Vec3(x, y, z));
-	Matrix tmp;
-	tmp.ScaleMatrix(Vec3(x, y, z));
-	PreMul(tmp);
+	m_Mat.PreScale(Vec3(x, y, z));
+	identity = false;
+	SetChanged(true);
 }
 
 /*!
@@ -601,9 +568,9 @@ void Matrix::Scale(float x, float y, float z)
  */
 void Matrix::Scale(const Vec3& p)
 {
-	Matrix tmp;
-	tmp.ScaleMatrix(p);
-	PreMul(tmp);
+	m_Mat.PreScale(p);
+	identity = false;
+	SetChanged(true);
 }
 
 /*!
@@ -669,7 +636,7 @@ void Matrix::LookAt(const Vec3& v, float twist)
 Matrix& Matrix::operator+=(const Matrix& m)
 {
 	const float* src = m.GetMatrix();
-	float* dst = (float*) data;
+	float* dst = (float*) m_Mat.data;
 
 	for (int i=0; i < 16; i++)
 		dst[i] += src[i];
@@ -690,7 +657,7 @@ Matrix& Matrix::operator+=(const Matrix& m)
 Matrix&	Matrix::operator-=(const Matrix& m)
 {
 	const float* src = m.GetMatrix();
-	float* dst = (float*) data;
+	float* dst = (float*) m_Mat.data;
 
 	for (int i=0; i < 16; i++)
 		dst[i] -= src[i];
@@ -711,8 +678,7 @@ Matrix&	Matrix::operator-=(const Matrix& m)
  */
 void Matrix::PreMul(const Matrix& src)
 {
-	Matrix tmp(*this);
-	Multiply(src, tmp);
+	Multiply(src, *this);
 }
 
 /*!
@@ -727,8 +693,7 @@ void Matrix::PreMul(const Matrix& src)
  */
 void Matrix::PostMul(const Matrix& src)
 {
-	Matrix tmp(*this);
-	Multiply(tmp, src);
+	Multiply(*this, src);
 }
 
 /*!
@@ -756,10 +721,9 @@ Matrix&	Matrix::operator*=(const Matrix& src)
  * We interpret matrices to be in the same row/column order as C arrays.
  * To get element[i][j] of the destination, we multiply the ith row of A
  * by the jth column of B.
- * This routine does not work if two or more of the matrices are 
- * the same.  A call like Matrix::Mul(a, a, b) will compute the wrong result.
+ * Either input may be this matrix.
  *
- * @see Matrix::PreMul Matrix::PostMul Matrix::operator*=
+ * @see Matrix::PreMul Matrix::PostMul Matrix::operator*= Mat4::Multiply
  */
 void Matrix::Multiply(const Matrix &inA, const Matrix &inB)
 {
@@ -774,8 +738,6 @@ void Matrix::Multiply(const Matrix &inA, const Matrix &inB)
 		Identity();
 		return;
 	}
-
-	identity = false;
 	if (a.identity)
 	{
 		Copy(b);
@@ -787,41 +749,24 @@ void Matrix::Multiply(const Matrix &inA, const Matrix &inB)
 		return;
 	}
 
+	identity = false;				// after testing, a or b may be this matrix
 	SetChanged(true);
-    data[0][0]=a.data[0][0]*b.data[0][0]+a.data[0][1]*b.data[1][0]+a.data[0][2]*b.data[2][0]+a.data[0][3]*b.data[3][0];
-    data[1][0]=a.data[1][0]*b.data[0][0]+a.data[1][1]*b.data[1][0]+a.data[1][2]*b.data[2][0]+a.data[1][3]*b.data[3][0];
-    data[2][0]=a.data[2][0]*b.data[0][0]+a.data[2][1]*b.data[1][0]+a.data[2][2]*b.data[2][0]+a.data[2][3]*b.data[3][0];
-    data[3][0]=a.data[3][0]*b.data[0][0]+a.data[3][1]*b.data[1][0]+a.data[3][2]*b.data[2][0]+a.data[3][3]*b.data[3][0];
-    data[0][1]=a.data[0][0]*b.data[0][1]+a.data[0][1]*b.data[1][1]+a.data[0][2]*b.data[2][1]+a.data[0][3]*b.data[3][1];
-    data[1][1]=a.data[1][0]*b.data[0][1]+a.data[1][1]*b.data[1][1]+a.data[1][2]*b.data[2][1]+a.data[1][3]*b.data[3][1];
-    data[2][1]=a.data[2][0]*b.data[0][1]+a.data[2][1]*b.data[1][1]+a.data[2][2]*b.data[2][1]+a.data[2][3]*b.data[3][1];
-    data[3][1]=a.data[3][0]*b.data[0][1]+a.data[3][1]*b.data[1][1]+a.data[3][2]*b.data[2][1]+a.data[3][3]*b.data[3][1];
-    data[0][2]=a.data[0][0]*b.data[0][2]+a.data[0][1]*b.data[1][2]+a.data[0][2]*b.data[2][2]+a.data[0][3]*b.data[3][2];
-    data[1][2]=a.data[1][0]*b.data[0][2]+a.data[1][1]*b.data[1][2]+a.data[1][2]*b.data[2][2]+a.data[1][3]*b.data[3][2];
-    data[2][2]=a.data[2][0]*b.data[0][2]+a.data[2][1]*b.data[1][2]+a.data[2][2]*b.data[2][2]+a.data[2][3]*b.data[3][2];
-    data[3][2]=a.data[3][0]*b.data[0][2]+a.data[3][1]*b.data[1][2]+a.data[3][2]*b.data[2][2]+a.data[3][3]*b.data[3][2];
-    data[0][3]=a.data[0][0]*b.data[0][3]+a.data[0][1]*b.data[1][3]+a.data[0][2]*b.data[2][3]+a.data[0][3]*b.data[3][3];
-    data[1][3]=a.data[1][0]*b.data[0][3]+a.data[1][1]*b.data[1][3]+a.data[1][2]*b.data[2][3]+a.data[1][3]*b.data[3][3];
-    data[2][3]=a.data[2][0]*b.data[0][3]+a.data[2][1]*b.data[1][3]+a.data[2][2]*b.data[2][3]+a.data[2][3]*b.data[3][3];
-    data[3][3]=a.data[3][0]*b.data[0][3]+a.data[3][1]*b.data[1][3]+a.data[3][2]*b.data[2][3]+a.data[3][3]*b.data[3][3];
+	m_Mat.Multiply(a.m_Mat, b.m_Mat);
 }
 
 
 
 void Matrix::Transform(const Vec4 &tmp, Vec4 &dst) const
 {
-	dst.x = Dot4(tmp, data[0]);
-    dst.y = Dot4(tmp, data[1]);
-    dst.z = Dot4(tmp, data[2]);
-	dst.w = Dot4(tmp, data[3]); 
+	m_Mat.Transform(tmp, dst);
 }
 
 void Matrix::Transform(const Vec3 &tmp, Vec4 &dst) const
 {
-	dst.x = Dot3(tmp, data[0]) + data[0][3];
-    dst.y = Dot3(tmp, data[1]) + data[1][3];
-    dst.z = Dot3(tmp, data[2]) + data[2][3];
-	dst.w = Dot3(tmp, data[3]) + data[3][3];
+	dst.x = Dot3(tmp, m_Mat.data[0]) + m_Mat.data[0][3];
+    dst.y = Dot3(tmp, m_Mat.data[1]) + m_Mat.data[1][3];
+    dst.z = Dot3(tmp, m_Mat.data[2]) + m_Mat.data[2][3];
+	dst.w = Dot3(tmp, m_Mat.data[3]) + m_Mat.data[3][3];
 }
 
 void Matrix::Transform(const Sphere& src, Sphere& dst) const
@@ -832,22 +777,22 @@ void Matrix::Transform(const Sphere& src, Sphere& dst) const
 		dst.Radius = src.Radius;
 	else
 	{
-		rx = fabs(data[0][0]);
-		tmp = fabs(data[0][1]);
+		rx = fabs(m_Mat.data[0][0]);
+		tmp = fabs(m_Mat.data[0][1]);
 		if (tmp > rx) rx = tmp;
-			tmp = fabs(data[0][2]);
+			tmp = fabs(m_Mat.data[0][2]);
 		if (tmp > rx) rx = tmp;
-			tmp = fabs(data[1][0]);
+			tmp = fabs(m_Mat.data[1][0]);
 		if (tmp > rx) rx = tmp;
-			tmp = fabs(data[1][1]);
+			tmp = fabs(m_Mat.data[1][1]);
 		if (tmp > rx) rx = tmp;
-			tmp = fabs(data[1][2]);
+			tmp = fabs(m_Mat.data[1][2]);
 		if (tmp > rx) rx = tmp;
-			tmp = fabs(data[2][0]);
+			tmp = fabs(m_Mat.data[2][0]);
 		if (tmp > rx) rx = tmp;
-			tmp = fabs(data[2][1]);
+			tmp = fabs(m_Mat.data[2][1]);
 		if (tmp > rx) rx = tmp;
-			tmp = fabs(data[2][2]);
+			tmp = fabs(m_Mat.data[2][2]);
 		if (tmp > rx) rx = tmp;
 			dst.Radius = src.Radius * (float) rx;
 	}
@@ -864,25 +809,7 @@ void Matrix::Transform(const Sphere& src, Sphere& dst) const
  */
 void Matrix::Transpose()
 {
-    float val;
-    val = data[0][1];
-    data[0][1] = data[1][0];
-    data[1][0] = val;
-    val = data[0][2];
-    data[0][2] = data[2][0];
-    data[2][0] = val;
-    val = data[0][3];
-    data[0][3] = data[3][0];
-    data[3][0] = val;
-    val = data[1][2];
-    data[1][2] = data[2][1];
-    data[2][1] = val;
-    val = data[1][3];
-    data[1][3] = data[3][1];
-    data[3][1] = val;
-    val = data[2][3];
-    data[2][3] = data[3][2];
-    data[3][2] = val;
+	m_Mat.Transpose();
 	SetChanged(true);
 }
 
@@ -892,10 +819,8 @@ void Matrix::Transpose()
  *				replaces the destination matrix.
  *
  * Replaces this matrix with the inverse of the source matrix.
- * Currently this function does not work correctly if the source
- * and destination matrices are the same (will not compute inverse
- * in place). It also does not tell you if the matrix is singular
- * (does not have a valid inverse).
+ * The source may be this matrix. It does not tell you if the
+ * matrix is singular (does not have a valid inverse).
  *
  * @see Matrix::Transpose
  */
@@ -907,24 +832,16 @@ void Matrix::Invert(const Matrix& src)
 		return;
 	}
 
+	Mat4	tmp(src.m_Mat.GetData());
+
 	identity = false;	
 	SetChanged(true);
-    if ((src.data[0][3] == 0) && (src.data[1][3] == 0) && (src.data[2][3] == 0))
-	{
-        Down_triangle_Inverse_Xform(src.data, data);
-        return;
-    }
-	else if ((src.data[3][0] == 0) && (src.data[3][1] == 0) && (src.data[3][2] == 0))
-	{
-        Up_triangle_Inverse_Xform(src.data, data);
-        return;
-    }
+	if ((tmp.data[0][3] == 0) && (tmp.data[1][3] == 0) && (tmp.data[2][3] == 0))
+		Down_triangle_Inverse_Xform(tmp.data, m_Mat.data);
+	else if ((tmp.data[3][0] == 0) && (tmp.data[3][1] == 0) && (tmp.data[3][2] == 0))
+		Up_triangle_Inverse_Xform(tmp.data, m_Mat.data);
 	else
-	{
-        Full_Inverse_Xform3(src.data, data);
-        return;
-    }
-
+		m_Mat.Invert(tmp);
 }
 
 /*!
@@ -936,9 +853,7 @@ void Matrix::Invert(const Matrix& src)
  */
 void Matrix::Invert()
 {
-Matrix tmp(*this);
-
-	Invert(tmp);
+	Invert(*this);
 }
 
 Matrix &Matrix::operator=(const Matrix &src)
@@ -965,16 +880,27 @@ bool Matrix::Copy(const SharedObj* src)
 
 void Matrix::Copy(const Matrix &src)
 {
-	const Matrix& a = (const Matrix&) src;
-
-	if (identity == a.identity && identity)
+	if (identity == src.identity && identity)
 		return;
-	identity = a.identity;
+	identity = src.identity;
 	SetChanged(true);
-	data[0][0]=a.data[0][0]; data[0][1]=a.data[0][1]; data[0][2]=a.data[0][2]; data[0][3]=a.data[0][3];
-	data[1][0]=a.data[1][0]; data[1][1]=a.data[1][1]; data[1][2]=a.data[1][2]; data[1][3]=a.data[1][3];
-	data[2][0]=a.data[2][0]; data[2][1]=a.data[2][1]; data[2][2]=a.data[2][2]; data[2][3]=a.data[2][3];
-	data[3][0]=a.data[3][0]; data[3][1]=a.data[3][1]; data[3][2]=a.data[3][2]; data[3][3]=a.data[3][3];
+	m_Mat = src.m_Mat;
+}
+
+/*!
+ * @fn void Matrix::Copy(const Mat4& src)
+ * @param src	matrix elements to copy
+ *
+ * Copies the elements of a matrix value into this matrix.
+ * Unlike Matrix::SetMatrix, the change is not logged.
+ *
+ * @see Matrix::GetMat4 Matrix::SetMatrix
+ */
+void Matrix::Copy(const Mat4 &src)
+{
+	identity = false;
+	SetChanged(true);
+	m_Mat = src;
 }
 
 /***
@@ -1028,214 +954,6 @@ int Matrix::Save(Messenger& s, int opts) const
 
 
 
-static void Full_Inverse_Xform3(const float b[4][4], float a[4][4])
-{
-    long indxc[4], indxr[4], ipiv[4];
-    long i, icol = 0, irow = 0, j, ir, ic;
-    float big, dum, pivinv, temp, bb;
-    ipiv[0] = -1;
-    ipiv[1] = -1;
-    ipiv[2] = -1;
-    ipiv[3] = -1;
-    a[0][0] = b[0][0];
-    a[1][0] = b[1][0];
-    a[2][0] = b[2][0];
-    a[3][0] = b[3][0];
-    a[0][1] = b[0][1];
-    a[1][1] = b[1][1];
-    a[2][1] = b[2][1];
-    a[3][1] = b[3][1];
-    a[0][2] = b[0][2];
-    a[1][2] = b[1][2];
-    a[2][2] = b[2][2];
-    a[3][2] = b[3][2];
-    a[0][3] = b[0][3];
-    a[1][3] = b[1][3];
-    a[2][3] = b[2][3];
-    a[3][3] = b[3][3];
-    for (i = 0; i < 4; i++)
-	{
-        big = 0.0f;
-        for (j = 0; j < 4; j++)
-		{
-            if (ipiv[j] != 0)
-			{
-                if (ipiv[0] == -1)
-				{
-                    if ((bb = (float) fabs(a[j][0])) > big)
-					{
-                        big = bb;
-                        irow = j;
-                        icol = 0;
-                    }
-                }
-				else if (ipiv[1] > 0)
-				{
-					   return;
-				}
-				if (ipiv[2] == -1)
-				{
-					if ((bb = (float) fabs((float) a[j][2])) > big)
-					{
-						big = bb;
-						irow = j;
-						icol = 2;
-					}
-				}
-				else if (ipiv[2] > 0)
-				{
-                    return;
-                }
-                if (ipiv[3] == -1)
-				{
-                    if ((bb = (float) fabs((float) a[j][3])) > big)
-					{
-                        big = bb;
-                        irow = j;
-                        icol = 3;
-                    }
-                }
-				else if (ipiv[3] > 0)
-				{
-                    return;
-                }
-            }
-        }
-        ++(ipiv[icol]);
-        if (irow != icol)
-		{
-            temp = a[irow][0];
-            a[irow][0] = a[icol][0];
-            a[icol][0] = temp;
-            temp = a[irow][1];
-            a[irow][1] = a[icol][1];
-            a[icol][1] = temp;
-            temp = a[irow][2];
-            a[irow][2] = a[icol][2];
-            a[icol][2] = temp;
-            temp = a[irow][3];
-            a[irow][3] = a[icol][3];
-            a[icol][3] = temp;
-        }
-        indxr[i] = irow;
-        indxc[i] = icol;
-        if (a[icol][icol] == 0.0)
-		{
-            return;
-        }
-        pivinv = 1.0f / a[icol][icol];
-        a[icol][icol] = 1.0f;
-        a[icol][0] *= pivinv;
-        a[icol][1] *= pivinv;
-        a[icol][2] *= pivinv;
-        a[icol][3] *= pivinv;
-        if (icol != 0)
-		{
-            dum = a[0][icol];
-            a[0][icol] = 0.0f;
-            a[0][0] -= a[icol][0] * dum;
-            a[0][1] -= a[icol][1] * dum;
-            a[0][2] -= a[icol][2] * dum;
-            a[0][3] -= a[icol][3] * dum;
-        }
-        if (icol != 1)
-		{
-            dum = a[1][icol];
-            a[1][icol] = 0.0f;
-            a[1][0] -= a[icol][0] * dum;
-            a[1][1] -= a[icol][1] * dum;
-            a[1][2] -= a[icol][2] * dum;
-            a[1][3] -= a[icol][3] * dum;
-        }
-        if (icol != 2)
-		{
-            dum = a[2][icol];
-            a[2][icol] = 0.0f;
-            a[2][0] -= a[icol][0] * dum;
-            a[2][1] -= a[icol][1] * dum;
-            a[2][2] -= a[icol][2] * dum;
-            a[2][3] -= a[icol][3] * dum;
-        }
-        if (icol != 3)
-		{
-            dum = a[3][icol];
-            a[3][icol] = 0.0f;
-            a[3][0] -= a[icol][0] * dum;
-            a[3][1] -= a[icol][1] * dum;
-            a[3][2] -= a[icol][2] * dum;
-            a[3][3] -= a[icol][3] * dum;
-        }
-    }
-    if (indxr[3] != indxc[3])
-	{
-        ir = indxr[3];
-        ic = indxc[3];
-        temp = a[0][ir];
-        a[0][ir] = a[0][ic];
-        a[0][ic] = temp;
-        temp = a[1][ir];
-        a[1][ir] = a[1][ic];
-        a[1][ic] = temp;
-        temp = a[2][ir];
-        a[2][ir] = a[2][ic];
-        a[2][ic] = temp;
-        temp = a[3][ir];
-        a[3][ir] = a[3][ic];
-        a[3][ic] = temp;
-    }
-    if (indxr[2] != indxc[2])
-	{
-        ir = indxr[2];
-        ic = indxc[2];
-        temp = a[0][ir];
-        a[0][ir] = a[0][ic];
-        a[0][ic] = temp;
-        temp = a[1][ir];
-        a[1][ir] = a[1][ic];
-        a[1][ic] = temp;
-        temp = a[2][ir];
-        a[2][ir] = a[2][ic];
-        a[2][ic] = temp;
-        temp = a[3][ir];
-        a[3][ir] = a[3][ic];
-        a[3][ic] = temp;
-    }
-    if (indxr[1] != indxc[1])
-	{
-        ir = indxr[1];
-        ic = indxc[1];
-        temp = a[0][ir];
-        a[0][ir] = a[0][ic];
-        a[0][ic] = temp;
-        temp = a[1][ir];
-        a[1][ir] = a[1][ic];
-        a[1][ic] = temp;
-        temp = a[2][ir];
-        a[2][ir] = a[2][ic];
-        a[2][ic] = temp;
-        temp = a[3][ir];
-        a[3][ir] = a[3][ic];
-        a[3][ic] = temp;
-    }
-    if (indxr[0] != indxc[0])
-	{
-        ir = indxr[0];
-        ic = indxc[0];
-        temp = a[0][ir];
-        a[0][ir] = a[0][ic];
-        a[0][ic] = temp;
-        temp = a[1][ir];
-        a[1][ir] = a[1][ic];
-        a[1][ic] = temp;
-        temp = a[2][ir];
-        a[2][ir] = a[2][ic];
-        a[2][ic] = temp;
-        temp = a[3][ir];
-        a[3][ir] = a[3][ic];
-        a[3][ic] = temp;
-    }
-}
-
 static float det3x3(float a1, float a2, float a3, float b1, float b2, float b3, float c1, float c2, float c3)
 {
         return (float) (a1 * (b2 * c3 - b3 * c2) - b1 * (a2 * c3 - a3 * c2) + c1 * (a2 * b3 - a3 * b2));
@@ -6,7 +6,6 @@ using namespace Core;
 
 
 VX_IMPLEMENT_CLASSID(Messenger, Core::Stream, VX_Messenger);
-VX_IMPLEMENT_CLASS(Messenger::Observer, List);
 
 bool	Messenger::t_NoLog;
 int		Messenger::SysVecSize = VX_VEC3_SIZE;
@@ -16,15 +15,14 @@ Messenger::Messenger(Core::Stream* stream, bool dolock) : SharedObj()
 	m_ConnectID = 0;
 	Version = MESS_CurrentVersion;
 	FileVecSize = 3;
-	DoSync = SendUpdates = SendEvents = false;
-	m_Observers = new PtrArray;
+	DoSync = SendUpdates = SendEvents = DirectEvents = false;
+	m_EventBus = new EventBus;
 	m_Names = new NameTable;
 	m_Objs = new ObjMap;
 	if (dolock)
 	{
 		m_Names->MakeLock();
 		m_Objs->MakeLock();
-		m_Observers->MakeLock();
 	}
 	SetInStream(stream);
 }
@@ -40,17 +38,16 @@ bool Messenger::Copy(const SharedObj* srcobj)
 
 	m_Objs = src->m_Objs;
 	m_Names = src->m_Names;
-	m_Observers = src->m_Observers;
+	m_EventBus = src->m_EventBus;
 	m_Names->MakeLock();
 	m_Objs->MakeLock();
-	m_Observers->MakeLock();
 	return true;
 }
 
 
 Messenger::~Messenger()
 {
-	m_Observers = (PtrArray*) NULL;
+	m_EventBus = (EventBus*) NULL;
 	m_Objs = (ObjMap*) NULL;
 	m_Names = (NameTable*) NULL;
 }
@@ -201,21 +198,37 @@ int	Messenger::CanSave(const SharedObj* obj, int savemode)
  */
 SharedObj* Messenger::Find(const TCHAR* name) const
 {
-	NameProp	np(name);
 	ObjRef*	ref;
 
 	if (STRCHR(name, TEXT('*')) == 0)		// not a wildcard search?
-	{
-		if (ref = m_Names->Find(np))
-			return (SharedObj*) *ref;
-		else
-			return NULL;
-	}
+		return Find(Core::AtomTable::Find(name));
 	if (ref = m_Names->FindWild(name))
 		return (SharedObj*) *ref;
 	return NULL;
 }
 
+/*!
+ * @fn SharedObj* Messenger::Find(Core::Atom name) const
+ * @param name	atom for the name of the object to retrieve
+ *
+ * Finds the object with the given name in the messenger's dictionary.
+ * Names are compared using their atoms so the string is not hashed
+ * or compared. Code which looks up the same names every frame
+ * can intern them once with Core::AtomTable::Intern and use this function.
+ *
+ * @return pointer to object found, NULL if object not found
+ *
+ * @see Messenger::Define Core::AtomTable
+ */
+SharedObj* Messenger::Find(Core::Atom name) const
+{
+	ObjRef*	ref = m_Names->Find(name);
+
+	if (ref)
+		return (SharedObj*) *ref;
+	return NULL;
+}
+
 /*!
  * @fn ObjArray* Messenger::FindAll(const TCHAR* name) const
  * @param name	String name of objects to retrieve. If the name is NULL
@@ -461,6 +474,7 @@ void Messenger::Detach(const SharedObj* obj)
  */
 bool Messenger::Load()
 {
+	VX_PROFILE_ZONE(TEXT("Messenger::Load"));
 	int32		opcode, handle;
 	int32		classid;
 	SharedObj*		obj;
@@ -564,33 +578,11 @@ void Messenger::SetConnectID(int id)
  */
 bool Messenger::Observe(const SharedObj* target, int code, const SharedObj* sender)
 {
-	if (target == NULL)
+	if (!m_EventBus->Observe(target, code, sender))
 		return false;
-	Observer*	head = NULL;
-	ObjectLock	lock((SharedObj*) m_Observers);
-
-	if ((code < (int) m_Observers->GetSize()) &&
-		(head = (Observer*) m_Observers->GetAt(code)))
-	{
-		Observer* cur = head;
-		do									// scan for duplicates
-		{
-			if (cur->Target != target)		// same target
-				continue;
-			if (cur->Code && (cur->Code != code))
-				continue;					// same code
-			if ((cur->Sender != (const SharedObj*) NULL) && (cur->Sender != sender))
-				continue;					// same sender
-			return false;					// don't add
-		}
-		while (cur = (Observer*) cur->Next);
-	}
-	Observer*	obs = new Observer(target, code, sender);
-	obs->Next = head;						// add observer to list
-	m_Observers->SetAt(code, (void*) obs);
 	VX_TRACE(Messenger::Debug, ("Messenger::Observe %s %d\n", Event::GetName(code), code));
 	return true;
-};
+}
 
 /*!
  * @fn bool Messenger::Observe(const SharedObj* target, int code, const SharedObj* sender)
@@ -607,40 +599,9 @@ bool Messenger::Observe(const SharedObj* target, int code, const SharedObj* send
  */
 bool Messenger::Ignore(const SharedObj* target, int code, const SharedObj* sender)
 {
-	Observer*	obs;
-	Observer*	next;
-	int			rc = -1;
-	ObjectLock	lock((SharedObj*) m_Observers);
-
-	if (m_Observers.IsNull())
+	if (m_EventBus.IsNull())
 		return false;
-	if (code && (code < (int) m_Observers->GetSize()))
-	{
-		if (obs = (Observer*) m_Observers->GetAt(code))
-		{
-			next = (Observer*) obs->Next;
-			rc = obs->Remove(target, sender);
-			if (rc >= 0) { VX_TRACE(Messenger::Debug, ("Messenger::Ignore %s %d\n", Event::GetName(code), code)); }
-			if (rc > 0)
-				m_Observers->SetAt(code, next);
-		}
-		return rc >= 0;
-	}
-	for (int i = 0; i < (int) m_Observers->GetSize(); ++i)
-	{
-		if (obs = (Observer*) m_Observers->GetAt(i))
-		{
-			do
-			{
-				next = (Observer*) obs->Next;
-				rc = obs->Remove(target, sender);
-				if (rc >= 0) { VX_TRACE(Messenger::Debug, ("Messenger::Ignore %s %d\n", Event::GetName(i), i)); }
-			}
-			while (obs = next);
-			m_Observers->SetAt(i, NULL);
-		}
-	}
-	return rc >= 0;
+	return m_EventBus->Ignore(target, code, sender);
 }
 
 /****
@@ -714,7 +675,7 @@ void Messenger::DoEvent()
 
 	*this >> code;
 	VX_ASSERT(code <= Event::MAX_CODE);
-	Event*	e = World::Get()->MakeEvent(code);
+	Event*	e = m_EventBus->NewEvent(code);
 	if (e == NULL)
 	   { VX_ERROR_RETURN(("Messenger::DoEvent(%d) event cannot be created\n", code)); }
 	e->Parse(*this);
@@ -722,13 +683,8 @@ void Messenger::DoEvent()
 	VX_TRACE((Event::Debug || (Messenger::Debug > 1)),
 			 ("VX_Event %s Code = %d, Time = %f\n", Event::GetName(e->Code), e->Code, e->Time));
 #endif
-	if (code < (int) m_Observers->GetSize())
-	{
-		Observer*	obs = (Observer*) m_Observers->GetAt(code);
-		if (obs)
-			obs->Dispatch(e);
-	}
-	delete e;
+	m_EventBus->Dispatch(*e);
+	m_EventBus->FreeEvent(e);
 }
 
 
@@ -822,13 +778,19 @@ Messenger& Messenger::operator<<(const TCHAR* cp)
  * next frame. All events are sent to remote processors whether or
  * not they are observed there.
  *
- * @see Messenger::Observe Messenger::Ignore Event SharedObj::OnEvent
+ * If \b DirectEvents is set and events are not sent to remote processors,
+ * the event is copied into a pooled event and posted to the event bus
+ * instead of being saved to the stream. It is dispatched at the same time
+ * without ever being serialized.
+ *
+ * @see Messenger::Observe Messenger::Ignore Event SharedObj::OnEvent EventBus::Post
  */
 Messenger& Messenger::operator<<(const Event& ev)
 {
 	VX_TRACE((Event::Debug || (Messenger::Debug > 1)),
 			 ("Messenger::LogEvent %s Code = %d, Time = %f\n", Event::GetName(ev.Code), ev.Code, ev.Time));
-	SharedObj* sender = ev.Sender;
+	if (DirectEvents && !SendEvents && m_EventBus->Post(ev))
+		return *this;
 	BeginOp(MESS_EventLog);
 	ev.Save(*this);
 	EndOp();
@@ -1134,6 +1096,7 @@ bool Messenger::Input(float* fp, int n)
  ****/
 void	Messenger::Flush()
 {
+	VX_PROFILE_ZONE(TEXT("Messenger::Flush"));
 	if (!m_OutStream.IsNull())
 		m_OutStream->Flush();
 }
@@ -1211,57 +1174,6 @@ DebugOut& Messenger::Print(DebugOut& dbg, int opts) const
 	return dbg;
 }
 
-/****
- *
- * PROP_Observe is a property used internally to maintain observation
- * relationships for a stream. Each time an event is observed,
- * an Observer property is linked into that event's list of observers.
- * When an event occurs, its observer list is scanned and the
- * OnEvent method is called for the observers of that event
- *
- ****/
-int Messenger::Observer::Remove(const SharedObj* target, const SharedObj* sender)
-{
-	Observer*	obs = NULL;
-	Observer*	cur = this;
-	int			rc = -1;
-
-	do
-	{
-		if ((cur->Sender == sender) && sender)
-			continue;
-		if ((cur->Target != target) && target)
-			continue;
-		if (obs)
-		{
-			rc = 0;
-			obs->Next = (Observer*) cur->Next;
-		}
-		else
-			rc = 1;
-		delete cur;
-		return rc;
-	}
-	while ((obs == cur) && (cur = (Observer*) cur->Next));
-	return -1;
-}
-	
-void Messenger::Observer::Dispatch(Event* e)		// dispatch event to proper observer
-{
-	Observer*	obs = this;
-	Observer*	next;
-
-	do													// for all observers linked to us
-	{
-		next = (Observer*) obs->Next;
-		if (((SharedObj*) obs->Sender == e->Sender) ||	// observing the sender?
-			(obs->Sender == NULL))						// observing anybody sending the event?
-			if (obs->Target != (const SharedObj*) NULL)
-				obs->Target->OnEvent(e);
-	}
-	while (obs = next);
-};
-
 Messenger::ObjMap::~ObjMap()
 {
 	Empty();
@@ -29,37 +29,9 @@ Matrix::Matrix(const Quat& q) : SharedObj()
  */
 void Matrix::Set(const Quat& q)
 {
-    float data[4][4];
-	data[0][3] = data[1][3] = data[2][3] = 0.0;
-    data[3][0] = data[3][1] = data[3][2] = 0.0;
-	data[3][3] = 1.0f;
-
-	float	s = 2.0f / q.LengthSquared();
-	float	xx = q.x * q.x;
-	float	xy = q.x * q.y;
-	float	xz = q.x * q.z;
-	float	xw = q.x * q.w;
-	float	yy = q.y * q.y;
-	float	yz = q.y * q.z;
-	float	yw = q.y * q.w;
-	float	zz = q.z * q.z;
-	float	wz = q.z * q.w;
-	float	ww = q.w * q.w;
-
-	//	1-2(yy+zz)	2(xy+wz)	2(xz-yw)
-	//	2(xy-wz)	1-2(xx+zz)	2(yz+xw)
-	//	2(xz+yw)	2(yz-xw)	1-2(xx+yy)
-	//
-	data[0][0] = 1.0f - s * (yy + zz);
-	data[1][0] = s * (xy + wz);
-	data[2][0] = s * (xz - yw);
-	data[0][1] = s * (xy - wz);
-	data[1][1] = 1.0f - s * (xx + zz);	
-	data[2][1] = s * (yz + xw);
-	data[0][2] = s * (xz + yw);
-	data[1][2] = s * (yz - xw);
-	data[2][2] = 1.0f - s * (xx + yy);
-	SetMatrix(&(data[0][0]));
+	Mat4	tmp(q);
+
+	SetMatrix(tmp.GetData());
 	SetChanged(true);
 
 #ifdef _DEBUG
@@ -46,6 +46,7 @@ Synchronizer::Synchronizer(int maxbuf, Core::ThreadQueue* bufpool)
 	m_CurConn = -1;
 	m_ReadSocket = false;
 	m_SyncFlags = m_SyncAll = m_SendAll = 0;
+	m_Resync = 0;
 }
 
 Synchronizer::~Synchronizer()
@@ -73,6 +74,7 @@ bool Synchronizer::Open(const TCHAR* svrname, int mode)
 	m_IsFull = false;
 	m_MaxPrevID = m_CurBase = 0;
 	m_SyncFlags = m_SyncAll = m_SendAll = m_AllClients = 0;
+	m_Resync = 0;
 	m_CurConn = -1;
 /*
  * If the name is NULL or begins with "master" assume we are
@@ -142,6 +144,14 @@ bool Synchronizer::Close()
  ****/
 void Synchronizer::Flush()
 {
+	if (m_Resync)						// clients which fell behind?
+	{
+		uint32 flags = m_Resync;
+
+		m_Resync = 0;
+		m_AllClients |= flags;
+		ConnectObjs(flags);				// send them the scene again
+	}
 	BufMessenger::Flush();
 	if (DoSync && (m_BytesSent == 0) && m_SendBuf)
 	{
@@ -559,6 +569,8 @@ bool Synchronizer::SendAll(uint32 sendflags)
 	int				ntotal = stream->GetSize();
 	int				nconn = 0;
 
+	if (ntotal >= MESS_MaxHosts)			// more clients than sync flags?
+		ntotal = MESS_MaxHosts - 1;
 	for (int i = 0; i < ntotal; ++i)		// who needs to be sent something?
 		if (GetSyncFlag(i + 1))
 			connections[nconn++] = i;
@@ -568,12 +580,62 @@ bool Synchronizer::SendAll(uint32 sendflags)
 	{
 		if (stream->Select(connections, nconn) > 0)
 			SendToArbitrator(connections, nconn, sendflags);
+		CheckStalled(stream);
 		sendflags = m_SendAgain;			// need to resent these
 	}
 	while (sendflags);
 	return true;
 }
 
+/*!
+ * @fn void Synchronizer::CheckStalled(Core::Arbitrator* stream)
+ *
+ * Handles the connections which could not keep up with the output.
+ * A connection which was dropped by the arbitrator is removed
+ * as if it had exited, it will be sent the scene if it reconnects.
+ * A connection which had its output discarded is sent the
+ * whole scene again at the start of the next flush.
+ *
+ * @see Arbitrator::GetStalled SocketArbitrator::SlowPolicy
+ */
+void Synchronizer::CheckStalled(Core::Arbitrator* stream)
+{
+	int		stalled[MESS_MaxHosts];
+	int		n = stream->GetStalled(stalled, MESS_MaxHosts);
+
+	for (int i = 0; i < n; ++i)
+	{
+		int		connid = stalled[i];
+		uint32	syncflag;
+
+		if ((connid < 0) || (connid >= MESS_MaxHosts))
+			continue;
+		syncflag = s_SyncTable[connid];
+		if ((syncflag == 0) && (stream->GetSize() == 1))
+			syncflag = 1;
+		m_SendAgain &= ~syncflag;
+		m_SyncFlags &= ~syncflag;
+		m_SendAll &= ~syncflag;
+		if (stream->GetAt(connid) < 0)		// connection was dropped?
+		{
+			VX_TRACE(Debug, ("Synchronizer: connection %d dropped", connid));
+			m_SyncAll &= ~syncflag;
+			m_Resync &= ~syncflag;
+		}
+		else								// output was discarded
+		{
+			VX_TRACE(Debug, ("Synchronizer: connection %d will be resynchronized", connid));
+			m_Resync |= syncflag;
+		}
+	}
+	if ((n > 0) && (m_SendAgain == 0) && !m_WasSent)
+	{
+		m_WasSent = true;
+		m_IsFull = false;
+		m_BytesSent = 0;
+	}
+}
+
 
 bool Synchronizer::SendToArbitrator(int* connections, int nconn, uint32 sendflags)
 {
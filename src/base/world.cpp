@@ -158,9 +158,22 @@ void World::OnExit()
  */
 float World::GetTime() const
 {
-	double	time = Core::GetTime();
-	float	t = (float) (time - StartTime);
-	return t;
+	return (float) GetRealTime();
+}
+
+/*!
+ * @fn double World::GetRealTime() const
+ *
+ * Returns the number of seconds since World::StartTime as a double.
+ * The time comes from a monotonic clock and does not lose precision
+ * in long running applications. Use this instead of World::GetTime
+ * to measure intervals after the application has been running for days.
+ *
+ * @see World::GetTime Scene::SetSimStep
+ */
+double World::GetRealTime() const
+{
+	return Core::GetTime() - StartTime;
 }
 
 /*!
@@ -37,13 +37,16 @@ public:
 	bool				NeedPose;
 	bool				IsStarted;
 	KinectTracker*		Owner;
+	int32				UserState[BodyTracker::MAX_USERS];
+	Core::CritSec		DataLock;		// held while sensor data is updated or copied to textures
 
 	Kinect(KinectTracker* owner = NULL);
 	~Kinect();
 	bool		OpenRecording(const TCHAR* file);
 	bool		Configure(const TCHAR* file);
 	bool		Start();
-	void		Update();
+	bool		Update(bool wait);
+	void		SetUserState(XnUserID userid, int32 state);
 	bool		GetJointRotation(XnUserID userid, XnSkeletonJoint jointindex, Quat& rotationk);
 	bool		GetJointPosition(XnUserID nId, XnSkeletonJoint jointindex, Vec3& position);
 	void		NewUser(XnUserID userid);
@@ -134,6 +137,7 @@ KinectTracker::KinectTracker(const KinectTracker& src)
  */
 KinectTracker::~KinectTracker()
 {
+	StopCapture();
 	if (m_Kinect)
 	{
 		m_Kinect->Delete();
@@ -271,133 +275,114 @@ bool KinectTracker::OnStart()
 }
 
 /*
- * Updates the color and depth map textures from the Kinect cameras.
- * If a Skeleton is our target or a child, we update the joint angles
- * for the user associated with it.
+ * Updates the joint angles of the skeleton from the
+ * newest frame captured from the Kinect.
+ * The depth and color map textures are updated here on the
+ * simulation thread when a new frame arrives, not on the capture thread.
  */
 bool KinectTracker::Eval(float t)
 {
+	int32	seq = m_Frame.Sequence;
+	bool	rc;
+
 	if (m_Kinect == NULL)
 		return false;
-	if (m_Kinect->Owner == this)
+	rc = BodyTracker::Eval(t);
+	if ((m_Kinect->Owner == this) &&
+		(m_Frame.Sequence != seq) &&		// new frame from the sensor?
+		(!m_DepthTexture.IsNull() || !m_ColorTexture.IsNull()))
 	{
-		m_Kinect->Update();
+		Core::Lock	lock(m_Kinect->DataLock);
+
 		if (!m_DepthTexture.IsNull())
 			m_Kinect->MakeDepthMap(m_DepthTexture);
 		if (!m_ColorTexture.IsNull())
 			m_Kinect->MakeColorMap(m_ColorTexture);
 	}
-	return BodyTracker::Eval(t);
+	return rc;
 }
 
-
 /*!
- * @fn bool KinectTracker::ComputeBoneAngles(Skeleton* target)
- * @param target	body poser target to update
+ * @fn bool KinectTracker::CaptureFrame(JointFrame& frame, bool wait)
+ * @param frame	joint frame to get the Kinect data
+ * @param wait	true to wait for new data from the Kinect
  *
- * Gathers joint rotations for the skeleton bones from the Kinect
- * and updates the pose of the target skeleton.
+ * Updates the Kinect state, then gathers the joint rotations and positions for all the users
+ * the Kinect has found. User tracking events generated by the Kinect
+ * are saved as user states in the frame. Only the tracker which
+ * owns the Kinect captures from it.
+ *
+ * @return true if frame was updated, else false
+ *
+ * @see BodyTracker::CaptureFrame
  */
-bool KinectTracker::ComputeBoneAngles(int userid)
-{
-	Scene*		scene = GetMainScene();
-	Camera*		cam = scene->GetCamera();
-	Box3		vvol(cam->GetViewVol());
-	Box3		kvv;
-	Matrix		mtx;
-	Quat		krot;
-	Vec3		kpos;
-	Vec3		campos = cam->GetTranslation();
-	bool		rotchanged[Skeleton::NUM_BONES];
-	bool		poschanged[Skeleton::NUM_BONES];
-	bool		changed = false;
-	Quat		(&rotations)[Skeleton::NUM_BONES] = m_Users[userid].Rotations;
-	Vec3		(&positions)[Skeleton::NUM_BONES] = m_Users[userid].Positions;
-
-	/*
-	 * Set rotations on the individual bones from the Kinect joint angles
-	 */
-	GetViewVolume(kvv);
-	for (int i = 0; i < KinectTracker::NUM_BONES; ++i)
-	{
-		XnSkeletonJoint jointindex = (XnSkeletonJoint) (i + 1);
-		int				boneindex = m_SensorBoneMap[i];
+bool KinectTracker::CaptureFrame(JointFrame& frame, bool wait)
+{
+	Quat	krot;
+	Vec3	kpos;
 
-		rotchanged[boneindex] = false;
-		poschanged[boneindex] = false;
-		if (m_Kinect->GetJointRotation(userid, jointindex, krot))
-		{
-			VX_TRACE(BodyTracker::Debug > 1, ("KinectTracker: Joint %d rot(%.3f, %.3f, %.3f, %.3f)", boneindex, krot.x, krot.y, krot.z, krot.w));
-			if (!m_BindPoseRelative)
-				krot *= m_KinectRest[boneindex];
-			/*
-			 * Sometimes OpenNI flips the legs backwards.
-			 * This code filters that out.
-			 */
-			if (m_Options & TRACK_FRONT_ONLY)
-				switch (i)
-				{
-					case KinectTracker::RIGHT_HIP:
-					case KinectTracker::RIGHT_KNEE:
-					case KinectTracker::LEFT_HIP:
-					case KinectTracker::LEFT_KNEE:
-					if (ZForward(krot) < 0.1f)		// Z axis flipped back?
-						continue;					// filter this out - bad data
-				}
-			rotations[boneindex] = krot;
-			changed = true;
-			rotchanged[boneindex] = true;
-		}
-		if (m_Kinect->GetJointPosition(userid, jointindex, kpos))
-		{
-//			VX_TRACE(BodyTracker::Debug > 1, ("KinectTracker: Joint %d pos(%.3f, %.3f, %.3f)", boneindex, kpos.x, kpos.y, kpos.z));
-			positions[boneindex] = kpos;
-			poschanged[boneindex] = true;
-		}
-	}
-	if (!changed)
+	if ((m_Kinect == NULL) || (m_Kinect->Owner != this) || !m_Kinect->IsStarted)
 		return false;
-	for (int i = 0; i < Skeleton::NUM_BONES; ++i)
+	if (!m_Kinect->Update(wait))
+		return false;
+	frame.Time = GetClock();
+	for (int u = 0; u < MAX_USERS; ++u)
 	{
-		Vec3	wpos;
+		JointFrame::User& user = frame.Users[u];
 
-		if (!poschanged[i])
+		user.State = m_Kinect->UserState[u];
+		user.RotMask = 0;
+		user.PosMask = 0;
+		if (user.State == USER_NONE)
 			continue;
-		kpos = positions[i];
-		wpos.x = kpos.x / kvv.Width();
-		wpos.y = kpos.y / kvv.Height();
-		wpos.z = (kpos.z - kvv.min.z) / kvv.Depth();
-		switch (i)
+		for (int i = 0; i < KinectTracker::NUM_BONES; ++i)
 		{
-			case Skeleton::RIGHT_WRIST:
-			case Skeleton::RIGHT_HAND:
-			case Skeleton::LEFT_WRIST:
-			case Skeleton::LEFT_HAND:
-			if ((m_Options & TRACK_HANDS) == 0)
-				continue;
-			VX_TRACE(BodyTracker::Debug > 1, ("KinectTracker: HAND kinect(%f, %f, %f) world(%f, %f, %f)", kpos.x, kpos.y, kpos.z, wpos.x, wpos.y, wpos.z));
-			if (m_UserID == userid)
-				OnUserMove(userid, i, wpos, rotations[i]);
-			break;
-
-			case Skeleton::TORSO:
-			if (wpos.z < 0.0f)
-				continue;
-			wpos.z *= vvol.Depth();
-			wpos.x *= vvol.Width() * wpos.z / vvol.min.z;
-			wpos.y *= vvol.Height() * wpos.z / vvol.min.z;
-			wpos.z = -wpos.z / 2.0f;
-			wpos.y = m_WaistOffset.y;
-			m_UserPos = wpos;
-			VX_TRACE(BodyTracker::Debug > 1, ("KinectTracker: TORSO kinect(%f, %f, %f) world(%f, %f, %f)", kpos.x, kpos.y, kpos.z, wpos.x, wpos.y, wpos.z));
-			m_Skeleton.SetPosition(wpos);
-			if ((m_Options & TRACK_TORSO) &&
-				(m_UserID == userid))
-				OnUserMove(userid, i, wpos, rotations[i]);
-			break;
+			XnSkeletonJoint jointindex = (XnSkeletonJoint) (i + 1);
+			int				boneindex = m_SensorBoneMap[i];
+
+			if (m_Kinect->GetJointRotation(u, jointindex, krot))
+			{
+				VX_TRACE(BodyTracker::Debug > 1, ("KinectTracker: Joint %d rot(%.3f, %.3f, %.3f, %.3f)", boneindex, krot.x, krot.y, krot.z, krot.w));
+				if (!m_BindPoseRelative)
+					krot *= m_KinectRest[boneindex];
+				user.Rotations[boneindex] = krot;
+				user.RotMask |= 1 << boneindex;
+			}
+			if (m_Kinect->GetJointPosition(u, jointindex, kpos))
+			{
+				user.Positions[boneindex] = kpos;
+				user.PosMask |= 1 << boneindex;
+			}
 		}
 	}
-	ApplyCurrentPose(userid, rotchanged);
+	return true;
+}
+
+/*!
+ * @fn bool KinectTracker::UpdateFrame()
+ *
+ * A Kinect tracker which shares its Kinect with another tracker
+ * uses the current joint frame of the tracker which owns the Kinect.
+ * The frame is copied under the owner's frame lock because the
+ * owner may be updating it on another thread.
+ *
+ * @return true if a new frame is available, else false
+ *
+ * @see BodyTracker::UpdateFrame
+ */
+bool KinectTracker::UpdateFrame()
+{
+	if (m_Kinect == NULL)
+		return false;
+	if (m_Kinect->Owner == this)
+		return BodyTracker::UpdateFrame();
+
+	JointFrame	frame;
+
+	m_Kinect->Owner->GetJointFrame(frame);
+	if (frame.Sequence == m_Frame.Sequence)
+		return false;
+	ApplyFrame(frame);
 	return true;
 }
 
@@ -508,6 +493,8 @@ Kinect::Kinect(KinectTracker* owner)
 	FOV(0.0f),
 	IsStarted(false)
 {
+	for (int u = 0; u < BodyTracker::MAX_USERS; ++u)
+		UserState[u] = BodyTracker::USER_NONE;
 }
 
 Kinect::~Kinect()
@@ -613,12 +600,33 @@ bool Kinect::Start()
 }
 
 /*
- * Called every frame to update Kinect state.
+ * Called from the capture thread to update Kinect state.
+ * The Kinect callbacks are called from here.
+ * The sensor data is only replaced while the data lock is held so the
+ * simulation thread can copy the depth and color maps under the same lock.
+ * The capture thread does not block in OpenNI waiting for new data,
+ * it returns false and polls again so the lock is never held while waiting.
  */
-void Kinect::Update()
+bool Kinect::Update(bool wait)
 {
-	if (IsStarted)
-		Context.WaitAndUpdateAll();
+	if (!IsStarted)
+		return false;
+	if (wait && !UserGenerator.IsNewDataAvailable())
+		return false;
+	Core::Lock	lock(DataLock);
+	Context.WaitNoneUpdateAll();
+	return true;
+}
+
+/*
+ * Save the tracking state of a user. The body tracker
+ * generates tracking events on the simulation thread
+ * when it sees the state change.
+ */
+void Kinect::SetUserState(XnUserID userid, int32 state)
+{
+	if (userid < BodyTracker::MAX_USERS)
+		UserState[userid] = state;
 }
 
 /*
@@ -632,11 +640,7 @@ void Kinect::NewUser(XnUserID userid)
 	else
 		UserGenerator.GetSkeletonCap().RequestCalibration(userid, TRUE);
 	LastUser = userid;
-	if (Owner)
-	{
-		Owner->OnNewUser(userid);
-		Owner->OnStartJointTrack(userid);
-	}
+	SetUserState(userid, BodyTracker::USER_TRACKING);
 }
 
 /*
@@ -645,9 +649,7 @@ void Kinect::NewUser(XnUserID userid)
 void Kinect::LostUser(XnUserID userid)
 {
 	VX_TRACE(BodyTracker::Debug, ("KinectTracker: Lost User %d", userid));
-
-	if (Owner)
-		Owner->OnStopJointTrack(userid);
+	SetUserState(userid, BodyTracker::USER_NONE);
 }
 
 /*
@@ -656,9 +658,7 @@ void Kinect::LostUser(XnUserID userid)
 void Kinect::ExitUser(XnUserID userid)
 {
 	VX_TRACE(BodyTracker::Debug, ("KinectTracker: stopped tracking user %d EXIT", userid));
-
-	if (Owner)
-		Owner->OnPauseJointTrack(userid);
+	SetUserState(userid, BodyTracker::USER_PAUSED);
 }
 
 /*
@@ -682,8 +682,7 @@ void  Kinect::CalibrationGood(xn::SkeletonCapability& capability, XnUserID nId)
 	VX_TRACE(BodyTracker::Debug, ("Calibration complete, start tracking user %d", nId));
 	UserGenerator.GetSkeletonCap().StartTracking(nId);
 	LastUser = nId;
-	if (Owner)
-		Owner->OnStartJointTrack(nId);
+	SetUserState(nId, BodyTracker::USER_TRACKING);
 }
 
 /*
@@ -693,8 +692,7 @@ void  Kinect::EnterUser(XnUserID nId)
 {
 	// Calibration succeeded
 	VX_TRACE(BodyTracker::Debug, ("start tracking user %d ENTER", nId));
-	if (Owner)
-		Owner->OnStartJointTrack(nId);
+	SetUserState(nId, BodyTracker::USER_TRACKING);
 	LastUser = nId;
 }
 
@@ -12,9 +12,118 @@ static const TCHAR* opnames[] = {
 };
 
 const TCHAR** BodyTracker::DoNames = opnames;
+bool BodyTracker::UseCaptureThread = true;
 
 VX_IMPLEMENT_CLASS(BodyTracker, Engine);
 
+#ifndef VX_NOTHREAD
+/*
+ * Thread which polls the sensor of a body tracker and publishes
+ * joint frames to the simulation thread.
+ */
+class BodyCaptureThread : public Core::Thread
+{
+public:
+	BodyCaptureThread(BodyTracker* owner) : Core::Thread(0), Owner(owner), DoExit(0) { }
+
+	static Core::ThreadFunc	CaptureFunc;
+
+	BodyTracker*	Owner;		// body tracker to capture for
+	vint32			DoExit;		// set to make thread exit
+};
+
+#if defined(_WIN32) && !defined(VX_PTHREAD)
+void BodyCaptureThread::CaptureFunc(void* arg)
+#else
+void* BodyCaptureThread::CaptureFunc(void* arg)
+#endif
+{
+	VX_ASSERT(arg);
+	BodyCaptureThread&	thread = *((BodyCaptureThread*) arg);
+	BodyTracker*		owner = thread.Owner;
+
+	VX_TRACE(BodyTracker::Debug, ("BodyTracker capture thread started"));
+	while (!thread.DoExit)
+	{
+		BodyTracker::JointFrame& frame = owner->m_Joints.GetBack();
+
+		if (!owner->CaptureFrame(frame, true))	// no data from sensor?
+		{
+			BodyTracker::SleepFor(5);
+			continue;
+		}
+		frame.Sequence = ++(owner->m_Sequence);
+		owner->RecordFrame(frame);
+		owner->m_Joints.Publish();
+	}
+	VX_TRACE(BodyTracker::Debug, ("BodyTracker capture thread exited"));
+	thread.Stop();
+#if !defined(_WIN32) || defined(VX_PTHREAD)
+	return NULL;
+#endif
+}
+#endif
+
+/*!
+ * @fn void BodyTracker::JointFrame::Empty()
+ *
+ * Marks all the users in the frame as not present.
+ */
+void BodyTracker::JointFrame::Empty()
+{
+	Time = 0;
+	Sequence = 0;
+	for (int u = 0; u < MAX_USERS; ++u)
+	{
+		Users[u].State = USER_NONE;
+		Users[u].RotMask = 0;
+		Users[u].PosMask = 0;
+	}
+}
+
+BodyTracker::JointBuffer::JointBuffer()
+:	m_Back(0), m_Middle(1), m_Front(2)
+{
+	m_Frames[0].Empty();
+	m_Frames[1].Empty();
+	m_Frames[2].Empty();
+}
+
+/*
+ * Called by the producer when the back frame is complete.
+ * The back frame becomes the middle frame and is marked fresh.
+ * The producer gets the old middle frame to write next.
+ */
+void BodyTracker::JointBuffer::Publish()
+{
+	int32	old;
+
+	do
+		old = m_Middle;
+	while (!Core::InterlockTestSet(&m_Middle, m_Back | FRESH, old));
+	m_Back = old & ~FRESH;
+}
+
+/*
+ * Called by the consumer to get the newest frame. If the middle frame
+ * is fresh, it is exchanged with the front frame.
+ * @return true if a new front frame was acquired, false if nothing new
+ */
+bool BodyTracker::JointBuffer::Acquire()
+{
+	int32	old;
+
+	do
+	{
+		old = m_Middle;
+		if ((old & FRESH) == 0)
+			return false;
+	}
+	while (!Core::InterlockTestSet(&m_Middle, m_Front, old));
+	m_Front = old & ~FRESH;
+	return true;
+}
+
 
 /*!
  * @fn BodyTracker::BodyTracker()
@@ -28,6 +137,10 @@ BodyTracker::BodyTracker()
 	m_BindPoseRelative(true)
 {
 	m_Skeleton.SetName(TEXT("bodytracker.skeleton"));
+	m_Sequence = 0;
+	m_CaptureThread = NULL;
+	m_RecordFile = NULL;
+	m_Frame.Empty();
 	Init();
 	m_PoseMapper = new PoseMapper();
 	m_PoseMapper->SetName(TEXT("bodytracker.default.posemapper"));
@@ -52,6 +165,9 @@ BodyTracker::~BodyTracker()
 {
 	Texture* tex = m_ColorTexture;
 	Bitmap* bmap;
+
+	StopCapture();
+	StopRecording();
 	if (tex)
 	{
 		bmap = tex->GetBitmap();
@@ -167,13 +283,276 @@ void BodyTracker::SetOptions(int opts)
 }
 
 
+/*!
+ * @fn bool BodyTracker::StartCapture()
+ *
+ * Starts a thread which captures input from the sensor continuously
+ * by calling BodyTracker::CaptureFrame. The newest frame captured is
+ * consumed by the simulation thread each time the tracker is evaluated.
+ * The capture thread is started automatically when the engine is started
+ * if BodyTracker::UseCaptureThread is set.
+ *
+ * @return true if capture thread is running, else false
+ *
+ * @see BodyTracker::StopCapture BodyTracker::CaptureFrame
+ */
+bool BodyTracker::StartCapture()
+{
+#ifdef VX_NOTHREAD
+	return false;
+#else
+	if (m_CaptureThread)
+		return true;
+	m_CaptureThread = new BodyCaptureThread(this);
+	m_CaptureThread->Run(&BodyCaptureThread::CaptureFunc);
+	if (m_CaptureThread->IsRunning())
+		return true;
+	delete m_CaptureThread;
+	m_CaptureThread = NULL;
+	VX_ERROR(("BodyTracker: ERROR cannot start capture thread"), false);
+#endif
+}
+
+/*!
+ * @fn void BodyTracker::StopCapture()
+ *
+ * Stops the capture thread and waits for it to exit.
+ * Subsequent evaluations poll the sensor without waiting.
+ * Subclasses must call this in their destructor before
+ * releasing sensor resources.
+ *
+ * @see BodyTracker::StartCapture
+ */
+void BodyTracker::StopCapture()
+{
+#ifndef VX_NOTHREAD
+	BodyCaptureThread* thread = m_CaptureThread;
+
+	if (thread == NULL)
+		return;
+	Core::InterlockSet(&(thread->DoExit), 1);
+	if (thread->IsRunning())
+		thread->GetDoneEvent()->Wait();
+	m_CaptureThread = NULL;
+	delete thread;
+#endif
+}
+
+/*!
+ * @fn bool BodyTracker::StartRecording(const TCHAR* filename)
+ * @param filename	name of joint log file to write
+ *
+ * Records every joint frame captured to a file which can be
+ * played back by a ReplayTracker. The file begins with the view volume,
+ * field of view and image size of the sensor followed by the joint
+ * frames with the time they were captured.
+ *
+ * @return true if file was opened, else false
+ *
+ * @see BodyTracker::StopRecording ReplayTracker
+ */
+bool BodyTracker::StartRecording(const TCHAR* filename)
+{
+	Core::Lock	lock(m_RecordLock);
+	int32		header[4] = { BODYTRACK_LogMagic, BODYTRACK_LogVersion, Skeleton::NUM_BONES, MAX_USERS };
+	float		info[9];
+	Box3		vvol;
+	Vec2		size(GetImageSize());
+	FILE*		fp;
+
+	if (m_RecordFile)
+	{
+		fclose(m_RecordFile);
+		m_RecordFile = NULL;
+	}
+	fp = FOPEN(filename, TEXT("wb"));
+	if (fp == NULL)
+		VX_ERROR(("BodyTracker: ERROR cannot open joint log %s for writing", filename), false);
+	if (!GetViewVolume(vvol))
+		vvol.Empty();
+	info[0] = vvol.min.x; info[1] = vvol.min.y; info[2] = vvol.min.z;
+	info[3] = vvol.max.x; info[4] = vvol.max.y; info[5] = vvol.max.z;
+	info[6] = GetFOV();
+	info[7] = size.x;
+	info[8] = size.y;
+	fwrite(header, sizeof(int32), 4, fp);
+	fwrite(info, sizeof(float), 9, fp);
+	m_RecordFile = fp;
+	return true;
+}
+
+void BodyTracker::StopRecording()
+{
+	Core::Lock lock(m_RecordLock);
+
+	if (m_RecordFile)
+	{
+		fclose(m_RecordFile);
+		m_RecordFile = NULL;
+	}
+}
+
 /*
- * Updates the color and depth map textures from the Kinect cameras.
- * If a Skeleton is our target or a child, we update the joint angles
- * for the user associated with it.
+ * Writes a joint frame to the recording file.
+ * Only users which are present are saved.
+ * Called from the capture thread.
+ */
+void BodyTracker::RecordFrame(const JointFrame& frame)
+{
+	Core::Lock	lock(m_RecordLock);
+	FILE*		fp = m_RecordFile;
+	int32		n = 0;
+
+	if (fp == NULL)
+		return;
+	for (int u = 0; u < MAX_USERS; ++u)
+		if (frame.Users[u].State != USER_NONE)
+			++n;
+	fwrite(&frame.Time, sizeof(double), 1, fp);
+	fwrite(&n, sizeof(int32), 1, fp);
+	for (int32 u = 0; u < MAX_USERS; ++u)
+	{
+		const JointFrame::User& user = frame.Users[u];
+		int32	state[4] = { u, user.State, int32(user.RotMask), int32(user.PosMask) };
+		float	data[Skeleton::NUM_BONES * 7];
+		float*	p = data;
+
+		if (user.State == USER_NONE)
+			continue;
+		for (int i = 0; i < Skeleton::NUM_BONES; ++i)
+		{
+			const Quat& q = user.Rotations[i];
+			const Vec3& v = user.Positions[i];
+
+			*p++ = q.x; *p++ = q.y; *p++ = q.z; *p++ = q.w;
+			*p++ = v.x; *p++ = v.y; *p++ = v.z;
+		}
+		fwrite(state, sizeof(int32), 4, fp);
+		fwrite(data, sizeof(float), Skeleton::NUM_BONES * 7, fp);
+	}
+}
+
+/*!
+ * @fn bool BodyTracker::CaptureFrame(JointFrame& frame, bool wait)
+ * @param frame	joint frame to get the sensor data
+ * @param wait	true to wait for new data, false to return immediately
+ *
+ * Reads the state of each user and the positions and rotations
+ * of their joints from the sensor. This function is called
+ * repeatedly on the capture thread with \b wait set so it may block
+ * until the sensor has new data. If the capture thread is not running,
+ * it is called on the simulation thread with \b wait clear and must not block.
+ * The function should not touch the scene graph or generate events.
+ *
+ * The default implementation does nothing and returns false.
+ * Subclasses are expected to override this function for a specific sensor.
+ *
+ * @return true if frame was updated with new data, else false
+ *
+ * @see BodyTracker::StartCapture KinectTracker ReplayTracker
+ */
+bool BodyTracker::CaptureFrame(JointFrame& frame, bool wait)
+{
+	return false;
+}
+
+/*!
+ * @fn bool BodyTracker::UpdateFrame()
+ *
+ * Makes the newest joint frame from the sensor current.
+ * If the capture thread is not running, the sensor is polled directly.
+ * Frames captured since the last call are skipped.
+ *
+ * @return true if a new frame is available, else false
+ *
+ * @see BodyTracker::ApplyFrame BodyTracker::CaptureFrame
+ */
+bool BodyTracker::UpdateFrame()
+{
+	if (m_CaptureThread == NULL)
+	{
+		JointFrame& back = m_Joints.GetBack();
+
+		if (!CaptureFrame(back, false))
+			return false;
+		back.Sequence = ++m_Sequence;
+		RecordFrame(back);
+		m_Joints.Publish();
+	}
+	if (!m_Joints.Acquire())
+		return false;
+	ApplyFrame(m_Joints.GetFront());
+	return true;
+}
+
+/*!
+ * @fn void BodyTracker::ApplyFrame(const JointFrame& frame)
+ * @param frame	new joint frame
+ *
+ * Compares the state of each user in the new frame with the current
+ * frame and calls the tracking callbacks for the users which have changed.
+ * The new frame becomes the current frame used by BodyTracker::ComputeBoneAngles.
+ *
+ * @see BodyTracker::OnNewUser BodyTracker::OnStartJointTrack
+ *		BodyTracker::OnPauseJointTrack BodyTracker::OnStopJointTrack
+ */
+void BodyTracker::ApplyFrame(const JointFrame& frame)
+{
+	for (int u = 1; u < MAX_USERS; ++u)
+	{
+		int32	state = frame.Users[u].State;
+		int32	prev = m_Frame.Users[u].State;
+
+		if (state == prev)
+			continue;
+		if (prev == USER_NONE)
+			OnNewUser(u);
+		switch (state)
+		{
+			case USER_TRACKING:
+			OnStartJointTrack(u);
+			break;
+
+			case USER_PAUSED:
+			if (prev == USER_TRACKING)
+				OnPauseJointTrack(u);
+			break;
+
+			case USER_NONE:
+			OnStopJointTrack(u);
+			break;
+		}
+	}
+	Core::Lock	lock(m_FrameLock);
+	m_Frame = frame;
+}
+
+/*!
+ * @fn void BodyTracker::GetJointFrame(JointFrame& frame) const
+ * @param frame	gets a copy of the current joint frame
+ *
+ * Copies the joint frame the tracker is currently using.
+ * Other trackers sharing the same sensor call this from their own
+ * simulation threads so the copy is made under the frame lock
+ * which BodyTracker::ApplyFrame holds while it replaces the frame.
+ *
+ * @see BodyTracker::ApplyFrame
+ */
+void BodyTracker::GetJointFrame(JointFrame& frame) const
+{
+	Core::Lock	lock(m_FrameLock);
+
+	frame = m_Frame;
+}
+
+/*
+ * Updates the joint angles of the skeleton from the newest
+ * frame captured from the sensor for the user being tracked.
+ * If no user is tracked, the closest user facing the sensor is chosen.
  */
 bool BodyTracker::Eval(float t)
 {
+	UpdateFrame();
 	if (m_UserID != 0)
 	{
 		Sphere s;
@@ -199,17 +578,20 @@ bool BodyTracker::Eval(float t)
 	}
 	float	mindist = 100000.0f;
 	int		userid = 0;
-	for (int i = 0; i < MAX_USERS; ++i)
+	for (int i = 1; i < MAX_USERS; ++i)
 	{
+		const JointFrame::User& joints = m_Frame.Users[i];
 		float dist;
 
 		if (m_Users[i].UserID == 0)
 			continue;
-		if (!ComputeBoneAngles(i))
+		if ((joints.RotMask & (1 << Skeleton::TORSO)) == 0)
 			continue;
-		if (!m_Users[i].FacingSensor)
+		if (ZForward(joints.Rotations[Skeleton::TORSO]) < 0.5f)
+			continue;						// not facing sensor
+		if ((joints.PosMask & 1) == 0)
 			continue;
-		dist = m_Users[i].Positions[0].Length();
+		dist = joints.Positions[0].Length();
 		if (dist < mindist)
 		{
 			mindist = dist;
@@ -221,6 +603,46 @@ bool BodyTracker::Eval(float t)
 	return true;
 }
 
+/*
+ * Starts the capture thread when the engine starts.
+ */
+bool BodyTracker::OnStart()
+{
+	if (UseCaptureThread)
+		StartCapture();
+	return Engine::OnStart();
+}
+
+/*
+ * Stops the capture thread when the engine stops.
+ */
+bool BodyTracker::OnStop()
+{
+	StopCapture();
+	return Engine::OnStop();
+}
+
+/*
+ * Returns the monotonic time in seconds
+ * used to time stamp joint frames.
+ */
+double BodyTracker::GetClock()
+{
+	return double(Core::Profiler::GetTicks()) / Core::Profiler::GetTickRate();
+}
+
+/*
+ * Suspends the calling thread for the given number of milliseconds.
+ */
+void BodyTracker::SleepFor(int ms)
+{
+#ifdef _WIN32
+	::Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif
+}
+
 void BodyTracker::ApplyCurrentPose(int userid, bool changed[Skeleton::NUM_BONES])
 {
 	Skeleton*	skeleton = (Skeleton*) GetSkeleton();
@@ -262,18 +684,113 @@ void BodyTracker::ApplyCurrentPose(int userid, bool changed[Skeleton::NUM_BONES]
  * @fn bool BodyTracker::ComputeBoneAngles(int userid)
  * @param userid	user ID of the user to drive the skeleton
  *
- * Gathers joint rotations from the sensor and updates the
- * internal skeleton. The default implementation returns false
- * and does nothing. Subclasses are expected to override this
- * function and provide an implementation which queries the sensor.
+ * Updates the internal skeleton from the joint rotations and positions
+ * for this user in the current joint frame. Sensor positions are mapped
+ * into the view volume of the camera using the sensor view volume.
+ * Subclasses may override this function to handle sensor-specific data.
  *
  * @return true if bone angles for this user changed, else false
  *
- * @see KinectTracker::ComputeBonenalges
+ * @see BodyTracker::CaptureFrame BodyTracker::GetViewVolume
  */
 bool BodyTracker::ComputeBoneAngles(int userid)
 {
-	return false;
+	Scene*		scene = GetMainScene();
+	Camera*		cam = scene->GetCamera();
+	Box3		vvol(cam->GetViewVol());
+	Box3		kvv;
+	Vec3		kpos;
+	bool		rotchanged[Skeleton::NUM_BONES];
+	bool		poschanged[Skeleton::NUM_BONES];
+	bool		changed = false;
+	Quat		(&rotations)[Skeleton::NUM_BONES] = m_Users[userid].Rotations;
+	Vec3		(&positions)[Skeleton::NUM_BONES] = m_Users[userid].Positions;
+	const JointFrame::User& joints = m_Frame.Users[userid];
+
+	VX_ASSERT((userid >= 0) && (userid < MAX_USERS));
+	if ((joints.State == USER_NONE) || (joints.RotMask == 0))
+		return false;
+	/*
+	 * Set rotations on the individual bones from the sensor joint angles
+	 */
+	GetViewVolume(kvv);
+	for (int i = 0; i < Skeleton::NUM_BONES; ++i)
+	{
+		uint32	bit = 1 << i;
+
+		rotchanged[i] = false;
+		poschanged[i] = false;
+		if (joints.RotMask & bit)
+		{
+			const Quat& krot = joints.Rotations[i];
+			/*
+			 * Sometimes the sensor flips the legs backwards.
+			 * This code filters that out.
+			 */
+			if (m_Options & TRACK_FRONT_ONLY)
+				switch (i)
+				{
+					case Skeleton::RIGHT_HIP:
+					case Skeleton::RIGHT_KNEE:
+					case Skeleton::LEFT_HIP:
+					case Skeleton::LEFT_KNEE:
+					if (ZForward(krot) < 0.1f)		// Z axis flipped back?
+						continue;					// filter this out - bad data
+				}
+			rotations[i] = krot;
+			changed = true;
+			rotchanged[i] = true;
+		}
+		if (joints.PosMask & bit)
+		{
+			positions[i] = joints.Positions[i];
+			poschanged[i] = true;
+		}
+	}
+	if (!changed)
+		return false;
+	for (int i = 0; i < Skeleton::NUM_BONES; ++i)
+	{
+		Vec3	wpos;
+
+		if (!poschanged[i])
+			continue;
+		kpos = positions[i];
+		wpos.x = kpos.x / kvv.Width();
+		wpos.y = kpos.y / kvv.Height();
+		wpos.z = (kpos.z - kvv.min.z) / kvv.Depth();
+		switch (i)
+		{
+			case Skeleton::RIGHT_WRIST:
+			case Skeleton::RIGHT_HAND:
+			case Skeleton::LEFT_WRIST:
+			case Skeleton::LEFT_HAND:
+			if ((m_Options & TRACK_HANDS) == 0)
+				continue;
+			VX_TRACE(BodyTracker::Debug > 1, ("BodyTracker: HAND sensor(%f, %f, %f) world(%f, %f, %f)", kpos.x, kpos.y, kpos.z, wpos.x, wpos.y, wpos.z));
+			if (m_UserID == userid)
+				OnUserMove(userid, i, wpos, rotations[i]);
+			break;
+
+			case Skeleton::TORSO:
+			if (wpos.z < 0.0f)
+				continue;
+			wpos.z *= vvol.Depth();
+			wpos.x *= vvol.Width() * wpos.z / vvol.min.z;
+			wpos.y *= vvol.Height() * wpos.z / vvol.min.z;
+			wpos.z = -wpos.z / 2.0f;
+			wpos.y = m_WaistOffset.y;
+			m_UserPos = wpos;
+			VX_TRACE(BodyTracker::Debug > 1, ("BodyTracker: TORSO sensor(%f, %f, %f) world(%f, %f, %f)", kpos.x, kpos.y, kpos.z, wpos.x, wpos.y, wpos.z));
+			m_Skeleton.SetPosition(wpos);
+			if ((m_Options & TRACK_TORSO) &&
+				(m_UserID == userid))
+				OnUserMove(userid, i, wpos, rotations[i]);
+			break;
+		}
+	}
+	ApplyCurrentPose(userid, rotchanged);
+	return true;
 }
 
 
@@ -0,0 +1,213 @@
+#include "vixen.h"
+#include "body/vxbodytrack.h"
+#include "body/vxreplaytrack.h"
+
+
+namespace Vixen {
+
+VX_IMPLEMENT_CLASS(ReplayTracker, BodyTracker);
+
+/*!
+ * @fn ReplayTracker::ReplayTracker(const TCHAR* filename)
+ * @param filename	name of joint log file to play back
+ *
+ * Constructs a body tracker which plays back a joint log
+ * recorded with BodyTracker::StartRecording.
+ */
+ReplayTracker::ReplayTracker(const TCHAR* filename)
+:	BodyTracker(),
+	m_File(NULL),
+	m_DataStart(0),
+	m_ImageSize(640, 480),
+	m_FOV(1.4f),
+	m_Loop(false),
+	m_Ended(false),
+	m_HasNext(false),
+	m_PlaySpeed(1.0f),
+	m_LogStart(0),
+	m_ClockStart(0)
+{
+	m_ViewVol.Empty();
+	m_Next.Empty();
+	if (filename)
+		Configure(filename);
+}
+
+ReplayTracker::~ReplayTracker()
+{
+	StopCapture();
+	Close();
+}
+
+void ReplayTracker::Close()
+{
+	if (m_File)
+	{
+		fclose(m_File);
+		m_File = NULL;
+	}
+	m_HasNext = false;
+}
+
+/*!
+ * @fn bool ReplayTracker::Configure(const TCHAR* filename)
+ * @param filename	name of joint log file to play back
+ *
+ * Opens the joint log and reads the sensor information from its header.
+ * Playback starts from the beginning of the log. This should not be
+ * called while the capture thread is running.
+ *
+ * @return true if the log was opened, else false
+ */
+bool ReplayTracker::Configure(const TCHAR* filename)
+{
+	int32	header[4];
+	float	info[9];
+	FILE*	fp;
+
+	Close();
+	if ((filename == NULL) || (*filename == 0))
+		return false;
+	fp = FOPEN(filename, TEXT("rb"));
+	if (fp == NULL)
+		VX_ERROR(("ReplayTracker: ERROR cannot open joint log %s", filename), false);
+	if ((fread(header, sizeof(int32), 4, fp) != 4) ||
+		(header[0] != BODYTRACK_LogMagic) ||
+		(header[1] != BODYTRACK_LogVersion) ||
+		(header[2] != Skeleton::NUM_BONES) ||
+		(header[3] != MAX_USERS) ||
+		(fread(info, sizeof(float), 9, fp) != 9))
+	{
+		fclose(fp);
+		VX_ERROR(("ReplayTracker: ERROR %s is not a joint log", filename), false);
+	}
+	m_ViewVol.Set(info[0], info[1], info[2], info[3], info[4], info[5]);
+	m_FOV = info[6];
+	m_ImageSize.Set(info[7], info[8]);
+	m_File = fp;
+	m_DataStart = ftell(fp);
+	m_Ended = false;
+	VX_TRACE(BodyTracker::Debug, ("ReplayTracker: playing %s", filename));
+	return BodyTracker::Configure(filename);
+}
+
+Vec2 ReplayTracker::GetImageSize() const
+{
+	return m_ImageSize;
+}
+
+bool ReplayTracker::GetViewVolume(Box3& vvol)
+{
+	if (m_ViewVol.IsEmpty())
+		return false;
+	vvol = m_ViewVol;
+	return true;
+}
+
+/*
+ * Reads the next joint frame from the log.
+ * Users not in the log frame are not present.
+ * @return true if frame was read, false at end of file
+ */
+bool ReplayTracker::ReadFrame(JointFrame& frame)
+{
+	int32	n;
+	double	t;
+
+	if ((fread(&t, sizeof(double), 1, m_File) != 1) ||
+		(fread(&n, sizeof(int32), 1, m_File) != 1) ||
+		(n < 0) || (n > MAX_USERS))
+		return false;
+	for (int u = 0; u < MAX_USERS; ++u)
+	{
+		frame.Users[u].State = USER_NONE;
+		frame.Users[u].RotMask = 0;
+		frame.Users[u].PosMask = 0;
+	}
+	frame.Time = t;
+	while (--n >= 0)
+	{
+		int32	state[4];
+		float	data[Skeleton::NUM_BONES * 7];
+		float*	p = data;
+
+		if ((fread(state, sizeof(int32), 4, m_File) != 4) ||
+			(fread(data, sizeof(float), Skeleton::NUM_BONES * 7, m_File) != Skeleton::NUM_BONES * 7) ||
+			(state[0] < 0) || (state[0] >= MAX_USERS))
+			return false;
+
+		JointFrame::User& user = frame.Users[state[0]];
+
+		user.State = state[1];
+		user.RotMask = uint32(state[2]);
+		user.PosMask = uint32(state[3]);
+		for (int i = 0; i < Skeleton::NUM_BONES; ++i, p += 7)
+		{
+			user.Rotations[i].Set(p[0], p[1], p[2], p[3]);
+			user.Positions[i].Set(p[4], p[5], p[6]);
+		}
+	}
+	return true;
+}
+
+/*!
+ * @fn bool ReplayTracker::CaptureFrame(JointFrame& frame, bool wait)
+ * @param frame	joint frame to get the next frame from the log
+ * @param wait	true to wait until it is time to play the next frame
+ *
+ * Gets the next frame from the joint log when it is due. Frames are
+ * played at the time they were recorded relative to the first frame,
+ * scaled by the playback speed. At the end of the log, playback restarts
+ * if looping is enabled. Otherwise a final frame with no users is produced
+ * so the tracker stops tracking.
+ *
+ * @return true if frame was updated, else false
+ *
+ * @see ReplayTracker::SetPlaySpeed ReplayTracker::SetLoop
+ */
+bool ReplayTracker::CaptureFrame(JointFrame& frame, bool wait)
+{
+	double	due;
+
+	if ((m_File == NULL) || m_Ended)
+		return false;
+	if (!m_HasNext)
+	{
+		if (!ReadFrame(m_Next))				// end of log?
+		{
+			if (m_Loop && (ftell(m_File) > m_DataStart))
+			{
+				fseek(m_File, m_DataStart, SEEK_SET);
+				m_ClockStart = 0;
+				return false;
+			}
+			VX_TRACE(BodyTracker::Debug, ("ReplayTracker: end of joint log"));
+			m_Ended = true;
+			frame.Empty();
+			frame.Time = GetClock();
+			return true;
+		}
+		m_HasNext = true;
+		if (m_ClockStart == 0)				// first frame played?
+		{
+			m_ClockStart = GetClock();
+			m_LogStart = m_Next.Time;
+		}
+	}
+	if (m_PlaySpeed > 0)
+	{
+		due = m_ClockStart + (m_Next.Time - m_LogStart) / m_PlaySpeed;
+		for (double now = GetClock(); now < due; now = GetClock())
+		{
+			if (!wait)
+				return false;
+			SleepFor(int((due - now) * 1000.0) + 1);
+		}
+	}
+	frame = m_Next;
+	frame.Time = GetClock();
+	m_HasNext = false;
+	return true;
+}
+
+}	// end Vixen
@@ -4,12 +4,12 @@ namespace Vixen {
 	
 template <> inline bool Core::Dict<NameProp, Core::String, Vixen::BaseDict>::CompareKeys(const NameProp& knew, const NameProp& kdict)
 {
-	return String(knew).CompareNoCase(kdict) == 0;
+	return knew.IsSame(kdict);
 }
 
 template <> inline uint32 Core::Dict<NameProp, Core::String, Vixen::BaseDict>::HashKey(const NameProp& np) const
 {
-	return HashStr((const TCHAR*) np);
+	return np.GetHash();
 }
 
 int		DXLight::NumLights = 0;
@@ -25,8 +25,7 @@ intptr DXRenderer::AddLight(Light* light)
 	VX_ASSERT(prop);
 	light->AddRef();
 	prop->DevIndex = m_LightList.Attach(light, prop);
-	if ((prop->DevIndex < 0) ||
-		(prop->DevIndex >= MaxLights))
+	if (prop->DevIndex < 0)
 		VX_ERROR(("DXRenderer::AddLight ERROR cannot add light #%d\n", prop->DevIndex), -1);
 	VX_ASSERT(prop);
 	if (prop->DevIndex == LIGHT_NoDevice)
@@ -52,7 +51,7 @@ int DXRenderer::LoadLights()
 		if (nbytes == 0)
 			return 0;
 	}
-	if (!listchanged && !m_LightList.LightsChanged())
+	if (!listchanged && !m_LightList.GetNumChanged())
 		return nlights;
 	/*
 	 * Allocate a temporary buffer to hold all of the light data
@@ -73,7 +72,9 @@ int DXRenderer::LoadLights()
 
 /*
  * Generate the pixel shader source for each light
- * and determine the total size of the light constant buffer
+ * and determine the total size of the light constant buffer.
+ * Each light declared is assigned its index in the
+ * shader LightList array (DXLight::ShaderSlot).
  */
 int	DXLight::LoadLights(LightList& lights, Core::String& source)
 {
@@ -92,6 +93,7 @@ int	DXLight::LoadLights(LightList& lights, Core::String& source)
 		DXShader*		tmp = DXShader::Find(shadername);
 		const TCHAR*	source;
 
+		l->ShaderSlot = -1;
 		if (tmp == NULL)
 			continue;
 		source = tmp->SceneShader->GetSource();
@@ -103,7 +105,7 @@ int	DXLight::LoadLights(LightList& lights, Core::String& source)
 		decls += TEXT("\tlight");
 		decls += Core::String(nlights);
 		decls += TEXT(";\n");
-		++nlights;
+		l->ShaderSlot = nlights++;
 		nbytes += l->GetByteSize();
 	}
 	NumLights = nlights;
@@ -129,7 +131,6 @@ int	DXLight::LoadLights(LightList& lights, Core::String& source)
 			source += *stringentry;
 	}
 	nbytes = (nbytes + 0X0F) & ~0X0F;	// multiple of 16 bytes
-	VX_ASSERT(nlights < LIGHT_MaxLights);
 
 	decls += TEXT("};\n\n");
 	source = source + decls;
@@ -149,6 +150,8 @@ void DXLight::UpdateBuffer(LightList& lights, void* buffer)
 
 	while (l = (DXLight*) iter.NextProp(enabled))
 	{
+		if (l->ShaderSlot < 0)			// not declared in the shader
+			continue;
 		l->VectorOffset = vectorofs;
 		vectorofs += l->GetByteSize() / sizeof(float);
 		memcpy(p, l->GetData(), l->GetByteSize());
@@ -162,6 +165,7 @@ DXLight& DXLight::operator=(const GPULight& src)
 	DXLight& dxsrc = (DXLight&) src;
 	if (dxsrc.LightClassInstance)
 		LightClassInstance = dxsrc.LightClassInstance;
+	ShaderSlot = dxsrc.ShaderSlot;
 	return *this;
 }
 
@@ -8,13 +8,20 @@ struct	PerFrameConstants
 	float	ProjMatrix[16];
 	Vec4	CameraPos;
 	int32	NumLights;
-	int32	LightsEnabled;
+	int32	Pad;				// keeps the layout of compiled shaders
 	Vec2	ImageSize;
 };
 
+/*
+ * The lights which illuminate an object are passed as indices
+ * into the LightList array of the pixel shader, four per register
+ */
 struct PerObjectConstants
 {
 	float	WorldMatrix[16];
+	uint32	LightCount;
+	uint32	LightPad[3];
+	uint32	LightIndex[LIGHT_MaxLights];
 };
 
 DXGI_FORMAT	DXRenderer::FontFormat = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
@@ -68,6 +75,7 @@ DXRenderer::DXRenderer()
 	m_ConstantBuffers[CBUF_PERFRAME]->SetName(TEXT("PerFrame"));
 	m_ConstantBuffers[CBUF_PEROBJECT] = new DeviceBuffer(TEXT("float16 WorldMatrix"), sizeof(PerObjectConstants));
 	m_ConstantBuffers[CBUF_PEROBJECT]->SetName(TEXT("PerObject"));
+	m_WorldMatrixSlot = m_ConstantBuffers[CBUF_PEROBJECT]->GetHandle(TEXT("WorldMatrix"));
 	m_ConstantBuffers[CBUF_MATERIAL] = new DeviceBuffer(TEXT("float4 Diffuse, float4 Ambient, float4 Specular, float4 Emission,	float Shine, int HasNormalMap, int HasDiffuseMap"), sizeof(PhongMaterial::ShaderConstants));
 	m_ConstantBuffers[CBUF_MATERIAL]->SetName(TEXT("PhongMaterial"));
 	m_ConstantBuffers[CBUF_LIGHT] = NULL;
@@ -342,7 +350,6 @@ void DXRenderer::Begin(int changed, int frame)
 	memcpy(cdata->ProjMatrix, proj.GetMatrix(), 16 * sizeof(float));
 	memcpy(cdata->ViewMatrix, view.GetMatrix(), 16 * sizeof(float));
 	cdata->CameraPos = cam->GetCenter();
-	cdata->LightsEnabled = m_LightList.LightsEnabled() & m_LightList.LightsActive();
 	cdata->NumLights = LoadLights();
 	constbuf->SetChanged(true);
 	CurrentAppear = NULL;
@@ -375,6 +382,37 @@ void DXRenderer::RenderState(int32 stateindex)
 	GeoSorter::RenderState(stateindex);
 }
 
+/*
+ * Get the shader indices of the lights enabled by LightList::LightsOn
+ * for the per object constants and return how many there are.
+ * If all the lights are on, the first LIGHT_MaxLights enabled lights are used.
+ */
+int DXRenderer::LoadObjectLights(uint32* lightindex)
+{
+	const uint16*	ids;
+	int				n = m_LightList.GetLightsOn(&ids);
+	uint32			count = 0;
+	DXLight*		l;
+
+	if (n < 0)
+	{
+		LightList::Iter	iter(m_LightList);
+		bool			enabled;
+
+		while ((count < LIGHT_MaxLights) && (l = (DXLight*) iter.NextProp(enabled)))
+			if (enabled && (l->ShaderSlot >= 0))
+				lightindex[count++] = l->ShaderSlot;
+	}
+	else
+		for (int i = 0; i < n; ++i)
+		{
+			l = (DXLight*) m_LightList.GetLight(ids[i]);
+			if (l && (l->ShaderSlot >= 0))
+				lightindex[count++] = l->ShaderSlot;
+		}
+	return count;
+}
+
 /*
  * Render a mesh with a given appearance and transformation matrix.
  * @param geo	TriMesh to render. Only triangle meshes are supported currently.
@@ -446,15 +484,20 @@ void	DXRenderer::RenderMesh(const Geometry* geo, const Appearance* app, const Ma
 	if (inds)
 	{
 		DXIndexBuf& ibuf = (DXIndexBuf&) geo->DevHandle;
-		if (!ibuf.HasBuffer())
+		int			idxsize = mesh->GetIndexSize();
+
+		if (!ibuf.HasBuffer() || (idxsize == 0))
 		{
-			ibuf.Update(this, inds, 0);
+			idxsize = ibuf.Update(this, inds, 0);	// decides 16 or 32 bit indices
+			mesh->SetIndexSize(idxsize);
 			inds->SetChanged(false);
 		}
 		nidx = inds->GetSize();
 		dxbuf = *ibuf;
+		if (idxsize == 0)
+			VX_ERROR_RETURN(("DXRenderer::RenderMesh: ERROR cannot update index buffer\n"));
 		if (dxbuf)
-			m_Context->IASetIndexBuffer(dxbuf, DXGI_FORMAT_R32_UINT, 0);
+			m_Context->IASetIndexBuffer(dxbuf, (idxsize == sizeof(uint16)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
 	}
 	geo->SetChanged(false);
 	/*
@@ -462,13 +505,17 @@ void	DXRenderer::RenderMesh(const Geometry* geo, const Appearance* app, const Ma
 	 */
 	UpdateAppearance(app, verts);
 	/*
-	 * Update constant buffer with render matrix
+	 * Update constant buffer with render matrix and lights
 	 */
 	DeviceBuffer*	constbuf = m_ConstantBuffers[CBUF_PEROBJECT];
 
 	if (constbuf)
 	{
-		constbuf->Set(TEXT("WorldMatrix"), mtx->GetMatrix());
+		constbuf->Set(m_WorldMatrixSlot, mtx->GetMatrix());
+		PerObjectConstants* cdata = (PerObjectConstants*) constbuf->GetData();
+
+		cdata->LightCount = LoadObjectLights(cdata->LightIndex);
+		constbuf->SetChanged(true);
 		DXConstantBuf::Update(this, constbuf);
 	}
 	/*
@@ -478,7 +525,15 @@ void	DXRenderer::RenderMesh(const Geometry* geo, const Appearance* app, const Ma
 
 	if (mesh->GetEndVtx() > 0)
 		nvtx = mesh->GetEndVtx() - mesh->GetStartVtx() + 1;
-	if (nidx)
+	const int32*	ranges;
+	int32			nranges = 0;
+
+	if (nidx && geo->IsKindOf(CLASS_(TriMesh)))
+		nranges = ((const TriMesh*) geo)->GetDrawRanges(&ranges);
+	if (nranges > 0)						// draw only the visible meshlets
+		for (int32 i = 0; i < nranges; ++i)
+			m_Context->DrawIndexed(ranges[2 * i + 1], ranges[2 * i], 0);
+	else if (nidx)
 		m_Context->DrawIndexed(nidx, 0, 0);
 	else
 		m_Context->Draw(nvtx, mesh->GetStartVtx());	
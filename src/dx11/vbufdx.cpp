@@ -121,20 +121,31 @@ bool DXBuffer::Update(DXRenderer* render, const void* data, int nbytes)
  *
  * The DX11 buffer will be created if it does not exist.
  * The DX11 usage will be D3D_DYNAMIC, allowing the CPU to update the buffer.
+ * Mapping a dynamic buffer discards its contents so the whole buffer is
+ * copied, but nothing is copied if the buffer did not change since the last time.
+ * The changes are taken before the copy so any made during it are sent next time.
  */
 bool DXConstantBuf::Update(DXRenderer* render, const DeviceBuffer* devbuf) 
 {
-	ObjectLock		lock(devbuf);
 	const void*		data;
 	int				size = (devbuf->GetByteSize() + 0X0F) & ~0X0F;
 	DXConstantBuf&	dxbuf = (DXConstantBuf&) devbuf->DevHandle;
+	size_t			start, end;
 
 	if (size == 0)
 		return false;
+	devbuf->Lock();
+	if (dxbuf.HasBuffer() && !devbuf->HasChanged() && !devbuf->IsDirty())
+	{
+		devbuf->Unlock();
+		return true;
+	}
+	devbuf->SetChanged(false);
+	devbuf->TakeDirty(start, end);		// later changes are marked again
+	devbuf->Unlock();
 	data = devbuf->GetData();
 	VX_ASSERT(data);
 	VX_TRACE(DXRenderer::Debug > 1, ("DXConstantBuf::Update %s %d bytes\n", devbuf->GetName(), size));
-	devbuf->SetChanged(false);
 	return dxbuf.Update(render, data, size);
 }
 
@@ -171,30 +182,52 @@ bool DXConstantBuf::Update(DXRenderer* render, const void* data, int size)
  * The caller specifies the usage of the index buffer each time it is updated.
  * If the buffer does not exist, it is created with the input usage model.
  * If that changes from static to dynamic, the buffer will be destroyed and recreated.
+ * The indices are checked while the array is locked and stored as 16 bit
+ * values if they all fit (see Mesh::FindIndexSize).
+ *
+ * @return bytes per index in the buffer, 0 if it could not be updated
  */
-bool DXIndexBuf::Update(DXRenderer* render, const IndexArray* inds, bool dynamic) 
+int DXIndexBuf::Update(DXRenderer* render, const IndexArray* inds, bool dynamic) 
 {
 	ObjectLock	lock(inds);
 	const void*	data;
-	intptr		size = inds->GetSize() * sizeof(uint32);
+	uint16*		tmpdata = NULL;
+	int			idxsize = Mesh::FindIndexSize(inds);
+	intptr		size = inds->GetSize() * idxsize;
+	bool		rc;
 
 	if (size == 0)
-		return false;
+		return 0;
 	data = inds->GetData();
 	VX_ASSERT(data);
+	if (idxsize == sizeof(uint16))
+	{
+		const int32* src = (const int32*) data;
+
+		tmpdata = (uint16*) Core::ThreadAllocator::Get()->Alloc(size);
+		for (intptr i = 0; i < inds->GetSize(); ++i)
+			tmpdata[i] = (uint16) src[i];
+		data = tmpdata;
+	}
 	VX_TRACE(DXRenderer::Debug, ("DXIndexBuf::Update %d bytes\n", size));
 	if (HasBuffer())
 	{
-		if (DXBuffer::Update(render, data, size))
-			return true;
+		rc = DXBuffer::Update(render, data, size);
+		if (tmpdata)
+			Core::ThreadAllocator::Get()->Free(tmpdata);
+		if (rc)
+			return idxsize;
 		if (dynamic)
 		{
 			DXRef<D3DBUFFER>::operator=(NULL);
 			VX_WARNING(("DXIndexBuf::Update recreating static buffer as dynamic %d bytes\n", size));
 		}
-		VX_ERROR(("DXIndexBuf::Update ERROR cannot update static buffer %d bytes\n", size), false);
+		VX_ERROR(("DXIndexBuf::Update ERROR cannot update static buffer %d bytes\n", size), 0);
 	}
-	return MakeBuffer(render, data, size, D3D11_BIND_INDEX_BUFFER, dynamic ? D3D_DYNAMIC : D3D_DEFAULT) != NULL;
+	rc = MakeBuffer(render, data, size, D3D11_BIND_INDEX_BUFFER, dynamic ? D3D_DYNAMIC : D3D_DEFAULT) != NULL;
+	if (tmpdata)
+		Core::ThreadAllocator::Get()->Free(tmpdata);
+	return rc ? idxsize : 0;
 }
 
 
@@ -276,7 +309,16 @@ void DXLayout::MakeLayout(const DataLayout* layout, D3D11_INPUT_ELEMENT_DESC* de
 		const LayoutSlot& slot = layout->Slot[i];
 		d->AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
 //		d->AlignedByteOffset = slot.Offset* sizeof(float);
-		if (slot.Style & VertexPool::INTEGER)
+		if (slot.Format != DataLayout::FULL)
+			switch (slot.Format)
+			{
+				case DataLayout::HALF: d->Format = (slot.Count > 2) ? DXGI_FORMAT_R16G16B16A16_FLOAT : DXGI_FORMAT_R16G16_FLOAT; break;
+				case DataLayout::QUANTIZED: d->Format = (slot.Count > 2) ? DXGI_FORMAT_R16G16B16A16_UNORM : DXGI_FORMAT_R16G16_UNORM; break;
+				case DataLayout::OCTAHEDRAL: d->Format = DXGI_FORMAT_R16G16_SNORM; break;
+				case DataLayout::SNORM16: d->Format = DXGI_FORMAT_R16G16B16A16_SNORM; break;
+				default: d->Format = DXGI_FORMAT_R10G10B10A2_UNORM; break;
+			}
+		else if (slot.Style & VertexPool::INTEGER)
 			switch (slot.Size)
 			{
 				case 4: d->Format = DXGI_FORMAT_R32G32B32A32_UINT; break;
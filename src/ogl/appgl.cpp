@@ -130,6 +130,8 @@ GLuint GLProgram::NewProgram(const TCHAR* key)
 		}
 	}
 	ProgramDict->Set(key, programid);
+	m_MaterialProgram = 0;				// new program has no material
+
 	m_GLProgram = programid;
 	return programid;
 }
@@ -181,11 +183,37 @@ bool GLProgram::LinkProgram(GLuint vertshader, GLuint pixshader)
 /*
  * Set material parameters. If not texturing, we force D3D to use the diffuse
  * material color instead of the texture color.
+ * If the program already has this material, only the elements which
+ * changed are copied. This works as long as nothing has taken the changes
+ * since the program last got the material, which the clean version tells us.
  */
 void GLProgram::UpdateMaterial(const DeviceBuffer* mat)
 {
-	if (mat)
+	size_t	start, end;
+	uint32	version;
+	bool	partial;
+
+	if (mat == NULL)
+		return;
+	mat->Lock();
+	partial = (mat == m_Material) &&
+			  (m_GLProgram == m_MaterialProgram) &&
+			  (m_MaterialVersion >= mat->GetCleanVersion());
+	version = mat->GetVersion();
+	if (partial && (m_MaterialVersion == version))
+	{
+		mat->Unlock();
+		return;
+	}
+	mat->TakeDirty(start, end);			// changes made while copying are marked again
+	mat->Unlock();
+	if (partial)
+		GLBuffer::Update(mat, m_GLProgram, NULL, start, end);
+	else
 		GLBuffer::Update(mat, m_GLProgram);
+	m_Material = mat;
+	m_MaterialProgram = m_GLProgram;
+	m_MaterialVersion = version;
 }
 
 intptr GLProgram::UpdateSampler(GLRenderer* render, const Sampler* smp, int texunit)
@@ -300,9 +328,15 @@ const Shader* 	GLProgram::SelectPixelShader(GLRenderer* render, const Appearance
 	{
 		PhongMaterial::ShaderConstants* mtldata = (PhongMaterial::ShaderConstants*) mtl->GetData();
 		VX_ASSERT(mtldata);
-		mtldata->HasDiffuseMap = diffusemap;
-		mtldata->HasSpecularMap = specularmap;
-		mtldata->HasNormalMap = normalmap;
+		if ((mtldata->HasDiffuseMap != (int32) diffusemap) ||
+			(mtldata->HasSpecularMap != (int32) specularmap) ||
+			(mtldata->HasNormalMap != (int32) normalmap))
+		{
+			mtldata->HasDiffuseMap = diffusemap;
+			mtldata->HasSpecularMap = specularmap;
+			mtldata->HasNormalMap = normalmap;
+			mtl->MarkDirty((char*) &mtldata->HasDiffuseMap - (char*) mtldata, 3 * sizeof(int32));
+		}
 	}
 	shaderchanged |= shader->HasChanged();
 	shader->GetShaderCode(&codeptr, &codelen);
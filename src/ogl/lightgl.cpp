@@ -17,12 +17,12 @@ namespace Vixen {
 	{
 		template <> inline bool Core::Dict<NameProp, Core::String, Vixen::BaseDict>::CompareKeys(const NameProp& knew, const NameProp& kdict)
 		{
-			return String(knew).CompareNoCase(kdict) == 0;
+			return knew.IsSame(kdict);
 		}
 
 		template <> inline uint32 Core::Dict<NameProp, Core::String, Vixen::BaseDict>::HashKey(const NameProp& np) const
 		{
-			return HashStr((const TCHAR*) np);
+			return np.GetHash();
 		}
 
 	}
@@ -37,8 +37,7 @@ intptr GLRenderer::AddLight(Light* light)
 		return prop->DevIndex;
 	prop = new GLLight(*this, *light);
 	prop->DevIndex = m_LightList.Attach(light, prop);
-	if ((prop->DevIndex < 0) ||
-		((int) prop->DevIndex >= MaxLights))
+	if (prop->DevIndex < 0)
 	{
 		VX_ERROR(("AddLight ERROR cannot add light #%d\n", prop->DevIndex), -1);
 	}
@@ -81,7 +80,9 @@ void GLLight::Detach()
 
 /*
  * Generate the pixel shader source for each light
- * and determine the total size of the light constant buffer
+ * and determine the total size of the light constant buffer.
+ * Each light is named by its ID and LightsEnabled is
+ * declared large enough for the highest light ID.
  */
 int	GLRenderer::LoadLights()
 {
@@ -91,6 +92,7 @@ int	GLRenderer::LoadLights()
 	int				nlights = 0;
 	int				nbytes = 0;
 	int				numshaders = 0;
+	int				maxid = 0;
 	Core::String	decls;
 	Core::String	source;
 	LightList::Iter	iter(lights);
@@ -107,9 +109,11 @@ int	GLRenderer::LoadLights()
 		NameProp		shadername = l->LightModel->ClassName();
 		const Shader*	shader = FindShader(shadername);
 		const TCHAR*	shadersrc = NULL;
-		Core::String	lightnum(nlights);
+		Core::String	lightnum(l->ID);
 
-		LightsEnabled[l->ID] = enabled;
+		EnableLight(l->ID, enabled);
+		if (l->ID >= maxid)
+			maxid = l->ID + 1;
 		if ((shader == NULL) || ((shadersrc = shader->GetSource()) == NULL))
 		{
 			VX_TRACE(GLRenderer::Debug, ("GLRenderer::LoadLights ERROR no shader found for %s\n", (const TCHAR*) shadername));
@@ -141,7 +145,9 @@ int	GLRenderer::LoadLights()
 		while (stringentry = niter.Next())
 			source += *stringentry;
 	}
-	VX_ASSERT(nlights < LIGHT_MaxLights);
+	m_LightsDeclared = (maxid > 0) ? maxid : 1;
+	decls = TEXT("uniform int\tLightsEnabled[") + Core::String(m_LightsDeclared) + TEXT("];\n") + decls;
+	m_LightsEnabledChanged = true;
 	source = source + decls + lightpixel;
 	m_LightShaderSource = source;
 	if ((nlights > 0) && (numshaders == nlights))
@@ -149,17 +155,71 @@ int	GLRenderer::LoadLights()
 	return nlights;
 }
 
+/*!
+ * @fn void GLRenderer::EnableLight(int id, int enabled)
+ * @param id		light ID (GPULight::ID)
+ * @param enabled	1 to enable the light, 0 to disable it
+ *
+ * Sets the flag for the light in the LightsEnabled array
+ * passed to the pixel shader, enlarging the array if necessary.
+ * The array is loaded into the GL program before the next draw.
+ *
+ * @see GLRenderer::LoadLightsEnabled LightList::LightsOn
+ */
+void GLRenderer::EnableLight(int id, int enabled)
+{
+	if (id < 0)
+		return;
+	if (id >= NumLightsEnabled)
+	{
+		int		n = NumLightsEnabled ? NumLightsEnabled : LIGHT_MaxLights;
+		int*	flags;
+
+		while (n <= id)
+			n *= 2;
+		if ((flags = (int*) realloc(LightsEnabled, n * sizeof(int))) == NULL)
+			VX_ERROR_RETURN(("GLRenderer::EnableLight ERROR out of memory for %d lights\n", n));
+		memset(flags + NumLightsEnabled, 0, (n - NumLightsEnabled) * sizeof(int));
+		LightsEnabled = flags;
+		NumLightsEnabled = n;
+	}
+	if (LightsEnabled[id] != enabled)
+	{
+		LightsEnabled[id] = enabled;
+		m_LightsEnabledChanged = true;
+	}
+}
+
+/*
+ * Load the light enable flags into the GL program if they
+ * have changed since the last draw or the program changed.
+ */
+void GLRenderer::LoadLightsEnabled(GLuint program)
+{
+	GLint	loc;
+	int		n = m_LightsDeclared;
+
+	m_LightsEnabledChanged = false;
+	if ((n <= 0) || (LightsEnabled == NULL))
+		return;
+	if (n > NumLightsEnabled)
+		n = NumLightsEnabled;
+	loc = glGetUniformLocation(program, TEXT("LightsEnabled"));
+	if (loc >= 0)
+		glUniform1iv(loc, n, LightsEnabled);
+}
+
 void GLLight::Enable() const
 {
 	GLRenderer&	render = (GLRenderer&) Render;
-	render.LightsEnabled[ID] = 1;
+	render.EnableLight(ID, 1);
 	VX_TRACE2(Light::Debug, ("GLLight::Enable #%d", DevIndex));
 }
 
 void GLLight::Disable() const
 {
 	GLRenderer&	render = (GLRenderer&) Render;
-	render.LightsEnabled[ID] = 0;
+	render.EnableLight(ID, 0);
 	VX_TRACE2(Light::Debug, ("GLLight::Disable #%d", DevIndex));
 }
 }	// end Vixen
\ No newline at end of file
@@ -49,7 +49,10 @@ void	GLRenderer::RenderMesh(const Geometry* geo, const Appearance* app, const Ma
 		if (m_CurProgram == 0)
 			return;
 		InitPerFrame(m_CurProgram, changed);
+		m_LightsEnabledChanged = true;		// program may have changed
 	}
+	if (m_LightsEnabledChanged)				// lights for this mesh differ from the last one
+		LoadLightsEnabled(m_CurProgram);
 	/*
 	 * Update vertex and index buffers if changed
 	 * and draw the mesh
@@ -76,6 +79,18 @@ void	GLRenderer::RenderMesh(const Geometry* geo, const Appearance* app, const Ma
 	geo->SetChanged(false);
 	if (mtxloc > 0)
 		glUniformMatrix4fv(mtxloc, 1, false, mtx->GetMatrix());
+	if (verts->GetLayout()->Slot[0].Format == DataLayout::QUANTIZED)
+	{									// application shader maps quantized locations back to model space
+		GLint	scaleloc = glGetUniformLocation(m_CurProgram, TEXT("QuantScale"));
+		GLint	ofsloc = glGetUniformLocation(m_CurProgram, TEXT("QuantOffset"));
+		Vec3	scale(verts->GetQuantScale());
+
+		scale *= 65535.0f;					// attribute is normalized to [0, 1]
+		if (scaleloc >= 0)
+			glUniform3fv(scaleloc, 1, &scale.x);
+		if (ofsloc >= 0)
+			glUniform3fv(ofsloc, 1, &(verts->GetQuantOffset().x));
+	}
 	if (!glvbuf.HasBuffer() || verts->HasChanged() || meshchanged)
 	{
 		glvbuf.Update(this, verts, verts->IsSet(VertexPool::MORPH));
@@ -90,17 +105,33 @@ void	GLRenderer::RenderMesh(const Geometry* geo, const Appearance* app, const Ma
 		GLIndexBuf& ibuf = (GLIndexBuf&) geomesh->DevHandle;
 		GLuint		nidx = (GLuint) inds->GetSize();
 		GLuint		glibuf = ibuf.GetBuffer();
+		int			idxsize = geomesh->GetIndexSize();
+		GLenum		idxtype = VXGLIndex;
+		const int32* ranges;
+		int32		nranges = 0;
 
 		VX_ASSERT(nidx < INT_MAX);
-		if (!glibuf || meshchanged)
+		if (!glibuf || meshchanged || (idxsize == 0))
 		{
-			ibuf.Update(this, inds, 0);
+			idxsize = ibuf.Update(this, inds, 0);	// decides 16 or 32 bit indices
+			geomesh->SetIndexSize(idxsize);
 			inds->SetChanged(false);
 		}
 		else
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, glibuf);
+		if (idxsize == sizeof(uint16))		// 16 bit indices if they fit
+			idxtype = GL_UNSIGNED_SHORT;
 		VX_TRACE(Debug > 1, ("GLRenderer::RenderMesh using index buffer #%d\n", glibuf));
-		glDrawRangeElements(rendertype, start, end, nidx, VXGLIndex, 0);
+		if (geomesh->IsKindOf(CLASS_(TriMesh)))
+			nranges = ((const TriMesh*) geomesh)->GetDrawRanges(&ranges);
+		if (idxsize == 0)					// index buffer could not be made
+			VX_WARNING(("GLRenderer::RenderMesh cannot update index buffer\n"));
+		else if (nranges > 0)				// draw only the visible meshlets
+			for (int32 i = 0; i < nranges; ++i)
+				glDrawRangeElements(rendertype, start, end, ranges[2 * i + 1], idxtype,
+									(const GLvoid*) (intptr(ranges[2 * i]) * idxsize));
+		else
+			glDrawRangeElements(rendertype, start, end, nidx, idxtype, 0);
 	}
 	else
 		glDrawArrays(rendertype, start, nverts);
@@ -47,7 +47,7 @@ bool CullList::Cull(const Geometry* g) const
  * visible (based on OGL occlusion check of its bounding box)
  *
  ****/
-int CullList::AddShape(Shape* shape, const Matrix* mtx, int32 lightmask)
+int CullList::AddShape(Shape* shape, const Matrix* mtx)
 {
 	Box3			b;
 	GLboolean	result;
@@ -62,7 +62,7 @@ int CullList::AddShape(Shape* shape, const Matrix* mtx, int32 lightmask)
 	{
 		RenderBox(b);								// render hierarchy bounds
 		glGetBooleanv(GL_OCCLUSION_TEST_RESULT_HP, &result);
-		if (result && GeoSorter::AddShape(shape, mtx, lightmask))	// something visible?
+		if (result && GeoSorter::AddShape(shape, mtx))	// something visible?
 			rc = 1;
 	}
 	glDisable(GL_OCCLUSION_TEST_HP);				// disable occlusion test
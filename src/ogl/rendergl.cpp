@@ -23,12 +23,23 @@ Renderer*	Renderer::CreateRenderer(int options)
 GLRenderer::GLRenderer() : GeoSorter()
 {
 	b_Transpose = false;
+	LightsEnabled = NULL;
+	NumLightsEnabled = 0;
+	m_LightsEnabledChanged = false;
+	m_LightsDeclared = 0;
+}
+
+GLRenderer::~GLRenderer()
+{
+	if (LightsEnabled)
+		free(LightsEnabled);
 }
 
 GLRenderer& GLRenderer::operator=(const GLRenderer& src)
 {
 	GeoSorter::operator=(src);
 	b_Transpose = false;
+	m_LightsEnabledChanged = true;
 	return *this;
 }
 
@@ -235,7 +246,7 @@ void GLRenderer::Begin(int changed, int frame)
 	if (err)
 		VX_WARNING(("GLRenderer::Begin GL ERROR %x\n", err));
 #endif
-	if (m_LightList.LightsChanged() != 0)
+	if (m_LightList.GetNumChanged() != 0)
 		m_Changed |= SCENE_LightsChanged;
 	if (m_LightShaderChanged || (m_LightList.GetNumLights() != NumLights))
 	{
@@ -273,9 +284,6 @@ void GLRenderer::InitPerFrame(intptr program, int changed)
 		GLLight*	l;
 		bool		enabled;
 
-		loc = glGetUniformLocation(glp, TEXT("LightsEnabled"));
-		if (loc >= 0)
-			glUniform1iv(loc, LIGHT_MaxLights, LightsEnabled);
 		loc = glGetUniformLocation(glp, TEXT("NumLights"));
 		if (loc >= 0)
 			glUniform1i(loc, NumLights);
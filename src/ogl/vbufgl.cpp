@@ -37,7 +37,13 @@ void GLBuffer::Release()
 }
 
 
-bool GLBuffer::Update(const DeviceBuffer* databuf, GLuint program, const TCHAR* prefix)
+/*
+ * Copy the elements of a device buffer into the uniforms of a program.
+ * Only the elements which overlap the byte range from start to end
+ * are copied, usually the range from DeviceBuffer::TakeDirty.
+ * The caller must know the program already has the other values.
+ */
+bool GLBuffer::Update(const DeviceBuffer* databuf, GLuint program, const TCHAR* prefix, size_t start, size_t end)
 {
 	const DataLayout*	layout = databuf->GetLayout();
 	const float*		data = (float*) databuf->GetData();
@@ -45,12 +51,20 @@ bool GLBuffer::Update(const DeviceBuffer* databuf, GLuint program, const TCHAR*
 
 	VX_ASSERT(layout);
 	VX_ASSERT(data);
+	if (end > databuf->GetByteSize())
+		end = databuf->GetByteSize();
+	if (end <= start)
+		return true;
 	for (int i = 0; i < layout->NumSlots; ++i)
 	{
 		const LayoutSlot& slot = layout->Slot[i];
 		GLint			attrib;
 		bool			isint = (slot.Style & VertexPool::INTEGER) != 0;
 		const float*	v = data + slot.Offset;
+		size_t			ofs = slot.Offset * sizeof(float);
+
+		if ((ofs >= end) || (ofs + slot.Size * sizeof(float) <= start))
+			continue;
 
 		if (prefix)
 		{
@@ -67,8 +81,8 @@ bool GLBuffer::Update(const DeviceBuffer* databuf, GLuint program, const TCHAR*
 				case 2:		if (isint) glUniform2iv(attrib, 1, (const GLint*) v); else glUniform2fv(attrib, 1, (const GLfloat*) v); break;
 				case 3:		if (isint) glUniform3iv(attrib, 1, (const GLint*) v); else glUniform3fv(attrib, 1, (const GLfloat*) v); break;
 				case 4:		if (isint) glUniform4iv(attrib, 1, (const GLint*) v); else glUniform4fv(attrib, 1, (const GLfloat*) v); break;
-				case 16:	VX_ASSERT(isint == false); glUniformMatrix4fv(attrib, 1, false, (const GLfloat*) v);
-				case 9:		VX_ASSERT(isint == false); glUniformMatrix3fv(attrib, 1, false, (const GLfloat*) v);
+				case 16:	VX_ASSERT(isint == false); glUniformMatrix4fv(attrib, 1, false, (const GLfloat*) v); break;
+				case 9:		VX_ASSERT(isint == false); glUniformMatrix3fv(attrib, 1, false, (const GLfloat*) v); break;
 				default:
 				VX_ERROR(("GLBuffer::Update ERROR invalid uniform vector size %d\n", slot.Size), false);
 			}
@@ -96,31 +110,39 @@ void GLBuffer::ReleaseAll()
  * Copy the indices from the input array into the D3D index buffer.
  * The previous contents of the index buffer are discarded.
  * This routine will create a D3D index buffer large enough to hold the
- * input data if one does not already exist.
+ * input data if one does not already exist. The indices are checked
+ * while the array is locked and stored as 16 bit values if they all fit
+ * (see Mesh::FindIndexSize).
+ * @return bytes per index in the buffer, 0 if it could not be updated
  */
-bool GLIndexBuf::Update(GLRenderer* render, const IndexArray* inds, bool dynamic) 
+int GLIndexBuf::Update(GLRenderer* render, const IndexArray* inds, bool dynamic) 
 {
 	ObjectLock		lock(inds);
 	const int32*	data;
-	size_t			size = inds->GetSize() * sizeof(VXGLIndex);
 	GLuint			bufid = m_GLBuffer;
+	int				idxsize = Mesh::FindIndexSize(inds);
+	size_t			size;
+
+	if (VXGLIndex == GL_UNSIGNED_SHORT)
+		idxsize = sizeof(uint16);
+	size = inds->GetSize() * idxsize;
 
 	if (size == 0)
-		return false;
+		return 0;
 	data = inds->GetData();
 	VX_ASSERT(data);
 	if (bufid == 0)
 	{
 		bufid = MakeBuffer(render, size, GL_ELEMENT_ARRAY_BUFFER);
 		if (bufid == 0)
-			return false;
+			return 0;
 	}
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufid);
-	if (VXGLIndex == GL_UNSIGNED_SHORT)
+	if (idxsize == sizeof(uint16))
 	{
-		int16*	tmpdata = (int16*) Core::ThreadAllocator::Get()->Alloc(size);
+		uint16*	tmpdata = (uint16*) Core::ThreadAllocator::Get()->Alloc(size);
 		for (intptr i = 0; i < inds->GetSize(); ++i)
-			tmpdata[i] = (int16) data[i];
+			tmpdata[i] = (uint16) data[i];
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, tmpdata, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
 		Core::ThreadAllocator::Get()->Free(tmpdata);
 	}
@@ -131,7 +153,7 @@ bool GLIndexBuf::Update(GLRenderer* render, const IndexArray* inds, bool dynamic
 		VX_ERROR(("GLIndexBuf::Update ERROR cannot update buffer %x\n", err), 0);
 #endif
 	VX_TRACE(GLRenderer::Debug, ("GLIndexBuf::Update #%d %d bytes\n", bufid, size));
-	return true;
+	return idxsize;
 }
 
 /*
@@ -185,8 +207,18 @@ void GLVertexBuf::EnableAttribs(const DataLayout* layout, GLuint glprogram)
 	{
 		const LayoutSlot& slot = layout->Slot[i];
 		GLuint	gltype = (slot.Style & VertexPool::INTEGER) ? GL_INT : GL_FLOAT;
+		GLint	count = slot.Size;
+		bool	normalize = false;
 
-		glVertexAttribPointer(i, slot.Size, gltype, false, stride, (const void*) (slot.Offset * sizeof(float)));
+		switch (slot.Format)				// compact formats are converted by GL
+		{
+			case DataLayout::HALF:			gltype = GL_HALF_FLOAT; count = slot.Count; break;
+			case DataLayout::QUANTIZED:		gltype = GL_UNSIGNED_SHORT; count = slot.Count; normalize = true; break;
+			case DataLayout::OCTAHEDRAL:	gltype = GL_SHORT; count = 2; normalize = true; break;
+			case DataLayout::PACKED10:		gltype = GL_UNSIGNED_INT_2_10_10_10_REV; count = 4; normalize = true; break;
+			case DataLayout::SNORM16:		gltype = GL_SHORT; count = 3; normalize = true; break;
+		}
+		glVertexAttribPointer(i, count, gltype, normalize, stride, (const void*) (slot.Offset * sizeof(float)));
 		glEnableVertexAttribArray(i);
 #ifdef _DEBUG
 		{
@@ -43,12 +43,12 @@ namespace Vixen {
 
 template <> inline bool Core::Dict<NameProp, void*, BaseDict>::CompareKeys(const NameProp& knew, const NameProp& kdict)
 {
-	return String(knew).CompareNoCase(kdict) == 0;
+	return knew.IsSame(kdict);
 }
 
 template <> inline uint32 Core::Dict<NameProp, void*, BaseDict>::HashKey(const NameProp& np) const
 {
-	return HashStr((const TCHAR*) np);
+	return np.GetHash();
 }
 
 /*
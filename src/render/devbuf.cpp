@@ -11,9 +11,55 @@ VX_IMPLEMENT_CLASS(DeviceBuffer, SharedObj);
 
 Core::Dict<Core::String, DataLayout, BaseDict>*	DataLayout::s_Layouts = NULL;
 
+/*
+ * Element types which may appear in a layout descriptor.
+ * The compact types pack several values into each 32 bit word.
+ */
+static const struct
+{
+	const TCHAR*	Name;		// type keyword
+	int32			Format;		// storage format
+	int32			Style;		// DataLayout::INTEGER or DataLayout::FLOAT
+	int32			Count;		// default number of values
+} s_LayoutTypes[] =
+{
+	{ TEXT("float"),	DataLayout::FULL,		DataLayout::FLOAT,		1 },
+	{ TEXT("int"),		DataLayout::FULL,		DataLayout::INTEGER,	1 },
+	{ TEXT("half"),		DataLayout::HALF,		DataLayout::FLOAT,		1 },
+	{ TEXT("short"),	DataLayout::QUANTIZED,	DataLayout::FLOAT,		1 },
+	{ TEXT("oct"),		DataLayout::OCTAHEDRAL,	DataLayout::FLOAT,		3 },
+	{ TEXT("packed"),	DataLayout::PACKED10,	DataLayout::FLOAT,		3 },
+	{ TEXT("snorm"),	DataLayout::SNORM16,	DataLayout::FLOAT,		3 },
+};
+
+#define	LAYOUT_NumTypes	int(sizeof(s_LayoutTypes) / sizeof(s_LayoutTypes[0]))
+
+/*
+ * Return the index of the type keyword at the start of the string
+ * or -1 if it does not start with a type.
+ */
+static int ParseType(const TCHAR* p)
+{
+	for (int t = 0; t < LAYOUT_NumTypes; ++t)
+	{
+		const TCHAR*	name = s_LayoutTypes[t].Name;
+		size_t			n = STRLEN(name);
+		TCHAR			c;
+
+		if (STRNCMP(p, name, n) != 0)
+			continue;
+		c = p[n];
+		if ((c == 0) || (c == TEXT(' ')) || (c == TEXT('\t')) || ((c >= TEXT('0')) && (c <= TEXT('9'))))
+			return t;
+	}
+	return -1;
+}
+
 DataLayout::DataLayout(const TCHAR* descriptor)
 {
 	NumSlots = 0;
+	NumCompact = 0;
+	Size = 0;
 	NormalOfs = -1;
 	NumTex = 0;
 	Style = 0;
@@ -30,7 +76,7 @@ void DataLayout::FormatDescriptor(Core::String& outdesc, const TCHAR* indesc)
 
 	while (*p && ((*p == TEXT(' ')) || (*p == TEXT('\t'))))
 		++p;
-	if ((*p == TEXT('i')) || (*p == TEXT('f')))
+	if (ParseType(p) >= 0)
 	{
 		outdesc = p;
 		return;
@@ -50,6 +96,23 @@ void DataLayout::FormatDescriptor(Core::String& outdesc, const TCHAR* indesc)
 	}
 }
 
+/*!
+ * @fn void DataLayout::SetDescriptor(const TCHAR* descriptor)
+ * @param descriptor	string describing layout
+ *
+ * Each element in the descriptor has a type, an optional number of values
+ * and a name. In addition to \b float and \b int, which use a 32 bit word
+ * for each value, vertex layouts may use compact types:
+ * @code
+ *	half2 texcoord		16 bit float values, two per word
+ *	short3 position		16 bit values scaled by VertexPool::GetQuantScale, two per word
+ *	oct normal			unit vector, octahedral encoding in one word
+ *	packed normal		unit vector, 10:10:10:2 encoding in one word
+ * @endcode
+ * The offsets and sizes of elements are always in 32 bit words.
+ *
+ * @see DataLayout::FindLayout VertexPool::DecodeIter
+ */
 void DataLayout::SetDescriptor(const TCHAR* descriptor)
 {
 	const TCHAR*	p = descriptor;
@@ -58,6 +121,8 @@ void DataLayout::SetDescriptor(const TCHAR* descriptor)
 
 	FormatDescriptor(Descriptor, descriptor);
 	NumSlots = 0;
+	NumCompact = 0;
+	Size = 0;
 	NormalOfs = -1;
 	NumTex = 0;
 	Style = 0;
@@ -67,19 +132,15 @@ void DataLayout::SetDescriptor(const TCHAR* descriptor)
 	{
 		LayoutSlot&	slot = Slot[NumSlots];
 		int			size;
+		int			type = ParseType(p);
 		TCHAR		name[128];
 		TCHAR*		q = name;
 
-		slot.Style = 0;
-		if (STRNCMP(p, TEXT("int"), 3) == 0)
-		{
-			slot.Style |= DataLayout::INTEGER;
-			p += 3;
-		}
-		else if (STRNCMP(p, TEXT("float"), 5) == 0)
-			p += 5;
-		else
+		if (type < 0)
 			break;
+		slot.Style = s_LayoutTypes[type].Style;
+		slot.Format = s_LayoutTypes[type].Format;
+		p += STRLEN(s_LayoutTypes[type].Name);
 		if (SSCANF(p, TEXT("%d"), &size))
 		{
 			while (*p &&
@@ -89,7 +150,7 @@ void DataLayout::SetDescriptor(const TCHAR* descriptor)
 				p++;
 		}
 		else
-			size = 1;
+			size = s_LayoutTypes[type].Count;
 		while (*p &&
 				(*p == TEXT(' ')) ||
 				(*p == TEXT('\t')) ||
@@ -104,7 +165,18 @@ void DataLayout::SetDescriptor(const TCHAR* descriptor)
 		slot.Name = name;
 		slot.Offset = Size;
 		slot.TexIndex = -1;
-		slot.Size = size;		// parse the size
+		slot.Count = size;		// parse the size
+		switch (slot.Format)
+		{
+			case HALF:
+			case QUANTIZED:		slot.Size = (size + 1) / 2; break;
+			case OCTAHEDRAL:
+			case PACKED10:		slot.Size = 1; slot.Count = 3; break;
+			case SNORM16:		slot.Size = 2; slot.Count = 3; break;
+			default:			slot.Size = size; break;
+		}
+		if (slot.Format != FULL)
+			++NumCompact;
 		++NumSlots;
 		Size += slot.Size;
 		VX_ASSERT(slot.Size >= 1);
@@ -135,6 +207,33 @@ const LayoutSlot* DataLayout::GetSlot(const TCHAR* name) const
 	return NULL;
 }
 
+/*!
+ * @fn SlotHandle DataLayout::GetHandle(const TCHAR* name) const
+ * @param name	name of element to find
+ *
+ * Resolves a handle for the named element which can be used to
+ * access it in any buffer with this layout without looking up the name.
+ * Because layouts are shared by all buffers with the same descriptor,
+ * handles are typically resolved once when an object is made.
+ *
+ * @returns handle for the element, SlotHandle::IsValid is \b false if not found
+ *
+ * @see DeviceBuffer::Set DeviceBuffer::SetSlots DataLayout::GetSlot
+ */
+SlotHandle DataLayout::GetHandle(const TCHAR* name) const
+{
+	const LayoutSlot*	slot = GetSlot(name);
+	SlotHandle			handle;
+
+	if (slot)
+	{
+		handle.Layout = this;
+		handle.Offset = slot->Offset;
+		handle.Size = slot->Size;
+	}
+	return handle;
+}
+
 
 /*!
  * @fn const DataLayout* DataLayout::FindLayout(const TCHAR* layout_desc)
@@ -214,15 +313,27 @@ void DataLayout::MakeDescriptor(Core::String& desc) const
 	desc = "";
 	for (int i = 0; i < NumSlots; ++i)
 	{
+		const LayoutSlot&	slot = Slot[i];
+		int32				count = slot.Size;
+
 		if (!desc.IsEmpty())
 			desc += TEXT(", ");
-		if (Slot[i].Style & DataLayout::INTEGER)
-			desc += TEXT("int");
-		else
-			desc += TEXT("float");
-		if (Slot[i].Size > 1)
-			desc += Core::String(Slot[i].Size);
-		desc += TEXT(" ") + Slot[i].Name;
+		switch (slot.Format)
+		{
+			case HALF:			desc += TEXT("half"); count = slot.Count; break;
+			case QUANTIZED:		desc += TEXT("short"); count = slot.Count; break;
+			case OCTAHEDRAL:	desc += TEXT("oct"); count = 1; break;
+			case PACKED10:		desc += TEXT("packed"); count = 1; break;
+			case SNORM16:		desc += TEXT("snorm"); count = 1; break;
+			default:
+			if (slot.Style & DataLayout::INTEGER)
+				desc += TEXT("int");
+			else
+				desc += TEXT("float");
+		}
+		if (count > 1)
+			desc += Core::String(count);
+		desc += TEXT(" ") + slot.Name;
 	}
 }
 
@@ -230,6 +341,7 @@ DataLayout&	DataLayout::operator=(const DataLayout& src)
 {
 	Descriptor = src.Descriptor;
 	NumSlots = src.NumSlots;
+	NumCompact = src.NumCompact;
 	Size = src.Size;
 	DevHandle = src.DevHandle;
 	NumTex = src.NumTex;
@@ -260,6 +372,11 @@ DeviceBuffer::DeviceBuffer(const TCHAR* desc, size_t nbytes)
 {
 	m_Data = NULL;
 	m_Size = (int32) 0;
+	m_Layout = NULL;
+	m_DirtyStart = 0;
+	m_DirtyEnd = 0;
+	m_Version = 0;
+	m_CleanVersion = 0;
 	DevHandle = 0;
 	Reset(desc, nbytes);
 }
@@ -269,6 +386,11 @@ DeviceBuffer::DeviceBuffer(const DeviceBuffer& src)
 	DevHandle = 0;
 	m_Size = 0;
 	m_Data = NULL;
+	m_Layout = NULL;
+	m_DirtyStart = 0;
+	m_DirtyEnd = 0;
+	m_Version = 0;
+	m_CleanVersion = 0;
 	Copy(&src);
 }
 
@@ -292,6 +414,7 @@ void	DeviceBuffer::Reset(const TCHAR* desc, size_t nbytes)
 		m_Size = (nbytes + 15) & ~0X0F;			// 16 byte boundary
 		SetData(Core::GlobalAllocator::Get()->Alloc(nbytes));
 	}
+	MarkDirty();
 }
 
 DeviceBuffer::~DeviceBuffer()
@@ -318,10 +441,171 @@ bool DeviceBuffer::Copy(const SharedObj* src_obj)
 			if (m_Layout && (m_Layout->Size > 0))
 				m_Data = Core::GlobalAllocator::Get()->Alloc(m_Layout->Size);
 		}
+		MarkDirty();
 	}
 	return true;
 }
 
+/*!
+ * @fn void DeviceBuffer::MarkDirty(size_t ofs, size_t nbytes) const
+ * @param ofs		byte offset of the first changed byte
+ * @param nbytes	number of bytes changed
+ *
+ * Records that part of the buffer has changed. The buffer keeps a
+ * single range which covers all the changes since the last call to
+ * DeviceBuffer::TakeDirty, which renderers use to upload only that part.
+ * The Set functions mark the elements they change. Code which writes
+ * the buffer data directly should call this function afterwards.
+ *
+ * @see DeviceBuffer::GetDirty DeviceBuffer::GetVersion
+ */
+void DeviceBuffer::MarkDirty(size_t ofs, size_t nbytes) const
+{
+	size_t	end = ofs + nbytes;
+
+	if (nbytes == 0)
+		return;
+	ObjectLock	lock(this);
+	if (m_DirtyEnd <= m_DirtyStart)
+	{
+		m_DirtyStart = ofs;
+		m_DirtyEnd = end;
+	}
+	else
+	{
+		if (ofs < m_DirtyStart)
+			m_DirtyStart = ofs;
+		if (end > m_DirtyEnd)
+			m_DirtyEnd = end;
+	}
+	++m_Version;
+}
+
+/*!
+ * @fn bool DeviceBuffer::TakeDirty(size_t& start, size_t& end) const
+ * @param start	gets the offset of the first changed byte
+ * @param end	gets the offset after the last changed byte
+ *
+ * Returns the range of bytes changed since the last call and forgets it.
+ * A renderer calls this before it copies the changed bytes to the device.
+ * Taking the range and clearing it happen together under the buffer lock
+ * so a change made while the renderer is uploading is marked again and
+ * will be picked up by the next upload instead of being lost.
+ * The version at this point is saved so a renderer which copies the
+ * buffer to more than one place can tell whether the changed range
+ * still covers everything it has not seen.
+ *
+ * @returns \b true if any bytes changed, \b false if none
+ *
+ * @see DeviceBuffer::GetCleanVersion DeviceBuffer::MarkDirty
+ */
+bool DeviceBuffer::TakeDirty(size_t& start, size_t& end) const
+{
+	ObjectLock	lock(this);
+	bool		dirty = GetDirty(start, end);
+
+	m_DirtyStart = 0;
+	m_DirtyEnd = 0;
+	m_CleanVersion = m_Version;
+	return dirty;
+}
+
+/*!
+ * @fn bool DeviceBuffer::GetDirty(size_t& start, size_t& end) const
+ * @param start	gets the offset of the first changed byte
+ * @param end	gets the offset after the last changed byte
+ *
+ * Returns the range of bytes changed since the last call
+ * to DeviceBuffer::TakeDirty without clearing it.
+ *
+ * @returns \b true if any bytes changed, \b false if none
+ *
+ * @see DeviceBuffer::MarkDirty
+ */
+bool DeviceBuffer::GetDirty(size_t& start, size_t& end) const
+{
+	ObjectLock	lock(this);
+
+	start = m_DirtyStart;
+	end = m_DirtyEnd;
+	if (end > m_Size)
+		end = m_Size;
+	return end > start;
+}
+
+/*
+ * Copy data into the element for a slot handle and mark it changed.
+ * If nbytes is zero, the size of the element is copied.
+ */
+bool DeviceBuffer::SetSlot(const SlotHandle& slot, const void* src, int32 nbytes)
+{
+	int32	slotbytes;
+	void*	data = GetSlotData(slot, slotbytes);
+
+	if (data == NULL)
+		return false;
+	VX_ASSERT((nbytes == 0) || (nbytes == slotbytes));
+	memcpy(data, src, slotbytes);
+	MarkDirty(slot.Offset * sizeof(int32), slotbytes);
+	return true;
+}
+
+/*
+ * Copy data from the element for a slot handle.
+ * If nbytes is zero, the size of the element is copied.
+ */
+bool DeviceBuffer::GetSlot(const SlotHandle& slot, void* dst, int32 nbytes) const
+{
+	int32	slotbytes;
+	void*	data = GetSlotData(slot, slotbytes);
+
+	if (data == NULL)
+		return false;
+	VX_ASSERT((nbytes == 0) || (nbytes == slotbytes));
+	memcpy(dst, data, slotbytes);
+	return true;
+}
+
+/*!
+ * @fn int DeviceBuffer::SetSlots(const SlotHandle* slots, const void* const* src, int n)
+ * @param slots	handles of the elements to set
+ * @param src	-> data for each element, the same size as the element
+ * @param n		number of elements to set
+ *
+ * Changes several elements at once, marking a single changed range
+ * which covers all of them. Handles which are not valid for the
+ * layout of this buffer and NULL sources are skipped.
+ *
+ * @returns number of elements changed
+ *
+ * @see DeviceBuffer::Set DataLayout::GetHandle DeviceBuffer::GetDirty
+ */
+int DeviceBuffer::SetSlots(const SlotHandle* slots, const void* const* src, int n)
+{
+	size_t	start = m_Size;
+	size_t	end = 0;
+	int		nset = 0;
+
+	for (int i = 0; i < n; ++i)
+	{
+		int32	nbytes;
+		void*	data = GetSlotData(slots[i], nbytes);
+		size_t	ofs = slots[i].Offset * sizeof(int32);
+
+		if ((data == NULL) || (src[i] == NULL))
+			continue;
+		memcpy(data, src[i], nbytes);
+		if (ofs < start)
+			start = ofs;
+		if (ofs + nbytes > end)
+			end = ofs + nbytes;
+		++nset;
+	}
+	if (nset > 0)
+		MarkDirty(start, end - start);
+	return nset;
+}
+
 
 /*!
  * @fn bool DeviceBuffer::Set(const TCHAR* name, float* src)
@@ -338,15 +622,7 @@ bool DeviceBuffer::Copy(const SharedObj* src_obj)
  */
 bool DeviceBuffer::Set(const TCHAR* name, const float* src)
 {
-	int32	nbytes;
-	float*	data = (float*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		memcpy(data, src, nbytes);
-		return true;
-	}
-	return false;
+	return SetSlot(GetHandle(name), src, 0);
 }
 
 /*!
@@ -364,15 +640,7 @@ bool DeviceBuffer::Set(const TCHAR* name, const float* src)
  */
 bool DeviceBuffer::Set(const TCHAR* name, const int32* src)
 {
-	int32	nbytes;
-	int32*	data = (int32*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		memcpy(data, src, nbytes);
-		return true;
-	}
-	return false;
+	return SetSlot(GetHandle(name), src, 0);
 }
 
 /*!
@@ -387,16 +655,7 @@ bool DeviceBuffer::Set(const TCHAR* name, const int32* src)
  */
 bool DeviceBuffer::Set(const TCHAR* name, const Col4& c)
 {
-	int32	nbytes;
-	Col4*	data = (Col4*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(Col4));
-		*data = c;
-		return true;
-	}
-	return false;
+	return Set(GetHandle(name), c);
 }
 
 /*!
@@ -411,17 +670,7 @@ bool DeviceBuffer::Set(const TCHAR* name, const Col4& c)
  */
 bool DeviceBuffer::Set(const TCHAR* name, const Vec4& v)
 {
-	int32	nbytes;
-	Vec4*	data = (Vec4*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(Vec4));
-		*data = v;
-		return true;
-	}
-	return false;
-
+	return Set(GetHandle(name), v);
 }
 
 /*!
@@ -436,16 +685,7 @@ bool DeviceBuffer::Set(const TCHAR* name, const Vec4& v)
  */
 bool DeviceBuffer::Set(const TCHAR* name, const Vec3& v)
 {
-	int32	nbytes;
-	Vec3*	data = (Vec3*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(Vec3));
-		*data = v;
-		return true;
-	}
-	return false;
+	return Set(GetHandle(name), v);
 }
 
 /*!
@@ -460,16 +700,7 @@ bool DeviceBuffer::Set(const TCHAR* name, const Vec3& v)
  */
 bool DeviceBuffer::Set(const TCHAR* name, const Vec2& v)
 {
-	int32	nbytes;
-	Vec2*	data = (Vec2*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(Vec2));
-		*data = v;
-		return true;
-	}
-	return false;
+	return Set(GetHandle(name), v);
 }
 
 
@@ -485,16 +716,7 @@ bool DeviceBuffer::Set(const TCHAR* name, const Vec2& v)
  */
 bool DeviceBuffer::Set(const TCHAR* name, float v)
 {
-	int32	nbytes;
-	float*	data = (float*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(float));
-		*data = v;
-		return true;
-	}
-	return false;
+	return Set(GetHandle(name), v);
 }
 
 /*!
@@ -509,16 +731,7 @@ bool DeviceBuffer::Set(const TCHAR* name, float v)
  */
 bool DeviceBuffer::Set(const TCHAR* name, int32 v)
 {
-	int32	nbytes;
-	int32*	data = (int32*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(int32));
-		*data = v;
-		return true;
-	}
-	return false;
+	return Set(GetHandle(name), v);
 }
 
 /*!
@@ -533,15 +746,7 @@ bool DeviceBuffer::Set(const TCHAR* name, int32 v)
  */
 bool DeviceBuffer::Get(const TCHAR* name, float& v) const
 {
-	int32	nbytes;
-	float*	data = (float*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		v = *data;
-		return true;
-	}
-	return false;
+	return Get(GetHandle(name), v);
 }
 
 /*!
@@ -559,15 +764,7 @@ bool DeviceBuffer::Get(const TCHAR* name, float& v) const
  */
 bool DeviceBuffer::Get(const TCHAR* name, float* dst) const
 {
-	int32	nbytes;
-	Vec3*	data = (Vec3*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		memcpy(dst, data, nbytes);
-		return true;
-	}
-	return false;
+	return GetSlot(GetHandle(name), dst, 0);
 }
 
 /*!
@@ -586,15 +783,8 @@ bool DeviceBuffer::Get(const TCHAR* name, float* dst) const
 bool DeviceBuffer::Get(const TCHAR* name, int32* dst) const
 {
 	ObjectLock	lock(this);
-	int32		nbytes;
-	void*		data = GetSlotData(name, nbytes);
 
-	if (data)
-	{
-		memcpy(dst, data, nbytes);
-		return true;
-	}
-	return false;
+	return GetSlot(GetHandle(name), dst, 0);
 }
 
 /*!
@@ -610,16 +800,8 @@ bool DeviceBuffer::Get(const TCHAR* name, int32* dst) const
 bool DeviceBuffer::Get(const TCHAR* name, Col4& c) const
 {
 	ObjectLock	lock(this);
-	int32		nbytes;
-	Col4*		data = (Col4*) GetSlotData(name, nbytes);
 
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(Col4));
-		c = *data;
-		return true;
-	}
-	return false;
+	return Get(GetHandle(name), c);
 }
 
 /*!
@@ -635,17 +817,8 @@ bool DeviceBuffer::Get(const TCHAR* name, Col4& c) const
 bool DeviceBuffer::Get(const TCHAR* name, Vec4& v) const
 {
 	ObjectLock	lock(this);
-	int32		nbytes;
-	Vec4*		data = (Vec4*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(Vec4));
-		v = *data;
-		return true;
-	}
-	return false;
 
+	return Get(GetHandle(name), v);
 }
 
 /*!
@@ -661,17 +834,8 @@ bool DeviceBuffer::Get(const TCHAR* name, Vec4& v) const
 bool DeviceBuffer::Get(const TCHAR* name, Vec3& v) const
 {
 	ObjectLock	lock(this);
-	int32		nbytes;
-	Vec3*		data = (Vec3*) GetSlotData(name, nbytes);
-
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(Vec3));
-		v = *data;
-		return true;
-	}
-	return false;
 
+	return Get(GetHandle(name), v);
 }
 
 /*!
@@ -687,16 +851,8 @@ bool DeviceBuffer::Get(const TCHAR* name, Vec3& v) const
 bool DeviceBuffer::Get(const TCHAR* name, Vec2& v) const
 {
 	ObjectLock	lock(this);
-	int32		nbytes;
-	Vec2*		data = (Vec2*) GetSlotData(name, nbytes);
 
-	if (data)
-	{
-		VX_ASSERT(nbytes == sizeof(Vec2));
-		v = *data;
-		return true;
-	}
-	return false;
+	return Get(GetHandle(name), v);
 }
 
 }	// end Vixen
\ No newline at end of file
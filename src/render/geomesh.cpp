@@ -30,6 +30,7 @@ VX_IMPLEMENT_CLASSID(Mesh, Geometry, VX_Mesh);
 Geometry::Geometry(const Geometry& src) : SharedObj(src)
 {
 	DevHandle = NULL;
+	m_NumShapes = 0;
 	Copy(&src);
 }
 
@@ -188,6 +189,8 @@ Mesh::Mesh()
 	m_Bound.Empty();
 	m_Verts = new VertexArray();
 	m_StartVtx = m_EndVtx = 0;
+	m_MemCharged = 0;
+	m_IndexSize = 0;
 }
 
 Mesh::Mesh(int style, intptr nvtx)
@@ -196,6 +199,8 @@ Mesh::Mesh(int style, intptr nvtx)
 	m_Bound.Empty();
 	m_Verts = new VertexArray(style, nvtx);
 	m_StartVtx = m_EndVtx = 0;
+	m_MemCharged = 0;
+	m_IndexSize = 0;
 }
 
 /*!
@@ -216,6 +221,8 @@ Mesh::Mesh(const TCHAR* layout_desc, intptr nvtx)
 	m_Bound.Empty();
 	m_Verts = new VertexArray(layout_desc, nvtx);
 	m_StartVtx = m_EndVtx = 0;
+	m_MemCharged = 0;
+	m_IndexSize = 0;
 }
 
 /*!
@@ -233,8 +240,58 @@ Mesh::Mesh(const Mesh& src) : Geometry(src)
 	m_StartVtx = src.m_StartVtx;
 	m_EndVtx = src.m_EndVtx;
 	m_Bound = src.m_Bound;
+	m_MemCharged = 0;
+	m_IndexSize = 0;
 	if (src.GetNumIdx())
 		m_VtxIndex = src.m_VtxIndex;
+	UpdateMemStats();
+}
+
+Mesh::~Mesh()
+{
+	Core::MemStats::Charge(Core::MemStats::INDEX, -m_MemCharged);
+}
+
+/*
+ * Charge the bytes allocated for the index array to index memory.
+ * An index array shared by several meshes is charged to each of them.
+ */
+void Mesh::UpdateMemStats()
+{
+	intptr	bytes = m_VtxIndex.IsNull() ? 0 : m_VtxIndex->GetMaxSize() * sizeof(int32);
+
+	if (bytes == m_MemCharged)
+		return;
+	Core::MemStats::Charge(Core::MemStats::INDEX, bytes - m_MemCharged);
+	m_MemCharged = bytes;
+}
+
+/*!
+ * @fn int Mesh::FindIndexSize(const IndexArray* inds)
+ * @param inds	indices to check, the caller should hold the array's lock
+ *
+ * Scans the input indices to find out how many bytes each index needs
+ * in a device index buffer. Device index buffers call this when they
+ * upload the indices so the size always matches the data on the device,
+ * even if the array was filled in after it was attached to the mesh or
+ * was changed through another mesh that shares it.
+ *
+ * @return 2 if every index fits in 16 bits, otherwise 4
+ *
+ * @see Mesh::GetIndexSize
+ */
+int Mesh::FindIndexSize(const IndexArray* inds)
+{
+	const int32*	data;
+	intptr			n;
+
+	if ((inds == NULL) || ((n = inds->GetSize()) == 0))
+		return sizeof(uint16);
+	data = inds->GetData();
+	for (intptr i = 0; i < n; ++i)
+		if ((uint32) data[i] >= 0xFFFF)
+			return sizeof(int32);
+	return sizeof(uint16);
 }
 
 void Mesh::Empty()
@@ -244,6 +301,7 @@ void Mesh::Empty()
 	m_Bound.Empty();
 	m_Verts->SetNumVtx(0);
 	m_VtxIndex = (IndexArray*) NULL;
+	UpdateMemStats();
 	m_StartVtx = 0;
 	m_EndVtx =0;
 	Touch();
@@ -340,7 +398,10 @@ bool Mesh::SetIndex(intptr i, intptr v)
 	m_VtxIndex = idx;
 	SetChanged(true);
 	VX_ASSERT(v < INT_MAX);
-	return idx->SetAt(i, (int32) v);
+	if (!idx->SetAt(i, (int32) v))
+		return false;
+	UpdateMemStats();
+	return true;
 }
 
 /*!
@@ -352,7 +413,9 @@ bool Mesh::SetIndex(intptr i, intptr v)
  * are added. Multiple meshes may share the same index array.
  *
  * @note index values may be either short or long depending on
- * the operating system and display device.
+ * the operating system and display device. The largest index is
+ * found when the array is attached, so if you change the indices
+ * in the array directly, call SetIndices again afterwards.
  *
  * @see Mesh::SetStyle Mesh::SetVertices
  */
@@ -363,6 +426,7 @@ void Mesh::SetIndices(IndexArray* inds)
 	VX_STREAM_END( )
 
 	m_VtxIndex = inds;
+	UpdateMemStats();
 }
 
 
@@ -416,6 +480,7 @@ intptr Mesh::AddIndices(const int32* idx, intptr n)
 	else ofs = m_VtxIndex->GetSize();
 	if (!m_VtxIndex->SetSize(n + ofs))
 		return -1;
+	UpdateMemStats();
 	if (idx == NULL)
 		return ofs;
 	VertexIndex*	iptr = (VertexIndex*) m_VtxIndex->GetData();
@@ -649,6 +714,7 @@ bool Mesh::Copy(const SharedObj* src_obj)
 		m_Verts = (VertexArray*) src->m_Verts->Clone();
 		if (!src->m_VtxIndex.IsNull())
 			m_VtxIndex = (IndexArray*) src->m_VtxIndex->Clone();
+		UpdateMemStats();
 	}
 	return true;
 }
@@ -15,6 +15,7 @@ using namespace Core;
  */
 static void tri_normal(const Vec3*, const Vec3*, const Vec3*, Vec3*, Vec3*, Vec3*);
 static void tri_normals(Mesh*);
+static bool compact_normals(Mesh*, bool);
 
 /*!
  * @fn bool TriMesh::MakeNormals(bool noclear)
@@ -29,6 +30,9 @@ static void tri_normals(Mesh*);
  * If you are computing normals on a vertex pool shared among
  * multiple meshes, use the  noclear flag for meshes after
  * the first so normals of shared vertices are averaged properly.
+ * Normals in a compact format are accumulated as floats and
+ * encoded when they are done. With the noclear flag, the decoded
+ * unit normals are used as the starting point.
  *
  * @return  true if normals were generated, else  false
  *
@@ -41,8 +45,8 @@ bool TriMesh::MakeNormals(bool noclear)
 	VertexPool::Iter	iter(verts);
 	intptr				nverts = verts->GetNumVtx();
 
-	if (!iter.HasNormals())
-		return false;
+	if (!iter.HasNormals())				// no float normals?
+		return compact_normals(this, noclear);
 	/*
 	 * Clear all normals to zero - can be done in parallel.
 	 */
@@ -124,6 +128,65 @@ static void tri_normals(Mesh* geo)
 		}
 }
 
+/****
+ *
+ * Generate the normals for a mesh whose normals are in a compact format.
+ * Locations are decoded, normals are accumulated in a temporary float
+ * array and encoded into the vertices at the end.
+ *
+ ****/
+static bool compact_normals(Mesh* geo, bool noclear)
+{
+	VertexArray*			verts = geo->GetVertices();
+	const DataLayout*		layout = verts->GetLayout();
+	VertexPool::DecodeIter	iter(verts);
+	intptr					nverts = iter.GetNumVtx();
+	int32*					data = (int32*) verts->GetData();
+	int						vtxsize = verts->GetVtxSize();
+	bool					indexed = (geo->GetNumIdx() > 0);
+	const LayoutSlot*		slot = NULL;
+	intptr					ind0, ind1, ind2;
+	Vec3					p0, p1, p2;
+	Vec3*					nmls;
+
+	for (int i = 0; i < layout->NumSlots; ++i)
+		if (layout->Slot[i].Style & VertexPool::NORMALS)
+		{
+			slot = &(layout->Slot[i]);
+			break;
+		}
+	if ((slot == NULL) || (nverts == 0))
+		return false;
+	nmls = (Vec3*) ThreadAllocator::Get()->Alloc(nverts * sizeof(Vec3));
+	if (nmls == NULL)
+		VX_ERROR(("TriMesh::MakeNormals ERROR out of memory\n"), false);
+	for (intptr i = 0; i < nverts; ++i)
+		if (!noclear || !iter.GetNormal(i, nmls[i]))
+			nmls[i].Set(0, 0, 0);
+	TriMesh::TriIter triter((TriMesh*) geo);
+	while (triter.Next(ind0, ind1, ind2))
+	{
+		if ((ind0 >= nverts) || (ind1 >= nverts) || (ind2 >= nverts))
+			continue;					// vertex index out of range?
+		iter.GetLoc(ind0, p0);
+		iter.GetLoc(ind1, p1);
+		iter.GetLoc(ind2, p2);
+		if (indexed)
+			tri_normal(&p0, &p2, &p1, &nmls[ind0], &nmls[ind1], &nmls[ind2]);
+		else
+			tri_normal(&p0, &p1, &p2, &nmls[ind0], &nmls[ind1], &nmls[ind2]);
+	}
+	#pragma omp PARALLEL_FOR(nverts)
+	cilk_for (intptr j = 0; j < nverts; ++j)
+	{
+		nmls[j].Normalize();
+		VertexPool::EncodeSlot(*slot, &nmls[j].x, data + j * vtxsize, verts->GetQuantScale(), verts->GetQuantOffset());
+	}
+	ThreadAllocator::Get()->Free(nmls);
+	verts->SetChanged(true);
+	return true;
+}
+
 /****
  *
  * Compute vertex normals for a triangle.
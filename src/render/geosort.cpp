@@ -10,6 +10,7 @@ VX_IMPLEMENT_CLASS(GeoSorter, Renderer);
 
 int GeoSorter::MaxStates = 256;
 int GeoSorter::StateMask = (MaxStates - 1);	// mask to keep within range of MaxStates
+int GeoSorter::MinInstances = 4;				// copies of a mesh needed to render instances
 
 
 /*!
@@ -55,11 +56,22 @@ bool Renderer::Init(Scene* scene, Vixen::Window win, const TCHAR* options)
 	return scene != NULL;
 }
 
+/*!
+ * @fn void Renderer::Reset()
+ *
+ * Called from the display traversal thread at the start of each frame.
+ * Transforms the light sources and, if LightList::DoClusterLights is set,
+ * assigns them to cells of the camera view volume so that finding
+ * the lights near each shape only examines nearby lights.
+ *
+ * @see LightList::UpdateAll LightList::BuildClusters
+ */
 void Renderer::Reset()
 {
-	m_LightList.LightsOn(uint32(-1));
-	m_LightList.LightsOff(uint32(-1));
+	m_LightList.LightsOn(NULL, 0);			// all active lights on
 	m_LightList.UpdateAll();				// transform light sources
+	if (m_LightList.DoClusterLights && m_Scene)
+		m_LightList.BuildClusters(m_Scene->GetCamera());
 }
 
 void Renderer::Begin(int changed, int frame)
@@ -91,14 +103,52 @@ intptr Renderer::AddLight(Light* light)
 	return prop->DevIndex;
 }
 
+/*!
+ * @fn void Renderer::RenderInstances(const Geometry* geo, const Appearance* appear, const Instance* inst, int n)
+ * @param geo		geometry to render
+ * @param appear	appearance to render it with
+ * @param inst		array of per-instance world matrices
+ * @param n			number of instances
+ *
+ * Called from the rendering thread to render several copies of the same
+ * geometry and appearance in one batch. All of the instances are
+ * illuminated by the lights enabled with LightList::LightsOn. Renderers which support hardware
+ * instancing should override this function and copy the instance array
+ * to the device. The default implementation renders each instance
+ * separately with Renderer::RenderMesh.
+ *
+ * @see GeoSorter::DrawBatch Renderer::RenderMesh
+ */
+void Renderer::RenderInstances(const Geometry* geo, const Appearance* appear, const Instance* inst, int n)
+{
+	Matrix	world[2];	// alternate so renderers which compare matrix addresses see each change
+	int		cur = 0;
+
+	for (int i = 0; i < n; ++i)
+	{
+		const float*	src = inst[i].Transform;
+		float			data[16];
+
+		memcpy(data, src, 12 * sizeof(float));
+		data[12] = data[13] = data[14] = 0.0f;
+		data[15] = 1.0f;
+		cur ^= 1;
+		world[cur].SetMatrix(data);
+		RenderMesh(geo, appear, &world[cur]);
+	}
+}
+
 /*!
  * GeoSorter::GeoSorter(int options)
  * @param options	GeoSorter::Flatten will flatten this hierarchy by
  *					removing all matrices and applying them to the geometry.
+ *					GeoSorter::NoInstancing disables instanced rendering.
  */
 GeoSorter::GeoSorter(int options)
   :	Renderer(options)
 {
+	m_AllLights = NULL;
+	m_NumAllLights = -1;
 	SetOptions(options);
 	m_States.SetMaxSize(256);
 }
@@ -110,16 +160,16 @@ void GeoSorter::Exit(bool shutdown)
 }
 
 /*!
- * @fn bool GeoSorter::AddShape(const Shape* shape, const Matrix* mtx, int32 lightmask)
+ * @fn bool GeoSorter::AddShape(const Shape* shape, const Matrix* mtx)
  * @param	shape	shape whose geometry should be added
  * @param	mtx		pointer to world matrix for shape, if NULL camera matrix is used
- * @param	lightmask bit mask for lights which illuminate this shape
  *
  * Adds the meshes in the given shape to this sorter
  * to be rendered later. This step sorts the meshes
- * into different buckets based on the appearance of each.
+ * into different buckets based on the appearance of each
+ * and finds the lights which illuminate the shape.
  */
-int GeoSorter::AddShape(const Shape* shape, const Matrix* mtx, int32 lightmask)
+int GeoSorter::AddShape(const Shape* shape, const Matrix* mtx)
 {
 	const Geometry*		geo = shape->GetGeometry();
 	const Appearance*	appear;
@@ -135,11 +185,11 @@ int GeoSorter::AddShape(const Shape* shape, const Matrix* mtx, int32 lightmask)
 		stateindex = appear->GetAppIndex();
 	else
 		stateindex = 1;
-	newprim = AddPrim(shape, stateindex, mtx, lightmask);
+	newprim = AddPrim(shape, stateindex, mtx);
 	return stateindex;
 }
 
-GeoSorter::RenderPrim* GeoSorter::AddPrim(const Shape* shape, int stateindex, const Matrix* mtx, int32 lightmask)
+GeoSorter::RenderPrim* GeoSorter::AddPrim(const Shape* shape, int stateindex, const Matrix* mtx)
 {
 	RenderPrim* newprim = new (&m_FrameAlloc) RenderPrim(shape);
 	m_IsEmpty = false;
@@ -151,11 +201,55 @@ GeoSorter::RenderPrim* GeoSorter::AddPrim(const Shape* shape, int stateindex, co
 	}
 	if (mtx)
 		newprim->Matrix = new (&m_FrameAlloc) Matrix(*mtx);
-	newprim->LightMask = lightmask;
+	AddLights(newprim, mtx);
 	SetState(stateindex, newprim);
 	return newprim;
 }
 
+/*!
+ * @fn void GeoSorter::AddLights(RenderPrim* prim, const Matrix* mtx)
+ * @param prim	primitive to find lights for
+ * @param mtx	world matrix of primitive, NULL for world coordinates
+ *
+ * Finds the lights near the primitive (using the light cells built
+ * by LightList::BuildClusters if they are available) and saves their
+ * indices with the primitive (allocated from the frame heap).
+ * If lights are neither culled by distance nor clustered, every
+ * primitive is lit by the same lights and they share one list.
+ *
+ * @see LightList::NearLights RenderPrim::Lights
+ */
+void GeoSorter::AddLights(RenderPrim* prim, const Matrix* mtx)
+{
+	uint16	ids[LIGHT_MaxLights];
+	bool	shared = !m_LightList.DoDistanceCull && !m_LightList.IsClustered();
+	int		n;
+	uint16*	lights;
+
+	if (shared && (m_NumAllLights >= 0))
+	{
+		prim->Lights = m_AllLights;
+		prim->NumLights = m_NumAllLights;
+		return;
+	}
+	n = m_LightList.NearLights(prim->Shape, mtx, ids, LIGHT_MaxLights);
+	lights = NULL;
+	if (n > 0)
+	{
+		lights = (uint16*) m_FrameAlloc.Alloc(n * sizeof(uint16));
+		if (lights == NULL)
+			return;
+		memcpy(lights, ids, n * sizeof(uint16));
+	}
+	prim->Lights = lights;
+	prim->NumLights = n;
+	if (shared)
+	{
+		m_AllLights = lights;
+		m_NumAllLights = n;
+	}
+}
+
 
 /*!
  * @fn int GeoSorter::CompareZ(const RenderPrim* p1, const RenderPrim* p2)
@@ -193,6 +287,34 @@ int GeoSorter::CompareZ(const RenderPrim* p1, const RenderPrim* p2)
 	return 0;
 }
 
+/*!
+ * @fn int GeoSorter::CompareGeo(const RenderPrim* p1, const RenderPrim* p2)
+ * Internal routine to compare RenderPrims based on their geometry, appearance
+ * and lights. Used to group copies of the same mesh together so they can be
+ * rendered as instances. Only the addresses of the geometry and appearance
+ * are compared, the light indices are compared if the lists differ.
+ */
+int GeoSorter::CompareGeo(const RenderPrim* p1, const RenderPrim* p2)
+{
+	intptr	g1 = (intptr) p1->Shape->GetGeometry();
+	intptr	g2 = (intptr) p2->Shape->GetGeometry();
+
+	if (g1 == g2)
+	{
+		g1 = (intptr) p1->Shape->GetAppearance();
+		g2 = (intptr) p2->Shape->GetAppearance();
+	}
+	if (g1 < g2)
+		return -1;
+	if (g1 > g2)
+		return 1;
+	if (p1->Lights == p2->Lights)
+		return p1->NumLights - p2->NumLights;
+	if (p1->NumLights != p2->NumLights)
+		return p1->NumLights - p2->NumLights;
+	return memcmp(p1->Lights, p2->Lights, p1->NumLights * sizeof(uint16));
+}
+
 
 /*!
  * @fn void GeoSorter::Render(int opts)
@@ -201,6 +323,13 @@ int GeoSorter::CompareZ(const RenderPrim* p1, const RenderPrim* p2)
  *	- GeoSorter::Opaque render only opaque primitves
  *	- GeoSorter::Transparent render only transparent primitives
  *	- GeoSorter::All render all primitives
+ *
+ * If the GeoSorter::RecordCommands option is set, the primitives are
+ * recorded into a RenderStream which is then replayed against this renderer.
+ * The stream is kept until the next frame and may be retrieved
+ * with GeoSorter::GetCommands.
+ *
+ * @see GeoSorter::Record RenderStream::Replay
  */
 void GeoSorter::Render(int frame, int opts)
 {
@@ -208,6 +337,20 @@ void GeoSorter::Render(int frame, int opts)
 		return;
 	if (m_States.GetSize() == 0)
 		return;
+	if (m_Options & RecordCommands)
+	{
+		if (m_Commands.IsNull())
+			m_Commands = new RenderStream;
+		m_Commands->Empty();
+		m_Commands->BeginFrame(frame);
+		if (opts & Opaque)
+			Record(m_Commands, Opaque, (int32) m_States.GetSize());
+		if ((opts & Transparent) &&
+			SortBin((RenderPrim**) &m_States.GetAt(0), &CompareZ))
+			Record(m_Commands, Transparent, Transparent + 1);
+		m_Commands->Replay(this);
+		return;
+	}
 	if (opts & Opaque)					// render opaque stuff?
 	{
 		for (int stateindex = Opaque; stateindex < (int) m_States.GetSize(); ++stateindex)
@@ -255,14 +398,126 @@ bool GeoSorter::SortBin(RenderPrim** listhead, CompareFunc* cmpfunc)
 	return true;
 }
 
+/*!
+ * @fn GeoSorter::RenderPrim* GeoSorter::SortList(RenderPrim* list, CompareFunc* cmpfunc)
+ * @param list		first primitive in list to sort
+ * @param cmpfunc	function to compare two primitives
+ *
+ * Merge sorts a list of primitives. Unlike GeoSorter::SortBin,
+ * this is fast enough for buckets with thousands of primitives.
+ *
+ * @return first primitive of sorted list
+ */
+GeoSorter::RenderPrim* GeoSorter::SortList(RenderPrim* list, CompareFunc* cmpfunc)
+{
+	RenderPrim*	fast;
+	RenderPrim*	slow;
+	RenderPrim*	head;
+	RenderPrim**	tail = &head;
+
+	if ((list == NULL) || (list->Next == NULL))
+		return list;
+	slow = list;						// split the list in half
+	fast = (RenderPrim*) list->Next;
+	while (fast && fast->Next)
+	{
+		slow = (RenderPrim*) slow->Next;
+		fast = (RenderPrim*) fast->Next->Next;
+	}
+	fast = (RenderPrim*) slow->Next;
+	slow->Next = NULL;
+	slow = SortList(list, cmpfunc);		// sort each half
+	fast = SortList(fast, cmpfunc);
+	while (slow && fast)				// merge the halves
+	{
+		if ((*cmpfunc)(fast, slow) < 0)
+		{
+			*tail = fast;
+			fast = (RenderPrim*) fast->Next;
+		}
+		else
+		{
+			*tail = slow;
+			slow = (RenderPrim*) slow->Next;
+		}
+		tail = (RenderPrim**) &((*tail)->Next);
+	}
+	*tail = slow ? slow : fast;
+	return head;
+}
+
+/*!
+ * @fn void GeoSorter::RenderState(int32 stateindex)
+ * @param stateindex	index of state bucket to render
+ *
+ * Renders all the primitives in a state bucket. Unless instancing is
+ * disabled (GeoSorter::NoInstancing), opaque buckets are sorted so that
+ * copies of the same geometry, appearance and lights are adjacent and runs of at
+ * least GeoSorter::MinInstances copies are rendered as a single batch of instances.
+ * The transparent bucket is Z sorted and always renders one primitive at a time.
+ *
+ * @see GeoSorter::DrawState Renderer::RenderInstances
+ */
 void GeoSorter::RenderState(int32 stateindex)
+{
+	DrawState(stateindex, NULL);
+}
+
+/*!
+ * @fn void GeoSorter::DrawState(int32 stateindex, RenderStream* stream)
+ * @param stateindex	index of state bucket to render
+ * @param stream		stream to record commands into,
+ *						NULL to call the renderer directly
+ *
+ * Walks the primitives in a state bucket and either renders them
+ * or records the commands to render them. Both GeoSorter::RenderState
+ * and GeoSorter::Record use this so the bucket is sorted and split
+ * into instance batches the same way whether or not it is recorded.
+ *
+ * @see GeoSorter::DrawBatch GeoSorter::RenderState GeoSorter::Record
+ */
+void GeoSorter::DrawState(int32 stateindex, RenderStream* stream)
 {
 	RenderPrim* prim = GetState(stateindex);
+	bool		instancing = (stateindex != Transparent) && !(m_Options & NoInstancing) && (MinInstances > 1);
+
+	if (instancing && prim && prim->Next)
+	{
+		prim = SortList(prim, &CompareGeo);	// group copies of the same mesh
+		SetState(stateindex, prim);
+	}
 	while (prim)
 	{
 		const Shape*	shape = prim->Shape;
 
-		m_LightList.LightsOn(prim->LightMask);
+		if (instancing)
+		{
+			RenderPrim*	next = (RenderPrim*) prim->Next;
+			int			n = 1;
+
+			while (next && (CompareGeo(prim, next) == 0))
+			{
+				next = (RenderPrim*) next->Next;
+				++n;
+			}
+			if (n >= MinInstances)
+			{
+				DrawBatch(prim, n, stream);
+				prim = next;
+				continue;
+			}
+		}
+		if (stream)							// recording commands?
+		{
+			stream->SetLights(prim->Lights, prim->NumLights);
+			stream->SetAppearance(shape->GetAppearance());
+			stream->SetMatrix(prim->Matrix);
+			stream->Draw(shape->GetGeometry());
+			prim = (RenderPrim*) prim->Next;
+			shape->SetRendered(true);
+			continue;
+		}
+		m_LightList.LightsOn(prim->Lights, prim->NumLights);
 	#if _TRACE > 1
 		if ((Appearance::Debug > 1) || (Scene::Debug > 1))
 		{
@@ -285,6 +540,75 @@ void GeoSorter::RenderState(int32 stateindex)
 	}
 }
 
+/*!
+ * @fn void GeoSorter::DrawBatch(RenderPrim* prim, int n, RenderStream* stream)
+ * @param prim		first primitive in batch
+ * @param n			number of primitives in batch
+ * @param stream	stream to record commands into,
+ *					NULL to call the renderer directly
+ *
+ * Renders or records a run of primitives which all have the same geometry,
+ * appearance and lights. The lights are enabled once for the batch and
+ * the world matrices of the primitives are packed into an instance array.
+ * When recording, the instance array is stored in the stream itself.
+ * Otherwise it is allocated from the frame heap and passed to
+ * Renderer::RenderInstances.
+ *
+ * @see GeoSorter::DrawState RenderStream::DrawInstances Renderer::Instance
+ */
+void GeoSorter::DrawBatch(RenderPrim* prim, int n, RenderStream* stream)
+{
+	const Shape*	shape = prim->Shape;
+	const float*	identity = Matrix::GetIdentity()->GetMatrix();
+	Instance*		inst;
+
+	if (stream)
+	{
+		stream->SetLights(prim->Lights, prim->NumLights);
+		stream->SetAppearance(shape->GetAppearance());
+		inst = stream->DrawInstances(shape->GetGeometry(), n);
+	}
+	else
+	{
+		inst = (Instance*) m_FrameAlloc.Alloc(n * sizeof(Instance));
+		m_LightList.LightsOn(prim->Lights, prim->NumLights);
+	}
+	if (inst == NULL)
+		VX_ERROR_RETURN(("GeoSorter::DrawBatch ERROR out of memory for %d instances\n", n));
+	for (int i = 0; i < n; ++i)
+	{
+		const float*	src = prim->Matrix ? prim->Matrix->GetMatrix() : identity;
+
+		memcpy(inst[i].Transform, src, 12 * sizeof(float));
+		prim->Shape->SetRendered(true);
+		prim = (RenderPrim*) prim->Next;
+	}
+	if (stream == NULL)
+		RenderInstances(shape->GetGeometry(), shape->GetAppearance(), inst, n);
+}
+
+/*!
+ * @fn void GeoSorter::Record(RenderStream* stream, int32 first, int32 last)
+ * @param stream	stream to record commands into
+ * @param first		index of first state bucket to record
+ * @param last		index after the last state bucket to record
+ *
+ * Records the commands to render a range of state buckets without
+ * calling the renderer. The buckets are sorted for instancing the
+ * same way as GeoSorter::RenderState. Different threads may record
+ * disjoint ranges of buckets into different streams which are
+ * then combined with RenderStream::Append.
+ *
+ * @see RenderStream GeoSorter::DrawState
+ */
+void GeoSorter::Record(RenderStream* stream, int32 first, int32 last)
+{
+	VX_ASSERT(stream);
+	if (last > (int32) m_States.GetSize())
+		last = (int32) m_States.GetSize();
+	for (int32 stateindex = first; stateindex < last; ++stateindex)
+		DrawState(stateindex, stream);
+}
 
 /*!
  * @fn void GeoSorter::Reset()
@@ -310,6 +634,8 @@ void	GeoSorter::Reset()
 		m_IsEmpty = true;
 	}
 	m_FrameAlloc.Empty();
+	m_AllLights = NULL;
+	m_NumAllLights = -1;
 }
 
 /*!
@@ -0,0 +1,334 @@
+#include "vixen.h"
+#include "render/vxglyphatlas.h"
+
+namespace Vixen {
+
+VX_IMPLEMENT_CLASS(GlyphAtlas, SharedObj);
+
+int GlyphAtlas::Padding = 1;
+
+/*!
+ * @fn GlyphAtlas::GlyphAtlas(int width, int height)
+ * @param width		pixel width of atlas texture
+ * @param height	pixel height of atlas texture
+ *
+ * Makes an empty atlas and the texture which displays it.
+ * The atlas has no glyphs until a font is set with GlyphAtlas::SetFont.
+ *
+ * @see GlyphAtlas::SetFont GlyphAtlas::GetTexture
+ */
+GlyphAtlas::GlyphAtlas(int width, int height) : SharedObj()
+{
+	Bitmap*	bmap = new Bitmap;
+
+	memset(&m_Atlas, 0, sizeof(TexFont));
+	m_Source = NULL;
+	m_PixelSize = Bitmap::FontDepth / 8;
+	m_Atlas.tex_width = width;
+	m_Atlas.tex_height = height;
+	m_Atlas.teximage = (unsigned char*) calloc(width * height, m_PixelSize);
+	m_MaxNodes = 16;
+	m_Skyline = (SkyNode*) malloc(m_MaxNodes * sizeof(SkyNode));
+	m_Skyline[0].X = 0;
+	m_Skyline[0].Y = 0;
+	m_Skyline[0].Width = width;
+	m_NumNodes = 1;
+	m_UsedArea = 0;
+	m_Changed = false;
+	bmap->Type = Bitmap::FONT;
+	bmap->Data = &m_Atlas;
+	bmap->Width = width;
+	bmap->Height = height;
+	bmap->Depth = Bitmap::FontDepth;
+	bmap->Format = Bitmap::HASALPHA | Bitmap::NOFREE_DATA;
+	bmap->ByteSize = width * height * m_PixelSize;
+	bmap->UpdateMemStats();
+	m_Texture = new Texture;
+	m_Texture->SetBitmap(bmap);
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+	m_Texture->SetBitmap((Bitmap*) NULL);	// texture may outlive the atlas
+	m_Texture = (Texture*) NULL;
+	FreeGlyphs();
+	if (m_Atlas.teximage)
+		free(m_Atlas.teximage);
+	free(m_Skyline);
+}
+
+void GlyphAtlas::FreeGlyphs()
+{
+	if (m_Atlas.tgvi)
+		free(m_Atlas.tgvi);
+	if (m_Atlas.lut)
+		free(m_Atlas.lut);
+	m_Atlas.tgvi = NULL;
+	m_Atlas.lut = NULL;
+	m_Atlas.num_glyphs = 0;
+	m_Atlas.range = 0;
+}
+
+/*!
+ * @fn bool GlyphAtlas::SetFont(TexFont* font)
+ * @param font	font to copy glyphs from
+ *
+ * Establishes the font whose glyphs are put into the atlas.
+ * The atlas is emptied and has room for any of the characters
+ * in the source font. The source font must stay loaded as
+ * long as glyphs may be added from it.
+ *
+ * @return \b true if font was set, \b false if out of memory
+ *
+ * @see GlyphAtlas::GetGlyph TextGeometry::GetTextExtent
+ */
+bool GlyphAtlas::SetFont(TexFont* font)
+{
+	Empty();
+	FreeGlyphs();
+	m_Source = font;
+	if (font == NULL)
+		return true;
+	m_Atlas.max_ascent = font->max_ascent;
+	m_Atlas.max_descent = font->max_descent;
+	m_Atlas.min_glyph = font->min_glyph;
+	m_Atlas.tgvi = (TexGlyphVertexInfo*) calloc(font->range, sizeof(TexGlyphVertexInfo));
+	m_Atlas.lut = (TexGlyphVertexInfo**) calloc(font->range, sizeof(TexGlyphVertexInfo*));
+	if ((m_Atlas.tgvi == NULL) || (m_Atlas.lut == NULL))
+	{
+		FreeGlyphs();
+		m_Source = NULL;
+		VX_ERROR(("GlyphAtlas::SetFont ERROR out of memory for %d glyphs\n", font->range), false);
+	}
+	m_Atlas.range = font->range;
+	return true;
+}
+
+/*!
+ * @fn void GlyphAtlas::Empty()
+ *
+ * Removes all of the glyphs from the atlas and clears its texture.
+ * Text which refers to glyphs in the atlas must be regenerated.
+ */
+void GlyphAtlas::Empty()
+{
+	if (m_Atlas.teximage)
+		memset(m_Atlas.teximage, 0, m_Atlas.tex_width * m_Atlas.tex_height * m_PixelSize);
+	if (m_Atlas.lut)
+		memset(m_Atlas.lut, 0, m_Atlas.range * sizeof(TexGlyphVertexInfo*));
+	m_Skyline[0].X = 0;
+	m_Skyline[0].Y = 0;
+	m_Skyline[0].Width = m_Atlas.tex_width;
+	m_NumNodes = 1;
+	m_UsedArea = 0;
+	m_Atlas.num_glyphs = 0;
+	m_Changed = true;
+}
+
+/*!
+ * @fn const TexGlyphVertexInfo* GlyphAtlas::GetGlyph(int c)
+ * @param c	character code
+ *
+ * Finds the glyph for a character. If it is not in the atlas yet,
+ * it is copied from the source font. The texture coordinates in
+ * the glyph information select the glyph within the atlas texture.
+ * Like the font, missing upper or lower case letters are replaced
+ * by their counterparts.
+ *
+ * @return glyph information, NULL if the font does not have
+ *	the character or there is no more room in the atlas
+ *
+ * @see GlyphAtlas::UpdateTexture
+ */
+const TexGlyphVertexInfo* GlyphAtlas::GetGlyph(int c)
+{
+	const TexGlyphVertexInfo*	src;
+	int							index = c - m_Atlas.min_glyph;
+
+	if ((m_Source == NULL) || (index < 0) || (index >= m_Atlas.range))
+		return NULL;
+	if (m_Atlas.lut[index])
+		return m_Atlas.lut[index];
+	src = getTCVI(m_Source, c);
+	if ((src == NULL) || !AddGlyph(c, src))
+		return NULL;
+	return m_Atlas.lut[index];
+}
+
+/*
+ * Copy the pixels of a glyph from the source font into
+ * the atlas and compute its texture coordinates in the atlas.
+ */
+bool GlyphAtlas::AddGlyph(int c, const TexGlyphVertexInfo* src)
+{
+	const TexGlyphInfo*	tgi = &m_Source->tgi[src - m_Source->tgvi];
+	TexGlyphVertexInfo*	dst = &m_Atlas.tgvi[c - m_Atlas.min_glyph];
+	int					w = tgi->width;
+	int					h = tgi->height;
+	int					x = 0, y = 0;
+	float				fw = (float) m_Atlas.tex_width;
+	float				fh = (float) m_Atlas.tex_height;
+	float				xstep = 0.5f / fw;
+	float				ystep = 0.5f / fh;
+
+	if ((w > 0) && (h > 0))
+	{
+		if (!Pack(w + Padding, h + Padding, &x, &y))
+			return false;
+		for (int row = 0; row < h; ++row)
+			memcpy(m_Atlas.teximage + ((y + row) * m_Atlas.tex_width + x) * m_PixelSize,
+				   m_Source->teximage + ((tgi->y + row) * m_Source->tex_width + tgi->x) * m_PixelSize,
+				   w * m_PixelSize);
+		m_UsedArea += w * h;
+		m_Changed = true;
+	}
+	*dst = *src;
+	dst->t0[0] = x / fw + xstep;
+	dst->t0[1] = y / fh + ystep;
+	dst->t1[0] = (x + w) / fw + xstep;
+	dst->t1[1] = y / fh + ystep;
+	dst->t2[0] = (x + w) / fw + xstep;
+	dst->t2[1] = (y + h) / fh + ystep;
+	dst->t3[0] = x / fw + xstep;
+	dst->t3[1] = (y + h) / fh + ystep;
+	m_Atlas.lut[c - m_Atlas.min_glyph] = dst;
+	++m_Atlas.num_glyphs;
+	return true;
+}
+
+/*
+ * Return the Y coordinate where a rectangle would go if its left edge
+ * were at the start of the given skyline segment, -1 if it does not fit.
+ */
+int32 GlyphAtlas::Fit(int32 index, int w, int h) const
+{
+	int32	y = 0;
+	int32	left = w;
+
+	if (m_Skyline[index].X + w > m_Atlas.tex_width)
+		return -1;
+	while ((left > 0) && (index < m_NumNodes))
+	{
+		const SkyNode&	node = m_Skyline[index++];
+
+		if (node.Y > y)
+			y = node.Y;
+		if (y + h > m_Atlas.tex_height)
+			return -1;
+		left -= node.Width;
+	}
+	return y;
+}
+
+/*!
+ * @fn bool GlyphAtlas::Pack(int w, int h, int* x, int* y)
+ * @param w	width of rectangle to allocate
+ * @param h	height of rectangle to allocate
+ * @param x	gets X coordinate of allocated rectangle
+ * @param y	gets Y coordinate of allocated rectangle
+ *
+ * Allocates a rectangle in the atlas using the skyline bottom left
+ * heuristic. The rectangle is placed on the segment where its top edge
+ * is lowest, choosing the narrowest segment when there is a tie.
+ * The skyline is then raised under the rectangle and adjacent segments
+ * of the same height are merged.
+ *
+ * @return \b true if rectangle was allocated, \b false if the atlas is full
+ */
+bool GlyphAtlas::Pack(int w, int h, int* x, int* y)
+{
+	int32	best = -1;
+	int32	besttop = INT_MAX;
+	int32	bestwidth = INT_MAX;
+	int32	i;
+
+	for (i = 0; i < m_NumNodes; ++i)
+	{
+		int32	top = Fit(i, w, h);
+
+		if (top < 0)
+			continue;
+		top += h;
+		if ((top < besttop) || ((top == besttop) && (m_Skyline[i].Width < bestwidth)))
+		{
+			best = i;
+			besttop = top;
+			bestwidth = m_Skyline[i].Width;
+		}
+	}
+	if (best < 0)
+		return false;
+	if (m_NumNodes >= m_MaxNodes)
+	{
+		SkyNode* nodes = (SkyNode*) realloc(m_Skyline, 2 * m_MaxNodes * sizeof(SkyNode));
+
+		if (nodes == NULL)
+			VX_ERROR(("GlyphAtlas::Pack ERROR out of memory\n"), false);
+		m_Skyline = nodes;
+		m_MaxNodes *= 2;
+	}
+	*x = m_Skyline[best].X;
+	*y = besttop - h;
+	memmove(m_Skyline + best + 1, m_Skyline + best, (m_NumNodes - best) * sizeof(SkyNode));
+	m_Skyline[best].Y = besttop;
+	m_Skyline[best].Width = w;
+	++m_NumNodes;
+	for (i = best + 1; i < m_NumNodes; )		// trim segments under the new one
+	{
+		SkyNode&	prev = m_Skyline[i - 1];
+		SkyNode&	node = m_Skyline[i];
+		int32		overlap = prev.X + prev.Width - node.X;
+
+		if (overlap <= 0)
+			break;
+		node.X += overlap;
+		node.Width -= overlap;
+		if (node.Width > 0)
+			break;
+		memmove(m_Skyline + i, m_Skyline + i + 1, (m_NumNodes - i - 1) * sizeof(SkyNode));
+		--m_NumNodes;
+	}
+	for (i = 0; i < m_NumNodes - 1; )			// merge segments of the same height
+	{
+		if (m_Skyline[i].Y == m_Skyline[i + 1].Y)
+		{
+			m_Skyline[i].Width += m_Skyline[i + 1].Width;
+			memmove(m_Skyline + i + 1, m_Skyline + i + 2, (m_NumNodes - i - 2) * sizeof(SkyNode));
+			--m_NumNodes;
+		}
+		else
+			++i;
+	}
+	return true;
+}
+
+float GlyphAtlas::GetUsage() const
+{
+	return float(m_UsedArea) / float(m_Atlas.tex_width * m_Atlas.tex_height);
+}
+
+/*!
+ * @fn bool GlyphAtlas::UpdateTexture()
+ *
+ * Marks the atlas texture as changed if glyphs have been added
+ * since the last call so the renderer will reload it.
+ * Glyphs are usually added in bursts when text is changed,
+ * so this is called once after the text is updated rather
+ * than for each glyph.
+ *
+ * @return \b true if the texture was changed
+ */
+bool GlyphAtlas::UpdateTexture()
+{
+	Bitmap*	bmap = m_Texture->GetBitmap();
+
+	if (!m_Changed)
+		return false;
+	m_Changed = false;
+	if (bmap)
+		bmap->SetChanged(true);
+	m_Texture->SetChanged(true);
+	return true;
+}
+
+}	// end Vixen
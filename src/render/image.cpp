@@ -498,6 +498,7 @@ void Texture::SetBitmap(int type, void* data)
 		bmap->Type = type;
 		bmap->Data = (void*) data;
 		bmap->SetChanged(true);
+		bmap->UpdateMemStats();
 		m_Bitmap = bmap;
 		return;
 	}
@@ -506,6 +507,7 @@ void Texture::SetBitmap(int type, void* data)
 	bmap->Type = type;
 	bmap->Data = (void*) data;
 	bmap->SetChanged(true);
+	bmap->UpdateMemStats();
 }
 
 void Texture::SetBitmap(Bitmap* bmap)
@@ -548,6 +550,7 @@ bool Texture::UpdateData(void* data)
 	memcpy(imagedata, newdata, imagesize);
 	//bmap->Type = type;
 	bmap->Data = imagedata;
+	bmap->UpdateMemStats();
 	return true;
 }
 
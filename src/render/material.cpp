@@ -74,6 +74,7 @@ bool Material::Do(Messenger& s, int op)
 			m_Data = Core::GlobalAllocator::Get()->Alloc(n * sizeof(int32));
 		VX_ASSERT(n == m_Layout->Size);
 		s.Input((int32*) m_Data, n);
+		MarkDirty();
 		break;
 
 		default:
@@ -122,6 +123,7 @@ bool Material::Copy(const SharedObj* src_obj)
 		return true;
 	if (m_Data && src->m_Data && (src->m_Layout == m_Layout))
 		memcpy(m_Data, src->m_Data, m_Layout->Size * sizeof(int32));
+	MarkDirty();
 	SetChanged(true);
 	return true;
 }
@@ -241,6 +243,7 @@ bool PhongMaterial::Copy(const SharedObj* src_obj)
 	m_ShaderData.Specular = src->m_ShaderData.Specular;
 	m_ShaderData.Emission = src->m_ShaderData.Emission;
 	m_ShaderData.Shine = src->m_ShaderData.Shine;
+	MarkDirty();
 	SetChanged(true);
 	return true;
 }
@@ -261,6 +264,7 @@ void PhongMaterial::SetDiffuse(const Col4& c)
 		*s << OP(VX_PhongMaterial, MAT_SetDiffuse) << this << c;
 	VX_STREAM_END( )
 	m_ShaderData.Diffuse = c;
+	MarkDirty((char*) &m_ShaderData.Diffuse - (char*) &m_ShaderData, sizeof(Col4));
 	SetChanged(true);
 }
 
@@ -280,6 +284,7 @@ void PhongMaterial::SetSpecular(const Col4& c)
 		*s << OP(VX_PhongMaterial, MAT_SetSpecular) << this << c;
 	VX_STREAM_END(  )
 	m_ShaderData.Specular = c;
+	MarkDirty((char*) &m_ShaderData.Specular - (char*) &m_ShaderData, sizeof(Col4));
 	SetChanged(true);
 }
 
@@ -298,6 +303,7 @@ void PhongMaterial::SetAmbient(const Col4& c)
 		*s << OP(VX_PhongMaterial, MAT_SetAmbient) << this << c;
 	VX_STREAM_END(  )
 	m_ShaderData.Ambient = c;
+	MarkDirty((char*) &m_ShaderData.Ambient - (char*) &m_ShaderData, sizeof(Col4));
 	SetChanged(true);
 }
 
@@ -317,6 +323,7 @@ void	PhongMaterial::SetEmission(const Col4& c)
 	VX_STREAM_END(  )
 
 	m_ShaderData.Emission = c;
+	MarkDirty((char*) &m_ShaderData.Emission - (char*) &m_ShaderData, sizeof(Col4));
 	SetChanged(true);
 }
 
@@ -336,6 +343,7 @@ void	PhongMaterial::SetShine(float shine)
 	VX_STREAM_END(  )
 
 	m_ShaderData.Shine = shine;
+	MarkDirty((char*) &m_ShaderData.Shine - (char*) &m_ShaderData, sizeof(float));
 	SetChanged(true);
 }
 
@@ -9,7 +9,11 @@
 namespace Vixen {
 VX_IMPLEMENT_CLASS(DeviceInfo, SharedObj);
 
-Renderer* Renderer::CreateRenderer(int options) { return NULL; }
+/*
+ * Without a graphics device the state sorter still runs
+ * but only counts what would have been rendered.
+ */
+Renderer* Renderer::CreateRenderer(int options) { return new NullRenderer(options); }
 
 
 };
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "vixen.h"
+
+namespace Vixen {
+
+VX_IMPLEMENT_CLASS(NullRenderer, GeoSorter);
+
+NullRenderer::NullRenderer(int options) : GeoSorter(options)
+{
+	m_CurAppear = NULL;
+	m_CurMatrix = NULL;
+	ClearCounts(m_Frame);
+	ClearCounts(m_LastFrame);
+	ClearCounts(m_Total);
+}
+
+void NullRenderer::ClearCounts(Counts& c)
+{
+	c.Frames = 0;
+	c.Meshes = 0;
+	c.Prims = 0;
+	c.Verts = 0;
+	c.Indices = 0;
+	c.StateChanges = 0;
+	c.MatrixChanges = 0;
+	c.Bytes = 0;
+	c.Batches = 0;
+	c.Instances = 0;
+	c.ConstantUploads = 0;
+	c.ConstantBytes = 0;
+	c.Ranges = 0;
+}
+
+/*!
+ * @fn void NullRenderer::ResetCounts()
+ *
+ * Discards the counts accumulated so far. Benchmarks call this
+ * after warming up so the totals only reflect the measured frames.
+ *
+ * @see NullRenderer::GetTotalCounts
+ */
+void NullRenderer::ResetCounts()
+{
+	ClearCounts(m_LastFrame);
+	ClearCounts(m_Total);
+}
+
+/*!
+ * @fn bool NullRenderer::Init(Scene* scene, Vixen::Window win, const TCHAR* options)
+ *
+ * Attaches the renderer to the scene. There is no device so
+ * a window is not required. The back buffer size is taken from
+ * the scene viewport if it has one.
+ */
+bool NullRenderer::Init(Scene* scene, Vixen::Window win, const TCHAR* options)
+{
+	if (!Renderer::Init(scene, win, options))
+		return false;
+	const Box2& vp = scene->GetViewport();
+	BackWidth = (int) vp.Width();
+	BackHeight = (int) vp.Height();
+	return true;
+}
+
+void NullRenderer::Begin(int changed, int frame)
+{
+	GeoSorter::Begin(changed, frame);
+	ClearCounts(m_Frame);
+	m_CurAppear = NULL;
+	m_CurMatrix = NULL;
+}
+
+void NullRenderer::End(int frame)
+{
+	m_Frame.Frames = 1;
+	m_LastFrame = m_Frame;
+	m_Total.Frames += m_Frame.Frames;
+	m_Total.Meshes += m_Frame.Meshes;
+	m_Total.Prims += m_Frame.Prims;
+	m_Total.Verts += m_Frame.Verts;
+	m_Total.Indices += m_Frame.Indices;
+	m_Total.StateChanges += m_Frame.StateChanges;
+	m_Total.MatrixChanges += m_Frame.MatrixChanges;
+	m_Total.Bytes += m_Frame.Bytes;
+	m_Total.Batches += m_Frame.Batches;
+	m_Total.Instances += m_Frame.Instances;
+	m_Total.ConstantUploads += m_Frame.ConstantUploads;
+	m_Total.ConstantBytes += m_Frame.ConstantBytes;
+	m_Total.Ranges += m_Frame.Ranges;
+}
+
+/*!
+ * @fn void NullRenderer::RenderMesh(const Geometry* geo, const Appearance* appear, const Matrix* mtx)
+ * @param geo		geometry to render
+ * @param appear	appearance to render it with
+ * @param mtx		world matrix for the geometry, NULL for identity
+ *
+ * Counts the work a device renderer would do to draw the geometry.
+ * A matrix change is counted whenever the world matrix differs
+ * from the one used for the previous mesh.
+ *
+ * @see NullRenderer::CountMesh
+ */
+void NullRenderer::RenderMesh(const Geometry* geo, const Appearance* appear, const Matrix* mtx)
+{
+	if (geo == NULL)
+		return;
+	if (mtx && mtx->IsIdentity())
+		mtx = NULL;
+	if (mtx != m_CurMatrix)
+	{
+		if ((mtx == NULL) || (m_CurMatrix == NULL) || !(*mtx == *m_CurMatrix))
+			++m_Frame.MatrixChanges;
+		m_CurMatrix = mtx;
+	}
+	CountMesh(geo, appear, 1);
+}
+
+/*!
+ * @fn void NullRenderer::RenderInstances(const Geometry* geo, const Appearance* appear, const Instance* inst, int n)
+ * @param geo		geometry to render
+ * @param appear	appearance to render it with
+ * @param inst		array of per-instance data
+ * @param n			number of instances
+ *
+ * Counts an instanced draw as a single draw call which renders
+ * \b n copies of the geometry. The geometry is submitted once
+ * along with the instance array.
+ *
+ * @see Renderer::RenderInstances
+ */
+void NullRenderer::RenderInstances(const Geometry* geo, const Appearance* appear, const Instance* inst, int n)
+{
+	if ((geo == NULL) || (n <= 0))
+		return;
+	m_CurMatrix = NULL;
+	++m_Frame.MatrixChanges;
+	++m_Frame.Batches;
+	m_Frame.Instances += n;
+	m_Frame.Bytes += n * sizeof(Instance);
+	CountMesh(geo, appear, n);
+}
+
+/*
+ * Count one draw call which renders \b ninst copies of the geometry.
+ * A state change is counted whenever the appearance differs from the
+ * one used for the previous draw. The bytes submitted include all of
+ * the vertices and indices referenced by the mesh. When the appearance
+ * changes, the part of its material which changed since it was last
+ * used is counted as uploaded. If some meshlets of a triangle mesh
+ * were culled, only the triangles in the visible index ranges are
+ * counted. The mesh is still one draw call, the ranges drawn are
+ * counted separately.
+ */
+void NullRenderer::CountMesh(const Geometry* geo, const Appearance* appear, int ninst)
+{
+	SceneStats*	stats = m_Scene ? m_Scene->GetStats() : NULL;
+	intptr		nprims = 0;
+
+	++m_Frame.Meshes;
+	if (appear != m_CurAppear)
+	{
+		m_CurAppear = appear;
+		++m_Frame.StateChanges;
+		if (stats)
+			Core::InterlockInc(&(stats->RenderStateChanges));
+		if (appear)
+		{
+			const DeviceBuffer*	mtl = appear->GetMaterial();
+			size_t				start, end;
+
+			if (mtl && mtl->TakeDirty(start, end))
+			{
+				++m_Frame.ConstantUploads;
+				m_Frame.ConstantBytes += end - start;
+			}
+		}
+	}
+	if (geo->IsKindOf(CLASS_(Mesh)))
+	{
+		const Mesh*	mesh = (const Mesh*) geo;
+		intptr		nvtx = mesh->GetNumVtx();
+		intptr		nidx = mesh->GetNumIdx();
+		int			idxsize = mesh->GetIndexSize();
+		const int32* ranges;
+		int32		nranges;
+
+		if (nidx && (idxsize == 0))		// size the indices as a device would
+		{
+			ObjectLock	lock(mesh->GetIndices());
+
+			idxsize = Mesh::FindIndexSize(mesh->GetIndices());
+			mesh->SetIndexSize(idxsize);
+		}
+		nprims = mesh->GetNumFaces();
+		if (nprims == 0)				// lines or points
+			nprims = nidx ? nidx : nvtx;
+		else if ((ninst == 1) && geo->IsKindOf(CLASS_(TriMesh)) &&
+				 ((nranges = ((const TriMesh*) mesh)->GetDrawRanges(&ranges)) > 0))
+		{
+			nidx = 0;					// only visible meshlets are drawn
+			for (int32 i = 0; i < nranges; ++i)
+				nidx += ranges[2 * i + 1];
+			nprims = nidx / 3;
+			m_Frame.Ranges += nranges;
+		}
+		m_Frame.Verts += nvtx * ninst;
+		m_Frame.Indices += nidx * ninst;
+		m_Frame.Bytes += nvtx * mesh->GetVtxSize() * sizeof(float) + nidx * idxsize;
+	}
+	else
+	{
+		nprims = geo->GetNumFaces();
+		m_Frame.Verts += geo->GetNumVtx() * ninst;
+	}
+	nprims *= ninst;
+	m_Frame.Prims += nprims;
+	if (stats)
+		Core::InterlockAdd(&(stats->PrimsRendered), (int) nprims);
+}
+
+void NullRenderer::Print(DebugOut& dbg) const
+{
+	endl(dbg << "<nullrenderer frames='" << (intptr) m_Total.Frames
+			 << "' meshes='" << (intptr) m_Total.Meshes
+			 << "' prims='" << (intptr) m_Total.Prims
+			 << "' statechanges='" << (intptr) m_Total.StateChanges
+			 << "' batches='" << (intptr) m_Total.Batches
+			 << "' instances='" << (intptr) m_Total.Instances
+			 << "' constantbytes='" << (intptr) m_Total.ConstantBytes
+			 << "' bytes='" << (intptr) m_Total.Bytes << "'>");
+	GeoSorter::Print(dbg);
+	endl(dbg << "</nullrenderer>");
+}
+
+}	// end Vixen
@@ -0,0 +1,720 @@
+#include "vixen.h"
+
+namespace Vixen {
+
+VX_IMPLEMENT_CLASSID(RenderStream, SharedObj, VX_RenderStream);
+
+#define	RSTREAM_MinWords	1024		// initial size of command array
+#define	RSTREAM_MinHash		64			// initial size of object hash table
+
+RenderStream::RenderStream() : SharedObj()
+{
+	m_Data = NULL;
+	m_Size = 0;
+	m_MaxSize = 0;
+	m_NumCommands = 0;
+	m_Ptrs = NULL;
+	m_NumObjects = 0;
+	m_MaxObjects = 0;
+	m_Hash = NULL;
+	m_HashSize = 0;
+	ResetState();
+}
+
+RenderStream::~RenderStream()
+{
+	Empty();
+	if (m_Data)
+		free(m_Data);
+	if (m_Ptrs)
+		free(m_Ptrs);
+	if (m_Hash)
+		free(m_Hash);
+}
+
+/*!
+ * @fn void RenderStream::Empty()
+ *
+ * Discards the commands and dereferences the objects they use.
+ * The memory for the commands is kept so a stream which
+ * is recorded every frame does not reallocate.
+ */
+void RenderStream::Empty()
+{
+	m_Size = 0;
+	m_NumCommands = 0;
+	m_NumObjects = 0;
+	m_Objects.Empty();
+	if (m_Hash)
+		memset(m_Hash, 0, m_HashSize * sizeof(Slot));
+	ResetState();
+}
+
+/*
+ * Forget the state recorded so far so the next
+ * appearance, matrix and lights are always recorded.
+ */
+void RenderStream::ResetState()
+{
+	m_CurAppear = -2;
+	m_NumCurLights = 0;
+	m_HasLights = false;
+	m_MatrixState = 0;
+}
+
+/*
+ * Add a command with \b nwords words (including the first)
+ * to the end of the stream and return its address.
+ */
+int32* RenderStream::Reserve(int cmd, int32 nwords)
+{
+	int32*	p;
+
+	if (m_Size + nwords > m_MaxSize)
+	{
+		int32	n = m_MaxSize ? m_MaxSize : RSTREAM_MinWords;
+
+		while (n < m_Size + nwords)
+			n *= 2;
+		p = (int32*) realloc(m_Data, n * sizeof(int32));
+		if (p == NULL)
+			VX_ERROR(("RenderStream::Reserve ERROR out of memory for %d words\n", n), NULL);
+		m_Data = p;
+		m_MaxSize = n;
+	}
+	p = m_Data + m_Size;
+	*p = (nwords << 8) | cmd;
+	m_Size += nwords;
+	++m_NumCommands;
+	return p;
+}
+
+/*
+ * Rebuild the hash table which finds the index of an object with \b size slots.
+ */
+bool RenderStream::GrowHash(int32 size)
+{
+	Slot*	hash = (Slot*) realloc(m_Hash, size * sizeof(Slot));
+
+	if (hash == NULL)
+		VX_ERROR(("RenderStream::GrowHash ERROR out of memory for %d objects\n", size), false);
+	m_Hash = hash;
+	m_HashSize = size;
+	memset(m_Hash, 0, size * sizeof(Slot));
+	for (int32 i = 0; i < m_NumObjects; ++i)
+	{
+		const SharedObj* obj = m_Ptrs[i];
+
+		if (obj == NULL)
+			continue;
+		uint32 h = uint32((intptr(obj) >> 4) * 2654435761u) & (size - 1);
+		while (m_Hash[h].Obj)
+			h = (h + 1) & (size - 1);
+		m_Hash[h].Obj = obj;
+		m_Hash[h].Index = i;
+	}
+	return true;
+}
+
+/*
+ * Return the index of an object in the object table, adding it if necessary.
+ * The table keeps a reference to the object.
+ */
+int32 RenderStream::AddObject(const SharedObj* obj)
+{
+	uint32	h;
+
+	if (obj == NULL)
+		return -1;
+	if ((m_NumObjects * 2 >= m_HashSize) &&
+		!GrowHash(m_HashSize ? m_HashSize * 2 : RSTREAM_MinHash))
+		return -1;
+	h = uint32((intptr(obj) >> 4) * 2654435761u) & (m_HashSize - 1);
+	while (m_Hash[h].Obj)
+	{
+		if (m_Hash[h].Obj == obj)
+			return m_Hash[h].Index;
+		h = (h + 1) & (m_HashSize - 1);
+	}
+	if (m_NumObjects >= m_MaxObjects)
+	{
+		int32				n = m_MaxObjects ? m_MaxObjects * 2 : RSTREAM_MinHash;
+		const SharedObj**	ptrs = (const SharedObj**) realloc(m_Ptrs, n * sizeof(SharedObj*));
+
+		if (ptrs == NULL)
+			VX_ERROR(("RenderStream::AddObject ERROR out of memory for %d objects\n", n), -1);
+		m_Ptrs = ptrs;
+		m_MaxObjects = n;
+	}
+	m_Objects.Append(obj);
+	m_Ptrs[m_NumObjects] = obj;
+	m_Hash[h].Obj = obj;
+	m_Hash[h].Index = m_NumObjects;
+	return m_NumObjects++;
+}
+
+/*!
+ * @fn void RenderStream::BeginFrame(int32 frame)
+ * @param frame	frame number
+ *
+ * Records the start of a frame. The appearance, matrix and lights
+ * of the previous frame are not assumed to still be in effect.
+ */
+void RenderStream::BeginFrame(int32 frame)
+{
+	int32*	p;
+
+	ResetState();
+	if (p = Reserve(CMD_Frame, 2))
+		p[1] = frame;
+}
+
+/*!
+ * @fn void RenderStream::SetAppearance(const Appearance* appear)
+ * @param appear	appearance for the following draws, may be NULL
+ *
+ * Nothing is recorded if the appearance is the same as the last one.
+ */
+void RenderStream::SetAppearance(const Appearance* appear)
+{
+	int32	index = AddObject(appear);
+	int32*	p;
+
+	if (index == m_CurAppear)
+		return;
+	if (p = Reserve(CMD_Appearance, 2))
+	{
+		p[1] = index;
+		m_CurAppear = index;
+	}
+}
+
+/*!
+ * @fn void RenderStream::SetMatrix(const Matrix* mtx)
+ * @param mtx	world matrix for the following draws, NULL for identity
+ *
+ * Only the top three rows of the matrix are recorded.
+ * Nothing is recorded if the matrix has the same values as the last one.
+ */
+void RenderStream::SetMatrix(const Matrix* mtx)
+{
+	int32*	p;
+
+	if ((mtx == NULL) || mtx->IsIdentity())
+	{
+		if (m_MatrixState == 1)
+			return;
+		if (Reserve(CMD_Identity, 1))
+			m_MatrixState = 1;
+		return;
+	}
+	const float* data = mtx->GetMatrix();
+
+	if ((m_MatrixState == 2) && (memcmp(m_CurMatrix, data, 12 * sizeof(float)) == 0))
+		return;
+	if (p = Reserve(CMD_Matrix, 13))
+	{
+		memcpy(p + 1, data, 12 * sizeof(float));
+		memcpy(m_CurMatrix, data, 12 * sizeof(float));
+		m_MatrixState = 2;
+	}
+}
+
+/*!
+ * @fn void RenderStream::SetLights(const uint16* ids, int n)
+ * @param ids	IDs of the lights which illuminate the following draws (GPULight::ID)
+ * @param n		number of light IDs, at most LIGHT_MaxLights are recorded
+ *
+ * Nothing is recorded if the lights are the same as the last ones.
+ *
+ * @see LightList::LightsOn
+ */
+void RenderStream::SetLights(const uint16* ids, int n)
+{
+	int32*	p;
+
+	if (n > LIGHT_MaxLights)
+		n = LIGHT_MaxLights;
+	if (m_HasLights && (n == m_NumCurLights) &&
+		((n == 0) || (memcmp(ids, m_CurLights, n * sizeof(uint16)) == 0)))
+		return;
+	if (p = Reserve(CMD_Lights, 2 + (n + 1) / 2))
+	{
+		p[1] = n;
+		if (n > 0)
+		{
+			p[1 + (n + 1) / 2] = 0;				// clear the padding
+			memcpy(p + 2, ids, n * sizeof(uint16));
+			memcpy(m_CurLights, ids, n * sizeof(uint16));
+		}
+		m_NumCurLights = n;
+		m_HasLights = true;
+	}
+}
+
+/*!
+ * @fn void RenderStream::Draw(const Geometry* geo)
+ * @param geo	geometry to draw with the current appearance, matrix and lights
+ *
+ * @see Renderer::RenderMesh
+ */
+void RenderStream::Draw(const Geometry* geo)
+{
+	int32	index = AddObject(geo);
+	int32*	p;
+
+	if (index < 0)
+		return;
+	if (p = Reserve(CMD_Draw, 2))
+		p[1] = index;
+}
+
+/*!
+ * @fn Renderer::Instance* RenderStream::DrawInstances(const Geometry* geo, int n)
+ * @param geo	geometry to draw with the current appearance
+ * @param n		number of copies
+ *
+ * Records drawing \b n copies of the geometry with the current lights.
+ * The per-instance world matrices are stored in the stream.
+ * The caller fills them in using the address returned, which
+ * is only valid until the next command is recorded.
+ *
+ * @return instance array in the stream, NULL on error
+ *
+ * @see Renderer::RenderInstances
+ */
+Renderer::Instance* RenderStream::DrawInstances(const Geometry* geo, int n)
+{
+	int32	index = AddObject(geo);
+	int32	nwords = int32((n * sizeof(Renderer::Instance) + sizeof(int32) - 1) / sizeof(int32));
+	int32*	p;
+
+	if ((index < 0) || (n <= 0))
+		return NULL;
+	if ((p = Reserve(CMD_Instances, 3 + nwords)) == NULL)
+		return NULL;
+	p[1] = index;
+	p[2] = n;
+	return (Renderer::Instance*) (p + 3);
+}
+
+/*
+ * Returns the length of the command at \b p in words if it fits before \b end
+ * and is long enough for its arguments, 0 if the command is corrupt.
+ * Streams read from files are checked before any argument is used.
+ */
+static int32 CommandLength(const int32* p, const int32* end)
+{
+	int32	len = uint32(*p) >> 8;
+	int32	need = 1;
+	int32	n;
+
+	if ((len <= 0) || (len > end - p))
+		return 0;
+	switch (*p & 0xFF)
+	{
+		case RenderStream::CMD_Frame:
+		case RenderStream::CMD_Appearance:
+		case RenderStream::CMD_Draw:
+		need = 2;
+		break;
+
+		case RenderStream::CMD_Matrix:
+		need = 13;
+		break;
+
+		case RenderStream::CMD_Lights:
+		if (len < 2)
+			return 0;
+		n = p[1];
+		if ((n < 0) || (n > LIGHT_MaxLights))
+			return 0;
+		need = 2 + (n + 1) / 2;
+		break;
+
+		case RenderStream::CMD_Instances:
+		if (len < 3)
+			return 0;
+		n = p[2];
+		if ((n <= 0) || (n > (len - 3) * int32(sizeof(int32)) / int32(sizeof(Renderer::Instance))))
+			return 0;
+		need = 3 + int32((n * sizeof(Renderer::Instance) + sizeof(int32) - 1) / sizeof(int32));
+		break;
+	}
+	return (len >= need) ? len : 0;
+}
+
+/*!
+ * @fn bool RenderStream::Append(const RenderStream& src)
+ * @param src	stream whose commands are added
+ *
+ * Adds the commands from the source stream to the end of this one.
+ * The objects they refer to are added to the object table of this stream.
+ * The state last recorded by the source stream is not known to this one
+ * so the next appearance, matrix and lights are always recorded.
+ *
+ * @return \b true if successful, \b false if out of memory
+ */
+bool RenderStream::Append(const RenderStream& src)
+{
+	const int32*	p = src.m_Data;
+	const int32*	end = src.m_Data + src.m_Size;
+
+	while (p < end)
+	{
+		int32	len = CommandLength(p, end);
+		int		cmd = *p & 0xFF;
+		int32*	dst;
+
+		if (len <= 0)
+			VX_ERROR(("RenderStream::Append ERROR bad command %X\n", *p), false);
+		if ((dst = Reserve(cmd, len)) == NULL)
+			return false;
+		memcpy(dst + 1, p + 1, (len - 1) * sizeof(int32));
+		switch (cmd)
+		{
+			case CMD_Appearance:
+			case CMD_Draw:
+			case CMD_Instances:
+			dst[1] = AddObject(src.GetObj(p[1]));
+			break;
+		}
+		p += len;
+	}
+	ResetState();
+	return true;
+}
+
+/*!
+ * @fn int RenderStream::Replay(Renderer* render) const
+ * @param render	renderer to call
+ *
+ * Calls Renderer::RenderMesh for each draw command and
+ * Renderer::RenderInstances for each instance command
+ * with the appearance and world matrix in effect.
+ * Light commands enable the lights in the light list of the renderer.
+ * Each command is checked against the end of the stream and the
+ * counts of light and instance commands against the command length,
+ * so a corrupt stream read from a file stops with an error instead of
+ * reading past the commands.
+ *
+ * @return number of draw and instance commands
+ *
+ * @see GeoSorter::Render NullRenderer
+ */
+int RenderStream::Replay(Renderer* render) const
+{
+	const int32*		p = m_Data;
+	const int32*		end = m_Data + m_Size;
+	const Appearance*	appear = NULL;
+	const Matrix*		mtx = NULL;
+	LightList*			lights = render->GetLights();
+	Matrix				world[2];	// alternate so renderers which compare matrix addresses see each change
+	int					cur = 0;
+	int					ndraws = 0;
+
+	while (p < end)
+	{
+		int32				len = CommandLength(p, end);
+		const Geometry*		geo;
+		float				data[16];
+
+		if (len <= 0)
+			VX_ERROR(("RenderStream::Replay ERROR bad command %X\n", *p), ndraws);
+		switch (*p & 0xFF)
+		{
+			case CMD_Appearance:
+			appear = (const Appearance*) GetObj(p[1]);
+			break;
+
+			case CMD_Matrix:
+			memcpy(data, p + 1, 12 * sizeof(float));
+			data[12] = data[13] = data[14] = 0.0f;
+			data[15] = 1.0f;
+			cur ^= 1;
+			world[cur].SetMatrix(data);
+			mtx = &world[cur];
+			break;
+
+			case CMD_Identity:
+			mtx = NULL;
+			break;
+
+			case CMD_Lights:
+			if (lights)
+				lights->LightsOn((const uint16*) (p + 2), p[1]);
+			break;
+
+			case CMD_Draw:
+			if (geo = (const Geometry*) GetObj(p[1]))
+			{
+				render->RenderMesh(geo, appear, mtx);
+				++ndraws;
+			}
+			break;
+
+			case CMD_Instances:
+			if (geo = (const Geometry*) GetObj(p[1]))
+			{
+				render->RenderInstances(geo, appear, (const Renderer::Instance*) (p + 3), p[2]);
+				++ndraws;
+			}
+			break;
+		}
+		p += len;
+	}
+	return ndraws;
+}
+
+/*
+ * Objects in two streams match if they are the same object or
+ * have the same class and name. Unnamed geometry matches if it has the
+ * same number of vertices and faces, so a stream read from a file
+ * can be compared with one recorded from the scene it was captured from.
+ */
+bool RenderStream::SameObject(const SharedObj* obj1, const SharedObj* obj2)
+{
+	const TCHAR*	name1;
+	const TCHAR*	name2;
+
+	if (obj1 == obj2)
+		return true;
+	if ((obj1 == NULL) || (obj2 == NULL) || (obj1->ClassID() != obj2->ClassID()))
+		return false;
+	name1 = obj1->GetName();
+	name2 = obj2->GetName();
+	if (name1 && name2)
+		return STRCMP(name1, name2) == 0;
+	if (name1 || name2)
+		return false;
+	if (obj1->IsClass(VX_Geometry))
+	{
+		const Geometry* geo1 = (const Geometry*) obj1;
+		const Geometry* geo2 = (const Geometry*) obj2;
+
+		return (geo1->GetNumVtx() == geo2->GetNumVtx()) && (geo1->GetNumFaces() == geo2->GetNumFaces());
+	}
+	return true;
+}
+
+/*!
+ * @fn int32 RenderStream::Compare(const RenderStream& src) const
+ * @param src	stream to compare with
+ *
+ * Compares the commands in two streams. Object references match if
+ * they refer to the same object or to objects with the same class and name.
+ * Frame numbers are not compared so frames recorded at different times
+ * can be compared.
+ *
+ * @return index of the first command which differs, -1 if the streams are the same
+ */
+int32 RenderStream::Compare(const RenderStream& src) const
+{
+	const int32*	p1 = m_Data;
+	const int32*	p2 = src.m_Data;
+	const int32*	end1 = m_Data + m_Size;
+	const int32*	end2 = src.m_Data + src.m_Size;
+	int32			index = 0;
+
+	while ((p1 < end1) && (p2 < end2))
+	{
+		int32	len = CommandLength(p1, end1);
+
+		if ((*p1 != *p2) || (len <= 0) || (len > end2 - p2))
+			return index;
+		switch (*p1 & 0xFF)
+		{
+			case CMD_Frame:
+			break;
+
+			case CMD_Appearance:
+			case CMD_Draw:
+			if (!SameObject(GetObj(p1[1]), src.GetObj(p2[1])))
+				return index;
+			break;
+
+			case CMD_Instances:
+			if (!SameObject(GetObj(p1[1]), src.GetObj(p2[1])) ||
+				(memcmp(p1 + 2, p2 + 2, (len - 2) * sizeof(int32)) != 0))
+				return index;
+			break;
+
+			default:
+			if (memcmp(p1 + 1, p2 + 1, (len - 1) * sizeof(int32)) != 0)
+				return index;
+		}
+		p1 += len;
+		p2 += len;
+		++index;
+	}
+	if ((p1 < end1) || (p2 < end2))
+		return index;
+	return -1;
+}
+
+/*!
+ * @fn bool RenderStream::Write(const TCHAR* filename)
+ * @param filename	name of file to write
+ *
+ * Saves the stream and the geometry and appearances it uses in a Vixen
+ * binary file. The stream is named after the file so RenderStream::Read
+ * can find it.
+ *
+ * @return \b true if the file was written, else \b false
+ *
+ * @see RenderStream::Read FileMessenger
+ */
+bool RenderStream::Write(const TCHAR* filename)
+{
+	FileMessenger	file;
+	TCHAR			filebase[VX_MaxPath];
+
+	if (!file.Open(filename, Messenger::OPEN_WRITE))
+		VX_ERROR(("RenderStream::Write ERROR cannot open %s for write\n", filename), false);
+	Core::Stream::ParseDirectory(filename, filebase, NULL);
+	SetName(Core::String(filebase) + TEXT(".commands"));
+	if (Save(file, 0) <= 0)
+		return false;
+	return file.Close();
+}
+
+/*!
+ * @fn bool RenderStream::Read(const TCHAR* filename)
+ * @param filename	name of file saved by RenderStream::Write
+ *
+ * Replaces the contents of this stream with the stream in the file.
+ *
+ * @return \b true if the stream was read, else \b false
+ *
+ * @see RenderStream::Write
+ */
+bool RenderStream::Read(const TCHAR* filename)
+{
+	FileMessenger		file;
+	Core::FileStream*	instream = new Core::FileStream;
+	TCHAR				filebase[VX_MaxPath];
+	const SharedObj*	obj;
+
+	file.SetInStream(instream);
+	if (!instream->Open(filename, Core::Stream::OPEN_READ))
+		VX_ERROR(("RenderStream::Read ERROR cannot open %s\n", filename), false);
+	if (!file.Load())
+		VX_ERROR(("RenderStream::Read ERROR cannot load %s\n", filename), false);
+	Core::Stream::ParseDirectory(filename, filebase, NULL);
+	STRCAT(filebase, TEXT(".commands"));
+	obj = file.Find(filebase);
+	if ((obj == NULL) || !obj->IsClass(VX_RenderStream))
+		VX_ERROR(("RenderStream::Read ERROR no commands in %s\n", filename), false);
+	return Copy(obj);
+}
+
+/****
+ *
+ * class RenderStream override for SharedObj::Copy
+ *
+ ****/
+bool RenderStream::Copy(const SharedObj* src_obj)
+{
+	ObjectLock dlock(this);
+	ObjectLock slock(src_obj);
+	if (!SharedObj::Copy(src_obj))
+		return false;
+	if (src_obj->IsClass(VX_RenderStream))
+	{
+		Empty();
+		return Append(*((const RenderStream*) src_obj));
+	}
+	return true;
+}
+
+/****
+ *
+ * class RenderStream override for SharedObj::Do
+ *
+ ****/
+bool RenderStream::Do(Messenger& s, int op)
+{
+	SharedObj*	obj;
+	int32		n, ncmds;
+
+	switch (op)
+	{
+		case RSTREAM_AddObject:
+		s >> obj;
+		if ((obj == NULL) && (m_NumObjects < m_MaxObjects))
+		{
+			m_Objects.Append(NULL);			// keep the indices of objects which did not load
+			m_Ptrs[m_NumObjects++] = NULL;
+		}
+		else if ((obj == NULL) || (AddObject(obj) < 0))
+		{
+			const SharedObj** ptrs = (const SharedObj**) realloc(m_Ptrs, (m_NumObjects + 1) * 2 * sizeof(SharedObj*));
+
+			if (ptrs == NULL)
+				VX_ERROR(("RenderStream::Do ERROR out of memory for %d objects\n", m_NumObjects), false);
+			m_Ptrs = ptrs;
+			m_MaxObjects = (m_NumObjects + 1) * 2;
+			m_Objects.Append(NULL);
+			m_Ptrs[m_NumObjects++] = NULL;
+		}
+		break;
+
+		case RSTREAM_SetCommands:
+		s >> n >> ncmds;
+		m_Size = 0;
+		m_NumCommands = 0;
+		if ((n > 0) && (Reserve(0, n) == NULL))
+			return false;
+		s.Input(m_Data, n);
+		m_NumCommands = ncmds;
+		ResetState();
+		break;
+
+		default:
+		return SharedObj::Do(s, op);
+	}
+	return true;
+}
+
+/****
+ *
+ * class RenderStream override for SharedObj::Save
+ *
+ ****/
+int RenderStream::Save(Messenger& s, int opts) const
+{
+	int32 h = SharedObj::Save(s, opts);
+
+	if (h <= 0)
+		return h;
+	for (int32 i = 0; i < m_NumObjects; ++i)
+	{
+		const SharedObj* obj = m_Ptrs[i];
+
+		if (obj)
+			obj->Save(s, opts);
+		s << OP(VX_RenderStream, RSTREAM_AddObject) << h << obj;
+	}
+	s << OP(VX_RenderStream, RSTREAM_SetCommands) << h << m_Size << m_NumCommands;
+	s.Output(m_Data, m_Size);
+	return h;
+}
+
+/****
+ *
+ * class RenderStream override for SharedObj::Print
+ *
+ ****/
+DebugOut& RenderStream::Print(DebugOut& dbg, int opts) const
+{
+	if ((opts & PRINT_Attributes) == 0)
+		return SharedObj::Print(dbg, opts);
+	SharedObj::Print(dbg, opts & ~PRINT_Trailer);
+	endl(dbg << "\t<attr name='Commands'>" << m_NumCommands << "</attr>");
+	endl(dbg << "\t<attr name='Words'>" << m_Size << "</attr>");
+	endl(dbg << "\t<attr name='Objects'>" << m_NumObjects << "</attr>");
+	SharedObj::Print(dbg, opts & PRINT_Trailer);
+	return dbg;
+}
+
+}	// end Vixen
@@ -0,0 +1,503 @@
+#include "vixen.h"
+#include "render/vxtextbatch.h"
+
+namespace Vixen {
+
+VX_IMPLEMENT_CLASSID(TextBatch, TriMesh, VX_TextBatch);
+
+#define	TEXTBATCH_VtxSize		6		// location, color, texcoord
+#define	TEXTBATCH_MinGlyphs		4		// smallest run of glyphs allocated for a label
+#define	TEXTBATCH_MinWaste		64		// compact when more than this many glyphs are wasted
+
+TextBatch::TextBatch(GlyphAtlas* atlas)
+ :	TriMesh(VertexPool::COLORS | VertexPool::TEXCOORDS)
+{
+	m_Atlas = atlas;
+	m_Labels = NULL;
+	m_NumLabels = 0;
+	m_MaxLabels = 0;
+	m_NumFree = 0;
+	m_NumGlyphs = 0;
+	m_WastedGlyphs = 0;
+	m_Bound.Empty();
+}
+
+TextBatch::~TextBatch()
+{
+	if (m_Labels)
+		free(m_Labels);
+}
+
+/*!
+ * @fn void TextBatch::SetAtlas(GlyphAtlas* atlas)
+ * @param atlas	glyph atlas for the labels
+ *
+ * Establishes the atlas which supplies the glyphs. The texture
+ * coordinates of the label vertices refer to this atlas so
+ * changing it removes all of the labels.
+ *
+ * @see GlyphAtlas TextBatch::AddLabel
+ */
+void TextBatch::SetAtlas(GlyphAtlas* atlas)
+{
+	Empty();
+	m_Atlas = atlas;
+}
+
+/*!
+ * @fn int32 TextBatch::AddLabel(const TCHAR* text, const Vec3& pos, float size, const Col4& color)
+ * @param text	null-terminated string to display, may contain newlines
+ * @param pos	location of the baseline of the first character
+ * @param size	height of a line of text in local coordinates
+ * @param color	color of text
+ *
+ * Adds a label to the batch. The index returned identifies the
+ * label in subsequent calls. Indices of removed labels are reused.
+ *
+ * @return index of label, -1 on error
+ *
+ * @see TextBatch::SetLabelText TextBatch::RemoveLabel
+ */
+int32 TextBatch::AddLabel(const TCHAR* text, const Vec3& pos, float size, const Col4& color)
+{
+	int32	index = m_NumLabels;
+	Label*	label;
+
+	if (m_Atlas.IsNull() || (m_Atlas->GetFont() == NULL))
+		VX_ERROR(("TextBatch::AddLabel ERROR no font\n"), -1);
+	if (m_NumFree > 0)							// reuse a removed label
+	{
+		for (index = 0; index < m_NumLabels; ++index)
+			if (m_Labels[index].MaxGlyphs < 0)
+				break;
+		--m_NumFree;
+	}
+	else
+	{
+		if (m_NumLabels >= m_MaxLabels)
+		{
+			int32	n = m_MaxLabels ? m_MaxLabels * 2 : 64;
+			Label*	labels = (Label*) realloc(m_Labels, n * sizeof(Label));
+
+			if (labels == NULL)
+				VX_ERROR(("TextBatch::AddLabel ERROR out of memory for %d labels\n", n), -1);
+			m_Labels = labels;
+			m_MaxLabels = n;
+		}
+		++m_NumLabels;
+	}
+	label = &m_Labels[index];
+	label->Pos = pos;
+	label->Size = size;
+	label->Color = Color(color);
+	label->FirstVtx = -1;
+	label->MaxGlyphs = 0;
+	label->NumGlyphs = 0;
+	if (!SetLabelText(index, text))
+	{
+		RemoveLabel(index);
+		return -1;
+	}
+	return index;
+}
+
+/*!
+ * @fn bool TextBatch::SetLabelText(int32 index, const TCHAR* text)
+ * @param index	index of label to change
+ * @param text	null-terminated string to display, may contain newlines
+ *
+ * Replaces the glyphs for a label. If the new text fits in the
+ * glyph rectangles already allocated for the label, only those
+ * vertices are changed. Otherwise the label gets a new run of
+ * vertices at the end of the vertex array.
+ *
+ * @see TextBatch::Compact Geometry::Touch
+ */
+bool TextBatch::SetLabelText(int32 index, const TCHAR* text)
+{
+	Label*	label;
+	int32	need = CountGlyphs(text);
+	int32	n;
+
+	if ((index < 0) || (index >= m_NumLabels) || (m_Labels[index].MaxGlyphs < 0) || m_Atlas.IsNull())
+		return false;
+	label = &m_Labels[index];
+	if (need > label->MaxGlyphs)
+	{
+		int32	size = label->MaxGlyphs * 2;
+		int32	first;
+
+		if (size < need)
+			size = need;
+		if (size < TEXTBATCH_MinGlyphs)
+			size = TEXTBATCH_MinGlyphs;
+		if ((first = AllocGlyphs(size)) < 0)
+			return false;
+		if (label->FirstVtx >= 0)				// abandon the old run
+		{
+			ClearGlyphs(*label, 0, label->NumGlyphs);
+			m_WastedGlyphs += label->MaxGlyphs;
+		}
+		label->FirstVtx = first;
+		label->MaxGlyphs = size;
+		label->NumGlyphs = 0;
+	}
+	n = WriteGlyphs(*label, text);
+	if (n < label->NumGlyphs)
+		ClearGlyphs(*label, n, label->NumGlyphs);
+	label->NumGlyphs = n;
+	Touch();
+	if ((m_WastedGlyphs > TEXTBATCH_MinWaste) && (m_WastedGlyphs > m_NumGlyphs / 2))
+		Compact();
+	return true;
+}
+
+/*!
+ * @fn bool TextBatch::SetLabelPos(int32 index, const Vec3& pos)
+ * @param index	index of label to move
+ * @param pos	new location of the baseline of the first character
+ *
+ * Moves the glyphs of a label without regenerating them.
+ *
+ * @see TextBatch::AddLabel
+ */
+bool TextBatch::SetLabelPos(int32 index, const Vec3& pos)
+{
+	Label*	label;
+	float*	vtx;
+	Vec3	ofs;
+
+	if ((index < 0) || (index >= m_NumLabels) || (m_Labels[index].MaxGlyphs < 0))
+		return false;
+	label = &m_Labels[index];
+	ofs = pos - label->Pos;
+	label->Pos = pos;
+	if (label->NumGlyphs == 0)
+		return true;
+	vtx = GetVertices()->GetData() + label->FirstVtx * TEXTBATCH_VtxSize;
+	for (int32 i = 0; i < 4 * label->NumGlyphs; ++i)
+	{
+		Vec3*	loc = (Vec3*) vtx;
+
+		*loc += ofs;
+		m_Bound.Extend(*loc);
+		vtx += TEXTBATCH_VtxSize;
+	}
+	Touch();
+	return true;
+}
+
+/*!
+ * @fn bool TextBatch::SetLabelColor(int32 index, const Col4& color)
+ * @param index	index of label to change
+ * @param color	new text color
+ *
+ * Changes the vertex colors of the glyphs of a label.
+ */
+bool TextBatch::SetLabelColor(int32 index, const Col4& color)
+{
+	Label*	label;
+	float*	vtx;
+
+	if ((index < 0) || (index >= m_NumLabels) || (m_Labels[index].MaxGlyphs < 0))
+		return false;
+	label = &m_Labels[index];
+	label->Color = Color(color);
+	if (label->NumGlyphs == 0)
+		return true;
+	vtx = GetVertices()->GetData() + label->FirstVtx * TEXTBATCH_VtxSize;
+	for (int32 i = 0; i < 4 * label->NumGlyphs; ++i)
+	{
+		vtx[3] = *((float*) &label->Color);
+		vtx += TEXTBATCH_VtxSize;
+	}
+	Touch();
+	return true;
+}
+
+/*!
+ * @fn bool TextBatch::RemoveLabel(int32 index)
+ * @param index	index of label to remove
+ *
+ * Removes a label from the batch. Its glyphs are collapsed and its
+ * vertices are reclaimed the next time the batch is compacted.
+ *
+ * @see TextBatch::Compact
+ */
+bool TextBatch::RemoveLabel(int32 index)
+{
+	Label*	label;
+
+	if ((index < 0) || (index >= m_NumLabels) || (m_Labels[index].MaxGlyphs < 0))
+		return false;
+	label = &m_Labels[index];
+	if (label->FirstVtx >= 0)
+	{
+		ClearGlyphs(*label, 0, label->NumGlyphs);
+		Touch();
+		m_WastedGlyphs += label->MaxGlyphs;
+	}
+	label->FirstVtx = -1;
+	label->MaxGlyphs = -1;
+	label->NumGlyphs = 0;
+	++m_NumFree;
+	return true;
+}
+
+/*
+ * Return the maximum number of glyphs needed to display a string.
+ */
+int32 TextBatch::CountGlyphs(const TCHAR* text)
+{
+	int32	n = 0;
+
+	if (text == NULL)
+		return 0;
+	for (const TCHAR* p = text; *p; ++p)
+		if ((*p != TEXT('\n')) && (*p != TEXT('\r')))
+			++n;
+	return n;
+}
+
+/*
+ * Add room for n glyph rectangles to the end of the vertex array and
+ * the indices for their triangles. The new glyphs are collapsed.
+ * Return the index of the first new vertex, -1 if out of memory.
+ */
+int32 TextBatch::AllocGlyphs(int32 n)
+{
+	int32		first = (int32) GetNumVtx();
+	IndexArray*	inds = GetIndices();
+	int32*		idx;
+
+	if (inds == NULL)
+	{
+		inds = new IndexArray;
+		SetIndices(inds);
+	}
+	VX_ASSERT(GetVtxSize() == TEXTBATCH_VtxSize);
+	if (!SetNumVtx(first + 4 * n) || !inds->SetSize(6 * (m_NumGlyphs + n)))
+		VX_ERROR(("TextBatch::AllocGlyphs ERROR out of memory for %d glyphs\n", m_NumGlyphs + n), -1);
+	UpdateMemStats();
+	memset(GetVertices()->GetData() + first * TEXTBATCH_VtxSize, 0, 4 * n * TEXTBATCH_VtxSize * sizeof(float));
+	idx = inds->GetData() + 6 * m_NumGlyphs;
+	for (int32 i = 0; i < n; ++i)
+	{
+		int32	v = first + 4 * i;
+
+		*idx++ = v;
+		*idx++ = v + 1;
+		*idx++ = v + 2;
+		*idx++ = v + 2;
+		*idx++ = v + 3;
+		*idx++ = v;
+	}
+	m_NumGlyphs += n;
+	return first;
+}
+
+/*
+ * Lay out the glyphs for a string in the vertex run of a label
+ * and return the number of glyph rectangles used. The origin is at the
+ * baseline of the first character, as it is for TextGeometry.
+ */
+int32 TextBatch::WriteGlyphs(Label& label, const TCHAR* text)
+{
+	TexFont*	font = m_Atlas->GetFont();
+	float		lineheight = float(font->max_ascent + font->max_descent);
+	float		scale = label.Size / lineheight;
+	float		color = *((float*) &label.Color);
+	float		x = label.Pos.x;
+	float		y = label.Pos.y;
+	float		z = label.Pos.z;
+	float*		vtx;
+	int32		n = 0;
+
+	if ((text == NULL) || (label.MaxGlyphs == 0))
+		return 0;
+	vtx = GetVertices()->GetData() + label.FirstVtx * TEXTBATCH_VtxSize;
+	for (const TCHAR* p = text; *p && (n < label.MaxGlyphs); ++p)
+	{
+		const TexGlyphVertexInfo*	tgvi;
+		const short*				v[4];
+		const float*				t[4];
+
+		switch (*p)
+		{
+			case TEXT('\r'):
+			continue;
+
+			case TEXT('\n'):
+			x = label.Pos.x;
+			y -= scale * lineheight;
+			continue;
+		}
+		if ((tgvi = m_Atlas->GetGlyph(*p)) == NULL)
+			continue;
+		v[0] = tgvi->v0; v[1] = tgvi->v1; v[2] = tgvi->v2; v[3] = tgvi->v3;
+		t[0] = tgvi->t0; t[1] = tgvi->t1; t[2] = tgvi->t2; t[3] = tgvi->t3;
+		for (int i = 0; i < 4; ++i)
+		{
+			vtx[0] = v[i][0] * scale + x;
+			vtx[1] = v[i][1] * scale + y;
+			vtx[2] = z;
+			vtx[3] = color;
+			vtx[4] = t[i][0];
+			vtx[5] = t[i][1];
+			m_Bound.Extend(*((Vec3*) vtx));
+			vtx += TEXTBATCH_VtxSize;
+		}
+		x += tgvi->advance * scale;
+		++n;
+	}
+	return n;
+}
+
+/*
+ * Collapse a range of glyph rectangles in a label so they have no area.
+ */
+void TextBatch::ClearGlyphs(const Label& label, int32 first, int32 last)
+{
+	float*	vtx;
+
+	if (first >= last)
+		return;
+	vtx = GetVertices()->GetData() + (label.FirstVtx + 4 * first) * TEXTBATCH_VtxSize;
+	for (int32 i = 4 * first; i < 4 * last; ++i)
+	{
+		vtx[0] = label.Pos.x;
+		vtx[1] = label.Pos.y;
+		vtx[2] = label.Pos.z;
+		vtx += TEXTBATCH_VtxSize;
+	}
+}
+
+/*!
+ * @fn void TextBatch::Compact()
+ *
+ * Moves the vertex runs of the labels so they are adjacent,
+ * reclaiming the vertices of removed labels and the runs
+ * abandoned by labels which outgrew them. Each label keeps
+ * its spare room. This is done automatically when more than
+ * half of the glyph rectangles are wasted.
+ *
+ * @see TextBatch::SetLabelText TextBatch::RemoveLabel
+ */
+void TextBatch::Compact()
+{
+	const int32	vtxbytes = 4 * TEXTBATCH_VtxSize * sizeof(float);
+	float*		vtx = GetVertices()->GetData();
+	float*		old;
+	int32		nglyphs = 0;
+	int32		first = 0;
+
+	if (m_WastedGlyphs == 0)
+		return;
+	old = (float*) malloc(m_NumGlyphs * vtxbytes);
+	if (old == NULL)
+		VX_ERROR_RETURN(("TextBatch::Compact ERROR out of memory\n"));
+	memcpy(old, vtx, m_NumGlyphs * vtxbytes);
+	m_Bound.Empty();
+	for (int32 i = 0; i < m_NumLabels; ++i)
+	{
+		Label&	label = m_Labels[i];
+		float*	src;
+
+		if (label.FirstVtx < 0)
+			continue;
+		src = old + label.FirstVtx * TEXTBATCH_VtxSize;
+		memcpy(vtx + first * TEXTBATCH_VtxSize, src, label.MaxGlyphs * vtxbytes);
+		for (int32 j = 0; j < 4 * label.NumGlyphs; ++j)
+			m_Bound.Extend(*((Vec3*) (src + j * TEXTBATCH_VtxSize)));
+		label.FirstVtx = first;
+		first += 4 * label.MaxGlyphs;
+		nglyphs += label.MaxGlyphs;
+	}
+	free(old);
+	SetNumVtx(first);
+	GetIndices()->SetSize(6 * nglyphs);		// indices for the first glyphs are unchanged
+	m_NumGlyphs = nglyphs;
+	m_WastedGlyphs = 0;
+	Touch();
+}
+
+void TextBatch::Empty()
+{
+	TriMesh::Empty();
+	m_NumLabels = 0;
+	m_NumFree = 0;
+	m_NumGlyphs = 0;
+	m_WastedGlyphs = 0;
+}
+
+/*!
+ * @fn intptr TextBatch::Cull(const Matrix* trans, Scene* scene)
+ *
+ * Culls the batch as a whole and reloads the atlas texture
+ * if glyphs were added to it since the last frame.
+ *
+ * @see GlyphAtlas::UpdateTexture
+ */
+intptr TextBatch::Cull(const Matrix* trans, Scene* scene)
+{
+	if (!m_Atlas.IsNull())
+		m_Atlas->UpdateTexture();
+	return TriMesh::Cull(trans, scene);
+}
+
+bool TextBatch::GetBound(Box3* box) const
+{
+	if (m_Bound.IsEmpty())
+		return false;
+	*box = m_Bound;
+	return true;
+}
+
+/****
+ *
+ * class TextBatch override for SharedObj::Copy
+ *
+ ****/
+bool TextBatch::Copy(const SharedObj* srcobj)
+{
+	ObjectLock dlock(this);
+	ObjectLock slock(srcobj);
+	if (!TriMesh::Copy(srcobj))
+		return false;
+	const TextBatch* src = (const TextBatch*) srcobj;
+	if (src->IsClass(VX_TextBatch))
+	{
+		if (m_MaxLabels < src->m_NumLabels)
+		{
+			Label* labels = (Label*) realloc(m_Labels, src->m_NumLabels * sizeof(Label));
+
+			if (labels == NULL)
+				VX_ERROR(("TextBatch::Copy ERROR out of memory for %d labels\n", src->m_NumLabels), false);
+			m_Labels = labels;
+			m_MaxLabels = src->m_NumLabels;
+		}
+		if (src->m_NumLabels > 0)
+			memcpy(m_Labels, src->m_Labels, src->m_NumLabels * sizeof(Label));
+		m_Atlas = src->m_Atlas;
+		m_NumLabels = src->m_NumLabels;
+		m_NumFree = src->m_NumFree;
+		m_NumGlyphs = src->m_NumGlyphs;
+		m_WastedGlyphs = src->m_WastedGlyphs;
+		m_Bound = src->m_Bound;
+	}
+	return true;
+}
+
+DebugOut& TextBatch::Print(DebugOut& dbg, int opts) const
+{
+	if ((opts & PRINT_Attributes) == 0)
+		return SharedObj::Print(dbg, opts);
+	TriMesh::Print(dbg, opts & ~PRINT_Trailer);
+	endl(dbg << "\t<attr name='NumLabels'>" << GetNumLabels() << "</attr>");
+	endl(dbg << "\t<attr name='NumGlyphs'>" << m_NumGlyphs << "</attr>");
+	endl(dbg << "\t<attr name='WastedGlyphs'>" << m_WastedGlyphs << "</attr>");
+	TriMesh::Print(dbg, opts & PRINT_Trailer);
+	return dbg;
+}
+
+}	// end Vixen
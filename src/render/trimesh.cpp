@@ -27,6 +27,10 @@ VX_IMPLEMENT_CLASSID(TriMesh, Mesh, VX_TriMesh);
 TriMesh::TriMesh(int style, intptr nvtx)
 	: Mesh(style, nvtx)
 {
+	m_Meshlets = NULL;
+	m_NumMeshlets = 0;
+	m_DrawRanges = NULL;
+	m_NumRanges = 0;
 	if (nvtx)
 		SetMaxVtx(nvtx);
 }
@@ -46,12 +50,378 @@ TriMesh::TriMesh(int style, intptr nvtx)
 TriMesh::TriMesh(const TCHAR* layout_desc, intptr nvtx)
 	: Mesh(layout_desc, nvtx)
 {
+	m_Meshlets = NULL;
+	m_NumMeshlets = 0;
+	m_DrawRanges = NULL;
+	m_NumRanges = 0;
 	if (nvtx)
 		SetMaxVtx(nvtx);
 }
 
 TriMesh::TriMesh(const TriMesh& src) : Mesh(src)
 {
+	m_Meshlets = NULL;
+	m_NumMeshlets = 0;
+	m_DrawRanges = NULL;
+	m_NumRanges = 0;
+	CopyMeshlets(&src);						// indices are shared so meshlets are too
+}
+
+TriMesh::~TriMesh()
+{
+	EmptyMeshlets();
+}
+
+void TriMesh::Empty()
+{
+	Mesh::Empty();
+	EmptyMeshlets();
+}
+
+/****
+ *
+ * Override for SharedObj::Copy
+ *
+ ****/
+bool TriMesh::Copy(const SharedObj* src_obj)
+{
+	if (!Mesh::Copy(src_obj))
+		return false;
+	if (src_obj->IsKindOf(CLASS_(TriMesh)))
+		return CopyMeshlets((const TriMesh*) src_obj);
+	return true;
+}
+
+/*
+ * Copy the meshlets of another mesh with the same indices.
+ */
+bool TriMesh::CopyMeshlets(const TriMesh* src)
+{
+	int32	n = src->m_NumMeshlets;
+
+	EmptyMeshlets();
+	if (n == 0)
+		return true;
+	m_Meshlets = (Meshlet*) malloc(n * sizeof(Meshlet));
+	m_DrawRanges = (int32*) malloc(2 * n * sizeof(int32));
+	if ((m_Meshlets == NULL) || (m_DrawRanges == NULL))
+	{
+		EmptyMeshlets();
+		VX_ERROR(("TriMesh::Copy ERROR out of memory for %d meshlets\n", n), false);
+	}
+	memcpy(m_Meshlets, src->m_Meshlets, n * sizeof(Meshlet));
+	m_NumMeshlets = n;
+	return true;
+}
+
+/*!
+ * @fn void TriMesh::EmptyMeshlets()
+ *
+ * Discards the meshlets of this mesh. The mesh is drawn
+ * and culled as a whole afterwards.
+ *
+ * @see TriMesh::MakeMeshlets
+ */
+void TriMesh::EmptyMeshlets()
+{
+	if (m_Meshlets)
+		free(m_Meshlets);
+	if (m_DrawRanges)
+		free(m_DrawRanges);
+	m_Meshlets = NULL;
+	m_DrawRanges = NULL;
+	m_NumMeshlets = 0;
+	m_NumRanges = 0;
+}
+
+/*
+ * Compute the bounding sphere and normal cone of a meshlet
+ * from the locations of its vertices.
+ */
+static void meshlet_bounds(TriMesh::Meshlet& m, const int32* inds, const VertexPool::DecodeIter& viter)
+{
+	Vec3	vmin, vmax, axis(0, 0, 0);
+	Vec3	p0, p1, p2;
+	Vec3*	normals;
+	float	mindp = 1.0f;
+	float	r2 = 0.0f;
+
+	inds += m.StartIdx;
+	normals = (Vec3*) Core::ThreadAllocator::Get()->Alloc(m.NumTris * sizeof(Vec3));
+	viter.GetLoc(inds[0], vmin);
+	vmax = vmin;
+	for (int32 t = 0; t < m.NumTris; ++t)
+	{
+		Vec3*	n = normals + t;
+
+		viter.GetLoc(inds[3 * t], p0);
+		viter.GetLoc(inds[3 * t + 1], p1);
+		viter.GetLoc(inds[3 * t + 2], p2);
+		for (int k = 0; k < 3; ++k)
+		{
+			const Vec3& p = (k == 0) ? p0 : ((k == 1) ? p1 : p2);
+
+			if (p.x < vmin.x) vmin.x = p.x;
+			if (p.y < vmin.y) vmin.y = p.y;
+			if (p.z < vmin.z) vmin.z = p.z;
+			if (p.x > vmax.x) vmax.x = p.x;
+			if (p.y > vmax.y) vmax.y = p.y;
+			if (p.z > vmax.z) vmax.z = p.z;
+		}
+		p1 -= p0;								// same winding as TriMesh::MakeNormals
+		p2 -= p0;
+		*n = p1.Cross(p2);
+		if (n->Normalize() > 0.0f)
+			axis += *n;
+	}
+	m.Center = vmin;
+	m.Center += vmax;
+	m.Center *= 0.5f;
+	for (int32 i = 0; i < 3 * m.NumTris; ++i)
+	{
+		float d;
+
+		viter.GetLoc(inds[i], p0);
+		d = p0.DistanceSquared(m.Center);
+		if (d > r2)
+			r2 = d;
+	}
+	m.Radius = sqrtf(r2);
+	m.ConeAxis.Set(0, 0, 0);
+	m.ConeCutoff = 2.0f;
+	if (axis.Normalize() > 0.0f)
+	{
+		for (int32 t = 0; t < m.NumTris; ++t)
+		{
+			float	d = normals[t].Dot(axis);
+
+			if ((normals[t].LengthSquared() > 0.0f) && (d < mindp))
+				mindp = d;
+		}
+		m.ConeAxis = axis;
+		if (mindp > 0.1f)						// cone narrow enough to cull with
+			m.ConeCutoff = sqrtf(1.0f - mindp * mindp);
+	}
+	Core::ThreadAllocator::Get()->Free(normals);
+}
+
+/*!
+ * @fn bool TriMesh::MakeMeshlets(int maxvtx, int maxtris)
+ * @param maxvtx	maximum number of different vertices in a meshlet
+ * @param maxtris	maximum number of triangles in a meshlet
+ *
+ * Divides the triangles of the mesh into meshlets which are culled
+ * separately. Each meshlet is a run of consecutive triangles in the
+ * index array, so the indices are not changed and the mesh can still
+ * be drawn as a whole. A new meshlet is started whenever adding
+ * the next triangle would exceed either limit. Meshes whose triangles
+ * are ordered for the vertex cache make compact meshlets.
+ *
+ * Each meshlet has a bounding sphere and a cone which contains the
+ * facing directions of its triangles. TriMesh::Cull tests them against
+ * the camera and keeps the index ranges of the visible meshlets.
+ *
+ * The meshlets are not saved with the mesh and must be made again
+ * if the vertex locations or the indices change. They are not used
+ * if the vertices are animated (VertexPool::MORPH) or if the mesh
+ * is shared by more than one shape.
+ *
+ * @return \b true if meshlets were made, \b false if mesh has no indexed triangles
+ *
+ * @see TriMesh::Cull TriMesh::GetDrawRanges SceneOptimize::MakeMeshlets
+ */
+bool TriMesh::MakeMeshlets(int maxvtx, int maxtris)
+{
+	ObjectLock		lock(this);
+	const VertexArray*	verts = GetVertices();
+	intptr			nvtx = GetNumVtx();
+	intptr			ntris = GetNumIdx() / 3;
+	const int32*	inds;
+	int32*			stamp;				// meshlet which last used each vertex
+	int32			maxmeshlets;
+	Meshlet*		cur;
+
+	EmptyMeshlets();
+	if ((verts == NULL) || (nvtx == 0) || (ntris == 0) || (maxvtx < 3) || (maxtris < 1))
+		return false;
+	VX_ASSERT(GetNumIdx() < INT_MAX);
+	inds = m_VtxIndex->GetData();
+	maxmeshlets = int32(ntris / maxtris) + 1;
+	stamp = (int32*) malloc(nvtx * sizeof(int32));
+	m_Meshlets = (Meshlet*) malloc(maxmeshlets * sizeof(Meshlet));
+	if ((stamp == NULL) || (m_Meshlets == NULL))
+	{
+		if (stamp)
+			free(stamp);
+		EmptyMeshlets();
+		VX_ERROR(("TriMesh::MakeMeshlets ERROR out of memory for %d triangles\n", (int) ntris), false);
+	}
+	memset(stamp, -1, nvtx * sizeof(int32));
+	cur = m_Meshlets;
+	cur->StartIdx = 0;
+	cur->NumTris = 0;
+	cur->NumVtx = 0;
+	for (intptr t = 0; t < ntris; ++t)
+	{
+		const int32*	tri = inds + 3 * t;
+		int32			id = m_NumMeshlets;
+		int				newvtx = 0;
+
+		if ((tri[0] >= nvtx) || (tri[1] >= nvtx) || (tri[2] >= nvtx) ||
+			(tri[0] < 0) || (tri[1] < 0) || (tri[2] < 0))
+		{
+			free(stamp);
+			EmptyMeshlets();
+			VX_ERROR(("TriMesh::MakeMeshlets ERROR triangle %d has bad vertex index\n", (int) t), false);
+		}
+		for (int k = 0; k < 3; ++k)			// count vertices not already in the meshlet
+			if ((stamp[tri[k]] != id) && ((k == 0) || (tri[k] != tri[0])) && ((k < 2) || (tri[2] != tri[1])))
+				++newvtx;
+		if ((cur->NumTris > 0) && ((cur->NumVtx + newvtx > maxvtx) || (cur->NumTris >= maxtris)))
+		{
+			if (++m_NumMeshlets >= maxmeshlets)		// start a new meshlet
+			{
+				Meshlet* tmp = (Meshlet*) realloc(m_Meshlets, 2 * maxmeshlets * sizeof(Meshlet));
+
+				if (tmp == NULL)
+				{
+					free(stamp);
+					EmptyMeshlets();
+					VX_ERROR(("TriMesh::MakeMeshlets ERROR out of memory for %d meshlets\n", 2 * maxmeshlets), false);
+				}
+				m_Meshlets = tmp;
+				maxmeshlets *= 2;
+			}
+			cur = m_Meshlets + m_NumMeshlets;
+			cur->StartIdx = int32(3 * t);
+			cur->NumTris = 0;
+			cur->NumVtx = 0;
+			id = m_NumMeshlets;
+			newvtx = 0;
+			for (int k = 0; k < 3; ++k)
+				if ((stamp[tri[k]] != id) && ((k == 0) || (tri[k] != tri[0])) && ((k < 2) || (tri[2] != tri[1])))
+					++newvtx;
+		}
+		for (int k = 0; k < 3; ++k)
+			stamp[tri[k]] = id;
+		cur->NumVtx += newvtx;
+		++(cur->NumTris);
+	}
+	++m_NumMeshlets;
+	free(stamp);
+	m_DrawRanges = (int32*) malloc(2 * m_NumMeshlets * sizeof(int32));
+	if (m_DrawRanges == NULL)
+	{
+		EmptyMeshlets();
+		VX_ERROR(("TriMesh::MakeMeshlets ERROR out of memory for %d meshlets\n", m_NumMeshlets), false);
+	}
+
+	VertexPool::DecodeIter	viter(verts);	// decodes compact locations
+
+	#pragma omp PARALLEL_FOR(m_NumMeshlets)
+	cilk_for (int32 i = 0; i < m_NumMeshlets; ++i)
+		meshlet_bounds(m_Meshlets[i], inds, viter);
+	return true;
+}
+
+/*!
+ * @fn intptr TriMesh::Cull(const Matrix* trans, Scene* scene)
+ * @param trans	matrix to map from local coordinates to world coordinates
+ * @param scene	scene the mesh is being rendered to, NULL suppresses culling
+ *
+ * Culls the mesh as a whole like Geometry::Cull. If the mesh is divided
+ * into meshlets, each one is culled against the camera view volume
+ * and, for a perspective camera, against its normal cone to reject
+ * meshlets whose triangles all face away from the eye. The index ranges
+ * of the visible meshlets are saved for the renderer. If no meshlets
+ * are visible, the mesh is marked as culled and will not be drawn.
+ *
+ * The cone test assumes the matrix does not scale the mesh
+ * differently along different axes.
+ *
+ * @return number of vertices culled, less than the number of vertices
+ *			in the mesh unless all of it was culled
+ *
+ * @see TriMesh::MakeMeshlets TriMesh::GetDrawRanges Geometry::Cull
+ */
+intptr TriMesh::Cull(const Matrix* trans, Scene* scene)
+{
+	intptr				culled = Geometry::Cull(trans, scene);
+	const Meshlet*		m = m_Meshlets;
+	const VertexArray*	verts = GetVertices();
+	const Camera*		cam;
+	const Meshlet*		last;
+	Vec3				eye;
+	bool				cones;
+	int32				nranges = 0;
+	int32				lastend = -1;
+
+	m_NumRanges = 0;
+	if ((m == NULL) || (scene == NULL) || (culled > 0) || IsSet(GEO_Culled))
+		return culled;
+	last = m + m_NumMeshlets - 1;
+	if ((last->StartIdx + 3 * last->NumTris != GetNumIdx()) ||	// indices changed?
+		(GetNumShapes() > 1) ||									// shared by other shapes?
+		(verts == NULL) || verts->IsSet(VertexPool::MORPH))		// vertices animated?
+		return culled;
+	cam = scene->GetCamera();
+	cones = (cam->GetType() == Camera::PERSPECTIVE);
+	if (cones)
+	{
+		eye = cam->GetCenter(Model::WORLD);		// eye in local coordinates
+		if (trans && !trans->IsIdentity())
+		{
+			Matrix	inv;
+			Vec3	p(eye);
+
+			inv.Invert(*trans);
+			inv.Transform(p, eye);
+		}
+	}
+	for (int32 i = 0; i < m_NumMeshlets; ++i, ++m)
+	{
+		int32	n = 3 * m->NumTris;
+
+		if (cones && (m->ConeCutoff < 1.0f))	// all triangles face away?
+		{
+			Vec3	v(m->Center);
+
+			v -= eye;
+			if (v.Dot(m->ConeAxis) >= m->ConeCutoff * v.Length() + m->Radius)
+			{
+				culled += m->NumVtx;
+				continue;
+			}
+		}
+		Sphere	bsp(m->Center, m->Radius);
+
+		if (trans)
+			bsp *= *trans;
+		if (!cam->IsVisible(bsp))
+		{
+			culled += m->NumVtx;
+			continue;
+		}
+		if (m->StartIdx == lastend)				// extend previous range
+			m_DrawRanges[2 * nranges - 1] += n;
+		else
+		{
+			m_DrawRanges[2 * nranges] = m->StartIdx;
+			m_DrawRanges[2 * nranges + 1] = n;
+			++nranges;
+		}
+		lastend = m->StartIdx + n;
+	}
+	if (nranges == 0)							// all meshlets culled
+	{
+		SetFlags(GEO_Culled);
+		return GetNumVtx();
+	}
+	if ((nranges > 1) || (m_DrawRanges[1] < GetNumIdx()))
+		m_NumRanges = nranges;					// otherwise draw everything
+	if (culled >= GetNumVtx())					// shared vertices were counted more than once
+		culled = GetNumVtx() - 1;
+	return culled;
 }
 
 
@@ -90,20 +460,20 @@ bool TriMesh::Hit(const Ray& ray, TriHitEvent* hitinfo) const
 	}
 
 	const VertexArray* verts = GetVertices();
-	const float* vptr = verts->GetData();
 	intptr		i0, i1, i2;
 	float		dist = FLT_MAX;
 	Vec3		intersect(0,0,0);				// minimum intersection distance
-	int			vtxsize = verts->GetVtxSize();
+	Vec3		v0, v1, v2;
+	VertexPool::DecodeIter	viter(verts);		// decodes compact locations
 	TriMesh::TriIter	triter(this);			// test all the triangles
 
 	hitinfo->Target = this;
 	while (triter.Next(i0, i1, i2))				// for each triangle
 	{
-		const Vec3* v0 = (const Vec3*) (vptr + i0 * vtxsize);	// get vertex locations
-		const Vec3* v1 = (const Vec3*) (vptr + i1 * vtxsize);
-		const Vec3* v2 = (const Vec3*) (vptr + i2 * vtxsize);
-		if (TriHit(ray, *v0, *v1, *v2, &intersect))
+		viter.GetLoc(i0, v0);					// get vertex locations
+		viter.GetLoc(i1, v1);
+		viter.GetLoc(i2, v2);
+		if (TriHit(ray, v0, v1, v2, &intersect))
 		{
 			float d = intersect.Distance(ray.start);
 			if (d < dist)						// closest one so far?
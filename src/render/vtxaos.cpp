@@ -37,6 +37,7 @@ VX_IMPLEMENT_CLASSID(VertexArray, SharedObj, VX_VtxArray);
 VertexArray::VertexArray(int style, intptr nvtx) :	VertexPool(style)
 {
 	DevHandle = NULL;
+	m_MemCharged = 0;
 	if (VertexAlloc)
 		m_Data.SetElemAllocator(VertexAlloc);
 	if (nvtx > 0)
@@ -46,6 +47,7 @@ VertexArray::VertexArray(int style, intptr nvtx) :	VertexPool(style)
 VertexArray::VertexArray(const TCHAR* layout_desc, intptr nvtx) : VertexPool(layout_desc)
 {
 	DevHandle = NULL;
+	m_MemCharged = 0;
 	if (VertexAlloc)
 		m_Data.SetElemAllocator(VertexAlloc);
 	if (nvtx > 0)
@@ -66,12 +68,32 @@ VertexArray::VertexArray(const VertexArray& src)
   :	VertexPool(src.GetStyle())
 {
 	DevHandle = NULL;
+	m_MemCharged = 0;
 	if (VertexAlloc)
 		m_Data.SetElemAllocator(VertexAlloc);
 	SetMaxVtx(src.GetNumVtx());
 	Copy(&src);
 }
 
+VertexArray::~VertexArray()
+{
+	Core::MemStats::Charge(Core::MemStats::VERTEX, -m_MemCharged);
+}
+
+/*
+ * Charge the bytes allocated for vertices to vertex memory
+ * so the total for all vertex arrays is available from Core::MemStats.
+ */
+void VertexArray::UpdateMemStats()
+{
+	intptr	bytes = m_Data.GetMaxSize() * sizeof(float);
+
+	if (bytes == m_MemCharged)
+		return;
+	Core::MemStats::Charge(Core::MemStats::VERTEX, bytes - m_MemCharged);
+	m_MemCharged = bytes;
+}
+
 /*!
  * @fn bool VertexArray::SetMaxVtx(intptr n)
  *
@@ -91,6 +113,7 @@ bool	VertexArray::SetMaxVtx(intptr n)
 	if (!m_Data.SetMaxSize(n * GetVtxSize()))
 		return false;
 	m_MaxVtx = n;
+	UpdateMemStats();
 	return true;
 }
 
@@ -112,6 +135,7 @@ bool VertexArray::SetNumVtx(intptr n)
 {
 	if (!m_Data.SetSize(n * GetVtxSize()))
 		return false;
+	UpdateMemStats();
 	Core::InterlockSet(&m_NumVtx, n);		// remember new size
 	SetChanged(true);
 	return true;
@@ -169,6 +193,7 @@ intptr VertexArray::AddVertices(const float* vtx, intptr n)
 		return ofs;
 	for (intptr i = ofs * vtxsize; i < n; i++)	// copy the vertex data
 		m_Data.SetAt(i, *vtx++);
+	UpdateMemStats();
 	return ofs;
 }
 
@@ -274,10 +299,13 @@ bool VertexArray::Copy(const SharedObj* src_obj)
 	ObjectLock dlock(this);
 	ObjectLock slock(src_obj);
 	const VertexArray*	src = (const VertexArray*) src_obj;
+	bool				rc;
 
 	if (!VertexPool::Copy(src_obj))
 		return false;
-	return m_Data.Copy(&(src->m_Data));
+	rc = m_Data.Copy(&(src->m_Data));
+	UpdateMemStats();
+	return rc;
 }
 
 }	// end Vixen
\ No newline at end of file
@@ -53,7 +53,8 @@ static const TCHAR* opnames[] =
 	{ TEXT("Transform"), TEXT("AddVertices"), TEXT("SetStyle"), TEXT("SetAt"),
 	  TEXT("SetLocs"),TEXT( "SetNormals"), TEXT("SetColors4"), TEXT("SetTexCoords"),
 	  TEXT("Merge"), TEXT("DupVtx"), TEXT("Append4"), TEXT("ReflectMap"), TEXT("SetMaxVtx"),
-	  TEXT("SelectTexCoords"), TEXT("SetNumTexCoords"), TEXT("SetColor"), TEXT("Append"), TEXT("SetLayout") };
+	  TEXT("SelectTexCoords"), TEXT("SetNumTexCoords"), TEXT("SetColor"), TEXT("Append"), TEXT("SetLayout"),
+	  TEXT("SetQuantize") };
 
 const TCHAR** VertexArray::DoNames = opnames;
 
@@ -89,6 +90,8 @@ VertexPool::VertexPool(int style) : SharedObj()
 	m_NumTexCoords = 0;
 	m_Layout = NULL;
 	m_Style = 0;
+	m_QuantScale.Set(1, 1, 1);
+	m_QuantOffset.Set(0, 0, 0);
 	if (style)
 		SetStyle(style);			// vertex style (which components we need)
 }
@@ -101,6 +104,8 @@ VertexPool::VertexPool(const TCHAR* layout_desc)
 	m_Style = 0;
 	m_NumTexCoords = 0;
 	m_Layout = NULL;
+	m_QuantScale.Set(1, 1, 1);
+	m_QuantOffset.Set(0, 0, 0);
 	SetLayout(layout_desc);
 }
 
@@ -243,8 +248,8 @@ const DataLayout* VertexPool::FindLayout(const TCHAR* layout_desc)
 		{
 			layout->Style |= VertexPool::NORMALS;
 			slot.Style |= VertexPool::NORMALS;
-			if (layout->NormalOfs < 0)
-				layout->NormalOfs = slot.Offset;
+			if ((layout->NormalOfs < 0) && (slot.Format == DataLayout::FULL))
+				layout->NormalOfs = slot.Offset;	// only float normals can be accessed directly
 		}
 		else if ((slot.Name.Find(TEXT("texcoord")) == 0) || (slot.Name.Find(TEXT("texture")) == 0))
 		{
@@ -444,20 +449,22 @@ VertexPool& VertexPool::operator*=(const Matrix& trans)
 
 	if (trans.IsIdentity())
 		return *this;
-	VertexPool::Iter iter(this);
-	while (iter.Next())
+	if (m_Layout->IsCompact())
 	{
-		Vec3* p = iter.GetLoc();
-		Vec3* n = iter.GetNormal();
-	
-		*p *= trans;
-		if (n)
-		{
-			Vec3	t(*n);
-			trans.TransformVector(t, *n);
-			n->Normalize();
-		}
+		VX_WARNING(("VertexPool::Transform cannot transform compact vertex layout %s\n", (const TCHAR*) m_Layout->Descriptor));
+		return *this;
 	}
+
+	float*		data = GetData();
+	int			vtxsize = GetVtxSize();
+	int			nmlofs = GetLayout()->NormalOfs;
+	const Mat4&	mtx = trans.GetMat4();
+
+	if (data == NULL)
+		return *this;
+	mtx.TransformPoints(data, data, GetNumVtx(), vtxsize);
+	if (nmlofs >= 0)
+		mtx.TransformVectors(data + nmlofs, data + nmlofs, GetNumVtx(), vtxsize, true);
 	SetChanged(true);
 	return *this;
 }
@@ -476,6 +483,22 @@ VertexPool& VertexPool::operator*=(const Matrix& trans)
  */
 bool VertexPool::GetBound(Box3* bound) const
 {
+	if (m_Layout && m_Layout->IsCompact())
+	{
+		VertexPool::DecodeIter	iter(this);
+		Vec3					loc;
+
+		if (!iter.Next())
+			return false;
+		iter.GetLoc(loc);
+		bound->Around(loc, loc);
+		while (iter.Next())
+		{
+			iter.GetLoc(loc);
+			bound->Extend(&loc);
+		}
+		return (bound->Width() || bound->Height() || bound->Depth());
+	}
 	VertexPool::ConstIter iter(this);
 	const Vec3* p = (const Vec3*) iter.Next();
 
@@ -487,6 +510,439 @@ bool VertexPool::GetBound(Box3* bound) const
 	return (bound->Width() || bound->Height() || bound->Depth());
 }
 
+/*!
+ * @fn void VertexPool::SetQuantize(const Box3& bound)
+ * @param bound	bounding box the quantized locations must cover
+ *
+ * Locations stored in the 16 bit \b short format are mapped
+ * linearly onto the given bounds, so each step of the 16 bit value
+ * is 1/65535 of the width, height or depth of the box.
+ * This should be called before quantized locations are stored,
+ * changing it afterwards moves the vertices.
+ * VertexPool::Convert computes it automatically from the source vertices.
+ *
+ * @see VertexPool::GetQuantScale VertexPool::GetQuantOffset DataLayout::SetDescriptor
+ */
+void VertexPool::SetQuantize(const Box3& bound)
+{
+	Vec3	scale(bound.max - bound.min);
+
+	scale /= 65535.0f;
+	SetQuantize(scale, bound.min);
+}
+
+void VertexPool::SetQuantize(const Vec3& scale, const Vec3& offset)
+{
+	VX_STREAM_BEGIN(s)
+		*s << OP(VX_VtxArray, VTX_SetQuantize) << this << scale << offset;
+	VX_STREAM_END( )
+
+	m_QuantScale = scale;
+	m_QuantOffset = offset;
+	SetChanged(true);
+}
+
+/*!
+ * @fn bool VertexPool::Convert(const VertexPool* src)
+ * @param src	vertices to convert
+ *
+ * Replaces the vertices in this pool with those from the source
+ * converted to the layout of this pool. Components are matched by name,
+ * components this layout has which the source does not are set to zero.
+ * Either layout may use compact formats. If this layout has quantized
+ * locations, the quantization is set to fit the bounds of the source vertices.
+ *
+ * This is usually done once at load time to make compact vertices
+ * from float ones:
+ * @code
+ *	Core::String		desc;
+ *	Ref<VertexArray>	compact;
+ *
+ *	if (VertexPool::MakeCompactLayout(desc, verts->GetLayout()))
+ *	{
+ *		compact = new VertexArray(desc);
+ *		compact->Convert(verts);
+ *		mesh->SetVertices(compact);
+ *	}
+ * @endcode
+ *
+ * @return \b true if vertices were converted, \b false on error
+ *
+ * @see VertexPool::MakeCompactLayout VertexPool::SetQuantize SceneOptimize::CompactVertices
+ */
+bool VertexPool::Convert(const VertexPool* src)
+{
+	const DataLayout*	dstlayout = m_Layout;
+	const DataLayout*	srclayout = src->GetLayout();
+	intptr				n = src->GetNumVtx();
+	int					srcsize = src->GetVtxSize();
+	int					dstsize = GetVtxSize();
+	const int32*		srcdata = (const int32*) src->GetData();
+	int32*				dstdata;
+	int					map[VX_MAX_LAYOUT_SLOTS];
+	float				tmp[MAX_VTX_SIZE];
+	bool				quantize = false;
+
+	if ((dstlayout == NULL) || (srclayout == NULL))
+		VX_ERROR(("VertexPool::Convert ERROR vertex layout missing\n"), false);
+	for (int i = 0; i < dstlayout->NumSlots; ++i)
+	{
+		const LayoutSlot& dslot = dstlayout->Slot[i];
+
+		map[i] = -1;
+		for (int j = 0; j < srclayout->NumSlots; ++j)
+			if (srclayout->Slot[j].Name == dslot.Name)
+			{
+				map[i] = j;
+				break;
+			}
+		if ((map[i] >= 0) && (dslot.Format == DataLayout::QUANTIZED))
+			quantize = true;
+	}
+	VX_ASSERT(src != this);
+	if (quantize && (n > 0))
+	{
+		Box3	bound;
+
+		src->GetBound(&bound);
+		SetQuantize(bound);
+	}
+	if (!SetNumVtx(n))
+		return false;
+	if (n == 0)
+		return true;
+	dstdata = (int32*) GetData();
+	if ((srcdata == NULL) || (dstdata == NULL))
+		VX_ERROR(("VertexPool::Convert ERROR no vertex data\n"), false);
+	for (intptr v = 0; v < n; ++v)
+	{
+		const int32*	sv = srcdata + v * srcsize;
+		int32*			dv = dstdata + v * dstsize;
+
+		memset(dv, 0, dstsize * sizeof(int32));
+		for (int i = 0; i < dstlayout->NumSlots; ++i)
+		{
+			const LayoutSlot&	dslot = dstlayout->Slot[i];
+
+			if (map[i] < 0)
+				continue;
+			const LayoutSlot&	sslot = srclayout->Slot[map[i]];
+
+			memset(tmp, 0, 4 * sizeof(float));
+			if ((i == 0) && (sslot.Count < 4))
+				tmp[3] = 1.0f;			// W of a location
+			DecodeSlot(sslot, sv, tmp, src->m_QuantScale, src->m_QuantOffset);
+			EncodeSlot(dslot, tmp, dv, m_QuantScale, m_QuantOffset);
+		}
+	}
+	SetChanged(true);
+	return true;
+}
+
+/*!
+ * @fn bool VertexPool::MakeCompactLayout(Core::String& desc, const DataLayout* layout, int opts)
+ * @param desc		where to store the descriptor for the compact layout
+ * @param layout	float vertex layout to compact
+ * @param opts		which components to compact:
+ * @code
+ *	VertexPool::COMPACT_LOCATIONS	16 bit locations scaled to the vertex bounds
+ *	VertexPool::COMPACT_NORMALS		octahedral normals and tangents in one word
+ *	VertexPool::COMPACT_TEXCOORDS	half float texture coordinates
+ *	VertexPool::COMPACT_PACKED		10:10:10:2 normals instead of octahedral
+ *	VertexPool::COMPACT_SNORM		16 bit signed normalized normals and tangents in two words
+ *	VertexPool::COMPACT_HARDWARE	formats the vertex fetch expands (half texture coordinates, 16 bit normals)
+ * @endcode
+ *
+ * Makes a vertex layout descriptor with the same components, in the same
+ * order, as the input layout with the selected components in compact formats.
+ * Colors and other integer components are not changed.
+ *
+ * The formats in VertexPool::COMPACT_HARDWARE are converted to floats by
+ * the GPU, so they work with any shader. Quantized locations, octahedral
+ * and 10:10:10:2 normals must be decoded by the vertex shader, using the
+ * \b QuantScale and \b QuantOffset uniforms for locations. Use them only
+ * with shaders which do. For a typical vertex with a location, normal and
+ * texture coordinates, COMPACT_HARDWARE reduces the size from 32 bytes
+ * to 24 bytes and COMPACT_ALL to 16 bytes.
+ *
+ * @return \b true if any components were compacted, \b false if the layout
+ *			has nothing which can be compacted
+ *
+ * @see VertexPool::Convert DataLayout::SetDescriptor
+ */
+bool VertexPool::MakeCompactLayout(Core::String& desc, const DataLayout* layout, int opts)
+{
+	bool	changed = false;
+
+	desc.Empty();
+	if (layout == NULL)
+		return false;
+	for (int i = 0; i < layout->NumSlots; ++i)
+	{
+		const LayoutSlot&	slot = layout->Slot[i];
+		bool				isfloat = (slot.Format == DataLayout::FULL) && !(slot.Style & DataLayout::INTEGER);
+
+		if (!desc.IsEmpty())
+			desc += TEXT(", ");
+		if (isfloat && (i == 0) && (opts & COMPACT_LOCATIONS))
+		{
+			desc += TEXT("short3 ");
+			changed = true;
+		}
+		else if (isfloat && (slot.Style & (NORMALS | TANGENTS)) && (slot.Count == 3) && (opts & COMPACT_SNORM))
+		{
+			desc += TEXT("snorm ");
+			changed = true;
+		}
+		else if (isfloat && (slot.Style & (NORMALS | TANGENTS)) && (slot.Count >= 3) && (opts & COMPACT_NORMALS))
+		{
+			desc += (opts & COMPACT_PACKED) ? TEXT("packed ") : TEXT("oct ");
+			changed = true;
+		}
+		else if (isfloat && (slot.Style & TEXCOORDS) && (opts & COMPACT_TEXCOORDS))
+		{
+			desc += TEXT("half") + Core::String(slot.Count) + TEXT(" ");
+			changed = true;
+		}
+		else
+		{
+			Core::String	tmp;
+			DataLayout		single;
+
+			single.NumSlots = 1;
+			single.Slot[0] = slot;
+			single.MakeDescriptor(tmp);
+			desc += tmp + TEXT(" ");
+			continue;
+		}
+		desc += slot.Name;
+	}
+	return changed;
+}
+
+/*!
+ * @fn void VertexPool::DecodeSlot(const LayoutSlot& slot, const int32* vtx, float* out, const Vec3& scale, const Vec3& offset)
+ * @param slot		layout slot of component to decode
+ * @param vtx		-> start of vertex
+ * @param out		where to store LayoutSlot::Count floats
+ * @param scale		quantization scale, used only for quantized components
+ * @param offset	quantization offset, used only for quantized components
+ *
+ * Decodes a single vertex component from any format.
+ * Components in the 32 bit format are copied without conversion,
+ * so integer components keep their bit patterns.
+ * VertexPool::DecodeIter is faster for locations and normals.
+ *
+ * @see VertexPool::EncodeSlot VertexPool::DecodeIter
+ */
+void VertexPool::DecodeSlot(const LayoutSlot& slot, const int32* vtx, float* out, const Vec3& scale, const Vec3& offset)
+{
+	const uint32*	p = (const uint32*) (vtx + slot.Offset);
+
+	switch (slot.Format)
+	{
+		case DataLayout::HALF:
+		for (int j = 0; j < slot.Count; ++j)
+			out[j] = DecodeHalf((j & 1) ? (p[j >> 1] >> 16) : (p[j >> 1] & 0xFFFF));
+		break;
+
+		case DataLayout::QUANTIZED:
+		for (int j = 0; j < slot.Count; ++j)
+		{
+			float q = float((j & 1) ? (p[j >> 1] >> 16) : (p[j >> 1] & 0xFFFF));
+
+			out[j] = (j < 3) ? ((&offset.x)[j] + q * (&scale.x)[j]) : (q / 65535.0f);
+		}
+		break;
+
+		case DataLayout::OCTAHEDRAL:
+		DecodeOctahedral(*p, *((Vec3*) out));
+		break;
+
+		case DataLayout::PACKED10:
+		DecodePacked10(*p, *((Vec3*) out));
+		break;
+
+		case DataLayout::SNORM16:
+		for (int j = 0; j < 3; ++j)
+		{
+			float s = float(int16((j & 1) ? (p[j >> 1] >> 16) : (p[j >> 1] & 0xFFFF))) * (1.0f / 32767.0f);
+
+			out[j] = (s < -1.0f) ? -1.0f : s;
+		}
+		break;
+
+		default:
+		memcpy(out, p, slot.Size * sizeof(float));
+	}
+}
+
+/*!
+ * @fn void VertexPool::EncodeSlot(const LayoutSlot& slot, const float* in, int32* vtx, const Vec3& scale, const Vec3& offset)
+ * @param slot		layout slot of component to encode
+ * @param in		LayoutSlot::Count floats to encode
+ * @param vtx		-> start of vertex to store component in
+ * @param scale		quantization scale, used only for quantized components
+ * @param offset	quantization offset, used only for quantized components
+ *
+ * Encodes a single vertex component into the format of the slot.
+ * Quantized values outside the range given by the scale and offset are clamped.
+ *
+ * @see VertexPool::DecodeSlot VertexPool::SetQuantize
+ */
+void VertexPool::EncodeSlot(const LayoutSlot& slot, const float* in, int32* vtx, const Vec3& scale, const Vec3& offset)
+{
+	uint32*	p = (uint32*) (vtx + slot.Offset);
+
+	switch (slot.Format)
+	{
+		case DataLayout::HALF:
+		memset(p, 0, slot.Size * sizeof(int32));
+		for (int j = 0; j < slot.Count; ++j)
+			p[j >> 1] |= EncodeHalf(in[j]) << ((j & 1) * 16);
+		break;
+
+		case DataLayout::QUANTIZED:
+		memset(p, 0, slot.Size * sizeof(int32));
+		for (int j = 0; j < slot.Count; ++j)
+		{
+			float	s = (j < 3) ? (&scale.x)[j] : (1.0f / 65535.0f);
+			float	q = (j < 3) ? (in[j] - (&offset.x)[j]) : in[j];
+			uint32	u;
+
+			q = (s > 0.0f) ? (q / s + 0.5f) : 0.0f;
+			u = (q <= 0.0f) ? 0 : ((q >= 65535.0f) ? 65535 : uint32(q));
+			p[j >> 1] |= u << ((j & 1) * 16);
+		}
+		break;
+
+		case DataLayout::OCTAHEDRAL:
+		*p = EncodeOctahedral(*((const Vec3*) in));
+		break;
+
+		case DataLayout::PACKED10:
+		*p = EncodePacked10(*((const Vec3*) in));
+		break;
+
+		case DataLayout::SNORM16:
+		memset(p, 0, slot.Size * sizeof(int32));
+		for (int j = 0; j < 3; ++j)
+		{
+			float	s = in[j] * 32767.0f;
+			int32	i = int32((s < 0.0f) ? (s - 0.5f) : (s + 0.5f));
+
+			i = (i < -32767) ? -32767 : ((i > 32767) ? 32767 : i);
+			p[j >> 1] |= (uint32(i) & 0xFFFF) << ((j & 1) * 16);
+		}
+		break;
+
+		default:
+		memcpy(p, in, slot.Size * sizeof(float));
+	}
+}
+
+/*!
+ * @fn uint32 VertexPool::EncodeHalf(float f)
+ * @param f	value to convert
+ *
+ * Converts a single precision float to IEEE half precision with rounding.
+ * Values too large for a half float become infinity, values too small
+ * become zero or denormals.
+ *
+ * @return 16 bit half float in the low bits
+ *
+ * @see VertexPool::DecodeHalf
+ */
+uint32 VertexPool::EncodeHalf(float f)
+{
+	union { uint32 i; float f; } u;
+	uint32	sign, mant;
+	int		exp;
+
+	u.f = f;
+	sign = (u.i >> 16) & 0x8000;
+	mant = u.i & 0x7FFFFF;
+	exp = int((u.i >> 23) & 0xFF) - 127 + 15;
+	if ((u.i & 0x7FFFFFFF) > 0x7F800000)	// NaN
+		return sign | 0x7E00;
+	if (exp >= 31)							// too big or infinity
+		return sign | 0x7C00;
+	if (exp <= 0)							// denormal or zero
+	{
+		uint32	shift;
+
+		if (exp < -10)
+			return sign;
+		mant |= 0x800000;
+		shift = uint32(14 - exp);
+		return sign | ((mant + (1 << (shift - 1))) >> shift);
+	}
+	return (sign | (exp << 10) | (mant >> 13)) + ((mant >> 12) & 1);	// round, may carry into exponent
+}
+
+/*!
+ * @fn uint32 VertexPool::EncodeOctahedral(const Vec3& n)
+ * @param n	unit vector to encode
+ *
+ * Projects the vector onto an octahedron, unfolds the lower half
+ * over the upper half and stores the resulting 2D coordinates
+ * as 16 bit signed normalized values. The error is less than
+ * 0.01 degrees, better than three floats quantized to 10 bits.
+ *
+ * @return X in the low 16 bits, Y in the high 16 bits
+ *
+ * @see VertexPool::DecodeOctahedral
+ */
+uint32 VertexPool::EncodeOctahedral(const Vec3& n)
+{
+	float	len = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+	float	x, y;
+	int32	ix, iy;
+
+	if (len <= 0.0f)
+		return 0;
+	x = n.x / len;
+	y = n.y / len;
+	if (n.z < 0.0f)							// fold lower hemisphere over
+	{
+		float	t = x;
+
+		x = (1.0f - fabsf(y)) * ((t >= 0.0f) ? 1.0f : -1.0f);
+		y = (1.0f - fabsf(t)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+	}
+	ix = int32(floorf(x * 32767.0f + 0.5f));
+	iy = int32(floorf(y * 32767.0f + 0.5f));
+	return (uint32(ix) & 0xFFFF) | (uint32(iy) << 16);
+}
+
+/*!
+ * @fn uint32 VertexPool::EncodePacked10(const Vec3& n)
+ * @param n	vector to encode, components between -1 and 1
+ *
+ * Each component is mapped from [-1, 1] to a 10 bit unsigned value.
+ * This matches the GL_UNSIGNED_INT_2_10_10_10_REV and
+ * DXGI_FORMAT_R10G10B10A2_UNORM vertex formats, the shader
+ * maps the normal back to [-1, 1] with N * 2 - 1.
+ *
+ * @return X in the low 10 bits, then Y and Z, top two bits zero
+ *
+ * @see VertexPool::DecodePacked10
+ */
+uint32 VertexPool::EncodePacked10(const Vec3& n)
+{
+	const float*	v = &n.x;
+	uint32			w = 0;
+
+	for (int j = 0; j < 3; ++j)
+	{
+		float	f = (v[j] * 0.5f + 0.5f) * 1023.0f + 0.5f;
+		uint32	u = (f <= 0.0f) ? 0 : ((f >= 1023.0f) ? 1023 : uint32(f));
+
+		w |= u << (j * 10);
+	}
+	return w;
+}
+
 /****
  *
  * class VtxArray override for SharedObj::Copy
@@ -505,6 +961,8 @@ bool VertexPool::Copy(const SharedObj* src_obj)
 	m_NumTexCoords = src->m_NumTexCoords;
 	SetNumVtx(src->GetNumVtx());
 	m_Layout = src->m_Layout;
+	m_QuantScale = src->m_QuantScale;
+	m_QuantOffset = src->m_QuantOffset;
 	return true;
 }
 
@@ -516,6 +974,7 @@ bool VertexPool::Copy(const SharedObj* src_obj)
  *	VTX_AddVertices	<int32 n> <float [ ]>
  *	VTX_SetStyle	<int32>
  *	VTX_SetAt		<int32 i> <float [ ]>
+ *	VTX_SetQuantize	<Vec3 scale> <Vec3 offset>
  *
  ****/
 bool VertexPool::Do(Messenger& s, int op)
@@ -524,6 +983,7 @@ bool VertexPool::Do(Messenger& s, int op)
 	SharedObj*		obj;
 	int32			n, vs;
 	float*			vtx;
+	Vec3			scale, offset;
 	Core::String	layout;
 	TCHAR			layout_desc[1024];
 	Opcode			o = Opcode(op);
@@ -560,7 +1020,7 @@ bool VertexPool::Do(Messenger& s, int op)
 			s >> vs;
 		vtx = (float*) Core::ThreadAllocator::Get()->Alloc(vs * n * sizeof(float));
 		s.Input(vtx, n * vs);
-		if (s.FileVecSize != s.SysVecSize)
+		if ((s.FileVecSize != s.SysVecSize) && !m_Layout->IsCompact())
 		{
 			float* padded = PadVertices(vtx, n, vs);
 			if (padded)
@@ -578,6 +1038,11 @@ bool VertexPool::Do(Messenger& s, int op)
 		SetLayout(layout_desc);
 		break;
 
+		case VTX_SetQuantize:
+		s >> scale >> offset;
+		SetQuantize(scale, offset);
+		break;
+
 		default:
 		return SharedObj::Do(s, op);
 	}
@@ -610,6 +1075,8 @@ int VertexPool::Save(Messenger& s, int opts) const
 		return h;
 	VX_ASSERT(vs > 0);
 	s << OP(VX_VtxArray, VTX_SetLayout) << h << m_Layout->Descriptor;
+	if (m_Layout->IsCompact())
+		s << OP(VX_VtxArray, VTX_SetQuantize) << h << m_QuantScale << m_QuantOffset;
 	s << OP(VX_VtxArray, VTX_SetMaxVtx) << h << int32(n);
 	
 	while (n > 0)
@@ -676,7 +1143,15 @@ DebugOut& VertexPool::Print(DebugOut& dbg, int opts) const
 				const LayoutSlot& slot = layout->Slot[i];
 				bool	isint = (slot.Style & DataLayout::INTEGER) != 0;
 
-				if (isint)
+				if (slot.Format != DataLayout::FULL)
+				{
+					float	v[MAX_VTX_SIZE];
+
+					DecodeSlot(slot, iptr, v, m_QuantScale, m_QuantOffset);
+					for (int j = 0; j < slot.Count; ++j)
+						dbg << " " << v[j];
+				}
+				else if (isint)
 				{
 					for (int j = slot.Offset; j < slot.Offset + slot.Size; ++j)
 						dbg << " " << iptr[j];
@@ -84,9 +84,12 @@ void DualScene::DoFrame()
 	scene = this;
 	if (Scene::GetChanged() & SCENE_RootChanged)// if hierarchy changed
 		Scene::GetRenderer()->Empty();		// detach lights used by previous hierarchy
-	DoDisplay();
-	GetMessenger()->t_NoLog = false;		// enable logging again
-	Scene::DoSimulation();					// run simulation
+	{
+		Core::EpochReader	reader;			// no model locking in epoch mode
+		DoDisplay();
+		GetMessenger()->t_NoLog = false;	// enable logging again
+		Scene::DoSimulation();				// run simulation
+	}
 //
 //	Synchronize and swap frames
 //
@@ -94,6 +97,7 @@ void DualScene::DoFrame()
 	if (Scene::IsExit())
 		return;
 	GetMessenger()->Flush();				// distribute scene graph updates
+	Core::Epoch::Collect();					// free objects released during traversal
 	Scene::m_Changed = 0;
 	Scene::m_Stats.StartTime = save_start;
 	++(threadg->Frame);
@@ -290,17 +294,21 @@ void StereoScene::DoFrame()
 // do display traversal for this scene and all the child scenes
 // which use its display context (procedural texture generation scenes)
 //
-	DoDisplay();
-	if (GetChild())						// force viewport change if multiple scenes
-		Notify(SCENE_CameraChanged);	// render this scene last
-	DoRender();
-	GetCamera()->SetViewVol(m_MonoViewVol);
+	{
+		Core::EpochReader	reader;		// no model locking in epoch mode
+		DoDisplay();
+		if (GetChild())					// force viewport change if multiple scenes
+			Notify(SCENE_CameraChanged);// render this scene last
+		DoRender();
+		GetCamera()->SetViewVol(m_MonoViewVol);
 //
 // done rendering, enable logging and do simulation
 //
-	GetMessenger()->t_NoLog = false;	// enable logging again
-	DoSimulation();						// run simulation (hierarchy locked here)
+		GetMessenger()->t_NoLog = false;// enable logging again
+		DoSimulation();					// run simulation, engines are not locked while reading
+	}
 	GetMessenger()->Flush();			// distribute scene graph updates
+	Core::Epoch::Collect();				// free objects released during traversal
 	m_Stats.StartTime = save_start;
 	++(g->Frame);
 	m_Stats.EndTime = World3D::Get()->GetTime();
@@ -14,14 +14,7 @@ static const TCHAR* opnames[] =
 
 const TCHAR** Light::DoNames = opnames;
 
-/*
- * Maps light ID to bit mask, assumes 16 lights
- */
-static	uint32	id2mask[16] = {
-	0x80000000,	0x40000000,	0x20000000,	0x10000000,
-	0x08000000,	0x04000000,	0x02000000,	0x01000000,
-	0x00800000,	0x00400000,	0x00200000,	0x00100000,
-	0x00080000,	0x00040000,	0x00020000,	0x00010000 };
+#define	LIGHT_MinTable	16		// initial size of light table
 
 VX_IMPLEMENT_CLASSID(Light, Model, VX_Light);
 VX_IMPLEMENT_CLASSID(DirectLight, Light, VX_DirectLight);
@@ -448,15 +441,14 @@ GPULight* LightList::Iter::NextProp(bool &enabled)
 	if (list == NULL)
 		return NULL;
 	ObjectLock	lock(list);
-	while (m_CurLight <= list->m_NumLights)
+	while (m_CurLight < list->m_MaxLights)
 	{
 		GPULight* prop = list->m_Lights[m_CurLight++];
 		if (prop == NULL)
 			continue;
-		if (!(list->m_LightsActive & prop->Mask))
+		if (!(prop->State & LIGHT_Active))
 			continue;
-		uint32 tmp = list->m_LightsOn;
-		enabled = (tmp & prop->Mask) != 0;
+		enabled = (prop->State & LIGHT_Enabled) != 0;
 		return prop;
 	}
 	return NULL;
@@ -498,37 +490,86 @@ void Light::Display(Scene* scene)
 LightList::LightList()
 {
 	DoDistanceCull = false;
-	for (int i = 0; i < LIGHT_MaxLights; ++i)
-		m_Lights[i] = NULL;
-	m_LightsActive = 0;
+	DoClusterLights = false;
+	m_Lights = NULL;
+	m_LightPos = NULL;
+	m_LightIDs = NULL;
+	m_MaxLights = 0;
+	m_NumActive = 0;
 	m_NumLights = 0;
-	m_LightsChanged = 0;
-	m_LightsOn = 0;
+	m_NumChanged = 0;
+	m_NumOn = 0;
 	m_ListChanged = true;
-	m_LightsOff = uint32(-1);
 }
 
 LightList::LightList(const LightList& src)
 {
+	DoDistanceCull = false;
+	DoClusterLights = false;
+	m_Lights = NULL;
+	m_LightPos = NULL;
+	m_LightIDs = NULL;
+	m_MaxLights = 0;
+	m_NumLights = 0;
+	m_NumOn = 0;
 	*this = src;
 }
 
 LightList::~LightList()
 {
 	DetachAll();
+	if (m_Lights)
+		free(m_Lights);
+	if (m_LightPos)
+		free(m_LightPos);
+	if (m_LightIDs)
+		free(m_LightIDs);
+}
+
+/*
+ * Enlarge the light table to hold at least \b size lights.
+ * The new entries are empty.
+ */
+bool LightList::Grow(int32 size)
+{
+	int32		n = m_MaxLights ? m_MaxLights : LIGHT_MinTable;
+	GPULight**	lights;
+	Vec4*		pos;
+	int32*		ids;
+
+	if (size <= m_MaxLights)
+		return true;
+	while (n < size)
+		n *= 2;
+	if ((lights = (GPULight**) realloc(m_Lights, n * sizeof(GPULight*))) == NULL)
+		VX_ERROR(("LightList::Grow ERROR out of memory for %d lights\n", n), false);
+	m_Lights = lights;
+	if ((pos = (Vec4*) realloc(m_LightPos, n * sizeof(Vec4))) == NULL)
+		VX_ERROR(("LightList::Grow ERROR out of memory for %d lights\n", n), false);
+	m_LightPos = pos;
+	if ((ids = (int32*) realloc(m_LightIDs, n * sizeof(int32))) == NULL)
+		VX_ERROR(("LightList::Grow ERROR out of memory for %d lights\n", n), false);
+	m_LightIDs = ids;
+	memset(m_Lights + m_MaxLights, 0, (n - m_MaxLights) * sizeof(GPULight*));
+	m_MaxLights = n;
+	return true;
 }
 
 LightList& LightList::operator=(const LightList& src)
 {
 	m_ListChanged = src.m_ListChanged;
-	for (int i = 0; i < LIGHT_MaxLights; ++i)
+	if (!Grow(src.m_MaxLights))
+		return *this;
+	for (int i = 0; i < m_MaxLights; ++i)
 	{
-		GPULight* dstprop = m_Lights[i];
-		GPULight* srcprop = src.m_Lights[i];
+		GPULight*	dstprop = m_Lights[i];
+		GPULight*	srcprop = (i < src.m_MaxLights) ? src.m_Lights[i] : NULL;
+		uint32		enabled = 0;
 
 		if (srcprop == NULL)
 		{
-			Detach(dstprop);
+			if (dstprop)
+				Detach(dstprop);
 			continue;
 		}
 		if (dstprop == NULL)
@@ -538,69 +579,149 @@ LightList& LightList::operator=(const LightList& src)
 			m_ListChanged = true;
 		}		
 		else
+		{
+			enabled = dstprop->State & LIGHT_Enabled;	// keep our own device state
 			*dstprop = *srcprop;
+		}
+		dstprop->State = (dstprop->State & (LIGHT_Active | LIGHT_Changed)) | enabled;
 	}
-	m_LightsActive = src.m_LightsActive;
-	m_LightsChanged = src.m_LightsChanged;
+	m_NumActive = src.m_NumActive;
+	m_NumChanged = src.m_NumChanged;
 	m_NumLights = src.m_NumLights;
-//	m_LightsOn = src.m_LightsOn;
-	m_LightsOff = src.m_LightsOff;
 	return *this;
 }
 
 /*!
- * @fn uint32 LightList::NearLights(const Model* mod, const Matrix* mtx, uint32 mask)
- * @param mod	model to illuminate
- * @param mtx	world matrix for model
- * @param mask	mask of lights to consider (0 indicates all lights)
+ * @fn GPULight* LightList::GetLight(int id) const
+ * @param id	light ID (GPULight::ID)
  *
- * Determines which lights are near the given model.
- * Proximity is determined by the light radius. Lights
- * with a radius of zero will illuminate all models in
- * the scene. Keeps track of the number of vertices
- * lit by each light.
+ * @return light with the given ID, NULL if there is none
+ */
+GPULight* LightList::GetLight(int id) const
+{
+	if ((id < 0) || (id >= m_MaxLights))
+		return NULL;
+	return m_Lights[id];
+}
+
+/*!
+ * @fn int LightList::GetLightsOn(const uint16** ids) const
+ * @param ids	gets the address of the IDs of the enabled lights
  *
- * @return bit mask of lights that are near the model
+ * Used by renderers which bind the lights for each draw to find
+ * the lights selected by the last call to LightList::LightsOn.
+ *
+ * @return number of light IDs, -1 if all the active lights are enabled
  *
  * @see LightList::LightsOn
  */
-uint32 LightList::NearLights(const Model* mod, const Matrix* mv,uint32 mask)
+int LightList::GetLightsOn(const uint16** ids) const
+{
+	*ids = m_LightsOn;
+	return m_NumOn;
+}
+
+/*!
+ * @fn int LightList::NearLights(const Model* mod, const Matrix* mtx, uint16* ids, int maxids)
+ * @param mod		model to illuminate
+ * @param mtx		world matrix for model, NULL if the model is in world coordinates
+ * @param ids		array to get the indices of the nearby lights
+ * @param maxids	maximum number of indices to return
+ *
+ * Finds the active lights whose illumination radius
+ * overlaps the bounding sphere of the model. The indices returned
+ * are positions in the light list (GPULight::ID). If the lights
+ * have been assigned to view volume cells the cost is proportional
+ * to the number of lights near the model, otherwise every active
+ * light is examined. If distance culling is off (LightList::DoDistanceCull)
+ * the first \b maxids active lights are returned.
+ *
+ * @return number of light indices returned
+ *
+ * @see LightList::BuildClusters LightCluster::GetLights
+ */
+int LightList::NearLights(const Model* mod, const Matrix* mtx, uint16* ids, int maxids)
 {
-	Sphere	mbs;
-	int32	bits;
-	int32	n = 0;
 	Sphere	bsp;
-	Vec3	ctr(mv->Get(0, 3), mv->Get(1, 3), mv->Get(2, 3));
-
-	if (!DoDistanceCull)
-		return m_LightsActive;
-	if (mask == 0)
-		mask = LIGHT_All;
- 	mask &= m_LightsActive;
-	bits = mask;
-	mod->GetBound(&bsp, Model::NONE);
-	while (bits)				// lights left to look at?
+	int		n = 0;
+
+	if (IsClustered() || DoDistanceCull)
 	{
-		if (bits < 0)			// hi bit set? look at light
+		mod->GetBound(&bsp, Model::NONE);
+		if (mtx)
+			bsp *= *mtx;
+	}
+	if (IsClustered())
+	{
+		int m = m_Cluster.GetLights(bsp, ids, maxids);
+
+		for (int i = 0; i < m; ++i)			// remove inactive lights
 		{
-			GPULight* prop = m_Lights[n];
+			GPULight* prop = GetLight(ids[i]);
 
-			if ((prop != NULL) && (prop->LightModel != NULL))
-			{
-				Light* light = (Light*) prop->LightModel;
-				if ((light->GetRadius() > 0) &&
-					!light->IsClass(VX_DirectLight))
-				{
-					float d = ctr.Distance(light->GetCenter());
-					if (d > light->GetRadius() + bsp.Radius)
-						mask &= ~prop->Mask;		// ignore far away light
-				}
-			}
+			if (prop && (prop->State & LIGHT_Active))
+				ids[n++] = ids[i];
 		}
-		++n;
-		bits <<= 1;
+		return n;
+	}
+	for (int i = 0; (i < m_MaxLights) && (n < maxids); ++i)
+	{
+		GPULight*		prop = m_Lights[i];
+		const Light*	light;
+
+		if ((prop == NULL) || ((prop->State & LIGHT_Active) == 0) ||
+			((light = prop->LightModel) == NULL))
+			continue;
+		if (DoDistanceCull && (light->GetRadius() > 0) && !light->IsClass(VX_DirectLight))
+		{
+			float d = bsp.Center.Distance((const Vec3&) light->m_WorldPos);
+			if (d > light->GetRadius() + bsp.Radius)
+				continue;					// ignore far away light
+		}
+		ids[n++] = (uint16) i;
+	}
+	return n;
+}
+
+/*!
+ * @fn bool LightList::BuildClusters(const Camera* cam)
+ * @param cam	camera for the scene
+ *
+ * Assigns the active lights to cells of the camera view volume so
+ * that LightList::NearLights only has to look at the lights near each model.
+ * Lights without an illumination radius and directional lights are
+ * returned for every model. This is called from the display traversal
+ * thread by Renderer::Reset after the lights have been transformed
+ * if LightList::DoClusterLights is set.
+ *
+ * @return \b true if the lights were assigned to cells, else \b false
+ *
+ * @see LightCluster LightList::UpdateAll
+ */
+bool LightList::BuildClusters(const Camera* cam)
+{
+	int		n = 0;
+
+	if (!DoClusterLights || (cam == NULL))
+	{
+		m_Cluster.Empty();
+		return false;
 	}
-	return mask;
+	for (int i = 0; i < m_MaxLights; ++i)
+	{
+		GPULight*		prop = m_Lights[i];
+		const Light*	light;
+
+		if ((prop == NULL) || ((prop->State & LIGHT_Active) == 0) ||
+			((light = prop->LightModel) == NULL))
+			continue;
+		m_LightPos[n] = light->m_WorldPos;
+		m_LightPos[n].w = light->GetRadius();
+		if (light->IsClass(VX_DirectLight))
+			m_LightPos[n].w = 0.0f;
+		m_LightIDs[n++] = i;
+	}
+	return m_Cluster.Build(cam, m_LightPos, m_LightIDs, n);
 }
 
 /*!
@@ -610,7 +731,8 @@ uint32 LightList::NearLights(const Model* mod, const Matrix* mv,uint32 mask)
  * thread to attach a light to the scene if it is not already
  * in the light table. This creates a light property and attaches
  * it to the light model. The property remains attached until
- * GPULight::Detach is called.
+ * GPULight::Detach is called. The light table is enlarged
+ * if there are no free entries.
  *
  * @see GPULight
  */
@@ -619,23 +741,22 @@ int LightList::Attach(const Light* light, GPULight* prop)
 	ObjectLock	lock(this);
 	int			i;
 
-	for (i = 0; i < LIGHT_MaxLights; ++i)
-	{
-		if (m_Lights[i])
-			continue;
-		prop->Type = light->ClassID();
-		prop->ID = i;
-		prop->Mask = id2mask[i];
-		prop->LightModel = light;
-		m_ListChanged = true;
-		m_Lights[i] = prop;
-		m_LightsChanged |= prop->Mask;
-		light->DevHandle = prop;
-		++m_NumLights;
-		VX_TRACE(Light::Debug, ("LightList::Attach #%d %s\n", i, light->GetName()));
-		return i;
-	}
-	VX_ERROR(("Light::Attach cannot attach light %d\n", i), NULL);
+	for (i = 0; i < m_MaxLights; ++i)
+		if (m_Lights[i] == NULL)
+			break;
+	if ((i >= 0xFFFF) || !Grow(i + 1))			// IDs must fit in 16 bits
+		VX_ERROR(("Light::Attach cannot attach light %d\n", i), -1);
+	prop->Type = light->ClassID();
+	prop->ID = i;
+	prop->State = LIGHT_Changed;
+	prop->LightModel = light;
+	m_ListChanged = true;
+	m_Lights[i] = prop;
+	++m_NumChanged;
+	light->DevHandle = prop;
+	++m_NumLights;
+	VX_TRACE(Light::Debug, ("LightList::Attach #%d %s\n", i, light->GetName()));
+	return i;
 }
 
 /*!
@@ -652,7 +773,7 @@ void LightList::DetachAll()
 	if (m_NumLights <= 0)
 		return;
 	ObjectLock	lock(this);
-	for (int i = 0; i < LIGHT_MaxLights; ++i)
+	for (int i = 0; i < m_MaxLights; ++i)
 	{
 		GPULight* prop = m_Lights[i];
 
@@ -663,48 +784,89 @@ void LightList::DetachAll()
 			VX_TRACE(Light::Debug, ("LightList::DetachAll deleting light %d\n", i));
 		}
 	}
-	m_LightsActive = 0;
+	m_NumActive = 0;
 	m_NumLights = 0;
+	m_NumOn = 0;
 	m_ListChanged = true;
 }
 
-void LightList::LightsOff(uint32 mask)
+/*
+ * Enable or disable a light in the device if its state changes.
+ */
+void LightList::Enable(GPULight* prop)
 {
-	m_LightsOff = mask;
+	if (prop->State & LIGHT_Enabled)
+		return;
+	prop->State |= LIGHT_Enabled;
+	if (prop->DevIndex != LIGHT_NoDevice)
+		prop->Enable();
+}
+
+void LightList::Disable(GPULight* prop)
+{
+	if ((prop->State & LIGHT_Enabled) == 0)
+		return;
+	prop->State &= ~LIGHT_Enabled;
+	if (prop->DevIndex != LIGHT_NoDevice)
+		prop->Disable();
 }
 
 /*!
- * @fn uint32 LightList::LightsOn(uint32 mask)
- * Enables the lights specified by the input mask to be
- * used for rendering the next shape. This routine is only
- * called from rendering thread.
+ * @fn void LightList::LightsOn(const uint16* ids, int n)
+ * @param ids	IDs of the lights which illuminate the next primitive,
+ *				NULL to enable all the active lights
+ * @param n		number of light IDs (at most LIGHT_MaxLights are used)
+ *
+ * Enables the given lights to be used for rendering the next shape
+ * and disables the lights enabled for the previous one. Only the lights
+ * whose state changes are updated in the device, so the cost depends
+ * on the number of lights per primitive, not the size of the light table.
+ * This routine is only called from rendering thread.
  *
- * @see LightList::NearLights
+ * @see LightList::NearLights LightList::GetLightsOn
  */
-uint32 LightList::LightsOn(uint32 mask)
+void LightList::LightsOn(const uint16* ids, int n)
 {
 	ObjectLock	lock(this);
-	int32		bits ;
-	int			i = -1;
+	GPULight*	prop;
 
-	mask &= m_LightsOff;					// force these lights always off
-	bits = mask ^ m_LightsOn;				// mask of lights to change
-	m_LightsOn = mask;
-	while (bits && (++i < m_NumLights))		// lights that changed
+	if (ids == NULL)						// all active lights on
 	{
-		if (bits < 0)						// hi bit set? update light
+		for (int i = 0; i < m_MaxLights; ++i)
+			if (prop = m_Lights[i])
+			{
+				if (prop->State & LIGHT_Active)
+					Enable(prop);
+				else
+					Disable(prop);
+			}
+		m_NumOn = -1;
+		return;
+	}
+	if (n > LIGHT_MaxLights)
+		n = LIGHT_MaxLights;
+	for (int i = 0; i < n; ++i)				// mark the new lights
+		if (prop = GetLight(ids[i]))
+			prop->State |= LIGHT_Near;
+	if (m_NumOn < 0)						// turn off the previous lights
+	{
+		for (int i = 0; i < m_MaxLights; ++i)
+			if ((prop = m_Lights[i]) && !(prop->State & LIGHT_Near))
+				Disable(prop);
+	}
+	else
+		for (int i = 0; i < m_NumOn; ++i)
+			if ((prop = GetLight(m_LightsOn[i])) && !(prop->State & LIGHT_Near))
+				Disable(prop);
+	for (int i = 0; i < n; ++i)				// turn on the new ones
+		if (prop = GetLight(ids[i]))
 		{
-			GPULight*	prop = m_Lights[i];
-			if ((prop == NULL) || (prop->DevIndex == LIGHT_NoDevice))
-				continue;
-			if (mask & 0x80000000)
-				prop->Enable();
-			else prop->Disable();
+			prop->State &= ~LIGHT_Near;
+			Enable(prop);
 		}
-		bits <<= 1;
-		mask <<= 1;
-	}
-	return m_LightsOn;		// remember active ones
+	if (n > 0)
+		memcpy(m_LightsOn, ids, n * sizeof(uint16));
+	m_NumOn = n;
 }
 
 /*!
@@ -719,38 +881,42 @@ uint32 LightList::LightsOn(uint32 mask)
 void LightList::UpdateAll()
 {
 	ObjectLock	lock(this);
-	uint32		lightson = m_LightsOff & m_LightsActive;
 	Matrix		mtx;
 
-	m_LightsChanged = 0;
-	for (int i = 0; i < LIGHT_MaxLights; ++i)
+	m_NumChanged = 0;
+	m_NumActive = 0;
+	for (int i = 0; i < m_MaxLights; ++i)
 	{
 		GPULight*	prop = m_Lights[i];
 		Light*		l;
 		Vec3		v;
-		int32		mask;
 		int			changed;
 
 		if (prop == NULL)
 			continue;
 		l = (Light*) prop->LightModel;
-		if ((l == NULL) && (prop->DevIndex != LIGHT_NoDevice))
+		if (l == NULL)
 		{
-			Detach(prop);
+			if (prop->DevIndex != LIGHT_NoDevice)
+				Detach(prop);
 			continue;
 		}
-		mask = prop->Mask;
+		prop->State &= ~LIGHT_Changed;
 		if (l->IsActive())
 		{
-			if ((m_LightsActive & mask) == 0)
-				m_LightsChanged |= mask;
-			m_LightsActive |= mask;
+			if ((prop->State & LIGHT_Active) == 0)
+				prop->State |= LIGHT_Changed;
+			prop->State |= LIGHT_Active;
+			++m_NumActive;
 		}
 		else
 		{
-			if (m_LightsActive & mask)
-				m_LightsChanged |= mask;
-			m_LightsActive &= ~mask;
+			if (prop->State & LIGHT_Active)
+			{
+				prop->State |= LIGHT_Changed;
+				++m_NumChanged;
+			}
+			prop->State &= ~LIGHT_Active;
 			continue;
 		}
 		changed = l->HasChanged();
@@ -766,9 +932,11 @@ void LightList::UpdateAll()
 		if (changed)
 		{
 			prop->Update(&mtx);
-			m_LightsChanged |= mask;
+			prop->State |= LIGHT_Changed;
 			l->SetChanged(false);
 		}
+		if (prop->State & LIGHT_Changed)
+			++m_NumChanged;
 	}
 }
 
@@ -788,32 +956,28 @@ void LightList::LoadAll()
 {
 	ObjectLock	lock(this);
 
-	for (int i = 0; i < LIGHT_MaxLights; ++i)
+	for (int i = 0; i < m_MaxLights; ++i)
 	{
 		GPULight* lprop = m_Lights[i];
 
 		if (lprop && (lprop->DevIndex != LIGHT_NoDevice))
 		{
-			int32 mask = lprop->Mask;
-
 			if (lprop->LightModel == NULL)		// light has been deleted?
 			{
 				lprop->Disable();
 				Detach(lprop);
 			}
-			else if (m_LightsActive & mask)		// light is active
+			else if (lprop->State & LIGHT_Active)	// light is active
 			{
-				if (m_LightsChanged & mask)
-					lprop->Load((m_LightsChanged & mask) != 0);
-				lprop->Enable();
-			}
-			else if (m_LightsOn & mask)			// not active but currently enabled
-			{
-				m_LightsOn = m_LightsOn & ~mask;// disable the light
-				lprop->Disable();
+				if (lprop->State & LIGHT_Changed)
+					lprop->Load(true);
+				Enable(lprop);
 			}
+			else								// not active, disable if enabled
+				Disable(lprop);
 		}
 	}
+	m_NumOn = -1;
 }
 
 GPULight::GPULight(Renderer& render, const Light& light)
@@ -823,7 +987,7 @@ GPULight::GPULight(Renderer& render, const Light& light)
 {
 	DevIndex = LIGHT_NoDevice;
 	ID = -1;
-	Mask = 0;
+	State = 0;
 	LightModel = NULL;
 	LocalDir.Set(0, 0, -1);
 	if (m_Data == NULL)
@@ -843,8 +1007,10 @@ GPULight& GPULight::operator=(const GPULight& src)
 	LocalDir = src.LocalDir;
 	ID = src.ID;
 	Type = src.Type;
-	Mask = src.Mask;
+	State = src.State;
 	DevIndex = src.DevIndex;
+	WorldPosSlot = src.WorldPosSlot;
+	WorldDirSlot = src.WorldDirSlot;
 	return *this;
 }
 
@@ -854,16 +1020,21 @@ void GPULight::Update(const Matrix* mtx)
 	DeviceBuffer*	lbuf = l->GetDataBuffer();
 	size_t			nbytes = lbuf->GetByteSize();
 
-	lbuf->Set(TEXT("WorldPos"), l->m_WorldPos);
-	lbuf->Set(TEXT("WorldDir"), l->m_WorldDir);
+	if (WorldPosSlot.Layout != lbuf->GetLayout())
+	{
+		WorldPosSlot = lbuf->GetHandle(TEXT("WorldPos"));
+		WorldDirSlot = lbuf->GetHandle(TEXT("WorldDir"));
+	}
+	lbuf->Set(WorldPosSlot, l->m_WorldPos);
+	lbuf->Set(WorldDirSlot, l->m_WorldDir);
 	VX_ASSERT(GetByteSize() >= nbytes);
 	memcpy(GetData(), lbuf->GetData(), nbytes);
+	MarkDirty(0, nbytes);
 }
 
 void LightList::Detach(GPULight* prop)
 {
 	ObjectLock	lock(this);
-	int			mask = prop->Mask;
 	Light*		light = (Light*) prop->LightModel;
 
 	VX_ASSERT(prop->ID >= 0);
@@ -880,8 +1051,9 @@ void LightList::Detach(GPULight* prop)
 		prop->Disable();
 		prop->Detach();
 	}
-	m_LightsActive &= ~mask;
-	m_LightsOn &= ~mask;
+	if (prop->State & LIGHT_Active)
+		--m_NumActive;
+	prop->State = 0;
 	--m_NumLights;
 }
 
@@ -0,0 +1,387 @@
+#include "vixen.h"
+
+namespace Vixen {
+
+int LightCluster::TilesX = 16;
+int LightCluster::TilesY = 8;
+int LightCluster::Slices = 24;
+
+LightCluster::LightCluster()
+{
+	m_Ortho = false;
+	m_Left = m_Bottom = 0.0f;
+	m_ScaleX = m_ScaleY = 0.0f;
+	m_Hither = 1.0f;
+	m_LogScale = 0.0f;
+	m_NumCells = 0;
+	m_NumLights = 0;
+	m_NumRefs = 0;
+	m_NumGlobal = 0;
+	m_CellStart = NULL;
+	m_CellLights = NULL;
+	m_Global = NULL;
+	m_IDs = NULL;
+	m_Ranges = NULL;
+	m_ViewPos = NULL;
+	m_MaxCells = 0;
+	m_MaxRefs = 0;
+	m_MaxLights = 0;
+}
+
+LightCluster::~LightCluster()
+{
+	if (m_CellStart)
+		free(m_CellStart);
+	if (m_CellLights)
+		free(m_CellLights);
+	if (m_Global)
+		free(m_Global);
+	if (m_IDs)
+		free(m_IDs);
+	if (m_Ranges)
+		free(m_Ranges);
+	if (m_ViewPos)
+		free(m_ViewPos);
+}
+
+void LightCluster::Empty()
+{
+	m_NumCells = 0;
+	m_NumLights = 0;
+	m_NumRefs = 0;
+	m_NumGlobal = 0;
+}
+
+/*
+ * Make sure the per-light and per-cell arrays are big enough.
+ * The arrays are kept between frames and only grow.
+ */
+bool LightCluster::Alloc(int nlights)
+{
+	int32	ncells = TilesX * TilesY * Slices;
+
+	if (ncells + 1 > m_MaxCells)
+	{
+		free(m_CellStart);
+		m_MaxCells = ncells + 1;
+		m_CellStart = (int32*) malloc(m_MaxCells * sizeof(int32));
+	}
+	if (nlights > m_MaxLights)
+	{
+		free(m_Global);
+		free(m_IDs);
+		free(m_Ranges);
+		free(m_ViewPos);
+		m_MaxLights = (nlights + 63) & ~63;
+		m_Global = (uint16*) malloc(m_MaxLights * sizeof(uint16));
+		m_IDs = (int32*) malloc(m_MaxLights * sizeof(int32));
+		m_Ranges = (CellRange*) malloc(m_MaxLights * sizeof(CellRange));
+		m_ViewPos = (float*) malloc(4 * m_MaxLights * sizeof(float));
+	}
+	if ((m_CellStart == NULL) || (m_Global == NULL) || (m_IDs == NULL) ||
+		(m_Ranges == NULL) || (m_ViewPos == NULL))
+	{
+		m_MaxCells = m_MaxLights = 0;
+		VX_ERROR(("LightCluster::Alloc ERROR out of memory for %d lights\n", nlights), false);
+	}
+	return true;
+}
+
+/*!
+ * @fn bool LightCluster::Build(const Camera* cam, const Vec4* lights, const int32* ids, int nlights)
+ * @param cam		camera whose view volume is divided into cells
+ * @param lights	world space center (X, Y, Z) and illumination radius (W) of each light
+ * @param ids		identifier for each light returned by LightCluster::GetLights
+ * @param nlights	number of lights
+ *
+ * Assigns each light to the cells its bounding sphere overlaps.
+ * Lights with a radius of zero or less illuminate everything
+ * and are returned for every query. This is called once per frame
+ * after the camera and lights have been updated.
+ *
+ * The light centers are transformed into view space in separate passes
+ * over X, Y, Z and radius arrays so the compiler can vectorize them.
+ * The cell lists are built with a counting sort: one pass counts
+ * the lights in each cell, a prefix sum gives the start of each cell
+ * and a second pass fills in the light indices.
+ *
+ * @return \b true if successful, \b false if there is no camera or not enough memory
+ *
+ * @see LightCluster::GetLights LightList::BuildClusters
+ */
+bool LightCluster::Build(const Camera* cam, const Vec4* lights, const int32* ids, int nlights)
+{
+	Empty();
+	if ((cam == NULL) || (nlights < 0) || (TilesX <= 0) || (TilesY <= 0) || (Slices <= 0))
+		return false;
+	if (nlights > 0xFFFF)
+		VX_ERROR(("LightCluster::Build ERROR too many lights %d\n", nlights), false);
+	if (!Alloc(nlights))
+		return false;
+/*
+ * Compute the mapping from view space to cells.
+ * For a perspective camera tiles are uniform in X / depth and Y / depth.
+ * For an orthographic camera they are uniform in X and Y.
+ */
+	const Box3&	vv = cam->GetViewVol();
+	float		hither = vv.min.z;
+	float		yon = vv.max.z;
+
+	m_ViewTrans.Copy(*(cam->GetViewTrans()));
+	m_Ortho = (cam->GetType() == Camera::ORTHOGRAPHIC);
+	if (hither < VX_EPSILON)
+		hither = VX_EPSILON;
+	if (yon <= hither)
+		yon = hither + 1.0f;
+	m_Hither = hither;
+	m_LogScale = Slices / logf(yon / hither);
+	if (m_Ortho)
+	{
+		m_Left = vv.min.x;
+		m_Bottom = vv.min.y;
+		m_ScaleX = TilesX / (vv.max.x - vv.min.x);
+		m_ScaleY = TilesY / (vv.max.y - vv.min.y);
+	}
+	else
+	{
+		m_Left = vv.min.x / hither;
+		m_Bottom = vv.min.y / hither;
+		m_ScaleX = TilesX * hither / (vv.max.x - vv.min.x);
+		m_ScaleY = TilesY * hither / (vv.max.y - vv.min.y);
+	}
+	m_NumCells = TilesX * TilesY * Slices;
+	m_NumLights = nlights;
+/*
+ * Transform the light centers into view space
+ */
+	const float*	m = m_ViewTrans.GetMatrix();
+	float*			px = m_ViewPos;
+	float*			py = px + m_MaxLights;
+	float*			pz = py + m_MaxLights;
+	float*			pr = pz + m_MaxLights;
+
+	for (int i = 0; i < nlights; ++i)
+		px[i] = m[0] * lights[i].x + m[1] * lights[i].y + m[2] * lights[i].z + m[3];
+	for (int i = 0; i < nlights; ++i)
+		py[i] = m[4] * lights[i].x + m[5] * lights[i].y + m[6] * lights[i].z + m[7];
+	for (int i = 0; i < nlights; ++i)
+		pz[i] = m[8] * lights[i].x + m[9] * lights[i].y + m[10] * lights[i].z + m[11];
+	for (int i = 0; i < nlights; ++i)
+		pr[i] = lights[i].w;
+	memcpy(m_IDs, ids, nlights * sizeof(int32));
+/*
+ * Count the lights in each cell
+ */
+	int32*	count = m_CellStart;
+
+	memset(count, 0, (m_NumCells + 1) * sizeof(int32));
+	for (int i = 0; i < nlights; ++i)
+	{
+		CellRange& r = m_Ranges[i];
+
+		if (pr[i] <= 0.0f)					// illuminates everything?
+		{
+			m_Global[m_NumGlobal++] = (uint16) i;
+			r.Z0 = 0; r.Z1 = -1;			// empty range
+			continue;
+		}
+		GetCellRange(px[i], py[i], pz[i], pr[i], r);
+		for (int z = r.Z0; z <= r.Z1; ++z)
+			for (int y = r.Y0; y <= r.Y1; ++y)
+			{
+				int32* c = count + (z * TilesY + y) * TilesX;
+
+				for (int x = r.X0; x <= r.X1; ++x)
+					++c[x];
+			}
+	}
+/*
+ * Convert counts into starting indices and make room for the light lists.
+ * After filling, each entry is the end of its cell so the
+ * starting indices are restored by shifting the array.
+ */
+	int32	total = 0;
+
+	for (int c = 0; c < m_NumCells; ++c)
+	{
+		int32 n = count[c];
+
+		count[c] = total;
+		total += n;
+	}
+	count[m_NumCells] = total;
+	m_NumRefs = total;
+	if (total > m_MaxRefs)
+	{
+		free(m_CellLights);
+		m_MaxRefs = total + (total >> 2);
+		m_CellLights = (uint16*) malloc(m_MaxRefs * sizeof(uint16));
+		if (m_CellLights == NULL)
+		{
+			m_MaxRefs = 0;
+			Empty();
+			VX_ERROR(("LightCluster::Build ERROR out of memory for %d light references\n", total), false);
+		}
+	}
+	for (int i = 0; i < nlights; ++i)
+	{
+		const CellRange& r = m_Ranges[i];
+
+		for (int z = r.Z0; z <= r.Z1; ++z)
+			for (int y = r.Y0; y <= r.Y1; ++y)
+			{
+				int32* c = count + (z * TilesY + y) * TilesX;
+
+				for (int x = r.X0; x <= r.X1; ++x)
+					m_CellLights[c[x]++] = (uint16) i;
+			}
+	}
+	for (int c = m_NumCells - 1; c > 0; --c)
+		count[c] = count[c - 1];
+	count[0] = 0;
+	return true;
+}
+
+/*
+ * Return the slice containing the given distance from the camera.
+ * Depths in front of the hither plane map to the first slice
+ * and depths beyond the yon plane to the last.
+ */
+int LightCluster::GetSlice(float depth) const
+{
+	float	s;
+
+	if (depth <= m_Hither)
+		return 0;
+	s = logf(depth / m_Hither) * m_LogScale;
+	if (s >= Slices)
+		return Slices - 1;
+	return (int) s;
+}
+
+static inline int32 ClampTile(float f, int32 ntiles)
+{
+	if (f <= 0.0f)
+		return 0;
+	if (f >= ntiles)
+		return ntiles - 1;
+	return (int32) f;
+}
+
+/*!
+ * @fn void LightCluster::GetCellRange(float cx, float cy, float cz, float r, CellRange& range) const
+ * @param cx, cy, cz	view space center of sphere
+ * @param r				radius of sphere
+ * @param range			range of cells overlapped by the sphere
+ *
+ * Computes the range of cells which contain the box around the sphere.
+ * The camera looks down the negative Z axis so depth is -Z.
+ * For a perspective camera the extreme X / depth and Y / depth values
+ * occur at the corners of the box. Depths are clamped at the hither plane
+ * so parts of the sphere behind the camera map to the border cells.
+ */
+void LightCluster::GetCellRange(float cx, float cy, float cz, float r, CellRange& range) const
+{
+	float	d0 = -cz - r;
+	float	d1 = -cz + r;
+	float	x0 = cx - r;
+	float	x1 = cx + r;
+	float	y0 = cy - r;
+	float	y1 = cy + r;
+
+	range.Z0 = GetSlice(d0);
+	range.Z1 = GetSlice(d1);
+	if (!m_Ortho)
+	{
+		float	s, t;
+
+		if (d0 < m_Hither)
+			d0 = m_Hither;
+		if (d1 < m_Hither)
+			d1 = m_Hither;
+		s = x0 / d0; t = x0 / d1; x0 = (s < t) ? s : t;
+		s = x1 / d0; t = x1 / d1; x1 = (s > t) ? s : t;
+		s = y0 / d0; t = y0 / d1; y0 = (s < t) ? s : t;
+		s = y1 / d0; t = y1 / d1; y1 = (s > t) ? s : t;
+	}
+	range.X0 = ClampTile((x0 - m_Left) * m_ScaleX, TilesX);
+	range.X1 = ClampTile((x1 - m_Left) * m_ScaleX, TilesX);
+	range.Y0 = ClampTile((y0 - m_Bottom) * m_ScaleY, TilesY);
+	range.Y1 = ClampTile((y1 - m_Bottom) * m_ScaleY, TilesY);
+}
+
+/*!
+ * @fn int LightCluster::GetLights(const Sphere& bound, uint16* ids, int maxids) const
+ * @param bound		world space bounding sphere of object to illuminate
+ * @param ids		array to get identifiers of lights near the object
+ * @param maxids	maximum number of identifiers to return
+ *
+ * Finds the lights whose spheres of illumination intersect the bounding
+ * sphere. The global lights are returned first, followed by the lights
+ * from the cells the sphere overlaps which pass a sphere to sphere test.
+ * Each light is returned once: a light found in more than one cell is
+ * skipped if it is already in the output list. The query keeps no state
+ * in the cluster so several threads may call it at once after it is built.
+ *
+ * @return number of light identifiers returned
+ *
+ * @see LightCluster::Build LightList::NearLights
+ */
+int LightCluster::GetLights(const Sphere& bound, uint16* ids, int maxids) const
+{
+	const float*	px = m_ViewPos;
+	const float*	py = px + m_MaxLights;
+	const float*	pz = py + m_MaxLights;
+	const float*	pr = pz + m_MaxLights;
+	CellRange		range;
+	Vec3			c;
+	float			r = bound.Radius;
+	int				n = 0;
+	int				first;
+
+	if (m_NumLights == 0)
+		return 0;
+	for (int i = 0; (i < m_NumGlobal) && (n < maxids); ++i)
+		ids[n++] = (uint16) m_IDs[m_Global[i]];
+	if ((m_NumRefs == 0) || (n >= maxids))
+		return n;
+	first = n;								// lights from the cells start here
+	m_ViewTrans.Transform(bound.Center, c);
+	if (r < 0.0f)
+		r = 0.0f;
+	GetCellRange(c.x, c.y, c.z, r, range);
+	for (int z = range.Z0; z <= range.Z1; ++z)
+		for (int y = range.Y0; y <= range.Y1; ++y)
+		{
+			const int32* start = m_CellStart + (z * TilesY + y) * TilesX;
+
+			for (int x = range.X0; x <= range.X1; ++x)
+			{
+				for (int32 j = start[x]; j < start[x + 1]; ++j)
+				{
+					int		i = m_CellLights[j];
+					uint16	id = (uint16) m_IDs[i];
+					float	dx, dy, dz, d;
+					int		k;
+
+					dx = px[i] - c.x;
+					dy = py[i] - c.y;
+					dz = pz[i] - c.z;
+					d = pr[i] + r;
+					if (dx * dx + dy * dy + dz * dz > d * d)
+						continue;			// too far away
+					for (k = first; k < n; ++k)
+						if (ids[k] == id)
+							break;
+					if (k < n)
+						continue;			// already found in another cell
+					ids[n++] = id;
+					if (n >= maxids)
+						return n;
+				}
+			}
+		}
+	return n;
+}
+
+}	// end Vixen
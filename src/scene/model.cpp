@@ -21,11 +21,16 @@
  *
  ****/
 #include "vixen.h"
+#ifndef _WIN32
+#include <sched.h>
+#endif
 
 namespace Vixen {
 
 VX_IMPLEMENT_CLASSID(Model, Group, VX_Model);
 
+#define	MOD_WorldBlockSize	1024		// initial size of UpdateWorld arrays
+
 const Vec3	Model::XAXIS(1.0f, 0.0f, 0.0f);
 const Vec3	Model::YAXIS(0.0f, 1.0f, 0.0f);
 const Vec3	Model::ZAXIS(0.0f, 0.0f, 1.0f);
@@ -48,10 +53,17 @@ Model::Model() : Group()
 	m_Verts = m_Faces = 0;
 	m_BoundVol.Empty();
 	m_BoundBox.Empty();
+	m_ParentVol.Empty();
+	m_ParentBox.Empty();
 	m_NoBounds = m_AutoBounds = true;
+	m_ParentBound = false;
 	m_NoCull = false;
 	m_Rendered = false;
 	m_Hints = 0;
+	m_PrevStep = 0;
+	m_WorldDirty = true;
+	m_WorldBelow = false;
+	m_WorldLock = 0;
 }
 
 Model::Model(const Model& src) : Group(src)
@@ -60,10 +72,17 @@ Model::Model(const Model& src) : Group(src)
 	m_Verts = m_Faces = 0;
 	m_BoundVol.Empty();
 	m_BoundBox.Empty();
+	m_ParentVol.Empty();
+	m_ParentBox.Empty();
 	m_NoBounds = m_AutoBounds = true;
+	m_ParentBound = false;
 	m_NoCull = false;
 	m_Rendered = false;
 	m_Hints = 0;
+	m_PrevStep = 0;
+	m_WorldDirty = true;
+	m_WorldBelow = false;
+	m_WorldLock = 0;
 }
 
 /*!
@@ -106,9 +125,11 @@ Model::Model(const Model& src) : Group(src)
 void Model::Display(Scene* scene)
 {
 	Model*	m;
-	Matrix	save_mtx;
+	Mat4	save_mtx;
 	Matrix*	mv = (Matrix*) scene->GetWorldMatrix();
-	Matrix*	save = NULL;
+	bool	save = false;
+	bool	save_ident;
+	bool	locked;
 
 	if (!IsActive())			// don't display if not active
 		return;
@@ -116,12 +137,14 @@ void Model::Display(Scene* scene)
  * Push current matrix and compute new transformation matrix
  * for this character. The default behavior for CalcMatrix is to
  * concatenate the model's local transformation matrix onto
- * the current ModelView.
+ * the current ModelView. Models are not locked when
+ * traversing in epoch mode.
  */
-	Lock();
-	save_mtx.SetMatrix(mv->GetMatrix());
+	locked = !Core::Epoch::IsReading() && Lock();
+	save_mtx = mv->GetMat4();
+	save_ident = mv->IsIdentity();
 	if (CalcMatrix(mv, scene))
-		save = &save_mtx;
+		save = true;
 /*
  * Check whether the model and its children should be culled.
  * If not, render the model and traverse its children
@@ -130,17 +153,26 @@ void Model::Display(Scene* scene)
 	switch (Cull(mv, scene))
 	{
 		case DISPLAY_NONE:
-		Unlock();
+		if (locked)
+			Unlock();
 		break;
 
 		case DISPLAY_ME:
-		Render(scene);				// render this model
-		Unlock();
+		{
+			VX_PROFILE_DETAIL(ClassName());
+			Render(scene);			// render this model
+		}
+		if (locked)
+			Unlock();
 		break;
 
 		default:
-		Render(scene);				// render this model
-		Unlock();
+		{
+			VX_PROFILE_DETAIL(ClassName());
+			Render(scene);			// render this model
+		}
+		if (locked)
+			Unlock();
 		m = First();				// get first child
 		while (m)
 		{
@@ -150,7 +182,12 @@ void Model::Display(Scene* scene)
 		break;
 	}
 	if (save)
-		mv->Copy(save);
+	{
+		if (save_ident)			// Copy(Mat4) clears the identity flag
+			mv->Identity();
+		else
+			mv->Copy(save_mtx);
+	}
 }
 
 /*!
@@ -255,6 +292,49 @@ void Model::CalcStats(intptr& numverts, intptr& numfaces) const
 }
 
 
+/*
+ * Interpolates between two local matrices. Translation and scale
+ * are interpolated linearly and rotation spherically.
+ * A NULL matrix is the identity.
+ */
+static void LerpTransform(Matrix& dst, const Matrix* m1, const Matrix* m2, float t)
+{
+	Matrix	r1, r2;
+	Vec3	p1(0, 0, 0), p2(0, 0, 0);
+	Vec3	s1(1, 1, 1), s2(1, 1, 1);
+	Quat	q;
+
+	if (m1)
+	{
+		r1.Copy(*m1);
+		m1->GetTranslation(p1);
+		m1->GetScale(s1);
+	}
+	if (m2)
+	{
+		r2.Copy(*m2);
+		m2->GetTranslation(p2);
+		m2->GetScale(s2);
+	}
+	for (int j = 0; j < 3; ++j)				// remove scale from rotations
+		for (int i = 0; i < 3; ++i)
+		{
+			if (s1[j] > VX_EPSILON)
+				r1.Set(i, j, r1.Get(i, j) / s1[j]);
+			if (s2[j] > VX_EPSILON)
+				r2.Set(i, j, r2.Get(i, j) / s2[j]);
+		}
+	q.Slerp(Quat(r1), Quat(r2), t);
+	q.Normalize();
+	dst.Set(q);
+	s1 += (s2 - s1) * t;
+	p1 += (p2 - p1) * t;
+	for (int j = 0; j < 3; ++j)
+		for (int i = 0; i < 3; ++i)
+			dst.Set(i, j, dst.Get(i, j) * s1[j]);
+	dst.SetTranslation(p1);
+}
+
 /*!
  * @fn bool Model::CalcMatrix(Matrix* mtx, Scene* scene) const
  * @param mtx	On input, this has total matrix for parent.
@@ -280,12 +360,55 @@ void Model::CalcStats(intptr& numverts, intptr& numfaces) const
  */
 bool Model::CalcMatrix(Matrix* trans, Scene* scene) const
 {
+	if (scene && m_PrevStep &&				// moved in last simulation step?
+		(m_PrevStep == scene->GetLastSimStep()) &&
+		(scene->GetSimAlpha() < 1.0f))
+	{
+		Matrix	tmp;
+
+		LerpTransform(tmp, (const Matrix*) m_PrevTransform, (const Matrix*) m_Transform, scene->GetSimAlpha());
+		trans->PostMul(tmp);
+		return true;
+	}
 	if (m_Transform.IsNull())
 		return false;
 	trans->PostMul(*((const Matrix*) m_Transform));
 	return true;
 }
 
+/*!
+ * @fn void Model::SaveTransform()
+ *
+ * Called before the local matrix changes to remember the matrix
+ * from before the current fixed simulation step. Only the first change
+ * in each step is saved so CalcMatrix can interpolate between the
+ * previous and current step during display. Changes made outside
+ * a simulation step are not interpolated. The step is the one being
+ * run by the scene simulating on the calling thread so scenes
+ * simulating on different threads do not interfere.
+ *
+ * @see Scene::SetSimStep Model::CalcMatrix
+ */
+void Model::SaveTransform()
+{
+	int32	step = Scene::GetTLS()->SimStep;
+
+	if (step == 0)						// not simulating?
+	{
+		m_PrevStep = 0;
+		return;
+	}
+	if (m_PrevStep == step)				// already saved this step
+		return;
+	m_PrevStep = step;
+	if (m_PrevTransform.IsNull())
+		m_PrevTransform = new Matrix();
+	if (m_Transform.IsNull())
+		m_PrevTransform->Identity();
+	else
+		m_PrevTransform->Copy(*((const Matrix*) m_Transform));
+}
+
 /*!
  * @fn bool Model::CalcBound(Box3* box) const
  * @param box	calculated bounding box upon return
@@ -429,6 +552,7 @@ void Model::SetBound(const Sphere* bsp)
 		m_NoBounds = bsp->IsEmpty();	/* is it empty? */
 		m_AutoBounds = false;			/* suppress automatic calcs */
 	}
+	m_ParentBound = false;				/* parent must transform new bounds */
 	Group* parent = Parent();
 	if (parent)
 		parent->NotifyParents(MOD_BVinvalid); /* notify parents bbox changed */
@@ -473,18 +597,23 @@ void Model::SetBound(const Box3* box)
  * Helper function that does the work to compute the bounding box of a
  * model and its children. Inactive models also report empty bounds.
  *
- * This routine is not used internally unless Model::GetBound is called.
+ * Only the children whose bounds or local matrix changed are visited.
+ * The bounds of the others are merged from the copy each child keeps
+ * in the coordinates of this model, so a single moving model only
+ * causes its ancestors to be refit.
+ *
+ * This routine is not used internally unless Model::GetBound
+ * or Model::UpdateBounds is called.
  *
  * @internal
  * @return  true if non-empty bounds computed, else  false
  *
- * @see Model::CalcBound Model::GetBound
+ * @see Model::CalcBound Model::GetBound Model::UpdateBounds
  */
 bool Model::DoBounds() const
 {
 	bool	rc = false;
 	bool	nobounds = true;
-	Matrix	totalmtx;
 
 /*
  * If the bounding sphere is already valid, just return it to the
@@ -496,6 +625,8 @@ bool Model::DoBounds() const
  * if the bounding volume is valid or it has been set by user,
  * do not recalculate the bounds here.
  * If we are morphing, we always recalculate since the geometry is changing.
+ * This does not examine the vertices, deformers give the mesh the
+ * bounds of their output (see Deformer::UpdateBound).
  */
 	if ((!IsSet(MOD_BVinvalid) || !m_AutoBounds) && !(m_Hints & MORPH))
 		return true;
@@ -513,41 +644,66 @@ bool Model::DoBounds() const
 		rc = true;
 	}
 /*
- * Calculate bounding volumes for all children and add that in too.
+ * Add in the bounding volumes of the children. Children which changed
+ * are recomputed and transformed into our coordinates, the others
+ * use the transformed bounds saved the last time.
  */
-	const Model* mod;
-	Sphere sp;
-	for (mod = First(); mod != NULL; mod = mod->Next())	// for each child
+	for (const Model* mod = First(); mod != NULL; mod = mod->Next())
 	{
 		VX_ASSERT(mod != this);
-		if (mod->DoBounds())				// get bounding volume
-		{
-			Sphere	bsp(mod->m_BoundVol);
-			Box3	bbox(mod->m_BoundBox);
-			const Matrix* trans = mod->GetTransform();
-
-			if (bsp.Radius == 0)			// don't count empty models
-				continue;
-			if (!trans->IsIdentity())		// have a local matrix?
-			{
-				bsp *= *trans;				// apply child's local matrix
-				bbox *= *trans;
-			}
-			boundvol.Extend(bsp);			// extend overall model bounds
-			boundbox.Extend(bbox);
-			rc = true;
-			nobounds = false;
-		}
+		if (mod->IsSet(MOD_BVinvalid) || !mod->m_ParentBound || (mod->m_Hints & MORPH))
+			mod->CalcParentBound(mod->DoBounds());
+		if (mod->m_ParentVol.Radius == 0)	// don't count empty models
+			continue;
+		boundvol.Extend(mod->m_ParentVol);	// extend overall model bounds
+		boundbox.Extend(mod->m_ParentBox);
+		rc = true;
+		nobounds = false;
 	}
-	Lock();
+	bool locked = !Core::Epoch::IsReading() && Lock();
 	ClearFlags(MOD_BVinvalid);		// mark bounds as valid
 	m_NoBounds = nobounds;
 	m_BoundVol = boundvol;			// update model bounding volume
 	m_BoundBox = boundbox;
-	Unlock();
+	m_ParentBound = false;			// parent must transform new bounds
+	if (locked)
+		Unlock();
 	return rc;
 }
 
+/*!
+ * @fn void Model::CalcParentBound(bool valid) const
+ * @param valid	\b true if the bounds of this model are not empty
+ *
+ * Transforms the bounding sphere and box of this model and its
+ * children by the local matrix and saves them for the parent
+ * to merge when it is refit.
+ *
+ * @internal
+ * @see Model::DoBounds
+ */
+void Model::CalcParentBound(bool valid) const
+{
+	const Matrix* trans = GetTransform();
+
+	if (!valid || (m_BoundVol.Radius == 0))
+	{
+		m_ParentVol.Empty();
+		m_ParentBox.Empty();
+	}
+	else
+	{
+		m_ParentVol = m_BoundVol;
+		m_ParentBox = m_BoundBox;
+		if (!trans->IsIdentity())		// have a local matrix?
+		{
+			m_ParentVol *= *trans;		// apply local matrix
+			m_ParentBox *= *trans;
+		}
+	}
+	m_ParentBound = true;
+}
+
 /*!
  *
  * @fn bool Model::GetCenter(Vec3* ctr, int opts) const
@@ -570,10 +726,6 @@ bool Model::DoBounds() const
  */
 bool Model::GetCenter(Vec3* p, int opts) const
 {
-	Sphere	sp;
-	Vec3	tmp;
-	Matrix	mtx;
-
     VX_ASSERT(p);
 	if (!DoBounds())				// empty bounds?
 	{
@@ -584,8 +736,12 @@ bool Model::GetCenter(Vec3* p, int opts) const
 	switch (opts)
 	{
 		case WORLD:					// model & children in world coords (top parent)
-		TotalTransform(&mtx);
-		mtx.Transform(m_BoundVol.Center, *p);
+		{
+			Matrix	world;
+
+			GetWorldTransform(&world);
+			world.Transform(m_BoundVol.Center, *p);
+		}
 		break;
 
 		case LOCAL:					// model & children in local coords
@@ -612,10 +768,10 @@ Vec3 Model::GetCenter(int flags) const
 Vec3 Model::GetDirection() const
 {
 	Vec3		v;
-	Matrix	tmp;
+	Matrix		world;
 
-	TotalTransform(&tmp);
-	tmp.TransformVector(Vec3(0, 0, -1), v);
+	GetWorldTransform(&world);
+	world.TransformVector(Vec3(0, 0, -1), v);
 	return v;
 }
 
@@ -644,9 +800,6 @@ Vec3 Model::GetDirection() const
  */
 bool Model::GetBound(Sphere* sphere, int flags) const
 {
-	Sphere	sp;
-	Matrix	totalmtx;
-
 	VX_ASSERT(sphere);
 	if (!DoBounds())		// calculate bounding volumes
 	{
@@ -657,8 +810,12 @@ bool Model::GetBound(Sphere* sphere, int flags) const
 	switch (flags)
 	{
 		case WORLD:			// model & children in world coords (top parent)
-		TotalTransform(&totalmtx);
-		*sphere *= totalmtx;
+		{
+			Matrix	world;
+
+			GetWorldTransform(&world);
+			*sphere *= world;
+		}
 		break;
 
 		case LOCAL:			// model & children in local coords
@@ -713,10 +870,10 @@ bool Model::GetBound(Box3* bbox, int flags) const
 	}
 	else if (flags == WORLD)				// bounding box in world coordinates
 	{
-		Matrix totalmtx;
+		Matrix	world;
 
-		TotalTransform(&totalmtx);
-		*bbox *= totalmtx;
+		GetWorldTransform(&world);
+		*bbox *= world;
 	}
 	return true;
 }
@@ -779,19 +936,391 @@ void Model::TotalTransform(Matrix* trans, const Model* parent) const
  *
  * The total matrix is the concatenation of all the transformations
  * which apply to this model in the hierarchy it is a part of.
+ * It is copied from the cached world matrix.
  *
- * @see Model::GetCenter Model::GetBound
+ * @see Model::GetCenter Model::GetBound Model::GetWorldTransform
  */
 void Model::TotalTransform(Matrix* trans) const
 {
-	const Model* c = this;
-	if (m_Transform.IsNull())					// no local matrix
-		trans->Identity();
-	else										// copy local matrix
-		trans->Copy((Matrix *) m_Transform);
-	while ((c = (const Model*) c->Parent()) != NULL)
-		if (!c->m_Transform.IsNull())
-			trans->PreMul(*((Matrix*) c->m_Transform));
+	GetWorldTransform(trans);
+}
+
+/*
+ * Spin lock guarding the cached world matrices of a hierarchy
+ */
+static void LockWorld(vint32* lock)
+{
+	while (!Core::InterlockTestSet(lock, 1, 0))
+#ifdef _WIN32
+		::Sleep(0);
+#else
+		sched_yield();
+#endif
+}
+
+static void UnlockWorld(vint32* lock)
+{
+	Core::InterlockSet(lock, 0);
+}
+
+/*
+ * Returns the lock for the cached world matrices of the hierarchy
+ * this model is in. It belongs to the root of the hierarchy so
+ * models in different scenes do not share a lock.
+ */
+vint32* Model::GetWorldLock() const
+{
+	const Model* root = this;
+	const Model* parent;
+
+	while (parent = (const Model*) root->Parent())
+		root = parent;
+	return &(root->m_WorldLock);
+}
+
+/*!
+ * @fn void Model::GetWorldTransform(Matrix* world) const
+ * @param world	where to store the world matrix
+ *
+ * Each model caches the concatenation of its local matrix with
+ * those of its ancestors. Changing the local matrix of a model or
+ * moving it to another parent invalidates the cached matrices of the
+ * model and all its descendants. If the cached matrix is not valid,
+ * it is computed from the parent's cached matrix, so finding the
+ * world matrices of many models in the same hierarchy only concatenates
+ * each matrix once.
+ *
+ * The cached matrices of a hierarchy are guarded by a lock kept in
+ * the root model. The matrix is copied while the lock is held so
+ * another thread moving the model cannot change it during the copy.
+ *
+ * @see Model::UpdateWorld Model::TotalTransform Model::GetBound
+ */
+void Model::GetWorldTransform(Matrix* world) const
+{
+	vint32*	lock = GetWorldLock();
+
+	LockWorld(lock);
+	world->Copy(FindWorld());
+	UnlockWorld(lock);
+}
+
+/*
+ * Returns the cached world matrix, computing it and the invalid
+ * matrices of the ancestors first. The caller holds the world lock.
+ */
+const Matrix* Model::FindWorld() const
+{
+	if (m_WorldDirty)
+	{
+		const Model* parent = (const Model*) Parent();
+
+		CalcWorld(parent ? parent->FindWorld() : NULL);
+	}
+	return &m_WorldTransform;
+}
+
+/*
+ * Computes the cached world matrix from the parent world matrix
+ * (NULL for the root) and the local matrix.
+ */
+void Model::CalcWorld(const Matrix* parentworld) const
+{
+	if (m_Transform.IsNull())
+	{
+		if (parentworld)
+			m_WorldTransform.Copy(parentworld);
+		else
+			m_WorldTransform.Identity();
+	}
+	else if (parentworld && !parentworld->IsIdentity())
+		m_WorldTransform.Multiply(*parentworld, *((const Matrix*) m_Transform));
+	else
+		m_WorldTransform.Copy((const Matrix*) m_Transform);
+	m_WorldDirty = false;
+}
+
+/*!
+ * @fn void Model::InvalidateWorld() const
+ *
+ * Marks the cached world matrix of this model and all its descendants
+ * as invalid and marks its ancestors as having a descendant to update.
+ * Descendants of a model whose matrix is already invalid are not
+ * visited again because they must also be invalid.
+ *
+ * @see Model::GetWorldTransform Model::UpdateWorld
+ */
+void Model::InvalidateWorld() const
+{
+	vint32*	lock = GetWorldLock();
+
+	LockWorld(lock);
+	MarkWorld();
+	UnlockWorld(lock);
+}
+
+/*
+ * Marks the cached world matrices invalid, the caller holds the world lock.
+ */
+void Model::MarkWorld() const
+{
+	const Model* mod;
+
+	if (!m_WorldDirty)
+	{
+		m_WorldDirty = true;
+		for (mod = First(); mod; mod = mod->Next())
+		{
+			m_WorldBelow = true;
+			mod->MarkWorld();
+		}
+	}
+	for (mod = (const Model*) Parent(); mod && !mod->m_WorldBelow; mod = (const Model*) mod->Parent())
+		mod->m_WorldBelow = true;
+}
+
+/*!
+ * @fn int Model::UpdateWorld(const Model* root)
+ * @param root	root of hierarchy to update
+ *
+ * Recomputes the cached world matrices which have become invalid
+ * since the last update. Only the parts of the hierarchy with changed
+ * models are visited. The changed models are first collected in
+ * depth first order into an array of models and an array of parent
+ * indices, then the matrices are computed in one pass over the arrays so
+ * each parent matrix is ready before its children need it.
+ * The scene calls this once per frame after simulation.
+ *
+ * The world lock of the hierarchy is held while the models are
+ * collected and their matrices computed. If the arrays are too small,
+ * the lock is released while they are enlarged and the models are
+ * collected again.
+ *
+ * @return number of world matrices computed
+ *
+ * @see Model::GetWorldTransform Scene::DoSimulation
+ */
+int Model::UpdateWorld(const Model* root)
+{
+	const Model**	mods;			// models visited in depth first order
+	int32*			parents;		// index of parent in mods, -1 if parent is valid, -2 if model is valid
+	const Model**	todo;			// models still to visit
+	int32*			todopar;		// parent index for models still to visit
+	int32			maxmods = MOD_WorldBlockSize;
+	int32			maxtodo = MOD_WorldBlockSize;
+	int32			nmods;
+	int32			ntodo;
+	int32			ncalc = 0;
+	vint32*			lock;
+
+	if ((root == NULL) || (!root->m_WorldDirty && !root->m_WorldBelow))
+		return 0;
+	lock = root->GetWorldLock();
+	mods = (const Model**) malloc(maxmods * sizeof(Model*));
+	parents = (int32*) malloc(maxmods * sizeof(int32));
+	todo = (const Model**) malloc(maxtodo * sizeof(Model*));
+	todopar = (int32*) malloc(maxtodo * sizeof(int32));
+	while (mods && parents && todo && todopar)
+	{
+		bool	full = false;
+
+		nmods = 0;
+		ntodo = 0;
+		todo[ntodo] = root;
+		todopar[ntodo++] = -1;
+		LockWorld(lock);
+/*
+ * Collect the changed models in depth first order.
+ * All the descendants of an invalid model are invalid.
+ */
+		while ((ntodo > 0) && !full)
+		{
+			const Model*	mod = todo[--ntodo];
+			int32			par = todopar[ntodo];
+
+			if (!mod->m_WorldDirty && !mod->m_WorldBelow)
+				continue;
+			if (nmods >= maxmods)
+			{
+				full = true;
+				break;
+			}
+			mods[nmods] = mod;
+			parents[nmods] = mod->m_WorldDirty ? par : -2;
+			par = mod->m_WorldDirty ? nmods : -1;
+			++nmods;
+			for (const Model* child = mod->First(); child; child = child->Next())
+			{
+				if (ntodo >= maxtodo)
+				{
+					full = true;
+					break;
+				}
+				todo[ntodo] = child;
+				todopar[ntodo++] = par;
+			}
+		}
+/*
+ * Compute the world matrices, parents before children
+ */
+		if (!full)
+		{
+			for (int32 i = 0; i < nmods; ++i)
+			{
+				const Model*	mod = mods[i];
+				const Matrix*	parentworld = NULL;
+
+				mod->m_WorldBelow = false;
+				if (parents[i] == -2)			// only descendants changed
+					continue;
+				if (parents[i] >= 0)
+					parentworld = &(mods[parents[i]]->m_WorldTransform);
+				else if (mod->Parent())
+					parentworld = ((const Model*) mod->Parent())->FindWorld();
+				mod->CalcWorld(parentworld);
+				++ncalc;
+			}
+			UnlockWorld(lock);
+			break;
+		}
+/*
+ * Arrays are too small, enlarge them without holding the lock
+ */
+		UnlockWorld(lock);
+		if (nmods >= maxmods)
+		{
+			const Model**	newmods = (const Model**) realloc(mods, 2 * maxmods * sizeof(Model*));
+			int32*			newparents;
+
+			if (newmods == NULL)
+				break;
+			mods = newmods;
+			newparents = (int32*) realloc(parents, 2 * maxmods * sizeof(int32));
+			if (newparents == NULL)
+				break;
+			parents = newparents;
+			maxmods *= 2;
+		}
+		else
+		{
+			const Model**	newtodo = (const Model**) realloc(todo, 2 * maxtodo * sizeof(Model*));
+			int32*			newtodopar;
+
+			if (newtodo == NULL)
+				break;
+			todo = newtodo;
+			newtodopar = (int32*) realloc(todopar, 2 * maxtodo * sizeof(int32));
+			if (newtodopar == NULL)
+				break;
+			todopar = newtodopar;
+			maxtodo *= 2;
+		}
+	}
+	if (mods)
+		free(mods);
+	if (parents)
+		free(parents);
+	if (todo)
+		free(todo);
+	if (todopar)
+		free(todopar);
+	return ncalc;
+}
+
+/*!
+ * @fn int Model::UpdateBounds(const Model* root)
+ * @param root	root of hierarchy to update
+ *
+ * Recomputes the bounding volumes which have become invalid since
+ * the last update. Moving a model or changing its geometry only
+ * invalidates the bounds of the model and its ancestors, so only
+ * those chains are visited. The invalid models are collected in
+ * depth first order and refit in reverse order so each model is
+ * refit after all of its children. Children which did not change
+ * are merged using the bounds they saved in the coordinates of
+ * their parent, they are not transformed again.
+ * The scene calls this once per frame after simulation.
+ *
+ * @return number of models whose bounds were recomputed
+ *
+ * @see Model::GetBound Model::UpdateWorld Scene::DoSimulation
+ */
+int Model::UpdateBounds(const Model* root)
+{
+	const Model**	mods;			// models to refit in depth first order
+	const Model**	todo;			// models still to visit
+	int32			maxmods = MOD_WorldBlockSize;
+	int32			maxtodo = MOD_WorldBlockSize;
+	int32			nmods = 0;
+	int32			ntodo = 0;
+	bool			failed = false;
+
+	if ((root == NULL) || (!root->IsSet(MOD_BVinvalid) && !(root->m_Hints & MORPH)))
+		return 0;
+	mods = (const Model**) malloc(maxmods * sizeof(Model*));
+	todo = (const Model**) malloc(maxtodo * sizeof(Model*));
+	if (mods && todo)
+		todo[ntodo++] = root;
+	else
+		failed = true;
+/*
+ * Collect the invalid models in depth first order.
+ * The ancestors of an invalid model are also invalid so
+ * the children of a valid model are not visited.
+ */
+	while ((ntodo > 0) && !failed)
+	{
+		const Model*	mod = todo[--ntodo];
+
+		if (!mod->IsSet(MOD_BVinvalid) && !(mod->m_Hints & MORPH))
+			continue;
+		if (nmods >= maxmods)
+		{
+			const Model**	newmods = (const Model**) realloc(mods, 2 * maxmods * sizeof(Model*));
+
+			if (newmods == NULL)
+			{
+				failed = true;
+				break;
+			}
+			mods = newmods;
+			maxmods *= 2;
+		}
+		mods[nmods++] = mod;
+		if (!mod->m_AutoBounds)			// bounds set by user?
+			continue;
+		for (const Model* child = mod->First(); child; child = child->Next())
+		{
+			if (ntodo >= maxtodo)
+			{
+				const Model**	newtodo = (const Model**) realloc(todo, 2 * maxtodo * sizeof(Model*));
+
+				if (newtodo == NULL)
+				{
+					failed = true;
+					break;
+				}
+				todo = newtodo;
+				maxtodo *= 2;
+			}
+			todo[ntodo++] = child;
+		}
+	}
+/*
+ * Refit the bounds, children before parents. DoBounds does
+ * not descend because the invalid children are already valid.
+ * If out of memory, the bounds stay invalid and are computed
+ * when they are next asked for.
+ */
+	if (failed)
+		nmods = 0;
+	for (int32 i = nmods - 1; i >= 0; --i)
+		mods[i]->DoBounds();
+	if (mods)
+		free(mods);
+	if (todo)
+		free(todo);
+	return nmods;
 }
 
 void Model::Reset()
@@ -800,9 +1329,11 @@ void Model::Reset()
 		*s << OP(VX_Model, MOD_Reset) << this;
 	VX_STREAM_END( )
 
+	SaveTransform();
 	if (!m_Transform.IsNull())
 		m_Transform->Identity();
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 /*!
@@ -820,6 +1351,7 @@ void Model::Size(const Vec3& v)
 		*s << OP(VX_Model, MOD_Size) << this << v;
 	VX_STREAM_END( )
 
+	SaveTransform();
 	if (m_Transform.IsNull())
 	{
 		m_Transform = new Matrix();
@@ -832,6 +1364,7 @@ void Model::Size(const Vec3& v)
 		m_Transform->PostMul(tmp);
 	}
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 /*!
@@ -863,7 +1396,9 @@ void Model::Scale(const Vec3& v)
 		*s << OP(VX_Model, MOD_Scale) << this << v;
 	VX_STREAM_END( )
 
+	SaveTransform();
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 	if (m_Transform.IsNull())
 	{
 		m_Transform = new Matrix();
@@ -901,6 +1436,7 @@ void Model::Move(const Vec3& v)
 		*s << OP(VX_Model, MOD_Move) << this << v;
 	VX_STREAM_END( )
 
+	SaveTransform();
 	if (m_Transform.IsNull())
 	{
 		m_Transform = new Matrix();
@@ -913,6 +1449,7 @@ void Model::Move(const Vec3& v)
 		m_Transform->PostMul(tmp);
 	}
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 /*!
@@ -944,6 +1481,7 @@ void Model::Translate(const Vec3& v)
 		*s << OP(VX_Model, MOD_Translate) << this << v;
 	VX_STREAM_END( )
 
+	SaveTransform();
 	if (m_Transform.IsNull())
 	{
 		m_Transform = new Matrix();
@@ -951,6 +1489,7 @@ void Model::Translate(const Vec3& v)
 	}
 	else m_Transform->Translate(v);
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 /*!
@@ -988,6 +1527,7 @@ void Model::Turn(const Vec3& axis, float angle)
 
 	if (angle == 0.0)
 		return;
+	SaveTransform();
 
 	if (m_Transform.IsNull())
 	{
@@ -1001,6 +1541,7 @@ void Model::Turn(const Vec3& axis, float angle)
 		m_Transform->PostMul(tmp);
 	}
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 /*!
@@ -1023,6 +1564,7 @@ void Model::Turn(const Quat& q)
 
 	if (q.w == 0.0)
 		return;
+	SaveTransform();
 	if (m_Transform.IsNull())
 		m_Transform = new Matrix(q);
 	else
@@ -1031,6 +1573,7 @@ void Model::Turn(const Quat& q)
 		m_Transform->PostMul(tmp);
 	}
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 /*!
@@ -1055,6 +1598,7 @@ void Model::Rotate(const Vec3& axis, float angle)
 		*s << OP(VX_Model, MOD_Rotate) << this << axis << angle;
 	VX_STREAM_END( )
 
+	SaveTransform();
 	if (m_Transform.IsNull())
 	{
 		m_Transform = new Matrix();
@@ -1062,6 +1606,7 @@ void Model::Rotate(const Vec3& axis, float angle)
 	}
 	else m_Transform->Rotate(axis, angle);
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 /*!
@@ -1084,6 +1629,7 @@ void Model::Rotate(const Quat& q)
 // TODO: put stream logging here
 	if (q.w == 0.0)
 		return;
+	SaveTransform();
 	if (m_Transform.IsNull())
 		m_Transform = new Matrix(q);
 	else
@@ -1092,6 +1638,7 @@ void Model::Rotate(const Quat& q)
 		m_Transform->PreMul(tmp);
 	}
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 /*!
@@ -1113,6 +1660,7 @@ void Model::LookAt(const Vec3& lookat, float twist)
 		*s << OP(VX_Model, MOD_LookAt) << this << lookat << twist;
 	VX_STREAM_END( )
 
+	SaveTransform();
     Vec3	trans, p;
 
 	if (m_Transform.IsNull())
@@ -1123,6 +1671,7 @@ void Model::LookAt(const Vec3& lookat, float twist)
 	m_Transform->LookAt(p, twist);
     m_Transform->Translate(trans);
  	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 /*!
@@ -1141,6 +1690,7 @@ void Model::SetTranslation(const Vec3& p)
 		*s << OP(VX_Model, MOD_SetTranslation) << this << p;
 	VX_STREAM_END( )
 
+	SaveTransform();
 	if (m_Transform.IsNull())
 	{
 		m_Transform = new Matrix();
@@ -1150,6 +1700,7 @@ void Model::SetTranslation(const Vec3& p)
 		m_Transform->SetTranslation(p);
 
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 }
 
 Vec3 Model::GetTranslation() const
@@ -1178,10 +1729,13 @@ void Model::SetRotation(const Quat& q)
 		*s << OP(VX_Model, MOD_SetRotation) << this << q;
 	VX_STREAM_END( )
 
+	SaveTransform();
 	if (m_Transform.IsNull())
 	{
 		m_Transform = new Matrix();
 		m_Transform->Set(q);
+		NotifyParents(MOD_BVinvalid);
+		InvalidateWorld();
 		return;
 	}
 	Vec3 p = GetTranslation();
@@ -1235,7 +1789,9 @@ void Model::SetTransform(const Matrix* trans)
 		}
 	VX_STREAM_END( )
 
+	SaveTransform();
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 	if ((trans == NULL) || trans->IsIdentity())
 	{
 		m_Transform = (Matrix*) NULL;
@@ -1262,7 +1818,9 @@ void Model::SetTransform(const float* mtx)
 		s->Output(mtx, 16);
 	VX_STREAM_END( )
 
+	SaveTransform();
 	NotifyParents(MOD_BVinvalid);
+	InvalidateWorld();
 	if (mtx == NULL)
 	{
 		m_Transform = (Matrix*) NULL;
@@ -1276,11 +1834,13 @@ void Model::SetTransform(const float* mtx)
 void Model::TakeOut(Group* parent)
 {
 	NotifyParents(MOD_BVinvalid | CHANGED);
+	InvalidateWorld();
 }
 
 void Model::PutIn(Group* parent)
 {
 	NotifyParents(MOD_BVinvalid | CHANGED);
+	InvalidateWorld();
 }
 
 /****
@@ -1308,6 +1868,8 @@ bool Model::Copy(const SharedObj* src_obj)
 	else if (m_Transform.IsNull())
 		m_Transform = new Matrix(*((Matrix*) src->m_Transform));
 	else m_Transform->Copy((const Matrix*) src->m_Transform);
+	m_ParentBound = false;
+	InvalidateWorld();
 	m_AutoBounds = src->m_AutoBounds;
 	m_NoCull = src->m_NoCull;
 	m_Hints = src->m_Hints;
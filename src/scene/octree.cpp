@@ -301,8 +301,11 @@ intptr Octree::Cull(const Matrix* trans, Scene* scene)
 	if (GetBound(&box, NONE) && scene->GetCamera()->IsVisible(box))
 	{
 		Geometry* geo = GetGeometry();
-		if ((geo == NULL) || !geo->Cull(trans, scene))
-			return DISPLAY_ALL;				// shape is visible
+		if (geo == NULL)
+			return DISPLAY_ALL;
+		intptr nculled = geo->Cull(trans, scene);
+		if ((nculled == 0) || (!geo->IsSet(GEO_Culled) && (nculled < geo->GetNumVtx())))
+			return DISPLAY_ALL;				// shape or some of its meshlets visible
 	}
 	SceneStats* g = scene->GetStats();
 	Core::InterlockAdd(&(g->CulledVerts), (int) m_Verts);
@@ -268,7 +268,8 @@ void Portal::RemoveMatrix()
  * most recently displayed room. This routine adds the clip
  * planes of the portal polygon to the current camera,
  * causing the objects outside this portal to be culled.
- * It also displays the adjoining room of this portal.
+ * It also displays the adjoining room of this portal unless
+ * the room group has already culled it with its potentially visible set.
  *
  * Note that the roomgroup and room matrices are not applied
  * to portals. Before any portal is displayed, Room::RemoveMatrix
@@ -286,6 +287,9 @@ void Portal::Display(Scene* pScene)
 
 	if (m_bVisited || !IsActive())
 		return;
+	if (m_pAdjoiner && m_pAdjoiner->IsClass(VX_Room) &&
+		!((Room*) m_pAdjoiner)->IsPotentiallyVisible())
+		return;							// adjoiner culled by room group PVS
 	if (!GetTransform()->IsIdentity())	// if portal has a matrix
 		RemoveMatrix();
 #ifdef _DEBUG 		
@@ -194,6 +194,41 @@ Model* Room::DetachFixture()
 	return NULL;
 }
 
+/*!
+ * @fn int Room::GetNumFixtures() const
+ *
+ * The fixtures which are culled separately by the potentially visible set
+ * are the children of the fixture model. If the fixture model has no children,
+ * it is a single fixture.
+ *
+ * @see Room::GetFixture RoomGroup::BuildPVS
+ */
+int Room::GetNumFixtures() const
+{
+	if (m_Fixture.IsNull())
+		return 0;
+	if (m_Fixture->IsParent())
+		return m_Fixture->GetSize();
+	return 1;
+}
+
+/*!
+ * @fn Model* Room::GetFixture(int index) const
+ * @param index	index of fixture, between 0 and GetNumFixtures() - 1
+ *
+ * @return fixture model or NULL if index is out of range
+ *
+ * @see Room::GetNumFixtures
+ */
+Model* Room::GetFixture(int index) const
+{
+	if (m_Fixture.IsNull() || (index < 0))
+		return NULL;
+	if (m_Fixture->IsParent())
+		return (Model*) m_Fixture->GetAt(index);
+	return (index == 0) ? (Model*) m_Fixture : NULL;
+}
+
 void Room::UpdateChildArray()
 {
     // Repack the children so that the outgoing portals occur first, walls
@@ -266,6 +301,54 @@ bool Room::ContainsOrigin()
     return true;
 }
 
+/*!
+ * @fn bool Room::ContainsPoint(const Vec3& p) const
+ * @param p	point in room group coordinates
+ *
+ * Determines if the point is on the same side of all the walls
+ * as the center of the room. Unlike Room::ContainsOrigin, it uses
+ * the model planes of the walls so it does not depend on the camera.
+ * Requires that the room matrices have been removed.
+ *
+ * @see Room::ContainsOrigin RoomGroup::RemoveMatrix
+ */
+bool Room::ContainsPoint(const Vec3& p) const
+{
+	Vec3			roomctr = m_WallBound.Center();
+	ObjArray::Iter	witer(m_Wall);
+	const Wall*		pWall;
+
+	while (pWall = (const Wall*) witer.Next())
+	{
+		const Plane& plane = pWall->GetModelPlane();
+
+		if (plane.Distance(p) * plane.Distance(roomctr) < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+/*!
+ * @fn void Room::SetPVS(bool visible, const int32* row, int32 firstfixture)
+ * @param visible		false to skip this room when it is displayed
+ * @param row			PVS row of the room containing the camera, NULL to display all fixtures
+ * @param firstfixture	index of the bit in \b row for the first fixture of this room,
+ *						-1 to display all fixtures
+ *
+ * Called by the room group before it displays the rooms to tell each room
+ * which of its parts are potentially visible from the room containing the camera.
+ * Fixtures whose bits are clear are disabled while the room is displayed.
+ * Portals do not traverse into rooms which are not potentially visible.
+ *
+ * @see RoomGroup::BuildPVS Room::IsPotentiallyVisible
+ */
+void Room::SetPVS(bool visible, const int32* row, int32 firstfixture)
+{
+	m_PVSVisible = visible;
+	m_PVSRow = row;
+	m_PVSFixture = firstfixture;
+}
+
 void Room::RemoveMatrix()
 {
 	const Matrix*			roommtx = GetTransform();
@@ -296,6 +379,9 @@ void Room::RemoveMatrix()
 
 void Room::Display(Scene* pScene)
 {
+	if (!m_PVSVisible)					// culled by the room group PVS
+		return;
+
     // Once you are in a room to display it, further portal graph traversal
     // will not contain a loop that exits current room then enters it again.
     // This is a consequence of having convex rooms.  Turn off all incoming
@@ -315,8 +401,29 @@ void Room::Display(Scene* pScene)
     // result in traversing to the 'last' visible portal from the camera.
     // The corresponding room adjoining the portal has its walls drawn first,
     // its fixtures drawn last.
+	// Disable the fixtures which the room group PVS says cannot be seen
+	// from the room containing the camera.
+	int		nfixtures = 0;
+	Model*	fixture;
+
+	if (m_PVSRow && (m_PVSFixture >= 0))
+		nfixtures = GetNumFixtures();
+	fixture = GetFixture(0);
+	for (i = 0; i < nfixtures; ++i, fixture = fixture->Next())
+	{
+		int32	bit = m_PVSFixture + i;
+		bool	hide = fixture->IsActive() && ((m_PVSRow[bit >> 5] & (1 << (bit & 31))) == 0);
+
+		m_FixtureActive.SetAt(i, hide);
+		if (hide)
+			fixture->SetFlags(INACTIVE);
+	}
 	VX_TRACE(Portal::Debug, ("Room::Display %s", GetName()));
     Model::Display(pScene);
+	fixture = GetFixture(0);
+	for (i = 0; i < nfixtures; ++i, fixture = fixture->Next())
+		if (m_FixtureActive.GetAt(i))		// restore fixtures hidden by PVS
+			fixture->ClearFlags(INACTIVE);
 
     iter.Reset();
     i = 0;
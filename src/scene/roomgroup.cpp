@@ -4,6 +4,20 @@ namespace Vixen {
 
 VX_IMPLEMENT_CLASSID(RoomGroup, Model, VX_RoomGroup);
 
+#define	PVS_MaxVerts	32		// most vertices in a clipped portal polygon
+#define	PVS_MaxDepth	32		// longest chain of portals followed
+#define	PVS_Inset		0.02f	// how far samples are moved into the room
+
+static inline void PVSSet(int32* row, int32 bit)
+{
+	row[bit >> 5] |= (1 << (bit & 31));
+}
+
+static inline bool PVSGet(const int32* row, int32 bit)
+{
+	return (row[bit >> 5] & (1 << (bit & 31))) != 0;
+}
+
 /****
  *
  * Debug = 0	disables all debug printout for roomgroups
@@ -11,6 +25,11 @@ VX_IMPLEMENT_CLASSID(RoomGroup, Model, VX_RoomGroup);
  *
  ****/
 
+RoomGroup::~RoomGroup()
+{
+	ClearPVS();
+}
+
 /*!
  * @fn void RoomGroup::AttachShell(Model* shell)
  * @param shell model to add as shell
@@ -51,6 +70,7 @@ void RoomGroup::AttachRoom(Room* room)
 {
 	if (m_Rooms.Find(room) >= 0)
 		return;
+	ClearPVS();
 	m_Rooms.Append(room);
 	if (room->Parent() != this)
 		Append(room);
@@ -61,6 +81,7 @@ Room* RoomGroup::DetachRoom(Room* room)
 	int i = m_Rooms.Find(room);
 	if (i < 0)
 		return NULL;
+	ClearPVS();
 	m_Rooms.RemoveAt(i);
 	if (room->Remove(Group::UNLINK_NOFREE))
 		return room;
@@ -176,12 +197,313 @@ void RoomGroup::Display (Scene* scene)
 	CalcMatrix(mtx, scene);
     WhichRoom(mtx, scene);			// determine which room contains the camera
     if (!m_LastRoom.IsNull())		// start the portal system from this interior room
+	{
+		ApplyPVS(m_LastRoom);		// cull rooms and fixtures which cannot be seen
         m_LastRoom->Display(scene);
+		ApplyPVS(NULL);
+	}
     else if (!m_Shell.IsNull())
         m_Shell->Display(scene);	// draw the exterior representation of the room group
 	mtx->Copy(save_mtx);
 }
 
+/*!
+ * @fn bool RoomGroup::BuildPVS(int samples)
+ * @param samples	number of sample viewpoints along each axis of a room
+ *
+ * Computes the potentially visible set of each room, the rooms and fixtures
+ * which can be seen from somewhere inside it. Viewpoints are sampled
+ * on a grid inside the walls of each room and just inside each of its
+ * outgoing portals. From each one the portal graph is traversed,
+ * clipping each portal polygon against the frustum of the portals before it.
+ * A room is potentially visible if any part of a portal into it is
+ * seen from a viewpoint. A fixture is potentially visible if its bounding sphere
+ * is inside the frustum of a room it is in. Rooms joined to a room by
+ * its outgoing portals are always in its set.
+ *
+ * The sets are sampled so they may miss a fixture which is only
+ * visible between viewpoints. More samples make the set more conservative
+ * but take longer to compute. The sets are kept as one row of bits
+ * for each room which has a bit for each room followed by a bit for each fixture.
+ * They are saved with the room group and are discarded when rooms
+ * are attached or detached.
+ *
+ * @return \b true if the sets were computed, \b false if there are no rooms
+ *
+ * @see RoomGroup::Display Room::GetNumFixtures Room::SetPVS
+ */
+bool RoomGroup::BuildPVS(int samples)
+{
+	int32	nrooms = m_Rooms.GetSize();
+	int32	nfixtures = 0;
+	Room*	room;
+
+	ClearPVS();
+	if (nrooms == 0)
+		return false;
+	if (samples < 1)
+		samples = 1;
+	if (HasChanged())
+		RemoveMatrix();
+	for (int32 r = 0; r < nrooms; ++r)
+	{
+		room = (Room*) m_Rooms.GetAt(r);
+		nfixtures += room->GetNumFixtures();
+	}
+	if (!AllocPVS(nrooms, nfixtures))
+		return false;
+	for (int32 r = 0, n = 0; r < nrooms; ++r)
+	{
+		room = (Room*) m_Rooms.GetAt(r);
+		m_PVSBase[r] = nrooms + n;
+		n += room->GetNumFixtures();
+
+		ObjArray::Iter	iter(room->GetOutgoingPortals());
+		Portal*			portal;
+
+		while (portal = (Portal*) iter.Next())
+			portal->RemoveMatrix();			// portal vertices in room group coordinates
+	}
+	m_PVSBase[nrooms] = nrooms + nfixtures;
+	for (int32 r = 0; r < nrooms; ++r)
+	{
+		int32*			row = m_PVSData + r * m_PVSWords;
+		Portal*			portal;
+		Vec3			eye;
+		Box3			box;
+		int				nsamples = 0;
+
+		room = (Room*) m_Rooms.GetAt(r);
+		box = room->GetWallBound();
+		PVSSet(row, r);
+		if (box.IsEmpty())
+			continue;
+
+		Vec3	size(box.Width(), box.Height(), box.Depth());
+		Vec3	ctr = box.Center();
+
+		// sample a grid of points inside the walls
+		for (int i = 0; i < samples; ++i)
+			for (int j = 0; j < samples; ++j)
+				for (int k = 0; k < samples; ++k)
+				{
+					eye.Set(box.min.x + size.x * (i + 0.5f) / samples,
+							box.min.y + size.y * (j + 0.5f) / samples,
+							box.min.z + size.z * (k + 0.5f) / samples);
+					if (!room->ContainsPoint(eye))
+						continue;
+					VisitPVS(room, eye, row, NULL, 0, 0);
+					++nsamples;
+				}
+		// sample just inside each outgoing portal where the view is widest
+		ObjArray::Iter	iter(room->GetOutgoingPortals());
+		while (portal = (Portal*) iter.Next())
+		{
+			Room*	adjoiner = (Room*) portal->GetAdjoiner();
+			Box3	pbox;
+
+			if (adjoiner && adjoiner->IsClass(VX_Room))
+			{
+				intptr a = m_Rooms.Find(adjoiner);
+				if (a >= 0)
+					PVSSet(row, (int32) a);
+			}
+			if (!portal->GetBound(&pbox, NONE))
+				continue;
+			eye = pbox.Center();
+			eye += (ctr - eye) * PVS_Inset;
+			if (!room->ContainsPoint(eye))
+				continue;
+			VisitPVS(room, eye, row, NULL, 0, 0);
+			++nsamples;
+		}
+		if (nsamples == 0)
+			VisitPVS(room, ctr, row, NULL, 0, 0);
+	}
+	VX_TRACE(RoomGroup::Debug, ("RoomGroup::BuildPVS(%s) %d rooms %d fixtures", GetName(), nrooms, nfixtures));
+	return true;
+}
+
+/*
+ * Add the room and the fixtures in it which are inside the frustum to the PVS row.
+ * Then clip each outgoing portal of the room to the frustum.
+ * If part of the portal is left, add the planes through the eye
+ * and its edges and the plane of the portal to make the frustum
+ * for the room on the other side.
+ * The frustum is empty for the room which contains the eye.
+ */
+void RoomGroup::VisitPVS(Room* room, const Vec3& eye, int32* row, const Plane* planes, int nplanes, int depth)
+{
+	int32	r = (int32) m_Rooms.Find(room);
+	int32	nfixtures = room->GetNumFixtures();
+	Model*	fixture = room->GetFixture(0);
+
+	if (r < 0)
+		return;
+	PVSSet(row, r);
+	for (int32 f = 0; f < nfixtures; ++f, fixture = fixture->Next())
+	{
+		Sphere	bound;
+		int		i;
+
+		if (PVSGet(row, m_PVSBase[r] + f))
+			continue;
+		if (!fixture->GetBound(&bound, LOCAL))
+			continue;
+		if (fixture != room->GetFixture())
+			bound *= *(room->GetFixture()->GetTransform());
+		for (i = 0; i < nplanes; ++i)
+			if (planes[i].Distance(bound.Center) < -bound.Radius)
+				break;
+		if (i == nplanes)
+			PVSSet(row, m_PVSBase[r] + f);
+	}
+	if (depth >= PVS_MaxDepth)
+		return;
+
+	ObjArray::Iter	iter(room->GetOutgoingPortals());
+	Portal*			portal;
+
+	while (portal = (Portal*) iter.Next())
+	{
+		Room*		adjoiner = (Room*) portal->GetAdjoiner();
+		VertexArray* verts = portal->GetVertices();
+		Vec3		poly[2][PVS_MaxVerts];
+		Plane		clip[PVS_MaxVerts + 1];
+		Vec3		ctr(0, 0, 0);
+		int			n = 0;
+		int			cur = 0;
+
+		if ((adjoiner == NULL) || !adjoiner->IsClass(VX_Room) || (adjoiner == room) || (verts == NULL))
+			continue;
+
+		VertexPool::ConstIter viter(*verts);
+		while (viter.Next() && (n < PVS_MaxVerts / 2))
+			poly[0][n++] = *viter.GetLoc();
+
+		// clip the portal polygon against the frustum
+		for (int p = 0; (p < nplanes) && (n >= 3); ++p)
+		{
+			const Vec3*	in = poly[cur];
+			Vec3*		out = poly[cur ^ 1];
+			int			m = 0;
+
+			for (int i = 0; i < n; ++i)
+			{
+				const Vec3&	a = in[i];
+				const Vec3&	b = in[(i + 1) % n];
+				float		da = planes[p].Distance(a);
+				float		db = planes[p].Distance(b);
+
+				if (da >= 0.0f)
+					out[m++] = a;
+				if (((da >= 0.0f) != (db >= 0.0f)) && (m < PVS_MaxVerts))
+					out[m++] = a + (b - a) * (da / (da - db));
+				if (m >= PVS_MaxVerts)
+					break;
+			}
+			n = m;
+			cur ^= 1;
+		}
+		if (n < 3)
+			continue;
+
+		// make the frustum through the eye and the clipped portal
+		const Vec3*	v = poly[cur];
+		int			m = 0;
+
+		for (int i = 0; i < n; ++i)
+			ctr += v[i];
+		ctr /= float(n);
+		for (int i = 0; i < n; ++i)
+		{
+			Vec3	normal = (v[i] - eye).Cross(v[(i + 1) % n] - eye);
+
+			if (normal.Length() <= VX_EPSILON)
+				continue;
+			normal.Normalize();
+			clip[m].Set(normal.x, normal.y, normal.z, -normal.Dot(eye));
+			if (clip[m].Distance(ctr) < 0.0f)
+				clip[m] *= -1.0f;
+			++m;
+		}
+		Vec3	normal = (v[1] - v[0]).Cross(v[2] - v[1]);
+
+		if (normal.Length() > VX_EPSILON)
+		{
+			normal.Normalize();
+			clip[m].Set(normal.x, normal.y, normal.z, -normal.Dot(v[0]));
+			if (clip[m].Distance(eye) > 0.0f)	// keep the far side of the portal
+				clip[m] *= -1.0f;
+			++m;
+		}
+		VisitPVS(adjoiner, eye, row, clip, m, depth + 1);
+	}
+}
+
+/*
+ * Allocate one block for the first fixture bit of each room
+ * followed by a row of bits for each room.
+ */
+bool RoomGroup::AllocPVS(int32 nrooms, int32 nfixtures)
+{
+	int32	nwords = (nrooms + nfixtures + 31) / 32;
+	size_t	size = (nrooms + 1 + nrooms * nwords) * sizeof(int32);
+
+	ClearPVS();
+	m_PVSBase = (int32*) malloc(size);
+	if (m_PVSBase == NULL)
+		VX_ERROR(("RoomGroup::AllocPVS ERROR out of memory for %d rooms %d fixtures\n", nrooms, nfixtures), false);
+	memset(m_PVSBase, 0, size);
+	m_PVSData = m_PVSBase + nrooms + 1;
+	m_PVSRooms = nrooms;
+	m_PVSWords = nwords;
+	return true;
+}
+
+void RoomGroup::ClearPVS()
+{
+	ApplyPVS(NULL);
+	if (m_PVSBase)
+		free(m_PVSBase);
+	m_PVSBase = NULL;
+	m_PVSData = NULL;
+	m_PVSRooms = 0;
+	m_PVSWords = 0;
+}
+
+/*
+ * Mark the rooms which are not in the PVS of the camera room
+ * so portals do not traverse into them, and give each room its
+ * fixture bits. Rooms whose fixtures changed after the PVS was built
+ * display all their fixtures. A NULL room restores all the rooms.
+ */
+void RoomGroup::ApplyPVS(const Room* camroom)
+{
+	int32		nrooms = m_Rooms.GetSize();
+	int32		r = -1;
+	const int32* row = NULL;
+
+	if (!HasPVS())
+		return;
+	if (camroom && ((r = (int32) m_Rooms.Find(camroom)) >= 0))
+		row = m_PVSData + r * m_PVSWords;
+	for (int32 j = 0; j < nrooms; ++j)
+	{
+		Room*	room = (Room*) m_Rooms.GetAt(j);
+		int32	first = m_PVSBase[j];
+
+		if (row == NULL)
+		{
+			room->SetPVS(true);
+			continue;
+		}
+		if (m_PVSBase[j + 1] - first != room->GetNumFixtures())
+			first = -1;
+		room->SetPVS(PVSGet(row, j), row, first);
+	}
+}
+
 /****
  *
  * class RoomGroup override for SharedObj::Do
@@ -209,6 +531,18 @@ bool RoomGroup::Do(Messenger& s, int op)
 		AttachRoom(pRoom);
 		break;
 
+		case ROOMGROUP_SetPVS:
+		{
+			int32 nrooms, nfixtures;
+
+			s >> nrooms >> nfixtures;
+			if (!AllocPVS(nrooms, nfixtures))
+				return false;
+			s.Input(m_PVSBase, nrooms + 1);
+			s.Input(m_PVSData, nrooms * m_PVSWords);
+		}
+		break;
+
 		default:
 		return Model::Do(s, op);
 	}
@@ -232,6 +566,14 @@ int RoomGroup::Save(Messenger& s, int opts) const
 	Room* room;
 	while (room = (Room*) iter.Next())
 		s << OP(VX_RoomGroup, ROOMGROUP_AttachRoom) << h << room;
+	if (HasPVS())
+	{
+		int32 nfixtures = m_PVSBase[m_PVSRooms] - m_PVSRooms;
+
+		s << OP(VX_RoomGroup, ROOMGROUP_SetPVS) << h << m_PVSRooms << nfixtures;
+		s.Output(m_PVSBase, m_PVSRooms + 1);
+		s.Output(m_PVSData, m_PVSRooms * m_PVSWords);
+	}
 	return h;
 }
 
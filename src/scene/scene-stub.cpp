@@ -103,7 +103,7 @@ DeviceInfo* Scene::MakeDevInfo(const DeviceInfo* srcinfo)
  * to produce textures used in the main scene. Although the scenes the same
  * light sources, different lights may be enabled and disabled for each scene.
  *
- * @see LightList::LightsOff Scene::SetColorBuffer
+ * @see LightList::LightsOn Scene::SetColorBuffer
  */
 void Scene::Append(Scene* child)
 {
@@ -6,14 +6,19 @@ VX_IMPLEMENT_CLASSID(Scene, SharedObj, VX_Scene);
 
 int						Scene::DeviceDepth = 32;
 int						Scene::NumTexUnits = 1;
+int						Scene::MaxSimSteps = 5;
 bool					Scene::SupportDDS = false;
 const TCHAR*			Scene::RenderOptions = NULL;
 Scene::TLS				Scene::t_State;
+static vint32			s_SimStepID = 0;	// last simulation step identifier used
+
+#define	SCENE_RebaseTime	1024.0		// largest scene time before fixed step time is rebased
 
 void Scene::InitThreadGlobals()
 {
 	TLS* g = GetTLS();
 	g->ThreadType = -1;
+	g->SimStep = 0;
 }
 
 static const TCHAR* opnames[] =
@@ -80,6 +85,13 @@ Scene::Scene(Renderer* renderer) : SharedObj()
 	m_pDevInfo = MakeDevInfo();
 	m_Time = 0.0f;
 	m_TimeInc = 0.0f;
+	m_SimStep = 0.0f;
+	m_SimAlpha = 1.0f;
+	m_SimTime = 0.0;
+	m_TimeBase = 0.0;
+	m_SimAccum = 0.0;
+	m_RealTime = -1.0;
+	m_LastSimStep = 0;
 	m_Changed = -1;
 	m_Camera = new Camera();
 	SetBackColor(Col4(0.2f, 0.5f, 0.8f, 0.0f));
@@ -152,6 +164,7 @@ bool Scene::Copy(const SharedObj* src_obj)
 		SetPostProcess(src->m_PostProcess);
 	SetAmbient(src->m_Ambient);
 	SetTimeInc(src->m_TimeInc);
+	SetSimStep(src->m_SimStep);
 	if (src->m_Viewport.Width() && src->m_Viewport.Height())
 		SetViewport(src->m_Viewport);
 	m_AutoAdjust = src->m_AutoAdjust;
@@ -213,6 +226,7 @@ void Scene::Empty()
 		gs->Empty();
 	m_Models = (const Model*) NULL;
 	m_Engines = (const Engine*) NULL;
+	m_BasedEngines = (const Engine*) NULL;
 }
 
 /*!
@@ -362,14 +376,43 @@ bool Scene::GetBound(Sphere* bound) const
  * should not be called at the user level. It is used internally for
  * sychronizing simulation across multiple processors.
  *
- * @see Scene::SetTimeInc World3D::GetTime Scene::GetTime
+ * If a fixed simulation step is set, the real time elapsed since
+ * the last frame is accumulated for Scene::DoSimulation to consume
+ * in fixed steps. The scene time is the time of the last simulation step.
+ * If the application falls behind by more than Scene::MaxSimSteps
+ * steps, the extra time is discarded and the simulation slows down
+ * instead of trying to catch up.
+ *
+ * @see Scene::SetTimeInc Scene::SetSimStep World3D::GetTime Scene::GetTime
  */
 void Scene::SetTime()
 {
-	if (m_TimeInc == 0.0f)				// animate in real time?
+	if (((m_SimStep <= 0.0f) || (m_TimeInc != 0.0f)) && (m_TimeBase != 0.0))
+		RebaseTime(0.0);				// engines back to scene time
+	if (m_TimeInc != 0.0f)				// frame based animation?
+		m_Time += m_TimeInc;
+	else if (m_SimStep > 0.0f)			// fixed step simulation?
+	{
+		double	now = World3D::Get()->GetRealTime();
+		double	maxaccum = m_SimStep * (MaxSimSteps > 0 ? MaxSimSteps : 1);
+
+		if (m_RealTime < 0.0)			// first frame?
+		{
+			m_SimTime = now - m_SimStep;
+			m_SimAccum = m_SimStep;
+		}
+		else
+			m_SimAccum += now - m_RealTime;
+		m_RealTime = now;
+		if (m_SimAccum > maxaccum)		// too far behind?
+			m_SimAccum = maxaccum;		// drop the extra time
+		m_SimAlpha = float(m_SimAccum / m_SimStep);
+		if (m_SimAlpha > 1.0f)			// steps pending, show latest
+			m_SimAlpha = 1.0f;
+		m_Time = float(m_SimTime);
+	}
+	else								// animate in real time
 		m_Time = World3D::Get()->GetTime();
-	else
-		m_Time += m_TimeInc;			// no, frame based animation
 	VX_TRACE2(Engine::Debug, ("Scene::SetTime(%0.3f)\n", m_Time));
 }
 
@@ -689,9 +732,73 @@ void Scene::SetTimeInc(float timeinc)
 	if (m_TimeInc != 0.0f)			// establish credible starting time
 	{								// for application (NOW)
 		World3D*	w = World3D::Get();
-		w->StartTime = w->GetTime();
+		w->StartTime = Core::GetTime() - m_Time;
 	}
 	m_TimeInc = timeinc;
+	m_RealTime = -1.0;				// restart fixed step simulation
+}
+
+/*!
+ * @fn void Scene::SetSimStep(float step)
+ * @param step	simulation time step in seconds,
+ *				zero (default) evaluates the simulation once per frame
+ *
+ * Decouples the simulation from the frame rate. If the time step is
+ * non-zero and the scene animates in real time, the simulation engines are
+ * evaluated at a fixed rate of 1 / \b step times per second. Several steps
+ * are run in one frame if rendering is slower than the simulation rate
+ * (up to Scene::MaxSimSteps) and none if it is faster.
+ *
+ * Because the simulation and rendering rates differ, models which changed
+ * position in the last simulation step are displayed between their
+ * previous and current transforms, using the fraction of the step that
+ * has elapsed since the last simulation step (Scene::GetSimAlpha).
+ * Rendering lags the simulation by at most one step.
+ *
+ * The simulation time is kept in double precision. The time passed
+ * to the engines is relative to a base which is moved forward in whole
+ * multiples of 1024 seconds so fixed steps stay the same size as a float.
+ * The start times of the scene engines are moved with the base.
+ * Engines added below the scene engines during fixed step simulation
+ * should be given start times relative to the start time of an existing
+ * engine rather than an absolute scene time. Scene::GetTime is not affected.
+ *
+ * @see Scene::SetTimeInc Scene::DoSimulation Model::CalcMatrix Engine::ShiftTime
+ */
+void Scene::SetSimStep(float step)
+{
+	if (step < 0.0f)
+		step = 0.0f;
+	if (m_SimStep == step)
+		return;
+	m_SimStep = step;
+	m_SimAlpha = 1.0f;
+	m_RealTime = -1.0;
+}
+
+/*
+ * Moves the origin of the time passed to the engines to the given
+ * simulation time. The start times of the engines are moved by the
+ * same amount so their elapsed times do not change. If the engines
+ * were replaced since the last call, the old engines are moved back
+ * to scene time and the new ones are moved to the new base.
+ * Only called from the simulation thread.
+ */
+void Scene::RebaseTime(double base)
+{
+	Engine*	eng = m_Engines;
+
+	if (eng != (Engine*) m_BasedEngines)		// engines replaced?
+	{
+		if (!m_BasedEngines.IsNull() && (m_TimeBase != 0.0))
+			m_BasedEngines->ShiftTime(-float(m_TimeBase));
+		if (eng && (base != 0.0))
+			eng->ShiftTime(float(base));
+		m_BasedEngines = eng;
+	}
+	else if (eng && (base != m_TimeBase))
+		eng->ShiftTime(float(base - m_TimeBase));
+	m_TimeBase = base;
 }
 
 /*!
@@ -733,6 +840,8 @@ void Scene::DoFrame()
 //
 // compute start time of frame and process remote updates
 //
+	VX_PROFILE_FRAME();					// collect zones from last frame
+	VX_PROFILE_ZONE(TEXT("Scene::DoFrame"));
 	TLS*		g = GetTLS();
 	Renderer*	r = GetRenderer();
 	float		save_start = OnFrame(g->Frame);
@@ -753,17 +862,22 @@ void Scene::DoFrame()
 //
 // do display traversal for this scene and all the child scenes
 // which use its display context (procedural texture generation scenes)
+// In epoch mode, models are not locked individually during traversal
 //
-	DoDisplay();						// do traversal, culling
-	if (GetChild())						// force viewport change if multiple scenes
-		Notify(SCENE_CameraChanged);
-	DoRender();							// do rendering
+	{
+		Core::EpochReader	reader;
+		DoDisplay();					// do traversal, culling
+		if (GetChild())					// force viewport change if multiple scenes
+			Notify(SCENE_CameraChanged);
+		DoRender();						// do rendering
 //
 // done rendering, enable logging and do simulation
 //
-	GetMessenger()->t_NoLog = false;	// enable logging again
-	DoSimulation();						// run simulation (hierarchy locked here)
+		GetMessenger()->t_NoLog = false;// enable logging again
+		DoSimulation();					// run simulation, engines are not locked while reading
+	}
 	GetMessenger()->Flush();			// distribute scene graph updates
+	Core::Epoch::Collect();				// free objects released during traversal
 	m_Stats.StartTime = save_start;
 	++(g->Frame);
 	m_Stats.EndTime = World3D::Get()->GetTime();
@@ -795,16 +909,50 @@ void Scene::End()
  * and does not permit foreign threads to update the objects
  * while it is executing.
  *
- * @see Scene::GetTime Scene::SetTimeInc Scene::DoDisplay Scene::DoFrame Engine::Compute Engine::Eval
+ * If a fixed simulation step is set, the simulation tree is evaluated
+ * once for each whole step of real time accumulated by Scene::SetTime.
+ * Models remember their transform from before the last step they
+ * changed in so they can be interpolated during display.
+ *
+ * After simulation, the cached world matrices of the models
+ * which moved are recomputed in one pass and the bounds of the
+ * models which moved or changed shape are refit.
+ *
+ * @see Scene::GetTime Scene::SetTimeInc Scene::SetSimStep Scene::DoDisplay Scene::DoFrame Engine::Compute Engine::Eval Model::UpdateWorld Model::UpdateBounds
  */
 void Scene::DoSimulation()
 {
-	Sphere	sphere;
+	VX_PROFILE_ZONE(TEXT("Scene::DoSimulation"));
 
-	if (!m_Engines.IsNull())			// simulation engines?
+	if ((m_SimStep > 0.0f) && (m_TimeInc == 0.0f))
+	{
+		RebaseTime(m_TimeBase);			// new engines use the current base
+		while (m_SimAccum >= m_SimStep)	// run fixed simulation steps
+		{
+			int32 step = Core::InterlockInc(&s_SimStepID);
+
+			if (step == 0)				// zero means not simulating
+				step = Core::InterlockInc(&s_SimStepID);
+			m_SimAccum -= m_SimStep;
+			m_SimTime += m_SimStep;
+			if (m_SimTime - m_TimeBase >= SCENE_RebaseTime)
+				RebaseTime(m_TimeBase + floor((m_SimTime - m_TimeBase) / SCENE_RebaseTime) * SCENE_RebaseTime);
+			m_Time = float(m_SimTime);
+			m_LastSimStep = step;
+			GetTLS()->SimStep = step;
+			if (!m_Engines.IsNull())
+				m_Engines->Compute(float(m_SimTime - m_TimeBase));
+		}
+		GetTLS()->SimStep = 0;
+		m_SimAlpha = float(m_SimAccum / m_SimStep);
+	}
+	else if (!m_Engines.IsNull())		// simulation engines?
 		m_Engines->Compute(m_Time);		// run simulation
-	if (!m_Models.IsNull())				// compute dynamic bounds
-		m_Models->GetBound(&sphere);
+	if (!m_Models.IsNull())
+	{
+		Model::UpdateWorld(m_Models);	// update changed world matrices
+		Model::UpdateBounds(m_Models);	// refit changed bounds
+	}
 }
 
 /*!
@@ -820,6 +968,7 @@ void Scene::DoSimulation()
  */
 void Scene::DoRender()
 {
+	VX_PROFILE_ZONE(TEXT("Scene::DoRender"));
 	Renderer*	r = GetRenderer();
 	int			frame = GetTLS()->Frame;
 	Scene*		child = GetChild();
@@ -881,6 +1030,7 @@ void Scene::Begin()
  */
 void Scene::DoDisplay()
 {
+	VX_PROFILE_ZONE(TEXT("Scene::DoDisplay"));
 	Renderer*	r = GetRenderer();
 	TLS*		g = GetTLS();
 	Camera*		cam = GetCamera();
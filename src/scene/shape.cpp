@@ -17,6 +17,29 @@ static	const TCHAR* opnames[] =
 
 const TCHAR** Shape::DoNames = opnames;
 
+Shape::~Shape()
+{
+	ReplaceGeometry(NULL);
+}
+
+/*
+ * Use new geometry, keeping count of the shapes which use each geometry
+ * so meshes can tell if they are drawn by more than one shape.
+ * @see Geometry::GetNumShapes
+ */
+void Shape::ReplaceGeometry(const Geometry* geo)
+{
+	const Geometry*	old = m_Geometry;
+
+	if (old == geo)
+		return;
+	if (geo)
+		Core::InterlockInc(&(geo->m_NumShapes));
+	if (old)
+		Core::InterlockDec(&(old->m_NumShapes));
+	m_Geometry = geo;
+}
+
 /****
  *
  * Print shape description on standard output.
@@ -104,7 +127,7 @@ bool Shape::Copy(const SharedObj* src_obj)
 		return false;
 	if (src_obj->IsClass(VX_Shape))
 	{
-		m_Geometry = src->m_Geometry;
+		ReplaceGeometry(src->m_Geometry);
 		m_Appearance = src->m_Appearance;
 	}
 	return true;
@@ -160,7 +183,7 @@ void Shape::SetGeometry(const Geometry* geo)
 		*s << OP(VX_Shape, SHAPE_SetGeometry) << this << geo;
 	VX_STREAM_END( )
 
-	m_Geometry = geo;
+	ReplaceGeometry(geo);
 	NotifyParents(MOD_BVinvalid | MOD_STinvalid); // mark bounding volume as invalid
 	m_Faces = 0;
 	m_Verts = 0;
@@ -223,8 +246,6 @@ void Shape::Render(Scene* scene)
  * ShapeInfo properties are updated.
  */
 	Renderer*		render = (Renderer*) scene->GetRenderer();
-	uint32			lightmask = LIGHT_All;
-	LightList*		lights = render->GetLights();
 	const Matrix*	mv;
 
 	if (m_Geometry.IsNull())
@@ -233,13 +254,12 @@ void Shape::Render(Scene* scene)
 		mv = NULL;
 	else
 		mv = scene->GetWorldMatrix();		// get world matrix from scene
-	if (lights)
-		lightmask = lights->NearLights(this, mv, LIGHT_All);
 /*
  * State sorting enabled. Add each mesh in the surface
- * to a state-sorting bucket depending on its appearance index
+ * to a state-sorting bucket depending on its appearance index.
+ * The state sorter finds the lights near the shape.
  */
-	render->AddShape(this, mv, lightmask);
+	render->AddShape(this, mv);
 }
 
 /*!
@@ -10,6 +10,8 @@ VX_IMPLEMENT_CLASSID(World3D, World, VX_World3D);
 
 VX_IMPLEMENT_CLASSID(SceneLoader, FileLoader, VX_Loader);
 
+SceneLoader::PostLoadFunc* SceneLoader::PostLoad = NULL;
+
 /*****
  *
  *	Forces all of the built-in classes to be referenced.
@@ -119,7 +121,9 @@ bool World3D::OnInit()
 // Initialize file types
 //
 	load->SetFileFunc(TEXT("vix"), &SceneLoader::ReadScene, Event::LOAD_SCENE);
+	load->SetFileFunc(TEXT("vxz"), &SceneLoader::ReadScene, Event::LOAD_SCENE);
 //	load->SetFileFunc(TEXT("bvh"), &BVHLoader::ReadAnim, Event::LOAD_SCENE);
+	load->SetFileFunc(TEXT("vxa"), &AnimClip::ReadAnim, Event::LOAD_SCENE);
 	load->SetFileFunc(TEXT("scp"), &FileLoader::ReadText, Event::LOAD_TEXT);
 	load->SetFileFunc(TEXT("txt"), &FileLoader::ReadText, Event::LOAD_TEXT);
 	load->SetFileFunc(TEXT("cso"), &FileLoader::ReadBinary, Event::LOAD_DATA);
@@ -637,9 +641,16 @@ bool World3D::Do(Messenger& s, int op)
  * replace the current scene, the SceneLoader::Load function will do
  * this without blocking.
  *
+ * If SceneLoader::PostLoad is set, it is called in the load thread with
+ * the new scene before the load event is sent, so it can change the
+ * scene without locking it.
+ *
+ * Chunked scene files (.vxz) are loaded with a ChunkMessenger which
+ * decompresses the chunks in parallel.
+ *
  * @return \b true if load was successful, else \b false
  *
- * @see World::LoadAsync FileLoader::Load
+ * @see World::LoadAsync FileLoader::Load SceneLoader::PostLoad SceneLoader::OpenScene
  */
 bool SceneLoader::ReadScene(const TCHAR* filename, Core::Stream* instream, LoadEvent* ev)
 {
@@ -648,7 +659,9 @@ bool SceneLoader::ReadScene(const TCHAR* filename, Core::Stream* instream, LoadE
 	TCHAR			dir[VX_MaxPath];
 	Scene*			inscene = (Scene*) (SharedObj*) event->Object;
 	size_t			len;
-	FileMessenger	scenemaker;
+	FileMessenger	filemaker;
+	ChunkMessenger	chunkmaker;
+	FileMessenger*	scenemaker = &filemaker;
 	NameTable*		scenedict;
 	const Model*	sceneroot;
 	const Engine*	simroot;
@@ -662,8 +675,10 @@ bool SceneLoader::ReadScene(const TCHAR* filename, Core::Stream* instream, LoadE
 	instream->ParseDirectory(filename, filebase, dir);
 	instream->SetDirectory(dir);			// establish base directory
 	len = STRLEN(filebase);
-	scenemaker.SetInStream(instream);
-	if (!scenemaker.Load())					// cannot load file?
+	if (ChunkMessenger::IsChunked(filename))
+		scenemaker = &chunkmaker;
+	scenemaker->SetInStream(instream);
+	if (!scenemaker->Load())					// cannot load file?
 		return false;						// no input scene
 	instream->SetDirectory(NULL);
 /*
@@ -671,20 +686,20 @@ bool SceneLoader::ReadScene(const TCHAR* filename, Core::Stream* instream, LoadE
  * Closing the scene loader will delete this dictionary but we want to keep
  * it to merge with the display scene's dictionary later.
  */
-	scenedict = scenemaker.GetNameDict();
+	scenedict = scenemaker->GetNameDict();
 	World3D::Get()->GetLoader()->SetSceneDict(filebase, scenedict);
 /*
  * Define names in the current display scene's global dictionary for the
  * scene in the file, the simulation tree root and the scene graph
  */
 	STRCAT(filebase, TEXT(".scene"));				// find the scene
-	inscene = (Scene*) (SharedObj*) scenemaker.Find(filebase);
+	inscene = (Scene*) (SharedObj*) scenemaker->Find(filebase);
 	if (inscene == NULL)							// found a scene?
 	{
 		STRCPY(filebase + len, TEXT(".simroot"));
-		simroot = (const Engine*) scenemaker.Find(filebase);
+		simroot = (const Engine*) scenemaker->Find(filebase);
 		STRCPY(filebase + len, TEXT(".root"));
-		sceneroot = (const Model*) scenemaker.Find(filebase);
+		sceneroot = (const Model*) scenemaker->Find(filebase);
 		if (sceneroot != NULL)						// found object called filebase.root?
 		{
 			if (sceneroot->IsClass(VX_Model))		// we have a model
@@ -699,7 +714,7 @@ bool SceneLoader::ReadScene(const TCHAR* filename, Core::Stream* instream, LoadE
 			{
 				event->Object = sceneroot;
 				VX_TRACE(FileLoader::Debug, ("SceneLoader::ReadScene %s\n", (const char *) filebase));
-				scenemaker.Close();
+				scenemaker->Close();
 				return true;
 			}
 		}
@@ -739,11 +754,114 @@ bool SceneLoader::ReadScene(const TCHAR* filename, Core::Stream* instream, LoadE
 		if (name)
 			disp->Define(name, simroot);
 	}
+	if (PostLoad && inscene)
+		(*PostLoad)(inscene, filename);
 	event->Object = inscene;
-	scenemaker.Close();
+	scenemaker->Close();
 	return true;
 }
 
+/*!
+ * @fn bool SceneLoader::OpenScene(const TCHAR* filename)
+ * @param filename	name of chunked scene file (.vxz) to open.
+ *
+ * Opens a chunked scene file without loading it. Only the chunk directory
+ * is read. Afterwards, SceneLoader::Find loads the named subtrees
+ * it is asked for on demand, along with the objects they use.
+ * The objects loaded go into the dictionary for the scene, like
+ * the objects from scene files which are loaded completely.
+ * The file stays open until it is unloaded with SceneLoader::Unload
+ * or the loader is killed.
+ *
+ * @code
+ *	SceneLoader* loader = World3D::Get()->GetLoader();
+ *	loader->OpenScene(TEXT("city.vxz"));
+ *	Model* block = (Model*) loader->Find(TEXT("city.block12"));
+ * @endcode
+ *
+ * @return \b true if file was opened, \b false if it is not a chunked scene file
+ *
+ * @see SceneLoader::Find ChunkMessenger::LoadSubtree
+ */
+bool SceneLoader::OpenScene(const TCHAR* filename)
+{
+	TCHAR				filebase[VX_MaxPath];
+	TCHAR				dir[VX_MaxPath];
+	Core::FileStream*	instream = new Core::FileStream;
+	ChunkMessenger*		chunks = new ChunkMessenger;
+	ObjRef				ref(chunks);
+
+	instream->ParseDirectory(filename, filebase, dir);
+	instream->SetDirectory(dir);			// textures are relative to the file
+	chunks->SetInStream(instream);
+	if (!chunks->Open(filename, Core::Stream::OPEN_READ))
+		VX_ERROR(("SceneLoader::OpenScene %s ERROR: not a chunked scene file\n", filename), false);
+	SetSceneDict(filebase, chunks->GetNameDict());
+	SetChunks(filebase, chunks);
+	VX_TRACE(FileLoader::Debug, ("SceneLoader::OpenScene %s %d chunks %d subtrees\n",
+			 filename, chunks->GetNumChunks(), chunks->GetNumSubtrees()));
+	return true;
+}
+
+/*
+ * Returns the chunk messenger for a scene opened with SceneLoader::OpenScene.
+ * If the scene name is NULL, the last one opened is returned.
+ */
+ChunkMessenger* SceneLoader::GetChunks(const TCHAR* scenename) const
+{
+	TCHAR			namebuf[VX_MaxPath];
+	ObjRef*			ref;
+	TCHAR*			p;
+
+	if (scenename == NULL)
+		return m_LastChunks;
+	STRCPY(namebuf, scenename);
+	p = STRRCHR(namebuf, TEXT('.'));
+	if (p)
+		STRCPY(p, TEXT(".chunks"));
+	else
+		STRCAT(namebuf, TEXT(".chunks"));
+	ref = m_FileDict.Find(namebuf);			// look up without interning
+	if (ref == NULL)
+		return NULL;
+	return (ChunkMessenger*) (SharedObj*) *ref;
+}
+
+/*
+ * Saves the chunk messenger for a scene under the scene's name.
+ * A NULL messenger closes the file and removes it.
+ */
+void SceneLoader::SetChunks(const TCHAR* scenename, ChunkMessenger* chunks)
+{
+	TCHAR		namebuf[VX_MaxPath];
+	TCHAR*		p;
+	NameProp	np;
+	ObjectLock	lock(this);
+
+	STRCPY(namebuf, scenename);
+	p = STRRCHR(namebuf, TEXT('.'));
+	if (p)
+		STRCPY(p, TEXT(".chunks"));
+	else
+		STRCAT(namebuf, TEXT(".chunks"));
+	if (chunks)
+	{
+		np = namebuf;
+		m_FileDict.Set(np, chunks);
+		m_LastChunks = chunks;
+		return;
+	}
+	ObjRef* ref = m_FileDict.Find(namebuf);	// look up without interning
+	if (ref == NULL)
+		return;
+	chunks = (ChunkMessenger*) (SharedObj*) *ref;
+	if (chunks == m_LastChunks)
+		m_LastChunks = NULL;
+	chunks->Close();
+	np.Find(namebuf);
+	m_FileDict.Remove(np);
+}
+
 /*!
  * @fn NameTable* SceneLoader::GetSceneDict(const TCHAR* scenename) const
  * @param scenename	string name of scene, if NULL the last loaded scene dictionary is used
@@ -763,7 +881,6 @@ NameTable* SceneLoader::GetSceneDict(const TCHAR* scenename) const
 	TCHAR			namebuf[VX_MaxPath];
 	ObjRef*		dictptr;
 	TCHAR*			p;
-	NameProp		np;
 
 	STRCPY(namebuf, scenename);
 	p = STRRCHR(namebuf, TEXT('.'));
@@ -771,8 +888,7 @@ NameTable* SceneLoader::GetSceneDict(const TCHAR* scenename) const
 		STRCPY(p, TEXT(".dict"));
 	else
 		STRCAT(namebuf, TEXT(".dict"));
-	np = namebuf;
-	dictptr = m_FileDict.Find(np);
+	dictptr = m_FileDict.Find(namebuf);		// look up without interning
 	if (dictptr == NULL)
 		return NULL;
 	return (NameTable*) (SharedObj*) *dictptr;
@@ -807,9 +923,9 @@ void SceneLoader::SetSceneDict(const TCHAR* scenename, NameTable* dict)
 		STRCPY(p, TEXT(".dict"));
 	else
 		STRCAT(namebuf, TEXT(".dict"));
-	np = namebuf;
 	if (dict)
 	{
+		np = namebuf;
 		m_FileDict.Set(np, dict);
 		m_LastDict = dict;
 		dict->MakeLock();
@@ -819,6 +935,7 @@ void SceneLoader::SetSceneDict(const TCHAR* scenename, NameTable* dict)
 		if (m_LastDict)
 			m_LastDict->KillLock();
 		m_LastDict = NULL;
+		np.Find(namebuf);					// look up without interning
 		m_FileDict.Remove(np);
 	}
 }
@@ -835,9 +952,13 @@ void SceneLoader::SetSceneDict(const TCHAR* scenename, NameTable* dict)
  * If you are retrieving an object and it is within a hierarchy in the loaded file,
  * you must remove it from that hierarchy before you can put it into another.
  *
+ * If the scene was opened with SceneLoader::OpenScene and the object
+ * has not been loaded yet, the subtree with that name is loaded from
+ * the chunked file.
+ *
  * @return pointer to object found or NULL if object not there
  *
- * @see Messenger::Find
+ * @see Messenger::Find SceneLoader::OpenScene
  */
 SharedObj* SceneLoader::Find(const TCHAR* objname, const TCHAR* scenename)
 {
@@ -855,7 +976,13 @@ SharedObj* SceneLoader::Find(const TCHAR* objname, const TCHAR* scenename)
 	n = STRLEN(objname);
 	if ((objname[0] != '*') &&			// not a wildcard search?
 		(objname[n - 1] != '*'))
+	{
+		ChunkMessenger* chunks;
+
 		ref = dict->Find(objname);
+		if ((ref == NULL) && (chunks = GetChunks(scenename)))
+			return chunks->LoadSubtree(objname);	// load on demand
+	}
 	else
 		ref = dict->FindWild(objname);
 	if (ref)
@@ -928,18 +1055,23 @@ void SceneLoader::Unload(const TCHAR* filename)
 			{
 				STRCPY(namebuf, name);
 				STRCPY(STRRCHR(namebuf, TEXT('.')), TEXT(".dict"));
-				m_FileDict.Remove(NameProp(namebuf));
+				NameProp	np;
+
+				np.Find(namebuf);			// look up without interning
+				m_FileDict.Remove(np);
 			}
 			stream->Detach(obj);
 			stream->DetachAll(lookfor, obj);
 		}
 	}
+	SetChunks(basename, NULL);				// close chunked file
 	FileLoader::Unload(filename);
 }
 
 void SceneLoader::Kill()
 {
 	m_LastDict = NULL;
+	m_LastChunks = NULL;
 	FileLoader::Kill();
 }
 }	// end Vixen
\ No newline at end of file
@@ -0,0 +1,1116 @@
+#include "vixen.h"
+
+namespace Vixen {
+
+VX_IMPLEMENT_CLASS(AnimClip, SharedObj);
+VX_IMPLEMENT_CLASSID(ClipInterp, Interpolator, VX_ClipInterp);
+
+float	AnimClip::PosTolerance = 0.01f;
+float	AnimClip::RotTolerance = 0.002f;
+int32	AnimClip::WindowSize = 128;
+
+#define	CLIP_HeaderWords	9				// number of words in file header
+#define	CLIP_KeyBytes		6				// bytes in a packed key
+#define	CLIP_QuatRange		16383.5f		// half the range of a 15 bit quaternion component
+#define	CLIP_PosRange		65535.0f		// range of a 16 bit position component
+#define	CLIP_Sqrt2			1.41421356f		// smallest three components are within +-1/sqrt(2)
+
+static inline int32* PutFloats(int32* op, const float* v, int n)
+{
+	memcpy(op, v, n * sizeof(float));
+	return op + n;
+}
+
+static inline const int32* GetFloats(const int32* ip, float* v, int n)
+{
+	memcpy(v, ip, n * sizeof(float));
+	return ip + n;
+}
+
+AnimClip::AnimClip() : SharedObj()
+{
+	m_NumBones = 0;
+	m_NumChannels = 0;
+	m_NumFrames = 0;
+	m_NumKeys = 0;
+	m_NumWindows = 0;
+	m_WindowSize = WindowSize;
+	m_FrameSize = 0;
+	m_TimeStep = 0.0f;
+	m_PosError = 0.0f;
+	m_RotError = 0.0f;
+	m_Bones = NULL;
+	m_Channels = NULL;
+	m_Names = NULL;
+	m_NamesSize = 0;
+	m_Windows = NULL;
+	m_Data = NULL;
+	m_WindowData = NULL;
+	m_MaxWindowSize = 0;
+	m_DataOffset = 0;
+	m_Serial = 0;
+}
+
+AnimClip::~AnimClip()
+{
+	Empty();
+}
+
+/*
+ * Frees the bones, channels and key data.
+ */
+void AnimClip::Empty()
+{
+	if (m_Bones)
+		free(m_Bones);
+	if (m_Channels)
+		free(m_Channels);
+	if (m_Names)
+		free(m_Names);
+	if (m_Windows)
+		free(m_Windows);
+	if (m_Data)
+		free(m_Data);
+	if (m_WindowData)
+		free(m_WindowData);
+	m_Bones = NULL;
+	m_Channels = NULL;
+	m_Names = NULL;
+	m_Windows = NULL;
+	m_Data = NULL;
+	m_WindowData = NULL;
+	m_Cursor.Empty();
+	m_Stream = (Core::Stream*) NULL;
+	m_NumBones = 0;
+	m_NumChannels = 0;
+	m_NumFrames = 0;
+	m_NumKeys = 0;
+	m_NumWindows = 0;
+	m_NamesSize = 0;
+	m_FrameSize = 0;
+	m_MaxWindowSize = 0;
+	++m_Serial;
+}
+
+AnimClip::Cursor::Cursor()
+{
+	Window = -1;
+	Serial = -1;
+	MaxKeys = 0;
+	KeyStart = NULL;
+	KeyFrames = NULL;
+	KeyVals = NULL;
+}
+
+AnimClip::Cursor::~Cursor()
+{
+	Empty();
+}
+
+void AnimClip::Cursor::Empty()
+{
+	if (KeyStart)
+		free(KeyStart);
+	if (KeyFrames)
+		free(KeyFrames);
+	if (KeyVals)
+		free(KeyVals);
+	KeyStart = NULL;
+	KeyFrames = NULL;
+	KeyVals = NULL;
+	MaxKeys = 0;
+	Window = -1;
+	Serial = -1;
+}
+
+/*!
+ * @fn int AnimClip::AddBone(const TCHAR* name, int parent, const Vec3& offset, const Quat& bindrot)
+ * @param name		name of bone
+ * @param parent	index of parent bone, -1 for the root
+ * @param offset	position of bone relative to its parent
+ * @param bindrot	local rotation of bone in the bind pose
+ *
+ * Adds a bone to the skeleton saved with the clip. The parent
+ * must be added before its children.
+ *
+ * @return index of bone added, -1 on error
+ *
+ * @see AnimClip::AddChannel AnimClip::MakeSkeleton
+ */
+int AnimClip::AddBone(const TCHAR* name, int parent, const Vec3& offset, const Quat& bindrot)
+{
+	int32	n = (int32) STRLEN(name) + 1;
+	Bone*	bones;
+	TCHAR*	names;
+
+	if ((parent < -1) || (parent >= m_NumBones))
+		VX_ERROR(("AnimClip::AddBone ERROR parent of %s not added yet\n", name), -1);
+	bones = (Bone*) realloc(m_Bones, (m_NumBones + 1) * sizeof(Bone));
+	if (bones)
+		m_Bones = bones;
+	names = (TCHAR*) realloc(m_Names, (m_NamesSize + n) * sizeof(TCHAR));
+	if (names)
+		m_Names = names;
+	if ((bones == NULL) || (names == NULL))
+		VX_ERROR(("AnimClip::AddBone ERROR out of memory\n"), -1);
+
+	Bone& b = m_Bones[m_NumBones];
+
+	b.Parent = parent;
+	b.Offset = offset;
+	b.BindRot = bindrot;
+	b.Name = m_NamesSize;
+	memcpy(m_Names + m_NamesSize, name, n * sizeof(TCHAR));
+	m_NamesSize += n;
+	return m_NumBones++;
+}
+
+/*!
+ * @fn int AnimClip::AddChannel(int bone, int type)
+ * @param bone	index of bone animated by the channel
+ * @param type	Evaluator::POSITION (3 floats) or Evaluator::ROTATION (4 floats)
+ *
+ * Adds a channel to the clip. Each sampled frame given to AnimClip::Compress
+ * has the values for all the channels in the order they were added.
+ *
+ * @return index of channel added, -1 on error
+ *
+ * @see AnimClip::AddBone AnimClip::Compress
+ */
+int AnimClip::AddChannel(int bone, int type)
+{
+	Channel* chans;
+
+	if ((bone < 0) || (bone >= m_NumBones) ||
+		((type != Evaluator::POSITION) && (type != Evaluator::ROTATION)))
+		VX_ERROR(("AnimClip::AddChannel ERROR bad bone %d or type %d\n", bone, type), -1);
+	chans = (Channel*) realloc(m_Channels, (m_NumChannels + 1) * sizeof(Channel));
+	if (chans == NULL)
+		VX_ERROR(("AnimClip::AddChannel ERROR out of memory\n"), -1);
+	m_Channels = chans;
+
+	Channel& c = m_Channels[m_NumChannels];
+
+	c.Bone = bone;
+	c.Type = type;
+	c.Offset = m_FrameSize;
+	m_FrameSize += (type == Evaluator::ROTATION) ? 4 : 3;
+	return m_NumChannels++;
+}
+
+/*
+ * Allocates the buffer streamed windows are read into.
+ * Cursors decompressing the old key data are no longer valid.
+ */
+bool AnimClip::AllocWindow()
+{
+	if (m_WindowData)
+		free(m_WindowData);
+	m_WindowData = NULL;
+	++m_Serial;
+	if (m_Data)
+		return true;
+	m_WindowData = (char*) malloc(m_MaxWindowSize + 1);
+	if (m_WindowData == NULL)
+		VX_ERROR(("AnimClip ERROR out of memory for %d byte window\n", m_MaxWindowSize), false);
+	return true;
+}
+
+/*
+ * Returns the error of interpolating between two keys instead of
+ * using the sample. Rotation errors are angles in radians.
+ */
+float AnimClip::KeyError(const Channel& chan, const float* s, const float* k1, const float* k2, float t) const
+{
+	if (chan.Type == Evaluator::ROTATION)
+	{
+		Quat	q;
+		float	d;
+
+		q.Slerp(*((const Quat*) k1), *((const Quat*) k2), t);
+		d = fabsf(q.Dot(s)) / sqrtf(q.LengthSquared() * ((const Quat*) s)->LengthSquared());
+		return (d >= 1.0f) ? 0.0f : 2.0f * acosf(d);
+	}
+	float	dx = k1[0] + t * (k2[0] - k1[0]) - s[0];
+	float	dy = k1[1] + t * (k2[1] - k1[1]) - s[1];
+	float	dz = k1[2] + t * (k2[2] - k1[2]) - s[2];
+
+	return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+/*
+ * Marks the keys of a channel needed to stay within the error tolerance
+ * for the frames from first to last. The first and last frames are always kept.
+ * Each span of frames is split at the sample with the largest error
+ * until no sample is further than the tolerance from the interpolated value.
+ * Returns the number of keys kept.
+ */
+int32 AnimClip::ReduceKeys(const float* samples, int32 c, int32 first, int32 last, uchar* keep) const
+{
+	const Channel&	chan = m_Channels[c];
+	float			tol = (chan.Type == Evaluator::ROTATION) ? RotTolerance : PosTolerance;
+	int32			stack[2 * (CLIP_MaxWindow + 1)];
+	int32			sp = 0;
+	int32			nkeys = 1;
+
+	memset(keep, 0, last - first + 1);
+	keep[0] = 1;
+	if (last == first)
+		return nkeys;
+	keep[last - first] = 1;
+	++nkeys;
+	stack[sp++] = first;
+	stack[sp++] = last;
+	while (sp > 0)
+	{
+		int32			b = stack[--sp];
+		int32			a = stack[--sp];
+		const float*	k1 = samples + a * m_FrameSize + chan.Offset;
+		const float*	k2 = samples + b * m_FrameSize + chan.Offset;
+		float			maxerr = tol;
+		int32			m = -1;
+
+		for (int32 f = a + 1; f < b; ++f)
+		{
+			float err = KeyError(chan, samples + f * m_FrameSize + chan.Offset, k1, k2, float(f - a) / float(b - a));
+
+			if (err > maxerr)
+			{
+				maxerr = err;
+				m = f;
+			}
+		}
+		if (m < 0)							// all samples within tolerance
+			continue;
+		keep[m - first] = 1;
+		++nkeys;
+		if (m - a > 1)
+		{
+			stack[sp++] = a;
+			stack[sp++] = m;
+		}
+		if (b - m > 1)
+		{
+			stack[sp++] = m;
+			stack[sp++] = b;
+		}
+	}
+	return nkeys;
+}
+
+/*
+ * Packs one key into 6 bytes.
+ * Rotations keep the three smallest components of the normalized quaternion
+ * in 15 bits each and the index of the largest one in 2 bits. The largest
+ * component is made positive so it can be recomputed from the others.
+ * Positions keep 16 bits per component scaled to the range of the channel
+ * in the window, given as the minimum and the quantization step.
+ */
+void AnimClip::PackKey(int32 type, const Vec3* range, const float* v, uchar* op) const
+{
+	if (type == Evaluator::ROTATION)
+	{
+		Quat	q(v[0], v[1], v[2], v[3]);
+		int32	big = 0;
+		int64	bits;
+
+		q.Normalize();
+		for (int32 i = 1; i < 4; ++i)
+			if (fabsf(q[i]) > fabsf(q[big]))
+				big = i;
+		if (q[big] < 0)
+			q *= -1.0f;
+		bits = big;
+		for (int32 i = 0; i < 4; ++i)
+		{
+			if (i == big)
+				continue;
+			int32 u = int32((q[i] * CLIP_Sqrt2 + 1.0f) * CLIP_QuatRange + 0.5f);
+
+			if (u < 0)
+				u = 0;
+			else if (u > 32767)
+				u = 32767;
+			bits = (bits << 15) | u;
+		}
+		for (int32 i = 0; i < CLIP_KeyBytes; ++i)
+			*op++ = uchar(bits >> (8 * i));
+		return;
+	}
+	for (int32 i = 0; i < 3; ++i)
+	{
+		int32 u = 0;
+
+		if (range[1][i] > 0)
+			u = int32((v[i] - range[0][i]) / range[1][i] + 0.5f);
+		if (u < 0)
+			u = 0;
+		else if (u > 65535)
+			u = 65535;
+		*op++ = uchar(u & 0xFF);
+		*op++ = uchar(u >> 8);
+	}
+}
+
+/*
+ * Unpacks a key made by PackKey into 4 floats.
+ */
+void AnimClip::UnpackKey(int32 type, const Vec3* range, const uchar* ip, float* v) const
+{
+	if (type == Evaluator::ROTATION)
+	{
+		int64	bits = 0;
+		int32	big;
+		float	sum = 0;
+
+		for (int32 i = CLIP_KeyBytes - 1; i >= 0; --i)
+			bits = (bits << 8) | ip[i];
+		big = int32(bits >> 45) & 3;
+		for (int32 i = 3, shift = 0; i >= 0; --i)
+		{
+			if (i == big)
+				continue;
+			float c = (float(int32(bits >> shift) & 0x7FFF) / CLIP_QuatRange - 1.0f) / CLIP_Sqrt2;
+
+			v[i] = c;
+			sum += c * c;
+			shift += 15;
+		}
+		v[big] = (sum < 1.0f) ? sqrtf(1.0f - sum) : 0.0f;
+		return;
+	}
+	for (int32 i = 0; i < 3; ++i)
+		v[i] = range[0][i] + range[1][i] * float(ip[2 * i] | (ip[2 * i + 1] << 8));
+	v[3] = 0.0f;
+}
+
+/*!
+ * @fn bool AnimClip::Compress(const float* samples, int numframes, float timestep)
+ * @param samples	values for all the channels for each frame
+ * @param numframes	number of frames sampled
+ * @param timestep	time between frames in seconds
+ *
+ * Compresses the sampled frames. Each frame has 3 floats for each
+ * position channel and 4 floats (a quaternion) for each rotation channel
+ * in the order the channels were added. The frames are split into windows
+ * of AnimClip::WindowSize frames. In each window, keys are removed from each
+ * channel until interpolating the remaining keys would exceed
+ * AnimClip::PosTolerance or AnimClip::RotTolerance. Windows start
+ * and end with a key so each can be decompressed by itself.
+ *
+ * After compression, the clip is decompressed again to measure the
+ * largest error, including the quantization of the keys.
+ *
+ * @return \b true if clip was compressed, \b false on error
+ *
+ * @see AnimClip::AddChannel AnimClip::Write AnimClip::GetPosError AnimClip::GetRotError
+ */
+bool AnimClip::Compress(const float* samples, int numframes, float timestep)
+{
+	uchar	keep[CLIP_MaxWindow + 1];
+	int32	maxsize = 0;
+	int32	size = 0;
+	int32	wsize = WindowSize;
+
+	if ((numframes <= 0) || (m_NumChannels <= 0) || (timestep < 0))
+		VX_ERROR(("AnimClip::Compress ERROR no frames or channels to compress\n"), false);
+	if (wsize < 1)
+		wsize = 1;
+	else if (wsize > CLIP_MaxWindow)
+		wsize = CLIP_MaxWindow;
+	m_Stream = (Core::Stream*) NULL;
+	if (m_Windows)
+		free(m_Windows);
+	if (m_Data)
+		free(m_Data);
+	m_Windows = NULL;
+	m_Data = NULL;
+	m_WindowSize = wsize;
+	m_NumFrames = numframes;
+	m_TimeStep = timestep;
+	m_NumKeys = 0;
+	m_MaxWindowSize = 0;
+	m_NumWindows = (numframes > 1) ? (numframes - 2) / wsize + 1 : 1;
+	m_Windows = (int32*) malloc((m_NumWindows + 1) * sizeof(int32));
+	if (m_Windows == NULL)
+		VX_ERROR(("AnimClip::Compress ERROR out of memory\n"), false);
+	/*
+	 * Pack each window: for each channel, the range of positions in the window,
+	 * the number of keys - 1, the frames of the keys between the first and
+	 * last frame of the window and the packed keys.
+	 */
+	for (int32 w = 0; w < m_NumWindows; ++w)
+	{
+		int32	first = w * wsize;
+		int32	last = first + wsize;
+		int32	need = m_NumChannels * (1 + 6 * sizeof(float) + wsize + CLIP_KeyBytes * (wsize + 1));
+		uchar*	op;
+
+		if (last > numframes - 1)
+			last = numframes - 1;
+		if (size + need > maxsize)
+		{
+			char* data;
+
+			maxsize = 2 * maxsize + need;
+			data = (char*) realloc(m_Data, maxsize);
+			if (data == NULL)
+				VX_ERROR(("AnimClip::Compress ERROR out of memory for %d bytes\n", maxsize), false);
+			m_Data = data;
+		}
+		m_Windows[w] = size;
+		op = (uchar*) m_Data + size;
+		for (int32 c = 0; c < m_NumChannels; ++c)
+		{
+			const Channel&	chan = m_Channels[c];
+			int32			nkeys = ReduceKeys(samples, c, first, last, keep);
+			Vec3			range[2];
+
+			if (chan.Type == Evaluator::POSITION)
+			{
+				Vec3 vmin(samples + first * m_FrameSize + chan.Offset);
+				Vec3 vmax(vmin);
+
+				for (int32 f = first + 1; f <= last; ++f)
+				{
+					const float* s = samples + f * m_FrameSize + chan.Offset;
+
+					for (int32 i = 0; i < 3; ++i)
+					{
+						if (s[i] < vmin[i])
+							vmin[i] = s[i];
+						if (s[i] > vmax[i])
+							vmax[i] = s[i];
+					}
+				}
+				range[0] = vmin;
+				range[1] = (vmax - vmin) / CLIP_PosRange;
+				memcpy(op, &range[0].x, 3 * sizeof(float));
+				memcpy(op + 3 * sizeof(float), &range[1].x, 3 * sizeof(float));
+				op += 6 * sizeof(float);
+			}
+			*op++ = uchar(nkeys - 1);
+			for (int32 f = first + 1; f < last; ++f)
+				if (keep[f - first])
+					*op++ = uchar(f - first);
+			for (int32 f = first; f <= last; ++f)
+				if (keep[f - first])
+				{
+					PackKey(chan.Type, range, samples + f * m_FrameSize + chan.Offset, op);
+					op += CLIP_KeyBytes;
+				}
+			m_NumKeys += nkeys;
+		}
+		size = int32(op - (uchar*) m_Data);
+		if (size - m_Windows[w] > m_MaxWindowSize)
+			m_MaxWindowSize = size - m_Windows[w];
+	}
+	m_Windows[m_NumWindows] = size;
+	if (!AllocWindow())
+		return false;
+	CheckError(samples);
+	return true;
+}
+
+/*
+ * Measures the largest error between the samples and the decompressed clip.
+ */
+void AnimClip::CheckError(const float* samples)
+{
+	Cursor	cur;
+	float	val[4];
+
+	m_PosError = 0.0f;
+	m_RotError = 0.0f;
+	for (int32 f = 0; f < m_NumFrames; ++f)
+		for (int32 c = 0; c < m_NumChannels; ++c)
+		{
+			const Channel&	chan = m_Channels[c];
+			const float*	s = samples + f * m_FrameSize + chan.Offset;
+			float			err;
+
+			if (!Eval(cur, c, f * m_TimeStep, val))
+				continue;
+			err = KeyError(chan, s, val, val, 0.0f);
+			if (chan.Type == Evaluator::ROTATION)
+			{
+				if (err > m_RotError)
+					m_RotError = err;
+			}
+			else if (err > m_PosError)
+				m_PosError = err;
+		}
+}
+
+/*!
+ * @fn bool AnimClip::Write(Core::Stream* out) const
+ * @param out	stream to write clip file to
+ *
+ * Writes the header, directory and packed windows of a clip
+ * made by AnimClip::Compress.
+ *
+ * @return \b true if clip was written, \b false on error
+ *
+ * @see AnimClip::Open AnimClip::Compress
+ */
+bool AnimClip::Write(Core::Stream* out) const
+{
+	int32	header[CLIP_HeaderWords] = { CLIP_Magic, CLIP_Version, m_NumBones, m_NumChannels,
+									 m_NumFrames, m_WindowSize, m_NumKeys, 0, 0 };
+	int32	dirsize = 0;
+	int32*	dir;
+	int32*	op;
+
+	if ((m_Data == NULL) || (m_Windows == NULL))
+		VX_ERROR(("AnimClip::Write ERROR clip is not compressed in memory\n"), false);
+	for (int32 i = 0; i < m_NumBones; ++i)
+		dirsize += 9 + ((int32) (STRLEN(GetBoneName(i)) * sizeof(TCHAR)) + 4) / 4;
+	dirsize += m_NumChannels * 2 + m_NumWindows + 1;
+	dir = (int32*) calloc(dirsize, sizeof(int32));
+	if (dir == NULL)
+		VX_ERROR(("AnimClip::Write ERROR out of memory\n"), false);
+	op = dir;
+	for (int32 i = 0; i < m_NumBones; ++i)
+	{
+		const Bone&		b = m_Bones[i];
+		const TCHAR*	name = GetBoneName(i);
+		int32			n = (int32) (STRLEN(name) * sizeof(TCHAR));
+		int32			len = (n + 4) & ~3;		// include terminator
+
+		*op++ = b.Parent;
+		op = PutFloats(op, &b.Offset.x, 3);
+		op = PutFloats(op, &b.BindRot.x, 4);
+		*op++ = len;
+		memcpy(op, name, n);
+		op += len / 4;
+	}
+	for (int32 i = 0; i < m_NumChannels; ++i)
+	{
+		const Channel& c = m_Channels[i];
+
+		*op++ = c.Bone;
+		*op++ = c.Type;
+	}
+	memcpy(op, m_Windows, (m_NumWindows + 1) * sizeof(int32));
+	memcpy(&header[7], &m_TimeStep, sizeof(float));
+	header[8] = dirsize * sizeof(int32);
+	bool rc = (out->Write((const char*) header, sizeof(header)) == sizeof(header)) &&
+			  (out->Write((const char*) dir, header[8]) == size_t(header[8])) &&
+			  (out->Write(m_Data, GetDataSize()) == size_t(GetDataSize()));
+	free(dir);
+	if (!rc)
+		VX_ERROR(("AnimClip::Write ERROR cannot write clip\n"), false);
+	return true;
+}
+
+/*!
+ * @fn bool AnimClip::Open(Core::Stream* in)
+ * @param in	stream to read clip file from, must be able to seek
+ *
+ * Reads the header and directory of a clip file. The packed windows
+ * are not read until they are needed by AnimClip::Eval.
+ * The clip keeps a reference to the stream and reads from it while
+ * the clip is playing.
+ *
+ * @return \b true if clip directory was read, \b false on error
+ *
+ * @see AnimClip::Write AnimClip::Eval AnimClip::ReadAnim
+ */
+bool AnimClip::Open(Core::Stream* in)
+{
+	int32			header[CLIP_HeaderWords];
+	int32*			dir;
+	const int32*	ip;
+	const int32*	iend;
+	int32			nbones;
+	int32			nchans;
+
+	Empty();
+	if ((in == NULL) || (in->Read((char*) header, sizeof(header)) != sizeof(header)))
+		VX_ERROR(("AnimClip::Open ERROR cannot read header\n"), false);
+	nbones = header[2];
+	nchans = header[3];
+	if ((header[0] != CLIP_Magic) || (header[1] != CLIP_Version) ||
+		(nbones <= 0) || (nchans <= 0) || (header[4] <= 0) ||
+		(header[5] <= 0) || (header[5] > CLIP_MaxWindow) ||
+		(header[8] <= 0) || (header[8] & 3))
+		VX_ERROR(("AnimClip::Open ERROR not a clip file\n"), false);
+	dir = (int32*) malloc(header[8]);
+	if ((dir == NULL) || (in->Read((char*) dir, header[8]) != size_t(header[8])))
+	{
+		if (dir)
+			free(dir);
+		VX_ERROR(("AnimClip::Open ERROR cannot read directory\n"), false);
+	}
+	m_NumFrames = header[4];
+	m_WindowSize = header[5];
+	m_NumKeys = header[6];
+	memcpy(&m_TimeStep, &header[7], sizeof(float));
+	m_NumWindows = (m_NumFrames > 1) ? (m_NumFrames - 2) / m_WindowSize + 1 : 1;
+	m_DataOffset = sizeof(header) + header[8];
+	ip = dir;
+	iend = dir + header[8] / sizeof(int32);
+	for (int32 i = 0; i < nbones; ++i)			// read bones
+	{
+		TCHAR	name[VX_MaxName];
+		Vec3	offset;
+		Quat	rot;
+		int32	parent;
+		int32	len;
+		int32	n;
+
+		if ((iend - ip) < 9)
+			break;
+		parent = *ip++;
+		ip = GetFloats(ip, &offset.x, 3);
+		ip = GetFloats(ip, &rot.x, 4);
+		len = *ip++;
+		if ((len <= 0) || (len & 3) || ((iend - ip) < len / 4))
+			break;
+		n = len / sizeof(TCHAR) - 1;
+		if (n >= VX_MaxName)
+			n = VX_MaxName - 1;
+		memcpy(name, ip, n * sizeof(TCHAR));
+		name[n] = 0;
+		ip += len / 4;
+		if (AddBone(name, parent, offset, rot) < 0)
+			break;
+	}
+	for (int32 i = 0; i < nchans; ++i)			// read channels
+	{
+		if ((m_NumBones != nbones) || ((iend - ip) < 2))
+			break;
+		if (AddChannel(ip[0], ip[1]) < 0)
+			break;
+		ip += 2;
+	}
+	if ((m_NumChannels == nchans) && ((iend - ip) >= m_NumWindows + 1))
+	{
+		m_Windows = (int32*) malloc((m_NumWindows + 1) * sizeof(int32));
+		if (m_Windows)
+			memcpy(m_Windows, ip, (m_NumWindows + 1) * sizeof(int32));
+	}
+	free(dir);
+	if (m_Windows == NULL)
+	{
+		Empty();
+		VX_ERROR(("AnimClip::Open ERROR bad directory\n"), false);
+	}
+	for (int32 w = 0; w < m_NumWindows; ++w)	// check window offsets
+	{
+		int32 size = m_Windows[w + 1] - m_Windows[w];
+
+		if ((m_Windows[w] < 0) || (size <= 0))
+		{
+			Empty();
+			VX_ERROR(("AnimClip::Open ERROR bad window %d\n", w), false);
+		}
+		if (size > m_MaxWindowSize)
+			m_MaxWindowSize = size;
+	}
+	m_Stream = in;
+	return AllocWindow();
+}
+
+/*
+ * Reads a window from the stream if necessary and unpacks its keys into a cursor.
+ * Windows of clips in memory are unpacked without locking. Streamed windows
+ * are read into a buffer shared by all the cursors so the stream is locked.
+ */
+bool AnimClip::LoadWindow(int32 w, Cursor& cur)
+{
+	int32	size = m_Windows[w + 1] - m_Windows[w];
+	int32	maxkeys = m_NumChannels * (m_WindowSize + 1);
+
+	cur.Window = -1;
+	if (cur.MaxKeys < maxkeys)
+	{
+		cur.Empty();
+		cur.KeyStart = (int32*) malloc((maxkeys + 1) * sizeof(int32));	// at least 2 keys per channel
+		cur.KeyFrames = (float*) malloc(maxkeys * sizeof(float));
+		cur.KeyVals = (float*) malloc(maxkeys * 4 * sizeof(float));
+		if ((cur.KeyStart == NULL) || (cur.KeyFrames == NULL) || (cur.KeyVals == NULL))
+		{
+			cur.Empty();
+			VX_ERROR(("AnimClip ERROR out of memory for %d keys\n", maxkeys), false);
+		}
+		cur.MaxKeys = maxkeys;
+	}
+	cur.Serial = m_Serial;
+	if (m_Data)
+		return UnpackWindow(w, (const uchar*) m_Data + m_Windows[w], cur);
+
+	Core::Lock lock(m_StreamLock);
+
+	if (m_Stream.IsNull() || (m_WindowData == NULL) ||
+		(m_Stream->Seek(m_DataOffset + m_Windows[w], Core::Stream::SEEK_FROM_START) < 0) ||
+		(m_Stream->Read(m_WindowData, size) != size_t(size)))
+		VX_ERROR(("AnimClip::LoadWindow ERROR cannot read window %d of %s\n", w, GetName()), false);
+	return UnpackWindow(w, (const uchar*) m_WindowData, cur);
+}
+
+/*
+ * Unpacks the keys of a packed window into a cursor.
+ */
+bool AnimClip::UnpackWindow(int32 w, const uchar* ip, Cursor& cur) const
+{
+	const uchar*	iend = ip + (m_Windows[w + 1] - m_Windows[w]);
+	int32			first = w * m_WindowSize;
+	int32			len = m_WindowSize;
+	int32			k = 0;
+	int32			c;
+
+	if (first + len > m_NumFrames - 1)
+		len = m_NumFrames - 1 - first;
+	for (c = 0; c < m_NumChannels; ++c)
+	{
+		const Channel&	chan = m_Channels[c];
+		Vec3			range[2];
+		int32			n;
+
+		cur.KeyStart[c] = k;
+		if (chan.Type == Evaluator::POSITION)
+		{
+			if ((iend - ip) < int32(6 * sizeof(float)))
+				break;
+			memcpy(&range[0].x, ip, 3 * sizeof(float));
+			memcpy(&range[1].x, ip + 3 * sizeof(float), 3 * sizeof(float));
+			ip += 6 * sizeof(float);
+		}
+		if (ip >= iend)
+			break;
+		n = *ip++ + 1;
+		if ((n > len + 1) || ((len > 0) && (n < 2)) || ((len == 0) && (n != 1)) ||
+			((iend - ip) < (n - 2 + CLIP_KeyBytes * n)))
+			break;
+		cur.KeyFrames[k] = 0;
+		for (int32 i = 1; i < n - 1; ++i)
+			cur.KeyFrames[k + i] = float(*ip++);
+		if (n > 1)
+			cur.KeyFrames[k + n - 1] = float(len);
+		for (int32 i = 0; i < n; ++i)
+		{
+			UnpackKey(chan.Type, range, ip, cur.KeyVals + 4 * (k + i));
+			ip += CLIP_KeyBytes;
+		}
+		k += n;
+	}
+	if ((c < m_NumChannels) || (ip != iend))
+		VX_ERROR(("AnimClip::LoadWindow ERROR window %d of %s is corrupted\n", w, GetName()), false);
+	cur.KeyStart[m_NumChannels] = k;
+	cur.Window = w;
+	return true;
+}
+
+/*!
+ * @fn bool AnimClip::Eval(int channel, float t, float* val)
+ * @param channel	index of channel to evaluate
+ * @param t			time in seconds from the start of the clip
+ * @param val		where to store value, 3 floats for positions, 4 for rotations
+ *
+ * Computes the value of a channel using the cursor of the clip.
+ * Clip interpolators for the same clip usually play together so
+ * all of them share this cursor.
+ *
+ * @return \b true if value computed, \b false if time is past the end of the clip
+ *
+ * @see ClipInterp AnimClip::Compress
+ */
+bool AnimClip::Eval(int channel, float t, float* val)
+{
+	ObjectLock	lock(this);
+
+	return Eval(m_Cursor, channel, t, val);
+}
+
+/*!
+ * @fn bool AnimClip::Eval(Cursor& cur, int channel, float t, float* val)
+ * @param cur		cursor with the window of keys last used by this player
+ * @param channel	index of channel to evaluate
+ * @param t			time in seconds from the start of the clip
+ * @param val		where to store value, 3 floats for positions, 4 for rotations
+ *
+ * Computes the value of a channel by interpolating the two keys around
+ * the given time. Positions are linearly interpolated, rotations are
+ * spherically interpolated. If the window containing the time is not
+ * the one in the cursor, it is read and decompressed into the cursor first.
+ * Different threads can evaluate the same clip at the same time
+ * as long as each uses its own cursor.
+ *
+ * @return \b true if value computed, \b false if time is past the end of the clip
+ *
+ * @see BlendTree AnimClip::Compress
+ */
+bool AnimClip::Eval(Cursor& cur, int channel, float t, float* val)
+{
+	float			f;
+	int32			w;
+	int32			lo, hi;
+	const float*	k1;
+	const float*	k2;
+
+	if ((channel < 0) || (channel >= m_NumChannels) || (m_Windows == NULL))
+		return false;
+	if (!(t <= GetDuration()))					// also rejects NaN
+		return false;
+	f = (m_TimeStep > 0) ? t / m_TimeStep : 0.0f;
+	if (f < 0)
+		f = 0;
+	else if (f > m_NumFrames - 1)
+		f = float(m_NumFrames - 1);
+	w = int32(f) / m_WindowSize;
+	if (w >= m_NumWindows)
+		w = m_NumWindows - 1;
+	if (((w != cur.Window) || (cur.Serial != m_Serial)) && !LoadWindow(w, cur))
+		return false;
+	f -= w * m_WindowSize;
+	lo = cur.KeyStart[channel];
+	hi = cur.KeyStart[channel + 1] - 1;
+	while (lo < hi)								// find last key before time
+	{
+		int32 mid = (lo + hi + 1) / 2;
+
+		if (cur.KeyFrames[mid] <= f)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	k1 = cur.KeyVals + 4 * lo;
+	if (m_Channels[channel].Type == Evaluator::ROTATION)
+	{
+		Quat* q = (Quat*) val;
+
+		if (lo < cur.KeyStart[channel + 1] - 1)
+		{
+			k2 = k1 + 4;
+			q->Slerp(*((const Quat*) k1), *((const Quat*) k2),
+					 (f - cur.KeyFrames[lo]) / (cur.KeyFrames[lo + 1] - cur.KeyFrames[lo]));
+		}
+		else
+			q->Set(k1[0], k1[1], k1[2], k1[3]);
+		return true;
+	}
+	if (lo < cur.KeyStart[channel + 1] - 1)
+	{
+		float s = (f - cur.KeyFrames[lo]) / (cur.KeyFrames[lo + 1] - cur.KeyFrames[lo]);
+
+		k2 = k1 + 4;
+		for (int32 i = 0; i < 3; ++i)
+			val[i] = k1[i] + s * (k2[i] - k1[i]);
+	}
+	else
+		memcpy(val, k1, 3 * sizeof(float));
+	return true;
+}
+
+/*!
+ * @fn Skeleton* AnimClip::MakeSkeleton(const TCHAR* filebase, bool interps)
+ * @param filebase	base name of clip file, used as a prefix for engine names
+ * @param interps	\b true to animate the skeleton with clip interpolators
+ *
+ * Makes a skeleton from the bones saved with the clip. Each bone has a
+ * Transformer named <filebase>.<bone>.xform. If requested, each bone gets
+ * a ClipInterp child for each channel that animates it, named like the
+ * interpolators made by the BVH loader. Skeletons animated by a BlendTree
+ * do not need interpolators. The bind pose of the skeleton is the bind pose
+ * of the clip.
+ *
+ * @return skeleton made, NULL on error
+ *
+ * @see AnimClip::ReadAnim BVHLoader::LoadSkel
+ */
+Skeleton* AnimClip::MakeSkeleton(const TCHAR* filebase, bool interps)
+{
+	Core::String	base(filebase);
+	Skeleton*		skel;
+	Ref<Pose>		pose;
+	Transformer**	bones = (Transformer**) alloca(m_NumBones * sizeof(Transformer*));
+	Vec3*			positions = (Vec3*) alloca(m_NumBones * sizeof(Vec3));
+	Quat*			rotations = (Quat*) alloca(m_NumBones * sizeof(Quat));
+
+	if ((m_NumBones <= 0) || (m_Bones[0].Parent >= 0))
+		VX_ERROR(("AnimClip::MakeSkeleton ERROR %s has no root bone\n", filebase), NULL);
+	for (int32 i = 1; i < m_NumBones; ++i)
+		if (m_Bones[i].Parent < 0)
+			VX_ERROR(("AnimClip::MakeSkeleton ERROR %s has more than one root bone\n", filebase), NULL);
+	for (int32 i = 0; i < m_NumBones; ++i)
+	{
+		const Bone&		b = m_Bones[i];
+		Transformer*	bone = new Transformer();
+
+		bone->SetName(base + TEXT('.') + GetBoneName(i) + TEXT(".xform"));
+		bone->SetBoneIndex(i);
+		bone->SetPosition(b.Offset);
+		bone->CalcMatrix();
+		if (b.Parent >= 0)
+		{
+			bone->SetControl(Engine::CONTROL_CHILDREN | Engine::CHILDREN_FIRST);
+			bones[b.Parent]->Append(bone);
+		}
+		bones[i] = bone;
+	}
+	skel = new Skeleton(m_NumBones);
+	skel->SetName(base + TEXT('.') + base + TEXT(".skeleton"));
+	for (int32 i = 0; i < m_NumBones; ++i)
+		skel->SetBoneName(i, GetBoneName(i));
+	skel->Append(bones[0]);
+	skel->FindBones();
+	for (int32 i = 0; i < m_NumBones; ++i)
+	{
+		rotations[i].Set(0, 0, 0, 1);
+		bones[i]->GetTotalTransform()->GetTranslation(positions[i]);
+	}
+	skel->SetBindPose(rotations, positions);
+	pose = new Pose(skel);
+	pose->Copy(skel->GetBindPose());
+	for (int32 i = 0; i < m_NumBones; ++i)
+		pose->SetLocalRotation(i, m_Bones[i].BindRot);
+	pose->Sync();
+	skel->SetBindPose(pose);
+	for (int32 c = 0; interps && (c < m_NumChannels); ++c)
+	{
+		const Channel&	chan = m_Channels[c];
+		Transformer*	bone = bones[chan.Bone];
+		ClipInterp*		interp = new ClipInterp();
+		Core::String	name(bone->GetName());
+
+		if (chan.Type == Evaluator::ROTATION)
+		{
+			name += TEXT(".rot");
+			interp->SetInterpType(Interpolator::SLERP);
+			interp->SetValSize(sizeof(Quat) / sizeof(float));
+		}
+		else
+		{
+			name += TEXT(".pos");
+			interp->SetInterpType(Interpolator::LINEAR);
+			interp->SetValSize(3);
+		}
+		interp->SetName(name);
+		interp->SetDestType(chan.Type);
+		interp->SetClip(this, c);
+		bone->Append(interp);
+	}
+	return skel;
+}
+
+/*!
+ * @fn bool AnimClip::ReadAnim(const TCHAR* filename, Core::Stream* instream, LoadEvent* event)
+ * @param filename	name of clip file to load.
+ * @param instream	stream to use for reading.
+ * @param event		event to initialize if load is successful.
+ *
+ * Called by the loader to load a clip file (.vxa).
+ * Only the clip directory is read here. The object loaded is a
+ * skeleton whose bones are animated by clip interpolators,
+ * just like the skeleton made by loading a BVH file.
+ * The keys are read from the file while the animation plays.
+ *
+ * @return \b true if load was successful, else \b false
+ *
+ * @see Sequencer::Load BVHLoader::ReadAnim FileLoader::SetFileFunc
+ */
+bool AnimClip::ReadAnim(const TCHAR* filename, Core::Stream* instream, LoadEvent* e)
+{
+	Ref<AnimClip>	clip = new AnimClip;
+	LoadSceneEvent*	ev = (LoadSceneEvent*) e;
+	TCHAR			filebase[VX_MaxPath];
+	TCHAR			dir[VX_MaxPath];
+	Skeleton*		skel;
+
+	ev->Code = Event::LOAD_SCENE;
+	Core::Stream::ParseDirectory(filename, filebase, dir);
+	if (!clip->Open(instream))
+		VX_ERROR(("AnimClip: %s ERROR: cannot load clip file\n", filename), false);
+	clip->SetName(Core::String(filebase) + TEXT(".clip"));
+	skel = clip->MakeSkeleton(filebase);
+	if (skel == NULL)
+		return false;
+	ev->Object = skel;
+	VX_TRACE(FileLoader::Debug, ("AnimClip::ReadAnim %s %d frames in %d windows\n",
+			 filename, clip->GetNumFrames(), clip->GetNumWindows()));
+	return true;
+}
+
+ClipInterp::ClipInterp() : Interpolator()
+{
+	m_Channel = -1;
+}
+
+/*!
+ * @fn void ClipInterp::SetClip(AnimClip* clip, int channel)
+ * @param clip		clip to get keys from
+ * @param channel	index of clip channel to interpolate
+ *
+ * Establishes the clip channel this interpolator computes.
+ * The duration of the interpolator is set to the duration of the clip.
+ *
+ * @see AnimClip::Eval Interpolator::SetKeys
+ */
+void ClipInterp::SetClip(AnimClip* clip, int channel)
+{
+	m_Clip = clip;
+	m_Channel = channel;
+	if (clip)
+		SetDuration(clip->GetDuration());
+}
+
+int ClipInterp::GetSize() const
+{
+	if (m_Clip.IsNull())
+		return Interpolator::GetSize();
+	return m_Clip->GetNumFrames();
+}
+
+float ClipInterp::GetTime(int i) const
+{
+	if (m_Clip.IsNull())
+		return Interpolator::GetTime(i);
+	return (i < 0) ? 0.0f : i * m_Clip->GetTimeStep();
+}
+
+bool ClipInterp::Copy(const SharedObj* srcobj)
+{
+	ObjectLock dlock(this);
+	ObjectLock slock(srcobj);
+	if (!Interpolator::Copy(srcobj))
+		return false;
+
+	if (srcobj->IsClass(VX_ClipInterp))
+	{
+		const ClipInterp* src = (const ClipInterp*) srcobj;
+		m_Clip = src->m_Clip;
+		m_Channel = src->m_Channel;
+	}
+	return true;
+}
+
+/*!
+ * @fn const float* ClipInterp::ComputeValue(float t)
+ *
+ * Gets the value of the clip channel at the given time and
+ * blends it with the destination. Rotations are blended
+ * as quaternions, positions linearly.
+ * Without a clip, the keys of the interpolator are used.
+ *
+ * @see AnimClip::Eval Interpolator::ComputeValue
+ */
+const float* ClipInterp::ComputeValue(float t)
+{
+	float	val[4];
+
+	if (m_Clip.IsNull())
+		return Interpolator::ComputeValue(t);
+	if (!m_Clip->Eval(m_Channel, t, val))
+		return NULL;
+	Engine *par = (Engine*) Parent();
+	if (par)
+		par->SetChanged(true);
+	if ((m_InterpType == SLERP) || (m_InterpType == QSTEP))
+		QuatBlend((const Quat*) val);
+	else
+		BlendEval(val);
+	return NULL;
+}
+
+}	// end Vixen
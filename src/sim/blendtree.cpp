@@ -0,0 +1,941 @@
+#include "vixen.h"
+#ifndef _WIN32
+#include <sched.h>
+#endif
+
+namespace Vixen {
+
+VX_IMPLEMENT_CLASSID(BlendTree, Engine, VX_BlendTree);
+VX_IMPLEMENT_CLASSID(BlendGroup, Engine, VX_BlendGroup);
+
+int32	BlendGroup::NumThreads = 4;
+
+/*
+ * Interpolates between two arrays of quaternions by a weight for each bone.
+ * Each quaternion is flipped to the hemisphere of the first one and the
+ * result is normalized.
+ */
+static void BlendRotations(float* dst, const float* a, const float* b, float weight, const float* mask, int32 n, int32 pitch)
+{
+	float*			dx = dst;
+	float*			dy = dst + pitch;
+	float*			dz = dst + 2 * pitch;
+	float*			dw = dst + 3 * pitch;
+	const float*	ax = a;
+	const float*	ay = a + pitch;
+	const float*	az = a + 2 * pitch;
+	const float*	aw = a + 3 * pitch;
+	const float*	bx = b;
+	const float*	by = b + pitch;
+	const float*	bz = b + 2 * pitch;
+	const float*	bw = b + 3 * pitch;
+
+	for (int32 i = 0; i < n; ++i)
+	{
+		float	t = mask ? weight * mask[i] : weight;
+		float	d = ax[i] * bx[i] + ay[i] * by[i] + az[i] * bz[i] + aw[i] * bw[i];
+		float	s = (d < 0) ? -t : t;
+		float	u = 1.0f - t;
+		float	x = u * ax[i] + s * bx[i];
+		float	y = u * ay[i] + s * by[i];
+		float	z = u * az[i] + s * bz[i];
+		float	w = u * aw[i] + s * bw[i];
+		float	len = x * x + y * y + z * z + w * w;
+
+		len = (len > 0) ? (1.0f / sqrtf(len)) : 0.0f;
+		dx[i] = x * len;
+		dy[i] = y * len;
+		dz[i] = z * len;
+		dw[i] = w * len;
+	}
+}
+
+BlendTree::BlendTree() : Engine()
+{
+	m_Nodes = NULL;
+	m_NumNodes = 0;
+	m_MaxNodes = 0;
+	m_Output = -1;
+	m_NumBones = 0;
+	m_Pitch = 0;
+	m_Rotations = NULL;
+	m_BindRots = NULL;
+	m_NeedBind = true;
+	m_Valid = false;
+}
+
+BlendTree::~BlendTree()
+{
+	FreeNodes();
+}
+
+/*
+ * Frees the nodes and the pose buffers.
+ */
+void BlendTree::FreeNodes()
+{
+	for (int32 i = 0; i < m_NumNodes; ++i)
+	{
+		Node& node = m_Nodes[i];
+
+		if (node.Source)
+			node.Source->Delete();
+		if (node.Cursor)
+			delete node.Cursor;
+		if (node.BoneMap)
+			free(node.BoneMap);
+		if (node.Mask)
+			free(node.Mask);
+	}
+	if (m_Nodes)
+		free(m_Nodes);
+	if (m_Rotations)
+		free(m_Rotations);
+	if (m_BindRots)
+		free(m_BindRots);
+	m_Nodes = NULL;
+	m_NumNodes = m_MaxNodes = 0;
+	m_Rotations = NULL;
+	m_BindRots = NULL;
+	m_NumBones = m_Pitch = 0;
+	m_Output = -1;
+	m_NeedBind = true;
+	m_Valid = false;
+}
+
+/*!
+ * @fn void BlendTree::SetTarget(SharedObj* target)
+ * @param target	skeleton to pose
+ *
+ * The target of a blend tree must be a Skeleton.
+ * The bones of the clips are matched to the skeleton bones
+ * by name the next time the tree is evaluated.
+ *
+ * @see BlendTree::AddClip Skeleton::GetBoneIndex
+ */
+void BlendTree::SetTarget(SharedObj* target)
+{
+	if (target && !target->IsClass(VX_Skeleton))
+		VX_ERROR_RETURN(("BlendTree::SetTarget ERROR target must be a skeleton\n"));
+	ObjectLock lock(this);
+	Engine::SetTarget(target);
+	m_NeedBind = true;
+	m_Valid = false;
+}
+
+/*
+ * Adds a node of the given type and references its source.
+ * Returns the index of the new node, -1 on error.
+ */
+int BlendTree::AddNode(int type, SharedObj* source)
+{
+	ObjectLock	lock(this);
+	Node*		node;
+
+	if (m_NumNodes >= m_MaxNodes)
+	{
+		int32	n = m_MaxNodes ? (m_MaxNodes * 2) : 8;
+		Node*	nodes = (Node*) realloc(m_Nodes, n * sizeof(Node));
+
+		if (nodes == NULL)
+			VX_ERROR(("BlendTree::AddNode ERROR out of memory\n"), -1);
+		m_Nodes = nodes;
+		m_MaxNodes = n;
+	}
+	node = &m_Nodes[m_NumNodes];
+	memset(node, 0, sizeof(Node));
+	node->Type = type;
+	node->Input[0] = node->Input[1] = node->Input[2] = -1;
+	node->Weight = 1.0f;
+	node->Speed = 1.0f;
+	node->Source = source;
+	if (source)
+		source->IncUse();
+	m_NeedBind = true;
+	return m_NumNodes++;
+}
+
+/*!
+ * @fn int BlendTree::AddClip(AnimClip* clip, float speed, float timeofs, bool cycle)
+ * @param clip		clip to sample
+ * @param speed		scale factor applied to the time of the tree
+ * @param timeofs	time in the clip when the tree starts
+ * @param cycle		\b true to repeat the clip, else it stops at the last frame
+ *
+ * Adds a node which samples an animation clip at the time of the tree
+ * multiplied by the speed plus the time offset. The rotation channels of
+ * the clip set the local rotations of the skeleton bones with the same name.
+ * A position channel for the root bone sets the root position.
+ * Bones the clip does not animate keep their bind pose rotation.
+ *
+ * @return index of the new node, -1 on error
+ *
+ * @see BlendTree::SetClipTime AnimClip::Eval
+ */
+int BlendTree::AddClip(AnimClip* clip, float speed, float timeofs, bool cycle)
+{
+	int		i;
+
+	if (clip == NULL)
+		VX_ERROR(("BlendTree::AddClip ERROR no clip\n"), -1);
+	if ((i = AddNode(CLIP, clip)) < 0)
+		return -1;
+	m_Nodes[i].Cursor = new AnimClip::Cursor;
+	m_Nodes[i].Speed = speed;
+	m_Nodes[i].TimeOfs = timeofs;
+	m_Nodes[i].Cycle = cycle;
+	return i;
+}
+
+/*!
+ * @fn int BlendTree::AddPose(Pose* pose)
+ * @param pose	pose to copy, must have the same bones as the skeleton
+ *
+ * Adds a node which copies the local rotations and root position
+ * of a pose. This is useful as a reference for additive blending
+ * or to hold a pose computed by another engine.
+ *
+ * @return index of the new node, -1 on error
+ */
+int BlendTree::AddPose(Pose* pose)
+{
+	if (pose == NULL)
+		VX_ERROR(("BlendTree::AddPose ERROR no pose\n"), -1);
+	return AddNode(POSE, pose);
+}
+
+/*!
+ * @fn int BlendTree::AddLerp(int src1, int src2, float weight)
+ * @param src1		node to blend from
+ * @param src2		node to blend to
+ * @param weight	0 gives the pose of \b src1, 1 gives the pose of \b src2
+ *
+ * Adds a node which interpolates the local rotations and root positions
+ * of two nodes. A locomotion blend between walk and run clips is a lerp
+ * whose weight follows the speed of the character.
+ *
+ * @return index of the new node, -1 on error
+ *
+ * @see BlendTree::SetWeight BlendTree::AddLayer
+ */
+int BlendTree::AddLerp(int src1, int src2, float weight)
+{
+	int		i;
+
+	if ((src1 < 0) || (src1 >= m_NumNodes) || (src2 < 0) || (src2 >= m_NumNodes))
+		VX_ERROR(("BlendTree::AddLerp ERROR bad input node\n"), -1);
+	if ((i = AddNode(LERP, NULL)) < 0)
+		return -1;
+	m_Nodes[i].Input[0] = src1;
+	m_Nodes[i].Input[1] = src2;
+	m_Nodes[i].Weight = weight;
+	return i;
+}
+
+/*!
+ * @fn int BlendTree::AddAdditive(int base, int add, int ref, float weight)
+ * @param base		node to add to
+ * @param add		node with the pose to add
+ * @param ref		node with the reference pose subtracted from \b add
+ * @param weight	how much of the difference to add
+ *
+ * Adds a node which computes the rotation of each bone relative to the
+ * reference pose and applies it on top of the base pose. The root position
+ * is offset by the difference between the additive and reference positions.
+ * With a weight of 0 the result is the base pose.
+ *
+ * @return index of the new node, -1 on error
+ */
+int BlendTree::AddAdditive(int base, int add, int ref, float weight)
+{
+	int		i;
+
+	if ((base < 0) || (base >= m_NumNodes) ||
+		(add < 0) || (add >= m_NumNodes) ||
+		(ref < 0) || (ref >= m_NumNodes))
+		VX_ERROR(("BlendTree::AddAdditive ERROR bad input node\n"), -1);
+	if ((i = AddNode(ADDITIVE, NULL)) < 0)
+		return -1;
+	m_Nodes[i].Input[0] = base;
+	m_Nodes[i].Input[1] = add;
+	m_Nodes[i].Input[2] = ref;
+	m_Nodes[i].Weight = weight;
+	return i;
+}
+
+/*!
+ * @fn int BlendTree::AddLayer(int base, int layer, float weight)
+ * @param base		node with the pose of the bones not masked
+ * @param layer		node with the pose of the masked bones
+ * @param weight	weight of the layer
+ *
+ * Adds a node which replaces some of the bones of the base pose with the
+ * bones of the layer pose. The mask gives the weight of the layer for each
+ * bone. Initially all the bones are masked, use BlendTree::SetMask to
+ * restrict the layer to a branch like the upper body.
+ *
+ * @return index of the new node, -1 on error
+ *
+ * @see BlendTree::SetMask BlendTree::AddLerp
+ */
+int BlendTree::AddLayer(int base, int layer, float weight)
+{
+	int		i;
+
+	if ((base < 0) || (base >= m_NumNodes) || (layer < 0) || (layer >= m_NumNodes))
+		VX_ERROR(("BlendTree::AddLayer ERROR bad input node\n"), -1);
+	if ((i = AddNode(LAYER, NULL)) < 0)
+		return -1;
+	m_Nodes[i].Input[0] = base;
+	m_Nodes[i].Input[1] = layer;
+	m_Nodes[i].Weight = weight;
+	return i;
+}
+
+/*!
+ * @fn bool BlendTree::SetMask(int node, int bone, float weight, bool branch)
+ * @param node		index of layer node
+ * @param bone		index of skeleton bone
+ * @param weight	weight of the layer for the bone, between 0 and 1
+ * @param branch	\b true to set the weight of all the descendants of the bone too
+ *
+ * Sets the layer weight of a bone. For example, to layer a wave
+ * on the upper body only, set the mask of the root to 0
+ * and then the mask of the torso to 1.
+ * The tree must have a skeleton target.
+ *
+ * @return \b true if mask was set, \b false on error
+ *
+ * @see BlendTree::AddLayer Skeleton::GetBoneIndex
+ */
+bool BlendTree::SetMask(int node, int bone, float weight, bool branch)
+{
+	ObjectLock	lock(this);
+	Skeleton*	skel = (Skeleton*) GetTarget();
+
+	if ((node < 0) || (node >= m_NumNodes) || (m_Nodes[node].Type != LAYER))
+		VX_ERROR(("BlendTree::SetMask ERROR %d is not a layer node\n", node), false);
+	if (skel == NULL)
+		VX_ERROR(("BlendTree::SetMask ERROR no skeleton\n"), false);
+	if (m_NeedBind && !Bind())
+		return false;
+	if ((bone < 0) || (bone >= m_NumBones))
+		VX_ERROR(("BlendTree::SetMask ERROR bad bone %d\n", bone), false);
+	for (int32 b = 0; b < m_NumBones; ++b)
+	{
+		int32	p = b;
+
+		while ((p != bone) && (p >= 0) && branch)
+			p = skel->GetParentBoneIndex(p);
+		if (p == bone)
+			m_Nodes[node].Mask[b] = weight;
+	}
+	return true;
+}
+
+void BlendTree::SetOutput(int node)
+{
+	VX_ASSERT(node < m_NumNodes);
+	m_Output = node;
+}
+
+void BlendTree::SetWeight(int node, float weight)
+{
+	VX_ASSERT((node >= 0) && (node < m_NumNodes));
+	m_Nodes[node].Weight = weight;
+}
+
+void BlendTree::SetClipTime(int node, float speed, float timeofs)
+{
+	VX_ASSERT((node >= 0) && (node < m_NumNodes));
+	m_Nodes[node].Speed = speed;
+	m_Nodes[node].TimeOfs = timeofs;
+}
+
+/*
+ * Allocates the pose buffers for the skeleton, gets its bind pose
+ * and maps the channels of the clips onto its bones.
+ */
+bool BlendTree::Bind()
+{
+	Skeleton*	skel = (Skeleton*) GetTarget();
+	const Pose*	bind;
+	int32		nb, pitch;
+	float*		rots;
+	float*		bindrots;
+
+	m_Valid = false;
+	if ((skel == NULL) || ((nb = skel->GetNumBones()) <= 0))
+		return false;
+	pitch = (nb + 3) & ~3;
+	rots = (float*) realloc(m_Rotations, (m_NumNodes ? m_NumNodes : 1) * 4 * pitch * sizeof(float));
+	if (rots == NULL)
+		VX_ERROR(("BlendTree::Bind ERROR out of memory\n"), false);
+	m_Rotations = rots;
+	bindrots = (float*) realloc(m_BindRots, 4 * pitch * sizeof(float));
+	if (bindrots == NULL)
+		VX_ERROR(("BlendTree::Bind ERROR out of memory\n"), false);
+	m_BindRots = bindrots;
+	memset(bindrots, 0, 4 * pitch * sizeof(float));
+	bind = skel->GetBindPose();
+	for (int32 b = 0; b < nb; ++b)
+	{
+		Quat	q(0, 0, 0, 1);
+
+		if (bind)
+			q = bind->GetLocalRotation(b);
+		bindrots[b] = q.x;
+		bindrots[pitch + b] = q.y;
+		bindrots[2 * pitch + b] = q.z;
+		bindrots[3 * pitch + b] = q.w;
+	}
+	for (int32 i = 0; i < m_NumNodes; ++i)
+	{
+		Node&	node = m_Nodes[i];
+
+		if (node.Type == LAYER)
+		{
+			float*	mask = node.Mask;
+
+			if ((mask == NULL) || (nb != m_NumBones))
+			{
+				if ((mask = (float*) realloc(mask, nb * sizeof(float))) == NULL)
+					VX_ERROR(("BlendTree::Bind ERROR out of memory\n"), false);
+				for (int32 b = 0; b < nb; ++b)
+					mask[b] = 1.0f;
+				node.Mask = mask;
+			}
+		}
+		else if (node.Type == CLIP)
+		{
+			AnimClip*	clip = (AnimClip*) node.Source;
+			int32		nc = clip->GetNumChannels();
+			int32*		map = (int32*) realloc(node.BoneMap, (nc ? nc : 1) * sizeof(int32));
+
+			if (map == NULL)
+				VX_ERROR(("BlendTree::Bind ERROR out of memory\n"), false);
+			node.BoneMap = map;
+			for (int32 c = 0; c < nc; ++c)
+			{
+				int32	b = skel->GetBoneIndex(clip->GetBoneName(clip->GetChannelBone(c)));
+
+				if ((clip->GetChannelType(c) == Evaluator::POSITION) && (b != 0))
+					b = -1;
+				map[c] = b;
+			}
+		}
+	}
+	m_NumBones = nb;
+	m_Pitch = pitch;
+	m_NeedBind = false;
+	return true;
+}
+
+/*
+ * Samples the clip of a node. Bones the clip does not animate
+ * get their bind pose rotations.
+ */
+void BlendTree::EvalClip(Node& node, float t, float* rots)
+{
+	AnimClip*	clip = (AnimClip*) node.Source;
+	float		dur = clip->GetDuration();
+	float		ct = node.TimeOfs + t * node.Speed;
+	float		val[4];
+
+	memcpy(rots, m_BindRots, 4 * m_Pitch * sizeof(float));
+	node.HasRoot = false;
+	if (node.Cycle && (dur > 0))
+	{
+		ct = fmodf(ct, dur);
+		if (ct < 0)
+			ct += dur;
+	}
+	else if (ct > dur)
+		ct = dur;
+	if (!(ct >= 0))				// also rejects NaN
+		ct = 0;
+	for (int32 c = 0; c < clip->GetNumChannels(); ++c)
+	{
+		int32	b = node.BoneMap[c];
+
+		if (b < 0)
+			continue;
+		if (!clip->Eval(*node.Cursor, c, ct, val))
+			continue;
+		if (clip->GetChannelType(c) == Evaluator::POSITION)
+		{
+			node.Root.Set(val[0], val[1], val[2]);
+			node.HasRoot = true;
+			continue;
+		}
+		rots[b] = val[0];
+		rots[m_Pitch + b] = val[1];
+		rots[2 * m_Pitch + b] = val[2];
+		rots[3 * m_Pitch + b] = val[3];
+	}
+}
+
+/*
+ * Copies the local rotations and root position of a pose.
+ */
+void BlendTree::CopyPose(Node& node, float* rots)
+{
+	const Pose*	pose = (const Pose*) node.Source;
+	ObjectLock	lock(pose);
+	int32		nb = pose->GetNumBones();
+
+	memcpy(rots, m_BindRots, 4 * m_Pitch * sizeof(float));
+	if (nb > m_NumBones)
+		nb = m_NumBones;
+	for (int32 b = 0; b < nb; ++b)
+	{
+		const Quat&	q = pose->GetLocalRotation(b);
+
+		rots[b] = q.x;
+		rots[m_Pitch + b] = q.y;
+		rots[2 * m_Pitch + b] = q.z;
+		rots[3 * m_Pitch + b] = q.w;
+	}
+	node.HasRoot = (nb > 0);
+	if (node.HasRoot)
+		node.Root = pose->GetLocalPosition(0);
+}
+
+/*
+ * Interpolates between the first two inputs of a node,
+ * optionally weighting each bone by a mask.
+ */
+void BlendTree::EvalLerp(Node& node, float* rots, const float* mask)
+{
+	const Node&	a = m_Nodes[node.Input[0]];
+	const Node&	b = m_Nodes[node.Input[1]];
+	float		w = node.Weight;
+
+	BlendRotations(rots, GetRotations(node.Input[0]), GetRotations(node.Input[1]), w, mask, m_NumBones, m_Pitch);
+	if (mask)
+		w *= mask[0];
+	node.HasRoot = a.HasRoot || b.HasRoot;
+	if (a.HasRoot && b.HasRoot)
+		node.Root = a.Root + (b.Root - a.Root) * w;
+	else if (a.HasRoot)
+		node.Root = a.Root;
+	else if (b.HasRoot)
+		node.Root = b.Root;
+}
+
+/*
+ * Applies the difference between the additive and reference inputs
+ * to the base input. The difference is scaled toward the identity
+ * rotation by the weight of the node.
+ */
+void BlendTree::EvalAdditive(Node& node, float* rots)
+{
+	const Node&		base = m_Nodes[node.Input[0]];
+	const Node&		add = m_Nodes[node.Input[1]];
+	const Node&		ref = m_Nodes[node.Input[2]];
+	const float*	b = GetRotations(node.Input[0]);
+	const float*	a = GetRotations(node.Input[1]);
+	const float*	r = GetRotations(node.Input[2]);
+	float			w = node.Weight;
+	int32			p = m_Pitch;
+
+	for (int32 i = 0; i < m_NumBones; ++i)
+	{
+		Quat	q(-r[i], -r[p + i], -r[2 * p + i], r[3 * p + i]);
+		Quat	d;
+		float	len;
+
+		d.Mul(q, Quat(a[i], a[p + i], a[2 * p + i], a[3 * p + i]));
+		if (d.w < 0)
+		{
+			d.x = -d.x; d.y = -d.y; d.z = -d.z; d.w = -d.w;
+		}
+		d.x *= w;
+		d.y *= w;
+		d.z *= w;
+		d.w = 1.0f - w + w * d.w;
+		len = d.x * d.x + d.y * d.y + d.z * d.z + d.w * d.w;
+		len = (len > 0) ? (1.0f / sqrtf(len)) : 0.0f;
+		d.x *= len; d.y *= len; d.z *= len; d.w *= len;
+		q.Mul(Quat(b[i], b[p + i], b[2 * p + i], b[3 * p + i]), d);
+		rots[i] = q.x;
+		rots[p + i] = q.y;
+		rots[2 * p + i] = q.z;
+		rots[3 * p + i] = q.w;
+	}
+	node.HasRoot = base.HasRoot;
+	node.Root = base.Root;
+	if (base.HasRoot && add.HasRoot && ref.HasRoot)
+		node.Root += (add.Root - ref.Root) * w;
+}
+
+/*!
+ * @fn bool BlendTree::EvalPose(float t)
+ * @param t	time of the tree in seconds
+ *
+ * Computes the pose of every node in the order they were added.
+ * The skeleton is not changed, call BlendTree::ApplyPose to pose it.
+ * This function only changes the blend tree, so different trees
+ * may be evaluated at the same time by different threads.
+ *
+ * @return \b true if the pose was computed, \b false if the tree is empty or has no skeleton
+ *
+ * @see BlendTree::ApplyPose BlendGroup
+ */
+bool BlendTree::EvalPose(float t)
+{
+	m_Valid = false;
+	if (m_NeedBind && !Bind())
+		return false;
+	if (m_NumNodes == 0)
+		return false;
+	for (int32 i = 0; i < m_NumNodes; ++i)
+	{
+		Node&	node = m_Nodes[i];
+		float*	rots = GetRotations(i);
+
+		switch (node.Type)
+		{
+			case CLIP:
+			EvalClip(node, t, rots);
+			break;
+
+			case POSE:
+			CopyPose(node, rots);
+			break;
+
+			case LERP:
+			EvalLerp(node, rots, NULL);
+			break;
+
+			case LAYER:
+			EvalLerp(node, rots, node.Mask);
+			break;
+
+			case ADDITIVE:
+			EvalAdditive(node, rots);
+			break;
+		}
+	}
+	m_Valid = true;
+	return true;
+}
+
+/*!
+ * @fn void BlendTree::ApplyPose()
+ *
+ * Sets the rotations of the skeleton bones to the pose computed by the
+ * output node. The root position is set if the output node computed one.
+ * The bones are animated through their transformers, the way clip
+ * interpolators animate them, and the skeleton updates its pose from them.
+ * Bones without a transformer are set in the skeleton pose directly.
+ *
+ * @see BlendTree::EvalPose Skeleton::Eval
+ */
+void BlendTree::ApplyPose()
+{
+	Skeleton*	skel = (Skeleton*) GetTarget();
+	int32		out = GetOutput();
+	Pose*		pose;
+	const float* rots;
+
+	if (!m_Valid || (skel == NULL) || (out < 0) || (skel->GetNumBones() != m_NumBones))
+		return;
+	pose = skel->GetPose();
+	rots = GetRotations(out);
+	for (int32 b = 0; b < m_NumBones; ++b)
+	{
+		Quat			q(rots[b], rots[m_Pitch + b], rots[2 * m_Pitch + b], rots[3 * m_Pitch + b]);
+		Transformer*	bone = skel->GetBone(b);
+
+		if (bone)
+		{
+			ObjectLock lock(bone);
+			bone->SetRotation(q);
+			if ((b == 0) && m_Nodes[out].HasRoot)
+				bone->SetPosition(m_Nodes[out].Root);
+		}
+		else if (pose)
+		{
+			ObjectLock lock(pose);
+			pose->SetLocalRotation(b, q);
+			if ((b == 0) && m_Nodes[out].HasRoot)
+				pose->SetPosition(m_Nodes[out].Root + skel->GetRootOffset());
+		}
+	}
+}
+
+/*!
+ * @fn bool BlendTree::GetLocalRotation(int bone, Quat& rot) const
+ * @param bone	index of skeleton bone
+ * @param rot	where to store the rotation
+ *
+ * Gets the local rotation of a bone computed by the output node
+ * during the last evaluation.
+ *
+ * @return \b true if rotation was returned, \b false if the pose was not computed
+ */
+bool BlendTree::GetLocalRotation(int bone, Quat& rot) const
+{
+	int32	out = GetOutput();
+
+	if (!m_Valid || (out < 0) || (bone < 0) || (bone >= m_NumBones))
+		return false;
+	const float* rots = GetRotations(out);
+	rot.Set(rots[bone], rots[m_Pitch + bone], rots[2 * m_Pitch + bone], rots[3 * m_Pitch + bone]);
+	return true;
+}
+
+/*!
+ * @fn bool BlendTree::Eval(float t)
+ * @param t	time of the tree in seconds
+ *
+ * Computes the pose of the tree and applies it to the skeleton.
+ * Trees below a BlendGroup are evaluated by the group instead.
+ *
+ * @see BlendTree::EvalPose BlendTree::ApplyPose
+ */
+bool BlendTree::Eval(float t)
+{
+	if (EvalPose(t))
+		ApplyPose();
+	return true;
+}
+
+#ifndef VX_NOTHREAD
+/*
+ * Thread which evaluates the blend trees of a blend group.
+ * It polls for new work, spinning for a while before sleeping.
+ */
+class BlendThread : public Core::Thread
+{
+public:
+	BlendThread(BlendGroup* group) : Core::Thread(0), Group(group), Generation(group->m_Generation), DoExit(0) { }
+
+	static Core::ThreadFunc	BlendFunc;
+
+	BlendGroup*	Group;		// group to evaluate trees for
+	int32		Generation;	// last set of jobs seen
+	vint32		DoExit;		// set to make thread exit
+};
+
+#if defined(_WIN32) && !defined(VX_PTHREAD)
+void BlendThread::BlendFunc(void* arg)
+#else
+void* BlendThread::BlendFunc(void* arg)
+#endif
+{
+	VX_ASSERT(arg);
+	BlendThread&	thread = *((BlendThread*) arg);
+	BlendGroup*		group = thread.Group;
+	int32			spins = 0;
+
+	while (!Core::InterlockGet(&thread.DoExit))
+	{
+		int32 gen = Core::InterlockGet(&group->m_Generation);
+
+		if (gen != thread.Generation)
+		{
+			thread.Generation = gen;
+			group->RunJobs();
+			spins = 0;
+		}
+		else if (++spins < BLEND_SpinCount)
+#ifdef _WIN32
+			::Sleep(0);
+#else
+			sched_yield();
+#endif
+		else
+		{
+#ifdef _WIN32
+			::Sleep(1);
+#else
+			usleep(1000);
+#endif
+		}
+	}
+	thread.Stop();
+#if !defined(_WIN32) || defined(VX_PTHREAD)
+	return NULL;
+#endif
+}
+#endif
+
+BlendGroup::BlendGroup() : Engine()
+{
+	m_Jobs = NULL;
+	m_MaxJobs = 0;
+	m_NumJobs = 0;
+	m_NextJob = 0;
+	m_NumDone = 0;
+	m_Generation = 0;
+	m_NumThreads = 0;
+	for (int32 t = 0; t < BLEND_MaxThreads; ++t)
+		m_Threads[t] = NULL;
+}
+
+BlendGroup::~BlendGroup()
+{
+	StopThreads();
+	if (m_Jobs)
+		free(m_Jobs);
+}
+
+/*
+ * Starts worker threads until there are n of them.
+ */
+bool BlendGroup::StartThreads(int32 n)
+{
+#ifdef VX_NOTHREAD
+	return false;
+#else
+	if (n > BLEND_MaxThreads)
+		n = BLEND_MaxThreads;
+	while (m_NumThreads < n)
+	{
+		BlendThread* thread = new BlendThread(this);
+
+		thread->Run(&BlendThread::BlendFunc);
+		if (!thread->IsRunning())
+		{
+			delete thread;
+			VX_ERROR(("BlendGroup: ERROR cannot start blend thread\n"), false);
+		}
+		m_Threads[m_NumThreads++] = thread;
+	}
+	return true;
+#endif
+}
+
+/*
+ * Stops the worker threads and waits for them to exit.
+ */
+void BlendGroup::StopThreads()
+{
+#ifndef VX_NOTHREAD
+	for (int32 t = 0; t < m_NumThreads; ++t)
+		Core::InterlockSet(&(m_Threads[t]->DoExit), 1);
+	for (int32 t = 0; t < m_NumThreads; ++t)
+	{
+		BlendThread* thread = m_Threads[t];
+
+		if (thread->IsRunning())
+			thread->GetDoneEvent()->Wait();
+		delete thread;
+		m_Threads[t] = NULL;
+	}
+	m_NumThreads = 0;
+#endif
+}
+
+/*
+ * Evaluates blend tree poses until all the jobs of this frame
+ * have been claimed. Called by the simulation thread and the workers.
+ */
+void BlendGroup::RunJobs()
+{
+	int32	n;
+
+	while ((n = Core::InterlockGet(&m_NextJob)) < Core::InterlockGet(&m_NumJobs))
+	{
+		if (!Core::InterlockTestSet(&m_NextJob, n + 1, n))
+			continue;						// another thread got it
+		m_Jobs[n].Tree->EvalPose(m_Jobs[n].Time);
+		Core::InterlockInc(&m_NumDone);
+	}
+}
+
+/*!
+ * @fn void BlendGroup::ComputeChildren(float t, int filter)
+ * @param t			current time
+ * @param filter	class ID of children to evaluate, 0 for all
+ *
+ * Evaluates the poses of the BlendTree children in parallel, then applies
+ * them to their skeletons and computes the rest of the children in order.
+ * The simulation thread evaluates poses too and only waits for poses
+ * other threads have started, so a group is never slower than evaluating
+ * the trees one after the other.
+ *
+ * Note: This function does no locking. It is designed to be called
+ * during simulation tree traversal.
+ *
+ * @see BlendGroup::NumThreads Engine::ComputeChildren BlendTree::EvalPose
+ */
+void BlendGroup::ComputeChildren(float t, int filter)
+{
+	GroupIterNotSafe<Engine> iter(this, Group::CHILDREN);
+	Engine*	g;
+	int32	n = 0;
+
+	Core::InterlockSet(&m_NumJobs, 0);
+	while (g = iter.Next())			// compute blend tree times
+	{
+		if (!g->IsClass(VX_BlendTree))
+			continue;
+		if ((filter > 0) && !g->IsClass(filter))
+			continue;
+		if ((filter < 0) && g->IsClass(-filter))
+			continue;
+
+		float evalt = g->ComputeTime(t);
+
+		if (evalt < 0)
+			continue;
+		if (n >= m_MaxJobs)
+		{
+			int32	maxjobs = m_MaxJobs ? (m_MaxJobs * 2) : 64;
+			Job*	jobs = (Job*) realloc(m_Jobs, maxjobs * sizeof(Job));
+
+			if (jobs == NULL)
+				break;
+			m_Jobs = jobs;
+			m_MaxJobs = maxjobs;
+		}
+		m_Jobs[n].Tree = (BlendTree*) g;
+		m_Jobs[n].Time = evalt;
+		++n;
+	}
+	if (n > 0)
+	{
+		int32 nthreads = NumThreads - 1;
+
+		if (nthreads > n - 1)
+			nthreads = n - 1;
+		if (nthreads > m_NumThreads)
+			StartThreads(nthreads);
+		Core::InterlockSet(&m_NumDone, 0);
+		Core::InterlockSet(&m_NextJob, 0);
+		Core::InterlockSet(&m_NumJobs, n);
+		Core::InterlockInc(&m_Generation);	// wake up the workers
+		RunJobs();
+		while (Core::InterlockGet(&m_NumDone) < n)
+#ifdef _WIN32
+			::Sleep(0);
+#else
+			sched_yield();
+#endif
+		Core::InterlockSet(&m_NumJobs, 0);
+		for (int32 i = 0; i < n; ++i)		// apply poses serially
+		{
+			BlendTree* tree = m_Jobs[i].Tree;
+
+			tree->ApplyPose();
+			if (tree->IsParent())
+				tree->ComputeChildren(t);
+		}
+	}
+	iter.Reset(Group::CHILDREN);
+	while (g = iter.Next())			// other engines run serially
+	{
+		if (g->IsClass(VX_BlendTree))
+			continue;
+		if ((filter > 0) && !g->IsClass(filter))
+			continue;
+		if ((filter < 0) && g->IsClass(-filter))
+			continue;
+		g->Compute(t);
+	}
+}
+
+}	// end Vixen
@@ -329,6 +329,93 @@ bool BVHLoader::LoadKeys()
 	return true;
 }
 
+/*!
+ * @fn bool BVHLoader::LoadClip(AnimClip* clip)
+ * @param clip	empty clip to get the skeleton and compressed keys
+ *
+ * Reads the rest of the BVH motion data and compresses it into
+ * an animation clip instead of making interpolators.
+ * The skeleton and bind pose must already be loaded with
+ * LoadSkel and LoadKeyAsPose. The clip gets a position channel
+ * for the root bone and a rotation channel for every bone.
+ *
+ * @return \b true if the clip was compressed, else \b false
+ *
+ * @see AnimClip::Compress BVHLoader::LoadKeys
+ */
+bool BVHLoader::LoadClip(AnimClip* clip)
+{
+	int		numbones = m_Skeleton->GetNumBones();
+	int		numchannels = (numbones + 1) * 3;
+	int		framesize = 3 + 4 * numbones;
+	float*	data = (float*) alloca(numchannels * sizeof(float));
+	float*	samples = NULL;
+	int		maxframes = 0;
+	int		nframes = 0;
+	int		nkeys;
+	bool	rc;
+
+	VX_ASSERT(m_Pose);
+	for (int i = 0; i < numbones; ++i)
+	{
+		Transformer*	bone = m_Skeleton->GetBone(i);
+		Vec3			offset(0, 0, 0);
+
+		if (bone)
+			offset = bone->GetPosition();
+		if (clip->AddBone(m_Skeleton->GetBoneName(i), m_Skeleton->GetParentBoneIndex(i),
+						  offset, m_Pose->GetLocalRotation(i)) < 0)
+			return false;
+	}
+	clip->AddChannel(0, Evaluator::POSITION);
+	for (int i = 0; i < numbones; ++i)
+		clip->AddChannel(i, Evaluator::ROTATION);
+	while (nkeys = ReadKeys(data, numchannels))
+	{
+		float*	fp = data;
+		float*	op;
+
+		if (nkeys != numchannels)
+		{	VX_WARNING(("BVHLoader: Warning %d channels requested, %d keys read", numchannels, nkeys)); }
+		if (nframes >= maxframes)
+		{
+			maxframes = (m_NumFrames > 2 * maxframes) ? m_NumFrames : 2 * maxframes;
+			op = (float*) realloc(samples, maxframes * framesize * sizeof(float));
+			if (op == NULL)
+			{
+				free(samples);
+				VX_ERROR(("BVHLoader: ERROR out of memory for %d frames", maxframes), false);
+			}
+			samples = op;
+		}
+		op = samples + nframes * framesize;
+		*op++ = *fp++ - m_RootPos.x;
+		*op++ = *fp++ - m_RootPos.y;
+		*op++ = *fp++ - m_RootPos.z;
+		for (int i = 0; i < numbones; ++i)
+		{
+			float	z = *fp++ * PI / 180.0f;
+			float	x = *fp++ * PI / 180.0f;
+			float	y = *fp++ * PI / 180.0f;
+			Quat	q(Model::ZAXIS, z);
+
+			q *= Quat(Model::YAXIS, y);
+			q *= Quat(Model::XAXIS, x);
+			q.Normalize();
+			*op++ = q.x;
+			*op++ = q.y;
+			*op++ = q.z;
+			*op++ = q.w;
+		}
+		++nframes;
+	}
+	if (nframes == 0)
+		VX_ERROR(("BVHLoader: %s ERROR no motion data", (const TCHAR*) m_FileName), false);
+	rc = clip->Compress(samples, nframes, m_TimeStep);
+	free(samples);
+	return rc;
+}
+
 int	BVHLoader::ReadKeys(float* data, int numchannels)
 {
 	TCHAR	line[4096];
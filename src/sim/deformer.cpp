@@ -541,10 +541,41 @@ bool Deformer::Eval(float t)
 			if (mesh && mesh->IsClass(VX_TriMesh))
 				mesh->MakeNormals();
 		}
+		if (!m_TargetMesh.IsNull())
+		{
+			Box3	bound;
+
+			if (GetBound(bound))
+				UpdateBound(bound);
+		}
 	}
 	return true;
 }
 
+/*!
+ * @fn void Deformer::UpdateBound(const Box3& bound)
+ * @param bound	bounding box of the deformed locations
+ *
+ * Gives the target mesh the bounds of the deformed vertices so they
+ * are not examined again and, if the target is a shape, invalidates
+ * the bounds of the shape and its ancestors. Deformers call this after
+ * they update the target vertices. The bounds are computed from the
+ * deformer output, which for skins are the unique active locations.
+ *
+ * @see Mesh::SetBound Model::UpdateBounds
+ */
+void Deformer::UpdateBound(const Box3& bound)
+{
+	Mesh*		mesh = m_TargetMesh;
+	SharedObj*	target = GetTarget();
+
+	if (mesh == NULL)
+		return;
+	mesh->SetBound(bound);
+	if (target && target->IsClass(VX_Shape))
+		((Shape*) target)->NotifyParents(MOD_BVinvalid);
+}
+
 /*!
  * @fn bool Deformer::UpdateVertices(const FloatArray* srclocs, VertexArray* dstverts, const IntArray* vmap, const FloatArray* srcnmls)
  * Copy the source vertices computed from skinning into the target vertex array using the vertex map.
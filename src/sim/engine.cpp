@@ -876,14 +876,15 @@ bool Engine::Copy(const SharedObj* src_obj)
  */
 void Engine::Compute(float t)
 {
-	Lock();
+	bool		locked = !Core::Epoch::IsReading() && Lock();
 	bool		do_my_kids_no_matter_what = !(m_Control & CONTROL_CHILDREN);
 	bool		kids_first = (m_Control & CHILDREN_FIRST) != 0;
 	bool		eval_says_do_my_kids = true;
 	float		eval_t = ComputeTime(t);
 	bool		do_my_evals = (eval_t >= 0);
 	bool		isactive = IsActive();
-	Unlock();
+	if (locked)
+		Unlock();
 
 	if (!IsParent())
 	{
@@ -905,6 +906,7 @@ void Engine::Compute(float t)
 
 bool Engine::DoEval(float t)
 {
+	VX_PROFILE_DETAIL(ClassName());
 	VX_TRACE2(Engine::Debug, ("Engine::Eval: %s\n", GetName()));
 	return Eval(t);
 }
@@ -1008,6 +1010,41 @@ float Engine::ComputeTime(float t)
 	return evalt;
 }
 
+/*!
+ * @fn void Engine::ShiftTime(float ofs)
+ * @param ofs	time offset in seconds to subtract from start times
+ *
+ * Called by the scene when it moves the origin of its simulation time
+ * so the time passed to Engine::Compute stays small enough to be
+ * accurate as a float. The start times of this engine and all of its
+ * descendants are moved by the same amount so elapsed times do not change.
+ * Idle engines without a start time (negative) are not changed.
+ * Idle engines whose start time would become negative are set
+ * to start at the next evaluation.
+ *
+ * Note: This function does no locking. It is designed to be called
+ * during simulation tree traversal.
+ *
+ * @see Scene::SetSimStep Engine::SetStartTime Engine::ComputeTime
+ */
+void Engine::ShiftTime(float ofs)
+{
+	GroupIterNotSafe<Engine> iter(this, Group::DEPTH_FIRST);
+	Engine*	g;
+
+	while (g = iter.Next())
+	{
+		if ((g->m_State & IDLE) == 0)			// running or done
+			g->m_StartTime -= ofs;
+		else if (g->m_StartTime >= 0.0f)		// waiting for its start time
+		{
+			g->m_StartTime -= ofs;
+			if (g->m_StartTime < 0.0f)			// start time has passed
+				g->m_StartTime = 0.0f;			// start it now
+		}
+	}
+}
+
 /*!
  *
  * @fn void Engine::ComputeChildren(float t, int filter)
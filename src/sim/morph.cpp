@@ -6,6 +6,8 @@
 
 namespace Vixen {
 
+#define	MORPH_BlockSize	1024	// vertices per block in Morph::Eval
+
 VX_IMPLEMENT_CLASSID(Morph, Deformer, VX_Morph);
 
 Morph::Morph() : Deformer()
@@ -209,9 +211,15 @@ void Morph::Compute(float t)
 }
 
 
+/*
+ * Blend the source shapes into the target vertices.
+ * The vertices are done in blocks in parallel and the bounds of
+ * each block are saved as it is written, so the bounds of the
+ * target mesh come from the morph output without another pass.
+ */
 bool Morph::Eval(float t)
 {
-	intptr	start = 0, n, total;
+	intptr	n, nblocks;
 	int		debug = Deformer::Debug + Engine::Debug;
 
 	if (m_TargetVerts.IsNull())
@@ -221,42 +229,81 @@ bool Morph::Eval(float t)
 	VertexArray::Iter	iter(dstlocs);
 	intptr				nverts = dstlocs->GetNumVtx();
 	int					nshapes = (int) m_Sources.GetSize();
+	Box3*				bounds;
 
-	total = n = nverts;
+	if (nverts <= 0)
+		return true;
+	nblocks = (nverts + MORPH_BlockSize - 1) / MORPH_BlockSize;
+	bounds = (Box3*) Core::ThreadAllocator::Get()->Alloc(nblocks * sizeof(Box3));
+	n = nblocks;
 	#pragma omp PARALLEL_FOR(n)
-	cilk_for (intptr j = 0; j < n; ++j)
+	cilk_for (intptr b = 0; b < n; ++b)
 	{
-		Vec3	vtx(0, 0, 0);
-		intptr	vindex = j + start;
-		Vec3*	dstvtx = (Vec3*) iter.GetLoc(vindex);
-
-		for (int i = 0; i < nshapes; ++i)
+		intptr	vindex = b * MORPH_BlockSize;
+		intptr	vend = vindex + MORPH_BlockSize;
+		Vec3*	dstvtx;
+		Vec3	vmin(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vec3	vmax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		if (vend > nverts)
+			vend = nverts;
+		for (; vindex < vend; ++vindex)
 		{
-			const VertexArray*	srclocs = m_Sources.GetAt(i);
-			float				f = m_Weights.GetAt(i);
-			int					stride(srclocs->GetVtxSize());
+			Vec3	vtx(0, 0, 0);
 
-			if ((f > 0.0f) && srclocs)
+			dstvtx = (Vec3*) iter.GetLoc(vindex);
+			for (int i = 0; i < nshapes; ++i)
 			{
-				Vec3*	srcvtx = (Vec3*) (srclocs->GetData() + vindex * stride);
-				if (f == 1.0f)
-				{
-					vtx.x = srcvtx->x;
-					vtx.y = srcvtx->y;
-					vtx.z = srcvtx->z;
-				}
-				else
+				const VertexArray*	srclocs = m_Sources.GetAt(i);
+				float				f = m_Weights.GetAt(i);
+
+				if ((f > 0.0f) && srclocs)
 				{
-					vtx.x += f * srcvtx->x;
-					vtx.y += f * srcvtx->y;
-					vtx.z += f * srcvtx->z;
+					Vec3*	srcvtx = (Vec3*) (srclocs->GetData() + vindex * srclocs->GetVtxSize());
+					if (f == 1.0f)
+					{
+						vtx.x = srcvtx->x;
+						vtx.y = srcvtx->y;
+						vtx.z = srcvtx->z;
+					}
+					else
+					{
+						vtx.x += f * srcvtx->x;
+						vtx.y += f * srcvtx->y;
+						vtx.z += f * srcvtx->z;
+					}
 				}
 			}
+			*dstvtx += vtx;
+			if (dstvtx->x < vmin.x) vmin.x = dstvtx->x;
+			if (dstvtx->y < vmin.y) vmin.y = dstvtx->y;
+			if (dstvtx->z < vmin.z) vmin.z = dstvtx->z;
+			if (dstvtx->x > vmax.x) vmax.x = dstvtx->x;
+			if (dstvtx->y > vmax.y) vmax.y = dstvtx->y;
+			if (dstvtx->z > vmax.z) vmax.z = dstvtx->z;
 		}
-		*dstvtx += vtx;
-		++vindex;
+		bounds[b].min = vmin;
+		bounds[b].max = vmax;
 	}
-   return true;
+	if (!m_TargetMesh.IsNull())
+	{
+		Box3	bound(bounds[0]);
+
+		for (intptr b = 1; b < nblocks; ++b)
+		{
+			const Box3& bb = bounds[b];
+
+			if (bb.min.x < bound.min.x) bound.min.x = bb.min.x;
+			if (bb.min.y < bound.min.y) bound.min.y = bb.min.y;
+			if (bb.min.z < bound.min.z) bound.min.z = bb.min.z;
+			if (bb.max.x > bound.max.x) bound.max.x = bb.max.x;
+			if (bb.max.y > bound.max.y) bound.max.y = bb.max.y;
+			if (bb.max.z > bound.max.z) bound.max.z = bb.max.z;
+		}
+		UpdateBound(bound);
+	}
+	Core::ThreadAllocator::Get()->Free(bounds);
+	return true;
 }
 
 
@@ -86,7 +86,8 @@ bool Sequencer::Do(Messenger& s, int op)
 
 /*!
  * @fn Animator* Sequencer::Load(const TCHAR* animfile, const TCHAR* engname, int opts, SharedObj* target)
- * @param animfile	name of animation file to load (usually animations are in .vix or .bvh files)
+ * @param animfile	name of animation file to load (usually animations are in .vix or .bvh files,
+ *					compressed clips made from .bvh files are in .vxa files)
  * @param engname	name of animation engine to associate with target.
  *					usually the engine name begins with the name of the engine's target model
  * @param target	target hierarchy to animate
@@ -101,6 +102,8 @@ bool Sequencer::Do(Messenger& s, int op)
  * Loading, playing and recording are independent operations.
  * By default, an animation is loaded asynchronously, does not play
  * automatically and remains available after it has stopped playing.
+ * The keys of a compressed clip (.vxa) are read from the file a window
+ * at a time while the animation plays.
  * Animation options allow you to control the startup and play behavior.
  * @code
  *	Animator::LOAD_STREAM	stream part of the animation from the file each frame.
@@ -131,6 +134,7 @@ Animator* Sequencer::Load(const TCHAR* animfile, const TCHAR* engname, int opts,
 	Core::String	ext(Core::String(animfile).Right(4));
 	if ((ext.CompareNoCase(TEXT(".vix")) != 0) &&
 		(ext.CompareNoCase(TEXT(".bvh")) != 0) &&
+		(ext.CompareNoCase(TEXT(".vxa")) != 0) &&
 		(ext.CompareNoCase(TEXT(".xml")) != 0) &&
 		(ext.CompareNoCase(TEXT(".hkt")) != 0))
 	{
@@ -1,4 +1,7 @@
 #include "vixen.h"
+#ifndef _WIN32
+#include <sched.h>
+#endif
 
 namespace Vixen {
 
@@ -6,6 +9,10 @@ namespace Vixen {
 #define BAD_TRIGGER_TYPE 0
 #endif
 
+#define	TRIGGER_Tested	0x100	// collider tested by broad phase this frame
+
+bool Trigger::UseBroadPhase = true;
+
 VX_IMPLEMENT_CLASSID(Trigger, Engine, VX_Trigger);
 
 static const TCHAR* opnames[] =
@@ -20,6 +27,11 @@ Trigger::Trigger() : Engine()
 {
 Debug = 1;
 	m_Options = SPHERE;
+	m_Space = NULL;
+	m_SpaceIndex = -1;
+	m_NumInside = 0;
+	m_ZoneTarget = NULL;
+	m_HasZone = false;
 	m_TriggerFlags = new IntArray();
 	m_GeoSphere.Empty();
 	m_GeoBox.Empty();
@@ -33,6 +45,17 @@ Trigger::Trigger(const Trigger& src) : Engine(src)
 	m_Collider = src.m_Collider;
 	m_GeoSphere = src.m_GeoSphere;
 	m_GeoBox = src.m_GeoBox;
+	m_Space = NULL;
+	m_SpaceIndex = -1;
+	m_NumInside = 0;
+	m_ZoneTarget = NULL;
+	m_HasZone = false;
+}
+
+Trigger::~Trigger()
+{
+	if (m_Space)
+		TriggerSpace::Leave(this);
 }
 
 /*!
@@ -79,6 +102,9 @@ bool Trigger::SetColliders(const SharedObj* obj)
 	{
 		m_Collider = obj;
 		m_TriggerFlags->SetAt(0, OUTSIDE);
+		m_NumInside = 0;
+		if (m_Space)
+			m_Space->SetChanged();
 		return true;
 	}
 	else if (obj->IsClass(VX_ObjArray))
@@ -87,6 +113,9 @@ bool Trigger::SetColliders(const SharedObj* obj)
 		intptr sz = ((ObjArray*)obj)->GetSize();
 		for (intptr i=0; i<sz; i++) 
 			m_TriggerFlags->SetAt(i, OUTSIDE);
+		m_NumInside = 0;
+		if (m_Space)
+			m_Space->SetChanged();
 		return true;
 	}
 	return false;
@@ -123,6 +152,8 @@ bool Trigger::AddCollider(const Model* mod)
 		oa->Append(mod);				// add the collider
 		m_TriggerFlags->SetAt(1, OUTSIDE);
 		m_Collider = oa;
+		if (m_Space)
+			m_Space->SetChanged();
 		return true;
 	}
 	if (obj->IsClass(VX_ObjArray))		// multiple colliders?
@@ -132,6 +163,8 @@ bool Trigger::AddCollider(const Model* mod)
 		if (!oa->Append(mod))			// add the new model
 			return false;
 		m_TriggerFlags->SetAt(n, OUTSIDE);
+		if (m_Space)
+			m_Space->SetChanged();
 		return true;
 	}
 	return false;
@@ -177,14 +210,17 @@ bool Trigger::RemoveCollider(const Model* mod)
 		if (i < 0)						// no, guess not
 			return false;
 		oa->RemoveAt(i);				// remove the one found
+		if (m_Space)
+			m_Space->SetChanged();
 		return true;
 	}
 	return false;
 }
 
 /*!
- * @fn bool Trigger::Hit(const Model* col, int32& op, TriggerEvent& event)
+ * @fn bool Trigger::Hit(const Model* col, const Vec3& pos, int32& op, TriggerEvent& event)
  * @param col	model to test for collision
+ * @param pos	world position of the collider center
  * @param op	current collision results
  * @param event	event to indicate trigger collision
  *
@@ -206,50 +242,28 @@ bool Trigger::RemoveCollider(const Model* mod)
  *
  * If no collision geometry is supplied but there is a target model,
  * the bounding sphere or box of that model is used as the collision geometry.
+ * The collision zone is computed once per evaluation by Trigger::UpdateZone
+ * and the collider position is supplied by the caller (the broad phase
+ * keeps it for each collider) so nothing is recomputed for each pair.
  *
  * @return  true if there was a collision, else  false
  *
- * @see Model::Hit Trigger::SetColliders TriggerEvent
+ * @see Model::Hit Trigger::SetColliders TriggerEvent Trigger::UpdateZone
  */
-bool Trigger::Hit(const Model* col, int32& op, TriggerEvent& event)
+bool Trigger::Hit(const Model* col, const Vec3& pos, int32& op, TriggerEvent& event)
 {
-	const SharedObj*	targ = GetTarget();
-	Vec3				colPos, dV;
-	Box3				bbox;
-	Vec3				center(0, 0, 0);
-	Sphere				bsp;
+	const Model*		mod = m_ZoneTarget;
+	const Sphere&		bsp = m_ZoneSphere;
+	const Box3&			bbox = m_ZoneBox;
+	Vec3				colPos(pos);
+	Vec3				dV, center;
 	float				dist;
-	const Model*		mod = NULL;
-	const Transformer*	bone = NULL;
-	Matrix				wmtx;
 
 	if (col->IsSet(INACTIVE))
 		return false;
-	colPos = col->GetCenter(Model::WORLD);
-	if (targ)
-		if (targ->IsClass(VX_Model))			// have a target model?
-		{
-			mod = (const Model*) targ;
-			mod->GetBound(&bsp, Model::WORLD);	// get bounding sphere
-			center = bsp.Center;
-		}
-		else if (targ->IsClass(VX_Transformer))
-		{
-			bone = ((const Transformer*) targ);
-			bone->GetTotalTransform()->GetTranslation(center);
-		}
 	switch (m_Options)
 	{
 		case SPHERE:
-		if (mod != NULL)						// attached to model?
-		{
-			if (m_GeoSphere.Radius != 0)		// center comes from model
-				bsp.Radius = m_GeoSphere.Radius;
-		}
-		else if (bone)							// attached to bone?
-			bsp.Radius = m_GeoSphere.Radius;	// radius comes from trigger
-		else
-			bsp = m_GeoSphere;					// no target, radius and center come from trigger
 		dV = colPos - bsp.Center;
 		dist = dV.Length();
 		VX_TRACE(Debug > 1, ("Trigger: %s(%f, %f, %f) ? %s(%f, %f, %f) %f\n",
@@ -293,23 +307,10 @@ bool Trigger::Hit(const Model* col, int32& op, TriggerEvent& event)
 		break;
 
 		case BOX:
-		bbox = m_GeoBox;					// assume collision geometry in world coords
-		if (mod != NULL)					// have a target model?
-		{
-			mod->GetBound(&bbox, Model::NONE);	// get it's bounding box
-			mod->TotalTransform(&wmtx);			// get collider position in
-			wmtx.Invert();						// local coordinate space of model
-		}
-		else if (bone != NULL)
-		{
-			const Matrix* bonemtx = bone->GetTotalTransform();
-			bonemtx->GetTranslation(center);
-			wmtx.Invert(*bonemtx);
-		}
-		wmtx.Transform(colPos, colPos);		// where box is axially aligned
-		center = bbox.Center();
 		if (bbox.IsEmpty())
 			return false;
+		m_ZoneMtx.Transform(colPos, colPos);	// where box is axially aligned
+		center = bbox.Center();
 		dV = colPos - center;
 		dist = dV.Length();
 		VX_TRACE(Debug > 1, ("Trigger: %s(%f, %f, %f) ? %s(%f, %f, %f) %f\n",
@@ -477,6 +478,19 @@ bool Trigger::Eval(float t)
 	te.Sender = this;
 	te.Target = this->GetTarget();
 
+	if (UseBroadPhase && !m_Collider.IsNull())
+	{
+		TriggerSpace*	space = m_Space;
+		const Engine*	root = GetSpaceRoot();
+
+		if ((space == NULL) || (space->GetRoot() != root))
+			space = TriggerSpace::Join(this, root);
+		if (space && space->Touch(this))	// trigger has a zone?
+			return EvalSpace(space, te);
+	}
+	else if (m_Space)						// colliders removed or broad phase disabled
+		TriggerSpace::Leave(this);
+	UpdateZone();
 	if (collider->IsClass(VX_ObjArray))
 	{
 		//array of object colliders
@@ -486,7 +500,7 @@ bool Trigger::Eval(float t)
 		{
 			const Model* mod = (const Model*) (const SharedObj*) oa->GetAt(i);
 			op = m_TriggerFlags->GetAt(i);
-			hit = Hit(mod, op, te);
+			hit = Hit(mod, mod->GetCenter(Model::WORLD), op, te);
 			m_TriggerFlags->SetAt(i, op);
 			if (hit)
 			{
@@ -498,7 +512,7 @@ bool Trigger::Eval(float t)
 	else if (collider->IsClass(VX_Model))
 	{
 		op = m_TriggerFlags->GetAt(0);
-		hit = Hit(collider, op, te);
+		hit = Hit(collider, collider->GetCenter(Model::WORLD), op, te);
 		m_TriggerFlags->SetAt(0, op);
 		if (hit)
 		{
@@ -509,6 +523,226 @@ bool Trigger::Eval(float t)
 	return false; 
 }
 
+/*!
+ * @fn bool Trigger::EvalSpace(TriggerSpace* space, TriggerEvent& te)
+ * @param space	broad phase the trigger is registered with
+ * @param te	event to send for each collision
+ *
+ * Hit tests the colliders which the broad phase found inside
+ * the bounding box of the trigger zone and the colliders which
+ * were inside the trigger last frame (which may be leaving).
+ * Unlike the brute force evaluation, an event is sent for every
+ * collider which enters or leaves, not just the first.
+ *
+ * @return \b true if any events were sent, else \b false
+ *
+ * @see TriggerSpace::Overlaps Trigger::Hit
+ */
+bool Trigger::EvalSpace(TriggerSpace* space, TriggerEvent& te)
+{
+	IntArray*		flags = m_TriggerFlags;
+	const int32*	found;
+	const Vec3*		pos;
+	int				n = space->Overlaps(this, &found, &pos);
+	bool			hitany = false;
+
+	for (int k = 0; k < n; ++k)			// colliders inside trigger box
+	{
+		intptr	i = found[k];
+		int32	op = (i < flags->GetSize()) ? flags->GetAt(i) : OUTSIDE;
+		int32	inside = op & INSIDE;
+
+		if (Hit(GetCollider(i), pos[k], op, te))
+		{
+			*GetMessenger() << te;
+			hitany = true;
+		}
+		m_NumInside += ((op & INSIDE) != 0) - (inside != 0);
+		flags->SetAt(i, op | TRIGGER_Tested);
+	}
+	if (m_NumInside <= 0)					// nothing inside, no one can leave
+	{
+		for (int k = 0; k < n; ++k)
+			flags->SetAt(found[k], flags->GetAt(found[k]) & ~TRIGGER_Tested);
+		return hitany;
+	}
+	for (intptr i = 0; i < flags->GetSize(); ++i)
+	{
+		int32	op = flags->GetAt(i);
+
+		if (op & TRIGGER_Tested)
+			op &= ~TRIGGER_Tested;
+		else if (op & INSIDE)				// was inside but not in box now
+		{
+			const Model* mod = GetCollider(i);
+
+			if (mod && Hit(mod, mod->GetCenter(Model::WORLD), op, te))
+			{
+				*GetMessenger() << te;
+				hitany = true;
+			}
+			if ((op & INSIDE) == 0)
+				--m_NumInside;
+		}
+		else
+			continue;
+		flags->SetAt(i, op);
+	}
+	return hitany;
+}
+
+/*
+ * Return the collider at the given position in the collider list.
+ */
+const Model* Trigger::GetCollider(intptr i) const
+{
+	const SharedObj* obj = m_Collider;
+
+	if (obj == NULL)
+		return NULL;
+	if (obj->IsClass(VX_ObjArray))
+	{
+		const ObjArray* oa = (const ObjArray*) obj;
+
+		if (i >= oa->GetSize())
+			return NULL;
+		obj = oa->GetAt(i);
+		return (obj && obj->IsClass(VX_Model)) ? (const Model*) obj : NULL;
+	}
+	return (i == 0) ? (const Model*) obj : NULL;
+}
+
+intptr Trigger::GetNumColliders() const
+{
+	const SharedObj* obj = m_Collider;
+
+	if (obj == NULL)
+		return 0;
+	if (obj->IsClass(VX_ObjArray))
+		return ((const ObjArray*) obj)->GetSize();
+	return 1;
+}
+
+/*
+ * Return the closest engine above the trigger which is evaluated as
+ * a parallel task or the root of the simulation tree. The triggers
+ * under it are evaluated by one thread and can share a trigger space.
+ */
+const Engine* Trigger::GetSpaceRoot() const
+{
+	const Engine*	root = this;
+	const Engine*	parent;
+
+	while (((root->GetControl() & TASK_PARALLEL) == 0) && (parent = root->Parent()))
+		root = parent;
+	return root;
+}
+
+/*!
+ * @fn bool Trigger::UpdateZone()
+ *
+ * Computes the collision zone in world coordinates from the target
+ * and the collision geometry. For the sphere test this is the world
+ * sphere, for the box test the box and the matrix which takes world
+ * positions into the space where the box is axially aligned.
+ * Trigger::Hit uses the zone computed here so it is only computed
+ * once per evaluation instead of once for each collider tested.
+ * The axially aligned world box which encloses the zone is used by
+ * the broad phase to find the colliders which might hit the trigger.
+ *
+ * @return \b true if trigger has collision geometry, else \b false
+ *
+ * @see TriggerSpace::Update Trigger::GetWorldBound Trigger::SetOptions
+ */
+bool Trigger::UpdateZone()
+{
+	const SharedObj*	targ = GetTarget();
+	const Transformer*	bone = NULL;
+	float				r;
+
+	m_ZoneTarget = NULL;
+	m_HasZone = false;
+	m_ZoneBound.Empty();
+	if (targ)
+	{
+		if (targ->IsClass(VX_Model))
+			m_ZoneTarget = (const Model*) targ;
+		else if (targ->IsClass(VX_Transformer))
+			bone = (const Transformer*) targ;
+	}
+	switch (m_Options)
+	{
+		case SPHERE:
+		if (m_ZoneTarget != NULL)					// center comes from model
+		{
+			m_ZoneTarget->GetBound(&m_ZoneSphere, Model::WORLD);
+			if (m_GeoSphere.Radius != 0)
+				m_ZoneSphere.Radius = m_GeoSphere.Radius;
+		}
+		else if (bone != NULL)						// center comes from bone
+		{
+			bone->GetTotalTransform()->GetTranslation(m_ZoneSphere.Center);
+			m_ZoneSphere.Radius = m_GeoSphere.Radius;
+		}
+		else
+			m_ZoneSphere = m_GeoSphere;				// no target, radius and center come from trigger
+		r = m_ZoneSphere.Radius;
+		if (r <= 0)
+			return false;
+		m_ZoneBound.Set(m_ZoneSphere.Center - Vec3(r, r, r), m_ZoneSphere.Center + Vec3(r, r, r));
+		break;
+
+		case BOX:
+		m_ZoneBox = m_GeoBox;						// assume collision geometry in world coords
+		m_ZoneMtx.Identity();
+		if (m_ZoneTarget != NULL)					// box comes from model
+		{
+			m_ZoneTarget->GetBound(&m_ZoneBox, Model::NONE);
+			m_ZoneTarget->GetBound(&m_ZoneBound, Model::WORLD);
+			m_ZoneTarget->TotalTransform(&m_ZoneMtx);
+			m_ZoneMtx.Invert();
+		}
+		else
+		{
+			m_ZoneBound = m_ZoneBox;
+			if ((bone != NULL) && !m_ZoneBox.IsEmpty())
+			{
+				const Matrix* bonemtx = bone->GetTotalTransform();
+
+				m_ZoneBound *= *bonemtx;
+				m_ZoneMtx.Invert(*bonemtx);
+			}
+		}
+		if (m_ZoneBox.IsEmpty() || m_ZoneBound.IsEmpty())
+			return false;
+		break;
+
+		default:
+		return false;
+	}
+	m_HasZone = true;
+	return true;
+}
+
+/*!
+ * @fn bool Trigger::GetWorldBound(Box3& box) const
+ * @param box	gets the world bounding box of the trigger zone
+ *
+ * Returns an axially aligned box in world coordinates which encloses
+ * the collision zone computed by the last call to Trigger::UpdateZone.
+ *
+ * @return \b true if trigger has collision geometry, else \b false
+ *
+ * @see TriggerSpace Trigger::UpdateZone
+ */
+bool Trigger::GetWorldBound(Box3& box) const
+{
+	if (!m_HasZone)
+		return false;
+	box = m_ZoneBound;
+	return true;
+}
+
 DebugOut& Trigger::Print(DebugOut& dbg, int opts) const
 {
 	return Engine::Print(dbg);
@@ -627,4 +861,445 @@ int Trigger::Save(Messenger& s, int opts) const
 		s << OP(VX_Trigger, TRIGGER_SetOptions) << h << int32(GetOptions());
 	return h;
 }
+
+static TriggerSpace**	s_Spaces = NULL;		// trigger spaces in use
+static int32			s_NumSpaces = 0;
+static int32			s_MaxSpaces = 0;
+static vint32			s_SpaceLock = 0;		// guards the list of spaces
+
+static void LockSpaces()
+{
+	while (!Core::InterlockTestSet(&s_SpaceLock, 1, 0))
+#ifdef _WIN32
+		::Sleep(0);
+#else
+		sched_yield();
+#endif
+}
+
+static void UnlockSpaces()
+{
+	Core::InterlockSet(&s_SpaceLock, 0);
+}
+
+TriggerSpace::TriggerSpace()
+{
+	m_Root = NULL;
+	m_Entries = NULL;
+	m_NumEntries = 0;
+	m_MaxEntries = 0;
+	m_Members = NULL;
+	m_NumMembers = 0;
+	m_MaxMembers = 0;
+	m_Proxies = NULL;
+	m_NumProxies = 0;
+	m_MaxProxies = 0;
+	m_Order = NULL;
+	m_Pass = 0;
+	m_Changed = true;
+}
+
+TriggerSpace::~TriggerSpace()
+{
+	for (int i = 0; i < m_NumEntries; ++i)
+		m_Entries[i].Owner->m_Space = NULL;
+	if (m_Entries)
+		free(m_Entries);
+	if (m_Members)
+		free(m_Members);
+	if (m_Proxies)
+		free(m_Proxies);
+	if (m_Order)
+		free(m_Order);
+}
+
+/*!
+ * @fn TriggerSpace* TriggerSpace::Join(Trigger* trigger, const Engine* root)
+ * @param trigger	trigger to add
+ * @param root		trigger root of the trigger
+ *
+ * Adds the trigger to the space shared by the triggers under \b root,
+ * creating the space if it does not exist. If the trigger was in the
+ * space of another root, it is removed from that one first. Spaces are
+ * deleted when their last trigger leaves.
+ *
+ * @return space the trigger was added to, NULL on error
+ *
+ * @see Trigger::GetSpaceRoot TriggerSpace::Leave
+ */
+TriggerSpace* TriggerSpace::Join(Trigger* trigger, const Engine* root)
+{
+	TriggerSpace*	space = NULL;
+
+	if (trigger->m_Space && (trigger->m_Space->m_Root == root))
+		return trigger->m_Space;
+	if (trigger->m_Space)
+		Leave(trigger);
+	LockSpaces();
+	for (int i = 0; i < s_NumSpaces; ++i)
+		if (s_Spaces[i]->m_Root == root)
+		{
+			space = s_Spaces[i];
+			break;
+		}
+	if ((space == NULL) && Grow((void**) &s_Spaces, s_MaxSpaces, s_NumSpaces + 1, sizeof(TriggerSpace*)))
+	{
+		space = new TriggerSpace;
+		space->m_Root = root;
+		s_Spaces[s_NumSpaces++] = space;
+	}
+	if (space && (space->AddTrigger(trigger) < 0))
+		space = NULL;
+	UnlockSpaces();
+	return space;
+}
+
+/*!
+ * @fn void TriggerSpace::Leave(Trigger* trigger)
+ * @param trigger	trigger to remove
+ *
+ * Removes the trigger from its space. The space is
+ * deleted if no other triggers are using it.
+ *
+ * @see TriggerSpace::Join
+ */
+void TriggerSpace::Leave(Trigger* trigger)
+{
+	TriggerSpace*	space = trigger->m_Space;
+
+	if (space == NULL)
+		return;
+	LockSpaces();
+	space->RemoveTrigger(trigger);
+	if (space->m_NumEntries == 0)
+		for (int i = 0; i < s_NumSpaces; ++i)
+			if (s_Spaces[i] == space)
+			{
+				s_Spaces[i] = s_Spaces[--s_NumSpaces];
+				delete space;
+				break;
+			}
+	UnlockSpaces();
+}
+
+bool TriggerSpace::Grow(void** data, int32& maxsize, int32 size, int elemsize)
+{
+	int32	n = maxsize;
+	void*	newdata;
+
+	if (size <= maxsize)
+		return true;
+	while (n < size)
+		n = n ? n * 2 : 64;
+	newdata = realloc(*data, n * elemsize);
+	if (newdata == NULL)
+		VX_ERROR(("TriggerSpace ERROR out of memory\n"), false);
+	*data = newdata;
+	maxsize = n;
+	return true;
+}
+
+/*!
+ * @fn int TriggerSpace::AddTrigger(Trigger* trigger)
+ * @param trigger	trigger to add to the space
+ *
+ * Registers a trigger so the world positions of its colliders
+ * and the bounds of its collision zone are updated each frame.
+ * A trigger may only be in one space. Triggers are removed
+ * from the space automatically when they are deleted.
+ *
+ * @return index of trigger in the space, -1 on error
+ *
+ * @see TriggerSpace::RemoveTrigger
+ */
+int TriggerSpace::AddTrigger(Trigger* trigger)
+{
+	Entry*	e;
+
+	if (trigger->m_Space == this)
+		return trigger->m_SpaceIndex;
+	if (trigger->m_Space)
+		trigger->m_Space->RemoveTrigger(trigger);
+	if (!Grow((void**) &m_Entries, m_MaxEntries, m_NumEntries + 1, sizeof(Entry)))
+		return -1;
+	e = &m_Entries[m_NumEntries];
+	e->Owner = trigger;
+	e->Bound.Empty();
+	e->HasBound = false;
+	e->First = 0;
+	e->Count = 0;
+	e->Size = 0;
+	e->Pass = -1;
+	trigger->m_Space = this;
+	trigger->m_SpaceIndex = m_NumEntries;
+	m_Changed = true;
+	return m_NumEntries++;
+}
+
+void TriggerSpace::RemoveTrigger(Trigger* trigger)
+{
+	int32	i = trigger->m_SpaceIndex;
+
+	if (trigger->m_Space != this)
+		return;
+	VX_ASSERT((i >= 0) && (i < m_NumEntries) && (m_Entries[i].Owner == trigger));
+	if (i < --m_NumEntries)					// move last trigger into this slot
+	{
+		m_Entries[i] = m_Entries[m_NumEntries];
+		m_Entries[i].Owner->m_SpaceIndex = i;
+	}
+	trigger->m_Space = NULL;
+	trigger->m_SpaceIndex = -1;
+	m_Changed = true;
+}
+
+/*!
+ * @fn bool TriggerSpace::Touch(Trigger* trigger)
+ * @param trigger	trigger being evaluated
+ *
+ * Called when a trigger is evaluated. If the trigger has already
+ * been evaluated since the last update, a new frame has started
+ * and the space is updated. The space is also updated if the
+ * collider lists have changed.
+ *
+ * @return \b true if the trigger has a collision zone the broad phase can use
+ */
+bool TriggerSpace::Touch(Trigger* trigger)
+{
+	int32	i = trigger->m_SpaceIndex;
+
+	if ((trigger->m_Space != this) || (i < 0))
+		return false;
+	if (m_Changed || (m_Entries[i].Pass == m_Pass))
+		Update();
+	m_Entries[i].Pass = m_Pass;
+	return m_Entries[i].HasBound;
+}
+
+int TriggerSpace::CompareColliders(const void* p1, const void* p2)
+{
+	intptr	m1 = (intptr) ((const Proxy*) p1)->Collider;
+	intptr	m2 = (intptr) ((const Proxy*) p2)->Collider;
+
+	if (m1 < m2)
+		return -1;
+	return (m1 > m2) ? 1 : 0;
+}
+
+int TriggerSpace::CompareModels(const void* key, const void* p)
+{
+	intptr	m1 = *((const intptr*) key);
+	intptr	m2 = (intptr) ((const Proxy*) p)->Collider;
+
+	if (m1 < m2)
+		return -1;
+	return (m1 > m2) ? 1 : 0;
+}
+
+int TriggerSpace::CompareProxies(const void* p1, const void* p2)
+{
+	const Member*	m1 = (const Member*) p1;
+	const Member*	m2 = (const Member*) p2;
+
+	if (m1->Proxy != m2->Proxy)
+		return m1->Proxy - m2->Proxy;
+	return m1->Index - m2->Index;
+}
+
+/*
+ * Rebuild the collider proxies and trigger memberships from
+ * the collider lists of all the triggers. Each unique collider
+ * gets one proxy no matter how many triggers test it.
+ */
+void TriggerSpace::BuildMembers()
+{
+	m_NumMembers = 0;
+	m_NumProxies = 0;
+	for (int t = 0; t < m_NumEntries; ++t)
+	{
+		Entry&	e = m_Entries[t];
+		intptr	n = e.Owner->GetNumColliders();
+
+		e.First = m_NumMembers;
+		e.Size = n;
+		if (!Grow((void**) &m_Members, m_MaxMembers, int32(m_NumMembers + n), sizeof(Member)))
+			n = 0;
+		for (intptr i = 0; i < n; ++i)
+		{
+			const Model* mod = e.Owner->GetCollider(i);
+
+			if (mod == NULL)
+				continue;
+			m_Members[m_NumMembers].Collider = mod;
+			m_Members[m_NumMembers].Proxy = -1;
+			m_Members[m_NumMembers].Index = int32(i);
+			++m_NumMembers;
+		}
+		e.Count = m_NumMembers - e.First;
+	}
+	m_Changed = false;
+	if (m_NumMembers == 0)
+		return;
+	if (!Grow((void**) &m_Proxies, m_MaxProxies, m_NumMembers, sizeof(Proxy)))
+		return;
+	m_Order = (int32*) realloc(m_Order, m_MaxProxies * sizeof(int32));
+	if (m_Order == NULL)
+	{
+		m_MaxProxies = 0;
+		VX_ERROR_RETURN(("TriggerSpace ERROR out of memory\n"));
+	}
+	for (int i = 0; i < m_NumMembers; ++i)
+	{
+		m_Proxies[i].Collider = m_Members[i].Collider;
+		m_Proxies[i].Active = false;
+	}
+	qsort(m_Proxies, m_NumMembers, sizeof(Proxy), &CompareColliders);
+	for (int i = 0; i < m_NumMembers; ++i)	// remove duplicates
+		if ((m_NumProxies == 0) || (m_Proxies[m_NumProxies - 1].Collider != m_Proxies[i].Collider))
+			m_Proxies[m_NumProxies++] = m_Proxies[i];
+	for (int i = 0; i < m_NumMembers; ++i)
+	{
+		intptr	key = (intptr) m_Members[i].Collider;
+		Proxy*	p = (Proxy*) bsearch(&key, m_Proxies, m_NumProxies, sizeof(Proxy), &CompareModels);
+
+		VX_ASSERT(p != NULL);
+		m_Members[i].Proxy = int32(p - m_Proxies);
+	}
+	for (int t = 0; t < m_NumEntries; ++t)
+	{
+		Entry& e = m_Entries[t];
+		qsort(m_Members + e.First, e.Count, sizeof(Member), &CompareProxies);
+	}
+	for (int i = 0; i < m_NumProxies; ++i)
+		m_Order[i] = i;
+}
+
+/*!
+ * @fn void TriggerSpace::Update()
+ *
+ * Computes the world position of each collider and the world
+ * bounding box of each trigger zone, then re-sorts the colliders
+ * by X with an insertion sort. Because colliders move only a little
+ * between frames, the order is nearly sorted and this is close to linear.
+ * This is called automatically by TriggerSpace::Touch once per frame.
+ *
+ * @see Trigger::GetWorldBound
+ */
+void TriggerSpace::Update()
+{
+	if (!m_Changed)							// collider arrays changed directly?
+		for (int t = 0; t < m_NumEntries; ++t)
+			if (m_Entries[t].Owner->GetNumColliders() != m_Entries[t].Size)
+			{
+				m_Changed = true;
+				break;
+			}
+	if (m_Changed)
+		BuildMembers();
+	++m_Pass;
+	for (int i = 0; i < m_NumProxies; ++i)
+	{
+		Proxy&	p = m_Proxies[i];
+
+		p.Active = !p.Collider->IsSet(SharedObj::INACTIVE);
+		if (p.Active)
+			p.Pos = p.Collider->GetCenter(Model::WORLD);
+	}
+	for (int i = 1; i < m_NumProxies; ++i)	// insertion sort by X
+	{
+		int32	p = m_Order[i];
+		float	x = m_Proxies[p].Pos.x;
+		int		j = i - 1;
+
+		while ((j >= 0) && (m_Proxies[m_Order[j]].Pos.x > x))
+		{
+			m_Order[j + 1] = m_Order[j];
+			--j;
+		}
+		m_Order[j + 1] = p;
+	}
+	for (int t = 0; t < m_NumEntries; ++t)
+	{
+		Entry& e = m_Entries[t];
+		e.HasBound = e.Owner->UpdateZone() && e.Owner->GetWorldBound(e.Bound);
+	}
+}
+
+/*!
+ * @fn int TriggerSpace::Overlaps(const Trigger* trigger, const int32** indices, const Vec3** positions)
+ * @param trigger	trigger to find colliders for
+ * @param indices	gets a pointer to the positions of the colliders in the trigger collider list
+ * @param positions	gets a pointer to the world positions of the colliders found
+ *
+ * Finds the colliders of the trigger whose centers are inside the
+ * bounding box of the trigger zone. The colliders sorted by X are binary
+ * searched for the left edge of the box and scanned to the right edge.
+ * The world positions are the ones cached by the last update so the
+ * narrow phase does not compute them again for each trigger.
+ * The arrays returned are only valid until the next call.
+ *
+ * @return number of colliders found
+ *
+ * @see Trigger::EvalSpace
+ */
+int TriggerSpace::Overlaps(const Trigger* trigger, const int32** indices, const Vec3** positions)
+{
+	int32	t = trigger->m_SpaceIndex;
+	int		lo = 0;
+	int		hi = m_NumProxies;
+
+	m_Found.SetSize(0);
+	m_FoundPos.SetSize(0);
+	*indices = NULL;
+	*positions = NULL;
+	if ((trigger->m_Space != this) || (t < 0))
+		return 0;
+	const Entry&	e = m_Entries[t];
+	const Box3&		b = e.Bound;
+	const Member*	first = m_Members + e.First;
+
+	if (!e.HasBound || (e.Count == 0))
+		return 0;
+	while (lo < hi)							// find left edge of box
+	{
+		int mid = (lo + hi) / 2;
+
+		if (m_Proxies[m_Order[mid]].Pos.x < b.min.x)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (int i = lo; i < m_NumProxies; ++i)
+	{
+		int32			p = m_Order[i];
+		const Proxy&	px = m_Proxies[p];
+		int				l = 0;
+		int				h = e.Count;
+
+		if (px.Pos.x > b.max.x)				// past right edge of box
+			break;
+		if (!px.Active ||
+			(px.Pos.y < b.min.y) || (px.Pos.y > b.max.y) ||
+			(px.Pos.z < b.min.z) || (px.Pos.z > b.max.z))
+			continue;
+		while (l < h)						// is collider in the trigger list?
+		{
+			int mid = (l + h) / 2;
+
+			if (first[mid].Proxy < p)
+				l = mid + 1;
+			else
+				h = mid;
+		}
+		while ((l < e.Count) && (first[l].Proxy == p))
+		{
+			m_Found.Append(first[l++].Index);
+			m_FoundPos.Append(px.Pos);
+		}
+	}
+	*indices = m_Found.GetData();
+	*positions = m_FoundPos.GetData();
+	return (int) m_Found.GetSize();
+}
+
 }	// end Vixen
\ No newline at end of file
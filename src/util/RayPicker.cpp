@@ -1102,6 +1102,7 @@ bool RayPicker::Copy(const SharedObj* src_obj)
 
 NamePicker::NamePicker() : RayPicker()
 {
+	memset(m_NameAtoms, 0, sizeof(m_NameAtoms));
 }
 
 /*!
@@ -1126,6 +1127,7 @@ void NamePicker::SetNameFilter(const TCHAR* str)
 	VX_STREAM_END()
 
 	m_NameFilter = str;
+	memset(m_NameAtoms, 0, sizeof(m_NameAtoms));
 }
 
 /*!
@@ -1150,32 +1152,51 @@ int NamePicker::CanSelect(const Model* mod, float closest)
 	return RayPicker::CanSelect(mod, closest);
 }
 
+/*
+ * The names of the models are checked against the filter string once.
+ * The result is remembered for the name atom of the model so picking
+ * the same models again each frame does not repeat the string search.
+ */
 bool NamePicker::IsNameValid(const Model* mod)
 {
-	const TCHAR*	filter = m_NameFilter;
-	const TCHAR*	objname = mod->GetName();
-
-	if ((m_Options & NAME_FILTER) && filter)
+	if ((m_Options & NAME_FILTER) && !m_NameFilter.IsEmpty())
 	{
-		const TCHAR* p = objname;
-		size_t n = STRLEN(filter);
+		NameProp*	np = (NameProp*) mod->GetProp(PROP_NameTag, 0);
+		Core::Atom	atom = np ? np->GetAtom() : 0;
+		int			slot = atom % PICK_NameCacheSize;
 
-		while (objname)
+		if (atom == 0)
+			return false;
+		if (m_NameAtoms[slot] != atom)
 		{
-			p = STRCHR(objname, *filter);
-			if (p == NULL)
-				return false;
-			objname = p;
-			if (STRNCMP(objname, filter, n) == 0)
-				return true;
-			++objname;
+			m_NameValid[slot] = MatchName(*np);
+			m_NameAtoms[slot] = atom;
 		}
-		return false;
+		return m_NameValid[slot];
 	}
-	VX_TRACE2(Picker::Debug, ("Picker::IsNameValid %s\n", objname));
+	VX_TRACE2(Picker::Debug, ("Picker::IsNameValid %s\n", mod->GetName()));
 	return true;
 }
 
+bool NamePicker::MatchName(const TCHAR* objname) const
+{
+	const TCHAR*	filter = m_NameFilter;
+	const TCHAR*	p = objname;
+	size_t			n = STRLEN(filter);
+
+	while (objname)
+	{
+		p = STRCHR(objname, *filter);
+		if (p == NULL)
+			return false;
+		objname = p;
+		if (STRNCMP(objname, filter, n) == 0)
+			return true;
+		++objname;
+	}
+	return false;
+}
+
 int NamePicker::Save(Messenger& s, int opts) const
 {
 	int32 h = RayPicker::Save(s, opts);
@@ -27,12 +27,18 @@ FrameStats::FrameStats() : Engine()
 	m_Stats[STAT_ModelsRendered].Name = TEXT("Rendered Models");
 	m_Stats[STAT_ModelsCulled].Name = TEXT("Culled Models");
 	m_Stats[STAT_FrameTime].Name = TEXT("Frame Time");
+	m_Stats[STAT_ObjectMemory].Name = TEXT("Object MB");
+	m_Stats[STAT_VertexMemory].Name = TEXT("Vertex MB");
+	m_Stats[STAT_IndexMemory].Name = TEXT("Index MB");
+	m_Stats[STAT_BitmapMemory].Name = TEXT("Bitmap MB");
 	for (int i = 0; i < STAT_MaxProp; ++i)
 		m_Stats[i].Reset();
 	m_Stats[STAT_FrameRate].Enable = true;
 	SetControl(Engine::CYCLE | Engine::CHILDREN_FIRST);
 	m_Frame = 0;
 	m_StartTime = 0;
+	m_MemLogInterval = 0;
+	m_MemLogTime = 0;
 }
 
 FrameStats::~FrameStats() { CloseLog(); }
@@ -298,6 +304,53 @@ int FrameStats::AddProperty(const TCHAR* name, int prop)
 	return prop;
 }
 
+/*!
+ * @fn int FrameStats::AddZone(const TCHAR* zonename, const TCHAR* name)
+ * @param zonename	name of profiler zone (as given to VX_PROFILE_ZONE)
+ * @param name		string name of property, if NULL the zone name is used
+ *
+ * Adds a new property which reports the time in milliseconds spent
+ * in a profiler zone each frame. These properties are updated
+ * automatically by FrameStats::Gather from the rolling zone statistics
+ * kept by Core::Profiler. Zone properties are enabled for display
+ * and the profiler is enabled if it was not already.
+ *
+ * @return property ID of new property or negative on error 
+ *
+ * @see FrameStats::AddProperty Core::Profiler
+ */
+int FrameStats::AddZone(const TCHAR* zonename, const TCHAR* name)
+{
+	int prop = AddProperty(name ? name : zonename);
+
+	if ((prop < 0) || (m_Stats[prop].Name != (name ? name : zonename)))
+		return -1;
+	m_Stats[prop].Zone = zonename;
+	m_Stats[prop].Enable = true;
+	Core::Profiler::Enabled = true;
+	return prop;
+}
+
+/*!
+ * @fn void FrameStats::SetMemoryLog(const TCHAR* filename, float interval)
+ * @param filename	name of JSON file to write, NULL to stop logging
+ * @param interval	seconds between updates
+ *
+ * Every \b interval seconds the file is rewritten with the current
+ * live objects and bytes of each class, the resource memory totals
+ * and the change since it was last written. Classes that keep growing
+ * from one update to the next are likely leaks.
+ *
+ * @see Core::MemStats::WriteJSON FrameStats::Gather
+ */
+void FrameStats::SetMemoryLog(const TCHAR* filename, float interval)
+{
+	m_MemLogFile = filename;
+	m_MemLogInterval = (filename && *filename) ? interval : 0.0f;
+	m_MemLogTime = 0;
+	m_MemLast.Empty();
+}
+
 /*!
  * @fn void FrameStats::Gather(float time)
  *
@@ -313,6 +366,10 @@ int FrameStats::AddProperty(const TCHAR* name, int prop)
  *		STAT_StateChanges
  *		STAT_ModelsRendered
  *		STAT_ModelsCulled
+ *		STAT_ObjectMemory
+ *		STAT_VertexMemory
+ *		STAT_IndexMemory
+ *		STAT_BitmapMemory
  * @endcode
  * Gather is called every frame by Eval. It can be overridden
  * to gather other statistics every frame.
@@ -334,6 +391,23 @@ void FrameStats::Gather(float time)
 	SetValue(STAT_StateChanges, float(stats->RenderStateChanges));
 	SetValue(STAT_ModelsRendered, float(stats->TotalModels - stats->CulledModels));
 	SetValue(STAT_ModelsCulled, float(stats->CulledModels));
+	SetValue(STAT_ObjectMemory, float(Core::MemStats::GetObjectBytes() / (1024.0 * 1024.0)));
+	SetValue(STAT_VertexMemory, float(Core::MemStats::GetResourceBytes(Core::MemStats::VERTEX) / (1024.0 * 1024.0)));
+	SetValue(STAT_IndexMemory, float(Core::MemStats::GetResourceBytes(Core::MemStats::INDEX) / (1024.0 * 1024.0)));
+	SetValue(STAT_BitmapMemory, float(Core::MemStats::GetResourceBytes(Core::MemStats::BITMAP) / (1024.0 * 1024.0)));
+	if ((m_MemLogInterval > 0) && (stats->EndTime - m_MemLogTime >= m_MemLogInterval))
+	{
+		Core::MemStats::WriteJSON(m_MemLogFile, (m_MemLogTime > 0) ? &m_MemLast : NULL);
+		m_MemLast.Take();
+		m_MemLogTime = stats->EndTime;
+	}
+	for (int i = 0; i < STAT_MaxProp; ++i)
+		if (m_Stats[i].Zone)
+		{
+			const Core::Profiler::ZoneStats* zone = Core::Profiler::FindZone(m_Stats[i].Zone);
+			if (zone)
+				SetValue(i, zone->Last);
+		}
 	UpdateLog();
 }
 
@@ -1,229 +1,235 @@
 #include "vixen.h"
 #include "vxutil.h"
-#include "util/sceneopt.h"
-#include "scene/vxoctree.h"
+
+namespace Vixen {
+
+int SceneOptimize::Debug = 0;
+int SceneOptimize::CompactOptions = 0;
+bool SceneOptimize::ShaderDecode = false;
+int32 SceneOptimize::MeshletFaces = 0;
+
+SceneOptimize::SceneOptimize()
+{
+	MaxChunkVerts = 65536;
+	ChunkSize = 0.0f;
+	m_Shapes = NULL;
+	m_NumShapes = 0;
+	m_MaxShapes = 0;
+	m_Targets = NULL;
+	m_NumTargets = 0;
+	memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+SceneOptimize::~SceneOptimize()
+{
+	if (m_Shapes)
+		free(m_Shapes);
+	if (m_Targets)
+		free(m_Targets);
+}
 
 /*!
- * @fn void PSSceneOptimize::UniqueAppearances(PSModel* root)
- * @param root	root of hierarchy to optimize appearances for
+ * @fn bool SceneOptimize::PostLoad(Scene* scene, const TCHAR* filename)
+ * @param scene		scene which was just loaded
+ * @param filename	name of file the scene came from
  *
- * Scans the hierarchy and computes an Appearances table
- * containing the unique Appearance objects used in the
- * hierarchy and changes all the meshes to use this
- * this Appearances table.
+ * Loader post-processing function which merges the static geometry
+ * in each scene as it is loaded. It is called from the load thread
+ * before the scene is made visible, so it can change the hierarchy
+ * without locking. If SceneOptimize::CompactOptions is set, the
+ * vertices of the scene are then converted to compact formats.
+ * If SceneOptimize::MeshletFaces is set, meshes with at least that
+ * many triangles are divided into meshlets last.
+ * To enable it:
+ * @code
+ *	SceneLoader::PostLoad = &SceneOptimize::PostLoad;
+ * @endcode
  *
- * This routine is a step in the process of static scenery
- * optimization. Sharing a single sppearances table allows
- * meshes to be sorted more efficiently and permits the
- * scene graph hierarchy to be more easily rearranged.
+ * @return \b true if static geometry was merged, vertices compacted
+ *			or meshlets made, else \b false
  *
- * @see PSOctree PSSceneOptimize::MakeWorldCoords
+ * @see SceneLoader::PostLoad SceneOptimize::OptimizeStatic SceneOptimize::CompactVertices SceneOptimize::MakeMeshlets
  */
-PSAppearances* PSSceneOptimize::UniqueAppearances(PSModel* root)
+bool SceneOptimize::PostLoad(Scene* scene, const TCHAR* filename)
 {
-	PSShape*			mod;
-	PSSurface*			surf;
-	PSAppearances*		apps;
-	PSAppearances*		uniqapps = NULL;
-	int32				tot_apps = 0;
-	int32				tot_nodes = 0;
-	int32				tot_shapes = 0;
-	PSGroupIter<PSModel> iter(root, GROUP_DepthFirst);
-
-	while (mod = (PSShape*) (PSModel*) iter.Next())
-	{
-		++tot_nodes;						// count this node
-		if (!mod->IsClass(PSM_Shape))		// is it a shape?
-			continue;						// no, on to the next
-		++tot_shapes;						// count the shape
-		apps = mod->GetAppearances();		// get Appearances table
-		if (apps == uniqapps)				// no change needed
-			continue;
-		if (!apps)
-		{
-			mod->SetAppearances(uniqapps);	// use the global table
-			continue;
-		}
-		if (uniqapps == NULL)				// share the first non-null appearance table
-		{
-			uniqapps = apps;
-			continue;
-		}
-		mod->SetAppearances(uniqapps);		// use the global table
-		surf = mod->GetSurface();
-		if (surf == NULL)
-			continue;
-		for (int i = 0; i < apps->GetSize(); ++i)
-		{
-			PSGeometry* geo = surf->Find(i);
-			if (geo == NULL)
-				continue;
+	SceneOptimize	opt;
+	Model*			root = scene->GetModels();
+	bool			changed = false;
 
-			Ref<PSAppearance> a = apps->GetAt(i);
-			int32  n = uniqapps->Find(a);	// already have this one?
-			if (n < 0)						// no, let's add it
-			{
-				n = uniqapps->Append(a);
-				++tot_apps;					// another unique one
-			}
-			geo->SetAppIndex(n);
-		}
+	if (root == NULL)
+		return false;
+	const Stats& s = opt.GetStats();
+	if (opt.OptimizeStatic(root, scene->GetEngines()))
+	{
+		VX_TRACE(Debug, ("SceneOptimize %s: %d static shapes -> %d shapes in %d chunks, %d -> %d KB\n",
+			filename, s.ShapesBefore, s.ShapesAfter, s.Chunks,
+			int(s.BytesBefore / 1024), int(s.BytesAfter / 1024)));
+		changed = true;
 	}
-	PSM_PRINTF(("%d nodes, %d shapes, %d unique appearances", tot_nodes, tot_shapes, tot_apps));
-	return uniqapps;
-}
-
-
-PSModel* PSSceneOptimize::OptimizeStatic(PSModel* root)
-{
-	PSObjArray*	statmods;
-	PSModel*	statroot;
-	const char*	name = root->GetName();
-
-	m_StatRoots.SetSize(0);
-	if (name == NULL)
-		root->SetName("scene.root");
-	CollectStatic(root, PSMatrix::GetIdentity(), 0);	// collect the static shapes
-	if (m_StatRoots.GetSize() < 2)
-		return NULL;
-	statmods = (PSObjArray*) m_StatRoots.GetAt(1);
-	root = BuildStatic(root, statmods);
-	for (int i = 2; i < m_StatRoots.GetSize(); i += 2)
+	if (CompactOptions && (opt.CompactVertices(root, scene->GetEngines(), CompactOptions) > 0))
 	{
-		statroot = (PSModel*) m_StatRoots.GetAt(i);
-		statmods = (PSObjArray*) m_StatRoots.GetAt(i + 1);
-		if (statroot && statmods && !statmods->IsEmpty())	// make octree for each static root
-			BuildStatic(statroot, statmods);
+		VX_TRACE(Debug, ("SceneOptimize %s: %d vertex arrays compacted, %d -> %d KB\n",
+			filename, s.Compacted, int(s.CompactBefore / 1024), int(s.CompactAfter / 1024)));
+		changed = true;
 	}
-	m_StatRoots.Empty();
-	return root;
+	if ((MeshletFaces > 0) && (opt.MakeMeshlets(root, MeshletFaces) > 0))
+	{
+		VX_TRACE(Debug, ("SceneOptimize %s: %d meshes divided into %d meshlets\n",
+			filename, s.MeshletMeshes, s.Meshlets));
+		changed = true;
+	}
+	return changed;
 }
 
-#if 1
-PSModel* PSSceneOptimize::BuildStatic(PSModel* dynroot, const PSObjArray* statmods)
+/*!
+ * @fn bool SceneOptimize::OptimizeStatic(Model* root, const Engine* simroot)
+ * @param root		root of hierarchy to optimize
+ * @param simroot	root of simulation tree which animates the hierarchy
+ *
+ * Merges the static shapes in the hierarchy into large meshes.
+ * The meshes are transformed into the coordinate system of the root
+ * and merged into one set of spatial chunks for each appearance.
+ * The merged shapes are put in a new model called <root>.static
+ * which becomes the first child of the root. The shapes
+ * that were merged are removed from the hierarchy.
+ *
+ * This function changes the hierarchy without locking it and should
+ * not be called on a scene that is being displayed.
+ *
+ * @return \b true if any shapes were merged, else \b false
+ *
+ * @see SceneOptimize::GetStats SceneOptimize::PostLoad
+ */
+bool SceneOptimize::OptimizeStatic(Model* root, const Engine* simroot)
 {
-	PSObjArray::Iter iter(*statmods);
-	PSShape*	shape;
-	PSModel*	root;
-	PSOctree*	octree = new PSOctree;		// root of spatially sorted shapes
-	const char*	name = statmods->GetName();
-	char*		p;
-	char		namebuf[PSM_MaxString];
-	PSObjArray	surfaces;
-	PSBox3		bound;
-
-	PSAppearances* apps = UniqueAppearances(dynroot);
-	PSM_ASSERT(name);
-	strcpy(namebuf, name);
-	p = strrchr(namebuf, '.');
-	if (p)
-		*p = 0;
-	strcpy(p, ".static");	
-	while (shape = (PSShape*) iter.Next())	// remove static shapes from hierarchy
-	{
-		const PSMatrix* worldmtx = (const PSMatrix*) iter.Next();
-		PSSurface* surf = shape->GetSurface();
-		PSBox3 b;
+	Matrix			identity;
+	Model*			statroot;
+	Core::String	name;
+	int				first = 0;
 
-		PSM_ASSERT(worldmtx && worldmtx->IsClass(PSM_Matrix));
-		if (surf)
-		{
-			*surf *= *worldmtx;				// convert surface to world coords
-			surf->CalcBound(&b);
-			bound.Extend(b);				// compute overall bounding box
-			surfaces.Append(surf);			// save the surface
-			shape->SetSurface(NULL);		// disconnect surface we collected
-		}
-		while (shape && !shape->IsParent() && (shape != dynroot))
-		{
-			PSModel* mod = shape->Parent();
-			shape->Remove(GROUP_Free);		// nuke empty parent models
-			shape = (PSShape*) mod;
-		}
-			
-	}
+	memset(&m_Stats, 0, sizeof(m_Stats));
+	m_NumShapes = 0;
+	CollectTargets(simroot);
+	if (IsTarget(root))
+		return false;
+	GroupIter<Model> iter(root, Group::CHILDREN);
+	Model*	mod;
 
-	octree->SetAppearances(apps);
-	octree->SetName(namebuf);					// all statics in octree
-	if (octree->BuildTree(&surfaces, bound))	// make octree from surfaces
+	while (mod = iter.Next())			// collect from children
+		CollectStatic(mod, &identity);
+	KeepInstanced();
+	if (m_NumShapes < 2)				// nothing to merge?
+		return false;
+	m_Stats.ShapesBefore = m_NumShapes;
+	for (int i = 0; i < m_NumShapes; ++i)
+		m_Shapes[i].Source->IncUse();	// keep shapes around until we finish
+/*
+ * Group the shapes by appearance and vertex layout,
+ * then divide each group into spatial chunks and merge them.
+ */
+	statroot = new Model;
+	name = root->GetName() ? root->GetName() : TEXT("scene.root");
+	name += TEXT(".static");
+	statroot->SetName(name);
+	statroot->SetHints(Model::STATIC);
+	qsort(m_Shapes, m_NumShapes, sizeof(StaticShape), &CompareShapes);
+	for (int i = 1; i <= m_NumShapes; ++i)
 	{
-		root = new PSModel;
-		root->SetName(dynroot->GetName());		// make new root with no matrix
-		strcpy(p, ".dynamic");
-		dynroot->SetName(namebuf);				// name the dynamic tree
-		dynroot->Replace(root);					// replace the root
-		root->Append(octree);
-		root->Append(dynroot);
-		return root;
+		if ((i < m_NumShapes) &&
+			(m_Shapes[i].Appear == m_Shapes[first].Appear) &&
+			(m_Shapes[i].Layout == m_Shapes[first].Layout))
+			continue;
+		AssignCells(first, i);
+		BuildChunks(statroot, first, i);
+		first = i;
 	}
-	octree->Delete();							// octree failed
-	return NULL;
+/*
+ * Remove the original shapes. The shapes are sorted deepest first so
+ * children are removed before their parents and parents which end up
+ * empty can be removed too.
+ */
+	for (int i = 0; i < m_NumShapes; ++i)
+	{
+		m_Shapes[i].Depth = 0;
+		for (Model* mod = m_Shapes[i].Source->Parent(); mod && (mod != root); mod = mod->Parent())
+			++m_Shapes[i].Depth;
+	}
+	qsort(m_Shapes, m_NumShapes, sizeof(StaticShape), &CompareDepth);
+	for (int i = 0; i < m_NumShapes; ++i)
+		RemoveShape(root, m_Shapes[i].Source);
+	for (int i = 0; i < m_NumShapes; ++i)
+		m_Shapes[i].Source->Delete();
+	m_NumShapes = 0;
+	root->PutFirst(statroot);
+	return true;
 }
 
-#else
 /*
- * Extracts all static shapes into a separate scene graph but does not
- * do any spatial sorting
+ * Make a sorted table of all the objects targeted by engines
+ * in the simulation tree. Models which are targets may be
+ * moved by their engines so they cannot be static.
  */
-PSModel* PSSceneOptimize::BuildStatic(PSModel* dynroot, const PSObjArray* statmods)
+void SceneOptimize::CollectTargets(const Engine* simroot)
 {
-	PSObjArray::Iter iter(*statmods);
-	PSShape*	shape;
-	PSModel*	root;
-	PSModel*	statroot = new PSModel;		// root of spatially sorted shapes
-
-	const char*	name = statmods->GetName();
-	char*		p;
-	char		namebuf[PSM_MaxString];
-
-	PSM_ASSERT(name);
-	strcpy(namebuf, name);
-	p = strrchr(namebuf, '.');
-	if (p)
-		*p = NULL;
-	strcpy(p, ".static");	
-	statroot->SetName(namebuf);				// name the static tree
-	while (shape = (PSShape*) iter.Next())	// remove static shapes from hierarchy
+	int32	maxtargets = 0;
+
+	m_NumTargets = 0;
+	if (simroot == NULL)
+		return;
+	GroupIter<Engine> iter((Engine*) simroot, Group::DEPTH_FIRST);
+	Engine*	eng = (Engine*) simroot;
+
+	do
 	{
-		const PSMatrix* worldmtx = (const PSMatrix*) iter.Next();
-		PSModel* parent = shape->Parent();	// parent model
-		PSSurface* surf = shape->GetSurface();
+		SharedObj* target = eng->GetTarget();
 
-		if (!shape->IsParent())
-		{
-			PSM_ASSERT(worldmtx && worldmtx->IsClass(PSM_Matrix));
-			*surf *= *worldmtx;				// convert surface to world coords
-			shape->SetTransform((PSMatrix*) NULL);
-			shape->Remove(GROUP_DontFree);	// remove if a leaf shape
-			statroot->PutFirst(shape);
-		}
-		while (parent && !parent->IsParent() && (parent != dynroot))
+		if (target == NULL)
+			continue;
+		if (m_NumTargets >= maxtargets)
 		{
-			PSModel* mod = parent->Parent();
-			parent->Remove(GROUP_Free);		// nuke empty parent models
-			parent = mod;
+			maxtargets = maxtargets ? maxtargets * 2 : 64;
+			m_Targets = (intptr*) realloc(m_Targets, maxtargets * sizeof(intptr));
+			if (m_Targets == NULL)
+			{
+				m_NumTargets = 0;
+				VX_ERROR_RETURN(("SceneOptimize::CollectTargets ERROR out of memory\n"));
+			}
 		}
-			
+		m_Targets[m_NumTargets++] = (intptr) target;
 	}
-	root = new PSModel;
-	root->SetName(dynroot->GetName());		// make new root with no matrix
-	strcpy(p, ".dynamic");
-	dynroot->SetName(namebuf);				// name the dynamic tree
-	dynroot->Replace(root);					// replace the root
-	root->Append(statroot);
-	root->Append(dynroot);
-	return root;
+	while (eng = iter.Next());
+	qsort(m_Targets, m_NumTargets, sizeof(intptr), &CompareTargets);
+}
+
+bool SceneOptimize::IsTarget(const Model* mod) const
+{
+	intptr	key = (intptr) mod;
+
+	if (m_NumTargets == 0)
+		return false;
+	return bsearch(&key, m_Targets, m_NumTargets, sizeof(intptr), &CompareTargets) != NULL;
+}
+
+int SceneOptimize::CompareTargets(const void* p1, const void* p2)
+{
+	intptr	t1 = *((const intptr*) p1);
+	intptr	t2 = *((const intptr*) p2);
+
+	if (t1 < t2)
+		return -1;
+	if (t1 > t2)
+		return 1;
+	return 0;
 }
-#endif
 
 /*!
- * @fn bool PSSceneOptimize::CollectStatic(const PSModel* root, const PSMatrix* mtx, int level)
- * @param root		root of hierarchy to convert to world coordinates
- * @param mtx		initial matrix (usually identity)
- * @param level		0-based level index
+ * @fn void SceneOptimize::CollectStatic(Model* root, const Matrix* mtx)
+ * @param root		root of hierarchy to collect static shapes from
+ * @param mtx		matrix of the parent relative to the optimized root
  *
- * Collects all of the static geometry in the hierarchy and computes the
- * world matrix for each static surface.
+ * Collects the static shapes in the hierarchy and computes the
+ * matrix for each shape relative to the root being optimized.
+ * Parents are collected before their children.
  *
  * Billboards, sprites, level of detail nodes and other implementations
  * which update the local matrix or geometry are not collected.
@@ -231,178 +237,500 @@ PSModel* PSSceneOptimize::BuildStatic(PSModel* dynroot, const PSObjArray* statmo
  * Only shapes which have no parents that update the local matrix can be
  * kept in the static scene.
  *
- * This routine is useful for optimizing static scenery. By collecting the
- * surfaces, their meshes may be spatially sorted for more efficient rendering.
- * For simple scenes, all of the static scenery can be extracted and put into a
- * single octree. More complex scenes, such as those using portal visiblity,
- * may require multiple octrees.
- *
- * This routine only collects the surfaces - it does not change the
+ * This routine only collects the shapes - it does not change the
  * structure or contents of the input hierarchy.
  *
- * @return true this model and children are static, else false
- *
- * @see PSSceneOptimize::UniqueAppearances PSSceneOptimize::BuildStatic
- * @see PSRoomGroup PSOctree::BuildTree 
+ * @see SceneOptimize::OptimizeStatic
  */
-bool PSSceneOptimize::CollectStatic(const PSModel* root, const PSMatrix* mtx, int level)
+void SceneOptimize::CollectStatic(Model* root, const Matrix* mtx)
 {
-	const PSModel*	statroot;				// root of hierarchy
-	PSObjArray*		statmods;				// static models for this hierarchy
-	Ref<PSMatrix>	worldmtx = (PSMatrix*) NULL;
+	Matrix		worldmtx(*mtx);
+	uint32		classid = root->ClassID();
 
-	if (level >= m_StatRoots.GetSize())		// need to add a new root?
-	{
-		statroot = root;					// remember this root
-		m_StatRoots.Append(statroot);
-		statmods = new PSObjArray;			// make new static models collection
-		statmods->SetName(root->GetName());
-		m_StatRoots.Append(statmods);		// remember it too
-	}
-	else									// use existing collection
+	if ((classid != VX_Model) && (classid != VX_Shape))
+		return;								// not a model or shape, don't descend
+	if ((root->GetHints() & Model::MORPH) || IsTarget(root))
+		return;
+	root->CalcMatrix(&worldmtx, NULL);		// concatenate with input matrix
+	if (classid == VX_Shape)
 	{
-		statroot = (const PSModel*) m_StatRoots.GetAt(level);
-		PSM_ASSERT(statroot && statroot->IsClass(PSM_Model));
-		statmods = (PSObjArray*) m_StatRoots.GetAt(level + 1);
-		PSM_ASSERT(statmods && statmods->IsClass(PSM_Array));
-	}
-	if (root->IsClass(PSM_RoomGroup))		// room group is a special case
-	{
-		PSRoomGroup*		roomgroup = (PSRoomGroup*) root;
-		PSObjArray::Iter	iter(roomgroup->GetRooms());
-		PSRoom*				room;
+		Shape*			shape = (Shape*) root;
+		const TriMesh*	mesh = (const TriMesh*) shape->GetGeometry();
+		const VertexArray* verts;
+		Box3			bound;
+
+		if (mesh && mesh->IsClass(VX_TriMesh) &&
+			(verts = mesh->GetVertices()) && verts->GetLayout() &&
+			!verts->GetLayout()->IsCompact() &&		// merging transforms float vertices
 
-		roomgroup->RemoveMatrix();
-		while (room = (PSRoom*) iter.Next())
+			(mesh->GetNumIdx() >= 3) &&
+			mesh->GetBound(&bound))
 		{
-			Ref<PSModel> fixture = room->GetFixture();
-			if (fixture != (const PSModel*) NULL)	// room has contents?
+			if (m_NumShapes >= m_MaxShapes)
 			{
-				char	namebuf[PSM_MaxString];
-
-				level += 2;					// make empty node to contain static models laster
-				CollectStatic(fixture, mtx, level);
-				statmods = (PSObjArray*) m_StatRoots.GetAt(level + 1);
-				strcpy(namebuf, room->GetName());
-				strcat(namebuf, ".static");
-				statmods->SetName(namebuf);
+				int32			n = m_MaxShapes ? m_MaxShapes * 2 : 256;
+				StaticShape*	shapes = (StaticShape*) realloc(m_Shapes, n * sizeof(StaticShape));
+
+				if (shapes == NULL)
+					VX_ERROR_RETURN(("SceneOptimize::CollectStatic ERROR out of memory\n"));
+				m_Shapes = shapes;
+				m_MaxShapes = n;
 			}
+			StaticShape* s = &m_Shapes[m_NumShapes++];
+			s->Source = shape;
+			s->Appear = shape->GetAppearance();
+			s->Layout = verts->GetLayout();
+			s->Cell = 0;
+			memcpy(s->World, worldmtx.GetMatrix(), 16 * sizeof(float));
+			worldmtx.Transform(bound.Center(), s->Center);
 		}
-		return false;
 	}
-	if (root->GetTransform()->IsIdentity())	// local matrix is identity
-		worldmtx = mtx;
-	else									// make a new world matrix
+	GroupIter<Model> iter(root, Group::CHILDREN);
+	Model*	mod;
+
+	while (mod = iter.Next())				// collect from children
+		CollectStatic(mod, &worldmtx);
+}
+
+/*
+ * Geometry which is referenced by several static shapes is
+ * removed from the static set so it can be rendered with instancing
+ * instead of being duplicated in the merged meshes.
+ * Computes the memory used by the remaining static geometry.
+ * The shapes are left in their original (parent first) order.
+ */
+void SceneOptimize::KeepInstanced()
+{
+	int32	first = 0;
+	int32	n = 0;
+
+	if (m_NumShapes == 0)
+		return;
+	for (int i = 0; i < m_NumShapes; ++i)
+		m_Shapes[i].Cell = i;				// remember original order
+	qsort(m_Shapes, m_NumShapes, sizeof(StaticShape), &CompareGeometry);
+	for (int i = 1; i <= m_NumShapes; ++i)
+	{
+		const Geometry* geo = m_Shapes[first].Source->GetGeometry();
+
+		if ((i < m_NumShapes) && (m_Shapes[i].Source->GetGeometry() == geo))
+			continue;
+		if ((GeoSorter::MinInstances > 1) && (i - first >= GeoSorter::MinInstances))
+		{
+			first = i;						// leave these for instancing
+			continue;
+		}
+		m_Stats.BytesBefore += GetBytes((const Mesh*) geo);
+		while (first < i)
+			m_Shapes[n++] = m_Shapes[first++];
+	}
+	m_NumShapes = n;
+	qsort(m_Shapes, m_NumShapes, sizeof(StaticShape), &CompareShapes);
+	for (int i = 0; i < m_NumShapes; ++i)
+		m_Shapes[i].Cell = 0;
+}
+
+/*
+ * Sort by geometry address, preserving the original order
+ * (saved in Cell) for shapes with the same geometry.
+ */
+int SceneOptimize::CompareGeometry(const void* p1, const void* p2)
+{
+	const StaticShape* s1 = (const StaticShape*) p1;
+	const StaticShape* s2 = (const StaticShape*) p2;
+	intptr	g1 = (intptr) s1->Source->GetGeometry();
+	intptr	g2 = (intptr) s2->Source->GetGeometry();
+
+	if (g1 < g2)
+		return -1;
+	if (g1 > g2)
+		return 1;
+	return s1->Cell - s2->Cell;
+}
+
+/*
+ * Sort shapes by decreasing depth in the hierarchy
+ */
+int SceneOptimize::CompareDepth(const void* p1, const void* p2)
+{
+	const StaticShape* s1 = (const StaticShape*) p1;
+	const StaticShape* s2 = (const StaticShape*) p2;
+
+	return s2->Depth - s1->Depth;
+}
+
+/*
+ * Sort by appearance, vertex layout and spatial chunk.
+ * The original order (saved in Cell) is used before chunks are assigned.
+ */
+int SceneOptimize::CompareShapes(const void* p1, const void* p2)
+{
+	const StaticShape* s1 = (const StaticShape*) p1;
+	const StaticShape* s2 = (const StaticShape*) p2;
+
+	if (s1->Appear != s2->Appear)
+		return ((intptr) s1->Appear < (intptr) s2->Appear) ? -1 : 1;
+	if (s1->Layout != s2->Layout)
+		return ((intptr) s1->Layout < (intptr) s2->Layout) ? -1 : 1;
+	return s1->Cell - s2->Cell;
+}
+
+/*!
+ * @fn void SceneOptimize::AssignCells(int first, int last)
+ * @param first	index of first shape in group
+ * @param last	index after last shape in group
+ *
+ * Divides the space occupied by a group of shapes with the same appearance
+ * into a grid of chunks and assigns each shape to the chunk containing its center.
+ * If SceneOptimize::ChunkSize is zero, the chunk size is chosen so that each
+ * chunk would be about half full if the vertices were evenly distributed.
+ * Shapes within a group are sorted by chunk afterwards.
+ */
+void SceneOptimize::AssignCells(int first, int last)
+{
+	Box3	bound;
+	Vec3	ext;
+	intptr	nverts = 0;
+	float	size = ChunkSize;
+	int		nx, ny, nz;
+
+	for (int i = first; i < last; ++i)
 	{
-		worldmtx = new PSMatrix(*mtx);
-		root->CalcMatrix(worldmtx, PSGetScene());			// concatenate with input matrix
+		bound.Extend(m_Shapes[i].Center);
+		nverts += m_Shapes[i].Source->GetGeometry()->GetNumVtx();
 	}
-	switch (root->ClassID())
+	ext.x = bound.Width();
+	ext.y = bound.Height();
+	ext.z = bound.Depth();
+	if (size <= 0.0f)
 	{
-		case PSM_Shape:						// for a shape - transform geometry
-		if (root->GetHints() & MOD_MorphBounds)
-			return false;
-		break;
+		float	maxext = ext.x;
+		float	ncells = (2.0f * nverts) / MaxChunkVerts;
 
-		case PSM_Model:
-		break;
+		if (ext.y > maxext)
+			maxext = ext.y;
+		if (ext.z > maxext)
+			maxext = ext.z;
+		if ((ncells <= 1.0f) || (maxext <= 0.0f))
+			return;							// everything fits in one chunk
+		maxext *= 0.01f;					// flat scenes still get square chunks
+		size = powf(((ext.x > maxext) ? ext.x : maxext) *
+					((ext.y > maxext) ? ext.y : maxext) *
+					((ext.z > maxext) ? ext.z : maxext) / ncells, 1.0f / 3.0f);
+	}
+	nx = 1 + int(ext.x / size);
+	ny = 1 + int(ext.y / size);
+	nz = 1 + int(ext.z / size);
+	for (int i = first; i < last; ++i)
+	{
+		const Vec3&	c = m_Shapes[i].Center;
+		int			ix = int((c.x - bound.min.x) / size);
+		int			iy = int((c.y - bound.min.y) / size);
+		int			iz = int((c.z - bound.min.z) / size);
 
-		default:							// not a model or shape?
-		return false;						// don't descend further
+		if (ix >= nx) ix = nx - 1;
+		if (iy >= ny) iy = ny - 1;
+		if (iz >= nz) iz = nz - 1;
+		m_Shapes[i].Cell = ix + nx * (iy + ny * iz);
 	}
+	qsort(m_Shapes + first, last - first, sizeof(StaticShape), &CompareShapes);
+}
+
+/*!
+ * @fn void SceneOptimize::BuildChunks(Model* statroot, int first, int last)
+ * @param statroot	model to add merged shapes to
+ * @param first		index of first shape in group
+ * @param last		index after last shape in group
+ *
+ * Merges the shapes in each chunk of a group into one or more meshes.
+ * A new mesh is started when the current one would exceed
+ * SceneOptimize::MaxChunkVerts vertices.
+ */
+void SceneOptimize::BuildChunks(Model* statroot, int first, int last)
+{
+	const Appearance*	appear = m_Shapes[first].Appear;
+	const DataLayout*	layout = m_Shapes[first].Layout;
+	TriMesh*			mesh = NULL;
+	int32				cell = -1;
 
-	PSGroupIter<PSModel> iter(root, GROUP_TopOnly);
-	const PSModel*	mod;
+	for (int i = first; i < last; ++i)
+	{
+		StaticShape*	src = &m_Shapes[i];
+		intptr			nvtx = src->Source->GetGeometry()->GetNumVtx();
 
-	while (mod = iter.Next())				// collect from children
-		CollectStatic(mod, worldmtx, level);
+		if (src->Cell != cell)				// new chunk?
+		{
+			cell = src->Cell;
+			++m_Stats.Chunks;
+			mesh = NULL;
+		}
+		else if (mesh && (mesh->GetNumVtx() + nvtx > MaxChunkVerts))
+			mesh = NULL;					// mesh is full
+		if (mesh == NULL)
+		{
+			Shape*	shape = new Shape;
 
-	if (root->IsClass(PSM_Shape))
+			mesh = new TriMesh(layout->Descriptor, nvtx);
+			shape->SetGeometry(mesh);
+			shape->SetAppearance(appear);
+			shape->SetHints(Model::STATIC);
+			statroot->Append(shape);
+			++m_Stats.ShapesAfter;
+		}
+		m_Stats.BytesAfter -= GetBytes(mesh);
+		MergeShape(mesh, src);
+		m_Stats.BytesAfter += GetBytes(mesh);
+	}
+}
+
+/*!
+ * @fn bool SceneOptimize::MergeShape(TriMesh* dst, StaticShape* src)
+ * @param dst	mesh to merge into
+ * @param src	static shape to merge
+ *
+ * Appends the triangles of the shape's mesh to the destination mesh.
+ * Only the vertices referenced by the triangles are copied. They are
+ * transformed into the coordinate system of the optimized root
+ * (which also transforms the normals).
+ *
+ * @return \b true if shape was merged, \b false on error
+ */
+bool SceneOptimize::MergeShape(TriMesh* dst, StaticShape* src)
+{
+	const TriMesh*		mesh = (const TriMesh*) src->Source->GetGeometry();
+	const VertexArray*	verts = mesh->GetVertices();
+	const float*		vdata = verts->GetData();
+	int					vtxsize = verts->GetVtxSize();
+	intptr				nvtx = verts->GetNumVtx();
+	Ref<VertexArray>	tmpverts = new VertexArray(src->Layout->Descriptor, nvtx);
+	Matrix				mtx(src->World);
+	intptr				ofs = dst->GetNumVtx();
+	intptr				n = 0;
+	intptr				i0, i1, i2;
+	int32*				map;
+	int32				tri[3];
+
+	if (!m_VtxMap.SetSize(nvtx))
+		VX_ERROR(("SceneOptimize::MergeShape ERROR out of memory\n"), false);
+	map = m_VtxMap.GetData();
+	memset(map, -1, nvtx * sizeof(int32));
+	TriMesh::TriIter	triter(mesh);
+	while (triter.Next(i0, i1, i2))			// copy referenced vertices
 	{
-		statmods->Append(root);				// save shape in static model list
-		statmods->Append((const PSMatrix*) worldmtx);	// save its world matrix too
+		intptr	idx[3] = { i0, i1, i2 };
+
+		for (int j = 0; j < 3; ++j)
+		{
+			intptr	v = idx[j];
+
+			VX_ASSERT((v >= 0) && (v < nvtx));
+			if (map[v] < 0)
+			{
+				map[v] = (int32) n++;
+				tmpverts->AddVertices(vdata + v * vtxsize, 1);
+			}
+			tri[j] = int32(ofs + map[v]);
+		}
+		dst->AddIndices(tri, 3);
 	}
-	return true;
+	*((VertexArray*) tmpverts) *= mtx;		// transform into root coordinates
+	return dst->AddVertices(tmpverts->GetData(), n) >= 0;
 }
 
 /*!
- * @fn void PSSceneOptimize::OptimizeVerts(PSSurface* surf)
+ * @fn int32 SceneOptimize::CompactVertices(Model* root, const Engine* simroot, int opts)
+ * @param root		root of hierarchy whose vertices should be compacted
+ * @param simroot	root of simulation tree which animates the hierarchy
+ * @param opts		vertex components to compact, see VertexPool::MakeCompactLayout
+ *
+ * Replaces the vertex arrays of the triangle meshes in the hierarchy
+ * with arrays which store the same vertices in compact formats.
+ * A vertex array shared by several meshes is converted once.
+ * Vertices which are changed at run time (meshes of shapes targeted
+ * by engines and vertex arrays with the VertexPool::MORPH flag) and meshes
+ * which are subclasses of TriMesh, like text, are left alone because they
+ * are updated as floats.
+ *
+ * Quantized locations and octahedral or 10:10:10:2 normals
+ * (VertexPool::COMPACT_LOCATIONS and VertexPool::COMPACT_NORMALS) must be
+ * decoded by the vertex shader and the shaders supplied with Vixen do not.
+ * They are only used if the application sets SceneOptimize::ShaderDecode
+ * to indicate its shaders decode them, otherwise they are dropped from
+ * the options with a warning and only the formats the GPU expands are used.
  *
- * Sorts the indices and vertices of the meshes in the surface based on
- * the order the vertices are used by the primitives.
- * Duplicate vertices are coalesced so that the one vertex
- * array contaiing only unique vertices is shared by all meshes.
+ * This function changes the hierarchy without locking it and should
+ * not be called on a scene that is being displayed.
  *
- * This routine correctly optimizes multiple meshes sharing the same
- * vertex and/or index arrays.
+ * @return number of vertex arrays converted
  *
- * @see PSSurface PSTriangles
+ * @see VertexPool::Convert SceneOptimize::PostLoad SceneOptimize::GetStats
  */
-void PSSceneOptimize::OptimizeVerts(PSSurface* surf)
+int32 SceneOptimize::CompactVertices(Model* root, const Engine* simroot, int opts)
 {
-	int32		i;
-	int32		nvtx;			/* no of vertices */
-	int32		nidx;			/* no of indices */
-	int32		j = 0;
-	
-	PSSurface::Iter	siter(surf);
-	PSTriMesh*		mesh;
-	PSIndexArray	vtx_map;
-	PSVtxArray*		new_vtx = NULL;
-	PSIndexArray*	new_idx = NULL;
-
-	while (mesh = (PSTriMesh*) siter.Next())
+	GroupIter<Shape>	iter((Shape*) root, Group::DEPTH_FIRST);
+	Shape*				shape;
+	Core::String		desc;
+	VertexArray**		converted = NULL;	// pairs of original and compact arrays
+	int32				nconverted = 0;
+	int32				maxconverted = 0;
+
+	m_Stats.Compacted = 0;
+	m_Stats.CompactBefore = 0;
+	m_Stats.CompactAfter = 0;
+	if (!ShaderDecode && (opts & (VertexPool::COMPACT_LOCATIONS | VertexPool::COMPACT_NORMALS)))
+	{
+		VX_WARNING(("SceneOptimize::CompactVertices shaders do not decode quantized locations or octahedral normals\n"));
+		opts &= ~(VertexPool::COMPACT_LOCATIONS | VertexPool::COMPACT_NORMALS | VertexPool::COMPACT_PACKED);
+		if (opts == 0)
+			return 0;
+	}
+	CollectTargets(simroot);
+	while (shape = iter.Next())
 	{
-		if (!mesh->IsClass(PSM_TriMesh))		/* not a triangle mesh */
+		TriMesh*		mesh;
+		VertexArray*	verts;
+		VertexArray*	compact = NULL;
+
+		if (!shape->IsClass(VX_Shape) || IsTarget(shape))
 			continue;
-		if ((nvtx = mesh->GetNumVtx()) <= 0)	/* no vertices in mesh */
+		mesh = (TriMesh*) shape->GetGeometry();
+		if ((mesh == NULL) || (mesh->ClassID() != VX_TriMesh))
 			continue;
-		if ((nidx = mesh->GetNumIdx()) <= 0)	/* do we have indices? */
-			continue;							/* no, skip this one */
-		if (new_vtx == NULL)
-			new_vtx = new PSVtxArray(mesh->GetStyle(), nvtx);
-		else if (new_vtx->GetStyle() != mesh->GetStyle())
-			continue;							/* vertex style incompatible */
-
-		int firstvtx = vtx_map.GetSize();		/* set unused map cells to -1 */
-		vtx_map.SetSize(firstvtx + nvtx);		/* enlarge vertex map */
-		memset(vtx_map.GetData() + firstvtx * vtx_map.GetElemSize(), -1, nvtx * vtx_map.GetElemSize());
-		if (new_idx == NULL)					/* allocate new index array */
-			new_idx = new PSIndexArray(nidx);
-		new_idx->SetSize(new_idx->GetSize() + nidx);
-/*
- * Sort the vertices in the order they are used by the primitives.
- * Copy the vertices into a new array so that they are in
- * the same order as the primitives. Construct a mapping
- * array which gives the new location of each vertex (using
- * the old vertex location as an index). The vertex map entries
- * are initialized as -1 so that vertices that are mapped can
- * be detected and not remapped.
- */
-		PSTriangles::PrimIter iter(mesh);
-		const PSTriPrim* prim;
-
-		while (prim = iter.Next())				/* for each primitive */
+		verts = mesh->GetVertices();
+		if ((verts == NULL) || verts->IsSet(VertexPool::MORPH))
+			continue;
+		for (int32 i = 0; i < nconverted; ++i)		// already converted?
+			if (converted[i * 2] == verts)
+			{
+				compact = converted[i * 2 + 1];
+				break;
+			}
+		if (compact == NULL)
 		{
-			for (i = 0; i < prim->Size; ++i)	/* for each vertex */
+			if (!VertexPool::MakeCompactLayout(desc, verts->GetLayout(), opts))
+				continue;
+			compact = new VertexArray(desc);
+			if (!compact->Convert(verts))
 			{
-				int32 v = mesh->GetIndex(i + prim->VtxIndex);
-				PSM_ASSERT(v >= 0);
-				if (vtx_map[v] < 0)				/* has this one been added? */
+				compact->Delete();
+				continue;
+			}
+			++m_Stats.Compacted;
+			m_Stats.CompactBefore += int64(verts->GetNumVtx()) * verts->GetVtxSize() * sizeof(float);
+			m_Stats.CompactAfter += int64(compact->GetNumVtx()) * compact->GetVtxSize() * sizeof(float);
+			if (verts->GetUse() > 1)				// shared by other meshes?
+			{
+				if (nconverted >= maxconverted)
 				{
-					float tmpvtx[VTX_MaxVtxSize];
+					int32			n = maxconverted ? maxconverted * 2 : 64;
+					VertexArray**	p = (VertexArray**) realloc(converted, n * 2 * sizeof(VertexArray*));
 
-					mesh->GetVertices()->GetVertex(v, tmpvtx);
-					if ((j = new_vtx->Find(tmpvtx)) < 0)
-						j = new_vtx->Append(tmpvtx);
-					vtx_map.SetAt(v, PSVtxIndex(j));
+					if (p)
+					{
+						converted = p;
+						maxconverted = n;
+					}
+				}
+				if (nconverted < maxconverted)		// otherwise it is converted again
+				{
+					verts->IncUse();				// keep both until we finish
+					compact->IncUse();
+					converted[nconverted * 2] = verts;
+					converted[nconverted * 2 + 1] = compact;
+					++nconverted;
 				}
-				PSM_ASSERT(v != PSVtxIndex(-1));
-				new_idx->SetAt(j++, v);			/* add new index to table */
 			}
 		}
-		mesh->SetVertices(new_vtx);				/* use new vertex array */
-		mesh->SetIndices(new_idx);				/* use new index array */
-		mesh->CompressPrims();					/* optimize primitive usage */
+		mesh->SetVertices(compact);
 	}
+	for (int32 i = 0; i < nconverted * 2; ++i)
+		converted[i]->Delete();
+	if (converted)
+		free(converted);
+	return m_Stats.Compacted;
 }
+
+/*!
+ * @fn int32 SceneOptimize::MakeMeshlets(Model* root, int32 minfaces)
+ * @param root		root of hierarchy whose meshes should be divided
+ * @param minfaces	minimum number of triangles in a mesh to divide
+ *
+ * Divides the triangle meshes in the hierarchy which have at least
+ * \b minfaces triangles into meshlets with the default limits.
+ * Meshes shared by several shapes (which may be instanced),
+ * meshes with animated vertices and subclasses of TriMesh, like text,
+ * are left alone because their meshlets would not be used.
+ *
+ * @return number of meshes divided into meshlets
+ *
+ * @see TriMesh::MakeMeshlets SceneOptimize::PostLoad SceneOptimize::GetStats
+ */
+int32 SceneOptimize::MakeMeshlets(Model* root, int32 minfaces)
+{
+	GroupIter<Shape>	iter((Shape*) root, Group::DEPTH_FIRST);
+	Shape*				shape;
+
+	m_Stats.MeshletMeshes = 0;
+	m_Stats.Meshlets = 0;
+	while (shape = iter.Next())
+	{
+		TriMesh*			mesh;
+		const VertexArray*	verts;
+
+		if (!shape->IsClass(VX_Shape))
+			continue;
+		mesh = (TriMesh*) shape->GetGeometry();
+		if ((mesh == NULL) || (mesh->ClassID() != VX_TriMesh) ||
+			(mesh->GetNumShapes() > 1) || (mesh->GetNumFaces() < minfaces))
+			continue;
+		verts = mesh->GetVertices();
+		if ((verts == NULL) || verts->IsSet(VertexPool::MORPH))
+			continue;
+		if ((mesh->GetNumMeshlets() == 0) && !mesh->MakeMeshlets())
+			continue;
+		++m_Stats.MeshletMeshes;
+		m_Stats.Meshlets += mesh->GetNumMeshlets();
+	}
+	return m_Stats.MeshletMeshes;
+}
+
+/*
+ * Remove a merged shape from the hierarchy. If the shape has
+ * children, only its geometry is removed. Unnamed models which
+ * become empty are removed too.
+ */
+void SceneOptimize::RemoveShape(Model* root, Shape* shape)
+{
+	Model*	parent = shape->Parent();
+
+	if (parent == NULL)
+		return;
+	if (shape->IsParent())
+	{
+		shape->SetGeometry(NULL);
+		return;
+	}
+	shape->Remove();
+	while (parent && (parent != root) && !parent->IsParent() &&
+		   parent->IsClass(VX_Model) && (parent->GetName() == NULL))
+	{
+		Model* mod = parent->Parent();
+		parent->Remove();
+		parent = mod;
+	}
+}
+
+/*
+ * Return the number of vertex and index bytes used by a mesh
+ */
+int64 SceneOptimize::GetBytes(const Mesh* mesh)
+{
+	const VertexArray* verts = mesh->GetVertices();
+	int64	bytes = mesh->GetNumIdx() * sizeof(int32);
+
+	if (verts)
+		bytes += int64(verts->GetNumVtx()) * verts->GetVtxSize() * sizeof(float);
+	return bytes;
+}
+
+}	// end Vixen
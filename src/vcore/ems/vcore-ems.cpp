@@ -18,8 +18,12 @@ namespace Core {
 	
 double	GetTime()
 {
-	float t = emscripten_get_now() / 1000.0f;
-	return t;
+	return emscripten_get_now() / 1000.0;
+}
+
+int64	GetTimeNS()
+{
+	return int64(emscripten_get_now() * 1000000.0);
 }
 
 /*!
@@ -64,6 +68,8 @@ void _cdecl CoreExit()
 {
 	if (GlobalAllocator::s_ptheOneAndOnly == NULL)
 		return;
+	Epoch::SetEnabled(false);				// free retired objects
+	AtomTable::FreeAll();					// free interned names
 	_vStringPool->FreeAll();
 	delete _vStringPool;
 	_vStringPool = NULL;
@@ -46,8 +46,11 @@ void _cdecl CoreExit()
 {
 	if (GlobalAllocator::s_ptheOneAndOnly == NULL)
 		return;
+	Epoch::SetEnabled(false);				// free retired objects
+	AtomTable::FreeAll();					// free interned names
 	_vStringPool->FreeAll();
 	TLSData::Shutdown();
+	Profiler::Shutdown();
 	delete _vStringPool;
 	_vStringPool = NULL;
 	delete PoolAllocator::s_ptheOneAndOnly;
@@ -1,4 +1,5 @@
 #include "vcore/vcore.h"
+#include <time.h>
 //#include "vcore/vlock.h"
 //#include "asm/errno.h"
 
@@ -7,13 +8,33 @@ namespace Core {
 
 bool	CritSec::DoLock = false;
 
-float GetTime()
+/*!
+ * @fn double GetTime()
+ *
+ * Returns the time in seconds from a monotonic clock.
+ * The clock is not affected by changes to the system time
+ * and keeps sub-microsecond precision after days of uptime.
+ *
+ * @see GetTimeNS
+ */
+double GetTime()
+{
+	return double(GetTimeNS()) * 1e-9;
+}
+
+/*!
+ * @fn int64 GetTimeNS()
+ *
+ * Returns the time in nanoseconds from a monotonic clock.
+ *
+ * @see GetTime
+ */
+int64 GetTimeNS()
 {
-	timeval tv;
-	unsigned long tv_ms;
-	gettimeofday( &tv, NULL );
-	tv_ms = (tv.tv_sec * 1000) + tv.tv_usec;
-	return (float)tv_ms * 0.001f;
+	timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return int64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
 }
 
 
@@ -0,0 +1,243 @@
+#include "vcore/vcore.h"
+#ifndef _WIN32
+#include <sched.h>
+#endif
+
+namespace Vixen {
+namespace Core {
+
+AtomTable::Entry*	AtomTable::s_Blocks[ATOM_MaxBlocks];
+Atom*				AtomTable::s_Buckets = NULL;
+uint32				AtomTable::s_NumBuckets = 0;
+vint32				AtomTable::s_Size = 0;
+
+static vint32	s_AtomLock = 0;		// guards hash buckets and new atoms
+
+static void LockAtoms()
+{
+	while (!InterlockTestSet(&s_AtomLock, 1, 0))
+#ifdef _WIN32
+		::Sleep(0);
+#else
+		sched_yield();
+#endif
+}
+
+static void UnlockAtoms()
+{
+	InterlockSet(&s_AtomLock, 0);
+}
+
+/*!
+ * @fn uint32 AtomTable::Hash(const TCHAR* name)
+ * @param name	string to hash
+ *
+ * Computes a case insensitive hash of a string. This is
+ * the same hash BaseDict::HashStr computes so dictionaries
+ * which use atom hashes distribute names the same way.
+ *
+ * @see AtomTable::GetHash BaseDict::HashStr
+ */
+uint32 AtomTable::Hash(const TCHAR* name)
+{
+	uint32	c, result = 0;
+
+	if (name == NULL)
+		return 0;
+	while (c = *name++)
+	{
+		result += (result << 3);
+		if (isalpha(c))
+			result += tolower(c);
+		else
+			result += c;
+	}
+	return result;
+}
+
+/*!
+ * @fn Atom AtomTable::Intern(const TCHAR* name)
+ * @param name	string to intern, may be NULL
+ *
+ * Returns the atom for the given string, adding it to the table
+ * if it is not already there. Strings which differ only in case get
+ * different atoms which have the same folded atom.
+ *
+ * @return atom for the string, zero if the string is NULL or empty
+ *
+ * @see AtomTable::Find AtomTable::GetString AtomTable::GetFolded
+ */
+Atom AtomTable::Intern(const TCHAR* name)
+{
+	Atom	folded = 0;
+	Atom	atom;
+	uint32	hash;
+
+	if ((name == NULL) || (*name == 0))
+		return 0;
+	hash = Hash(name);
+	LockAtoms();
+	if (atom = Lookup(name, hash, &folded))
+	{
+		UnlockAtoms();
+		return atom;
+	}
+	if (s_Size == 0)
+		s_Size = 1;							// atom zero is the empty name
+	atom = s_Size;
+	if (((atom / ATOM_BlockSize) >= ATOM_MaxBlocks) ||
+		(((s_Blocks[atom / ATOM_BlockSize] == NULL) || (atom >= s_NumBuckets)) && !Grow()))
+	{
+		UnlockAtoms();
+		VX_ERROR(("AtomTable::Intern ERROR cannot add atom for %s\n", name), 0);
+	}
+	Entry*	e = GetEntry(atom);
+	uint32	b = hash & (s_NumBuckets - 1);
+
+	new ((void*) &(e->Name)) String(name);
+	e->Hash = hash;
+	e->Folded = folded ? folded : atom;
+	e->Next = s_Buckets[b];
+	s_Buckets[b] = atom;
+	InterlockSet(&s_Size, atom + 1);
+	UnlockAtoms();
+	return atom;
+}
+
+/*!
+ * @fn Atom AtomTable::Find(const TCHAR* name)
+ * @param name	string to find, may be NULL
+ *
+ * Returns the atom for the given string without adding it.
+ * If the string itself has not been interned, an atom which
+ * matches it ignoring case is returned. Looking up names which
+ * are not in the table does not make it grow.
+ *
+ * @return atom for the string, zero if no matching name has been interned
+ *
+ * @see AtomTable::Intern
+ */
+Atom AtomTable::Find(const TCHAR* name)
+{
+	Atom	folded = 0;
+	Atom	atom;
+	uint32	hash;
+
+	if ((name == NULL) || (*name == 0) || (s_Size == 0))
+		return 0;
+	hash = Hash(name);
+	LockAtoms();
+	atom = Lookup(name, hash, &folded);
+	UnlockAtoms();
+	return atom ? atom : folded;
+}
+
+/*!
+ * @fn const String& AtomTable::GetString(Atom atom)
+ * @param atom	atom to get string for
+ *
+ * The string returned shares its data with the string in the
+ * atom table so copying it does not allocate memory.
+ *
+ * @return string for the atom, empty string for atom zero
+ *
+ * @see AtomTable::Intern
+ */
+const String& AtomTable::GetString(Atom atom)
+{
+	static String	empty;
+
+	if ((atom == 0) || (atom >= (Atom) s_Size))
+		return empty;
+	return GetEntry(atom)->Name;
+}
+
+/*
+ * Finds the atom for a string in the hash bucket for its hash.
+ * Returns the folded atom of the first name which matches
+ * ignoring case in \b folded. The atom table must be locked.
+ */
+Atom AtomTable::Lookup(const TCHAR* name, uint32 hash, Atom* folded)
+{
+	if (s_Buckets == NULL)
+		return 0;
+	for (Atom atom = s_Buckets[hash & (s_NumBuckets - 1)]; atom; )
+	{
+		Entry*	e = GetEntry(atom);
+
+		if (e->Hash == hash)
+		{
+			if (STRCMP(e->Name, name) == 0)
+				return atom;
+			if ((*folded == 0) && (STRCASECMP(e->Name, name) == 0))
+				*folded = e->Folded;
+		}
+		atom = e->Next;
+	}
+	return 0;
+}
+
+/*
+ * Makes room for atom number s_Size. Allocates the next
+ * block of atoms if necessary and doubles the number of hash buckets
+ * when there are as many atoms as buckets. The atom table must be locked.
+ */
+bool AtomTable::Grow()
+{
+	uint32	b = s_Size / ATOM_BlockSize;
+	uint32	n = s_NumBuckets ? (s_NumBuckets * 2) : ATOM_BlockSize;
+	Atom*	buckets;
+
+	if (s_Blocks[b] == NULL)
+	{
+		s_Blocks[b] = (Entry*) calloc(ATOM_BlockSize, sizeof(Entry));
+		if (s_Blocks[b] == NULL)
+			return false;
+	}
+	if ((Atom) s_Size < s_NumBuckets)
+		return true;
+	buckets = (Atom*) calloc(n, sizeof(Atom));
+	if (buckets == NULL)
+		return false;
+	for (Atom atom = 1; atom < (Atom) s_Size; ++atom)
+	{
+		Entry*	e = GetEntry(atom);
+		uint32	i = e->Hash & (n - 1);
+
+		e->Next = buckets[i];
+		buckets[i] = atom;
+	}
+	if (s_Buckets)
+		free(s_Buckets);
+	s_Buckets = buckets;
+	s_NumBuckets = n;
+	return true;
+}
+
+/*!
+ * @fn void AtomTable::FreeAll()
+ *
+ * Frees all the atoms and their strings. Called from CoreExit.
+ * Atoms obtained before this call are no longer valid.
+ */
+void AtomTable::FreeAll()
+{
+	LockAtoms();
+	for (Atom atom = 1; atom < (Atom) s_Size; ++atom)
+		GetEntry(atom)->Name.~String();
+	for (int i = 0; i < ATOM_MaxBlocks; ++i)
+		if (s_Blocks[i])
+		{
+			free(s_Blocks[i]);
+			s_Blocks[i] = NULL;
+		}
+	if (s_Buckets)
+		free(s_Buckets);
+	s_Buckets = NULL;
+	s_NumBuckets = 0;
+	InterlockSet(&s_Size, 0);
+	UnlockAtoms();
+}
+
+}	// end Core
+}	// end Vixen
@@ -0,0 +1,198 @@
+#include "vcore/vcore.h"
+
+namespace Vixen {
+namespace Core {
+
+#define	LZ_MinMatch		4		// shortest match encoded
+#define	LZ_LastLiterals	5		// block always ends with this many literals
+#define	LZ_MatchLimit	12		// no match can start this close to the end
+
+static inline uint32 ReadWord(const uchar* p)
+{
+	uint32 w;
+
+	memcpy(&w, p, sizeof(uint32));
+	return w;
+}
+
+static inline uchar* PutLength(uchar* op, int32 n)
+{
+	while (n >= 255)
+	{
+		*op++ = 255;
+		n -= 255;
+	}
+	*op++ = uchar(n);
+	return op;
+}
+
+/*!
+ * @fn int32 Compressor::Compress(const char* src, int32 srclen, char* dst, int32 dstmax)
+ * @param src		data to compress
+ * @param srclen	number of bytes to compress
+ * @param dst		buffer for compressed data
+ * @param dstmax	size of output buffer, Compressor::GetMaxSize(srclen) is always enough
+ *
+ * Compresses a block of data using a greedy search for matches with
+ * a single entry hash table of the 4 byte sequences already seen.
+ * This function is thread-safe, the hash table is on the stack.
+ *
+ * @return number of compressed bytes or zero if the output buffer is too small
+ *
+ * @see Compressor::Decompress Compressor::GetMaxSize
+ */
+int32 Compressor::Compress(const char* src, int32 srclen, char* dst, int32 dstmax)
+{
+	int32			table[1 << LZ_HashBits];	// position + 1 of last sequence with each hash
+	const uchar*	base = (const uchar*) src;
+	const uchar*	ip = base;
+	const uchar*	anchor = base;				// start of literals not yet output
+	const uchar*	iend = base + srclen;
+	uchar*			op = (uchar*) dst;
+	uchar*			oend = op + dstmax;
+	int32			litlen;
+
+	memset(table, 0, sizeof(table));
+	if (srclen > LZ_MatchLimit)
+	{
+		const uchar*	mflimit = iend - LZ_MatchLimit;
+		const uchar*	matchlimit = iend - LZ_LastLiterals;
+
+		while (ip < mflimit)
+		{
+			uint32			seq = ReadWord(ip);
+			uint32			h = (seq * 2654435761U) >> (32 - LZ_HashBits);
+			int32			prev = table[h];
+			const uchar*	ref = base + prev - 1;
+
+			table[h] = int32(ip - base) + 1;
+			if ((prev == 0) || ((ip - ref) > LZ_MaxOffset) || (ReadWord(ref) != seq))
+			{
+				++ip;
+				continue;
+			}
+			const uchar*	mp = ip + LZ_MinMatch;	// extend the match
+			const uchar*	rp = ref + LZ_MinMatch;
+			int32			matchlen;
+			int32			offset = int32(ip - ref);
+			uchar*			token;
+
+			while ((mp < matchlimit) && (*mp == *rp))
+			{
+				++mp;
+				++rp;
+			}
+			litlen = int32(ip - anchor);
+			matchlen = int32(mp - ip) - LZ_MinMatch;
+			if ((op + 1 + litlen + (litlen / 255) + 1 + 2 + (matchlen / 255) + 1) > oend)
+				return 0;
+			token = op++;
+			if (litlen >= 15)
+			{
+				*token = 15 << 4;
+				op = PutLength(op, litlen - 15);
+			}
+			else
+				*token = uchar(litlen << 4);
+			memcpy(op, anchor, litlen);
+			op += litlen;
+			*op++ = uchar(offset & 0xFF);
+			*op++ = uchar(offset >> 8);
+			if (matchlen >= 15)
+			{
+				*token |= 15;
+				op = PutLength(op, matchlen - 15);
+			}
+			else
+				*token |= uchar(matchlen);
+			ip = mp;
+			anchor = ip;
+		}
+	}
+	litlen = int32(iend - anchor);				// last literals
+	if ((op + 1 + litlen + (litlen / 255) + 1) > oend)
+		return 0;
+	if (litlen >= 15)
+	{
+		*op++ = 15 << 4;
+		op = PutLength(op, litlen - 15);
+	}
+	else
+		*op++ = uchar(litlen << 4);
+	memcpy(op, anchor, litlen);
+	op += litlen;
+	return int32(op - (uchar*) dst);
+}
+
+/*!
+ * @fn int32 Compressor::Decompress(const char* src, int32 srclen, char* dst, int32 dstlen)
+ * @param src		compressed data
+ * @param srclen	number of compressed bytes
+ * @param dst		buffer for decompressed data
+ * @param dstlen	size of output buffer
+ *
+ * Decompresses a block made by Compressor::Compress. The input is checked
+ * so corrupted data will not read or write outside the buffers.
+ * This function is thread-safe.
+ *
+ * @return number of decompressed bytes or -1 if the data is corrupted
+ *
+ * @see Compressor::Compress
+ */
+int32 Compressor::Decompress(const char* src, int32 srclen, char* dst, int32 dstlen)
+{
+	const uchar*	ip = (const uchar*) src;
+	const uchar*	iend = ip + srclen;
+	uchar*			op = (uchar*) dst;
+	uchar*			oend = op + dstlen;
+
+	while (ip < iend)
+	{
+		uint32	token = *ip++;
+		size_t	len = token >> 4;
+		uint32	b;
+
+		if (len == 15)
+			do
+			{
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+			}
+			while (b == 255);
+		if ((len > size_t(iend - ip)) || (len > size_t(oend - op)))
+			return -1;
+		memcpy(op, ip, len);					// copy literals
+		ip += len;
+		op += len;
+		if (ip >= iend)							// last literals?
+			break;
+		if ((iend - ip) < 2)
+			return -1;
+		size_t	offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if ((offset == 0) || (offset > size_t(op - (uchar*) dst)))
+			return -1;
+		len = token & 15;
+		if (len == 15)
+			do
+			{
+				if (ip >= iend)
+					return -1;
+				b = *ip++;
+				len += b;
+			}
+			while (b == 255);
+		len += LZ_MinMatch;
+		if (len > size_t(oend - op))
+			return -1;
+		const uchar* ref = op - offset;			// matches may overlap output
+		while (len--)
+			*op++ = *ref++;
+	}
+	return int32(op - (uchar*) dst);
+}
+
+}	// end Core
+}	// end Vixen
@@ -0,0 +1,269 @@
+#include "vcore/vcore.h"
+#ifndef _WIN32
+#include <sched.h>
+#endif
+
+namespace Vixen {
+namespace Core {
+
+#define	EPOCH_Max		0x3FFFFFFF		// epoch counter wraps after this
+
+volatile bool	Epoch::s_Enabled = false;
+vint32			Epoch::s_Epoch = 3;
+vint32			Epoch::s_Readers[EPOCH_MaxReaders];
+vint32			Epoch::s_NumRetired = 0;
+vint32			Epoch::s_Collecting = 0;
+Epoch::RetireList* volatile	Epoch::s_RetireLists = NULL;
+int32			Epoch::t_Slot = 0;
+int32			Epoch::t_Depth = 0;
+Epoch::RetireList*	Epoch::t_Retired = NULL;
+
+static void YieldThread()
+{
+#ifdef _WIN32
+	::Sleep(0);
+#else
+	sched_yield();
+#endif
+}
+
+static void LockList(vint32* lock)
+{
+	while (!InterlockTestSet(lock, 1, 0))
+		YieldThread();
+}
+
+static void UnlockList(vint32* lock)
+{
+	InterlockSet(lock, 0);
+}
+
+/*
+ * Return the retired lists of the calling thread, making them the first
+ * time the thread retires an object. The lists are linked into the global
+ * chain without a lock and stay there after the thread exits so
+ * Epoch::Collect still frees the objects in them.
+ */
+Epoch::RetireList* Epoch::GetRetireList()
+{
+	RetireList*	rl = t_Retired;
+
+	if (rl)
+		return rl;
+	rl = (RetireList*) calloc(1, sizeof(RetireList));
+	if (rl == NULL)
+		return NULL;
+	do rl->Next = s_RetireLists;
+	while (!InterlockTestSet((voidptr*) &s_RetireLists, rl, rl->Next));
+	t_Retired = rl;
+	return rl;
+}
+
+/*!
+ * @fn void Epoch::SetEnabled(bool enable)
+ * @param enable	\b true to defer frees until readers leave,
+ *					\b false to delete objects immediately
+ *
+ * Epoch mode should be enabled before the threads which read in
+ * epochs are started. When it is disabled, all retired objects are
+ * freed after the current readers leave.
+ *
+ * @see Epoch::Enter Epoch::Flush
+ */
+void Epoch::SetEnabled(bool enable)
+{
+#ifndef VX_NOTHREAD
+	if (enable == s_Enabled)
+		return;
+	s_Enabled = enable;
+	if (!enable)
+		Flush();
+#endif
+}
+
+/*!
+ * @fn void Epoch::Enter()
+ *
+ * Enters a read-side critical section. Objects released by other
+ * threads while this thread is reading are not freed until it calls
+ * Epoch::Leave. Read sections may be nested; only the outermost one
+ * claims a reader slot. If all the reader slots are in use, this
+ * function waits until one is free.
+ *
+ * @see Epoch::Leave EpochReader
+ */
+void Epoch::Enter()
+{
+	if ((t_Depth++ > 0) || !s_Enabled)
+		return;
+	while (true)
+	{
+		int32 e = s_Epoch;
+
+		for (int i = 0; i < EPOCH_MaxReaders; ++i)
+			if ((s_Readers[i] == 0) && InterlockTestSet(&s_Readers[i], e, 0))
+			{
+				t_Slot = i + 1;
+				return;
+			}
+		YieldThread();
+	}
+}
+
+/*!
+ * @fn void Epoch::Leave()
+ *
+ * Leaves a read-side critical section. When the outermost
+ * section is left, the reader slot is released and the epoch
+ * can advance past the one this thread entered in.
+ *
+ * @see Epoch::Enter EpochReader
+ */
+void Epoch::Leave()
+{
+	VX_ASSERT(t_Depth > 0);
+	if (--t_Depth > 0)
+		return;
+	if (t_Slot > 0)
+	{
+		InterlockSet(&s_Readers[t_Slot - 1], 0);
+		t_Slot = 0;
+	}
+}
+
+/*!
+ * @fn void Epoch::Retire(RefObj* obj)
+ * @param obj	object to free, its reference count must be zero
+ *
+ * Called by RefObj::Release and RefObj::Delete in epoch mode instead of
+ * deleting the object. The object is added to the calling thread's list
+ * for the current epoch and freed by Epoch::Collect three epochs later.
+ * If epoch mode is not enabled, the object is deleted immediately.
+ *
+ * @see Epoch::Collect RefObj::Release
+ */
+void Epoch::Retire(RefObj* obj)
+{
+	RetireList*	rl;
+
+	if (obj == NULL)
+		return;
+	if (!s_Enabled)
+	{
+		delete obj;
+		return;
+	}
+	if ((rl = GetRetireList()) == NULL)
+		VX_ERROR_RETURN(("Epoch::Retire ERROR out of memory, object %p leaked\n", obj));
+	LockList(&rl->Lock);
+	int32	b = s_Epoch % 3;				// read epoch with the list locked
+	int32	n = rl->Size[b];
+
+	if (n >= rl->Max[b])					// grow the list
+	{
+		int32		newmax = (n < EPOCH_CollectSize) ? EPOCH_CollectSize : n * 2;
+		RefObj**	list = (RefObj**) realloc(rl->Retired[b], newmax * sizeof(RefObj*));
+
+		if (list == NULL)
+		{
+			UnlockList(&rl->Lock);
+			VX_ERROR_RETURN(("Epoch::Retire ERROR out of memory, object %p leaked\n", obj));
+		}
+		rl->Retired[b] = list;
+		rl->Max[b] = newmax;
+	}
+	rl->Retired[b][n] = obj;
+	rl->Size[b] = n + 1;
+	UnlockList(&rl->Lock);
+	if ((InterlockInc(&s_NumRetired) >= EPOCH_CollectSize) && !IsReading())
+		Collect();
+}
+
+/*!
+ * @fn bool Epoch::Collect()
+ *
+ * Tries to advance the global epoch. This succeeds if every
+ * active reader entered in the current epoch. When the epoch advances
+ * to \b e, the objects all the threads retired in epoch \b e - 3 are deleted.
+ * Deleting them may retire more objects which are freed by later collections.
+ * Nothing is collected if the calling thread is reading or if
+ * another thread is collecting.
+ *
+ * @return \b true if the epoch advanced, \b false if a reader is behind
+ *
+ * @see Epoch::Retire Epoch::Flush
+ */
+bool Epoch::Collect()
+{
+	if (IsReading())
+		return false;
+	if (!InterlockTestSet(&s_Collecting, 1, 0))
+		return false;
+	int32	e = s_Epoch;
+	int32	next = (e < EPOCH_Max) ? (e + 1) : (3 + (e + 1) % 3);
+
+	for (int i = 0; i < EPOCH_MaxReaders; ++i)
+	{
+		int32 r = s_Readers[i];
+
+		if (r && (r != e))					// reader still in old epoch?
+		{
+			InterlockSet(&s_Collecting, 0);
+			return false;
+		}
+	}
+	/*
+	 * Free the lists of epoch next - 3 of every thread before the
+	 * epoch advances. Until then new objects, including the ones
+	 * retired by deleting these, go into the lists of epoch e.
+	 */
+	int32 b = next % 3;
+	for (RetireList* rl = s_RetireLists; rl; rl = rl->Next)
+	{
+		RefObj**	list;
+		int32		n;
+
+		LockList(&rl->Lock);				// wait for Retire on that thread
+		list = rl->Retired[b];
+		n = rl->Size[b];
+		rl->Retired[b] = NULL;
+		rl->Size[b] = 0;
+		rl->Max[b] = 0;
+		UnlockList(&rl->Lock);
+		FreeList(list, n);
+	}
+	InterlockSet(&s_Epoch, next);
+	InterlockSet(&s_Collecting, 0);
+	return true;
+}
+
+void Epoch::FreeList(RefObj** list, int32 n)
+{
+	if (list == NULL)
+		return;
+	for (int32 i = 0; i < n; ++i)
+		delete list[i];
+	InterlockAdd(&s_NumRetired, -n);
+	free(list);
+}
+
+/*!
+ * @fn void Epoch::Flush()
+ *
+ * Waits for all current readers to leave and frees all
+ * retired objects. This should not be called by a thread which
+ * is reading. It is called when epoch mode is disabled.
+ *
+ * @see Epoch::Collect Epoch::SetEnabled
+ */
+void Epoch::Flush()
+{
+	if (IsReading())
+		VX_ERROR_RETURN(("Epoch::Flush ERROR cannot flush while reading\n"));
+	while (s_NumRetired > 0)
+		if (!Collect())
+			YieldThread();
+}
+
+}	// end Core
+}	// end Vixen
@@ -0,0 +1,330 @@
+#include "vcore/vcore.h"
+#include "vcore/vmemstats.h"
+#ifndef _WIN32
+#include <sched.h>
+#endif
+
+namespace Vixen {
+namespace Core {
+
+int64		MemStats::s_Resources[MemStats::NUM_RESOURCES];
+
+static const char* s_ResourceNames[MemStats::NUM_RESOURCES] = { "vertex", "index", "bitmap" };
+static vint32	s_ResourceLock = 0;		// guards resource counters
+
+/*
+ * Resource counters are changed rarely, only when data areas are resized,
+ * so a spin lock is enough. It has no destructor so objects freed
+ * during static destruction can still be uncharged.
+ */
+static void LockResources()
+{
+	while (!InterlockTestSet(&s_ResourceLock, 1, 0))
+#ifdef _WIN32
+		::Sleep(0);
+#else
+		sched_yield();
+#endif
+}
+
+static void UnlockResources()
+{
+	InterlockSet(&s_ResourceLock, 0);
+}
+
+/*!
+ * @fn void MemStats::Charge(int restype, intptr bytes)
+ * @param restype	type of resource (MemStats::VERTEX, MemStats::INDEX, MemStats::BITMAP)
+ * @param bytes		number of bytes to add, negative to subtract
+ *
+ * Objects which own resource memory call this when they allocate,
+ * enlarge or free their data areas. Each owner should remember how
+ * much it has charged so it can subtract exactly that amount later.
+ *
+ * @see MemStats::GetResourceBytes
+ */
+void MemStats::Charge(int restype, intptr bytes)
+{
+	if ((restype < 0) || (restype >= NUM_RESOURCES) || (bytes == 0))
+		return;
+	LockResources();
+	s_Resources[restype] += bytes;
+	UnlockResources();
+}
+
+int64 MemStats::GetResourceBytes(int restype)
+{
+	if ((restype < 0) || (restype >= NUM_RESOURCES))
+		return 0;
+	int64	bytes;
+
+	LockResources();
+	bytes = s_Resources[restype];
+	UnlockResources();
+	return bytes;
+}
+
+const char* MemStats::GetResourceName(int restype)
+{
+	if ((restype < 0) || (restype >= NUM_RESOURCES))
+		return NULL;
+	return s_ResourceNames[restype];
+}
+
+/*!
+ * @fn int64 MemStats::GetObjectBytes()
+ *
+ * Adds up the bytes in live objects of all the classes.
+ * This is a loop over the classes, not over the objects,
+ * so it is inexpensive enough to call every frame.
+ *
+ * @see MemStats::GetLiveObjects Class::GetLiveBytes
+ */
+int64 MemStats::GetObjectBytes()
+{
+	int		n = Class::GetNumClasses();
+	int64	total = 0;
+
+	for (int i = 0; i < n; ++i)
+		total += Class::GetClassAt(i)->GetLiveBytes();
+	return total;
+}
+
+int64 MemStats::GetLiveObjects()
+{
+	int		n = Class::GetNumClasses();
+	int64	total = 0;
+
+	for (int i = 0; i < n; ++i)
+		total += Class::GetClassAt(i)->GetLiveObjects();
+	return total;
+}
+
+/*
+ * Order class counts by decreasing size of live bytes
+ * (or decreasing size of change in bytes for a difference).
+ */
+static int CompareBytes(const void* a, const void* b)
+{
+	int64 ba = ((const MemStats::ClassStats*) a)->LiveBytes;
+	int64 bb = ((const MemStats::ClassStats*) b)->LiveBytes;
+
+	if (ba < 0) ba = -ba;
+	if (bb < 0) bb = -bb;
+	return (ba > bb) ? -1 : ((ba < bb) ? 1 : 0);
+}
+
+static void WriteName(FILE* fp, const TCHAR* name)
+{
+	for (; *name; ++name)
+	{
+		int c = *name;
+		if ((c == '"') || (c == '\\'))
+			fputc('\\', fp);
+		fputc((c < 128) ? c : '?', fp);
+	}
+}
+
+MemStats::Snapshot::Snapshot()
+{
+	Time = 0;
+	ObjectBytes = 0;
+	LiveObjects = 0;
+	NumClasses = 0;
+	Classes = NULL;
+	IsDiff = false;
+	m_MaxClasses = 0;
+	memset(ResourceBytes, 0, sizeof(ResourceBytes));
+}
+
+MemStats::Snapshot::~Snapshot()
+{
+	Empty();
+}
+
+void MemStats::Snapshot::Empty()
+{
+	if (Classes)
+		free(Classes);
+	Classes = NULL;
+	NumClasses = 0;
+	m_MaxClasses = 0;
+}
+
+bool MemStats::Snapshot::Alloc(int32 n)
+{
+	if (n <= m_MaxClasses)
+		return true;
+	ClassStats* classes = (ClassStats*) realloc(Classes, n * sizeof(ClassStats));
+	if (classes == NULL)
+		VX_ERROR(("MemStats::Snapshot ERROR out of memory for %d classes\n", n), false);
+	Classes = classes;
+	m_MaxClasses = n;
+	return true;
+}
+
+/*!
+ * @fn bool MemStats::Snapshot::Take()
+ *
+ * Captures the live object counts of every class which has allocated
+ * objects and the bytes charged to each resource type.
+ * The classes are sorted so the ones using the most memory come first.
+ * Objects may be allocated by other threads while the snapshot
+ * is taken so the counts of different classes may be a few objects
+ * apart in time.
+ *
+ * @return \b true if snapshot was taken, \b false if out of memory
+ *
+ * @see MemStats::Snapshot::Diff MemStats::WriteJSON
+ */
+bool MemStats::Snapshot::Take()
+{
+	int		n = Class::GetNumClasses();
+
+	NumClasses = 0;
+	ObjectBytes = 0;
+	LiveObjects = 0;
+	IsDiff = false;
+	Time = Profiler::GetTicks() / Profiler::GetTickRate();
+	if (!Alloc(n))
+		return false;
+	for (int i = 0; i < n; ++i)
+	{
+		Class*			info = Class::GetClassAt(i);
+		ClassStats&		cs = Classes[NumClasses];
+
+		if (info->GetTotalAllocs() == 0)
+			continue;
+		cs.Info = info;
+		cs.LiveObjects = info->GetLiveObjects();
+		cs.LiveBytes = info->GetLiveBytes();
+		cs.TotalAllocs = info->GetTotalAllocs();
+		ObjectBytes += cs.LiveBytes;
+		LiveObjects += cs.LiveObjects;
+		++NumClasses;
+	}
+	for (int r = 0; r < NUM_RESOURCES; ++r)
+		ResourceBytes[r] = GetResourceBytes(r);
+	qsort(Classes, NumClasses, sizeof(ClassStats), CompareBytes);
+	return true;
+}
+
+/*!
+ * @fn bool MemStats::Snapshot::Diff(const Snapshot& before, const Snapshot& after)
+ * @param before	snapshot taken first
+ * @param after		snapshot taken later
+ *
+ * Makes this snapshot the change in memory counts between two snapshots.
+ * Only classes whose live objects or bytes changed are kept and those
+ * with the largest change in bytes come first. The allocation counts
+ * are the number of objects allocated between the two snapshots.
+ *
+ * @return \b true if difference was computed, \b false if out of memory
+ *
+ * @see MemStats::Snapshot::Take
+ */
+bool MemStats::Snapshot::Diff(const Snapshot& before, const Snapshot& after)
+{
+	NumClasses = 0;
+	IsDiff = true;
+	Time = after.Time - before.Time;
+	ObjectBytes = after.ObjectBytes - before.ObjectBytes;
+	LiveObjects = after.LiveObjects - before.LiveObjects;
+	for (int r = 0; r < NUM_RESOURCES; ++r)
+		ResourceBytes[r] = after.ResourceBytes[r] - before.ResourceBytes[r];
+	if (!Alloc(after.NumClasses))
+		return false;
+	for (int32 i = 0; i < after.NumClasses; ++i)
+	{
+		const ClassStats&	a = after.Classes[i];
+		ClassStats&			d = Classes[NumClasses];
+
+		d = a;
+		for (int32 j = 0; j < before.NumClasses; ++j)
+			if (before.Classes[j].Info == a.Info)
+			{
+				const ClassStats& b = before.Classes[j];
+
+				d.LiveObjects -= b.LiveObjects;
+				d.LiveBytes -= b.LiveBytes;
+				d.TotalAllocs -= b.TotalAllocs;
+				break;
+			}
+		if ((d.LiveObjects != 0) || (d.LiveBytes != 0))
+			++NumClasses;
+	}
+	qsort(Classes, NumClasses, sizeof(ClassStats), CompareBytes);
+	return true;
+}
+
+/*!
+ * @fn void MemStats::Snapshot::Write(FILE* fp) const
+ * @param fp	file to write to
+ *
+ * Writes the snapshot as a JSON object with the object totals,
+ * the bytes for each resource type and a list of the classes.
+ *
+ * @see MemStats::WriteJSON
+ */
+void MemStats::Snapshot::Write(FILE* fp) const
+{
+	fprintf(fp, "{\n\t\"%s\": %.3f,\n", IsDiff ? "seconds" : "time", Time);
+	fprintf(fp, "\t\"objects\": { \"count\": %lld, \"bytes\": %lld },\n", (long long) LiveObjects, (long long) ObjectBytes);
+	fputs("\t\"resources\": {", fp);
+	for (int r = 0; r < NUM_RESOURCES; ++r)
+		fprintf(fp, "%s \"%s\": %lld", (r > 0) ? "," : "", s_ResourceNames[r], (long long) ResourceBytes[r]);
+	fputs(" },\n\t\"classes\": [\n", fp);
+	for (int32 i = 0; i < NumClasses; ++i)
+	{
+		const ClassStats& cs = Classes[i];
+
+		fputs("\t\t{ \"name\": \"", fp);
+		WriteName(fp, cs.Info->GetName());
+		fprintf(fp, "\", \"live\": %d, \"bytes\": %lld, \"allocs\": %d }%s\n",
+				cs.LiveObjects, (long long) cs.LiveBytes, cs.TotalAllocs, (i < NumClasses - 1) ? "," : "");
+	}
+	fputs("\t]\n}", fp);
+}
+
+/*!
+ * @fn bool MemStats::WriteJSON(const TCHAR* filename, const Snapshot* since)
+ * @param filename	name of JSON file to write
+ * @param since		earlier snapshot to compare against, may be NULL
+ *
+ * Takes a snapshot of the current memory counts and writes it to a file.
+ * If an earlier snapshot is given, the change since then is also written.
+ * The file contains a single JSON object with a \b current member
+ * and optionally a \b change member.
+ *
+ * @return \b true if file was written, \b false on error
+ *
+ * @see MemStats::Snapshot FrameStats::SetMemoryLog
+ */
+bool MemStats::WriteJSON(const TCHAR* filename, const Snapshot* since)
+{
+	Snapshot	now;
+	FILE*		fp;
+
+	if (!now.Take())
+		return false;
+	if ((fp = FOPEN(filename, TEXT("w"))) == NULL)
+		VX_ERROR(("MemStats::WriteJSON cannot open %s\n", filename), false);
+	fputs("{\n\"current\": ", fp);
+	now.Write(fp);
+	if (since)
+	{
+		Snapshot	change;
+
+		if (change.Diff(*since, now))
+		{
+			fputs(",\n\"change\": ", fp);
+			change.Write(fp);
+		}
+	}
+	fputs("\n}\n", fp);
+	fclose(fp);
+	return true;
+}
+
+} // end Core
+} // end Vixen
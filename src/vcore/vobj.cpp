@@ -125,6 +125,36 @@ Class* Class::GetClass (uint32 serialid)
 	return NULL;
 }
 
+/*!
+ * @fn int Class::GetNumClasses()
+ *
+ * Classes are registered when their class information is initialized
+ * at startup. Together with Class::GetClassAt this permits iterating
+ * over all the classes, for example to report their live object counts.
+ *
+ * @return number of registered classes
+ *
+ * @see Class::GetClassAt Class::GetLiveObjects MemStats
+ */
+int Class::GetNumClasses()
+{
+	return s_classCount / 2;
+}
+
+/*!
+ * @fn Class* Class::GetClassAt(int index)
+ * @param index	index of class, between 0 and Class::GetNumClasses() - 1
+ *
+ * @return class information for the given class, NULL if index out of range
+ *
+ * @see Class::GetNumClasses
+ */
+Class* Class::GetClassAt(int index)
+{
+	if ((index < 0) || (index >= s_classCount / 2))
+		return NULL;
+	return s_classFixup[index * 2 + 1];
+}
 
 void Class::Print(DebugOut& dbg)
 {
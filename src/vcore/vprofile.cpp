@@ -0,0 +1,516 @@
+#include "vcore/vcore.h"
+#include "vcore/vprofile.h"
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+namespace Vixen {
+namespace Core {
+
+#define	PROFILE_HashSize	(PROFILE_MaxZones * 2)
+
+bool							Profiler::Enabled = false;
+bool							Profiler::Detail = false;
+Profiler::ThreadBuffer*			Profiler::t_Buffer = NULL;
+Profiler::ThreadBuffer* volatile Profiler::s_Buffers = NULL;
+vint32							Profiler::s_NumThreads = 0;
+Profiler::ZoneStats*			Profiler::s_Zones = NULL;
+int32							Profiler::s_NumZones = 0;
+Profiler::Event*				Profiler::s_Capture = NULL;
+int32							Profiler::s_CaptureSize = 0;
+int32							Profiler::s_CaptureMax = 0;
+int32							Profiler::s_CaptureFrames = 0;
+int32							Profiler::s_FrameEvents = 0;
+
+/*
+ * Maps zone name addresses to zone indices. Several addresses may
+ * map to the same zone if the same string is defined in more than one place.
+ */
+static const TCHAR*	s_HashNames[PROFILE_HashSize];
+static int32		s_HashZones[PROFILE_HashSize];
+
+/*!
+ * @fn int64 Profiler::GetTicks()
+ *
+ * Returns the current value of a monotonic high resolution timer.
+ * Use Profiler::GetTickRate to convert ticks to seconds.
+ *
+ * @see Profiler::GetTickRate
+ */
+int64 Profiler::GetTicks()
+{
+#ifdef _WIN32
+	LARGE_INTEGER	t;
+
+	::QueryPerformanceCounter(&t);
+	return t.QuadPart;
+#else
+	timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return int64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+double Profiler::GetTickRate()
+{
+#ifdef _WIN32
+	static double	rate = 0;
+
+	if (rate == 0)
+	{
+		LARGE_INTEGER	f;
+
+		::QueryPerformanceFrequency(&f);
+		rate = double(f.QuadPart);
+	}
+	return rate;
+#else
+	return 1000000000.0;
+#endif
+}
+
+/*!
+ * @fn Profiler::ThreadBuffer* Profiler::GetBuffer()
+ *
+ * Returns the event buffer for the calling thread. The first
+ * time a thread records an event, a buffer is allocated for it and
+ * linked into the global list of buffers without locking.
+ */
+Profiler::ThreadBuffer* Profiler::GetBuffer()
+{
+	ThreadBuffer*	buf = t_Buffer;
+
+	if (buf)
+		return buf;
+	buf = (ThreadBuffer*) calloc(1, sizeof(ThreadBuffer));
+	if (buf == NULL)
+		VX_ERROR(("Profiler: cannot allocate thread buffer\n"), NULL);
+	buf->Index = InterlockInc(&s_NumThreads);
+	do
+		buf->Next = s_Buffers;
+	while (!InterlockTestSet((voidptr*) &s_Buffers, buf, buf->Next));
+	t_Buffer = buf;
+	return buf;
+}
+
+/*!
+ * @fn int64 Profiler::Enter()
+ *
+ * Called by ProfileZone when a zone is entered.
+ * Increments the nesting depth for this thread.
+ *
+ * @return time zone was entered, in ticks
+ *
+ * @see Profiler::Leave ProfileZone
+ */
+int64 Profiler::Enter()
+{
+	ThreadBuffer*	buf = GetBuffer();
+
+	if (buf == NULL)
+		return 0;
+	++(buf->Depth);
+	return GetTicks();
+}
+
+/*!
+ * @fn void Profiler::Leave(const TCHAR* name, int64 start)
+ * @param name	name of zone being exited
+ * @param start	time zone was entered (from Profiler::Enter)
+ *
+ * Called by ProfileZone when a zone is exited. An event is
+ * written to the thread's buffer. If the buffer is full because
+ * the display thread has not drained it, the event is dropped.
+ *
+ * @see Profiler::Enter ProfileZone
+ */
+void Profiler::Leave(const TCHAR* name, int64 start)
+{
+	int64			end = GetTicks();
+	ThreadBuffer*	buf = t_Buffer;
+	int32			head = buf->Head;
+
+	--(buf->Depth);
+	if (head - buf->Tail >= PROFILE_MaxEvents)
+	{
+		++(buf->Dropped);
+		return;
+	}
+	Event&	e = buf->Events[head & (PROFILE_MaxEvents - 1)];
+	e.Name = name;
+	e.Start = start;
+	e.End = end;
+	e.Depth = buf->Depth;
+	e.Thread = buf->Index;
+	InterlockSet(&(buf->Head), head + 1);	// publish to consumer
+}
+
+/*!
+ * @fn Profiler::ZoneStats* Profiler::MakeZone(const TCHAR* name)
+ *
+ * Finds the statistics for the named zone, making a new
+ * entry if the zone has not been seen before. Zones are found
+ * by name address first and then by string comparison.
+ * If the address table is full, the event is not counted
+ * and NULL is returned.
+ * This function is only called from the thread which
+ * calls Profiler::EndFrame.
+ */
+Profiler::ZoneStats* Profiler::MakeZone(const TCHAR* name)
+{
+	uint32	h = uint32(intptr(name) >> 3) % PROFILE_HashSize;
+	int		probes = 0;
+	int		i;
+
+	while (s_HashNames[h])
+	{
+		if (s_HashNames[h] == name)
+			return &s_Zones[s_HashZones[h]];
+		if (++probes >= PROFILE_HashSize)	// table full of other addresses
+			break;
+		h = (h + 1) % PROFILE_HashSize;
+	}
+	if (s_Zones == NULL)
+		s_Zones = (ZoneStats*) calloc(PROFILE_MaxZones, sizeof(ZoneStats));
+	for (i = 0; i < s_NumZones; ++i)		// same name at another address?
+		if (STRCMP(s_Zones[i].Name, name) == 0)
+			break;
+	if (i >= s_NumZones)
+	{
+		if (s_NumZones >= PROFILE_MaxZones)
+			return NULL;
+		i = s_NumZones++;
+		memset(&s_Zones[i], 0, sizeof(ZoneStats));
+		s_Zones[i].Name = name;
+	}
+	if (probes >= PROFILE_HashSize)			// no room to remember this address
+		return NULL;
+	s_HashNames[h] = name;
+	s_HashZones[h] = i;
+	return &s_Zones[i];
+}
+
+/*
+ * Adds the time for the last frame to the rolling history of the zone
+ * and updates the average, maximum and histogram.
+ */
+void Profiler::AddSample(ZoneStats* zone, float ms)
+{
+	int		slot = zone->NumSamples % PROFILE_HistFrames;
+	int		n = zone->NumSamples + 1;
+	float	sum = 0;
+	int		b;
+
+	if (zone->NumSamples >= PROFILE_HistFrames)
+	{
+		b = (int) (log(zone->History[slot] * 1000.0f + 1.0f) / log(2.0f));
+		if (b >= PROFILE_HistBuckets) b = PROFILE_HistBuckets - 1;
+		--(zone->Histogram[b]);
+		n = PROFILE_HistFrames;
+	}
+	b = (int) (log(ms * 1000.0f + 1.0f) / log(2.0f));
+	if (b >= PROFILE_HistBuckets) b = PROFILE_HistBuckets - 1;
+	++(zone->Histogram[b]);
+	zone->History[slot] = ms;
+	zone->Last = ms;
+	++(zone->NumSamples);
+	zone->Maximum = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		sum += zone->History[i];
+		if (zone->History[i] > zone->Maximum)
+			zone->Maximum = zone->History[i];
+	}
+	zone->Average = sum / n;
+}
+
+/*!
+ * @fn void Profiler::EndFrame()
+ *
+ * Drains the event buffers of all threads and accumulates the
+ * time spent in each zone for this frame. Zones which were entered
+ * this frame add a sample to their rolling history. If a trace capture
+ * is in progress, the events are also saved for Profiler::WriteTrace.
+ *
+ * This function should be called once per frame from a single thread.
+ * Scene::DoFrame calls it at the start of each frame to collect
+ * the zones of the previous frame, so applications which use
+ * Scene::DoFrame should not call it again.
+ *
+ * @see Profiler::StartCapture Profiler::GetAverage VX_PROFILE_FRAME
+ */
+void Profiler::EndFrame()
+{
+	double	tomsec = 1000.0 / GetTickRate();
+
+	s_FrameEvents = 0;
+	for (ThreadBuffer* buf = s_Buffers; buf; buf = buf->Next)
+	{
+		int32	head = buf->Head;
+		int32	tail = buf->Tail;
+
+		s_FrameEvents += head - tail;
+
+		if (s_CaptureFrames > 0)
+		{
+			int32	n = s_CaptureSize + head - tail;
+
+			if (n > s_CaptureMax)
+			{
+				Event* events = (Event*) realloc(s_Capture, 2 * n * sizeof(Event));
+				if (events)
+				{
+					s_Capture = events;
+					s_CaptureMax = 2 * n;
+				}
+			}
+		}
+		while (tail != head)
+		{
+			const Event&	e = buf->Events[tail & (PROFILE_MaxEvents - 1)];
+			ZoneStats*		zone = MakeZone(e.Name);
+
+			if (zone)
+			{
+				zone->FrameTicks += e.End - e.Start;
+				++(zone->Calls);
+			}
+			if ((s_CaptureFrames > 0) && (s_CaptureSize < s_CaptureMax))
+				s_Capture[s_CaptureSize++] = e;
+			++tail;
+		}
+		InterlockSet(&(buf->Tail), tail);
+	}
+	for (int i = 0; i < s_NumZones; ++i)
+	{
+		ZoneStats* zone = &s_Zones[i];
+
+		if (zone->Calls == 0)
+			continue;
+		AddSample(zone, float(zone->FrameTicks * tomsec));
+		zone->FrameTicks = 0;
+		zone->Calls = 0;
+	}
+	if (s_CaptureFrames > 0)
+		--s_CaptureFrames;
+}
+
+/*!
+ * @fn void Profiler::StartCapture(int nframes)
+ * @param nframes	number of frames to capture
+ *
+ * Starts saving profiler events for the next \b nframes frames.
+ * Any previously captured events are discarded. The events can be
+ * written in Chrome trace format with Profiler::WriteTrace.
+ *
+ * @see Profiler::WriteTrace Profiler::IsCapturing
+ */
+void Profiler::StartCapture(int nframes)
+{
+	s_CaptureSize = 0;
+	s_CaptureFrames = nframes;
+	Enabled = true;
+}
+
+bool Profiler::IsCapturing()
+{
+	return s_CaptureFrames > 0;
+}
+
+static void WriteName(FILE* fp, const TCHAR* name)
+{
+	for (; *name; ++name)
+	{
+		int c = *name;
+		if ((c == '"') || (c == '\\'))
+			fputc('\\', fp);
+		fputc((c < 128) ? c : '?', fp);
+	}
+}
+
+/*!
+ * @fn bool Profiler::WriteTrace(const TCHAR* filename)
+ * @param filename	name of JSON file to write
+ *
+ * Writes the events saved since Profiler::StartCapture as
+ * complete ("X") events in the Chrome trace event format.
+ * The file can be loaded into chrome://tracing or the Perfetto UI.
+ * Times are in microseconds relative to the first captured event.
+ *
+ * @return \b true if file was written, \b false on error
+ *
+ * @see Profiler::StartCapture
+ */
+bool Profiler::WriteTrace(const TCHAR* filename)
+{
+	FILE*	fp = FOPEN(filename, TEXT("w"));
+	double	tousec = 1000000.0 / GetTickRate();
+	int64	base = 0;
+
+	if (fp == NULL)
+		VX_ERROR(("Profiler::WriteTrace cannot open %s\n", filename), false);
+	for (int i = 0; i < s_CaptureSize; ++i)
+		if ((base == 0) || (s_Capture[i].Start < base))
+			base = s_Capture[i].Start;
+	fputs("{\"traceEvents\":[\n", fp);
+	for (int i = 0; i < s_CaptureSize; ++i)
+	{
+		const Event& e = s_Capture[i];
+
+		fputs((i > 0) ? ",\n{\"name\":\"" : "{\"name\":\"", fp);
+		WriteName(fp, e.Name);
+		fprintf(fp, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%d}}",
+				e.Thread, (e.Start - base) * tousec, (e.End - e.Start) * tousec, e.Depth);
+	}
+	fputs("\n],\"displayTimeUnit\":\"ms\"}\n", fp);
+	fclose(fp);
+	return true;
+}
+
+/*!
+ * @fn const Profiler::ZoneStats* Profiler::FindZone(const TCHAR* name)
+ * @param name	name of zone to find
+ *
+ * @return statistics for the zone or NULL if the zone has not been recorded
+ *
+ * @see Profiler::GetAverage Profiler::GetPercentile
+ */
+const Profiler::ZoneStats* Profiler::FindZone(const TCHAR* name)
+{
+	for (int i = 0; i < s_NumZones; ++i)
+		if ((s_Zones[i].Name == name) || (STRCMP(s_Zones[i].Name, name) == 0))
+			return &s_Zones[i];
+	return NULL;
+}
+
+float Profiler::GetAverage(const TCHAR* name)
+{
+	const ZoneStats* zone = FindZone(name);
+	return zone ? zone->Average : 0.0f;
+}
+
+static int CompareFloat(const void* a, const void* b)
+{
+	float fa = *((const float*) a);
+	float fb = *((const float*) b);
+	return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
+}
+
+/*!
+ * @fn float Profiler::GetPercentile(const TCHAR* name, float pct)
+ * @param name	name of zone
+ * @param pct	percentile to compute (0 - 100)
+ *
+ * Computes a percentile of the per-frame times for a zone
+ * over the rolling history window.
+ *
+ * @return zone time in milliseconds at the given percentile, 0 if zone not found
+ *
+ * @see Profiler::GetAverage
+ */
+float Profiler::GetPercentile(const TCHAR* name, float pct)
+{
+	const ZoneStats*	zone = FindZone(name);
+	float				sorted[PROFILE_HistFrames];
+	int					n;
+
+	if ((zone == NULL) || (zone->NumSamples == 0))
+		return 0.0f;
+	n = (zone->NumSamples < PROFILE_HistFrames) ? zone->NumSamples : PROFILE_HistFrames;
+	memcpy(sorted, zone->History, n * sizeof(float));
+	qsort(sorted, n, sizeof(float), CompareFloat);
+	int i = int(pct * (n - 1) / 100.0f + 0.5f);
+	if (i < 0) i = 0;
+	if (i >= n) i = n - 1;
+	return sorted[i];
+}
+
+int Profiler::GetNumZones()
+{
+	return s_NumZones;
+}
+
+const Profiler::ZoneStats* Profiler::GetZone(int i)
+{
+	if ((i < 0) || (i >= s_NumZones))
+		return NULL;
+	return &s_Zones[i];
+}
+
+/*!
+ * @fn float Profiler::MeasureOverhead(int n)
+ * @param n	number of zones to record
+ *
+ * Measures the cost of recording one zone by entering and leaving
+ * an empty zone \b n times on the calling thread. The zones are
+ * recorded like any other and show up in the statistics as
+ * \b Profiler::Overhead. Multiply the result by
+ * Profiler::GetFrameEvents to estimate the profiler time per frame.
+ * At most a quarter of the event buffer is used so no events are dropped.
+ *
+ * @return nanoseconds to record one zone, 0 if profiling is disabled
+ *
+ * @see Profiler::GetFrameEvents
+ */
+float Profiler::MeasureOverhead(int n)
+{
+	static const TCHAR*	name = TEXT("Profiler::Overhead");
+	int64				start;
+
+	if (!Enabled || (GetBuffer() == NULL))
+		return 0.0f;
+	if (n > PROFILE_MaxEvents / 4)
+		n = PROFILE_MaxEvents / 4;
+	if (n <= 0)
+		return 0.0f;
+	start = GetTicks();
+	for (int i = 0; i < n; ++i)
+		Leave(name, Enter());
+	return float((GetTicks() - start) * 1000000000.0 / GetTickRate() / n);
+}
+
+int32 Profiler::GetFrameEvents()
+{
+	return s_FrameEvents;
+}
+
+void Profiler::Reset()
+{
+	if (s_Zones)
+		memset(s_Zones, 0, PROFILE_MaxZones * sizeof(ZoneStats));
+	memset(s_HashNames, 0, sizeof(s_HashNames));
+	s_NumZones = 0;
+	s_CaptureSize = 0;
+	s_CaptureFrames = 0;
+	s_FrameEvents = 0;
+}
+
+/*!
+ * @fn void Profiler::Shutdown()
+ *
+ * Frees all profiler storage. Called from CoreExit
+ * after all the threads have stopped.
+ */
+void Profiler::Shutdown()
+{
+	ThreadBuffer* buf = (ThreadBuffer*) InterlockExch((voidptr*) &s_Buffers, NULL);
+
+	Enabled = false;
+	while (buf)
+	{
+		ThreadBuffer* next = buf->Next;
+		free(buf);
+		buf = next;
+	}
+	t_Buffer = NULL;
+	Reset();
+	free(s_Zones);
+	free(s_Capture);
+	s_Zones = NULL;
+	s_Capture = NULL;
+	s_CaptureMax = 0;
+}
+
+} // end Core
+} // end Vixen
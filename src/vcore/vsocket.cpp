@@ -11,18 +11,19 @@
 
 #define	SOCK_MaxBufSize	64*STREAM_MaxBufSize	// socket buffer size
 #define	SOCK_MinBufSize	4*sizeof(int32)
+#define	SOCK_QueueSize	(64 * 1024)			// initial size of client send queue
 
 #ifdef _WIN32
 #pragma comment(lib, "Ws2_32.lib")
-
-inline SOCKET GETFD(uint32 i, fd_set* fdset)
-{
-	if (i >= fdset->fd_count)
-		return SOCKET(SOCKET_ERROR);
-	return fdset->fd_array[i];
-}
 #else
-#define GETFD(i, fdset) i
+#include <fcntl.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#ifndef MSG_NOSIGNAL
+#define	MSG_NOSIGNAL	0
+#endif
 #endif
 
 
@@ -209,6 +210,86 @@ size_t Socket::Write(const char* buf, size_t nbytes)
 	return n;
 }
 
+/*
+ * Puts a socket into non-blocking mode.
+ */
+static bool SetNonBlocking(SOCKET sock)
+{
+#ifdef _WIN32
+	u_long	val = 1;
+	return ioctlsocket(sock, FIONBIO, &val) == 0;
+#else
+	int		flags = fcntl(sock, F_GETFL, 0);
+	return (flags >= 0) && (fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0);
+#endif
+}
+
+/*
+ * Returns true if the last socket call failed because
+ * the operation would have blocked.
+ */
+static bool WouldBlock()
+{
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+#endif
+}
+
+/*
+ * Writes two buffers to a socket with a single gather write.
+ * Either buffer may be empty.
+ * @return number of bytes written, 0 if the socket cannot accept any, -1 on error
+ */
+static long SendGather(SOCKET sock, const char* buf1, long n1, const char* buf2, long n2)
+{
+#ifdef _WIN32
+	WSABUF	bufs[2];
+	DWORD	nsent = 0;
+	DWORD	nbufs = 0;
+
+	if (n1 > 0)
+	{
+		bufs[nbufs].buf = (char*) buf1;
+		bufs[nbufs++].len = n1;
+	}
+	if (n2 > 0)
+	{
+		bufs[nbufs].buf = (char*) buf2;
+		bufs[nbufs++].len = n2;
+	}
+	if (nbufs == 0)
+		return 0;
+	if (WSASend(sock, bufs, nbufs, &nsent, 0, NULL, NULL) == SOCKET_ERROR)
+		return WouldBlock() ? 0 : -1;
+	return (long) nsent;
+#else
+	struct iovec	bufs[2];
+	struct msghdr	msg;
+	ssize_t			nsent;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = bufs;
+	if (n1 > 0)
+	{
+		bufs[msg.msg_iovlen].iov_base = (void*) buf1;
+		bufs[msg.msg_iovlen++].iov_len = n1;
+	}
+	if (n2 > 0)
+	{
+		bufs[msg.msg_iovlen].iov_base = (void*) buf2;
+		bufs[msg.msg_iovlen++].iov_len = n2;
+	}
+	if (msg.msg_iovlen == 0)
+		return 0;
+	nsent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+	if (nsent < 0)
+		return WouldBlock() ? 0 : -1;
+	return (long) nsent;
+#endif
+}
+
 /*!
  * @fn SocketArbitrator::SocketArbitrator(int port)
  *
@@ -219,11 +300,20 @@ size_t Socket::Write(const char* buf, size_t nbytes)
 SocketArbitrator::SocketArbitrator(int port) : Arbitrator()
 {
 	m_NumClients = 0;
+	m_NumSlots = 0;
+	m_NumReady = 0;
+	m_NextReady = 0;
 	m_Port = port;
 	m_Listener = SOCKET(SOCKET_ERROR);
-	FD_ZERO(&m_Pending);
-	FD_ZERO(&m_Clients);
-	MaxReads = STREAM_MaxReads;
+	m_CurSock = SOCKET(SOCKET_ERROR);
+	m_EPoll = -1;
+	memset(m_Clients, 0, sizeof(m_Clients));
+	for (int i = 0; i < SOCK_MaxClients; ++i)
+		m_Clients[i].Sock = INVALID_SOCKET;
+	MaxQueueBytes = SOCK_MaxQueueBytes;
+	MaxStallTime = SOCK_MaxStallTime;
+	ReadTimeOut = SOCK_MaxStallTime;
+	SlowPolicy = SLOW_DROP;
 #ifdef _WIN32
 	WSADATA wsaData;
 	if (SOCKET_ERROR == WSAStartup(0x202, &wsaData))
@@ -252,68 +342,56 @@ SocketArbitrator::SocketArbitrator(int port) : Arbitrator()
  */
 bool SocketArbitrator::Open(const TCHAR* svrname, int mode)
 {
-	int			buf_size = SOCK_MinBufSize;
-	int			opt_size = sizeof(int);
 	sockaddr_in	local;
 	SOCKET		msgsock;
 	int			val = 1;
+
+	memset(&local, 0, sizeof(local));
 	local.sin_family      = AF_INET;
-	local.sin_addr.s_addr = INADDR_ANY; 
+	local.sin_addr.s_addr = INADDR_ANY;
 	local.sin_port        = htons(m_Port);
 
 	msgsock = socket(AF_INET,SOCK_STREAM,0); // Open a socket
 	if (msgsock == SOCKET(SOCKET_ERROR))
 		SOCKERR("SockArbitrator::Open socket open failed", false);
-	setsockopt(msgsock, SOL_SOCKET, TCP_NODELAY, (const char *) &val, sizeof(BOOL));
-//	setsockopt(msgsock, SOL_SOCKET, SO_SNDBUF, (const char *) &buf_size, opt_size );
-//	setsockopt(msgsock, SOL_SOCKET, SO_RCVBUF, (const char *) &buf_size, opt_size );
-	if (mode & OPEN_SMALL_PACKETS)
-	{
-		setsockopt(msgsock, SOL_SOCKET, TCP_NODELAY, (const char *) &val, sizeof(BOOL));
-		setsockopt(msgsock, SOL_SOCKET, SO_SNDBUF, (const char *) &buf_size, opt_size );
-	}
+	setsockopt(msgsock, SOL_SOCKET, SO_REUSEADDR, (const char *) &val, sizeof(val));
 /*
- * This stream can accept input from as many as 32
+ * This stream can accept input from as many as SOCK_MaxClients
  * client sockets. m_Listener is the socket which listens for input.
+ * It is non-blocking so new connections can be accepted
+ * whenever it is reported ready without waiting.
  */
 	VX_ASSERT(m_NumClients == 0);
-	FD_ZERO(&m_Clients);
-//	ioctlsocket(m_listener, FIONBIO, &val);	// non blocking reads
 	if (SOCKET_ERROR == bind(msgsock, (struct sockaddr*) &local, sizeof(local)))
+	{
+		closesocket(msgsock);
 		SOCKERR("Socket::Open socket bind failed", false);
-	if (SOCKET_ERROR == listen(msgsock, 5))
+	}
+	if (SOCKET_ERROR == listen(msgsock, SOCK_MaxClients))
+	{
+		closesocket(msgsock);
 		SOCKERR("Socket::Open socket listen failed", false);
-	m_Listener = msgsock;
-	m_NumClients = 0;
-	return Arbitrator::Open(svrname, mode);
-}
-
-
-/*!
- * @fn int SocketArbitrator::Select(int* connections, int n)
- *
- * A socket arbitrator will return \b true indication
- * if all of the clients can be selected for output.
- */
-int SocketArbitrator::Select(int* connections, int n)
-{
-	fd_set	output = m_Clients;
-	int		nready = 0;
+	}
+	SetNonBlocking(msgsock);
+#ifdef __linux__
+	struct epoll_event	ev;
 
-	if (select(m_NumClients, 0, &output, 0, &m_TimeOut) <= 0)
-		return 0;
-	for (int i = 0; i < n; ++i)
+	m_EPoll = epoll_create(SOCK_MaxClients + 1);
+	if (m_EPoll < 0)
 	{
-		int connid = connections[i];
-		SOCKET	fd = GETFD(connid, &output);
-		if (fd == SOCKET(SOCKET_ERROR))
-		{
-			connections[i] = 0;			// indicate this one not ready
-			continue;
-		}
-		++nready;
+		closesocket(msgsock);
+		SOCKERR("Socket::Open epoll create failed", false);
 	}
-	return nready;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = msgsock;
+	epoll_ctl((int) m_EPoll, EPOLL_CTL_ADD, msgsock, &ev);
+#endif
+	m_Listener = msgsock;
+	m_NumClients = 0;
+	m_NumSlots = 0;
+	m_NumReady = m_NextReady = 0;
+	return Arbitrator::Open(svrname, mode);
 }
 
 /****
@@ -331,184 +409,608 @@ bool SocketArbitrator::Close()
 {
 	if (m_openmode)
 	{
+		Flush();
 		Arbitrator::Close();
+		for (int i = 0; i < m_NumSlots; ++i)
+			DropClient(i, false);
+		m_NumSlots = 0;
 		if (m_Listener != SOCKET(SOCKET_ERROR))
 		{
 			closesocket(m_Listener);
 			m_Listener = SOCKET(SOCKET_ERROR);
 		}
+#ifdef __linux__
+		if (m_EPoll >= 0)
+			close((int) m_EPoll);
+#endif
+		m_EPoll = -1;
+		m_NumReady = m_NextReady = 0;
 		return true;
 	}
 	return Arbitrator::Close();
 }
 
-bool SocketArbitrator::IsEmpty() const
+/*!
+ * @fn int SocketArbitrator::Select(int* connections, int n)
+ * @param connections	Array of connection IDs for connections to check.
+ * @param n				Number of IDs to check.
+ *
+ * Output to a connected client never waits, it is queued if the
+ * client cannot accept it. All connected clients are ready.
+ * Queued output is written before checking and slow clients
+ * are dropped or resynchronized. The IDs of connections which
+ * are not connected are set to -1.
+ *
+ * @return number of connections ready for output
+ *
+ * @see SocketArbitrator::Flush SocketArbitrator::GetStalled
+ */
+int SocketArbitrator::Select(int* connections, int n)
 {
-	int					retval, n = m_NumClients + 1;
-	SocketArbitrator*	cheat = (SocketArbitrator*) this;
+	int		nready = 0;
 
-	if (!(m_openmode & OPEN_READ))
-		return true;
-/*
- * If there is no input pending from last time, check to see if there
- * is any new input pending. If not, exit as empty
- */
-	if (m_CurSock == SOCKET(SOCKET_ERROR))		// no input pending from last time?
+	Flush();
+	for (int i = 0; i < n; ++i)
 	{
-		m_NumReads = 0;					// start recv counter again
-		m_Pending = m_Clients;
-		FD_SET(m_Listener, &m_Pending);
-		retval = select(n, &m_Pending, 0, 0, (timeval*) &m_TimeOut);
-		if (retval < 0)
-			SOCKERR("Socket::IsEmpty socket select failed", true);
-		if (retval == 0)				// Timeout - no more input
-			return true;
+		int connid = connections[i];
+
+		if ((connid < 0) || (connid >= m_NumSlots) ||
+			(m_Clients[connid].Sock == INVALID_SOCKET))
+		{
+			connections[i] = -1;		// indicate this one not ready
+			continue;
+		}
+		++nready;
 	}
-/*
- * Examine all file descriptors with pending input.
- * Input from the listener is a new connection.
- * Input from another socket is data pending to be read.
+	return nready;
+}
+
+/*!
+ * @fn int SocketArbitrator::GetStalled(int* connections, int n)
+ * @param connections	Array to get IDs of stalled connections.
+ * @param n				Maximum number of IDs to return.
+ *
+ * Reports the connections which were too slow and were dropped
+ * or resynchronized since the last call. Each is reported once.
+ * A connection which was dropped is no longer connected,
+ * SocketArbitrator::GetAt will return -1 for it.
+ *
+ * @return number of connection IDs returned
+ *
+ * @see SocketArbitrator::SlowPolicy
  */
-	for (int i = 0; i < n; ++i)
+int SocketArbitrator::GetStalled(int* connections, int n)
+{
+	int		nstalled = 0;
+
+	for (int i = 0; (i < m_NumSlots) && (nstalled < n); ++i)
+		if (m_Clients[i].Stalled)
+		{
+			m_Clients[i].Stalled = false;
+			connections[nstalled++] = i;
+		}
+	return nstalled;
+}
+
+/*!
+ * @fn void SocketArbitrator::Flush()
+ *
+ * Writes as much queued output to each client as its socket will
+ * accept without waiting. Clients which have too much output queued
+ * or have not accepted any for too long are handled according
+ * to SocketArbitrator::SlowPolicy.
+ *
+ * @see SocketArbitrator::SendConnection
+ */
+void SocketArbitrator::Flush()
+{
+	int64	now = Profiler::GetTicks();
+
+	for (int i = 0; i < m_NumSlots; ++i)
 	{
-		SOCKET fd = GETFD(i, &m_Pending);
-		if (fd == SOCKET(SOCKET_ERROR))	// no input on this file descriptor?
-			continue;					// no, look again
-		if (fd == m_Listener)			// input from listener?
-		{								// accept a new connection
-			sockaddr_in remote;
-			socklen_t fromlen = sizeof(remote);
-			m_CurSock = accept(m_Listener, (struct sockaddr*) &remote, &fromlen);
-			if (m_CurSock == INVALID_SOCKET)
-				SOCKERR("Socket::IsEmpty socket accept failed", true);
-			if (!FD_ISSET(m_CurSock, &m_Clients))
-			{
-				++n;
-				cheat->AddConnection(m_CurSock);
-				FD_SET(m_CurSock, &m_Pending);
-			}
-			FD_CLR(m_Listener, &m_Pending);
-			--i;
-			--n;
+		Client&	client = m_Clients[i];
+
+		if (client.Sock == INVALID_SOCKET)
 			continue;
-		}
-		m_CurSock = fd;					// new socket to read from
-		if (m_NumReads++ < MaxReads)		// be empty after MaxReads recvs
-			return false;
-		m_NumReads = 0;			// start recv counter again
-		return true;					// report empty status
+		if (client.SendEnd > client.SendStart)
+			SendQueue(i, NULL, 0);
+		if (client.Sock != INVALID_SOCKET)
+			CheckSlow(i, now);
 	}
-	cheat->m_NumReads = 0;				// start recv counter again
-	m_CurSock = SOCKET(SOCKET_ERROR);
-	return true;						// no more input
 }
 
-/****
+/*!
+ * @fn bool SocketArbitrator::SendConnection(intptr connection, const char* buf, int nbytes)
+ * @param connection	device handle (SOCKET) of client to send to
+ * @param buf			data to send
+ * @param nbytes		number of bytes to send
  *
- * Socket override for Stream::Read
- * Try to recieve a message from the socket.
- * Check for error or closure and read data if available.
+ * Sends a packet to a client without waiting. Output already queued
+ * for the client and the new packet are written together.
+ * Whatever the socket does not accept is queued.
  *
- ****/
-size_t SocketArbitrator::Read(char* buffer, size_t len)
+ * @return \b true if the packet was sent or queued, \b false if the client is not connected
+ *
+ * @see SocketArbitrator::Flush
+ */
+bool SocketArbitrator::SendConnection(intptr connection, const char* buf, int nbytes)
 {
-	long	nread = 0;
-	long	ofs = 0;
-	long	l = (long) len;
+	int		connid = FindConnection(connection);
 
-	if (!(m_openmode & OPEN_READ))
-		return 0;
-	if (m_CurSock == SOCKET(SOCKET_ERROR))			// can't read anything
-		return 0;
-	while ((l -= nread) > 0)
+	if (connid < 0)
+		return false;
+	if (!SendQueue(connid, buf, nbytes))
+		return false;
+	CheckSlow(connid, Profiler::GetTicks());
+	return m_Clients[connid].Sock != INVALID_SOCKET;
+}
+
+/*
+ * Writes the send queue of a client followed by the given
+ * packet with a single gather write. Anything not written
+ * is appended to the queue.
+ * @return false if the client was dropped because of an error
+ */
+bool SocketArbitrator::SendQueue(int connid, const char* buf, int nbytes)
+{
+	Client&	client = m_Clients[connid];
+	long	queued = client.SendEnd - client.SendStart;
+	long	nsent;
+
+	nsent = SendGather(client.Sock, client.SendBuf + client.SendStart, queued, buf, nbytes);
+	VX_TRACE(Debug > 1, ("SocketArbitrator::SendQueue %d sent %d of %d", connid, nsent, queued + nbytes));
+	if (nsent < 0)								// error, remove this client
 	{
-		nread = recv(m_CurSock, buffer + ofs, l, 0);
-//		VX_TRACE(Debug, ("Socket::Read %d", nread));
-		if ((nread == SOCKET_ERROR) || (nread <= 0))// socket read error?
+		SOCKMSG("SocketArbitrator::SendQueue socket send failed");
+		DropClient(connid, true);
+		return false;
+	}
+	if (nsent >= queued)						// sent everything queued?
+	{
+		buf += nsent - queued;
+		nbytes -= nsent - queued;
+		client.SendStart = client.SendEnd = 0;
+		client.NumPackets = 0;
+	}
+	else										// sent part of the queue
+	{
+		client.SendStart += nsent;
+		if ((client.NumPackets > 0) && (client.Packets[0] <= client.SendStart))
 		{
-			RemoveConnection(m_CurSock);
-			m_CurSock = SOCKET(SOCKET_ERROR);
-			SOCKERR("Socket::Read socket recv failed ", false);
+			int n = 1;
+			while ((n < client.NumPackets) && (client.Packets[n] <= client.SendStart))
+				++n;
+			client.NumPackets -= n;
+			memmove(client.Packets, client.Packets + n, client.NumPackets * sizeof(int32));
 		}
-		ofs += nread;								// count bytes read
 	}
-	return nread;
+	if ((nbytes > 0) && !Enqueue(client, buf, nbytes))
+	{
+		DropClient(connid, true);
+		return false;
+	}
+	if (client.SendEnd == client.SendStart)		// nothing queued?
+		client.StallTicks = 0;
+	else if ((nsent > 0) || (client.StallTicks == 0))
+		client.StallTicks = Profiler::GetTicks();
+	return true;
 }
 
-size_t SocketArbitrator::Write(const char* buf, size_t nbytes)
+/*
+ * Appends a packet to the send queue for a client.
+ * The queue is compacted before it is enlarged.
+ */
+bool SocketArbitrator::Enqueue(Client& client, const char* buf, int nbytes)
 {
-	long	nsent = 0;
-	long	n = (long) nbytes;
+	int32	size = client.SendEnd - client.SendStart;
 
-	while ((nbytes -= nsent) > 0)
+	if (client.SendStart > 0)
 	{
-		VX_TRACE(Debug, ("Socket::Write %p %d", m_CurSock, n));
-		nsent = send(m_CurSock, buf, n, 0);
-		if (nsent == SOCKET_ERROR)	// error, remove this client
-			SOCKERR("Socket::Write socket send failed", false);
-		buf += nsent;				// couldn't send it all
-		n -= nsent;					// try to send the rest
+		memmove(client.SendBuf, client.SendBuf + client.SendStart, size);
+		for (int i = 0; i < client.NumPackets; ++i)
+			client.Packets[i] -= client.SendStart;
+		client.SendStart = 0;
+		client.SendEnd = size;
 	}
-	return n;
+	if (size + nbytes > client.SendMax)
+	{
+		int32	newmax = client.SendMax ? client.SendMax : SOCK_QueueSize;
+		char*	newbuf;
+
+		while (newmax < size + nbytes)
+			newmax *= 2;
+		newbuf = (char*) realloc(client.SendBuf, newmax);
+		if (newbuf == NULL)
+			VX_ERROR(("SocketArbitrator: ERROR out of memory for send queue"), false);
+		client.SendBuf = newbuf;
+		client.SendMax = newmax;
+	}
+	if (client.NumPackets >= client.MaxPackets)
+	{
+		int32	newmax = client.MaxPackets ? 2 * client.MaxPackets : 16;
+		int32*	newpk = (int32*) realloc(client.Packets, newmax * sizeof(int32));
+
+		if (newpk == NULL)
+			VX_ERROR(("SocketArbitrator: ERROR out of memory for send queue"), false);
+		client.Packets = newpk;
+		client.MaxPackets = newmax;
+	}
+	memcpy(client.SendBuf + client.SendEnd, buf, nbytes);
+	client.SendEnd += nbytes;
+	client.Packets[client.NumPackets++] = client.SendEnd;
+	return true;
 }
 
+/*
+ * Determines if a client is too slow to keep up with the output.
+ * A slow client is either dropped or has the packets in its queue
+ * discarded, depending on SlowPolicy. The first packet in the queue
+ * may have been partially sent. It is kept so the client stays on a
+ * packet boundary. If there is nothing else to discard the client is dropped.
+ */
+void SocketArbitrator::CheckSlow(int connid, int64 now)
+{
+	Client&	client = m_Clients[connid];
+	int32	queued = client.SendEnd - client.SendStart;
+
+	if (queued == 0)
+		return;
+	if ((queued <= MaxQueueBytes) &&
+		((now - client.StallTicks) < int64(MaxStallTime * Profiler::GetTickRate())))
+		return;
+	VX_TRACE(Debug, ("SocketArbitrator: client %d too slow, %d bytes queued", connid, queued));
+	if ((SlowPolicy != SLOW_RESYNC) || (client.NumPackets <= 1))
+	{
+		DropClient(connid, true);
+		return;
+	}
+	client.SendEnd = client.Packets[0];		// keep the first packet, it may be partially sent
+	client.NumPackets = 1;
+	client.StallTicks = now;
+	client.Stalled = true;
+}
 
-void SocketArbitrator::RemoveConnection(intptr connid)
+/*!
+ * @fn int SocketArbitrator::GetQueued(int connid) const
+ * @param connid	ID of connection to query
+ *
+ * @return number of bytes queued for the connection which have not been sent
+ *
+ * @see SocketArbitrator::MaxQueueBytes
+ */
+int SocketArbitrator::GetQueued(int connid) const
 {
-	intptr devhandle = FindConnection(connid);
-	FD_CLR(devhandle, &m_Clients);
-	--m_NumClients;
+	if ((connid < 0) || (connid >= m_NumSlots))
+		return 0;
+	return m_Clients[connid].SendEnd - m_Clients[connid].SendStart;
 }
 
-bool SocketArbitrator::SendConnection(intptr connid, const char* buf, int nbytes)
+/*
+ * Closes the connection to a client and frees its send queue.
+ * @param report	true to report the connection in GetStalled
+ */
+void SocketArbitrator::DropClient(int connid, bool report)
 {
-	SOCKET	socket = (SOCKET) connid;
-	int32	nsent = 0;
-	while ((nbytes -= nsent) > 0)
+	if ((connid < 0) || (connid >= m_NumSlots))
+		return;
+
+	Client&	client = m_Clients[connid];
+
+	if (client.Sock == INVALID_SOCKET)
+		return;
+	VX_TRACE(Debug, ("SocketArbitrator::DropClient %d", connid));
+#ifdef __linux__
+	if (m_EPoll >= 0)
+		epoll_ctl((int) m_EPoll, EPOLL_CTL_DEL, client.Sock, NULL);
+#endif
+	for (int i = m_NextReady; i < m_NumReady; ++i)
+		if (m_Ready[i] == client.Sock)
+			m_Ready[i] = INVALID_SOCKET;
+	if (m_CurSock == client.Sock)
 	{
-		VX_TRACE(Debug, ("Socket::Write %p %d", connid, nbytes));
-		nsent = send(socket, buf, nbytes, 0);
-		if (nsent == SOCKET_ERROR)	// error, remove this client
-			SOCKERR("Socket::Write socket send failed", false);
-		buf += nsent;				// couldn't send it all
-		nbytes -= nsent;			// try to send the rest
+		m_CurSock = SOCKET(SOCKET_ERROR);
+		m_CurConn = -1;
 	}
-	return true;
+	shutdown(client.Sock, 2);
+	closesocket(client.Sock);
+	if (client.SendBuf)
+		free(client.SendBuf);
+	if (client.Packets)
+		free(client.Packets);
+	memset(&client, 0, sizeof(Client));
+	client.Sock = INVALID_SOCKET;
+	client.Stalled = report;
+	--m_NumClients;
 }
 
+/*!
+ * @fn void SocketArbitrator::RemoveConnection(int connid)
+ * @param connid	ID of connection to remove
+ *
+ * Closes the connection to a client. Output queued for the
+ * client is discarded. The slot is reused for the next client.
+ *
+ * @see SocketArbitrator::AddConnection
+ */
+void SocketArbitrator::RemoveConnection(int connid)
+{
+	DropClient(connid, false);
+}
 
+/*!
+ * @fn int SocketArbitrator::AddConnection(intptr connection)
+ * @param connection	device handle (SOCKET) of client connection
+ *
+ * Adds a client socket to the arbitrator in the first free slot.
+ * The socket is made non-blocking.
+ *
+ * @return connection ID of the new client, -1 if there are too many clients
+ */
 int	SocketArbitrator::AddConnection(intptr connection)
 {
-	VX_TRACE(Debug, ("Socket::AddConnection %p", connection));
 	SOCKET	sock = (SOCKET) connection;
-	FD_SET(sock, &m_Clients);
-	return ++m_NumClients;
+	int		val = 1;
+	int		connid;
+
+	VX_TRACE(Debug, ("Socket::AddConnection %p", connection));
+	for (connid = 0; connid < SOCK_MaxClients; ++connid)
+		if (m_Clients[connid].Sock == INVALID_SOCKET)
+			break;
+	if (connid >= SOCK_MaxClients)
+		VX_ERROR(("SocketArbitrator: ERROR too many clients"), -1);
+	SetNonBlocking(sock);
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *) &val, sizeof(val));
+#ifdef __linux__
+	struct epoll_event	ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = sock;
+	if (epoll_ctl((int) m_EPoll, EPOLL_CTL_ADD, sock, &ev) < 0)
+		SOCKERR("SocketArbitrator::AddConnection epoll add failed", -1);
+#endif
+	memset(&m_Clients[connid], 0, sizeof(Client));
+	m_Clients[connid].Sock = sock;
+	if (connid >= m_NumSlots)
+		m_NumSlots = connid + 1;
+	++m_NumClients;
+	return connid;
 }
 
 intptr SocketArbitrator::GetAt(int i) const
 {
-	if (i >= 0)
-		return GETFD(i, &m_Clients);
+	if ((i >= 0) && (i < m_NumSlots) && (m_Clients[i].Sock != INVALID_SOCKET))
+		return (intptr) m_Clients[i].Sock;
 	return -1L;
 }
 
 int SocketArbitrator::GetSize() const
 {
-	return m_NumClients;
+	return m_NumSlots;
 }
 
 int SocketArbitrator::FindConnection(intptr connection) const
 {
-	for (uint32 i = 0; i < m_NumClients; ++i)
-	{
-		SOCKET fd = GETFD(i, &m_Clients);
-		VX_ASSERT(sizeof(SOCKET) <= sizeof(intptr));
-		if (intptr(fd) == connection)
+	VX_ASSERT(sizeof(SOCKET) <= sizeof(intptr));
+	if (connection == intptr(INVALID_SOCKET))
+		return -1;
+	for (int i = 0; i < m_NumSlots; ++i)
+		if (intptr(m_Clients[i].Sock) == connection)
 			return i;
-	}
 	return -1;
 }
 
+/*
+ * Accepts all the pending connections on the listener socket.
+ */
+void SocketArbitrator::Accept()
+{
+	for (;;)
+	{
+		sockaddr_in	remote;
+		socklen_t	fromlen = sizeof(remote);
+		SOCKET		sock = accept(m_Listener, (struct sockaddr*) &remote, &fromlen);
+
+		if (sock == INVALID_SOCKET)
+		{
+			if (!WouldBlock())
+				SOCKMSG("SocketArbitrator::Accept socket accept failed");
+			return;
+		}
+		if (AddConnection(sock) < 0)
+			closesocket(sock);
+	}
+}
+
+/*
+ * Finds the sockets which have input pending or, for the
+ * listener, connections waiting to be accepted. Does not wait.
+ * @return number of sockets ready for input
+ */
+int SocketArbitrator::Poll()
+{
+	m_NumReady = m_NextReady = 0;
+#ifdef __linux__
+	struct epoll_event	events[SOCK_MaxClients + 1];
+	int					n;
+
+	n = epoll_wait((int) m_EPoll, events, SOCK_MaxClients + 1, 0);
+	if (n < 0)
+		SOCKERR("SocketArbitrator::Poll epoll wait failed", 0);
+	for (int i = 0; i < n; ++i)
+		m_Ready[m_NumReady++] = events[i].data.fd;
+#else
+	fd_set	input;
+	timeval	timeout;
+	SOCKET	maxfd = m_Listener;
+
+	timeout.tv_sec = timeout.tv_usec = 0;
+	FD_ZERO(&input);
+	FD_SET(m_Listener, &input);
+	for (int i = 0; i < m_NumSlots; ++i)
+	{
+		SOCKET sock = m_Clients[i].Sock;
+		if (sock == INVALID_SOCKET)
+			continue;
+		FD_SET(sock, &input);
+		if (sock > maxfd)
+			maxfd = sock;
+	}
+	if (select((int) maxfd + 1, &input, 0, 0, &timeout) <= 0)
+		return 0;
+	if (FD_ISSET(m_Listener, &input))
+		m_Ready[m_NumReady++] = m_Listener;
+	for (int i = 0; i < m_NumSlots; ++i)
+	{
+		SOCKET sock = m_Clients[i].Sock;
+		if ((sock != INVALID_SOCKET) && FD_ISSET(sock, &input))
+			m_Ready[m_NumReady++] = sock;
+	}
+#endif
+	return m_NumReady;
+}
+
+/*
+ * Determines whether a client socket has input without reading it.
+ * A client which has closed its connection is dropped.
+ */
+bool SocketArbitrator::HasInput(SOCKET sock)
+{
+	char	c;
+	long	n = recv(sock, &c, 1, MSG_PEEK);
+
+	if (n > 0)
+		return true;
+	if ((n < 0) && WouldBlock())
+		return false;
+	DropClient(FindConnection(sock), true);		// client closed or failed
+	return false;
+}
+
+/*
+ * Waits up to ReadTimeOut seconds for input on a single socket.
+ * Used to get the rest of a message which has partially arrived.
+ */
+bool SocketArbitrator::WaitInput(SOCKET sock)
+{
+	fd_set	input;
+	timeval	timeout;
+
+	timeout.tv_sec = long(ReadTimeOut);
+	timeout.tv_usec = long((ReadTimeOut - timeout.tv_sec) * 1000000);
+	FD_ZERO(&input);
+	FD_SET(sock, &input);
+	return select((int) sock + 1, &input, 0, 0, &timeout) > 0;
+}
+
+/*
+ * Selects the next client with input pending as the current connection.
+ * The current client is read until it has no more input, then the
+ * other clients reported ready by the last poll are tried in order.
+ * New connections are accepted when the listener is ready.
+ * @return true if there is a client with input, else false
+ */
+bool SocketArbitrator::NextInput()
+{
+	if ((m_CurSock != SOCKET(SOCKET_ERROR)) && HasInput(m_CurSock))
+		return true;
+	m_CurSock = SOCKET(SOCKET_ERROR);
+	m_CurConn = -1;
+	for (int npolls = 0; npolls < 2; ++npolls)
+	{
+		while (m_NextReady < m_NumReady)
+		{
+			SOCKET sock = m_Ready[m_NextReady++];
+
+			if (sock == INVALID_SOCKET)
+				continue;
+			if (sock == m_Listener)
+			{
+				Accept();
+				continue;
+			}
+			if (HasInput(sock))
+			{
+				m_CurSock = sock;
+				m_CurConn = FindConnection(sock);
+				return true;
+			}
+		}
+		if (Poll() == 0)
+			return false;
+	}
+	return false;
+}
+
+/*!
+ * @fn bool SocketArbitrator::IsEmpty() const
+ *
+ * Determines whether any client has input to read.
+ * Queued output is also written each time the input is checked.
+ * If there is input, the client it came from becomes
+ * the current connection and will be read by SocketArbitrator::Read.
+ * Clients are read one at a time until they have no more input.
+ *
+ * @see Arbitrator::GetConnection
+ */
+bool SocketArbitrator::IsEmpty() const
+{
+	SocketArbitrator*	cheat = (SocketArbitrator*) this;
+
+	if (!(m_openmode & OPEN_READ))
+		return true;
+	cheat->Flush();
+	return !cheat->NextInput();
+}
+
+/****
+ *
+ * SocketArbitrator override for Stream::Read
+ * Receive a message from the current client.
+ * If only part of the message has arrived,
+ * wait a little while for the rest.
+ *
+ ****/
+size_t SocketArbitrator::Read(char* buffer, size_t len)
+{
+	long	nread;
+	size_t	ofs = 0;
+
+	if (!(m_openmode & OPEN_READ))
+		return 0;
+	while (ofs < len)
+	{
+		if (m_CurSock == SOCKET(SOCKET_ERROR))		// can't read anything
+			return 0;
+		nread = recv(m_CurSock, buffer + ofs, (int) (len - ofs), 0);
+		if (nread > 0)
+		{
+			ofs += nread;								// count bytes read
+			continue;
+		}
+		if ((nread < 0) && WouldBlock() && WaitInput(m_CurSock))
+			continue;
+		DropClient(FindConnection(m_CurSock), true);	// socket read error
+		SOCKERR("Socket::Read socket recv failed ", 0);
+	}
+	return ofs;
+}
+
+/****
+ *
+ * SocketArbitrator override for Stream::Write
+ * Sends to the current client without waiting.
+ *
+ ****/
+size_t SocketArbitrator::Write(const char* buf, size_t nbytes)
+{
+	if (m_CurSock == SOCKET(SOCKET_ERROR))
+		return 0;
+	if (!SendConnection((intptr) m_CurSock, buf, (int) nbytes))
+		return 0;
+	return nbytes;
+}
+
 
 }	// end Core
 }	// end Vixen
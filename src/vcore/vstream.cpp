@@ -546,6 +546,26 @@ int Arbitrator::GetSize() const
 	{ return (int) m_Connections.GetSize(); }
 
 
+/*!
+ * @fn int Arbitrator::GetStalled(int* connections, int n)
+ * @param connections	Array to get IDs of stalled connections.
+ * @param n				Maximum number of IDs to return.
+ *
+ * Reports the connections which could not keep up with the output
+ * sent to them and were either disconnected or had output discarded.
+ * The caller must resynchronize these connections. Connections which
+ * were disconnected are no longer valid, Arbitrator::GetAt returns
+ * -1 for them. The default implementation never stalls.
+ *
+ * @return number of connection IDs returned
+ *
+ * @see SocketArbitrator::SlowPolicy
+ */
+int Arbitrator::GetStalled(int* connections, int n)
+{
+	return 0;
+}
+
 /*!
  * @fn int Arbitrator::Select(int* connections, int n)
  * @param connections	Array of connection IDs for connections to check.
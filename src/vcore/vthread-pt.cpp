@@ -112,6 +112,7 @@ Thread::Thread(int opts)
 	m_ThreadIndex = 0;
 	m_IsRunning = false;
 	m_ThreadFunc = NULL;
+	m_ThreadHandle = 0;
 }
 
 /*!
@@ -122,8 +123,9 @@ Thread::Thread(int opts)
  * The argument passed to the thread function is the
  * pointer to this Thread. If this function pointer is NULL,
  * the function specified by \b SetThreadFunc is used.
+ * If the thread cannot be created, the thread handle is NULL.
  *
- * @see Scene::EndThread Scene::InitThread ThreadPool::RunAll Thread::SetThreadFunc
+ * @see Scene::EndThread Scene::InitThread ThreadPool::RunAll Thread::SetThreadFunc Thread::Join
  */
 void Thread::Run(ThreadFunc* func)
 {
@@ -132,8 +134,33 @@ void Thread::Run(ThreadFunc* func)
 	if (func == NULL)
 		return;
 
-	pthread_create(&m_ThreadHandle, NULL, func, this);
 	m_IsRunning = true;
+	if (pthread_create(&m_ThreadHandle, NULL, func, this) != 0)
+	{
+		m_IsRunning = false;
+		m_ThreadHandle = 0;
+		VX_ERROR_RETURN(("Thread::Run ERROR cannot create thread\n"));
+	}
+}
+
+/*!
+ * @fn bool Thread::Join()
+ *
+ * Waits for a thread started by Thread::Run to exit and
+ * releases the resources the system keeps for it.
+ *
+ * @return \b true if the thread was running, \b false if it was never started
+ *
+ * @see Thread::Run
+ */
+bool Thread::Join()
+{
+	if (m_ThreadHandle == 0)
+		return false;
+	pthread_join(m_ThreadHandle, NULL);
+	m_ThreadHandle = 0;
+	m_IsRunning = false;
+	return true;
 }
 
 Semaphore*	Thread::GetDoneEvent()
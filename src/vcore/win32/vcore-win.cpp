@@ -60,6 +60,9 @@ bool _cdecl CoreInit()
 void _cdecl CoreExit()
 {
 	Core::NetStream::Shutdown();			// shut down internet session
+	Epoch::SetEnabled(false);				// free retired objects
+	AtomTable::FreeAll();					// free interned names
+	Profiler::Shutdown();					// free profiler buffers
 	if (GlobalAllocator::s_ptheOneAndOnly == NULL)
 		return;
 	PoolAllocator::s_ptheOneAndOnly->FreeAll();
@@ -5,9 +5,52 @@
 namespace Vixen {
 namespace Core {
 
+/*!
+ * @fn double GetTime()
+ *
+ * Returns the time in seconds from the performance counter.
+ * Unlike timeGetTime, this does not wrap around after 49 days
+ * and has sub-microsecond resolution.
+ *
+ * @see GetTimeNS
+ */
 double GetTime()
 {
-	return (double) ::timeGetTime() * 0.001f;
+	static double	period = 0;
+	LARGE_INTEGER	t;
+
+	if (period == 0)
+	{
+		LARGE_INTEGER	f;
+
+		::QueryPerformanceFrequency(&f);
+		period = 1.0 / double(f.QuadPart);
+	}
+	::QueryPerformanceCounter(&t);
+	return double(t.QuadPart) * period;
+}
+
+/*!
+ * @fn int64 GetTimeNS()
+ *
+ * Returns the time in nanoseconds from the performance counter.
+ *
+ * @see GetTime
+ */
+int64 GetTimeNS()
+{
+	static int64	freq = 0;
+	LARGE_INTEGER	t;
+
+	if (freq == 0)
+	{
+		LARGE_INTEGER	f;
+
+		::QueryPerformanceFrequency(&f);
+		freq = f.QuadPart;
+	}
+	::QueryPerformanceCounter(&t);
+	return (t.QuadPart / freq) * 1000000000 + ((t.QuadPart % freq) * 1000000000) / freq;
 }
 
 bool	CritSec::DoLock = false;
@@ -56,8 +56,9 @@ Thread::~Thread()
  * The argument passed to the thread function is the
  * pointer to this Thread. If this function pointer is NULL,
  * the function specified by \b SetThreadFunc is used.
+ * If the thread cannot be created, the thread handle is NULL.
  *
- * @see Scene::EndThread Scene::InitThread ThreadPool::RunAll Thread::SetThreadFunc
+ * @see Thread::Join Scene::EndThread Scene::InitThread ThreadPool::RunAll Thread::SetThreadFunc
  */
 void Thread::Run(ThreadFunc* func)
 {
@@ -69,9 +70,37 @@ void Thread::Run(ThreadFunc* func)
 	{
 		m_IsRunning = true;
 		m_ThreadHandle = (HANDLE) _beginthread(func, 0, this);
+		if (m_ThreadHandle == (HANDLE) -1L)
+		{
+			m_IsRunning = false;
+			m_ThreadHandle = NULL;
+			VX_ERROR_RETURN(("Thread::Run ERROR cannot create thread\n"));
+		}
 	}
 }
 
+/*!
+ * @fn bool Thread::Join()
+ *
+ * Waits for a thread started by Thread::Run to finish.
+ * The system closes the thread handle when the thread exits,
+ * so this waits for the done event the thread function signals
+ * with Thread::Stop before it returns.
+ *
+ * @return \b true if the thread was running, \b false if it was never started
+ *
+ * @see Thread::Run Thread::Stop
+ */
+bool Thread::Join()
+{
+	if (m_ThreadHandle == NULL)
+		return false;
+	while (m_DoneEvent.Wait() == VX_WaitTimeOut)
+		;
+	m_ThreadHandle = NULL;
+	return true;
+}
+
 int Thread::GetNumProcessors()
 {
 #ifdef _OPENMP
@@ -0,0 +1,95 @@
+/*
+ * Unit tests for the atom table.
+ *
+ * Checks that interning is stable, that names which differ only in
+ * case share a folded atom and hash, that looking up names does not
+ * add them and that the table grows past its first block.
+ * Also checks that name properties made for lookups do not intern.
+ */
+#include "vxtest.h"
+
+using namespace Vixen;
+
+#define	TEST_NumNames	5000	// more than ATOM_BlockSize
+
+int main(int argc, char** argv)
+{
+	Core::Atom*	atoms = (Core::Atom*) malloc(TEST_NumNames * sizeof(Core::Atom));
+	TCHAR		name[64];
+	int32		size;
+
+	if (!TestInit())
+		return 1;
+	/*
+	 * The empty name is always atom zero
+	 */
+	TEST_CHECK(Core::AtomTable::Intern(NULL) == 0);
+	TEST_CHECK(Core::AtomTable::Intern(TEXT("")) == 0);
+	TEST_CHECK(Core::AtomTable::Find(NULL) == 0);
+	TEST_CHECK(Core::AtomTable::GetString(0).IsEmpty());
+	/*
+	 * Interning the same string twice gives the same atom
+	 */
+	Core::Atom a1 = Core::AtomTable::Intern(TEXT("test.root"));
+	Core::Atom a2 = Core::AtomTable::Intern(TEXT("test.root"));
+	TEST_CHECK(a1 != 0);
+	TEST_CHECK(a1 == a2);
+	TEST_CHECK(Core::AtomTable::GetString(a1) == TEXT("test.root"));
+	TEST_CHECK(Core::AtomTable::Find(TEXT("test.root")) == a1);
+	/*
+	 * Names which differ in case get different atoms
+	 * which compare equal and have the same hash
+	 */
+	Core::Atom a3 = Core::AtomTable::Intern(TEXT("TEST.Root"));
+	TEST_CHECK(a3 != a1);
+	TEST_CHECK(Core::AtomTable::GetFolded(a3) == a1);
+	TEST_CHECK(Core::AtomTable::Equal(a1, a3));
+	TEST_CHECK(Core::AtomTable::GetHash(a1) == Core::AtomTable::GetHash(a3));
+	TEST_CHECK(Core::AtomTable::GetHash(a1) == Core::AtomTable::Hash(TEXT("test.ROOT")));
+	TEST_CHECK(Core::AtomTable::GetString(a3) == TEXT("TEST.Root"));
+	TEST_CHECK(Core::AtomTable::Find(TEXT("test.ROOT")) == a1);
+	TEST_CHECK(!Core::AtomTable::Equal(a1, Core::AtomTable::Intern(TEXT("test.root2"))));
+	/*
+	 * Find does not add names
+	 */
+	size = Core::AtomTable::GetSize();
+	TEST_CHECK(Core::AtomTable::Find(TEXT("not.interned")) == 0);
+	TEST_CHECK(Core::AtomTable::GetSize() == size);
+	/*
+	 * Name properties intern when assigned but not when used for lookup
+	 */
+	NameProp	np;
+
+	size = Core::AtomTable::GetSize();
+	TEST_CHECK(!np.Find(TEXT("lookup.only")));
+	TEST_CHECK(Core::AtomTable::GetSize() == size);
+	TEST_CHECK(np == TEXT("lookup.only"));
+	TEST_CHECK(np.Find(TEXT("TEST.ROOT")));
+	TEST_CHECK(np.GetAtom() == a1);
+	np = TEXT("assigned.name");
+	TEST_CHECK(np.GetAtom() != 0);
+	TEST_CHECK(Core::AtomTable::GetSize() == size + 1);
+	TEST_CHECK(np.IsSame(NameProp(TEXT("ASSIGNED.name"))));
+	TEST_CHECK(np.GetHash() == Core::AtomTable::Hash(TEXT("assigned.NAME")));
+	/*
+	 * Many names, the table grows and all the atoms stay valid
+	 */
+	for (int i = 0; i < TEST_NumNames; ++i)
+	{
+		SPRINTF(name, TEXT("test.name%d"), i);
+		atoms[i] = Core::AtomTable::Intern(name);
+		TEST_CHECK(atoms[i] != 0);
+	}
+	TEST_CHECK(Core::AtomTable::GetSize() >= size + TEST_NumNames);
+	for (int i = 0; i < TEST_NumNames; ++i)
+	{
+		SPRINTF(name, TEXT("TEST.NAME%d"), i);
+		TEST_CHECK(Core::AtomTable::Find(name) == atoms[i]);
+		SPRINTF(name, TEXT("test.name%d"), i);
+		TEST_CHECK(Core::AtomTable::GetString(atoms[i]) == name);
+		TEST_CHECK(Core::AtomTable::Intern(name) == atoms[i]);
+	}
+	TEST_CHECK(Core::AtomTable::GetString(a1) == TEXT("test.root"));
+	free(atoms);
+	return TestExit();
+}
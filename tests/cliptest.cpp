@@ -0,0 +1,184 @@
+/*
+ * Unit tests for compressed animation clips.
+ *
+ * Compresses random rotations with every key kept so only the
+ * quaternion and position quantization changes the values, then
+ * smooth motion with the default tolerances, and checks the
+ * decompressed values against the samples. A clip written to a
+ * file and opened again must evaluate the same.
+ */
+#include "vxtest.h"
+
+using namespace Vixen;
+
+#define	TEST_NumFrames	300
+#define	TEST_FrameSize	11			// root position, root rotation, child rotation
+#define	TEST_TimeStep	(1.0f / 30.0f)
+#define	TEST_File		TEXT("cliptest.vxa")
+
+static uint32	s_Seed = 7;
+
+static float Random()
+{
+	s_Seed = s_Seed * 1103515245 + 12345;
+	return float((s_Seed >> 8) & 0xFFFF) / 65535.0f * 2.0f - 1.0f;
+}
+
+/*
+ * Returns the angle between two rotations in radians, q and -q are the same rotation
+ */
+static float Angle(const float* q1, const float* q2)
+{
+	float	d = fabsf(q1[0] * q2[0] + q1[1] * q2[1] + q1[2] * q2[2] + q1[3] * q2[3]);
+
+	return (d >= 1.0f) ? 0.0f : 2.0f * acosf(d);
+}
+
+static float Distance(const float* p1, const float* p2)
+{
+	float	dx = p1[0] - p2[0];
+	float	dy = p1[1] - p2[1];
+	float	dz = p1[2] - p2[2];
+
+	return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+/*
+ * Makes the clip skeleton: a root bone with position and rotation channels
+ * and a child bone with a rotation channel.
+ */
+static AnimClip* MakeClip()
+{
+	AnimClip*	clip = new AnimClip;
+
+	clip->AddBone(TEXT("root"), -1, Vec3(0, 0, 0), Quat(0, 0, 0, 1));
+	clip->AddBone(TEXT("child"), 0, Vec3(0, 1, 0), Quat(0, 0, 0, 1));
+	clip->AddChannel(0, Evaluator::POSITION);
+	clip->AddChannel(0, Evaluator::ROTATION);
+	clip->AddChannel(1, Evaluator::ROTATION);
+	return clip;
+}
+
+/*
+ * Evaluates each frame of a clip and returns the largest position
+ * and rotation differences from the samples.
+ */
+static void MeasureError(AnimClip* clip, const float* samples, float* poserr, float* roterr)
+{
+	float	val[4];
+
+	*poserr = 0.0f;
+	*roterr = 0.0f;
+	for (int f = 0; f < TEST_NumFrames; ++f)
+	{
+		const float*	s = samples + f * TEST_FrameSize;
+		float			err;
+
+		if (!TEST_CHECK(clip->Eval(0, f * TEST_TimeStep, val)))
+			return;
+		if ((err = Distance(val, s)) > *poserr)
+			*poserr = err;
+		for (int c = 1; c < 3; ++c)
+		{
+			if (!TEST_CHECK(clip->Eval(c, f * TEST_TimeStep, val)))
+				return;
+			if ((err = Angle(val, s + 3 + (c - 1) * 4)) > *roterr)
+				*roterr = err;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	float*	samples = (float*) malloc(TEST_NumFrames * TEST_FrameSize * sizeof(float));
+	float	poserr, roterr;
+	float	val1[4], val2[4];
+
+	if (!TestInit())
+		return 1;
+	/*
+	 * Random values with no keys removed. All four quaternion components
+	 * take turns being the largest and half the quaternions are negated.
+	 */
+	for (int f = 0; f < TEST_NumFrames; ++f)
+	{
+		float*	s = samples + f * TEST_FrameSize;
+
+		for (int i = 0; i < 3; ++i)
+			s[i] = Random() * 100.0f;
+		for (int c = 0; c < 2; ++c)
+		{
+			Quat	q(Random(), Random(), Random(), Random());
+
+			q[f & 3] = 2.0f * ((f & 4) ? -1.0f : 1.0f);
+			q.Normalize();
+			memcpy(s + 3 + c * 4, &q, 4 * sizeof(float));
+		}
+	}
+	{
+		float	postol = AnimClip::PosTolerance;
+		float	rottol = AnimClip::RotTolerance;
+		Ref<AnimClip>	clip;
+
+		AnimClip::PosTolerance = 0.0f;
+		AnimClip::RotTolerance = 0.0f;
+		clip = MakeClip();
+		TEST_CHECK(clip->Compress(samples, TEST_NumFrames, TEST_TimeStep));
+		AnimClip::PosTolerance = postol;
+		AnimClip::RotTolerance = rottol;
+		TEST_CHECK(clip->GetNumKeys() == 3 * TEST_NumFrames);
+		MeasureError(clip, samples, &poserr, &roterr);
+		TEST_CHECK(poserr < 200.0f / 65535.0f * 2.0f);	// 16 bits over the range of the window
+		TEST_CHECK(roterr < 0.0005f);					// 15 bits per quaternion component
+		TEST_CHECK(fabsf(roterr - clip->GetRotError()) < 0.0001f);
+	}
+	/*
+	 * Smooth motion with the default tolerances keeps few keys
+	 */
+	for (int f = 0; f < TEST_NumFrames; ++f)
+	{
+		float*	s = samples + f * TEST_FrameSize;
+		float	t = f * TEST_TimeStep;
+		Quat	q1(Vec3(0, 1, 0), t * 2.0f);
+		Quat	q2(Vec3(1, 0, 0), sinf(t * 3.0f));
+
+		s[0] = t * 2.0f;
+		s[1] = sinf(t);
+		s[2] = 0.0f;
+		memcpy(s + 3, &q1, 4 * sizeof(float));
+		memcpy(s + 7, &q2, 4 * sizeof(float));
+	}
+	{
+		Ref<AnimClip>	clip = MakeClip();
+		Ref<AnimClip>	loaded = new AnimClip;
+		Ref<Core::FileStream>	out = new Core::FileStream;
+		Ref<Core::FileStream>	in = new Core::FileStream;
+
+		TEST_CHECK(clip->Compress(samples, TEST_NumFrames, TEST_TimeStep));
+		TEST_CHECK(clip->GetNumKeys() < TEST_NumFrames);
+		MeasureError(clip, samples, &poserr, &roterr);
+		TEST_CHECK(poserr <= AnimClip::PosTolerance + 0.001f);
+		TEST_CHECK(roterr <= AnimClip::RotTolerance + 0.0005f);
+		/*
+		 * The clip read back from a file has the same values
+		 */
+		TEST_CHECK(out->Open(TEST_File, Core::Stream::OPEN_WRITE));
+		TEST_CHECK(clip->Write(out));
+		out->Close();
+		TEST_CHECK(in->Open(TEST_File, Core::Stream::OPEN_READ));
+		TEST_CHECK(loaded->Open(in));
+		TEST_CHECK(loaded->GetNumFrames() == TEST_NumFrames);
+		TEST_CHECK(loaded->GetNumKeys() == clip->GetNumKeys());
+		for (int f = 0; f < TEST_NumFrames; f += 7)
+			for (int c = 0; c < 3; ++c)
+			{
+				TEST_CHECK(clip->Eval(c, f * TEST_TimeStep, val1));
+				TEST_CHECK(loaded->Eval(c, f * TEST_TimeStep, val2));
+				TEST_CHECK(memcmp(val1, val2, ((c == 0) ? 3 : 4) * sizeof(float)) == 0);
+			}
+		loaded = (AnimClip*) NULL;			// closes the input file
+		remove(TEST_File);
+	}
+	free(samples);
+	return TestExit();
+}
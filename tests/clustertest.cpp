@@ -0,0 +1,69 @@
+/*
+ * Unit tests for the clustered light assignment.
+ *
+ * Builds a light cluster with more lights than the old per-model light
+ * mask could address and checks that lights past LIGHT_MaxLights are
+ * found, that each light is returned once even if the model overlaps
+ * several cells and that the global lights come first.
+ */
+#include "vxtest.h"
+
+using namespace Vixen;
+
+#define	TEST_NumLights	40
+
+int main(int argc, char** argv)
+{
+	Vec4	lights[TEST_NumLights];
+	int32	ids[TEST_NumLights];
+	uint16	found[64];
+	int		count[TEST_NumLights];
+	int		n;
+
+	if (!TestInit())
+		return 1;
+	/*
+	 * Light 0 illuminates everything, the others are small lights in a row
+	 * in front of the default camera looking down -Z
+	 */
+	lights[0].Set(0.0f, 0.0f, 0.0f, 0.0f);
+	ids[0] = 0;
+	for (int i = 1; i < TEST_NumLights; ++i)
+	{
+		lights[i].Set(-4.0f + 0.2f * i, 0.0f, -10.0f, 0.5f);
+		ids[i] = i;
+	}
+	{
+		Ref<Camera>		cam = new Camera;
+		LightCluster	cluster;
+
+		TEST_CHECK(cluster.Build(cam, lights, ids, TEST_NumLights));
+		TEST_CHECK(cluster.IsBuilt());
+		TEST_CHECK(cluster.GetNumLights() == TEST_NumLights);
+		/*
+		 * A sphere covering the whole row returns every light once
+		 */
+		n = cluster.GetLights(Sphere(Vec3(0.0f, 0.0f, -10.0f), 6.0f), found, 64);
+		TEST_CHECK(n == TEST_NumLights);
+		TEST_CHECK((n > 0) && (found[0] == 0));
+		memset(count, 0, sizeof(count));
+		for (int i = 0; i < n; ++i)
+			if (TEST_CHECK(found[i] < TEST_NumLights))
+				++count[found[i]];
+		for (int i = 0; i < TEST_NumLights; ++i)
+			TEST_CHECK(count[i] == 1);
+		/*
+		 * A small sphere at the far end of the row only returns
+		 * the global light and lights past LIGHT_MaxLights
+		 */
+		n = cluster.GetLights(Sphere(Vec3(3.6f, 0.0f, -10.0f), 0.1f), found, 64);
+		TEST_CHECK((n > 1) && (found[0] == 0));
+		for (int i = 1; i < n; ++i)
+			TEST_CHECK(found[i] >= 2 * LIGHT_MaxLights);
+		/*
+		 * The result is clipped to the size of the output array
+		 */
+		TEST_CHECK(cluster.GetLights(Sphere(Vec3(0.0f, 0.0f, -10.0f), 6.0f), found, 8) == 8);
+	}
+	return TestExit();
+}
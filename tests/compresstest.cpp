@@ -0,0 +1,95 @@
+/*
+ * Unit tests for the block compressor.
+ *
+ * Compresses buffers of different sizes and contents and checks
+ * that they decompress to the original bytes, that incompressible
+ * data fits in Compressor::GetMaxSize and that bad input is rejected
+ * without writing past the output buffer.
+ */
+#include "vxtest.h"
+
+using namespace Vixen;
+
+#define	TEST_MaxSize	(256 * 1024)
+
+/*
+ * Fills a buffer with one of several kinds of data:
+ * 0 = all zero, 1 = repeating text, 2 = random bytes, 3 = short random runs
+ */
+static void MakeData(char* buf, int32 n, int kind)
+{
+	static const char	text[] = "the quick brown fox jumps over the lazy dog ";
+	uint32				seed = 12345;
+
+	for (int32 i = 0; i < n; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		switch (kind)
+		{
+			case 0: buf[i] = 0; break;
+			case 1: buf[i] = text[i % (sizeof(text) - 1)]; break;
+			case 2: buf[i] = char(seed >> 16); break;
+			default: buf[i] = char((seed >> 28) & 3); break;
+		}
+	}
+}
+
+/*
+ * Compresses and decompresses one buffer, returns compressed size
+ */
+static int32 RoundTrip(const char* src, int32 n, char* packed, char* dst)
+{
+	int32	maxsize = Core::Compressor::GetMaxSize(n);
+	int32	packsize = Core::Compressor::Compress(src, n, packed, maxsize);
+
+	if (!TEST_CHECK((packsize > 0) || (n == 0)))
+		return -1;
+	memset(dst, 0xCD, n + 16);
+	TEST_CHECK(Core::Compressor::Decompress(packed, packsize, dst, n) == n);
+	TEST_CHECK(memcmp(src, dst, n) == 0);
+	TEST_CHECK((uchar) dst[n] == 0xCD);			// nothing written past the end
+	return packsize;
+}
+
+int main(int argc, char** argv)
+{
+	static const int32	sizes[] = { 0, 1, 5, 12, 13, 64, 1000, 65535, 65536, 70000, TEST_MaxSize };
+	char*	src = (char*) malloc(TEST_MaxSize);
+	char*	dst = (char*) malloc(TEST_MaxSize + 16);
+	char*	packed = (char*) malloc(Core::Compressor::GetMaxSize(TEST_MaxSize));
+
+	if (!TestInit())
+		return 1;
+	for (int kind = 0; kind < 4; ++kind)
+	{
+		MakeData(src, TEST_MaxSize, kind);
+		for (int s = 0; s < sizeof(sizes) / sizeof(int32); ++s)
+		{
+			int32	n = sizes[s];
+			int32	packsize = RoundTrip(src, n, packed, dst);
+
+			if ((kind == 0) && (n >= 1000))		// zeros must compress well
+				TEST_CHECK(packsize < n / 20);
+			if ((kind == 2) && (n > 0))			// random data fits in the maximum size
+				TEST_CHECK(packsize <= Core::Compressor::GetMaxSize(n));
+		}
+	}
+	/*
+	 * An output buffer which is too small must fail, not overflow
+	 */
+	MakeData(src, 1000, 2);
+	TEST_CHECK(Core::Compressor::Compress(src, 1000, packed, 100) == 0);
+	/*
+	 * Truncated input must not decompress to the whole block and
+	 * an output buffer which is too small must be rejected
+	 */
+	MakeData(src, 4096, 1);
+	int32 packsize = Core::Compressor::Compress(src, 4096, packed, Core::Compressor::GetMaxSize(4096));
+	TEST_CHECK(packsize > 0);
+	TEST_CHECK(Core::Compressor::Decompress(packed, packsize / 2, dst, 4096) != 4096);
+	TEST_CHECK(Core::Compressor::Decompress(packed, packsize, dst, 2048) < 0);
+	free(src);
+	free(dst);
+	free(packed);
+	return TestExit();
+}
@@ -0,0 +1,106 @@
+/*
+ * Unit tests for the skyline packer of the glyph atlas.
+ *
+ * Packs rectangles into an empty atlas and checks that they stay
+ * inside the atlas, do not overlap each other and that the atlas
+ * reports full only when a rectangle really cannot fit.
+ */
+#include "vxtest.h"
+#include "render/vxglyphatlas.h"
+
+using namespace Vixen;
+
+#define	TEST_AtlasSize	256
+#define	TEST_MaxRects	4096
+
+/*
+ * Atlas which lets the test call the packer directly.
+ */
+class TestAtlas : public GlyphAtlas
+{
+public:
+	TestAtlas() : GlyphAtlas(TEST_AtlasSize, TEST_AtlasSize) { }
+
+	bool	Pack(int w, int h, int* x, int* y)	{ return GlyphAtlas::Pack(w, h, x, y); }
+};
+
+/*
+ * Marks the pixels covered by a rectangle, returns false
+ * if the rectangle is outside the atlas or covers a marked pixel
+ */
+static bool Cover(uchar* used, int x, int y, int w, int h)
+{
+	if ((x < 0) || (y < 0) || (x + w > TEST_AtlasSize) || (y + h > TEST_AtlasSize))
+		return false;
+	for (int j = y; j < y + h; ++j)
+		for (int i = x; i < x + w; ++i)
+		{
+			if (used[j * TEST_AtlasSize + i])
+				return false;
+			used[j * TEST_AtlasSize + i] = 1;
+		}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	uchar*	used = (uchar*) calloc(TEST_AtlasSize * TEST_AtlasSize, 1);
+	uint32	seed = 1;
+	int		x, y, n, area;
+
+	if (!TestInit())
+		return 1;
+	/*
+	 * Equal squares tile the atlas exactly
+	 */
+	{
+		Ref<TestAtlas>	atlas = new TestAtlas;
+
+		for (n = 0; n < 16; ++n)
+		{
+			TEST_CHECK(atlas->Pack(64, 64, &x, &y));
+			TEST_CHECK(Cover(used, x, y, 64, 64));
+		}
+		TEST_CHECK(!atlas->Pack(64, 64, &x, &y));
+		TEST_CHECK(!atlas->Pack(1, 1, &x, &y));
+	}
+	/*
+	 * Rectangles too big for the atlas are rejected
+	 */
+	{
+		Ref<TestAtlas>	atlas = new TestAtlas;
+
+		TEST_CHECK(!atlas->Pack(TEST_AtlasSize + 1, 1, &x, &y));
+		TEST_CHECK(!atlas->Pack(1, TEST_AtlasSize + 1, &x, &y));
+		TEST_CHECK(atlas->Pack(TEST_AtlasSize, TEST_AtlasSize, &x, &y));
+		TEST_CHECK((x == 0) && (y == 0));
+	}
+	/*
+	 * Random glyph sized rectangles do not overlap and fill
+	 * most of the atlas before it is full
+	 */
+	{
+		Ref<TestAtlas>	atlas = new TestAtlas;
+
+		memset(used, 0, TEST_AtlasSize * TEST_AtlasSize);
+		area = 0;
+		for (n = 0; n < TEST_MaxRects; ++n)
+		{
+			int	w, h;
+
+			seed = seed * 1103515245 + 12345;
+			w = 4 + int((seed >> 16) % 21);
+			seed = seed * 1103515245 + 12345;
+			h = 8 + int((seed >> 16) % 17);
+			if (!atlas->Pack(w, h, &x, &y))
+				break;
+			if (!TEST_CHECK(Cover(used, x, y, w, h)))
+				break;
+			area += w * h;
+		}
+		TEST_CHECK(n < TEST_MaxRects);
+		TEST_CHECK(area > TEST_AtlasSize * TEST_AtlasSize / 2);
+	}
+	free(used);
+	return TestExit();
+}
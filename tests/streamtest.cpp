@@ -0,0 +1,118 @@
+/*
+ * Unit tests for render command streams.
+ *
+ * Records a small frame, checks that redundant state is filtered,
+ * that Compare finds the first different command, that Append and
+ * Copy keep the commands and that a stream saved with
+ * RenderStream::Write reads back the same.
+ */
+#include "vxtest.h"
+
+using namespace Vixen;
+
+#define	TEST_File	TEXT("streamtest.vix")
+
+/*
+ * Records a frame with two appearances, a moving matrix and instances.
+ * If \b change is not zero, the matrix of the second draw is different.
+ */
+static void RecordFrame(RenderStream* stream, Appearance** appear, Geometry** geo, int change)
+{
+	static const uint16	lights[3] = { 0, 2, 17 };
+	Matrix	mtx;
+	Renderer::Instance*	inst;
+
+	stream->BeginFrame(1);
+	stream->SetAppearance(appear[0]);
+	stream->SetAppearance(appear[0]);		// filtered
+	stream->SetMatrix(&mtx);				// identity
+	stream->SetLights(lights, 3);
+	stream->Draw(geo[0]);
+	mtx.TranslationMatrix(Vec3(1.0f, 2.0f, 3.0f + change));
+	stream->SetMatrix(&mtx);
+	stream->SetMatrix(&mtx);				// filtered
+	stream->SetLights(lights, 3);			// filtered
+	stream->Draw(geo[1]);
+	stream->SetAppearance(appear[1]);
+	inst = stream->DrawInstances(geo[0], 2);
+	for (int i = 0; i < 2; ++i)
+	{
+		memset(inst + i, 0, sizeof(Renderer::Instance));
+		inst[i].Transform[0] = inst[i].Transform[5] = inst[i].Transform[10] = 1.0f;
+		inst[i].Transform[3] = float(i);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Ref<Appearance>	appear[2];
+	Ref<TriMesh>	geo[2];
+	Appearance*		aptrs[2];
+	Geometry*		gptrs[2];
+
+	if (!TestInit())
+		return 1;
+	for (int i = 0; i < 2; ++i)
+	{
+		TCHAR	name[32];
+
+		appear[i] = new Appearance;
+		SPRINTF(name, TEXT("streamtest.appear%d"), i);
+		appear[i]->SetName(name);
+		aptrs[i] = appear[i];
+		geo[i] = new TriMesh;
+		SPRINTF(name, TEXT("streamtest.mesh%d"), i);
+		geo[i]->SetName(name);
+		gptrs[i] = geo[i];
+	}
+
+	Ref<RenderStream>	s1 = new RenderStream;
+	Ref<RenderStream>	s2 = new RenderStream;
+	Ref<RenderStream>	s3 = new RenderStream;
+	Ref<RenderStream>	saved = new RenderStream;
+
+	/*
+	 * Redundant state is not recorded:
+	 * frame, appearance, identity, lights, draw, matrix, draw, appearance, instances
+	 */
+	RecordFrame(s1, aptrs, gptrs, 0);
+	TEST_CHECK(s1->GetNumCommands() == 9);
+	TEST_CHECK(s1->GetNumObjects() == 4);
+	TEST_CHECK(s1->GetObj(0) == aptrs[0]);
+	TEST_CHECK(s1->GetObj(4) == NULL);
+	/*
+	 * The same frame compares equal, a different matrix is found
+	 */
+	RecordFrame(s2, aptrs, gptrs, 0);
+	TEST_CHECK(s1->Compare(*s2) == -1);
+	RecordFrame(s3, aptrs, gptrs, 1);
+	TEST_CHECK(s1->Compare(*s3) == 5);
+	TEST_CHECK(s3->Compare(*s1) == 5);
+	/*
+	 * A longer stream differs at the end of the shorter one
+	 */
+	TEST_CHECK(s2->Append(*s1));
+	TEST_CHECK(s2->GetNumCommands() == 18);
+	TEST_CHECK(s2->GetNumObjects() == 4);
+	TEST_CHECK(s1->Compare(*s2) == 9);
+	/*
+	 * Copy and empty
+	 */
+	TEST_CHECK(s3->Copy(s1));
+	TEST_CHECK(s3->Compare(*s1) == -1);
+	s3->Empty();
+	TEST_CHECK(s3->GetSize() == 0);
+	TEST_CHECK(s3->GetNumObjects() == 0);
+	/*
+	 * Saved streams read back the same. The objects read are
+	 * different objects with the same names.
+	 */
+	TEST_CHECK(s1->Write(TEST_File));
+	TEST_CHECK(saved->Read(TEST_File));
+	TEST_CHECK(saved->GetSize() == s1->GetSize());
+	TEST_CHECK(saved->GetNumObjects() == s1->GetNumObjects());
+	TEST_CHECK(saved->Compare(*s1) == -1);
+	TEST_CHECK(s1->Compare(*saved) == -1);
+	remove(TEST_File);
+	return TestExit();
+}
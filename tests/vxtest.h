@@ -0,0 +1,66 @@
+/*!
+ * @file vxtest.h
+ * @brief Checks shared by the unit tests.
+ *
+ * Each test is a console program which initializes Vixen, runs its
+ * checks and returns the number of checks which failed, so ctest
+ * reports the test as failed if any check fails.
+ *
+ * @code
+ *	int main(int argc, char** argv)
+ *	{
+ *		if (!TestInit())
+ *			return 1;
+ *		TEST_CHECK(Core::AtomTable::Intern(TEXT("a")) != 0);
+ *		return TestExit();
+ *	}
+ * @endcode
+ */
+#pragma once
+
+#include "vixen.h"
+
+static int	s_TestChecks = 0;
+static int	s_TestFailures = 0;
+
+/*!
+ * Checks a condition, printing the expression, file and
+ * line if it is false.
+ */
+#define	TEST_CHECK(cond) \
+	TestCheck((cond) != 0, #cond, __FILE__, __LINE__)
+
+static inline bool TestCheck(bool pass, const char* expr, const char* file, int line)
+{
+	++s_TestChecks;
+	if (pass)
+		return true;
+	++s_TestFailures;
+	fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expr);
+	return false;
+}
+
+/*
+ * Makes the world which initializes Vixen. Tests do not display anything
+ * so the base world is used.
+ */
+static inline bool TestInit()
+{
+	Vixen::World*	world = new Vixen::World;
+
+	world->IncUse();
+	if (world->OnInit())
+		return true;
+	fprintf(stderr, "cannot initialize Vixen\n");
+	return false;
+}
+
+/*
+ * Prints the number of checks which passed and returns the
+ * number which failed, to be returned from main.
+ */
+static inline int TestExit()
+{
+	printf("%d of %d checks passed\n", s_TestChecks - s_TestFailures, s_TestChecks);
+	return s_TestFailures;
+}